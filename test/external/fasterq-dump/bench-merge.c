@@ -0,0 +1,171 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/* ---------------------------------------------------------------------------------
+    micro-benchmark for the k-way merge in merge_sorter.c ( not part of ctest )
+
+    generates N sorted runs of synthetic lookup-keys, merges them with a linear
+    scan for the smallest key ( as merge_sorter.c did before ) and with the
+    loser-tree from merge_tree.c, checks that both produce the same sequence
+    and prints the time for both at fan-in 2, 4, 8, 16, 32 and 64.
+    below MERGE_TREE_MIN_FAN_IN merge_tree.c scans the keys as well, the two
+    columns measure the same thing there.
+
+    usage: fasterq-dump-bench-merge [ entries-per-run ]
+   --------------------------------------------------------------------------------- */
+
+#include "merge_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct run_t {
+    uint64_t * keys;
+    uint64_t count;
+    uint64_t pos;
+} run_t;
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void make_runs( run_t * runs, uint32_t fan_in, uint64_t per_run ) {
+    uint32_t i;
+    for ( i = 0; i < fan_in; ++i ) {
+        uint64_t j, key = 0;
+        runs[ i ] . keys = malloc( per_run * sizeof( uint64_t ) );
+        runs[ i ] . count = per_run;
+        runs[ i ] . pos = 0;
+        for ( j = 0; j < per_run; ++j ) {
+            /* spot-id << 1 | read-id, as hlp_make_key() produces */
+            key += ( uint64_t )( rand() % 8 );
+            runs[ i ] . keys[ j ] = key;
+        }
+    }
+}
+
+static void rewind_runs( run_t * runs, uint32_t fan_in ) {
+    uint32_t i;
+    for ( i = 0; i < fan_in; ++i ) { runs[ i ] . pos = 0; }
+}
+
+static void release_runs( run_t * runs, uint32_t fan_in ) {
+    uint32_t i;
+    for ( i = 0; i < fan_in; ++i ) { free( runs[ i ] . keys ); }
+}
+
+static uint64_t merge_linear( run_t * runs, uint32_t fan_in, uint64_t * dst ) {
+    uint64_t n = 0;
+    for ( ;; ) {
+        run_t * min = NULL;
+        uint32_t i;
+        for ( i = 0; i < fan_in; ++i ) {
+            run_t * r = &runs[ i ];
+            if ( r -> pos < r -> count ) {
+                if ( NULL == min || r -> keys[ r -> pos ] < min -> keys[ min -> pos ] ) {
+                    min = r;
+                }
+            }
+        }
+        if ( NULL == min ) { break; }
+        dst[ n++ ] = min -> keys[ min -> pos++ ];
+    }
+    return n;
+}
+
+static uint64_t merge_loser_tree( run_t * runs, uint32_t fan_in, uint64_t * dst ) {
+    uint64_t n = 0;
+    struct merge_tree_t * tree;
+    if ( 0 == make_merge_tree( &tree, fan_in ) ) {
+        int32_t idx;
+        uint32_t i;
+        for ( i = 0; i < fan_in; ++i ) {
+            merge_tree_set( tree, i, runs[ i ] . keys[ 0 ], runs[ i ] . count > 0 );
+        }
+        merge_tree_build( tree );
+        while ( ( idx = merge_tree_top( tree ) ) >= 0 ) {
+            run_t * r = &runs[ idx ];
+            dst[ n++ ] = r -> keys[ r -> pos++ ];
+            if ( r -> pos < r -> count ) {
+                merge_tree_replace_top( tree, r -> keys[ r -> pos ], true );
+            } else {
+                merge_tree_replace_top( tree, 0, false );
+            }
+        }
+        release_merge_tree( tree );
+    }
+    return n;
+}
+
+int main( int argc, char * argv[] ) {
+    uint64_t per_run = ( argc > 1 ) ? strtoull( argv[ 1 ], NULL, 10 ) : 1000000;
+    uint32_t fan_in;
+    int res = 0;
+
+    printf( "fan-in  entries     linear(s)  loser-tree(s)  speedup\n" );
+    for ( fan_in = 2; fan_in <= 64 && 0 == res; fan_in *= 2 ) {
+        run_t runs[ 64 ];
+        uint64_t total = per_run * fan_in;
+        uint64_t * dst1 = malloc( total * sizeof( uint64_t ) );
+        uint64_t * dst2 = malloc( total * sizeof( uint64_t ) );
+        double t0, t1, t2;
+        uint64_t n1, n2;
+
+        srand( fan_in );
+        make_runs( runs, fan_in, per_run );
+
+        t0 = now_seconds();
+        n1 = merge_linear( runs, fan_in, dst1 );
+        t1 = now_seconds();
+        rewind_runs( runs, fan_in );
+        n2 = merge_loser_tree( runs, fan_in, dst2 );
+        t2 = now_seconds();
+
+        if ( n1 != total || n2 != total ) {
+            printf( "fan-in %u : merged %lu / %lu of %lu entries\n", fan_in, n1, n2, total );
+            res = 1;
+        } else {
+            uint64_t i;
+            for ( i = 0; i < total && 0 == res; ++i ) {
+                if ( dst1[ i ] != dst2[ i ] ) {
+                    printf( "fan-in %u : difference at #%lu\n", fan_in, i );
+                    res = 1;
+                }
+            }
+        }
+        if ( 0 == res ) {
+            printf( "%6u  %10lu  %9.3f  %13.3f  %6.2fx\n",
+                    fan_in, total, t1 - t0, t2 - t1, ( t1 - t0 ) / ( t2 - t1 ) );
+        }
+        release_runs( runs, fan_in );
+        free( dst1 );
+        free( dst2 );
+    }
+    return res;
+}
@@ -0,0 +1,106 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/* ---------------------------------------------------------------------------------
+    throughput-benchmark for the ASCII <-> packed 4na kernels of fasterq-dump
+    ( not part of ctest )
+
+    packs and unpacks ( forward and reverse ) a buffer of random reads with every
+    implementation the cpu supports and prints the throughput in GB/s of bases
+
+    usage: fasterq-dump-bench-packed-4na [ read-length [ number-of-reads ] ]
+   --------------------------------------------------------------------------------- */
+
+#include "packed_4na.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static double gb_per_sec( uint64_t bases, double seconds ) {
+    return seconds > 0 ? ( bases / seconds ) / 1e9 : 0.0;
+}
+
+int main( int argc, char * argv[] ) {
+    uint32_t read_len = ( argc > 1 ) ? ( uint32_t )strtoul( argv[ 1 ], NULL, 10 ) : 150;
+    uint32_t num_reads = ( argc > 2 ) ? ( uint32_t )strtoul( argv[ 2 ], NULL, 10 ) : 1000000;
+    uint32_t packed_len = ( read_len + 1 ) / 2;
+    uint64_t total = ( uint64_t )read_len * num_reads;
+    uint8_t * ascii = malloc( total );
+    uint8_t * packed = malloc( ( uint64_t )packed_len * num_reads );
+    char * unpacked = malloc( total );
+    const p4na_impl_t impls[] = { p4na_scalar, p4na_sse41, p4na_avx2 };
+    uint64_t i;
+    uint32_t n, r;
+
+    if ( NULL == ascii || NULL == packed || NULL == unpacked || 0 == read_len ) {
+        fprintf( stderr, "cannot allocate buffers\n" );
+        return 1;
+    }
+    for ( i = 0; i < total; ++i ) {
+        ascii[ i ] = "ACGTACGTACGTACGN"[ rand() & 0x0F ];
+    }
+    /* touch the output-buffers, page-faults should not be measured */
+    memset( packed, 0, ( uint64_t )packed_len * num_reads );
+    memset( unpacked, 0, total );
+
+    printf( "read-length %u, %u reads\n", read_len, num_reads );
+    printf( "impl      pack GB/s  unpack GB/s  unpack-rev GB/s\n" );
+    for ( n = 0; n < sizeof impls / sizeof impls[ 0 ]; ++n ) {
+        double t0, t1, t2, t3;
+        if ( !p4na_set_impl( impls[ n ] ) ) {
+            printf( "%-8s  not supported by this cpu\n", p4na_impl_name( impls[ n ] ) );
+            continue;
+        }
+        t0 = now_seconds();
+        for ( r = 0; r < num_reads; ++r ) {
+            p4na_pack( ascii + ( uint64_t )r * read_len, read_len, packed + ( uint64_t )r * packed_len );
+        }
+        t1 = now_seconds();
+        for ( r = 0; r < num_reads; ++r ) {
+            p4na_unpack( packed + ( uint64_t )r * packed_len, read_len, unpacked + ( uint64_t )r * read_len, false );
+        }
+        t2 = now_seconds();
+        for ( r = 0; r < num_reads; ++r ) {
+            p4na_unpack( packed + ( uint64_t )r * packed_len, read_len, unpacked + ( uint64_t )r * read_len, true );
+        }
+        t3 = now_seconds();
+        printf( "%-8s  %9.2f  %11.2f  %15.2f\n", p4na_impl_name( impls[ n ] ),
+                gb_per_sec( total, t1 - t0 ), gb_per_sec( total, t2 - t1 ), gb_per_sec( total, t3 - t2 ) );
+    }
+    p4na_set_impl( p4na_auto );
+    free( ascii );
+    free( packed );
+    free( unpacked );
+    return 0;
+}
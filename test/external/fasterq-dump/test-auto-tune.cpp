@@ -0,0 +1,155 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the auto-tuning of fasterq-dump ( auto_tune.c ):
+* the plan follows the accession and the machine, values given on the commandline stay
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/auto_tune.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+TEST_SUITE ( TestAutoTune );
+
+static const size_t MB = 1024 * 1024;
+static const uint64_t GB = 1024 * 1024 * 1024ULL;
+
+/* a cSRA with 10 million spots on a machine with 8 cores and 16 GB of RAM available */
+static void make_input( at_input_t * input, insp_output_t * insp ) {
+    memset( insp, 0, sizeof *insp );
+    insp -> acc_type = acc_csra;
+    insp -> seq . first_row = 1;
+    insp -> seq . row_count = 10 * 1000 * 1000;
+    insp -> acc_size = 2 * GB;
+
+    memset( input, 0, sizeof *input );
+    input -> insp = insp;
+    input -> fmt = ft_fastq_split_3;
+    input -> total_ram = 32 * GB;
+    input -> avail_ram = 16 * GB;
+    input -> cores = 8;
+    input -> tmp_free = 500 * GB;
+    input -> lookup_estimate = 1 * GB;
+    input -> estimated_output_size = 10 * GB;
+}
+
+/* the defaults of fasterq-dump.c */
+static void make_plan( at_plan_t * plan ) {
+    memset( plan, 0, sizeof *plan );
+    plan -> num_threads = 6;
+    plan -> mem_limit = 50 * MB;
+    plan -> buf_size = 1 * MB;
+    plan -> cursor_cache = 5 * MB;
+    plan -> spill_io = sio_buffered;
+}
+
+TEST_CASE ( AutoTune_LookupInMemory ) {
+    insp_output_t insp;
+    at_input_t input;
+    at_plan_t plan;
+    make_input( &input, &insp );
+    make_plan( &plan );
+    REQUIRE_RC( at_make_plan( &input, &plan ) );
+    REQUIRE_EQ( plan . num_threads, ( uint32_t )8 );
+    REQUIRE( plan . rows_per_thread > 0 );
+    REQUIRE( plan . use_mem_lookup );
+    REQUIRE( plan . mem_lookup_limit > input . lookup_estimate );
+    /* should the lookup overflow: each thread sorts with its share, not with the lookup-budget */
+    REQUIRE_EQ( plan . mem_limit, ( size_t )( 16 * GB / 32 ) );
+    REQUIRE( plan . direct_write );
+    REQUIRE_EQ( plan . spill_io, sio_buffered );
+    REQUIRE_EQ( plan . buf_size, 8 * MB );
+    REQUIRE_EQ( plan . cursor_cache, 5 * MB );  /* local accession */
+    REQUIRE( 0 != plan . reason[ at_threads ][ 0 ] );
+}
+
+TEST_CASE ( AutoTune_LookupSpilled ) {
+    insp_output_t insp;
+    at_input_t input;
+    at_plan_t plan;
+    make_input( &input, &insp );
+    input . lookup_estimate = 20 * GB;
+    make_plan( &plan );
+    REQUIRE_RC( at_make_plan( &input, &plan ) );
+    REQUIRE( !plan . use_mem_lookup );
+    REQUIRE_EQ( plan . mem_limit, ( size_t )( 16 * GB / 32 ) );   /* 1/4 of the RAM shared by 8 threads */
+    REQUIRE_EQ( plan . spill_io, sio_direct );
+}
+
+TEST_CASE ( AutoTune_GivenStays ) {
+    insp_output_t insp;
+    at_input_t input;
+    at_plan_t plan;
+    make_input( &input, &insp );
+    input . given . num_threads = true;
+    input . given . buf_size = true;
+    input . given . mem_lookup = true;
+    input . given . direct_write = true;
+    make_plan( &plan );
+    plan . num_threads = 3;
+    plan . buf_size = 2 * MB;
+    REQUIRE_RC( at_make_plan( &input, &plan ) );
+    REQUIRE_EQ( plan . num_threads, ( uint32_t )3 );
+    REQUIRE_EQ( plan . buf_size, 2 * MB );
+    REQUIRE( !plan . use_mem_lookup );
+    REQUIRE( !plan . direct_write );
+}
+
+TEST_CASE ( AutoTune_SmallAndRemote ) {
+    insp_output_t insp;
+    at_input_t input;
+    at_plan_t plan;
+
+    /* not enough rows for 8 threads */
+    make_input( &input, &insp );
+    insp . seq . row_count = 350000;
+    make_plan( &plan );
+    REQUIRE_RC( at_make_plan( &input, &plan ) );
+    REQUIRE_EQ( plan . num_threads, ( uint32_t )3 );
+
+    /* remote: each thread caches the accession on a small scratch-device, bigger cursor-caches */
+    make_input( &input, &insp );
+    insp . acc_type = acc_sra_db;
+    insp . is_remote = true;
+    input . tmp_free = 16 * GB;
+    input . lookup_estimate = 0;
+    input . use_stdout = true;
+    make_plan( &plan );
+    REQUIRE_RC( at_make_plan( &input, &plan ) );
+    REQUIRE_EQ( plan . num_threads, ( uint32_t )4 );
+    REQUIRE( !plan . use_mem_lookup );
+    REQUIRE( !plan . direct_write );
+    REQUIRE( plan . cursor_cache > 5 * MB );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestAutoTune ( argc, argv );
+}
@@ -0,0 +1,186 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the defline-output of fasterq-dump:
+* the specialized emitter for the default deflines ( dflt_defline.c ) has to produce
+* the same bytes as the generic template-interpreter ( var_fmt.c )
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/var_fmt.c"
+#include "../../../tools/external/fasterq-dump/dflt_defline.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdio>
+#include <string>
+
+TEST_SUITE ( TestDefline );
+
+/* the same variables at the same indexes as in flex_printer.c */
+enum { sdi_acc = 0, sdi_sn = 1, sdi_sg = 2, sdi_rd1 = 3, sdi_rd2 = 4, sdi_qa = 5 };
+enum { idi_si = 0, idi_ri = 1, idi_rl = 2 };
+
+static struct vfmt_t * make_generic( const char * seq_defline, const char * qual_defline,
+                                     bool fasta, bool two_reads ) {
+    struct vfmt_desc_list_t * vdl = vfmt_create_desc_list();
+    vfmt_add_str_to_desc_list( vdl, "$ac",  sdi_acc, 0xFF );
+    vfmt_add_str_to_desc_list( vdl, "$sn",  sdi_sn,  idi_si );
+    vfmt_add_str_to_desc_list( vdl, "$sg",  sdi_sg,  0xFF );
+    vfmt_add_str_to_desc_list( vdl, "$RD1", sdi_rd1, 0xFF );
+    vfmt_add_str_to_desc_list( vdl, "$RD2", sdi_rd2, 0xFF );
+    vfmt_add_str_to_desc_list( vdl, "$QA",  sdi_qa,  0xFF );
+    vfmt_add_int_to_desc_list( vdl, "$si",  idi_si );
+    vfmt_add_int_to_desc_list( vdl, "$ri",  idi_ri );
+    vfmt_add_int_to_desc_list( vdl, "$rl",  idi_rl );
+
+    std::string s( seq_defline );
+    s += two_reads ? "\n$RD1$RD2\n" : "\n$RD1\n";
+    if ( !fasta ) {
+        s += qual_defline;
+        s += "\n$QA\n";
+    }
+    String fmt;
+    StringInit( &fmt, s . c_str(), s . size(), ( uint32_t )s . size() );
+    struct vfmt_t * res = vfmt_create( &fmt, vdl );
+    vfmt_release_desc_list( vdl );
+    return res;
+}
+
+static std::string to_std( const SBuffer_t * b ) {
+    return ( NULL == b ) ? std::string( "<NULL>" ) : std::string( b -> S . addr, b -> S . len );
+}
+
+static void make_S( String * s, const char * src ) {
+    if ( NULL == src ) {
+        StringInit( s, NULL, 0, 0 );
+    } else {
+        StringInitCString( s, src );
+    }
+}
+
+/* print one record both ways, return true if both are the same */
+static bool same_output( const char * seq_defline, const char * qual_defline, bool fasta,
+                         int64_t row_id, uint32_t read_id, const char * name,
+                         const char * read1, const char * read2, const char * qual ) {
+    dflt_emitter_t e;
+    if ( !dflt_match_emitter( &e, seq_defline, qual_defline, fasta ) ) { return false; }
+
+    String acc, sn, r1, r2, qa;
+    make_S( &acc, "SRR000001" );
+    make_S( &sn, name );
+    make_S( &r1, read1 );
+    make_S( &r2, read2 );
+    make_S( &qa, qual );
+
+    const String * str_args[ 6 ] = { &acc, NULL == name ? NULL : &sn, NULL,
+                                     &r1, NULL == read2 ? NULL : &r2, &qa };
+    uint64_t int_args[ 3 ] = { ( uint64_t )row_id, read_id, r1 . len + ( NULL == read2 ? 0 : r2 . len ) };
+
+    struct vfmt_t * fmt = make_generic( seq_defline, qual_defline, fasta, NULL != read2 );
+    std::string expected = to_std( vfmt_write_to_buffer( fmt, str_args, 6, int_args, 3 ) );
+    vfmt_release( fmt );
+
+    SBuffer_t buf;
+    make_SBuffer( &buf, 16 ); /* small on purpose: the emitter has to grow it */
+    rc_t rc = dflt_emit( &e, &buf, &acc, row_id, read_id, str_args[ sdi_sn ],
+                         &r1, str_args[ sdi_rd2 ], fasta ? NULL : &qa );
+    std::string actual = ( 0 == rc ) ? to_std( &buf ) : std::string( "<ERROR>" );
+    release_SBuffer( &buf );
+
+    if ( expected != actual ) {
+        fprintf( stderr, "expected: >%s<\nactual  : >%s<\n", expected . c_str(), actual . c_str() );
+    }
+    return expected == actual;
+}
+
+TEST_CASE ( u64_to_dec ) {
+    const uint64_t values[] = { 0, 1, 9, 10, 11, 99, 100, 101, 999, 1000, 65535, 4294967295ULL,
+                                4294967296ULL, 1234567890123456789ULL, 18446744073709551615ULL };
+    for ( uint64_t v : values ) {
+        char expected[ 32 ];
+        char actual[ HLP_MAX_DEC_DIGITS + 1 ];
+        int n = snprintf( expected, sizeof expected, "%llu", ( unsigned long long )v );
+        uint32_t len = hlp_u64_to_dec( actual, v );
+        REQUIRE_EQ( ( int )len, n );
+        REQUIRE_EQ( std::string( actual, len ), std::string( expected ) );
+    }
+}
+
+TEST_CASE ( all_defaults_match ) {
+    for ( int i = 0; i < 8; ++i ) {
+        bool has_name = ( 0 != ( i & 1 ) );
+        bool use_name = ( 0 != ( i & 2 ) );
+        bool use_read_id = ( 0 != ( i & 4 ) );
+        dflt_emitter_t e;
+        REQUIRE( dflt_match_emitter( &e, dflt_seq_defline( has_name, use_name, use_read_id, true ), NULL, true ) );
+        REQUIRE( dflt_match_emitter( &e, dflt_seq_defline( has_name, use_name, use_read_id, false ),
+                                     dflt_qual_defline( has_name, use_name, use_read_id ), false ) );
+        REQUIRE_EQ( e . use_read_id, use_read_id );
+    }
+}
+
+TEST_CASE ( custom_deflines_do_not_match ) {
+    dflt_emitter_t e;
+    REQUIRE( !dflt_match_emitter( &e, "@$ac.$si", "+$ac.$si", false ) );
+    REQUIRE( !dflt_match_emitter( &e, "@$ac.$si $sg length=$rl", NULL, true ) );
+    REQUIRE( !dflt_match_emitter( &e, NULL, NULL, true ) );
+    /* a default seq-defline with a custom qual-defline */
+    REQUIRE( !dflt_match_emitter( &e, dflt_seq_defline( true, true, true, false ), "+", false ) );
+    REQUIRE( !dflt_match_emitter( &e, dflt_seq_defline( true, true, true, false ), NULL, false ) );
+}
+
+TEST_CASE ( same_as_generic ) {
+    const int64_t rows[] = { 1, 9, 10, 99, 100, 12345, 9876543210LL };
+    const char * names[] = { "name_1", "", NULL, "a_very_long_spot_name_that_is_longer_than_twenty_chars" };
+    for ( int i = 0; i < 8; ++i ) {
+        bool has_name = ( 0 != ( i & 1 ) );
+        bool use_name = ( 0 != ( i & 2 ) );
+        bool use_read_id = ( 0 != ( i & 4 ) );
+        for ( int fasta = 0; fasta < 2; ++fasta ) {
+            const char * seq = dflt_seq_defline( has_name, use_name, use_read_id, fasta != 0 );
+            const char * qual = fasta ? NULL : dflt_qual_defline( has_name, use_name, use_read_id );
+            for ( int64_t row : rows ) {
+                for ( const char * name : names ) {
+                    REQUIRE( same_output( seq, qual, fasta != 0, row, 1, name,
+                                          "ACGTACGTNN", NULL, "??????????" ) );
+                    REQUIRE( same_output( seq, qual, fasta != 0, row, 2, name,
+                                          "ACGT", "TTGGCCAA", "IIIIIIIIIIII" ) );
+                    REQUIRE( same_output( seq, qual, fasta != 0, row, 1, name,
+                                          "", NULL, "" ) );
+                }
+            }
+        }
+    }
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestDefline ( argc, argv );
+}
@@ -0,0 +1,216 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the direct-output of fasterq-dump ( direct_out.c ):
+* chunks committed by concurrent threads have to end up in row-order in the output-files
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/file_tools.c"
+#include "../../../tools/external/fasterq-dump/out_compress.c"
+#include "../../../tools/external/fasterq-dump/telemetry.c"
+#include "../../../tools/external/fasterq-dump/direct_out.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <kproc/thread.h>
+
+#include <cstdio>
+#include <string>
+
+TEST_SUITE ( TestDirectOut );
+
+static const char * OUT_BASE = "test-direct-out.fastq";
+static const char * OUT_SECOND = "test-direct-out_1.fastq";
+
+/* what the rows produce: each row goes into dst 0, every 3rd row also into dst 1 */
+static std::string row_text( int64_t row ) {
+    char buf[ 64 ];
+    snprintf( buf, sizeof buf, "row #%ld\n", ( long )row );
+    return std::string( buf );
+}
+
+static std::string expected( uint32_t dst_id, int64_t first_row, uint64_t row_count ) {
+    std::string res;
+    for ( int64_t row = first_row; row < first_row + ( int64_t )row_count; ++row ) {
+        if ( 0 == dst_id || 0 == ( row % 3 ) ) { res += row_text( row ); }
+    }
+    return res;
+}
+
+static std::string read_file( KDirectory * dir, const char * filename ) {
+    std::string res;
+    const KFile * f;
+    if ( 0 == KDirectoryOpenFileRead( dir, &f, "%s", filename ) ) {
+        char buf[ 4096 ];
+        uint64_t pos = 0;
+        size_t num_read;
+        while ( 0 == KFileRead( f, pos, buf, sizeof buf, &num_read ) && num_read > 0 ) {
+            res . append( buf, num_read );
+            pos += num_read;
+        }
+        KFileRelease( f );
+    }
+    return res;
+}
+
+/* what a join-thread does in direct-write-mode: pick up chunks, produce, commit */
+static rc_t CC producer( const KThread * self, void * data ) {
+    struct dout_t * dout = ( struct dout_t * )data;
+    rc_t rc = 0;
+    SBuffer_t b0, b1;
+    Vector buffers;
+    uint64_t chunk_id;
+    int64_t first_row;
+    uint64_t row_count;
+
+    VectorInit( &buffers, 0, 2 );
+    make_SBuffer( &b0, 1024 );
+    make_SBuffer( &b1, 1024 );
+    VectorSet( &buffers, 0, &b0 );
+    VectorSet( &buffers, 1, &b1 );
+    while ( 0 == rc && dout_next_chunk( dout, &chunk_id, &first_row, &row_count ) ) {
+        for ( int64_t row = first_row; 0 == rc && row < first_row + ( int64_t )row_count; ++row ) {
+            std::string s = row_text( row );
+            rc = append_bytes_to_SBuffer( &b0, s . c_str(), s . size() );
+            if ( 0 == rc && 0 == ( row % 3 ) ) {
+                rc = append_bytes_to_SBuffer( &b1, s . c_str(), s . size() );
+            }
+        }
+        if ( 0 == rc ) {
+            rc = dout_commit_chunk( dout, chunk_id, &buffers );
+        }
+        clear_SBuffer( &b0 );
+        clear_SBuffer( &b1 );
+    }
+    if ( 0 != rc ) { dout_abort( dout ); }
+    release_SBuffer( &b0 );
+    release_SBuffer( &b1 );
+    VectorWhack( &buffers, NULL, NULL );
+    return rc;
+}
+
+static rc_t run_producers( struct dout_t * dout, uint32_t num_threads ) {
+    rc_t rc = 0;
+    KThread * threads[ 16 ];
+    uint32_t idx;
+    for ( idx = 0; 0 == rc && idx < num_threads; ++idx ) {
+        rc = KThreadMake( &threads[ idx ], producer, dout );
+    }
+    num_threads = idx;
+    for ( idx = 0; idx < num_threads; ++idx ) {
+        rc_t rc_thread;
+        KThreadWait( threads[ idx ], &rc_thread );
+        if ( 0 == rc ) { rc = rc_thread; }
+        KThreadRelease( threads[ idx ] );
+    }
+    return rc;
+}
+
+TEST_CASE ( DirectOut_ChunkRows ) {
+    REQUIRE_EQ( dout_calc_chunk_rows( 100, 0 ), ( uint64_t )100 );
+    REQUIRE_EQ( dout_calc_chunk_rows( 1000, 1000 * 1024 ), ( uint64_t )( DOUT_DFLT_CHUNK_BYTES / 1024 ) );
+    /* rows bigger than a chunk: at least one row per chunk */
+    REQUIRE_EQ( dout_calc_chunk_rows( 2, ( size_t )DOUT_DFLT_CHUNK_BYTES * 4 ), ( uint64_t )1 );
+}
+
+TEST_CASE ( DirectOut_Chunks ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    struct dout_t * dout;
+    REQUIRE_RC( dout_create( &dout, dir, OUT_BASE, 5, 10, 4, true, false, ct_none ) );
+
+    uint64_t chunk_id;
+    int64_t first_row;
+    uint64_t row_count;
+    REQUIRE( dout_next_chunk( dout, &chunk_id, &first_row, &row_count ) );
+    REQUIRE_EQ( chunk_id, ( uint64_t )0 );
+    REQUIRE_EQ( first_row, ( int64_t )5 );
+    REQUIRE_EQ( row_count, ( uint64_t )4 );
+    REQUIRE( dout_next_chunk( dout, &chunk_id, &first_row, &row_count ) );
+    REQUIRE( dout_next_chunk( dout, &chunk_id, &first_row, &row_count ) );
+    REQUIRE_EQ( chunk_id, ( uint64_t )2 );
+    REQUIRE_EQ( first_row, ( int64_t )13 );
+    REQUIRE_EQ( row_count, ( uint64_t )2 );
+    REQUIRE( !dout_next_chunk( dout, &chunk_id, &first_row, &row_count ) );
+
+    REQUIRE_RC( dout_release( dout ) );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( DirectOut_ConcurrentCommits ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    const uint64_t row_count = 100000;
+    struct dout_t * dout;
+    REQUIRE_RC( dout_create( &dout, dir, OUT_BASE, 1, row_count, 37, true, false, ct_none ) );
+    REQUIRE_RC( run_producers( dout, 8 ) );
+    uint64_t written = dout_bytes_written( dout );
+    REQUIRE_RC( dout_release( dout ) );
+
+    std::string out0 = read_file( dir, OUT_BASE );
+    std::string out1 = read_file( dir, OUT_SECOND );
+    REQUIRE( out0 == expected( 0, 1, row_count ) );
+    REQUIRE( out1 == expected( 1, 1, row_count ) );
+    REQUIRE_EQ( written, ( uint64_t )( out0 . size() + out1 . size() ) );
+
+    KDirectoryRemove( dir, true, "%s", OUT_BASE );
+    KDirectoryRemove( dir, true, "%s", OUT_SECOND );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( DirectOut_NoOverwrite ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    struct dout_t * dout;
+    /* create the file, then try again without force */
+    REQUIRE_RC( dout_create( &dout, dir, OUT_BASE, 1, 10, 10, true, false, ct_none ) );
+    REQUIRE_RC( run_producers( dout, 1 ) );
+    REQUIRE_RC( dout_release( dout ) );
+
+    REQUIRE_RC( dout_create( &dout, dir, OUT_BASE, 1, 10, 10, false, false, ct_none ) );
+    REQUIRE_RC_FAIL( run_producers( dout, 2 ) );
+    REQUIRE_RC( dout_release( dout ) );
+    REQUIRE( read_file( dir, OUT_BASE ) == expected( 0, 1, 10 ) );
+
+    /* with append the output goes at the end of the existing file */
+    REQUIRE_RC( dout_create( &dout, dir, OUT_BASE, 11, 10, 3, false, true, ct_none ) );
+    REQUIRE_RC( run_producers( dout, 4 ) );
+    REQUIRE_RC( dout_release( dout ) );
+    REQUIRE( read_file( dir, OUT_BASE ) == expected( 0, 1, 20 ) );
+
+    KDirectoryRemove( dir, true, "%s", OUT_BASE );
+    KDirectoryRemove( dir, true, "%s", OUT_SECOND );
+    KDirectoryRelease( dir );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestDirectOut ( argc, argv );
+}
@@ -0,0 +1,163 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the in-memory lookup of fasterq-dump ( mem_lookup.c ):
+* what is put into it comes back through memlkp_bases(), an exceeded mem-limit is
+* reported as an overflow ( and not as an error ) so that the caller can fall back
+* to the lookup-files
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/file_tools.c"
+#include "../../../tools/external/fasterq-dump/file_printer.c"
+#include "../../../tools/external/fasterq-dump/packed_4na.c"
+#include "../../../tools/external/fasterq-dump/telemetry.c"
+#include "../../../tools/external/fasterq-dump/spill_io.c"
+#include "../../../tools/external/fasterq-dump/index.c"
+#include "../../../tools/external/fasterq-dump/lookup_reader.c"
+#include "../../../tools/external/fasterq-dump/mem_lookup.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestMemLookup );
+
+static const uint64_t ROWS = 10;
+
+/* what sorter.c puts into the lookup: [dna_len_t][4na-packed bases] */
+static std::vector< uint8_t > pack( const std::string & bases ) {
+    dna_len_t dna_len = ( dna_len_t )bases . size();
+    std::vector< uint8_t > res( sizeof dna_len + ( dna_len + 1 ) / 2 );
+    memcpy( res . data(), &dna_len, sizeof dna_len );
+    p4na_pack( ( const uint8_t * )bases . data(), dna_len, res . data() + sizeof dna_len );
+    return res;
+}
+
+static rc_t put( struct mem_lookup_t * l, mem_lookup_slab_t * slab,
+                 int64_t row_id, uint32_t read_id, const std::string & bases ) {
+    std::vector< uint8_t > packed = pack( bases );
+    String S;
+    StringInit( &S, ( const char * )packed . data(), packed . size(), ( uint32_t )packed . size() );
+    return memlkp_put( l, slab, hlp_make_key( row_id, read_id ), &S );
+}
+
+static std::string get( const struct mem_lookup_t * l, int64_t row_id, uint32_t read_id, bool reverse ) {
+    std::string res;
+    SBuffer_t B;
+    if ( 0 == make_SBuffer( &B, 16 ) ) {
+        if ( 0 == memlkp_bases( l, row_id, read_id, &B, reverse ) ) {
+            res . assign( B . S . addr, B . S . len );
+        }
+        release_SBuffer( &B );
+    }
+    return res;
+}
+
+/* the slots of ROWS rows, see memlkp_make() */
+static size_t slot_bytes( void ) {
+    return ( ROWS + 2 ) * 2 * sizeof( const uint8_t * );
+}
+
+TEST_CASE ( MemLookup_RoundTrip ) {
+    struct mem_lookup_t * l = NULL;
+    mem_lookup_slab_t slab;
+    REQUIRE_RC( memlkp_make( &l, ROWS, slot_bytes() + MEMLKP_BLOCK_SIZE ) );
+    memlkp_init_slab( &slab );
+    REQUIRE_RC( put( l, &slab, 1, 1, "ACGTN" ) );
+    REQUIRE_RC( put( l, &slab, 1, 2, "GGGCCCAT" ) );
+    REQUIRE_RC( put( l, &slab, ROWS, 1, "T" ) );
+    REQUIRE_EQ( get( l, 1, 1, false ), std::string( "ACGTN" ) );
+    REQUIRE_EQ( get( l, 1, 2, false ), std::string( "GGGCCCAT" ) );
+    REQUIRE_EQ( get( l, 1, 2, true ), std::string( "ATGGGCCC" ) );
+    REQUIRE_EQ( get( l, ROWS, 1, false ), std::string( "T" ) );
+    REQUIRE_EQ( memlkp_entries( l ), ( uint64_t )3 );
+    REQUIRE( !memlkp_overflowed( l ) );
+    memlkp_release( l );
+}
+
+TEST_CASE ( MemLookup_BadKey_IsNoOverflow ) {
+    struct mem_lookup_t * l = NULL;
+    mem_lookup_slab_t slab;
+    rc_t rc;
+    REQUIRE_RC( memlkp_make( &l, ROWS, slot_bytes() + MEMLKP_BLOCK_SIZE ) );
+    memlkp_init_slab( &slab );
+    /* a key beyond the slots is an error, the caller must not fall back */
+    rc = put( l, &slab, ROWS + 5, 1, "ACGT" );
+    REQUIRE_RC_FAIL( rc );
+    REQUIRE( !memlkp_is_overflow_rc( rc ) );
+    REQUIRE( !memlkp_overflowed( l ) );
+    REQUIRE_EQ( get( l, 2, 1, false ), std::string() );
+    memlkp_release( l );
+}
+
+TEST_CASE ( MemLookup_Overflow ) {
+    struct mem_lookup_t * l = NULL;
+    mem_lookup_slab_t slab1, slab2;
+    rc_t rc;
+    /* room for the slots and one block */
+    REQUIRE_RC( memlkp_make( &l, ROWS, slot_bytes() + MEMLKP_BLOCK_SIZE ) );
+    memlkp_init_slab( &slab1 );
+    memlkp_init_slab( &slab2 );
+    REQUIRE_RC( put( l, &slab1, 1, 1, "ACGT" ) );
+    /* a second producer needs a second block */
+    rc = put( l, &slab2, 2, 1, "ACGT" );
+    REQUIRE_RC_FAIL( rc );
+    REQUIRE( memlkp_is_overflow_rc( rc ) );
+    REQUIRE( memlkp_overflowed( l ) );
+    /* the other producers stop too, even with room left in their block */
+    rc = put( l, &slab1, 3, 1, "ACGT" );
+    REQUIRE_RC_FAIL( rc );
+    REQUIRE( memlkp_is_overflow_rc( rc ) );
+    REQUIRE_EQ( memlkp_entries( l ), ( uint64_t )1 );
+    REQUIRE( memlkp_bytes_used( l ) <= slot_bytes() + MEMLKP_BLOCK_SIZE );
+    memlkp_release( l );
+}
+
+TEST_CASE ( MemLookup_SlotsOverLimit ) {
+    struct mem_lookup_t * l = NULL;
+    /* not even the slots fit: no lookup, the caller uses the lookup-files */
+    rc_t rc = memlkp_make( &l, ROWS, slot_bytes() - 1 );
+    REQUIRE_RC_FAIL( rc );
+    REQUIRE( memlkp_is_overflow_rc( rc ) );
+    REQUIRE_NULL( l );
+}
+
+TEST_CASE ( MemLookup_MallocFailure_IsNoOverflow ) {
+    /* the rc of a failing malloc() has the same object but not the same state */
+    rc_t rc = RC( rcVDB, rcNoTarg, rcInserting, rcMemory, rcExhausted );
+    REQUIRE( !memlkp_is_overflow_rc( rc ) );
+    REQUIRE( memlkp_is_overflow_rc( memlkp_overflow_rc() ) );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestMemLookup ( argc, argv );
+}
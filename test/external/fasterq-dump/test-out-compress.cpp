@@ -0,0 +1,176 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the compressed output of fasterq-dump ( out_compress.c ):
+* independently compressed blocks, concatenated, have to inflate to the original output
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/file_tools.c"
+#include "../../../tools/external/fasterq-dump/out_compress.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdio>
+#include <string>
+
+TEST_SUITE ( TestOutCompress );
+
+static std::string make_fastq( size_t rows, uint32_t seed ) {
+    std::string res;
+    char buf[ 64 ];
+    srand( seed );
+    for ( size_t row = 0; row < rows; ++row ) {
+        snprintf( buf, sizeof buf, "@SRR000001.%lu length=32\n", ( unsigned long )row );
+        res += buf;
+        for ( int i = 0; i < 32; ++i ) { res += "ACGTN"[ rand() % 5 ]; }
+        res += "\n+\n";
+        for ( int i = 0; i < 32; ++i ) { res += ( char )( '!' + rand() % 40 ); }
+        res += "\n";
+    }
+    return res;
+}
+
+/* inflate a multi-member gzip-stream, the way gzip / zcat do it */
+static bool gunzip( const std::string & src, std::string & dst ) {
+    size_t pos = 0;
+    dst . clear();
+    while ( pos < src . size() ) {
+        z_stream zs;
+        char buf[ 16 * 1024 ];
+        int zr;
+        memset( &zs, 0, sizeof zs );
+        if ( Z_OK != inflateInit2( &zs, MAX_WBITS + 16 ) ) { return false; }
+        zs . next_in = ( Bytef * )( src . data() + pos );
+        zs . avail_in = ( uInt )( src . size() - pos );
+        do {
+            zs . next_out = ( Bytef * )buf;
+            zs . avail_out = sizeof buf;
+            zr = inflate( &zs, Z_NO_FLUSH );
+            dst . append( buf, sizeof buf - zs . avail_out );
+        } while ( Z_OK == zr );
+        pos = src . size() - zs . avail_in;
+        inflateEnd( &zs );
+        if ( Z_STREAM_END != zr ) { return false; }
+    }
+    return true;
+}
+
+/* walk the BGZF-members: each one has to announce its own size in the BC-field */
+static bool check_bgzf( const std::string & src, size_t * members ) {
+    size_t pos = 0;
+    *members = 0;
+    while ( pos + BGZF_HDR_SIZE <= src . size() ) {
+        const uint8_t * m = ( const uint8_t * )src . data() + pos;
+        if ( 0 != memcmp( m, bgzf_hdr, 16 ) ) { return false; }
+        pos += ( size_t )( m[ 16 ] | ( m[ 17 ] << 8 ) ) + 1;
+        ( *members )++;
+    }
+    return pos == src . size();
+}
+
+static std::string compress_blocks( compress_t ct, const std::string & src, size_t block_size ) {
+    std::string res;
+    SBuffer_t packed;
+    if ( 0 == make_SBuffer( &packed, 1024 ) ) {
+        for ( size_t pos = 0; pos < src . size(); pos += block_size ) {
+            size_t len = src . size() - pos;
+            if ( len > block_size ) { len = block_size; }
+            if ( 0 != ocmp_compress( ct, src . data() + pos, len, &packed ) ) { break; }
+            res . append( packed . S . addr, packed . S . size );
+        }
+        release_SBuffer( &packed );
+    }
+    return res;
+}
+
+TEST_CASE ( OutCompress_Parse ) {
+    REQUIRE_EQ( hlp_get_compress_t( NULL ), ct_none );
+    REQUIRE_EQ( hlp_get_compress_t( "gzip" ), ct_gzip );
+    REQUIRE_EQ( hlp_get_compress_t( "ZSTD" ), ct_zstd );
+    REQUIRE_EQ( hlp_get_compress_t( "none" ), ct_none );
+    REQUIRE_EQ( hlp_get_compress_t( "bzip2" ), ct_unknown );
+    REQUIRE( ocmp_available( ct_gzip ) );
+    REQUIRE( !ocmp_available( ct_unknown ) );
+}
+
+TEST_CASE ( OutCompress_Gzip_Blocks ) {
+    std::string fastq = make_fastq( 50000, 1 );
+    /* block-size as used by the threads and an odd one, smaller than a BGZF-member */
+    size_t block_sizes[] = { OCMP_BLOCK_SIZE, 12345 };
+    for ( size_t i = 0; i < sizeof block_sizes / sizeof block_sizes[ 0 ]; ++i ) {
+        std::string packed = compress_blocks( ct_gzip, fastq, block_sizes[ i ] );
+        size_t members;
+        REQUIRE( check_bgzf( packed, &members ) );
+        REQUIRE_GE( members, ( fastq . size() + BGZF_MAX_INPUT - 1 ) / BGZF_MAX_INPUT );
+        std::string unpacked;
+        REQUIRE( gunzip( packed, unpacked ) );
+        REQUIRE( unpacked == fastq );
+    }
+}
+
+TEST_CASE ( OutCompress_Empty ) {
+    SBuffer_t packed;
+    REQUIRE_RC( make_SBuffer( &packed, 16 ) );
+    REQUIRE_RC( ocmp_compress( ct_gzip, "", 0, &packed ) );
+    REQUIRE_EQ( packed . S . size, ( size_t )0 );
+    release_SBuffer( &packed );
+}
+
+TEST_CASE ( OutCompress_EOF_Marker ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    const char * filename = "test-out-compress.fastq.gz";
+    std::string fastq = make_fastq( 1000, 2 );
+    std::string packed = compress_blocks( ct_gzip, fastq, OCMP_BLOCK_SIZE );
+
+    KFile * f;
+    size_t num_writ;
+    REQUIRE_RC( KDirectoryCreateFile( dir, &f, false, 0664, kcmInit, "%s", filename ) );
+    REQUIRE_RC( KFileWriteAll( f, 0, packed . data(), packed . size(), &num_writ ) );
+    KFileRelease( f );
+    REQUIRE_RC( ocmp_append_eof( ct_gzip, dir, filename ) );
+
+    uint64_t file_size;
+    REQUIRE_RC( KDirectoryFileSize( dir, &file_size, "%s", filename ) );
+    REQUIRE_EQ( file_size, ( uint64_t )( packed . size() + sizeof bgzf_eof ) );
+
+    /* the EOF-marker is an empty member: the content does not change */
+    std::string unpacked;
+    REQUIRE( gunzip( packed + std::string( ( const char * )bgzf_eof, sizeof bgzf_eof ), unpacked ) );
+    REQUIRE( unpacked == fastq );
+
+    KDirectoryRemove( dir, true, "%s", filename );
+    KDirectoryRelease( dir );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestOutCompress ( argc, argv );
+}
@@ -0,0 +1,153 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the ASCII <-> packed 4na kernels of fasterq-dump
+* every implementation has to produce the same bytes as the table-based code
+* that sorter.c and lookup_reader.c used before
+*/
+
+#include "../../../tools/external/fasterq-dump/packed_4na.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestPacked4na );
+
+/* the former pack_read_2_4na() of sorter.c, without the length-prefix */
+static void ref_pack( const uint8_t * src, uint32_t count, uint8_t * dst ) {
+    uint32_t dst_idx = 0;
+    for ( uint32_t src_idx = 0; src_idx < count; ++src_idx ) {
+        uint8_t base = ( xASCII_to_4na[ src[ src_idx ] ] & 0x0F );
+        if ( 0 == ( src_idx & 0x01 ) ) {
+            dst[ dst_idx ] = ( base << 4 );
+        } else {
+            dst[ dst_idx++ ] |= base;
+        }
+    }
+}
+
+/* the former unpack_4na() of lookup_reader.c, without the length-prefix */
+static void ref_unpack( const uint8_t * src, uint32_t count, char * dst, bool reverse ) {
+    const char * lookup = reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd;
+    int32_t dst_idx = reverse ? count - 1 : 0;
+    for ( uint32_t src_idx = 0; dst_idx >= 0 && src_idx < ( count + 1 ) / 2; ++src_idx ) {
+        uint8_t packed_byte = src[ src_idx ];
+        if ( dst_idx < ( int32_t )count ) {
+            dst[ dst_idx ] = lookup[ ( packed_byte >> 4 ) & 0x0F ];
+            dst_idx += reverse ? -1 : 1;
+        }
+        if ( dst_idx >= 0 && dst_idx < ( int32_t )count ) {
+            dst[ dst_idx ] = lookup[ packed_byte & 0x0F ];
+            dst_idx += reverse ? -1 : 1;
+        }
+    }
+}
+
+static std::vector< uint8_t > random_bases( uint32_t count ) {
+    static const char alphabet[] = "ACGTACGTACGTNacgtn.-";
+    std::vector< uint8_t > res( count );
+    for ( uint32_t i = 0; i < count; ++i ) {
+        /* mostly bases, sometimes any byte at all */
+        res[ i ] = ( 0 == rand() % 16 ) ? ( uint8_t )( rand() % 256 )
+                                         : ( uint8_t )alphabet[ rand() % ( sizeof alphabet - 1 ) ];
+    }
+    return res;
+}
+
+static const p4na_impl_t impls[] = { p4na_scalar, p4na_sse41, p4na_avx2 };
+
+TEST_CASE ( pack_identical ) {
+    srand( 1 );
+    for ( p4na_impl_t impl : impls ) {
+        if ( p4na_set_impl( impl ) ) {
+            for ( uint32_t count = 1; count < 300; ++count ) {
+                std::vector< uint8_t > src = random_bases( count );
+                std::vector< uint8_t > expected( ( count + 1 ) / 2 + 1, 0xAA );
+                std::vector< uint8_t > actual( ( count + 1 ) / 2 + 1, 0xAA );
+                ref_pack( src . data(), count, expected . data() );
+                p4na_pack( src . data(), count, actual . data() );
+                REQUIRE_EQ( memcmp( expected . data(), actual . data(), expected . size() ), 0 );
+            }
+        }
+    }
+    REQUIRE( p4na_set_impl( p4na_auto ) );
+}
+
+TEST_CASE ( unpack_identical ) {
+    srand( 2 );
+    for ( p4na_impl_t impl : impls ) {
+        if ( p4na_set_impl( impl ) ) {
+            for ( uint32_t count = 1; count < 300; ++count ) {
+                std::vector< uint8_t > src = random_bases( count );
+                std::vector< uint8_t > packed( ( count + 1 ) / 2 );
+                ref_pack( src . data(), count, packed . data() );
+                for ( int reverse = 0; reverse < 2; ++reverse ) {
+                    /* one extra byte to detect writes beyond count */
+                    std::string expected( count + 1, '#' );
+                    std::string actual( count + 1, '#' );
+                    ref_unpack( packed . data(), count, &expected[ 0 ], reverse != 0 );
+                    p4na_unpack( packed . data(), count, &actual[ 0 ], reverse != 0 );
+                    REQUIRE_EQ( expected, actual );
+                }
+            }
+        }
+    }
+    REQUIRE( p4na_set_impl( p4na_auto ) );
+}
+
+TEST_CASE ( roundtrip ) {
+    const char * bases = "ACGTTGCANNACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTTTTTGGGGCCCCAAAAC";
+    uint32_t count = ( uint32_t )strlen( bases );
+    for ( p4na_impl_t impl : impls ) {
+        if ( p4na_set_impl( impl ) ) {
+            std::vector< uint8_t > packed( ( count + 1 ) / 2 );
+            std::string unpacked( count, ' ' );
+            p4na_pack( ( const uint8_t * )bases, count, packed . data() );
+            p4na_unpack( packed . data(), count, &unpacked[ 0 ], false );
+            REQUIRE_EQ( unpacked, std::string( bases ) );
+            /* the reverse-complement of the first 8 bases, found at the end */
+            p4na_unpack( packed . data(), count, &unpacked[ 0 ], true );
+            REQUIRE_EQ( unpacked . substr( count - 8 ), std::string( "TGCAACGT" ) );
+        }
+    }
+    REQUIRE( p4na_set_impl( p4na_auto ) );
+}
+
+TEST_CASE ( unsupported_impl ) {
+    REQUIRE( p4na_set_impl( p4na_scalar ) );
+    REQUIRE_EQ( p4na_get_impl(), p4na_scalar );
+    REQUIRE( p4na_set_impl( p4na_auto ) );
+    REQUIRE_NE( p4na_get_impl(), p4na_auto );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestPacked4na ( argc, argv );
+}
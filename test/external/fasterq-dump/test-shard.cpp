@@ -0,0 +1,332 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the sharding of fasterq-dump ( shard.c ):
+* shards cover the table without gaps, the merge stitches the fragments together in row-order
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/file_tools.c"
+#include "../../../tools/external/fasterq-dump/out_compress.c"
+#include "../../../tools/external/fasterq-dump/telemetry.c"
+#include "../../../tools/external/fasterq-dump/progress_thread.c"
+#include "../../../tools/external/fasterq-dump/copy_machine.c"
+#include "../../../tools/external/fasterq-dump/concatenator.c"
+#include "../../../tools/external/fasterq-dump/shard.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <string>
+
+TEST_SUITE ( TestShard );
+
+static const char * OUT_DIR = "test-shard.out";
+
+static void write_file( KDirectory * dir, const std::string & path, const std::string & content ) {
+    KFile * f;
+    size_t num_writ;
+    if ( 0 == KDirectoryCreateFile( dir, &f, false, 0664, kcmInit | kcmParents, "%s", path . c_str() ) ) {
+        KFileWriteAll( f, 0, content . data(), content . size(), &num_writ );
+        KFileRelease( f );
+    }
+}
+
+static std::string read_file( KDirectory * dir, const std::string & path ) {
+    std::string res;
+    const KFile * f;
+    if ( 0 == KDirectoryOpenFileRead( dir, &f, "%s", path . c_str() ) ) {
+        char buf[ 4096 ];
+        uint64_t pos = 0;
+        size_t num_read;
+        while ( 0 == KFileRead( f, pos, buf, sizeof buf, &num_read ) && num_read > 0 ) {
+            res . append( buf, num_read );
+            pos += num_read;
+        }
+        KFileRelease( f );
+    }
+    return res;
+}
+
+/* what a shard-run leaves behind: fragments in the shard-directory plus the manifest,
+   rows is either '--rows first-last' or '--shard idx/count' */
+static rc_t make_shard( KDirectory * dir, char * shard_dir, size_t shard_dir_size,
+                        const char * rows, bool with_unpaired ) {
+    shard_t shard;
+    char filename[ 4096 ];
+    memset( &shard, 0, sizeof shard );
+    rc_t rc = ( NULL != strchr( rows, '/' ) ) ? shard_parse_idx( &shard, rows ) : shard_parse_rows( &shard, rows );
+    if ( 0 == rc ) { rc = shard_apply( &shard, 1, 100 ); }
+    if ( 0 == rc ) {
+        rc = shard_make_output_filename( &shard, "SRR000001", "test-shard.out/SRR000001.fastq",
+                                         shard_dir, shard_dir_size, filename, sizeof filename );
+    }
+    if ( 0 == rc ) {
+        std::string sd( shard_dir );
+        write_file( dir, sd + "/SRR000001_1.fastq", std::string( "R1 " ) + rows + "\n" );
+        write_file( dir, sd + "/SRR000001_2.fastq", std::string( "R2 " ) + rows + "\n" );
+        if ( with_unpaired ) {
+            write_file( dir, sd + "/SRR000001.fastq", std::string( "U " ) + rows + "\n" );
+        }
+
+        shard_manifest_args_t args;
+        args . shard = &shard;
+        args . shard_dir = shard_dir;
+        args . accession = "SRR000001";
+        args . format = "FASTQ split 3";
+        args . compress = "none";
+        rc = shard_write_manifest( dir, &args );
+    }
+    return rc;
+}
+
+TEST_CASE ( Shard_Parse ) {
+    shard_t shard;
+    memset( &shard, 0, sizeof shard );
+    REQUIRE_RC( shard_parse_idx( &shard, "3/8" ) );
+    REQUIRE( shard . requested );
+    REQUIRE_EQ( shard . idx, ( uint32_t )3 );
+    REQUIRE_EQ( shard . count, ( uint32_t )8 );
+    REQUIRE_RC_FAIL( shard_parse_idx( &shard, "0/8" ) );
+    REQUIRE_RC_FAIL( shard_parse_idx( &shard, "9/8" ) );
+    REQUIRE_RC_FAIL( shard_parse_idx( &shard, "3" ) );
+    REQUIRE_RC_FAIL( shard_parse_idx( &shard, "3/8x" ) );
+
+    REQUIRE_RC( shard_parse_rows( &shard, "1001-2000" ) );
+    REQUIRE_EQ( shard . idx, ( uint32_t )0 );
+    REQUIRE_EQ( shard . req_first, ( int64_t )1001 );
+    REQUIRE_EQ( shard . req_last, ( int64_t )2000 );
+    REQUIRE_RC_FAIL( shard_parse_rows( &shard, "2000-1001" ) );
+    REQUIRE_RC_FAIL( shard_parse_rows( &shard, "0-10" ) );
+    REQUIRE_RC_FAIL( shard_parse_rows( &shard, "10" ) );
+}
+
+TEST_CASE ( Shard_Apply_Covers_Table ) {
+    const uint32_t counts[] = { 1, 3, 7, 64, 999 };
+    for ( size_t c = 0; c < sizeof counts / sizeof counts[ 0 ]; ++c ) {
+        int64_t next = 5;
+        for ( uint32_t idx = 1; idx <= counts[ c ]; ++idx ) {
+            shard_t shard;
+            memset( &shard, 0, sizeof shard );
+            shard . requested = true;
+            shard . idx = idx;
+            shard . count = counts[ c ];
+            REQUIRE_RC( shard_apply( &shard, 5, 999 ) );
+            REQUIRE_EQ( shard . first_row, next );
+            next += shard . row_count;
+        }
+        REQUIRE_EQ( next, ( int64_t )( 5 + 999 ) );
+    }
+}
+
+TEST_CASE ( Shard_Apply_Empty ) {
+    /* 8 shards of 5 rows: 3 of them would be empty, the others still cover the table */
+    int64_t next = 1;
+    uint32_t empty = 0;
+    for ( uint32_t idx = 1; idx <= 8; ++idx ) {
+        shard_t shard;
+        memset( &shard, 0, sizeof shard );
+        shard . requested = true;
+        shard . idx = idx;
+        shard . count = 8;
+        if ( 0 != shard_apply( &shard, 1, 5 ) ) {
+            ++empty;
+        } else {
+            REQUIRE_EQ( shard . first_row, next );
+            REQUIRE_LT( ( uint64_t )0, shard . row_count );
+            next += shard . row_count;
+        }
+    }
+    REQUIRE_EQ( empty, ( uint32_t )3 );
+    REQUIRE_EQ( next, ( int64_t )6 );
+}
+
+TEST_CASE ( Shard_Apply_Rows ) {
+    shard_t shard;
+    memset( &shard, 0, sizeof shard );
+    REQUIRE_RC( shard_parse_rows( &shard, "900-2000" ) );
+    REQUIRE_RC( shard_apply( &shard, 1, 1000 ) );
+    REQUIRE_EQ( shard . first_row, ( int64_t )900 );
+    REQUIRE_EQ( shard . row_count, ( uint64_t )101 );
+    REQUIRE_RC( shard_parse_rows( &shard, "2000-3000" ) );
+    REQUIRE_RC_FAIL( shard_apply( &shard, 1, 1000 ) );
+}
+
+TEST_CASE ( Shard_Rows_Of_Thread ) {
+    /* 3 threads over rows 11..20 ( end_row = 21 ), 4 rows per thread */
+    REQUIRE_EQ( hlp_rows_of_thread( 11, 4, 21 ), ( uint64_t )4 );
+    REQUIRE_EQ( hlp_rows_of_thread( 19, 4, 21 ), ( uint64_t )2 );
+    REQUIRE_EQ( hlp_rows_of_thread( 23, 4, 21 ), ( uint64_t )0 );
+}
+
+TEST_CASE ( Shard_Output_Filename ) {
+    shard_t shard;
+    char shard_dir[ 4096 ];
+    char filename[ 4096 ];
+    memset( &shard, 0, sizeof shard );
+    shard . first_row = 1001;
+    shard . row_count = 1000;
+    REQUIRE_RC( shard_make_output_filename( &shard, "SRR000001", "/out/SRR000001.fastq.gz",
+                                            shard_dir, sizeof shard_dir, filename, sizeof filename ) );
+    REQUIRE_EQ( std::string( shard_dir ), std::string( "/out/SRR000001.rows_1001-2000" ) );
+    REQUIRE_EQ( std::string( filename ), std::string( "/out/SRR000001.rows_1001-2000/SRR000001.fastq.gz" ) );
+    REQUIRE_RC( shard_make_output_filename( &shard, "SRR000001", "x.fastq",
+                                            shard_dir, sizeof shard_dir, filename, sizeof filename ) );
+    REQUIRE_EQ( std::string( filename ), std::string( "SRR000001.rows_1001-2000/x.fastq" ) );
+}
+
+TEST_CASE ( Shard_Merge ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+
+    char s1[ 4096 ], s2[ 4096 ], s3[ 4096 ];
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "1-30", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "31-60", false ) );
+    REQUIRE_RC( make_shard( dir, s3, sizeof s3, "61-100", true ) );
+
+    /* the order of the parameters does not matter, the rows in the manifests do */
+    VNamelist * shard_dirs;
+    REQUIRE_RC( VNamelistMake( &shard_dirs, 3 ) );
+    REQUIRE_RC( VNamelistAppend( shard_dirs, s3 ) );
+    REQUIRE_RC( VNamelistAppend( shard_dirs, s1 ) );
+    REQUIRE_RC( VNamelistAppend( shard_dirs, s2 ) );
+    REQUIRE_RC( shard_merge( dir, shard_dirs, OUT_DIR, 4096, false, false ) );
+    VNamelistRelease( shard_dirs );
+
+    std::string out( OUT_DIR );
+    REQUIRE_EQ( read_file( dir, out + "/SRR000001_1.fastq" ), std::string( "R1 1-30\nR1 31-60\nR1 61-100\n" ) );
+    REQUIRE_EQ( read_file( dir, out + "/SRR000001_2.fastq" ), std::string( "R2 1-30\nR2 31-60\nR2 61-100\n" ) );
+    REQUIRE_EQ( read_file( dir, out + "/SRR000001.fastq" ), std::string( "U 1-30\nU 61-100\n" ) );
+    REQUIRE( !ft_dir_exists( dir, "%s", s1 ) );
+    REQUIRE( !ft_dir_exists( dir, "%s", s3 ) );
+
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( Shard_Merge_Gap ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+
+    char s1[ 4096 ], s3[ 4096 ];
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "1-30", true ) );
+    REQUIRE_RC( make_shard( dir, s3, sizeof s3, "61-100", true ) );
+
+    VNamelist * shard_dirs;
+    REQUIRE_RC( VNamelistMake( &shard_dirs, 2 ) );
+    REQUIRE_RC( VNamelistAppend( shard_dirs, s1 ) );
+    REQUIRE_RC( VNamelistAppend( shard_dirs, s3 ) );
+    REQUIRE_RC_FAIL( shard_merge( dir, shard_dirs, OUT_DIR, 4096, false, false ) );
+    VNamelistRelease( shard_dirs );
+
+    /* nothing has been consumed */
+    REQUIRE( ft_file_exists( dir, "%s/SRR000001_1.fastq", s1 ) );
+    REQUIRE( ft_file_exists( dir, "%s/SRR000001_1.fastq", s3 ) );
+    REQUIRE( !ft_file_exists( dir, "%s/SRR000001_1.fastq", OUT_DIR ) );
+
+    KDirectoryRemove( dir, true, "%s", s1 );
+    KDirectoryRemove( dir, true, "%s", s3 );
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+    KDirectoryRelease( dir );
+}
+
+static rc_t merge_two( KDirectory * dir, const char * s1, const char * s2 ) {
+    VNamelist * shard_dirs;
+    rc_t rc = VNamelistMake( &shard_dirs, 2 );
+    if ( 0 == rc ) { rc = VNamelistAppend( shard_dirs, s1 ); }
+    if ( 0 == rc ) { rc = VNamelistAppend( shard_dirs, s2 ); }
+    if ( 0 == rc ) { rc = shard_merge( dir, shard_dirs, OUT_DIR, 4096, false, false ); }
+    VNamelistRelease( shard_dirs );
+    return rc;
+}
+
+TEST_CASE ( Shard_Merge_Missing_Shard ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+
+    /* shards 1/3 and 2/3 are contiguous, but the last third of the table is missing */
+    char s1[ 4096 ], s2[ 4096 ];
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "1/3", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "2/3", true ) );
+    REQUIRE_RC_FAIL( merge_two( dir, s1, s2 ) );
+    REQUIRE( ft_file_exists( dir, "%s/SRR000001_1.fastq", s1 ) );
+    REQUIRE( ft_file_exists( dir, "%s/SRR000001_1.fastq", s2 ) );
+    REQUIRE( !ft_file_exists( dir, "%s/SRR000001_1.fastq", OUT_DIR ) );
+    KDirectoryRemove( dir, true, "%s", s1 );
+    KDirectoryRemove( dir, true, "%s", s2 );
+
+    /* the same for a missing first shard */
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "2/3", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "3/3", true ) );
+    REQUIRE_RC_FAIL( merge_two( dir, s1, s2 ) );
+    REQUIRE( !ft_file_exists( dir, "%s/SRR000001_1.fastq", OUT_DIR ) );
+    KDirectoryRemove( dir, true, "%s", s1 );
+    KDirectoryRemove( dir, true, "%s", s2 );
+
+    /* a '--rows' shard does not make the coverage of '--shard' shards optional */
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "1/2", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "51-90", true ) );
+    REQUIRE_RC_FAIL( merge_two( dir, s1, s2 ) );
+    KDirectoryRemove( dir, true, "%s", s1 );
+    KDirectoryRemove( dir, true, "%s", s2 );
+
+    /* all shards present */
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "1/2", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "2/2", true ) );
+    REQUIRE_RC( merge_two( dir, s1, s2 ) );
+    REQUIRE_EQ( read_file( dir, std::string( OUT_DIR ) + "/SRR000001_1.fastq" ),
+                std::string( "R1 1/2\nR1 2/2\n" ) );
+
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( Shard_Merge_Rows_Subrange ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+
+    /* explicitly requested rows may cover only a part of the table */
+    char s1[ 4096 ], s2[ 4096 ];
+    REQUIRE_RC( make_shard( dir, s1, sizeof s1, "11-30", true ) );
+    REQUIRE_RC( make_shard( dir, s2, sizeof s2, "31-50", true ) );
+    REQUIRE_RC( merge_two( dir, s2, s1 ) );
+    REQUIRE_EQ( read_file( dir, std::string( OUT_DIR ) + "/SRR000001_1.fastq" ),
+                std::string( "R1 11-30\nR1 31-50\n" ) );
+
+    KDirectoryRemove( dir, true, "%s", OUT_DIR );
+    KDirectoryRelease( dir );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestShard ( argc, argv );
+}
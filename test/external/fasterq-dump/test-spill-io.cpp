@@ -0,0 +1,193 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the direct spill-I/O of fasterq-dump ( spill_io.c ):
+* what goes through the spill-writer comes back byte-exact through the spill-reader,
+* with any chunking of writes and reads and with the tail of a file not aligned
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/file_tools.c"
+#include "../../../tools/external/fasterq-dump/spill_io.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <vector>
+
+TEST_SUITE ( TestSpillIo );
+
+static const char * SPILL_FILE = "test-spill-io.tmp";
+
+static rc_t make_writer( struct spill_writer_t ** w, KDirectory * dir, const char * fmt, ... ) {
+    va_list args;
+    va_start( args, fmt );
+    rc_t rc = spill_writer_make( w, dir, fmt, args );
+    va_end( args );
+    return rc;
+}
+
+static rc_t make_reader( struct spill_reader_t ** r, KDirectory * dir, const char * fmt, ... ) {
+    va_list args;
+    va_start( args, fmt );
+    rc_t rc = spill_reader_make( r, dir, fmt, args );
+    va_end( args );
+    return rc;
+}
+
+static std::vector< uint8_t > make_data( size_t size, uint32_t seed ) {
+    std::vector< uint8_t > res( size );
+    for ( size_t i = 0; i < size; ++i ) {
+        seed = seed * 1103515245 + 12345;
+        res[ i ] = ( uint8_t )( seed >> 16 );
+    }
+    return res;
+}
+
+/* write in chunks of write_chunk, read back in chunks of read_chunk */
+static bool round_trip( KDirectory * dir, const std::vector< uint8_t > & data,
+                        size_t write_chunk, size_t read_chunk ) {
+    struct spill_writer_t * w;
+    if ( 0 != make_writer( &w, dir, "%s", SPILL_FILE ) ) { return false; }
+    size_t pos = 0;
+    while ( pos < data . size() ) {
+        size_t n = data . size() - pos;
+        if ( n > write_chunk ) { n = write_chunk; }
+        if ( 0 != spill_writer_write( w, &data[ pos ], n ) ) { break; }
+        pos += n;
+    }
+    if ( spill_writer_size( w ) != data . size() ) { spill_writer_release( w ); return false; }
+    if ( 0 != spill_writer_release( w ) ) { return false; }
+
+    struct spill_reader_t * r;
+    if ( 0 != make_reader( &r, dir, "%s", SPILL_FILE ) ) { return false; }
+    bool res = ( spill_reader_size( r ) == data . size() );
+    std::vector< uint8_t > back( data . size() + read_chunk );
+    size_t got = 0;
+    while ( res ) {
+        size_t num_read;
+        if ( 0 != spill_reader_read( r, &back[ got ], read_chunk, &num_read ) ) { res = false; }
+        if ( 0 == num_read ) { break; }
+        got += num_read;
+    }
+    spill_reader_release( r );
+    return res && got == data . size() && 0 == memcmp( &data[ 0 ], &back[ 0 ], got );
+}
+
+TEST_CASE ( SpillIo_Mode ) {
+    REQUIRE_EQ( spill_io_get_mode( NULL ), sio_buffered );
+    REQUIRE_EQ( spill_io_get_mode( "Direct" ), sio_direct );
+    REQUIRE_EQ( spill_io_get_mode( "buffered" ), sio_buffered );
+    REQUIRE_EQ( spill_io_get_mode( "mmap" ), sio_unknown );
+    /* buffered: nothing to set up, the callers use their KFile's */
+    REQUIRE_RC( spill_io_init( sio_buffered, 4096, 0 ) );
+    REQUIRE( !spill_io_direct() );
+}
+
+TEST_CASE ( SpillIo_RoundTrip ) {
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    /* small blocks: many requests in flight, the slots are reused many times */
+    REQUIRE_RC( spill_io_init( sio_direct, 2 * FT_BLOCK_ALIGN, 3 ) );
+    REQUIRE( spill_io_direct() );
+
+    std::vector< uint8_t > data = make_data( 100 * 1000 + 17, 1 );
+    REQUIRE( round_trip( dir, data, 1000, 777 ) );
+    REQUIRE( round_trip( dir, data, 3 * FT_BLOCK_ALIGN + 5, 2 * FT_BLOCK_ALIGN ) );
+    REQUIRE( round_trip( dir, data, data . size(), 1 ) );
+
+    /* exactly one block, and nothing at all */
+    REQUIRE( round_trip( dir, make_data( 2 * FT_BLOCK_ALIGN, 2 ), 100, 100 ) );
+    REQUIRE( round_trip( dir, std::vector< uint8_t >(), 100, 100 ) );
+
+    spill_io_release();
+    REQUIRE( !spill_io_direct() );
+    KDirectoryRemove( dir, true, "%s", SPILL_FILE );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( SpillIo_WriteAfterFinish ) {
+    /* flush_lookup_writer() finishes the file, but more entries may follow */
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    REQUIRE_RC( spill_io_init( sio_direct, FT_BLOCK_ALIGN, 2 ) );
+
+    std::vector< uint8_t > data = make_data( 3 * FT_BLOCK_ALIGN + 100, 3 );
+    struct spill_writer_t * w;
+    REQUIRE_RC( make_writer( &w, dir, "%s", SPILL_FILE ) );
+    REQUIRE_RC( spill_writer_write( w, &data[ 0 ], 1000 ) );
+    REQUIRE_RC( spill_writer_finish( w ) );
+    REQUIRE_RC( spill_writer_write( w, &data[ 1000 ], data . size() - 1000 ) );
+    REQUIRE_RC( spill_writer_release( w ) );
+
+    struct spill_reader_t * r;
+    REQUIRE_RC( make_reader( &r, dir, "%s", SPILL_FILE ) );
+    REQUIRE_EQ( spill_reader_size( r ), ( uint64_t )data . size() );
+    std::vector< uint8_t > back( data . size() );
+    size_t num_read;
+    REQUIRE_RC( spill_reader_read( r, &back[ 0 ], back . size(), &num_read ) );
+    REQUIRE_EQ( num_read, data . size() );
+    REQUIRE( back == data );
+    spill_reader_release( r );
+
+    spill_io_release();
+    KDirectoryRemove( dir, true, "%s", SPILL_FILE );
+    KDirectoryRelease( dir );
+}
+
+TEST_CASE ( SpillIo_ShortRead ) {
+    /* a block that comes back short before the end of the file is an error, not fewer bytes */
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+    REQUIRE_RC( spill_io_init( sio_direct, FT_BLOCK_ALIGN, 2 ) );
+
+    std::vector< uint8_t > data = make_data( 4 * FT_BLOCK_ALIGN, 4 );
+    struct spill_writer_t * w;
+    REQUIRE_RC( make_writer( &w, dir, "%s", SPILL_FILE ) );
+    REQUIRE_RC( spill_writer_write( w, &data[ 0 ], data . size() ) );
+    REQUIRE_RC( spill_writer_release( w ) );
+
+    /* the reader knows the size, the first 2 blocks are in flight, the 3rd one gets cut */
+    struct spill_reader_t * r;
+    REQUIRE_RC( make_reader( &r, dir, "%s", SPILL_FILE ) );
+    REQUIRE_RC( KDirectorySetFileSize( dir, 2 * FT_BLOCK_ALIGN + 100, "%s", SPILL_FILE ) );
+    std::vector< uint8_t > back( data . size() );
+    size_t num_read;
+    REQUIRE_RC_FAIL( spill_reader_read( r, &back[ 0 ], back . size(), &num_read ) );
+    REQUIRE( num_read <= 2 * FT_BLOCK_ALIGN );
+    spill_reader_release( r );
+
+    spill_io_release();
+    KDirectoryRemove( dir, true, "%s", SPILL_FILE );
+    KDirectoryRelease( dir );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestSpillIo ( argc, argv );
+}
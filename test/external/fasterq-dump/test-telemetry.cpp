@@ -0,0 +1,142 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* Unit tests for the telemetry of fasterq-dump ( telemetry.c ):
+* the counters end up in the stage that was running, the report is valid for the stages used
+*/
+
+#include "../../../tools/external/fasterq-dump/helper.c"
+#include "../../../tools/external/fasterq-dump/sbuffer.c"
+#include "../../../tools/external/fasterq-dump/err_msg.c"
+#include "../../../tools/external/fasterq-dump/telemetry.c"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <string>
+
+TEST_SUITE ( TestTelemetry );
+
+static const char * REPORT = "test-telemetry.json";
+
+static std::string read_report( void ) {
+    std::string res;
+    KDirectory * dir;
+    if ( 0 == KDirectoryNativeDir( &dir ) ) {
+        const KFile * f;
+        if ( 0 == KDirectoryOpenFileRead( dir, &f, "%s", REPORT ) ) {
+            char buf[ 4096 ];
+            uint64_t pos = 0;
+            size_t num_read;
+            while ( 0 == KFileRead( f, pos, buf, sizeof buf, &num_read ) && num_read > 0 ) {
+                res . append( buf, num_read );
+                pos += num_read;
+            }
+            KFileRelease( f );
+        }
+        KDirectoryRemove( dir, true, "%s", REPORT );
+        KDirectoryRelease( dir );
+    }
+    return res;
+}
+
+static bool contains( const std::string & s, const char * what ) {
+    return std::string::npos != s . find( what );
+}
+
+TEST_CASE ( Telemetry_Inactive ) {
+    tele_report_args_t args;
+    memset( &args, 0, sizeof args );
+    REQUIRE( !tele_active() );
+    REQUIRE_EQ( tele_clock(), ( uint64_t )0 );
+    tele_stage_begin( ts_join );
+    tele_add_rows( 100 );
+    tele_stage_end( ts_join );
+    REQUIRE_RC( tele_write_report( REPORT, &args ) );
+    REQUIRE( read_report() . empty() );
+}
+
+TEST_CASE ( Telemetry_Stages ) {
+    REQUIRE_RC( tele_start( 0 ) );
+    REQUIRE( tele_active() );
+
+    tele_stage_begin( ts_join );
+    {
+        /* the way a cmn_iter counts its rows */
+        tele_acc_t acc;
+        uint32_t row;
+        memset( &acc, 0, sizeof acc );
+        for ( row = 0; row < 10000; ++row ) {
+            acc . rows++;
+            acc . bytes_read += 3;
+            tele_acc_check( &acc );
+        }
+        tele_acc_flush( &acc );
+        REQUIRE_EQ( acc . rows, ( uint64_t )0 );
+    }
+    tele_add_written( 5000 );
+    tele_stage_end( ts_join );
+
+    tele_stage_begin( ts_concat );
+    tele_add_read( 123 );
+    tele_add_wait_since( tele_clock() );
+    tele_stage_end( ts_concat );
+
+    tele_report_args_t args;
+    memset( &args, 0, sizeof args );
+    args . accession = "SRR\"000001";
+    args . format = "FASTQ split 3";
+    args . num_threads = 6;
+    REQUIRE_RC( tele_write_report( REPORT, &args ) );
+    tele_stop();
+    REQUIRE( !tele_active() );
+
+    std::string report = read_report();
+    REQUIRE( contains( report, "\"accession\" : \"SRR\\\"000001\"" ) );
+    REQUIRE( contains( report, "\"threads\" : 6" ) );
+    REQUIRE( contains( report, "{ \"name\" : \"join\"" ) );
+    REQUIRE( contains( report, "\"rows\" : 10000, " ) );
+    REQUIRE( contains( report, "\"bytes_read\" : 30000, " ) );
+    REQUIRE( contains( report, "\"bytes_written\" : 5000, " ) );
+    REQUIRE( contains( report, "{ \"name\" : \"concat\"" ) );
+    REQUIRE( contains( report, "\"bytes_read\" : 123, " ) );
+    REQUIRE( !contains( report, "\"lookup\"" ) );
+}
+
+TEST_CASE ( Telemetry_Interval ) {
+    /* the thread printing the progress-lines has to stop with the telemetry */
+    REQUIRE_RC( tele_start( 1 ) );
+    tele_stage_begin( ts_lookup );
+    tele_add_rows( 1 );
+    tele_stage_end( ts_lookup );
+    tele_stop();
+    REQUIRE( !tele_active() );
+}
+
+extern "C"
+int main ( int argc, char * argv [] ) {
+    return TestTelemetry ( argc, argv );
+}
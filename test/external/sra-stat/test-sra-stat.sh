@@ -69,6 +69,20 @@ if [ "$res" != "0" ];
 	then echo "quick_bases test FAILED, res=$res output=$output" && exit 1;
 fi
 
+echo the full table scan on several threads produces the same output
+NCBI_SETTINGS=/ ${bin_dir}/${sra_stat} -x --threads 4 db/SRR22714250.lite.1 > actual/SRR22714250
+output=$(diff actual/SRR22714250 expected/SRR22714250-default-SPOT_GROUP)
+res=$?
+if [ "$res" != "0" ];
+	then echo "threads test FAILED, res=$res output=$output" && exit 1;
+fi
+NCBI_SETTINGS=/ NCBI_VDB_QUALITY=R ${bin_dir}/${sra_stat} -x --threads 3 SRR413283 > actual/SRR413283
+output=$(diff actual/SRR413283 expected/SRR413283-with-AssemblyStatistics)
+res=$?
+if [ "$res" != "0" ];
+	then echo "threads test FAILED, res=$res output=$output" && exit 1;
+fi
+
 echo check SOFTWARE node for a table
 NCBI_SETTINGS=/ NCBI_VDB_QUALITY=R ${bin_dir}/${sra_stat} --quick -x --meta SRR053325 > actual/SRR053325
 output=$(diff actual/SRR053325 expected/SRR053325-meta)
@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+# benchmark, not a test: run it by hand
+#
+# compares the columnar export ( -f arrow ) with the csv-output of the same columns:
+#   - time and output-size of vdb-dump for both formats
+#   - if pyarrow is installed: time to load the csv-file and the memory-mapped Arrow-file
+#
+# usage: bench-arrow.sh vdb-dump-binary accession [ columns ] [ rows ]
+#   bench-arrow.sh ../../../bin/vdb-dump SRR000001 READ,QUALITY,READ_LEN 1-100000
+
+vdb_dump_binary=$1
+acc=$2
+columns=${3:-READ,QUALITY,READ_LEN}
+rows=$4
+
+if [ -z "$vdb_dump_binary" ] || [ -z "$acc" ]; then
+	echo "usage: $0 vdb-dump-binary accession [ columns ] [ rows ]"
+	exit 1
+fi
+
+args="$acc -C $columns"
+if [ -n "$rows" ]; then
+	args="$args -R $rows"
+fi
+
+TEMPDIR=$(mktemp -d)
+trap "rm -rf $TEMPDIR" EXIT
+
+TIMEFORMAT="%R"
+
+function bench() {
+	local name=$1
+	local output=$2
+	shift 2
+	local seconds
+	seconds=$( { time "$@" > /dev/null 2>$TEMPDIR/$name.stderr ; } 2>&1 )
+	local res=$?
+	if [ "$res" != "0" ]; then
+		echo "$name FAILED, res=$res $(cat $TEMPDIR/$name.stderr)" && exit 1
+	fi
+	printf "%-12s %10s s %14s bytes\n" "$name" "$seconds" "$(wc -c < $output)"
+}
+
+echo "vdb-dump $args"
+bench "csv" $TEMPDIR/out.csv ${vdb_dump_binary} $args -f csv --output-file $TEMPDIR/out.csv
+bench "arrow" $TEMPDIR/out.arrow ${vdb_dump_binary} $args -f arrow --output-file $TEMPDIR/out.arrow
+
+if python3 -c "import pyarrow" 2>/dev/null; then
+	python3 - $TEMPDIR/out.csv $TEMPDIR/out.arrow <<'EOF'
+import sys, time
+import pyarrow.csv as csv, pyarrow.feather as feather
+
+start = time.perf_counter()
+t = csv.read_csv( sys.argv[ 1 ], read_options = csv.ReadOptions( autogenerate_column_names = True ) )
+print( "%-12s %10.3f s %14d rows" % ( "load csv", time.perf_counter() - start, t.num_rows ) )
+
+start = time.perf_counter()
+t = feather.read_table( sys.argv[ 2 ], memory_map = True )
+print( "%-12s %10.3f s %14d rows" % ( "load arrow", time.perf_counter() - start, t.num_rows ) )
+EOF
+fi
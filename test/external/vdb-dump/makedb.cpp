@@ -29,6 +29,7 @@
 */
 
 #include <fstream>
+#include <string>
 
 #include <vdb/manager.h>
 #include <vdb/schema.h>
@@ -281,6 +282,55 @@ ViewDatabase()
     return 0;
 }
 
+rc_t
+ManyRows()
+{   // more rows than fit into the blocks of all threads of 'vdb-dump --threads', a few times over
+    const string ScratchDir         = "./data/";
+    const string DefaultSchemaText  =
+        "version 2;\n"
+        "table many_rows #1.0.0 { column ascii NAME; column U32 VALUE; };\n"
+    ;
+    const uint32_t RowCount = 20000;
+
+    VDBManager* mgr;
+    CHECK_RC ( VDBManagerMakeUpdate ( & mgr, NULL ) );
+    VSchema* schema;
+    CHECK_RC ( VDBManagerMakeSchema ( mgr, & schema ) );
+    CHECK_RC ( VSchemaParseText ( schema, NULL, DefaultSchemaText.c_str(), DefaultSchemaText.size() ) );
+
+    VTable *tab;
+    CHECK_RC ( VDBManagerCreateTable ( mgr,
+                                       & tab,
+                                       schema,
+                                       "many_rows",
+                                       kcmInit + kcmMD5,
+                                       "%s",
+                                       ( ScratchDir + "ManyRows" ) . c_str() ) );
+    VCursor *curs;
+    CHECK_RC ( VTableCreateCursorWrite ( tab, & curs, kcmInsert ) ) ;
+    uint32_t name_idx, value_idx;
+    CHECK_RC ( VCursorAddColumn ( curs, & name_idx, "NAME" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & value_idx, "VALUE" ) );
+    CHECK_RC ( VCursorOpen ( curs ) );
+    for ( uint32_t row = 1; row <= RowCount; ++row )
+    {   // rows of different lengths, some of them empty
+        const string name = ( row % 17 == 0 ) ? string() : "row-" + to_string( row ) + string( row % 23, 'x' );
+        const uint32_t value = row * 2654435761u;
+        CHECK_RC ( VCursorOpenRow ( curs ) );
+        CHECK_RC ( VCursorWrite ( curs, name_idx, 8, name.c_str(), 0, name.size() ) );
+        CHECK_RC ( VCursorWrite ( curs, value_idx, 32, & value, 0, 1 ) );
+        CHECK_RC ( VCursorCommitRow ( curs ) );
+        CHECK_RC ( VCursorCloseRow ( curs ) );
+    }
+    CHECK_RC ( VCursorCommit ( curs ) );
+    CHECK_RC ( VCursorRelease ( curs ) );
+    CHECK_RC ( VTableRelease ( tab ) );
+
+    CHECK_RC ( VSchemaRelease ( schema ) );
+    CHECK_RC ( VDBManagerRelease ( mgr ) );
+    return 0;
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -296,6 +346,10 @@ int main ( int argc, char *argv [] )
     {
         rc = ViewDatabase();
     }
+    if ( rc == 0 )
+    {
+        rc = ManyRows();
+    }
     return (int)rc;
 }
 
@@ -53,6 +53,64 @@ function run_test_neg() {
 	echo run_test $test_id done
 }
 
+function run_test_threads() {
+	local test_id=$1
+	local test_args=$2
+	local threads=${3:-4}
+
+	local output=actual/$test_id.stdout
+	local output_mt=actual/$test_id.threads.stdout
+
+	${bin_dir}/${vdb_dump_binary} $test_args > $output 2>actual/$test_id.stderr
+	local res=$?
+	if [ "$res" != "0" ];
+		then echo "${vdb_dump_binary} $test_args ($test_name $test_id) FAILED, res=$res output=$output" && exit 1;
+	fi
+
+	${bin_dir}/${vdb_dump_binary} $test_args --threads $threads > $output_mt 2>actual/$test_id.threads.stderr
+	res=$?
+	if [ "$res" != "0" ];
+		then echo "${vdb_dump_binary} $test_args --threads $threads ($test_name $test_id) FAILED, res=$res output=$output_mt" && exit 1;
+	fi
+
+	diff $output $output_mt >actual/$test_id.diff
+	res=$?
+	if [ "$res" != "0" ];
+		then echo "${vdb_dump_binary} $test_args --threads $threads ($test_id) FAILED, res=$res diff=$(cat actual/$test_id.diff)" && exit 1;
+	fi
+	echo run_test_threads $test_id done
+}
+
+function run_test_arrow() {
+	local test_id=$1
+	local test_args=$2
+
+	local output=actual/$test_id.arrow
+
+	${bin_dir}/${vdb_dump_binary} $test_args -f arrow --output-file $output >actual/$test_id.stdout 2>actual/$test_id.stderr
+	local res=$?
+	if [ "$res" != "0" ];
+		then echo "${vdb_dump_binary} $test_args -f arrow ($test_id) FAILED, res=$res" && exit 1;
+	fi
+
+	if [ "$(head -c 6 $output)" != "ARROW1" ] || [ "$(tail -c 6 $output)" != "ARROW1" ];
+		then echo "${vdb_dump_binary} $test_args -f arrow ($test_id) FAILED, $output is not an Arrow file" && exit 1;
+	fi
+
+	# if pyarrow is installed: the rows read from the Arrow file are the same as the tab-separated output
+	if python3 -c "import pyarrow" 2>/dev/null; then
+		${bin_dir}/${vdb_dump_binary} $test_args -f tab > actual/$test_id.tab.stdout 2>actual/$test_id.tab.stderr
+		python3 -c "import sys, pyarrow.feather as f
+for r in f.read_table( sys.argv[ 1 ], memory_map = True ).to_pylist() : print( *r.values(), sep = '\t' )" $output > actual/$test_id.arrow.stdout
+		diff actual/$test_id.tab.stdout actual/$test_id.arrow.stdout >actual/$test_id.diff
+		res=$?
+		if [ "$res" != "0" ];
+			then echo "${vdb_dump_binary} $test_args -f arrow ($test_id) FAILED, res=$res diff=$(cat actual/$test_id.diff)" && exit 1;
+		fi
+	fi
+	echo run_test_arrow $test_id done
+}
+
 #TODO: fail if multiple tables and/or views are requested
 
 # output format
@@ -114,6 +172,29 @@ run_test "6.1" "data/ViewDatabase -T VIEW3"
 # 7.0 symbolic names for various platforms
 run_test "7.0" "input/platforms -C PLATFORM"
 
+# 8.x the output with worker-threads ( --threads ) is the same as without
+run_test_threads "8.0" "input/platforms"
+run_test_threads "8.1" "input/platforms -f csv"
+run_test_threads "8.2" "input/platforms -f tab -I"
+run_test_threads "8.3" "input/platforms -f xml"
+run_test_threads "8.4" "input/platforms -f json"
+run_test_threads "8.5" "input/platforms -f piped"
+run_test_threads "8.6" "input/platforms -f sra-dump"
+run_test_threads "8.7" "input/platforms -U"
+run_test_threads "8.8" "data/ViewDatabase -T VIEW1"
+run_test_threads "8.9" "SRR056386 -R 1-20 -f fastq"
+run_test_threads "8.10" "SRR056386 -R 1-20 -f fasta"
+# 20000 rows: many blocks of 1024 rows per thread, the last one partial
+run_test_threads "8.11" "data/ManyRows"
+run_test_threads "8.12" "data/ManyRows -f csv" 3
+run_test_threads "8.13" "data/ManyRows -f json" 2
+run_test_threads "8.14" "data/ManyRows -R 1-3000,5000-19999 -f tab"
+run_test_threads "8.15" "data/ManyRows -R 1023-1025,8191-8193" 16
+
+# 9.x columnar export into an Arrow IPC file ( -f arrow )
+run_test_arrow "9.0" "SRR056386 -R 1-20 -C READ -I"
+run_test_arrow "9.1" "SRR056386 -R 1-20 -C NAME,READ"
+
 rm -rf actual
 # keep the test database for the other tests that might follow (e.g. Test_Vdb_dump_view-alias - see CMakeLists.txt)
 #rm -rf data
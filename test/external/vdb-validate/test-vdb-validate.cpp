@@ -36,6 +36,8 @@ extern "C" {
 
 #include <klib/out.h>
 
+#include <vector>
+
 using namespace std;
 using namespace ncbi::NK;
 
@@ -76,6 +78,190 @@ TEST_CASE(is_sorted_unsorted)
 	REQUIRE(!is_sorted(3, unsorted));
 }
 
+static bool radix_sort_matches_ksort(size_t N, bool second_ordered, unsigned threads)
+{
+	vector<id_pair_t> radix(N);
+	vector<id_pair_t> ksort(N);
+	vector<id_pair_t> tmp(N);
+	uint64_t x = 88172645463325252ull;
+
+	for (size_t i = 0; i < N; ++i) {
+		x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+		radix[i].first = (int64_t)(x % 100000) - 50000;
+		radix[i].second = second_ordered ? (int64_t)i : (int64_t)(x >> 40);
+	}
+	ksort = radix;
+	radix_sort_key_pairs(N, radix.data(), tmp.data(), threads);
+	sort_key_pairs(N, ksort.data());
+	for (size_t i = 0; i < N; ++i) {
+		if (radix[i].first != ksort[i].first || radix[i].second != ksort[i].second)
+			return false;
+	}
+	return true;
+}
+
+TEST_CASE(radix_sort_small)
+{
+	REQUIRE(radix_sort_matches_ksort(0, true, 1));
+	REQUIRE(radix_sort_matches_ksort(1, true, 1));
+	REQUIRE(radix_sort_matches_ksort(1000, true, 1));
+	REQUIRE(radix_sort_matches_ksort(1000, false, 1));
+}
+
+TEST_CASE(radix_sort_threads)
+{
+	REQUIRE(radix_sort_matches_ksort(1000000, true, 4));
+	REQUIRE(radix_sort_matches_ksort(1000000, false, 4));
+	REQUIRE(radix_sort_matches_ksort(1000001, false, 3));
+}
+
+/* table a: REF_ID of every row points to a row of table b,
+ * table b: PRIMARY_ALIGNMENT_IDS lists the rows of table a pointing to it;
+ * the REF_ID of row bad ( if > 0 ) points past table b */
+static rc_t make_ric_tables(VDBManager *mgr, char const *path, int64_t rows, int64_t bad)
+{
+	static char const schema_text[] =
+		"version 1;\n"
+		"table ric_a #1 { column I64 REF_ID; };\n"
+		"table ric_b #1 { column I64 PRIMARY_ALIGNMENT_IDS; };\n";
+	int64_t const b_rows = 3;
+	VSchema *schema = NULL;
+	VTable *tbl = NULL;
+	VCursor *curs = NULL;
+	uint32_t idx = 0;
+	rc_t rc = VDBManagerMakeSchema(mgr, &schema);
+
+	if (rc == 0)
+		rc = VSchemaParseText(schema, NULL, schema_text, sizeof(schema_text) - 1);
+	if (rc == 0)
+		rc = VDBManagerCreateTable(mgr, &tbl, schema, "ric_a", kcmInit + kcmMD5, "%s/a", path);
+	if (rc == 0)
+		rc = VTableCreateCursorWrite(tbl, &curs, kcmInsert);
+	if (rc == 0)
+		rc = VCursorAddColumn(curs, &idx, "REF_ID");
+	if (rc == 0)
+		rc = VCursorOpen(curs);
+	for (int64_t row = 1; rc == 0 && row <= rows; ++row) {
+		int64_t const fkey = row == bad ? b_rows + 1 : 1 + row % b_rows;
+
+		rc = VCursorOpenRow(curs);
+		if (rc == 0)
+			rc = VCursorWrite(curs, idx, 64, &fkey, 0, 1);
+		if (rc == 0)
+			rc = VCursorCommitRow(curs);
+		if (rc == 0)
+			rc = VCursorCloseRow(curs);
+	}
+	if (rc == 0)
+		rc = VCursorCommit(curs);
+	VCursorRelease(curs);
+	VTableRelease(tbl);
+	curs = NULL;
+	tbl = NULL;
+
+	if (rc == 0)
+		rc = VDBManagerCreateTable(mgr, &tbl, schema, "ric_b", kcmInit + kcmMD5, "%s/b", path);
+	if (rc == 0)
+		rc = VTableCreateCursorWrite(tbl, &curs, kcmInsert);
+	if (rc == 0)
+		rc = VCursorAddColumn(curs, &idx, "PRIMARY_ALIGNMENT_IDS");
+	if (rc == 0)
+		rc = VCursorOpen(curs);
+	for (int64_t fkey = 1; rc == 0 && fkey <= b_rows; ++fkey) {
+		vector<int64_t> ids;
+		int64_t const none = 0;	/* a row of table b may be empty */
+
+		for (int64_t row = 1; row <= rows; ++row) {
+			if (row != bad && 1 + row % b_rows == fkey)
+				ids.push_back(row);
+		}
+		rc = VCursorOpenRow(curs);
+		if (rc == 0)
+			rc = VCursorWrite(curs, idx, 64, ids.empty() ? &none : ids.data(), 0, (uint64_t)ids.size());
+		if (rc == 0)
+			rc = VCursorCommitRow(curs);
+		if (rc == 0)
+			rc = VCursorCloseRow(curs);
+	}
+	if (rc == 0)
+		rc = VCursorCommit(curs);
+	VCursorRelease(curs);
+	VTableRelease(tbl);
+	VSchemaRelease(schema);
+	return rc;
+}
+
+static rc_t check_ric_tables(VDBManager const *mgr, char const *path, uint64_t rows, unsigned threads)
+{
+	VTable const *atbl = NULL;
+	VTable const *btbl = NULL;
+	VCursor const *acurs = NULL;
+	VCursor const *bcurs = NULL;
+	ColumnInfo aci;
+	ColumnInfo bci;
+	rc_t rc;
+
+	memset(&aci, 0, sizeof(aci));
+	memset(&bci, 0, sizeof(bci));
+	aci.name = "REF_ID";
+	bci.name = "PRIMARY_ALIGNMENT_IDS";
+	rc = VDBManagerOpenTableRead(mgr, &atbl, NULL, "%s/a", path);
+	if (rc == 0)
+		rc = VDBManagerOpenTableRead(mgr, &btbl, NULL, "%s/b", path);
+	if (rc == 0)
+		rc = ric_open_cursor(atbl, &aci, &acurs);
+	if (rc == 0)
+		rc = ric_open_cursor(btbl, &bci, &bcurs);
+	if (rc == 0) {
+		size_t const chunk = work_chunk(rows, threads);
+		vector<id_pair_t> pair(chunk);
+
+		if (threads > 1)
+			rc = ric_align_threaded(threads, 1, rows, chunk, pair.data(),
+			                        atbl, acurs, &aci, btbl, bcurs, &bci);
+		else {
+			void *scratch = NULL;
+
+			rc = ric_align_generic(1, rows, chunk, pair.data(), &scratch,
+			                       acurs, &aci, bcurs, &bci);
+			free(scratch);
+		}
+	}
+	VCursorRelease(acurs);
+	VCursorRelease(bcurs);
+	VTableRelease(atbl);
+	VTableRelease(btbl);
+	return rc;
+}
+
+TEST_CASE(ric_threads_small_ranges)
+{
+	/* fewer rows than 2 * threads: ranges of a single row, each one has to be checked */
+	char const *const path = "ric_small.tmp";
+	unsigned const threads[] = { 1, 2, 4, 8 };
+	VDBManager *mgr = NULL;
+	KDirectory *dir = NULL;
+
+	REQUIRE_RC(KDirectoryNativeDir(&dir));
+	REQUIRE_RC(VDBManagerMakeUpdate(&mgr, NULL));
+	for (int64_t rows = 1; rows <= 9; rows += 2) {
+		for (int64_t bad = 0; bad <= rows; ++bad) {
+			REQUIRE_RC(make_ric_tables(mgr, path, rows, bad));
+			for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+				rc_t const rc = check_ric_tables(mgr, path, (uint64_t)rows, threads[i]);
+
+				if (bad == 0)
+					REQUIRE_RC(rc);
+				else
+					REQUIRE_EQ(GetRCState(rc), (enum RCState)rcInconsistent);
+			}
+			REQUIRE_RC(KDirectoryRemove(dir, true, "%s", path));
+		}
+	}
+	VDBManagerRelease(mgr);
+	KDirectoryRelease(dir);
+}
+
 //////////////////////////////////////////// Main
 #include <kfg/config.h>
 
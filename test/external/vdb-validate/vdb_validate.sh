@@ -116,6 +116,25 @@ if [ "$res" != "0" ];
         && exit 1;
 fi
 
+# the referential integrity checks on several threads report the same
+output=$(./runtestcase.sh \
+	    "${bin_dir}/${vdb_validate} db/sdc_len_mismatch.csra --threads 4" \
+	                                no_sdc_checks 0)
+res=$?
+if [ "$res" != "0" ];
+	then echo "${vdb_validate} threads FAILED, res=$res output=$output" \
+      && exit 1;
+fi
+
+output=$(./runtestcase.sh \
+	    "${bin_dir}/${vdb_validate} db/sdc_pa_longer.csra --sdc:rows 100% \
+	          --threads 3" sdc_pa_longer_1 3)
+res=$?
+if [ "$res" != "0" ];
+	then echo "${vdb_validate} sdc threads FAILED, res=$res output=$output"\
+      && exit 1;
+fi
+
 output=$(./runtestcase.sh \
         "${bin_dir}/${vdb_validate} db/blob-row-gap.kar" ROW_GAP 0)
 res=$?
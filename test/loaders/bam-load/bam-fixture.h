@@ -0,0 +1,252 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_bam_fixture_
+#define _h_bam_fixture_
+
+/* The synthetic BAM files of the bam-load tests: a BGZF writer, the records
+ * written into it, and reading the records back into a digest. A test includes
+ * this header once and defines main ( the functions are static ).
+ */
+
+#include <klib/rc.h>
+#include <kfs/file.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <zlib.h>
+
+#include "bam.h"
+
+#define MEMBER_SIZE 65280u
+
+typedef struct BGZFWriter {
+    FILE *f;
+    uint64_t coffset;       /* compressed bytes written */
+    unsigned used;
+    uint8_t data[MEMBER_SIZE];
+    uint8_t member[MEMBER_SIZE + 1024];
+} BGZFWriter;
+
+static void put16(uint8_t *dst, unsigned value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *dst, uint32_t value)
+{
+    put16(dst, value & 0xFFFF);
+    put16(dst + 2, value >> 16);
+}
+
+static void put64(uint8_t *dst, uint64_t value)
+{
+    put32(dst, (uint32_t)value);
+    put32(dst + 4, (uint32_t)(value >> 32));
+}
+
+static int WriteMember(BGZFWriter *self)
+{
+    static uint8_t const gzip_header[] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0 };
+    z_stream zs;
+    unsigned csize;
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    zs.next_in = self->data;
+    zs.avail_in = self->used;
+    zs.next_out = self->member + 18;
+    zs.avail_out = sizeof(self->member) - 26;
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        return -1;
+    }
+    csize = (unsigned)zs.total_out;
+    deflateEnd(&zs);
+
+    memmove(self->member, gzip_header, sizeof(gzip_header));
+    put16(self->member + 16, 18 + csize + 8 - 1);   /* BSIZE */
+    put32(self->member + 18 + csize, crc32(crc32(0L, Z_NULL, 0), self->data, self->used));
+    put32(self->member + 22 + csize, self->used);
+    self->used = 0;
+    self->coffset += 18 + csize + 8;
+    return fwrite(self->member, 1, 18 + csize + 8, self->f) == 18 + csize + 8 ? 0 : -1;
+}
+
+static int Write(BGZFWriter *self, void const *src, unsigned len)
+{
+    uint8_t const *bytes = src;
+
+    while (len > 0) {
+        unsigned n = MEMBER_SIZE - self->used;
+
+        if (n > len)
+            n = len;
+        memmove(self->data + self->used, bytes, n);
+        self->used += n;
+        bytes += n;
+        len -= n;
+        if (self->used == MEMBER_SIZE && WriteMember(self) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* the virtual offset of the next byte written */
+static uint64_t Tell(BGZFWriter const *self)
+{
+    return (self->coffset << 16) | self->used;
+}
+
+/* the magic, the SAM header text and the references chr1 .. chr<refs> */
+static int WriteHeader(BGZFWriter *self, char const text[], unsigned refs)
+{
+    uint8_t buf[64];
+    unsigned const tlen = (unsigned)strlen(text);
+    unsigned ref;
+    int res = Write(self, "BAM\1", 4);
+
+    put32(buf, tlen);
+    if (res == 0) res = Write(self, buf, 4);
+    if (res == 0) res = Write(self, text, tlen);
+    put32(buf, refs);               /* n_ref */
+    if (res == 0) res = Write(self, buf, 4);
+    for (ref = 0; ref < refs && res == 0; ++ref) {
+        unsigned const nlen = (unsigned)sprintf((char *)buf + 4, "chr%u", ref + 1) + 1;
+
+        put32(buf, nlen);
+        put32(buf + 4 + nlen, 250000000);
+        res = Write(self, buf, 4 + nlen + 4);
+    }
+    return res;
+}
+
+/* a BAM record with a random sequence of 100 - 250 bases on reference ref */
+static unsigned MakeRecord(uint8_t rec[], unsigned ref, unsigned n)
+{
+    char name[32];
+    unsigned const nlen = (unsigned)sprintf(name, "read.%u", n) + 1;
+    unsigned const slen = 100 + rand() % 151;
+    unsigned i;
+    unsigned len = 36;
+
+    put32(rec + 4, ref);            /* refID */
+    put32(rec + 8, n / 4);          /* pos */
+    rec[12] = (uint8_t)nlen;
+    rec[13] = 60;                   /* mapq */
+    put16(rec + 14, 4680);          /* bin */
+    put16(rec + 16, 1);             /* n_cigar_op */
+    put16(rec + 18, 0);             /* flag */
+    put32(rec + 20, slen);
+    put32(rec + 24, (uint32_t)-1);  /* next refID */
+    put32(rec + 28, (uint32_t)-1);  /* next pos */
+    put32(rec + 32, 0);             /* tlen */
+    memmove(rec + len, name, nlen);
+    len += nlen;
+    put32(rec + len, slen << 4);    /* <slen>M */
+    len += 4;
+    for (i = 0; i < slen; i += 2) {
+        unsigned const hi = 1 << (rand() % 4);
+        unsigned const lo = 1 << (rand() % 4);
+        rec[len++] = (uint8_t)((hi << 4) | lo);
+    }
+    for (i = 0; i < slen; ++i)
+        rec[len++] = (uint8_t)(2 + rand() % 39);
+    memmove(rec + len, "RGZgrp1", 8);
+    len += 8;
+
+    put32(rec, len - 4);            /* block_size */
+    return len;
+}
+
+static double Now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* reads the records to the end of the file into a digest of name, reference,
+ * position and sequence; detach copies each record out of the file first, as
+ * the loader does */
+static rc_t ReadRecords(BAM_File const *file, bool detach, uint64_t *count, uint32_t *digest)
+{
+    char seq[1024];
+    rc_t rc = 0;
+
+    *count = 0;
+    *digest = crc32(0L, Z_NULL, 0);
+    while (rc == 0) {
+        BAM_Alignment const *rec = NULL;
+        char const *name = NULL;
+        int32_t refSeqId = -1;
+        int64_t pos = 0;
+        uint32_t len = 0;
+
+        rc = BAM_FileRead2(file, &rec);
+        if (rc != 0) {
+            if (GetRCObject(rc) == (int)rcRow && GetRCState(rc) == rcNotFound)
+                rc = 0;
+            break;
+        }
+        if (detach)
+            rec = BAM_AlignmentDetach(rec);
+        BAM_AlignmentGetReadName(rec, &name);
+        BAM_AlignmentGetRefSeqId(rec, &refSeqId);
+        BAM_AlignmentGetPosition(rec, &pos);
+        BAM_AlignmentGetReadLength(rec, &len);
+        if (len < sizeof(seq))
+            BAM_AlignmentGetSequence(rec, seq);
+        else
+            len = 0;
+        *digest = crc32(*digest, (Bytef const *)name, (uInt)strlen(name));
+        *digest = crc32(*digest, (Bytef const *)&refSeqId, sizeof(refSeqId));
+        *digest = crc32(*digest, (Bytef const *)&pos, sizeof(pos));
+        *digest = crc32(*digest, (Bytef const *)seq, len);
+        ++*count;
+        BAM_AlignmentRelease(rec);
+    }
+    return rc;
+}
+
+/* 0 if both reads of path succeeded and produced the same records */
+static int CheckReads(char const *path, rc_t rc, unsigned records, uint64_t const count[2], uint32_t const digest[2])
+{
+    if (rc != 0)
+        fprintf(stderr, "failure: reading %s: rc = %u\n", path, (unsigned)rc);
+    else if (count[0] != records || count[1] != count[0] || digest[1] != digest[0])
+        fprintf(stderr, "failure: %lu/%lu records, digest %08x/%08x\n",
+                (unsigned long)count[0], (unsigned long)count[1], digest[0], digest[1]);
+    else
+        return 0;
+    return -1;
+}
+
+#endif /* _h_bam_fixture_ */
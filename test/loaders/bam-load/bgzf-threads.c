@@ -0,0 +1,116 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/* Reads a synthetic BAM file with the BGZF members inflated on the reading
+ * thread and on a pool of threads ( BAM_FileSetInflateThreads ), checks that
+ * both produce the same records and prints the time each one took.
+ *
+ * usage: Test_BamLoader_bgzf_threads [records [threads]]
+ *        ( default: 200000 records, 4 threads )
+ */
+
+#include "bam-fixture.h"
+
+/* the variant built with libdeflate runs next to the one with zlib */
+#ifdef HAVE_LIBDEFLATE
+#define BAM_PATH "bgzf-threads-libdeflate.bam"
+#define INFLATE "libdeflate"
+#else
+#define BAM_PATH "bgzf-threads.bam"
+#define INFLATE "zlib"
+#endif
+
+static char const header[] =
+    "@HD\tVN:1.6\tSO:coordinate\n"
+    "@SQ\tSN:chr1\tLN:250000000\n"
+    "@RG\tID:grp1\tPL:ILLUMINA\n";
+
+static int MakeBAM(unsigned records)
+{
+    BGZFWriter *const w = calloc(1, sizeof(*w));
+    uint8_t rec[1024];
+    unsigned i;
+    int res = -1;
+
+    if (w == NULL)
+        return -1;
+    w->f = fopen(BAM_PATH, "wb");
+    if (w->f != NULL) {
+        res = WriteHeader(w, header, 1);
+        srand(1);
+        for (i = 0; i < records && res == 0; ++i)
+            res = Write(w, rec, MakeRecord(rec, 0, i));
+        if (res == 0 && w->used > 0)
+            res = WriteMember(w);
+        if (res == 0)
+            res = WriteMember(w);       /* the empty EOF marker */
+        if (fclose(w->f) != 0)
+            res = -1;
+    }
+    free(w);
+    return res;
+}
+
+static rc_t ReadBAM(unsigned threads, uint64_t *count, uint32_t *digest, double *seconds)
+{
+    BAM_File const *bam = NULL;
+    double const start = Now();
+    rc_t rc = BAM_FileMake(&bam, NULL, NULL, "%s", BAM_PATH);
+
+    if (rc == 0)
+        rc = BAM_FileSetInflateThreads(bam, threads);
+    if (rc == 0)
+        rc = ReadRecords(bam, false, count, digest);
+    BAM_FileRelease(bam);
+    *seconds = Now() - start;
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned const records = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 200000;
+    unsigned const threads = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 4;
+    uint64_t count[2];
+    uint32_t digest[2];
+    double seconds[2];
+    rc_t rc;
+    int res = 1;
+
+    if (MakeBAM(records) != 0) {
+        fprintf(stderr, "failure: can not write %s\n", BAM_PATH);
+        return 1;
+    }
+    rc = ReadBAM(0, &count[0], &digest[0], &seconds[0]);
+    if (rc == 0)
+        rc = ReadBAM(threads, &count[1], &digest[1], &seconds[1]);
+    if (CheckReads(BAM_PATH, rc, records, count, digest) == 0) {
+        printf("%u records: %.3f sec serial, %.3f sec with %u inflate threads ( %s )\n",
+               records, seconds[0], seconds[1], threads, INFLATE);
+        res = 0;
+    }
+    remove(BAM_PATH);
+    return res;
+}
@@ -0,0 +1,121 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+
+/* Puts spot names into the blocked bloom filter of bam-load ( the key filter and the
+ * gates of the spilled batches ) and checks that every name put in is found again,
+ * also after the filter has grown by several stages, and that the share of names
+ * found that were never put in stays near the rate the filter estimates for itself.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "hashing.hpp"
+
+static unsigned failures = 0;
+
+static void check(bool const ok, char const *what, size_t i)
+{
+    if (!ok && ++failures < 10)
+        fprintf(stderr, "failure: %s, name %zu\n", what, i);
+}
+
+static string spot_name(size_t const i, char const *prefix)
+{
+    return string(prefix) + ".SRR" + to_string(1000000 + i) + "/" + to_string(i % 2 + 1);
+}
+
+/* names put in through seen_before() are found by seen_before() and contains_hash() */
+static void no_false_negatives(size_t const count, size_t const capacity)
+{
+    blocked_bloom_filter filter(capacity);
+
+    for (size_t i = 0; i < count; ++i) {
+        string const name = spot_name(i, "in");
+        filter.seen_before(name.data(), name.size());
+    }
+    check(filter.names() <= count, "more names than put in", count);
+    for (size_t i = 0; i < count; ++i) {
+        string const name = spot_name(i, "in");
+        check(filter.contains_hash(hashing::fnv1a(name.data(), name.size())), "contains_hash: not found", i);
+        check(filter.seen_before(name.data(), name.size()), "seen_before: not found", i);
+        check(filter.get_name_hash() == hashing::fnv1a(name.data(), name.size()), "name hash", i);
+    }
+}
+
+/* names put in by their hash, the rate of the names found that were never put in */
+static void bounded_false_positives(size_t const count, size_t const capacity, double const bound)
+{
+    blocked_bloom_filter filter(capacity);
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        string const name = spot_name(i, "in");
+        filter.insert_hash(hashing::fnv1a(name.data(), name.size()));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        string const name = spot_name(i, "in");
+        check(filter.contains_hash(hashing::fnv1a(name.data(), name.size())), "insert_hash: not found", i);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        string const name = spot_name(i, "out");
+        if (filter.contains_hash(hashing::fnv1a(name.data(), name.size())))
+            ++found;
+    }
+    double const rate = (double)found / count;
+    double const estimated = filter.estimated_fpr();
+
+    check(rate < bound, "false positive rate above the bound", found);
+    check(rate < 2 * estimated + 0.0005, "false positive rate far above the estimate", found);
+    printf("%zu names in %zu stages ( capacity %zu ): %.4f%% false positives, %.4f%% estimated, %zu bytes\n",
+           count, filter.stages(), capacity, 100 * rate, 100 * estimated, filter.memory_used());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t const count = argc > 1 ? strtoul(argv[1], NULL, 0) : 500000;
+
+    no_false_negatives(count, blocked_bloom_filter::MIN_CAPACITY);
+    no_false_negatives(count, 1000);        /* 10 stages */
+    /* 16 bits per name: about 0.1% for a full stage, every stage adds its own */
+    bounded_false_positives(count, count, 0.005);
+    bounded_false_positives(count, 1000, 0.02);
+    {
+        /* reserve() adds a stage big enough for the names to come */
+        blocked_bloom_filter filter(1000);
+        filter.reserve(count);
+        check(filter.capacity() >= count, "reserve", filter.capacity());
+        check(filter.stages() == 2, "reserve: stages", filter.stages());
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%u failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
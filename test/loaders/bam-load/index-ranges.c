@@ -0,0 +1,209 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/* Writes a synthetic coordinate-sorted BAM file with a BAI index, reads it
+ * sequentially and in ranges on a pool of threads ( BAM_FileSetIndexedThreads ),
+ * checks that both produce the same records in the same order and prints the
+ * time each one took. Then checks that an index, which does not match the
+ * file, makes the reading fail instead of producing other records.
+ *
+ * usage: Test_BamLoader_index_ranges [records [threads]]
+ *        ( default: 200000 records, 4 threads )
+ */
+
+#include "bam-fixture.h"
+
+#define BAM_PATH "index-ranges.bam"
+#define BAI_PATH "index-ranges.bam.bai"
+#define REFS 4u
+#define RECORDS_PER_CHUNK 1000u
+#define RECORDS_PER_WINDOW 250u
+
+static char const header[] =
+    "@HD\tVN:1.6\tSO:coordinate\n"
+    "@SQ\tSN:chr1\tLN:250000000\n"
+    "@SQ\tSN:chr2\tLN:250000000\n"
+    "@SQ\tSN:chr3\tLN:250000000\n"
+    "@SQ\tSN:chr4\tLN:250000000\n"
+    "@RG\tID:grp1\tPL:ILLUMINA\n";
+
+/* a BAI index with one bin per reference, a chunk per RECORDS_PER_CHUNK records,
+ * the pseudo-bin and a linear index entry per RECORDS_PER_WINDOW records;
+ * every offset is moved by shift bytes ( 0 for a matching index ) */
+static int WriteBAI(uint64_t const offset[], unsigned const first[], unsigned records, uint64_t end, unsigned shift)
+{
+    FILE *const f = fopen(BAI_PATH, "wb");
+    uint8_t buf[32];
+    unsigned ref;
+    int res = 0;
+
+    if (f == NULL)
+        return -1;
+    put32(buf, REFS);
+    if (fwrite("BAI\1", 1, 4, f) != 4 || fwrite(buf, 1, 4, f) != 4)
+        res = -1;
+    for (ref = 0; ref < REFS && res == 0; ++ref) {
+        unsigned const beg = first[ref];
+        unsigned const count = first[ref + 1] - beg;
+        unsigned const chunks = (count + RECORDS_PER_CHUNK - 1) / RECORDS_PER_CHUNK;
+        unsigned const windows = (count + RECORDS_PER_WINDOW - 1) / RECORDS_PER_WINDOW;
+        uint64_t const ref_end = first[ref + 1] < records ? offset[first[ref + 1]] : end;
+        unsigned i;
+
+        put32(buf, 2);                  /* n_bin */
+        put32(buf + 4, 4681);           /* bin */
+        put32(buf + 8, chunks);
+        res = fwrite(buf, 1, 12, f) == 12 ? 0 : -1;
+        for (i = 0; i < chunks && res == 0; ++i) {
+            unsigned const next = beg + (i + 1) * RECORDS_PER_CHUNK;
+
+            put64(buf, offset[beg + i * RECORDS_PER_CHUNK] + shift);
+            put64(buf + 8, next < first[ref + 1] ? offset[next] + shift : ref_end);
+            res = fwrite(buf, 1, 16, f) == 16 ? 0 : -1;
+        }
+        put32(buf, 37450);              /* the pseudo-bin */
+        put32(buf + 4, 2);
+        put64(buf + 8, offset[beg]);
+        put64(buf + 16, ref_end);
+        if (res == 0 && fwrite(buf, 1, 24, f) != 24)
+            res = -1;
+        put64(buf, count);              /* mapped */
+        put64(buf + 8, 0);              /* unmapped */
+        put32(buf + 16, windows);
+        if (res == 0 && fwrite(buf, 1, 20, f) != 20)
+            res = -1;
+        for (i = 0; i < windows && res == 0; ++i) {
+            put64(buf, offset[beg + i * RECORDS_PER_WINDOW] + shift);
+            res = fwrite(buf, 1, 8, f) == 8 ? 0 : -1;
+        }
+    }
+    if (fclose(f) != 0)
+        res = -1;
+    return res;
+}
+
+static int MakeBAM(unsigned records, unsigned shift)
+{
+    BGZFWriter *const w = calloc(1, sizeof(*w));
+    uint64_t *const offset = malloc(records * sizeof(offset[0]));
+    unsigned first[REFS + 1];
+    uint8_t rec[1024];
+    unsigned i;
+    int res = -1;
+
+    if (w == NULL || offset == NULL) {
+        free(offset);
+        free(w);
+        return -1;
+    }
+    w->f = fopen(BAM_PATH, "wb");
+    if (w->f != NULL) {
+        unsigned ref;
+
+        res = WriteHeader(w, header, REFS);
+        srand(1);
+        for (ref = 0; ref <= REFS; ++ref)
+            first[ref] = (unsigned)((uint64_t)records * ref / REFS);
+        for (i = 0, ref = 0; i < records && res == 0; ++i) {
+            while (i >= first[ref + 1])
+                ++ref;
+            offset[i] = Tell(w);
+            res = Write(w, rec, MakeRecord(rec, ref, i));
+        }
+        if (res == 0 && w->used > 0)
+            res = WriteMember(w);
+        if (res == 0)
+            res = WriteBAI(offset, first, records, Tell(w), shift);
+        if (res == 0)
+            res = WriteMember(w);       /* the empty EOF marker */
+        if (fclose(w->f) != 0)
+            res = -1;
+    }
+    free(offset);
+    free(w);
+    return res;
+}
+
+static rc_t ReadBAM(unsigned threads, unsigned *ranges, uint64_t *count, uint32_t *digest, double *seconds)
+{
+    BAM_File const *bam = NULL;
+    double const start = Now();
+    rc_t rc = BAM_FileMake(&bam, NULL, NULL, "%s", BAM_PATH);
+
+    *ranges = 0;
+    if (rc == 0 && threads > 0)
+        rc = BAM_FileSetIndexedThreads(bam, threads, BAM_PATH, ranges);
+    if (rc == 0)
+        rc = ReadRecords(bam, true, count, digest);
+    BAM_FileRelease(bam);
+    *seconds = Now() - start;
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned const records = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 200000;
+    unsigned const threads = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 4;
+    unsigned ranges[2];
+    uint64_t count[2];
+    uint32_t digest[2];
+    double seconds[2];
+    rc_t rc;
+    int res = 1;
+
+    if (MakeBAM(records, 0) != 0) {
+        fprintf(stderr, "failure: can not write %s\n", BAM_PATH);
+        return 1;
+    }
+    rc = ReadBAM(0, &ranges[0], &count[0], &digest[0], &seconds[0]);
+    if (rc == 0)
+        rc = ReadBAM(threads, &ranges[1], &count[1], &digest[1], &seconds[1]);
+    if (CheckReads(BAM_PATH, rc, records, count, digest) == 0) {
+        if (ranges[1] < 2)
+            fprintf(stderr, "failure: %u ranges, use more records\n", ranges[1]);
+        else {
+            printf("%u records: %.3f sec sequential, %.3f sec in %u ranges on %u threads\n",
+                   records, seconds[0], seconds[1], ranges[1], threads);
+            res = 0;
+        }
+    }
+
+    /* the offsets of this index are no starts of records */
+    if (res == 0 && MakeBAM(records, 3) != 0) {
+        fprintf(stderr, "failure: can not write %s\n", BAM_PATH);
+        res = 1;
+    }
+    if (res == 0) {
+        rc = ReadBAM(threads, &ranges[1], &count[1], &digest[1], &seconds[1]);
+        if (rc == 0) {
+            fprintf(stderr, "failure: a mismatched index was not detected, %lu records\n", (unsigned long)count[1]);
+            res = 1;
+        }
+    }
+    remove(BAI_PATH);
+    remove(BAM_PATH);
+    return res;
+}
@@ -0,0 +1,118 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/* Reads a synthetic SAM file with the lines parsed on the reading thread
+ * and on a pool of threads ( BAM_FileSetParseThreads ), checks that both
+ * produce the same records and prints the time each one took.
+ *
+ * usage: Test_BamLoader_sam_threads [records [threads]]
+ *        ( default: 200000 records, 4 threads )
+ */
+
+#include "bam-fixture.h"
+
+#define SAM_PATH "sam-threads.sam"
+
+static char const header[] =
+    "@HD\tVN:1.6\tSO:coordinate\n"
+    "@SQ\tSN:chr1\tLN:250000000\n"
+    "@SQ\tSN:chr2\tLN:240000000\n"
+    "@RG\tID:grp1\tPL:ILLUMINA\n";
+
+/* a SAM line with a random sequence of 100 - 250 bases, every 7th line ends with CR-LF */
+static int WriteRecord(FILE *f, unsigned n)
+{
+    char seq[251];
+    char qual[251];
+    unsigned const slen = 100 + rand() % 151;
+    unsigned i;
+
+    for (i = 0; i < slen; ++i) {
+        seq[i] = "ACGT"[rand() % 4];
+        qual[i] = (char)(35 + rand() % 39);
+    }
+    seq[slen] = qual[slen] = '\0';
+    return fprintf(f, "read.%u\t0\tchr%u\t%u\t60\t%uM\t*\t0\t0\t%s\t%s\tRG:Z:grp1\tNM:i:%u%s",
+                   n, 1 + n % 2, 1 + n / 4, slen, seq, qual, rand() % 5, n % 7 == 0 ? "\r\n" : "\n") > 0 ? 0 : -1;
+}
+
+static int MakeSAM(unsigned records)
+{
+    FILE *const f = fopen(SAM_PATH, "w");
+    unsigned i;
+    int res;
+
+    if (f == NULL)
+        return -1;
+    res = fputs(header, f) >= 0 ? 0 : -1;
+    srand(1);
+    for (i = 0; i < records && res == 0; ++i)
+        res = WriteRecord(f, i);
+    if (fclose(f) != 0)
+        res = -1;
+    return res;
+}
+
+static rc_t ReadSAM(unsigned threads, uint64_t *count, uint32_t *digest, double *seconds)
+{
+    BAM_File const *sam = NULL;
+    double const start = Now();
+    rc_t rc = BAM_FileMake(&sam, NULL, NULL, "%s", SAM_PATH);
+
+    if (rc == 0)
+        rc = BAM_FileSetParseThreads(sam, threads);
+    if (rc == 0)
+        rc = ReadRecords(sam, false, count, digest);
+    BAM_FileRelease(sam);
+    *seconds = Now() - start;
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned const records = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 200000;
+    unsigned const threads = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0) : 4;
+    uint64_t count[2];
+    uint32_t digest[2];
+    double seconds[2];
+    rc_t rc;
+    int res = 1;
+
+    if (MakeSAM(records) != 0) {
+        fprintf(stderr, "failure: can not write %s\n", SAM_PATH);
+        return 1;
+    }
+    rc = ReadSAM(0, &count[0], &digest[0], &seconds[0]);
+    if (rc == 0)
+        rc = ReadSAM(threads, &count[1], &digest[1], &seconds[1]);
+    if (CheckReads(SAM_PATH, rc, records, count, digest) == 0) {
+        printf("%u records: %.3f sec serial, %.3f sec with %u parse threads\n",
+               records, seconds[0], seconds[1], threads);
+        res = 0;
+    }
+    remove(SAM_PATH);
+    return res;
+}
@@ -0,0 +1,169 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+/* Runs the spot assembly with a spill budget of one byte ( every cold batch is spilled,
+ * every search in a spilled batch loads it back ) next to one without a budget and
+ * compares the results of all searches. The names of the later batches are longer than
+ * the ones of the early batches, the key filter lets every name through, so the gates of
+ * the spilled batches see lots of names that are not in them ( and have false positives ).
+ * At the end the scratch files have to be gone.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/stopwatch.h>
+
+#include "data_frame.hpp"
+#include <taskflow/taskflow.hpp>
+#include <taskflow/algorithm/sort.hpp>
+#include "hashing.hpp"
+#include <tsl/array_map.h>
+#include "spot_assembly.hpp"
+
+static unsigned failures = 0;
+
+static void check(bool const ok, char const *what, size_t i)
+{
+    if (!ok && ++failures < 10)
+        fprintf(stderr, "failure: %s, search %zu\n", what, i);
+}
+
+/* every name is 'seen before': all searches go through the batches */
+class pass_all_filter : public spot_name_filter
+{
+public:
+    virtual bool seen_before(const char* value, size_t sz) override
+    {
+        m_name_hash = hashing::fnv1a(value, sz);
+        return true;
+    }
+    size_t memory_used() const override { return 0; }
+};
+
+/* the names of the first half are short, in the second half every 3rd is long */
+static string spot_name(size_t const i, size_t const count)
+{
+    string name = fmt::format("S{}", i);
+    if (i >= count / 2 && i % 3 == 0)
+        name += string(40 + i % 50, 'x');
+    return name;
+}
+
+static size_t count_files(filesystem::path const &dir)
+{
+    size_t n = 0;
+    for (auto const &entry : filesystem::directory_iterator(dir)) {
+        (void)entry;
+        ++n;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t const count = 30000;       /* spots */
+    size_t const batch_size = 1500;   /* spots per batch -> 20 batches */
+    filesystem::path const dir = "spot-spill.tmp";
+
+    spdlog::set_level(spdlog::level::warn);
+    filesystem::remove_all(dir);
+    filesystem::create_directory(dir);
+
+    /* every spot is searched twice: when it is new and later as its mate */
+    vector<size_t> searches;
+    srand(1);
+    for (size_t i = 0; i < count; ++i) {
+        searches.push_back(i);
+        if (i > 0 && rand() % 2 == 0)
+            searches.push_back(i - 1 - rand() % i);
+    }
+
+    tf::Executor executor(2);
+    auto spill = make_shared<spot_spill>((dir / "names").string(), 1);
+    size_t gate_false_positives = 0;
+    size_t longer_than_batch = 0;
+    {
+        spot_assembly plain(executor, make_shared<pass_all_filter>(), 0, batch_size);
+        spot_assembly spilled(executor, make_shared<pass_all_filter>(), 1, batch_size, spill);
+        unordered_map<string, size_t> expected;
+
+        for (size_t s = 0; s < searches.size(); ++s) {
+            string const name = spot_name(searches[s], count);
+            uint64_t const hash = hashing::fnv1a(name.data(), name.size());
+            auto const known = expected.find(name);
+
+            /* what the gates of the spilled batches make the search load back in vain */
+            for (auto const &batch : spilled.m_batches) {
+                if (!batch->is_spilled() || !batch->m_gate->contains_hash(hash))
+                    continue;
+                if (known == expected.end() || known->second < batch->m_offset
+                    || known->second >= batch->m_offset + batch->m_batch_size)
+                {
+                    ++gate_false_positives;
+                    if (name.size() > batch->m_max_name_len)
+                        ++longer_than_batch;
+                }
+            }
+
+            auto const &p = plain.find(name.data(), (int)name.size());
+            bool const p_inserted = p.wasInserted;
+            size_t const p_pos = p.pos;
+            auto const &r = spilled.find(name.data(), (int)name.size());
+            check(r.wasInserted == p_inserted && r.pos == p_pos, "spilled vs. plain", s);
+            if (known == expected.end()) {
+                check(r.wasInserted, "new name found", s);
+                expected.emplace(name, r.pos);
+            }
+            else
+                check(!r.wasInserted && r.pos == known->second, "known name", s);
+
+            if (plain.m_curr_row >= batch_size)
+                plain.pack_batch();
+            if (spilled.m_curr_row >= batch_size) {
+                spilled.pack_batch();
+                /* the next enforce() spills it */
+                spilled.m_batches.back()->m_pack_job.wait();
+            }
+        }
+        check(spill->spills() > 10 && spill->reloads() > 10, "several spills and reloads", searches.size());
+        check(gate_false_positives > 0, "gate false positives", searches.size());
+        check(longer_than_batch > 0, "false positives longer than the names of the batch", searches.size());
+        check(count_files(dir) > 0, "scratch files while the assembly lives", searches.size());
+        printf("%zu searches, %zu batches: %zu spills, %zu reloads, %zu false positives of the gates ( %zu longer than the batch names )\n",
+               searches.size(), spilled.m_batches.size(), spill->spills(), spill->reloads(),
+               gate_false_positives, longer_than_batch);
+    }
+    check(count_files(dir) == 0, "scratch files removed with the assembly", searches.size());
+    filesystem::remove_all(dir);
+    return failures == 0 ? 0 : 1;
+}
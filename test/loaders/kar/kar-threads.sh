@@ -0,0 +1,80 @@
+#!/bin/sh
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+#####
+#### Creates archives of the same directory with one and with several
+### threads, with and without md5, and checks that they are identical
+## and that the md5 is the md5 of the archive
+#
+
+if [ $# -ne 1 ] || [ ! -x "$1" ]
+then
+    echo "Syntax: `basename $0` path_to_kar_utility" >&2
+    exit 1
+fi
+KAR_B=$1
+
+echo "## TEST START"
+
+WORKDIR=$( mktemp -d )
+trap 'rm -rf $WORKDIR' EXIT
+
+##
+## some larger files than in source, the files are copied in chunks of 8M
+##
+SRCDIR=$WORKDIR/source
+cp -R source $SRCDIR || exit 1
+dd if=/dev/urandom of=$SRCDIR/big1 bs=1000003 count=19 2>/dev/null || exit 1
+dd if=/dev/urandom of=$SRCDIR/big2 bs=1000 count=9 2>/dev/null || exit 1
+: > $SRCDIR/empty
+
+for MD5 in "" "--md5"
+do
+    $KAR_B $MD5 --create $WORKDIR/serial.sra --directory $SRCDIR || exit 1
+    for T in 2 5
+    do
+        echo "## kar $MD5 --threads $T"
+        $KAR_B $MD5 --threads $T --create $WORKDIR/threads.sra --directory $SRCDIR || exit 1
+        if ! cmp $WORKDIR/serial.sra $WORKDIR/threads.sra
+        then
+            echo "Error: archives made with 1 and $T threads differ" >&2
+            exit 1
+        fi
+        if [ -n "$MD5" ]
+        then
+            EXPECTED=$( md5sum < $WORKDIR/threads.sra | cut -d ' ' -f 1 )
+            ACTUAL=$( cut -d ' ' -f 1 $WORKDIR/threads.sra.md5 )
+            if [ "$EXPECTED" != "$ACTUAL" ]
+            then
+                echo "Error: wrong md5 with $T threads" >&2
+                exit 1
+            fi
+        fi
+        rm -f $WORKDIR/threads.sra $WORKDIR/threads.sra.md5
+    done
+    rm -f $WORKDIR/serial.sra $WORKDIR/serial.sra.md5
+done
+
+echo "## TEST PASSED"
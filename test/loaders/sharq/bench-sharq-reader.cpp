@@ -0,0 +1,122 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/* ---------------------------------------------------------------------------------
+    throughput-benchmark for the FASTQ reader of SHARQ
+    ( not part of ctest )
+
+    splits the input into lines with std::getline ( the reader's former way )
+    and with sharq::line_reader, then parses and validates the reads with
+    fastq_reader::get_read, and prints the throughput in MB/s of input
+
+    usage: bench-sharq-reader [ fastq-file | number-of-reads ]
+           the file may be compressed, it is decompressed into memory first
+   --------------------------------------------------------------------------------- */
+
+#include "../../tools/loaders/sharq/fastq_parser.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+
+using namespace std;
+
+static string s_MakeReads(size_t count)
+{
+    static const char bases[] = "ACGT";
+    string data;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i < count; ++i) {
+        data += "@A00123:8:H5KJ2DSXX:1:1101:" + to_string(1000 + i % 30000) + ":" + to_string(1000 + i) + " 1:N:0:ACGTACGT\n";
+        for (int j = 0; j < 150; ++j) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            data += bases[x & 3];
+        }
+        data += "\n+\n";
+        for (int j = 0; j < 150; ++j)
+            data += char('#' + (x >> (j % 60)) % 40);
+        data += '\n';
+    }
+    return data;
+}
+
+template<typename F>
+static void s_Measure(const char* name, size_t bytes, F&& f)
+{
+    auto start = chrono::steady_clock::now();
+    size_t count = f();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%-28s %12zu %10.3f s %10.1f MB/s\n", name, count, secs, bytes / secs / (1024 * 1024));
+}
+
+int main(int argc, char* argv[])
+{
+    string data;
+    int platform = SRA_PLATFORM_ILLUMINA;
+    if (argc > 1 && !isdigit(argv[1][0])) {
+        platform = SRA_PLATFORM_UNDEFINED;
+        auto is = s_OpenStream(argv[1], 1024 * 1024);
+        stringstream ss;
+        ss << is->rdbuf();
+        data = ss.str();
+    } else {
+        data = s_MakeReads(argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000);
+    }
+    printf("input: %zu bytes\n", data.size());
+
+    s_Measure("lines: std::getline", data.size(), [&]() {
+        istringstream is(data);
+        string line;
+        size_t count = 0;
+        while (getline(is, line))
+            ++count;
+        return count;
+    });
+    s_Measure("lines: sharq::line_reader", data.size(), [&]() {
+        istringstream is(data);
+        sharq::line_reader lines(is);
+        string_view line;
+        size_t count = 0;
+        while (lines.get_line(line) || !line.empty())
+            ++count;
+        return count;
+    });
+    s_Measure("reads: fastq_reader", data.size(), [&]() {
+        fastq_reader reader("bench", make_shared<istringstream>(data), {}, platform, true);
+        size_t errors = 0;
+        reader.set_error_handler([&errors](fastq_error&) { ++errors; });
+        CFastqRead read;
+        size_t count = 0;
+        while (!reader.eof()) {
+            if (reader.get_read<validator_options<ePhred, 33, 126>>(read))
+                ++count;
+        }
+        if (errors)
+            printf("%zu reads rejected\n", errors);
+        return count;
+    });
+    return 0;
+}
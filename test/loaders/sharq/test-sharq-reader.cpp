@@ -1241,6 +1241,270 @@ FIXTURE_TEST_CASE(illuminaOldBcOnly, LoaderFixture)
     REQUIRE(read.ReadNum().empty());
 }
 
+///////////////////////////////////////////////// decompression on background threads
+
+static string s_ReadAll(istream& is)
+{
+    string all, line;
+    while (getline(is, line)) {
+        all += line;
+        if (!is.eof())
+            all += '\n';
+    }
+    return all;
+}
+
+// BGZF member as written by bgzip: FEXTRA with the BC subfield, raw deflate, CRC32, ISIZE
+static string s_BgzfBlock(const string& data)
+{
+    auto put = [](string& s, uint32_t v, int bytes) { for (int i = 0; i < bytes; ++i) s += char((v >> (8 * i)) & 0xff); };
+    z_stream zs{};
+    deflateInit2(&zs, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    string deflated(deflateBound(&zs, data.size()), '\0');
+    zs.next_in = (Bytef*)data.data();
+    zs.avail_in = data.size();
+    zs.next_out = (Bytef*)deflated.data();
+    zs.avail_out = deflated.size();
+    deflate(&zs, Z_FINISH);
+    deflated.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    string block("\x1f\x8b\x08\x04\0\0\0\0\0\xff", 10);
+    put(block, 6, 2);
+    block += "BC";
+    put(block, 2, 2);
+    put(block, deflated.size() + 25, 2);
+    block += deflated;
+    put(block, crc32(0, (const Bytef*)data.data(), data.size()), 4);
+    put(block, data.size(), 4);
+    return block;
+}
+
+FIXTURE_TEST_CASE(BgzfInput, LoaderFixture)
+{
+    string text;
+    for (int i = 0; i < 20000; ++i) {
+        string defline = "@M00730:68:000000000-A2307:1:1101:" + to_string(i) + ":1383 1:N:0:1";
+        text += _READ(defline, "GATTACA", "IIIIIII");
+    }
+    string bgzf;
+    for (size_t pos = 0; pos < text.size(); pos += 60000)
+        bgzf += s_BgzfBlock(text.substr(pos, 60000));
+    bgzf += s_BgzfBlock(""); // EOF marker
+    const string file_name = "bgzf_input.fq.gz";
+    ofstream(file_name, ios::binary) << bgzf;
+
+    {
+        auto stream = s_OpenStream(file_name, 1024 * 1024, 4);
+        stream->exceptions(std::ifstream::badbit);
+        REQUIRE_EQ(s_ReadAll(*stream), text);
+    }
+    {
+        fastq_reader reader(file_name, s_OpenStream(file_name, 1024 * 1024, 4));
+        REQUIRE(reader.is_compressed());
+        CFastqRead read;
+        size_t count = 0;
+        while (reader.get_read(read))
+            ++count;
+        REQUIRE_EQ(count, 20000lu);
+        REQUIRE_EQ(reader.tellg(), bgzf.size());
+        auto metrics = reader.decompression_metrics();
+        REQUIRE_EQ(metrics.mode, string("bgzf"));
+        REQUIRE_EQ(metrics.threads, 4u);
+        REQUIRE_EQ(metrics.bytes, text.size());
+    }
+    // a damaged member is reported, not skipped
+    bgzf[bgzf.size() / 2] ^= 0x55;
+    ofstream(file_name, ios::binary) << bgzf;
+    {
+        auto stream = s_OpenStream(file_name, 1024 * 1024, 4);
+        stream->exceptions(std::ifstream::badbit);
+        REQUIRE_THROW(s_ReadAll(*stream));
+    }
+    remove(file_name.c_str());
+}
+
+FIXTURE_TEST_CASE(ReadAheadInput, LoaderFixture)
+{
+    for (const string file_name : { "input/003.t2_R1.fastq.gz", "input/003.t3_R1.fastq.bz2" }) {
+        auto sequential = s_OpenStream(file_name, 1024 * 1024);
+        auto read_ahead = s_OpenStream(file_name, 1024 * 1024, 4);
+        REQUIRE_EQ(s_ReadAll(*read_ahead), s_ReadAll(*sequential));
+        auto stream = dynamic_cast<sharq::input_stream*>(read_ahead.get());
+        REQUIRE(stream != nullptr);
+        REQUIRE_EQ(stream->metrics().mode, string("read-ahead"));
+        REQUIRE(stream->compression() != bxz::plaintext);
+    }
+    // not compressed: read on the reader's thread
+    auto plain = s_OpenStream("input/003.t_R1.fastq", 1024 * 1024, 4);
+    REQUIRE(dynamic_cast<sharq::input_stream*>(plain.get()) == nullptr);
+}
+
+//////////////////// defline scanners vs. the regexes
+
+// deflines of the test inputs and of the tag line tests above,
+// their truncations and single character edits, and random token soup
+static vector<string> s_DeflineCorpus()
+{
+    vector<string> base = {
+        "@M00730:68:000000000-A2307:1:1101:14701:1383 1:N:0:1",
+        "@HWI-M01380:63:000000000-A8KG4:1:1101:17932:1459 1:N:0:Alpha29 CTAGTACG|0|GTAAGGAG|0",
+        "@HWI-ST959:56:D0AW4ACXX:8:1101:1233:2026 2:N:0:",
+        "@HET-141-007:154:C391TACXX:6:1216:12924:76893 1:N:0",
+        "@DG7PMJN1:293:D12THACXX:2:1101:1161:1968_1:N:0:GATCAG",
+        "@MISEQ:36:000000000-A5BCL:1:1101:24982:8584;smpl=12;brcd=ACTTTCCCTCGA 1:N:0:ACTTTCCCTCGA",
+        "@HWI-ST1234:33:D1019ACXX:2:1101:1415:2223/1 1:N:0:ATCACG",
+        "@aa,HWI-7001455:146:H97PVADXX:2:1101:1498:2093 1:Y:0:ACAAACGGAGTTCCGA",
+        "@HWI:1:X:1:1101:1298:2061 1:N:0: AGCGATAG (barcode is discarded)",
+        "@8:1101:1486:2141 1:N:0:/1",
+        "@HS2000-1017_69:7:2203:18414:13643|2:N:O:GATCAG",
+        "@HISEQ:258:C6E8AANXX:6:1101:1823:1979:CGAGCACA:1:N:0:CGAGCACA:NG:GT",
+        "@SEDCJ:00674:05781 1:N:0:AAAAA",
+        "@spot2 1:N:0:ATCTTGTT",
+        "@HWUSI-EAS100R:6:73:941:1973#0/1",
+        "@HWUSI-EAS100R:6:73:941:1973#0/1 extra",
+        "@HWUSI-EAS100R:6:73:941:1973 /2",
+        "@HWUSI-EAS100R:6:73:941:1973#ACGT \\1",
+        "@R16:8:1:0:1617#0/1",
+        "@HWI-EAS30_2_FC200HWAAXX_6_1:6:1:1:1#0/1",
+        "@A:1:2:3:4:1:N:0:5:6:7:8 1:N:0:Z",
+        "@A:1:2:3:4_1:Y:0:5_6_7_8 1:N:0:Z",
+        "@HWUSI:1:2:3:4#x:5:6:7:8/1",
+        "@HWUSI:1:2:3:4:5/1 /2",
+        "@V300019058_8BL1C001R0010000000 1:N:0:ATGGTAGG",
+        "@V300103666L2C001R0010000000:0:0:0:0 1:N:0:ATAGTCTC",
+        "@CL100159005L1C001R001_2 2:N:0:0",
+        "@CL100050407L1C001R001_1#224_1078_917/1 1       1",
+        "@V350012516L1C001R00100001492/1",
+        "@V300019058_8BL1C001R00112345678 1:N:0:ATGGTAG",
+        "@V300047012L3C001R0010000001#AC/1x/2",
+        "@aba5dfd4-af02-46d1-9bce-3b62557aa8c1 runid=91c917caaf7b201766339e506ba26eddaf8c06d9 read=29 ch=350 start_time=2018-03-02T16:12:39Z barcode=barcode01",
+        "@72ad9b11-af72-4a2f-b943-650c9d88962f protocol_group_id=NASA_WCR_PCR_BC_083019 ch=503 barcode=BC08 read=17599 start_time=2019-08-30T21:26:18Z flow_cell_id=FAK67070",
+        "@5f8415e3-46ae-48fc-9092-a291b8b6a9b9 run_id=47b8d024d71eef532d676f4aa32d8867a259fc1b m_read=279 mux=3 ch=87 start_time=2017-01-20T16:26:27Z",
+        "@aba5dfd4-af02-46d1-9bce-3b62557aa8c1 runid=91c917caaf7b201766339e506ba26eddaf8c06d9 start_time=2018-03-02T16:12:39Z barcode=unclassified",
+        "@f286a4e1-fb27-4ee7-adb8-60c863e55dbb_Basecall_Alignment_template MINICOL235_20170120_FN__MN16250_sequencing_throughput_ONLL3135_25304_ch143_read16010_strand",
+    };
+    for (auto& entry : fs::directory_iterator("input")) {
+        try {
+            auto stream = s_OpenStream(entry.path().string(), 1024 * 1024);
+            string line;
+            for (int i = 0; i < 400 && getline(*stream, line); ++i)
+                if (!line.empty() && line[0] == '@' && line.size() < 512)
+                    base.push_back(line);
+        } catch (exception&) {
+            // not a readable input, e.g. a truncated archive
+        }
+    }
+    sort(base.begin(), base.end());
+    base.erase(unique(base.begin(), base.end()), base.end());
+
+    vector<string> lines;
+    static const string edits = " \t:_#/\\-.1050NYOLCR]";
+    for (const auto& line : base) {
+        lines.push_back(line);
+        for (size_t i = 1; i < line.size(); ++i) {
+            lines.push_back(line.substr(0, i));
+            lines.push_back(line.substr(0, i) + line.substr(i + 1));
+            for (char c : edits) {
+                string edited = line;
+                edited[i] = c;
+                lines.push_back(edited);
+            }
+        }
+    }
+
+    static const char* tokens[] = {
+        "@", "+", ">", "A00123", "HWI-ST", ":", "_", "-", ".", "#", "/", "\\", " ", "  ", "\t",
+        "0", "1", "2", "12", "1101", "14701", "N", "Y", "O", ":N:", "1:N:0:", "2:Y:0:", ":N:0", "ACGT",
+        "/1", "/2", "\\1", "#0/1", "L1", "C001", "R001", "V300012345", "0000001", "_1",
+        "aba5dfd4-af02-46d1-9bce-3b62557aa8c1", "read=", "read_", "ch=", "ch", "barcode=", "]", "\x80",
+    };
+    uint64_t x = 88172645463325252ull;
+    auto next = [&x]() { x ^= x << 13; x ^= x >> 7; x ^= x << 17; return x; };
+    for (int i = 0; i < 200000; ++i) {
+        string line(1, "@@@+>A"[next() % 6]);
+        for (size_t n = 1 + next() % 14; n > 0; --n)
+            line += tokens[next() % (sizeof(tokens) / sizeof(tokens[0]))];
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+FIXTURE_TEST_CASE(DeflineScanners, LoaderFixture)
+{
+    const vector<string> lines = s_DeflineCorpus();
+
+    CDefLineMatcherIlluminaNew illumina_new;
+    CDefLineMatcherIlluminaOldColon illumina_old;
+    CDefLineMatcherBgiNew bgi_new;
+    CDefLineMatcherBgiOld bgi_old;
+    CDefLineMatcherNanopore4 nanopore4;
+    const vector<pair<const CDefLineMatcher*, sharq::defline_scanner_t>> scanners = {
+        { &illumina_new, sharq::scan_illumina_new },
+        { &illumina_old, sharq::scan_illumina_old },
+        { &bgi_new, sharq::scan_bgi_new },
+        { &bgi_old, sharq::scan_bgi_old },
+        { &nanopore4, sharq::scan_nanopore4 },
+    };
+    for (auto& scanner : scanners) {
+        CRegExprMatcher re(scanner.first->GetPattern());
+        sharq::defline_groups_t groups(re.GetMatch().size());
+        size_t accepted = 0;
+        for (const auto& line : lines) {
+            if (!scanner.second(line, groups))
+                continue;
+            ++accepted;
+            if (!re.Matches(line))
+                FAIL((scanner.first->Defline() + " scanner accepts, regex does not match: '" + line + "'").c_str());
+            for (size_t i = 0; i < groups.size(); ++i) {
+                if (groups[i] != re.GetMatch()[i])
+                    FAIL((scanner.first->Defline() + " group " + to_string(i) + " differs: '" + line + "'").c_str());
+            }
+        }
+        REQUIRE_GT(accepted, 100lu);
+    }
+
+    // the fields Nanopore4 looks up in scanned lines
+    CRegExprMatcher read_no(R"(read[=_]?(\d+))");
+    CRegExprMatcher channel(R"(ch[=_]?(\d+))");
+    CRegExprMatcher barcode(R"(barcode=(\S+))");
+    for (const auto& line : lines) {
+        if (find_if(line.begin(), line.end(), [](char c) { return (unsigned char)c >= 0x80; }) != line.end())
+            continue;
+        re2::StringPiece value;
+        REQUIRE_EQ(sharq::find_number_field(line, "read", value), read_no.Matches(line));
+        if (!value.empty())
+            REQUIRE_EQ(value.as_string(), read_no.GetMatch()[0].as_string());
+        value = re2::StringPiece();
+        REQUIRE_EQ(sharq::find_number_field(line, "ch", value), channel.Matches(line));
+        if (!value.empty())
+            REQUIRE_EQ(value.as_string(), channel.GetMatch()[0].as_string());
+        value = re2::StringPiece();
+        REQUIRE_EQ(sharq::find_text_field(line, "barcode=", value), barcode.Matches(line));
+        if (!value.empty())
+            REQUIRE_EQ(value.as_string(), barcode.GetMatch()[0].as_string());
+    }
+}
+
+FIXTURE_TEST_CASE(DeflineScannersCommonFormats, LoaderFixture)
+{
+    sharq::defline_groups_t groups(16);
+    REQUIRE(sharq::scan_illumina_new("@A00123:8:H5KJ2DSXX:1:1101:1000:1000 1:N:0:ACGTACGT", groups));
+    REQUIRE_EQ(groups[0].as_string(), string("A00123:8:H5KJ2DSXX"));
+    REQUIRE_EQ(groups[13].as_string(), string("ACGTACGT"));
+    REQUIRE(sharq::scan_illumina_old("@HWUSI-EAS100R:6:73:941:1973#0/1", groups));
+    REQUIRE_EQ(groups[9].as_string(), string("#0"));
+    REQUIRE_EQ(groups[10].as_string(), string("/1"));
+    REQUIRE(sharq::scan_bgi_new("@V300019058L1C001R0010000001 1:N:0:ATGGTAGG", groups));
+    REQUIRE_EQ(groups[0].as_string(), string("V300019058"));
+    REQUIRE(sharq::scan_bgi_old("@V300047012L3C001R0010000001/1", groups));
+    REQUIRE_EQ(groups[4].as_string(), string("0000001"));
+    REQUIRE(sharq::scan_nanopore4("@aba5dfd4-af02-46d1-9bce-3b62557aa8c1 runid=91c9 read=29 ch=350", groups));
+    REQUIRE_EQ(groups[0].as_string(), string("aba5dfd4-af02-46d1-9bce-3b62557aa8c1"));
+    // the read number could be inside the name: left to the regex
+    REQUIRE(!sharq::scan_illumina_new("@DG7PMJN1:293:D12THACXX:2:1101:1161:1968_1:N:0:GATCAG", groups));
+}
+
 ////////////////////////////////////////////
 
 int main (int argc, char *argv [])
@@ -0,0 +1,301 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "auto_tune.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+#ifndef _h_klib_printf_
+#include <klib/printf.h>
+#endif
+
+#include <stdarg.h>
+
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+#define AT_MIN_THREADS 2
+#define AT_MAX_THREADS 64
+#define AT_MIN_ROWS_PER_THREAD 100000
+#define AT_MB ( ( size_t )1024 * 1024 )
+#define AT_MIN_BUF_SIZE ( 1 * AT_MB )
+#define AT_MAX_BUF_SIZE ( 8 * AT_MB )
+#define AT_MIN_MEM_LIMIT ( 50 * AT_MB )
+#define AT_MAX_MEM_LIMIT ( 1024 * AT_MB )
+#define AT_MAX_CUR_CACHE ( 64 * AT_MB )
+
+/* ---------------------------------------------------------------------------------- */
+
+#ifdef WINDOWS
+
+uint32_t at_num_cores( void ) { return 0; }
+uint64_t at_available_ram( void ) { return 0; }
+
+#else
+
+uint32_t at_num_cores( void ) {
+    long n = sysconf( _SC_NPROCESSORS_ONLN );
+    return ( n > 0 ) ? ( uint32_t )n : 0;
+}
+
+uint64_t at_available_ram( void ) {
+#ifdef _SC_AVPHYS_PAGES
+    /* free pages, the page-cache counts as used: on the safe side */
+    long pages = sysconf( _SC_AVPHYS_PAGES );
+    long page_size = sysconf( _SC_PAGESIZE );
+    if ( pages > 0 && page_size > 0 ) {
+        return ( uint64_t )pages * ( uint64_t )page_size;
+    }
+#endif
+    return 0;   /* mac: unknown, at_make_plan() uses half of the total RAM */
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------- */
+
+static void at_reason( at_plan_t * plan, at_item_t item, const char * fmt, ... ) {
+    size_t num_writ;
+    va_list args;
+    va_start( args, fmt );
+    if ( 0 != string_vprintf( plan -> reason[ item ], AT_REASON_LEN, &num_writ, fmt, args ) ) {
+        plan -> reason[ item ][ 0 ] = 0;
+    }
+    va_end( args );
+}
+
+static size_t at_clamp( size_t value, size_t min, size_t max ) {
+    if ( value < min ) { return min; }
+    if ( value > max ) { return max; }
+    return value;
+}
+
+/* the memory the tool may use for its buffers and the lookup */
+static uint64_t at_ram_budget( const at_input_t * input ) {
+    if ( input -> avail_ram > 0 ) { return input -> avail_ram; }
+    return input -> total_ram / 2;
+}
+
+static void at_plan_threads( const at_input_t * input, at_plan_t * plan ) {
+    uint64_t row_count = input -> insp -> seq . row_count;
+    if ( input -> given . num_threads ) {
+        at_reason( plan, at_threads, "given on the commandline" );
+    } else if ( 0 == input -> cores ) {
+        at_reason( plan, at_threads, "number of cores unknown, keeping the default" );
+    } else {
+        uint32_t threads = ( uint32_t )at_clamp( input -> cores, AT_MIN_THREADS, AT_MAX_THREADS );
+        uint64_t by_rows = row_count / AT_MIN_ROWS_PER_THREAD;
+        at_reason( plan, at_threads, "%u cores", input -> cores );
+        if ( by_rows < threads ) {
+            threads = ( uint32_t )at_clamp( by_rows, AT_MIN_THREADS, threads );
+            at_reason( plan, at_threads, "%,lu rows, at least %,u rows per thread",
+                       row_count, AT_MIN_ROWS_PER_THREAD );
+        }
+        /* a remote accession is cached on scratch by each thread ( see tool_ctx.c ) */
+        if ( input -> insp -> is_remote && input -> insp -> acc_size > 0 && input -> tmp_free > 0 ) {
+            uint64_t by_disk = input -> tmp_free / ( 2 * input -> insp -> acc_size );
+            if ( by_disk < threads ) {
+                threads = ( uint32_t )at_clamp( by_disk, AT_MIN_THREADS, threads );
+                at_reason( plan, at_threads, "remote, each thread caches %,lu bytes, %,lu bytes free on scratch",
+                           input -> insp -> acc_size, input -> tmp_free );
+            }
+        }
+        plan -> num_threads = threads;
+    }
+    {
+        uint32_t threads = plan -> num_threads;
+        plan -> rows_per_thread = hlp_calculate_rows_per_thread( &threads, row_count ); /* helper.c */
+    }
+}
+
+/* the memory-limit of the sorter of each producer-thread ( lookup-files ) */
+static size_t at_sort_mem_limit( uint64_t budget, const at_plan_t * plan ) {
+    /* bigger sorted runs per thread: fewer lookup-files to merge */
+    return at_clamp( budget / ( 4 * ( uint64_t )plan -> num_threads ),
+                     AT_MIN_MEM_LIMIT, AT_MAX_MEM_LIMIT );
+}
+
+static void at_plan_lookup( const at_input_t * input, at_plan_t * plan ) {
+    uint64_t budget = at_ram_budget( input );
+    if ( 0 == input -> lookup_estimate ) {
+        at_reason( plan, at_lookup, "no lookup needed" );
+    } else if ( input -> given . mem_lookup ) {
+        at_reason( plan, at_lookup, "given on the commandline" );
+    } else if ( budget > 0 && input -> lookup_estimate <= budget / 2 ) {
+        plan -> use_mem_lookup = true;
+        if ( !input -> given . mem_limit ) {
+            /* some headroom: the estimation does not know the exact length of each read */
+            plan -> mem_lookup_limit = input -> lookup_estimate + ( input -> lookup_estimate / 8 );
+            /* if the lookup overflows after all: each thread sorts for the lookup-files */
+            plan -> mem_limit = at_sort_mem_limit( budget, plan );
+        }
+        at_reason( plan, at_lookup, "estimated %,lu bytes, fits into half of %,lu bytes of RAM",
+                   input -> lookup_estimate, budget );
+    } else {
+        plan -> use_mem_lookup = false;
+        if ( !input -> given . mem_limit && budget > 0 ) {
+            plan -> mem_limit = at_sort_mem_limit( budget, plan );
+        }
+        at_reason( plan, at_lookup, "estimated %,lu bytes, more than half of %,lu bytes of RAM",
+                   input -> lookup_estimate, budget );
+    }
+}
+
+static void at_plan_spill( const at_input_t * input, at_plan_t * plan ) {
+    if ( input -> given . spill_io ) {
+        at_reason( plan, at_spill, "given on the commandline" );
+    } else if ( 0 == input -> lookup_estimate || plan -> use_mem_lookup ) {
+        at_reason( plan, at_spill, "no lookup-files" );
+    } else if ( input -> avail_ram > 0 && input -> lookup_estimate > input -> avail_ram / 2 ) {
+        /* the lookup-files would push the output-files out of the page-cache */
+        plan -> spill_io = sio_direct;
+        at_reason( plan, at_spill, "the lookup-files do not fit into the page-cache" );
+    } else {
+        at_reason( plan, at_spill, "the lookup-files fit into the page-cache" );
+    }
+    if ( 0 != input -> lookup_estimate && !plan -> use_mem_lookup &&
+         input -> tmp_free > 0 && input -> tmp_free < 2 * input -> lookup_estimate ) {
+        /* the sub-files and the final lookup-file exist at the same time */
+        at_reason( plan, at_spill, "WARNING: %,lu bytes free on scratch, the lookup-files need up to %,lu",
+                   input -> tmp_free, 2 * input -> lookup_estimate );
+    }
+}
+
+static void at_plan_output( const at_input_t * input, at_plan_t * plan ) {
+    if ( input -> given . direct_write ) {
+        at_reason( plan, at_output, "given on the commandline" );
+    } else if ( input -> use_stdout ) {
+        at_reason( plan, at_output, "output goes to stdout" );
+    } else if ( input -> row_limit ) {
+        at_reason( plan, at_output, "a row-limit is given" );
+    } else {
+        switch( input -> fmt ) {
+            case ft_fasta_us_split_spot :
+            case ft_fasta_ref_tbl :
+            case ft_fasta_concat :
+            case ft_ref_report  : at_reason( plan, at_output, "no temp-files for this format" ); break;
+            default             : plan -> direct_write = true;
+                                  at_reason( plan, at_output, "no temp-files for %,lu bytes of output, no concat-step",
+                                             input -> estimated_output_size );
+                                  break;
+        }
+    }
+}
+
+static void at_plan_buffers( const at_input_t * input, at_plan_t * plan ) {
+    uint64_t budget = at_ram_budget( input );
+    if ( input -> given . buf_size ) {
+        at_reason( plan, at_buffers, "given on the commandline" );
+    } else if ( 0 == budget ) {
+        at_reason( plan, at_buffers, "available RAM unknown, keeping the default" );
+    } else {
+        /* each thread has a few files open, 1/32 of the RAM for all of them */
+        size_t buf_size = at_clamp( budget / ( 32 * ( uint64_t )plan -> num_threads ),
+                                    AT_MIN_BUF_SIZE, AT_MAX_BUF_SIZE );
+        plan -> buf_size = ( buf_size / AT_MB ) * AT_MB;
+        at_reason( plan, at_buffers, "%u threads share 1/32 of %,lu bytes of RAM", plan -> num_threads, budget );
+    }
+}
+
+static void at_plan_cache( const at_input_t * input, at_plan_t * plan ) {
+    uint64_t budget = at_ram_budget( input );
+    if ( input -> given . cursor_cache ) {
+        at_reason( plan, at_cache, "given on the commandline" );
+    } else if ( !input -> insp -> is_remote ) {
+        at_reason( plan, at_cache, "local accession, the default is enough" );
+    } else if ( 0 == budget ) {
+        at_reason( plan, at_cache, "available RAM unknown, keeping the default" );
+    } else {
+        /* remote: every cache-miss is a round-trip over the network */
+        plan -> cursor_cache = at_clamp( budget / ( 16 * ( uint64_t )plan -> num_threads ),
+                                         plan -> cursor_cache, AT_MAX_CUR_CACHE );
+        at_reason( plan, at_cache, "remote accession, fewer round-trips" );
+    }
+}
+
+rc_t at_make_plan( const at_input_t * input, at_plan_t * plan ) {
+    uint32_t idx;
+    if ( NULL == input || NULL == input -> insp || NULL == plan ) {
+        rc_t rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "auto_tune.c at_make_plan() -> %R", rc );
+        return rc;
+    }
+    for ( idx = 0; idx < at_count; ++idx ) {
+        plan -> reason[ idx ][ 0 ] = 0;
+    }
+    /* the order matters: the threads first, the memory per thread depends on them */
+    at_plan_threads( input, plan );
+    at_plan_lookup( input, plan );
+    at_plan_spill( input, plan );
+    at_plan_output( input, plan );
+    at_plan_buffers( input, plan );
+    at_plan_cache( input, plan );
+    return 0;
+}
+
+rc_t at_print_plan( const at_input_t * input, const at_plan_t * plan ) {
+    rc_t rc = KOutHandlerSetStdErr();
+    if ( 0 == rc ) {
+        rc = KOutMsg( "auto-tune    : %u cores, %,lu bytes RAM available, %,lu bytes free on scratch\n",
+                      input -> cores, at_ram_budget( input ), input -> tmp_free );
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "  threads    : %u, %,lu rows each ( %s )\n",
+                      plan -> num_threads, plan -> rows_per_thread, plan -> reason[ at_threads ] );
+    }
+    if ( 0 == rc ) {
+        if ( plan -> use_mem_lookup ) {
+            rc = KOutMsg( "  lookup     : in memory, limit %,lu bytes, mem-limit %,lu bytes per thread ( %s )\n",
+                          plan -> mem_lookup_limit, plan -> mem_limit, plan -> reason[ at_lookup ] );
+        } else {
+            rc = KOutMsg( "  lookup     : lookup-files, mem-limit %,lu bytes per thread ( %s )\n",
+                          plan -> mem_limit, plan -> reason[ at_lookup ] );
+        }
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "  spill-io   : %s ( %s )\n",
+                      sio_direct == plan -> spill_io ? "direct" : "buffered", plan -> reason[ at_spill ] );
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "  output     : %s ( %s )\n",
+                      plan -> direct_write ? "direct-write" : "temp-files + concat", plan -> reason[ at_output ] );
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "  buf-size   : %,lu bytes ( %s )\n", plan -> buf_size, plan -> reason[ at_buffers ] );
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "  curcache   : %,lu bytes ( %s )\n", plan -> cursor_cache, plan -> reason[ at_cache ] );
+    }
+    KOutHandlerSetStdOut();
+    return rc;
+}
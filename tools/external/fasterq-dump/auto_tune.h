@@ -0,0 +1,122 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_auto_tune_
+#define _h_auto_tune_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"
+#endif
+
+#ifndef _h_inspector_
+#include "inspector.h"
+#endif
+
+#ifndef _h_spill_io_
+#include "spill_io.h"
+#endif
+
+/* ----------------------------------------------------------------------------------------------
+    auto-tune: picks thread-count, lookup-strategy ( in memory or spilled to scratch ), output-
+    strategy and buffer-sizes from what the inspector found out about the accession and from the
+    machine ( cores, available RAM, free scratch-space ). Values given on the commandline are
+    never changed. ( --auto-tune )
+   ---------------------------------------------------------------------------------------------- */
+
+/* which values were given on the commandline */
+typedef struct at_given_t {
+    bool num_threads;
+    bool mem_limit;
+    bool buf_size;
+    bool cursor_cache;
+    bool mem_lookup;
+    bool direct_write;
+    bool spill_io;
+} at_given_t;
+
+typedef struct at_input_t {
+    const insp_output_t * insp;     /* inspector.h */
+    format_t fmt;                   /* helper.h */
+    at_given_t given;               /* above */
+    uint64_t total_ram;             /* KAppGetTotalRam() */
+    uint64_t avail_ram;             /* at_available_ram(), 0 = unknown */
+    uint32_t cores;                 /* at_num_cores(), 0 = unknown */
+    size_t tmp_free;                /* free space on the scratch-device, 0 = unknown */
+    size_t lookup_estimate;         /* memlkp_estimate(), 0 = no lookup needed */
+    size_t estimated_output_size;   /* insp_estimate_output_size() */
+    bool use_stdout;
+    bool row_limit;                 /* -N/--row-limit given: no direct-write */
+} at_input_t;
+
+/* the items of the plan, each one has its reason */
+typedef enum at_item_t {
+    at_threads = 0,
+    at_lookup,
+    at_spill,
+    at_output,
+    at_buffers,
+    at_cache,
+    at_count
+} at_item_t;
+
+#define AT_REASON_LEN 160
+
+typedef struct at_plan_t {
+    uint32_t num_threads;
+    uint64_t rows_per_thread;       /* how the threads split the SEQ-table */
+    size_t mem_limit;               /* of the sorter in each thread ( lookup-files ) */
+    size_t mem_lookup_limit;        /* of the lookup in memory, all threads together */
+    size_t buf_size;
+    size_t cursor_cache;
+    bool use_mem_lookup;
+    bool direct_write;
+    spill_io_mode_t spill_io;       /* spill_io.h */
+    char reason[ at_count ][ AT_REASON_LEN ];
+} at_plan_t;
+
+uint32_t at_num_cores( void );
+uint64_t at_available_ram( void );
+
+/* plan has to be populated with the current values ( defaults or given on the commandline ),
+   only what is not given is changed */
+rc_t at_make_plan( const at_input_t * input, at_plan_t * plan );
+
+/* prints the plan and the reasons to stderr */
+rc_t at_print_plan( const at_input_t * input, const at_plan_t * plan );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -34,6 +34,10 @@
 #include "inspector.h"      /* inspector_path_to_vpath */
 #endif
 
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
 #ifndef _h_klib_num_gen_
 #include <klib/num-gen.h>
 #endif
@@ -77,6 +81,8 @@ bool cmn_iter_populate_params( cmn_iter_params_t * params,
         params -> cursor_cache = cursor_cache;
         params -> first_row = first_row;
         params -> row_count = row_count;
+        params -> next_range = NULL;
+        params -> next_range_ctx = NULL;
         res = true;
     }
     return res;
@@ -88,6 +94,9 @@ typedef struct cmn_iter_t {
     const struct num_gen_iter * row_iter;
     uint64_t row_count;
     int64_t first_row, row_id;
+    cmn_iter_next_range_t next_range;
+    void * next_range_ctx;
+    tele_acc_t tele;            /* telemetry.h, rows and bytes read from the cursor */
 } cmn_iter_t;
 
 /* ------------------------------------------------------------------------------------------------------- */
@@ -174,6 +183,7 @@ static rc_t cmn_iter_release_curs( const VCursor * curs, rc_t rc, const char * f
 
 void cmn_iter_release( cmn_iter_t * self ) {
     if ( NULL != self ) {
+        tele_acc_flush( &( self -> tele ) ); /* telemetry.c */
         if ( NULL != self -> row_iter ) {
             num_gen_iterator_destroy( self -> row_iter );
         }
@@ -265,6 +275,8 @@ rc_t cmn_iter_make( const cmn_iter_params_t * cp, const char * tblname, cmn_iter
                     i -> cursor = cur;
                     i -> first_row = cp -> first_row;
                     i -> row_count = cp -> row_count;
+                    i -> next_range = cp -> next_range;
+                    i -> next_range_ctx = cp -> next_range_ctx;
                     *iter = i;
                 }
             } else {
@@ -360,8 +372,26 @@ rc_t cmn_iter_add_column( struct cmn_iter_t * self, const char * name, uint32_t
 }
 
 bool cmn_iter_get_next( struct cmn_iter_t * self, rc_t * rc ) {
+    bool res;
     if ( NULL == self ) { return false; }
-    return num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+    res = num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+    /* the current range is exhausted: ask for the next one, if there is a callback for that */
+    while ( !res && 0 == *rc && NULL != self -> next_range ) {
+        int64_t first_row;
+        uint64_t row_count;
+        if ( !self -> next_range( self -> next_range_ctx, &first_row, &row_count, rc ) ) {
+            break;
+        }
+        *rc = cmn_iter_set_range( self, first_row, row_count ); /* above */
+        if ( 0 == *rc ) {
+            res = num_gen_iterator_next( self -> row_iter, &self -> row_id, rc );
+        }
+    }
+    if ( res ) {
+        self -> tele . rows++;
+        tele_acc_check( &( self -> tele ) ); /* telemetry.c */
+    }
+    return res;
 }
 
 int64_t cmn_iter_get_row_id( const struct cmn_iter_t * self ) {
@@ -420,10 +450,20 @@ rc_t cmn_iter_detect_range( struct cmn_iter_t * self, uint32_t col_id ) {
     return rc;
 }
 
+/* every cell read goes through here: count the bytes for the telemetry */
+static rc_t cmn_iter_cell_data( struct cmn_iter_t * self, uint32_t col_id, uint32_t * elem_bits,
+                                const void ** base, uint32_t * boff, uint32_t * row_len ) {
+    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, elem_bits, base, boff, row_len );
+    if ( 0 == rc ) {
+        self -> tele . bytes_read += ( ( uint64_t )( *elem_bits ) * ( *row_len ) ) >> 3;
+    }
+    return rc;
+}
+
 rc_t cmn_iter_read_uint64( struct cmn_iter_t * self, uint32_t col_id, uint64_t *value ) {
     uint32_t elem_bits, boff, row_len;
     const uint64_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint64( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -444,7 +484,7 @@ rc_t cmn_iter_read_uint64_array( struct cmn_iter_t * self, uint32_t col_id, uint
                             uint32_t num_values, uint32_t * values_read ) {
     uint32_t elem_bits, boff, row_len;
     const uint64_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint64_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -466,7 +506,7 @@ rc_t cmn_iter_read_uint64_array( struct cmn_iter_t * self, uint32_t col_id, uint
 rc_t cmn_iter_read_uint32( struct cmn_iter_t * self, uint32_t col_id, uint32_t *value ) {
     uint32_t elem_bits, boff, row_len;
     const uint32_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint32( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -487,7 +527,7 @@ rc_t cmn_iter_read_uint32( struct cmn_iter_t * self, uint32_t col_id, uint32_t *
 rc_t cmn_iter_read_uint32_array( struct cmn_iter_t * self, uint32_t col_id, uint32_t ** values,
                             uint32_t * values_read ) {
     uint32_t elem_bits, boff, row_len;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)values, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint32_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -505,7 +545,7 @@ rc_t cmn_iter_read_uint32_array( struct cmn_iter_t * self, uint32_t col_id, uint
 rc_t cmn_iter_read_uint8( struct cmn_iter_t * self, uint32_t col_id, uint8_t *value ) {
     uint32_t elem_bits, boff, row_len;
     const uint8_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                      (const void **)&value_ptr, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint8( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -526,7 +566,7 @@ rc_t cmn_iter_read_uint8( struct cmn_iter_t * self, uint32_t col_id, uint8_t *va
 rc_t cmn_iter_read_uint8_array( struct cmn_iter_t * self, uint32_t col_id, uint8_t ** values,
                             uint32_t * values_read ) {
     uint32_t elem_bits, boff, row_len;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)values, &boff, &row_len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_uint8_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -541,7 +581,7 @@ rc_t cmn_iter_read_uint8_array( struct cmn_iter_t * self, uint32_t col_id, uint8
 
 rc_t cmn_iter_read_String( struct cmn_iter_t * self, uint32_t col_id, String * value ) {
     uint32_t elem_bits, boff;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_iter_cell_data( self, col_id, &elem_bits,
                                  (const void **)&value->addr, &boff, &value -> len );
     if ( 0 != rc ) {
         ErrMsg( "cmn_iter.c cmn_read_String( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
@@ -43,6 +43,10 @@ extern "C" {
 #include "helper.h"
 #endif
 
+/* optional: called by cmn_iter_get_next() when the current range of rows is exhausted,
+   returns true and a new range to continue with, or false if there is nothing more to do */
+typedef bool ( CC * cmn_iter_next_range_t )( void * ctx, int64_t * first_row, uint64_t * row_count, rc_t * rc );
+
 typedef struct cmn_iter_params_t
 {
     const KDirectory * dir;
@@ -52,6 +56,8 @@ typedef struct cmn_iter_params_t
     size_t cursor_cache;
     int64_t first_row;
     uint64_t row_count;
+    cmn_iter_next_range_t next_range;   /* NULL: iterate only over first_row/row_count */
+    void * next_range_ctx;
 } cmn_iter_params_t;
 
 bool cmn_iter_populate_params( cmn_iter_params_t * params,
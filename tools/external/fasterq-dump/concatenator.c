@@ -38,6 +38,10 @@
 #include "copy_machine.h"
 #endif
 
+#ifndef _h_out_compress_
+#include "out_compress.h"
+#endif
+
 #ifndef _h_kfs_buffile_
 #include <kfs/buffile.h>
 #endif
@@ -157,7 +161,8 @@ rc_t concat_execute( KDirectory * dir,
                     size_t buf_size,
                     struct bg_progress_t * progress,
                     bool force,
-                    bool append ) {
+                    bool append,
+                    compress_t compress ) {
     uint32_t count;
     rc_t rc = VNameListCount( files, &count );
     if ( 0 != rc ) {
@@ -173,6 +178,9 @@ rc_t concat_execute( KDirectory * dir,
             rc = concat_execute_un_compressed_no_append( dir, output_filename, files,
                                 buf_size, progress, force, count, q_wait_time );
         }
+        if ( 0 == rc ) {
+            rc = ocmp_append_eof( compress, dir, output_filename ); /* out_compress.c */
+        }
     }
     return rc;
 }
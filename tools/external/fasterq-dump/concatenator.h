@@ -51,13 +51,16 @@ extern "C" {
 #include "progress_thread.h"
 #endif
 
+/* compress: the files are already compressed ( independent members/frames ),
+   they are concatenated as they are, only the end-of-file-marker is added */
 rc_t concat_execute( KDirectory * dir,
                     const char * output_filename,
                     const struct VNamelist * files,
                     size_t buf_size,
                     struct bg_progress_t * progress,
                     bool force,
-                    bool append );
+                    bool append,
+                    compress_t compress );
 
 #ifdef __cplusplus
 }
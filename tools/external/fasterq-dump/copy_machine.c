@@ -37,6 +37,10 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
 #ifndef _h_klib_time_
 #include <klib/time.h>
 #endif
@@ -155,7 +159,10 @@ static rc_t cm_copy_this_file( copy_machine_t * self, const struct KFile * src )
             ErrMsg( "copy_machine.c copy_this_file().TimeoutInit( %lu ms ) -> %R", self -> q_wait_time, rc );
         } else {
             copy_machine_block_t * block;
+            /* if there is no empty block, the writer-thread cannot keep up with the reader */
+            uint64_t wait_start = tele_clock(); /* telemetry.c */
             rc = KQueuePop ( self -> empty_q, ( void ** )&block, &tm );
+            tele_add_wait_since( wait_start ); /* telemetry.c */
             if ( 0 == rc ) {
                 block -> available = 0;
                 rc = KFileRead( src, src_pos, block -> buffer, self -> buf_size, &num_read );
@@ -166,7 +173,10 @@ static rc_t cm_copy_this_file( copy_machine_t * self, const struct KFile * src )
                     /* we have data for the writer-thread */
                     block -> available = num_read;
                     src_pos += num_read;
+                    tele_add_read( num_read ); /* telemetry.c */
+                    wait_start = tele_clock(); /* telemetry.c */
                     rc = cm_push2q ( self -> to_write_q, block, self -> q_wait_time );
+                    tele_add_wait_since( wait_start ); /* telemetry.c */
                 } else {
                     /* we are done with this file, put the block back... */
                     rc = cm_push2q ( self -> empty_q, block, self -> q_wait_time );
@@ -243,7 +253,9 @@ static rc_t CC cm_writer_thread( const KThread * thread, void *data ) {
             ErrMsg( "copy_machine.c copy_machine_writer_thread().TimeoutInit() -> %R", rc );
         } else {
             copy_machine_block_t * block;
+            uint64_t idle_start = tele_clock(); /* telemetry.c */
             rc = KQueuePop ( self -> to_write_q, ( void ** )&block, /*&tm*/ NULL );
+            tele_add_idle_since( idle_start ); /* telemetry.c */
             if ( 0 == rc ) {
                 /* we got a block to write out of the to_write_q */
                 size_t num_written;
@@ -252,6 +264,7 @@ static rc_t CC cm_writer_thread( const KThread * thread, void *data ) {
                 if ( 0 == rc ) {
                     /* increment the write - position */
                     self -> dst_pos += num_written;
+                    tele_add_written( num_written ); /* telemetry.c */
 
                     /* inform the background-process about it */
                     bg_progress_update( self -> progress, num_written ); /* progress_thread.c */
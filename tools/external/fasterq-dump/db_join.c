@@ -78,6 +78,7 @@ typedef struct dbj_cmn_t {
     struct bg_progress_t * progress;
     struct lookup_reader_t * lookup;        /* lookup_reader.h */
     struct index_reader_t * index;          /* index.h */
+    const struct mem_lookup_t * mem_lookup; /* mem_lookup.h */
     struct flp_t * flex_printer;            /* flex_printer.h */
     struct filter_2na_t * filter;           /* helper.h */
     SBuffer_t looked_up_bases_1;            /* helper.h */
@@ -105,9 +106,10 @@ static rc_t dbj_init_cmn_data( dbj_cmn_t * j,
                         struct filter_2na_t * filter,
                         const char * lookup_filename,
                         const char * index_filename,
+                        const struct mem_lookup_t * mem_lookup,
                         size_t buf_size,
                         bool cmp_read_present ) {
-    rc_t rc;
+    rc_t rc = 0;
 
     j -> accession_path  = cp -> accession_path;
     j -> accession_short = cp -> accession_short;
@@ -115,6 +117,8 @@ static rc_t dbj_init_cmn_data( dbj_cmn_t * j,
     j -> join_options = join_options;
     j -> progress = progress;
     j -> lookup = NULL;
+    j -> index = NULL;
+    j -> mem_lookup = mem_lookup;
     j -> flex_printer = flex_printer;
     j -> filter = filter;
     j -> looked_up_bases_1 . S . addr = NULL;
@@ -122,16 +126,17 @@ static rc_t dbj_init_cmn_data( dbj_cmn_t * j,
     j -> loop_nr = 0;
     j -> cmp_read_present = cmp_read_present;
 
-    if ( NULL != index_filename ) {
-        if ( ft_file_exists( cp -> dir, "%s", index_filename ) ) {
-            rc = make_index_reader( cp -> dir, &j -> index, buf_size, "%s", index_filename ); /* index.c */
+    /* with an in-memory lookup, there is no lookup-file and no index-file to open */
+    if ( NULL == mem_lookup ) {
+        if ( NULL != index_filename ) {
+            if ( ft_file_exists( cp -> dir, "%s", index_filename ) ) {
+                rc = make_index_reader( cp -> dir, &j -> index, buf_size, "%s", index_filename ); /* index.c */
+            }
         }
-    } else {
-        j -> index = NULL;
-    }
 
-    rc = make_lookup_reader( cp -> dir, j -> index, &( j -> lookup ), buf_size,
-                             "%s", lookup_filename ); /* lookup_reader.c */
+        rc = make_lookup_reader( cp -> dir, j -> index, &( j -> lookup ), buf_size,
+                                 "%s", lookup_filename ); /* lookup_reader.c */
+    }
     if ( 0 == rc ) {
         rc = make_SBuffer( &( j -> looked_up_bases_1 ), 4096 );  /* helper.c */
         if ( 0 != rc ) {
@@ -233,7 +238,12 @@ static rc_t dbj_print_data( struct flp_t * printer,
 
 static rc_t dbj_lookup1( dbj_cmn_t * j, const fq_seq_csra_rec_t * rec, const String ** res ) {
     bool reverse = dbj_is_reverse( rec, 0 );
-    rc_t rc = lookup_bases( j -> lookup, rec -> row_id, 1, &j -> looked_up_bases_1, reverse ); /* lookup_reader.c */
+    rc_t rc;
+    if ( NULL != j -> mem_lookup ) {
+        rc = memlkp_bases( j -> mem_lookup, rec -> row_id, 1, &j -> looked_up_bases_1, reverse ); /* mem_lookup.c */
+    } else {
+        rc = lookup_bases( j -> lookup, rec -> row_id, 1, &j -> looked_up_bases_1, reverse ); /* lookup_reader.c */
+    }
     if ( 0 == rc ) {
         *res = &( j -> looked_up_bases_1 . S );
     }
@@ -242,7 +252,12 @@ static rc_t dbj_lookup1( dbj_cmn_t * j, const fq_seq_csra_rec_t * rec, const Str
 
 static rc_t dbj_lookup2( dbj_cmn_t * j, const fq_seq_csra_rec_t * rec, const String ** res ) {
     bool reverse = dbj_is_reverse( rec, 1 );
-    rc_t rc = lookup_bases( j -> lookup, rec -> row_id, 2, &j -> looked_up_bases_2, reverse ); /* lookup_reader.c */
+    rc_t rc;
+    if ( NULL != j -> mem_lookup ) {
+        rc = memlkp_bases( j -> mem_lookup, rec -> row_id, 2, &j -> looked_up_bases_2, reverse ); /* mem_lookup.c */
+    } else {
+        rc = lookup_bases( j -> lookup, rec -> row_id, 2, &j -> looked_up_bases_2, reverse ); /* lookup_reader.c */
+    }
     if ( 0 == rc ) {
         *res = &( j -> looked_up_bases_2 . S );
     }
@@ -1454,11 +1469,13 @@ typedef struct dbj_thread_data_t {
     const char * accession_short;
     const char * lookup_filename;
     const char * index_filename;
+    const struct mem_lookup_t * mem_lookup;
     const char * seq_defline;
     const char * qual_defline;
     struct bg_progress_t * progress;
     struct temp_registry_t * registry;
     struct filter_2na_t * filter;
+    struct dout_t * dout;
 
     KThread * thread;
 
@@ -1468,6 +1485,7 @@ typedef struct dbj_thread_data_t {
     size_t cur_cache;
     size_t buf_size;
     format_t fmt;
+    compress_t compress;
     uint32_t thread_id;
     bool cmp_read_present;
 
@@ -1481,20 +1499,39 @@ static rc_t CC dbj_sorted_thread( const KThread * self, void * data ) {
     const join_options_t * jo = jtd -> join_options;
     struct filter_2na_t * filter = hlp_make_2na_filter( jo -> filter_bases ); /* helper.c */
     struct flp_t * flex_printer = NULL;
-    flp_args_t file_args;
-    
-    flp_initialize_args( &file_args,
-                         jtd -> dir,
-                         jtd -> registry,
-                         jtd -> part_file,
-                         jtd -> buf_size );
-    /* make_flex_printer() is in flex_printer.c */
-    flex_printer = flp_create_1( &file_args,
-                jtd -> accession_short,             /* we need that for the flexible defline! */
-                jtd -> seq_defline,                 /* the seq-defline */
-                jtd -> qual_defline,                /* the qual-defline */
-                hlp_is_format_fasta( jtd -> fmt ) );    /* fasta-mode */
-    if ( 0 == rc && NULL != flex_printer ) {
+    flp_args_t file_args;   /* referenced by the flex-printer, has to live as long as it */
+    int64_t first_row = jtd -> first_row;
+    uint64_t row_count = jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count;
+    bool has_rows = true;
+
+    if ( NULL != jtd -> dout ) {
+        /* direct-output: the rows are handed out in chunks, the output goes into the final files */
+        flex_printer = flp_create_3( jtd -> dout,
+                    jtd -> compress,
+                    jtd -> accession_short,
+                    jtd -> seq_defline,
+                    jtd -> qual_defline,
+                    hlp_is_format_fasta( jtd -> fmt ) ); /* flex_printer.c */
+        if ( NULL == flex_printer ) {
+            dout_abort( jtd -> dout ); /* direct_out.c */
+        } else {
+            has_rows = flp_first_chunk( flex_printer, &first_row, &row_count ); /* flex_printer.c */
+        }
+    } else {
+        flp_initialize_args( &file_args,
+                             jtd -> dir,
+                             jtd -> registry,
+                             jtd -> part_file,
+                             jtd -> buf_size,
+                             jtd -> compress );
+        /* make_flex_printer() is in flex_printer.c */
+        flex_printer = flp_create_1( &file_args,
+                    jtd -> accession_short,             /* we need that for the flexible defline! */
+                    jtd -> seq_defline,                 /* the seq-defline */
+                    jtd -> qual_defline,                /* the qual-defline */
+                    hlp_is_format_fasta( jtd -> fmt ) );    /* fasta-mode */
+    }
+    if ( 0 == rc && NULL != flex_printer && has_rows ) {
         dbj_cmn_t j;
         cmn_iter_params_t cp;
         cmn_iter_populate_params( &cp,
@@ -1503,8 +1540,13 @@ static rc_t CC dbj_sorted_thread( const KThread * self, void * data ) {
                                   jtd -> accession_short,
                                   jtd -> accession_path,
                                   jtd -> cur_cache,
-                                  jtd -> first_row,
-                                  jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count );
+                                  first_row,
+                                  row_count );
+        if ( NULL != jtd -> dout ) {
+            /* the iterator continues with the next chunk when the current one is done */
+            cp . next_range = flp_next_chunk; /* flex_printer.c */
+            cp . next_range_ctx = flex_printer;
+        }
         rc = dbj_init_cmn_data( &j,
                         &jtd -> stats,
                         jtd -> join_options,
@@ -1514,6 +1556,7 @@ static rc_t CC dbj_sorted_thread( const KThread * self, void * data ) {
                         filter,
                         jtd -> lookup_filename,
                         jtd -> index_filename,
+                        jtd -> mem_lookup,
                         jtd -> buf_size,
                         jtd -> cmp_read_present );
         if ( 0 == rc ) {
@@ -1538,8 +1581,9 @@ static rc_t CC dbj_sorted_thread( const KThread * self, void * data ) {
             }
             dbj_release_cmn_data( &j );
         }
-        flp_release( flex_printer ); /* flex_printer.c */
+        rc = flp_finish( flex_printer, rc ); /* flex_printer.c */
     }
+    flp_release( flex_printer ); /* flex_printer.c ( ignores NULL ) */
     hlp_release_2na_filter( filter );   /* helper.c */
     return rc;
 }
@@ -1588,7 +1632,8 @@ rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args )
 
         if ( 0 == rc && seq_row_count > 0 ) {
             Vector threads;
-            int64_t row = 1;
+            int64_t row = args -> insp_output -> seq . first_row;
+            int64_t end_row = row + seq_row_count;
             uint64_t rows_per_thread;
             uint32_t thread_id;
             uint32_t num_threads2 = args -> num_threads;
@@ -1608,7 +1653,7 @@ rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args )
                 rc = bg_progress_make( &progress, seq_row_count, 0, 0 ); /* progress_thread.c */
             }
 
-            for ( thread_id = 0; 0 == rc && thread_id < num_threads2; ++thread_id ) {
+            for ( thread_id = 0; 0 == rc && thread_id < num_threads2 && row < end_row; ++thread_id ) {
                 dbj_thread_data_t * jtd = calloc( 1, sizeof * jtd );
                 if ( NULL == jtd ) {
                     rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
@@ -1619,15 +1664,18 @@ rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args )
                     jtd -> accession_short  = args -> accession_short;
                     jtd -> lookup_filename  = args -> lookup_filename;
                     jtd -> index_filename   = args -> index_filename;
+                    jtd -> mem_lookup       = args -> mem_lookup;
                     jtd -> seq_defline      = args -> seq_defline;
                     jtd -> qual_defline     = args -> qual_defline;
                     jtd -> first_row        = row;
-                    jtd -> row_count        = rows_per_thread;
+                    jtd -> row_count        = hlp_rows_of_thread( row, rows_per_thread, end_row ); /* helper.c */
                     jtd -> row_limit        = args -> row_limit;
                     jtd -> cur_cache        = args -> cursor_cache;
                     jtd -> buf_size         = args -> buf_size;
                     jtd -> progress         = progress;
                     jtd -> registry         = args -> registry;
+                    jtd -> dout             = args -> dout;
+                    jtd -> compress         = args -> compress;
                     jtd -> fmt              = args -> fmt;
                     jtd -> join_options     = &corrected_join_options;
                     jtd -> thread_id        = thread_id;
@@ -2075,7 +2123,8 @@ rc_t dbj_create_unsorted_fasta( const dbj_unsorted_fasta_args_t * args ) {
                     args -> buf_size,
                     0,                          /* q_wait_time, if 0 --> use default = 5 ms */
                     args -> num_threads * 3,    /* q_num_blocks, if 0 use default = 8 */
-                    0 );                        /* q_block_size, if 0 use default = 4 MB */
+                    0,                          /* q_block_size, if 0 use default = 4 MB */
+                    args -> compress );         /* compressed by the producing threads */
             if ( NULL != multi_writer ) {
                 struct bg_progress_t * progress = NULL;
                 struct filter_2na_t * filter = hlp_make_2na_filter( args -> join_options -> filter_bases ); /* helper.c */
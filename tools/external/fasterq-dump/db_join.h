@@ -59,6 +59,14 @@ extern "C" {
 #include "inspector.h"
 #endif
 
+#ifndef _h_mem_lookup_
+#include "mem_lookup.h"
+#endif
+
+#ifndef _h_direct_out_
+#include "direct_out.h"
+#endif
+
 typedef struct dbj_sorted_fastq_fasta_args_t {
     KDirectory * dir;
     const VDBManager * vdb_mgr;
@@ -68,17 +76,20 @@ typedef struct dbj_sorted_fastq_fasta_args_t {
     const char * qual_defline;          /* NULL for default */
     const char * lookup_filename;
     const char * index_filename;
+    const struct mem_lookup_t * mem_lookup; /* mem_lookup.h, if not NULL: lookup/index-file are not used */
     join_stats_t * stats;                   /* helper.h */
     const join_options_t * join_options;    /* helper.h */
     const insp_output_t * insp_output; /* inspector.h */
     const struct temp_dir_t * temp_dir;
     struct temp_registry_t * registry;
+    struct dout_t * dout;                   /* direct_out.h, if not NULL: no temp-files, registry is not used */
     size_t cursor_cache;
     size_t buf_size;
     uint32_t num_threads;
     uint64_t row_limit;
     bool show_progress;
     format_t fmt;
+    compress_t compress;                    /* helper.h, compress the output-blocks */
 } dbj_sorted_fastq_fasta_args_t;
 
 rc_t dbj_create_sorted_fastq_fasta( const dbj_sorted_fastq_fasta_args_t * args );
@@ -102,6 +113,7 @@ typedef struct dbj_unsorted_fasta_args_t {
     bool force;                             /* overwrite output-file if it exists */
     bool only_unaligned;                    /* process only un-aligned reads */
     bool only_aligned;                      /* process only aligned reads */
+    compress_t compress;                    /* helper.h, compress the output-blocks */
 } dbj_unsorted_fasta_args_t;
 
 rc_t dbj_create_unsorted_fasta( const dbj_unsorted_fasta_args_t * args );
@@ -30,6 +30,12 @@
 #include <klib/text.h>
 #endif
 
+#ifndef _h_helper_
+#include "helper.h"     /* hlp_u64_to_dec() */
+#endif
+
+#include <string.h>     /* strcmp(), strstr() */
+
 static const char * DSD_FASTQ_USE_NAME_RDID = "@$ac.$si/$ri $sn length=$rl";
 static const char * DSD_FASTQ_SYN_NAME_RDID = "@$ac.$si/$ri $si length=$rl";
 static const char * DSD_FASTQ_NO_NAME_RDID  = "@$ac.$si/$ri length=$rl";
@@ -92,6 +98,120 @@ const char * dflt_qual_defline( bool has_name, bool use_name, bool use_read_id )
     return NULL;
 }
 
+/* ------------------------------------------------------------------------------------------- */
+
+static bool dflt_same( const char * a, const char * b ) {
+    return ( NULL != a && NULL != b && 0 == strcmp( a, b ) );
+}
+
+bool dflt_match_emitter( dflt_emitter_t * self, const char * seq_defline, const char * qual_defline, bool fasta ) {
+    uint32_t i;
+    if ( NULL == self || NULL == seq_defline ) { return false; }
+    /* try all combinations of has_name / use_name / use_read_id */
+    for ( i = 0; i < 8; ++i ) {
+        bool has_name = ( 0 != ( i & 1 ) );
+        bool use_name = ( 0 != ( i & 2 ) );
+        bool use_read_id = ( 0 != ( i & 4 ) );
+        if ( dflt_same( seq_defline, dflt_seq_defline( has_name, use_name, use_read_id, fasta ) ) &&
+             ( fasta || dflt_same( qual_defline, dflt_qual_defline( has_name, use_name, use_read_id ) ) ) ) {
+            self -> fasta = fasta;
+            self -> use_read_id = use_read_id;
+            self -> name_mode = has_name ? ( use_name ? dnm_use_name : dnm_syn_name ) : dnm_no_name;
+            return true;
+        }
+    }
+    return false;
+}
+
+static char * dflt_emit_String( char * dst, const String * src ) {
+    if ( NULL != src && NULL != src -> addr ) {
+        memcpy( dst, src -> addr, src -> len );
+        dst += src -> len;
+    }
+    return dst;
+}
+
+/* "$ac.$si/$ri $sn length=$rl" without the leading '@', '>' or '+' */
+static char * dflt_emit_defline_body( const dflt_emitter_t * self, char * dst,
+                                      const String * accession, int64_t row_id, uint32_t read_id,
+                                      const String * spotname, uint64_t read_len ) {
+    dst = dflt_emit_String( dst, accession );
+    *dst++ = '.';
+    dst += hlp_u64_to_dec( dst, ( uint64_t )row_id ); /* helper.c */
+    if ( self -> use_read_id ) {
+        *dst++ = '/';
+        dst += hlp_u64_to_dec( dst, read_id ); /* helper.c */
+    }
+    switch( self -> name_mode ) {
+        case dnm_no_name  : break;
+        case dnm_use_name : *dst++ = ' ';
+                            /* the spot-id is the alternative for a missing name */
+                            if ( NULL != spotname && NULL != spotname -> addr && spotname -> len > 0 ) {
+                                dst = dflt_emit_String( dst, spotname );
+                            } else {
+                                dst += hlp_u64_to_dec( dst, ( uint64_t )row_id ); /* helper.c */
+                            }
+                            break;
+        case dnm_syn_name : *dst++ = ' ';
+                            dst += hlp_u64_to_dec( dst, ( uint64_t )row_id ); /* helper.c */
+                            break;
+    }
+    memcpy( dst, " length=", 8 );
+    dst += 8;
+    dst += hlp_u64_to_dec( dst, read_len ); /* helper.c */
+    return dst;
+}
+
+static size_t dflt_len( const String * S ) {
+    return ( NULL != S && NULL != S -> addr ) ? S -> len : 0;
+}
+
+rc_t dflt_emit( const dflt_emitter_t * self, SBuffer_t * dst,
+                const String * accession, int64_t row_id, uint32_t read_id,
+                const String * spotname, const String * read1, const String * read2,
+                const String * quality ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == dst ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+    } else {
+        uint64_t read_len = ( ( NULL != read1 ) ? read1 -> len : 0 ) + ( ( NULL != read2 ) ? read2 -> len : 0 );
+        size_t name_len = dflt_len( spotname );
+        size_t body_max = dflt_len( accession ) + 1 + ( 3 * HLP_MAX_DEC_DIGITS ) + 2 + 8 +
+                          ( name_len > HLP_MAX_DEC_DIGITS ? name_len : HLP_MAX_DEC_DIGITS );
+        size_t needed = 2 * ( body_max + 2 ) + dflt_len( read1 ) + dflt_len( read2 ) + dflt_len( quality ) + 4;
+        if ( dst -> buffer_size < needed ) {
+            rc = increase_SBuffer_to( dst, needed ); /* sbuffer.c */
+        }
+        if ( 0 == rc ) {
+            char * start = ( char * )dst -> S . addr;
+            char * p = start;
+            char * body;
+            size_t body_len;
+
+            *p++ = self -> fasta ? '>' : '@';
+            body = p;
+            p = dflt_emit_defline_body( self, p, accession, row_id, read_id, spotname, read_len );
+            body_len = p - body;
+            *p++ = '\n';
+            p = dflt_emit_String( p, read1 );
+            p = dflt_emit_String( p, read2 );
+            *p++ = '\n';
+            if ( !self -> fasta ) {
+                /* the quality-defline is the same as the sequence-defline */
+                *p++ = '+';
+                memmove( p, body, body_len );
+                p += body_len;
+                *p++ = '\n';
+                p = dflt_emit_String( p, quality );
+                *p++ = '\n';
+            }
+            dst -> S . len = ( uint32_t )( p - start );
+            dst -> S . size = dst -> S . len;
+        }
+    }
+    return rc;
+}
+
 /* ------------------------------------------------------------------------------------------- */
 static uint32_t var_in_line( const char * defline, const char * var ) {
     uint32_t res = 0;
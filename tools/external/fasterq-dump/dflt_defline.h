@@ -35,11 +35,45 @@
 extern "C" {
 #endif
 
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+#ifndef _h_sbuffer_
+#include "sbuffer.h"
+#endif
+
 const char * dflt_seq_defline( bool has_name, bool use_name, bool use_read_id, bool fasta );
 const char * dflt_qual_defline( bool has_name, bool use_name, bool use_read_id );
 
 /* ------------------------------------------------------------------------------------------- */
 
+/* the default deflines above are known up front: instead of interpreting them via var_fmt.c
+   a specialized emitter writes the whole record ( FASTA or FASTQ ), the output is identical */
+
+typedef enum dflt_name_mode_t { dnm_no_name = 0, dnm_use_name, dnm_syn_name } dflt_name_mode_t;
+
+typedef struct dflt_emitter_t {
+    bool fasta;
+    bool use_read_id;
+    dflt_name_mode_t name_mode;
+} dflt_emitter_t;
+
+/* returns true if seq_defline/qual_defline are one of the default-pairs above */
+bool dflt_match_emitter( dflt_emitter_t * self, const char * seq_defline, const char * qual_defline, bool fasta );
+
+/* writes a whole record into dst ( read2 and quality can be NULL ) */
+rc_t dflt_emit( const dflt_emitter_t * self, SBuffer_t * dst,
+                const String * accession, int64_t row_id, uint32_t read_id,
+                const String * spotname, const String * read1, const String * read2,
+                const String * quality );
+
+/* ------------------------------------------------------------------------------------------- */
+
 bool spot_group_requested( const char * seq_defline, const char * qual_defline );
 bool read_id_requested( const char * seq_defline, const char * qual_defline );
 bool spot_name_requested( const char * seq_defline, const char * qual_defline );
@@ -0,0 +1,368 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "direct_out.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_file_tools_
+#include "file_tools.h"
+#endif
+
+#ifndef _h_sbuffer_
+#include "sbuffer.h"
+#endif
+
+#ifndef _h_out_compress_
+#include "out_compress.h"
+#endif
+
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+#ifndef _h_kproc_cond_
+#include <kproc/cond.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+typedef struct dout_file_t {
+    struct KFile * f;
+    uint64_t pos;               /* the next offset to be reserved */
+} dout_file_t;
+
+typedef struct dout_t {
+    KDirectory * dir;
+    const char * output_base;
+    KLock * lock;
+    KCondition * cond;          /* signaled each time a chunk has been committed */
+    Vector files;               /* dout_file_t, indexed by dst_id, created on demand */
+    int64_t first_row;
+    uint64_t row_count;
+    uint64_t chunk_rows;
+    uint64_t num_chunks;
+    uint64_t next_chunk;        /* the next chunk to be handed out */
+    uint64_t next_commit;       /* the chunk whose turn it is to reserve offsets */
+    uint64_t bytes_written;
+    compress_t compress;
+    bool force;
+    bool append;
+    bool aborted;
+} dout_t;
+
+/* the reservation made for one buffer of a chunk: written outside the lock */
+typedef struct dout_reservation_t {
+    const SBuffer_t * buffer;
+    dout_file_t * file;
+    uint64_t pos;
+} dout_reservation_t;
+
+static void CC dout_release_file( void * item, void * data ) {
+    if ( NULL != item ) {
+        dout_file_t * file = item;
+        rc_t * rc = data;
+        rc_t rc2 = ft_release_file( file -> f, "dout_release()" ); /* file_tools.c */
+        if ( 0 == *rc ) { *rc = rc2; }
+        free( item );
+    }
+}
+
+/* all chunks are written: terminate the compressed files */
+static rc_t dout_write_eof( dout_t * self ) {
+    rc_t rc = 0;
+    uint32_t idx;
+    uint32_t start = VectorStart( &( self -> files ) );
+    uint32_t end = start + VectorLength( &( self -> files ) );
+    for ( idx = start; 0 == rc && idx < end; ++idx ) {
+        dout_file_t * file = VectorGet( &( self -> files ), idx );
+        if ( NULL != file ) {
+            uint64_t written;
+            rc = ocmp_write_eof( self -> compress, file -> f, file -> pos, &written ); /* out_compress.c */
+            file -> pos += written;
+            self -> bytes_written += written;
+        }
+    }
+    return rc;
+}
+
+rc_t dout_release( dout_t * self ) {
+    rc_t rc = 0;
+    if ( NULL != self ) {
+        if ( !self -> aborted && ct_none != self -> compress ) {
+            rc = dout_write_eof( self ); /* above */
+        }
+        VectorWhack( &( self -> files ), dout_release_file, &rc );
+        if ( NULL != self -> cond ) { KConditionRelease( self -> cond ); }
+        if ( NULL != self -> lock ) { KLockRelease( self -> lock ); }
+        free( ( void * ) self );
+    }
+    return rc;
+}
+
+rc_t dout_create( dout_t ** self, KDirectory * dir, const char * output_base,
+                  int64_t first_row, uint64_t row_count, uint64_t chunk_rows,
+                  bool force, bool append, compress_t compress ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == dir || NULL == output_base || 0 == chunk_rows ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "direct_out.c dout_create() -> %R", rc );
+    } else {
+        dout_t * o = calloc( 1, sizeof * o );
+        *self = NULL;
+        if ( NULL == o ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "direct_out.c dout_create().calloc( %d ) -> %R", ( sizeof * o ), rc );
+        } else {
+            VectorInit( &( o -> files ), 0, 4 );
+            o -> dir = dir;
+            o -> output_base = output_base;
+            o -> first_row = first_row;
+            o -> row_count = row_count;
+            o -> chunk_rows = chunk_rows;
+            o -> num_chunks = ( row_count + chunk_rows - 1 ) / chunk_rows;
+            o -> force = force;
+            o -> append = append;
+            o -> compress = compress;
+            rc = KLockMake( &( o -> lock ) );
+            if ( 0 != rc ) {
+                ErrMsg( "direct_out.c dout_create().KLockMake() -> %R", rc );
+            } else {
+                rc = KConditionMake( &( o -> cond ) );
+                if ( 0 != rc ) {
+                    ErrMsg( "direct_out.c dout_create().KConditionMake() -> %R", rc );
+                }
+            }
+            if ( 0 == rc ) {
+                *self = o;
+            } else {
+                dout_release( o );
+            }
+        }
+    }
+    return rc;
+}
+
+uint64_t dout_calc_chunk_rows( uint64_t row_count, size_t estimated_output_size ) {
+    uint64_t res = row_count;
+    if ( row_count > 0 && estimated_output_size > 0 ) {
+        uint64_t bytes_per_row = estimated_output_size / row_count;
+        if ( 0 == bytes_per_row ) { bytes_per_row = 1; }
+        res = DOUT_DFLT_CHUNK_BYTES / bytes_per_row;
+    }
+    if ( 0 == res ) { res = 1; }
+    return res;
+}
+
+bool dout_next_chunk( dout_t * self, uint64_t * chunk_id, int64_t * first_row, uint64_t * row_count ) {
+    bool res = false;
+    if ( NULL != self && NULL != chunk_id && NULL != first_row && NULL != row_count ) {
+        rc_t rc = KLockAcquire( self -> lock );
+        if ( 0 != rc ) {
+            ErrMsg( "direct_out.c dout_next_chunk().KLockAcquire() -> %R", rc );
+        } else {
+            if ( !self -> aborted && self -> next_chunk < self -> num_chunks ) {
+                uint64_t ofs = self -> next_chunk * self -> chunk_rows;
+                *chunk_id = self -> next_chunk++;
+                *first_row = self -> first_row + ofs;
+                *row_count = self -> row_count - ofs;
+                if ( *row_count > self -> chunk_rows ) { *row_count = self -> chunk_rows; }
+                res = true;
+            }
+            KLockUnlock( self -> lock );
+        }
+    }
+    return res;
+}
+
+/* called with the lock held */
+static rc_t dout_get_file( dout_t * self, uint32_t dst_id, dout_file_t ** file ) {
+    rc_t rc = 0;
+    dout_file_t * res = VectorGet( &( self -> files ), dst_id );
+    if ( NULL == res ) {
+        SBuffer_t s_filename;
+        rc = split_filename_insert_idx( &s_filename, 4096, self -> output_base, dst_id ); /* sbuffer.c */
+        if ( 0 == rc ) {
+            const char * filename = s_filename . S . addr;
+            bool exists = ft_file_exists( self -> dir, "%s", filename ); /* file_tools.c */
+            struct KFile * f = NULL;
+            uint64_t pos = 0;
+            if ( exists && self -> append ) {
+                rc = KDirectoryFileSize( self -> dir, &pos, "%s", filename );
+                if ( 0 != rc ) {
+                    ErrMsg( "direct_out.c dout_get_file().KDirectoryFileSize( '%s' ) -> %R", filename, rc );
+                } else {
+                    rc = KDirectoryOpenFileWrite( self -> dir, &f, true, "%s", filename );
+                    if ( 0 != rc ) {
+                        ErrMsg( "direct_out.c dout_get_file().KDirectoryOpenFileWrite( '%s' ) -> %R", filename, rc );
+                    }
+                }
+            } else if ( exists && !self -> force ) {
+                rc = RC( rcExe, rcFile, rcPacking, rcName, rcExists );
+                ErrMsg( "direct_out.c creating ouput-file '%s' -> %R", filename, rc );
+            } else {
+                rc = KDirectoryCreateFile( self -> dir, &f, false, 0664, kcmInit | kcmParents, "%s", filename );
+                if ( 0 != rc ) {
+                    StdErrMsg( "\n\tError: fasterq-dump cannot create this file: '%s'\n", filename );
+                }
+            }
+            if ( 0 == rc ) {
+                res = calloc( 1, sizeof * res );
+                if ( NULL == res ) {
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                    ErrMsg( "direct_out.c dout_get_file().calloc( %d ) -> %R", ( sizeof * res ), rc );
+                    ft_release_file( f, "dout_get_file()" ); /* file_tools.c */
+                } else {
+                    res -> f = f;
+                    res -> pos = pos;
+                    rc = VectorSet( &( self -> files ), dst_id, res );
+                    if ( 0 != rc ) {
+                        ErrMsg( "direct_out.c dout_get_file().VectorSet( %u ) -> %R", dst_id, rc );
+                        dout_release_file( res, &rc );
+                        res = NULL;
+                    }
+                }
+            }
+            release_SBuffer( &s_filename ); /* sbuffer.c */
+        }
+    }
+    *file = res;
+    return rc;
+}
+
+/* called with the lock held: reserve space in the output-files for all non-empty buffers */
+static rc_t dout_reserve( dout_t * self, const Vector * buffers,
+                          dout_reservation_t * reservations, uint32_t * count ) {
+    rc_t rc = 0;
+    uint32_t idx, n = 0;
+    uint32_t start = VectorStart( buffers );
+    uint32_t end = start + VectorLength( buffers );
+    for ( idx = start; 0 == rc && idx < end; ++idx ) {
+        const SBuffer_t * buffer = VectorGet( buffers, idx );
+        if ( NULL != buffer && buffer -> S . len > 0 ) {
+            dout_file_t * file;
+            rc = dout_get_file( self, idx, &file ); /* above */
+            if ( 0 == rc ) {
+                reservations[ n ] . buffer = buffer;
+                reservations[ n ] . file = file;
+                reservations[ n ] . pos = file -> pos;
+                file -> pos += buffer -> S . len;
+                self -> bytes_written += buffer -> S . len;
+                n++;
+            }
+        }
+    }
+    *count = n;
+    return rc;
+}
+
+rc_t dout_commit_chunk( dout_t * self, uint64_t chunk_id, const Vector * buffers ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == buffers ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+        ErrMsg( "direct_out.c dout_commit_chunk() -> %R", rc );
+    } else {
+        dout_reservation_t * reservations = calloc( VectorLength( buffers ) + 1, sizeof * reservations );
+        uint32_t count = 0;
+        if ( NULL == reservations ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+            ErrMsg( "direct_out.c dout_commit_chunk().calloc() -> %R", rc );
+        } else {
+            rc = KLockAcquire( self -> lock );
+            if ( 0 != rc ) {
+                ErrMsg( "direct_out.c dout_commit_chunk().KLockAcquire() -> %R", rc );
+            } else {
+                /* wait for our turn: all chunks before this one must have reserved their space */
+                uint64_t wait_start = tele_clock(); /* telemetry.c */
+                while ( 0 == rc && !self -> aborted && self -> next_commit != chunk_id ) {
+                    rc = KConditionWait( self -> cond, self -> lock );
+                }
+                tele_add_wait_since( wait_start ); /* telemetry.c */
+                if ( 0 == rc && self -> aborted ) {
+                    rc = SILENT_RC( rcVDB, rcNoTarg, rcWriting, rcTransfer, rcCanceled );
+                }
+                if ( 0 == rc ) {
+                    rc = dout_reserve( self, buffers, reservations, &count ); /* above */
+                }
+                if ( 0 == rc ) {
+                    self -> next_commit++;
+                } else {
+                    self -> aborted = true;
+                }
+                KConditionBroadcast( self -> cond );
+                KLockUnlock( self -> lock );
+            }
+
+            /* the offsets are reserved: write outside of the lock, in parallel with the other threads */
+            if ( 0 == rc ) {
+                uint32_t idx;
+                for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+                    const SBuffer_t * buffer = reservations[ idx ] . buffer;
+                    size_t num_writ;
+                    rc = KFileWriteAll( reservations[ idx ] . file -> f, reservations[ idx ] . pos,
+                                        buffer -> S . addr, buffer -> S . len, &num_writ );
+                    if ( 0 != rc ) {
+                        ErrMsg( "direct_out.c dout_commit_chunk().KFileWriteAll( %lu bytes at %lu ) -> %R",
+                                buffer -> S . len, reservations[ idx ] . pos, rc );
+                    } else if ( num_writ != buffer -> S . len ) {
+                        rc = RC( rcVDB, rcNoTarg, rcWriting, rcTransfer, rcIncomplete );
+                        ErrMsg( "direct_out.c dout_commit_chunk().KFileWriteAll( %lu bytes at %lu ) -> %R",
+                                buffer -> S . len, reservations[ idx ] . pos, rc );
+                    } else {
+                        tele_add_written( num_writ ); /* telemetry.c */
+                    }
+                }
+                if ( 0 != rc ) { dout_abort( self ); }
+            }
+            free( ( void * ) reservations );
+        }
+    }
+    return rc;
+}
+
+void dout_abort( dout_t * self ) {
+    if ( NULL != self ) {
+        rc_t rc = KLockAcquire( self -> lock );
+        if ( 0 == rc ) {
+            self -> aborted = true;
+            KConditionBroadcast( self -> cond );
+            KLockUnlock( self -> lock );
+        }
+    }
+}
+
+/* only valid after all threads are done */
+uint64_t dout_bytes_written( const dout_t * self ) {
+    return ( NULL == self ) ? 0 : self -> bytes_written;
+}
@@ -0,0 +1,91 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_direct_out_
+#define _h_direct_out_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_vector_
+#include <klib/vector.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"     /* compress_t */
+#endif
+
+/* ----------------------------------------------------------------------------------------------
+    direct output: instead of each thread writing its own temp-file and concatenating them
+    at the end, the rows are cut into chunks. The threads pick up chunks, produce the output
+    of a chunk in memory and then reserve the file-offsets for it. The reservation happens
+    strictly in chunk-order ( = row-order ), the writing itself happens in parallel.
+    The output is the same as with temp-files + concatenation.
+   ---------------------------------------------------------------------------------------------- */
+
+/* how much output ( in bytes ) a chunk should produce */
+#define DOUT_DFLT_CHUNK_BYTES ( 8 * 1024 * 1024 )
+
+struct dout_t;
+
+/* output_base: the final output-filename, the dst_id is inserted like in temp_registry_merge()
+   compress: the chunks arrive compressed, the files have to be terminated on release */
+rc_t dout_create( struct dout_t ** self, KDirectory * dir, const char * output_base,
+                  int64_t first_row, uint64_t row_count, uint64_t chunk_rows,
+                  bool force, bool append, compress_t compress );
+
+/* closes the output-files ( and writes the end-of-file-marker if compressed ) */
+rc_t dout_release( struct dout_t * self );
+
+/* how many rows per chunk, to produce about DOUT_DFLT_CHUNK_BYTES per chunk */
+uint64_t dout_calc_chunk_rows( uint64_t row_count, size_t estimated_output_size );
+
+/* hand out the next chunk, returns false if there are no more chunks ( or if aborted ) */
+bool dout_next_chunk( struct dout_t * self, uint64_t * chunk_id, int64_t * first_row, uint64_t * row_count );
+
+/* buffers: SBuffer_t-pointers, indexed by dst_id ( can be NULL or empty )
+   blocks until all previous chunks have been committed, then writes the buffers */
+rc_t dout_commit_chunk( struct dout_t * self, uint64_t chunk_id, const Vector * buffers );
+
+/* a thread failed: wake up all threads waiting for their turn, they will fail too */
+void dout_abort( struct dout_t * self );
+
+uint64_t dout_bytes_written( const struct dout_t * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
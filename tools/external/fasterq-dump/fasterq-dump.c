@@ -60,6 +60,22 @@
 #include "ref_inventory.h"
 #endif
 
+#ifndef _h_out_compress_
+#include "out_compress.h"
+#endif
+
+#ifndef _h_shard_
+#include "shard.h"
+#endif
+
+#ifndef _h_spill_io_
+#include "spill_io.h"
+#endif
+
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
 #ifndef _h_kapp_args_
 #include <kapp/args.h>
 #endif
@@ -111,6 +127,36 @@ static const char * mem_usage[] = { "memory limit for sorting dflt=100MB", NULL
 #define OPTION_MEM      "mem"
 #define ALIAS_MEM       "m"
 
+static const char * mem_lookup_usage[] = { "keep lookup-table in memory, if it fits into --mem", NULL };
+#define OPTION_MEM_LOOKUP "mem-lookup"
+
+static const char * direct_write_usage[] = { "write directly into the output-files, no temp-files for the output", NULL };
+#define OPTION_DIRECT_WRITE "direct-write"
+
+static const char * compress_usage[] = { "compress the output: gzip ( BGZF-blocks ) or zstd, dflt=none", NULL };
+#define OPTION_COMPRESS "compress"
+
+static const char * shard_usage[] = { "extract only shard i of N ( i/N ) into a shard-directory", NULL };
+#define OPTION_SHARD "shard"
+
+static const char * rows_usage[] = { "extract only these rows ( first-last ) into a shard-directory", NULL };
+#define OPTION_ROWS "rows"
+
+static const char * merge_shards_usage[] = { "merge the shard-directories given as parameters", NULL };
+#define OPTION_MERGE_SHARDS "merge-shards"
+
+static const char * stats_json_usage[] = { "write time/throughput per stage as JSON into this file ( - for stderr )", NULL };
+#define OPTION_STATS_JSON "stats-json"
+
+static const char * stats_interval_usage[] = { "print a progress-line ( JSON ) to stderr every N seconds", NULL };
+#define OPTION_STATS_INTERVAL "stats-interval"
+
+static const char * spill_io_usage[] = { "how the lookup-files are written and read: buffered or direct ( O_DIRECT, async ), dflt=buffered", NULL };
+#define OPTION_SPILL_IO "spill-io"
+
+static const char * auto_tune_usage[] = { "pick threads, memory, lookup- and output-strategy and buffer-sizes from the accession and the machine", NULL };
+#define OPTION_AUTO_TUNE "auto-tune"
+
 static const char * temp_usage[] = { "where to put temp. files dflt=curr dir", NULL };
 #define OPTION_TEMP     "temp"
 #define ALIAS_TEMP      "t"
@@ -249,6 +295,16 @@ OptDef ToolOptions[] = {
     { OPTION_BUFSIZE,       ALIAS_BUFSIZE,      NULL, bufsize_usage,        1, true,   false },
     { OPTION_CURCACHE,      ALIAS_CURCACHE,     NULL, curcache_usage,       1, true,   false },
     { OPTION_MEM,           ALIAS_MEM,          NULL, mem_usage,            1, true,   false },
+    { OPTION_MEM_LOOKUP,    NULL,               NULL, mem_lookup_usage,     1, false,  false },
+    { OPTION_DIRECT_WRITE,  NULL,               NULL, direct_write_usage,   1, false,  false },
+    { OPTION_COMPRESS,      NULL,               NULL, compress_usage,       1, true,   false },
+    { OPTION_SHARD,         NULL,               NULL, shard_usage,          1, true,   false },
+    { OPTION_ROWS,          NULL,               NULL, rows_usage,           1, true,   false },
+    { OPTION_MERGE_SHARDS,  NULL,               NULL, merge_shards_usage,   1, false,  false },
+    { OPTION_STATS_JSON,    NULL,               NULL, stats_json_usage,     1, true,   false },
+    { OPTION_STATS_INTERVAL,NULL,               NULL, stats_interval_usage, 1, true,   false },
+    { OPTION_SPILL_IO,      NULL,               NULL, spill_io_usage,       1, true,   false },
+    { OPTION_AUTO_TUNE,     NULL,               NULL, auto_tune_usage,      1, false,  false },
     { OPTION_TEMP,          ALIAS_TEMP,         NULL, temp_usage,           1, true,   false },
     { OPTION_THREADS,       ALIAS_THREADS,      NULL, threads_usage,        1, true,   false },
     { OPTION_PROGRESS,      ALIAS_PROGRESS,     NULL, progress_usage,       1, false,  false },
@@ -298,7 +354,8 @@ rc_t CC UsageSummary( const char * progname ) {
                      "Usage:\n"
                      "  %s <path> [options]\n"
                      "  %s <accession> [options]\n"
-                     "\n", progname, progname );
+                     "  %s --merge-shards <shard-dir> ... [options]\n"
+                     "\n", progname, progname, progname );
 }
 
 /* ----------------------------------------------------------------------------------- */
@@ -380,10 +437,22 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
     tool_ctx -> output_dirname = ahlp_get_str_option( args, OPTION_OUTPUT_D, NULL );
     tool_ctx -> buf_size = ahlp_get_size_t_option( args, OPTION_BUFSIZE, DFLT_BUF_SIZE );
     tool_ctx -> mem_limit = ahlp_get_size_t_option( args, OPTION_MEM, DFLT_MEM_LIMIT );
+    tool_ctx -> use_mem_lookup = ahlp_get_bool_option( args, OPTION_MEM_LOOKUP );
+    tool_ctx -> direct_write = ahlp_get_bool_option( args, OPTION_DIRECT_WRITE );
     tool_ctx -> row_limit = ahlp_get_uint64_t_option( args, OPTION_ROW_LIMIT, 0 );
     tool_ctx -> disk_limit_out_cmdl = ahlp_get_size_t_option( args, OPTION_DISK_LIMIT_OUT, 0 );
     tool_ctx -> disk_limit_tmp_cmdl = ahlp_get_size_t_option( args, OPTION_DISK_LIMIT_TMP, 0 );
     tool_ctx -> num_threads = ahlp_get_uint32_t_option( args, OPTION_THREADS, DFLT_NUM_THREADS );
+    tool_ctx -> auto_tune = ahlp_get_bool_option( args, OPTION_AUTO_TUNE );
+
+    /* --auto-tune does not touch what is given on the commandline ( bool-option: given at least once ) */
+    tool_ctx -> at_given . num_threads = ahlp_get_bool_option( args, OPTION_THREADS );
+    tool_ctx -> at_given . mem_limit = ahlp_get_bool_option( args, OPTION_MEM );
+    tool_ctx -> at_given . buf_size = ahlp_get_bool_option( args, OPTION_BUFSIZE );
+    tool_ctx -> at_given . cursor_cache = ahlp_get_bool_option( args, OPTION_CURCACHE );
+    tool_ctx -> at_given . mem_lookup = tool_ctx -> use_mem_lookup;
+    tool_ctx -> at_given . direct_write = tool_ctx -> direct_write;
+    tool_ctx -> at_given . spill_io = ahlp_get_bool_option( args, OPTION_SPILL_IO );
 
     /* join_options_t is defined in helper.h */
     tool_ctx -> join_options . rowid_as_name = false;
@@ -407,6 +476,8 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
     tool_ctx -> use_name = ahlp_get_bool_option( args, OPTION_USE_NAME );
     tool_ctx -> keep_tmp_files = ahlp_get_bool_option( args, OPTION_KEEP );
     tool_ctx -> stop_after_step = ahlp_get_uint32_t_option( args, OPTION_STEP, 0 );
+    tool_ctx -> stats_json = ahlp_get_str_option( args, OPTION_STATS_JSON, NULL );
+    tool_ctx -> stats_interval = ahlp_get_uint32_t_option( args, OPTION_STATS_INTERVAL, 0 );
 
     if ( 0 == rc && NULL != tool_ctx -> ref_name_filter ) {
         rc = ahlp_get_list_option( args, OPTION_REF_NAME, tool_ctx -> ref_name_filter );
@@ -452,6 +523,36 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
         ErrMsg( "invalid check-mode -> %R", rc );
     }
 
+    tool_ctx -> compress = hlp_get_compress_t( ahlp_get_str_option( args, OPTION_COMPRESS, NULL ) );
+    if ( 0 == rc && ct_unknown == tool_ctx -> compress ) {
+        rc = RC( rcExe, rcFile, rcPacking, rcName, rcUnknown  );
+        ErrMsg( "invalid compression -> %R", rc );
+    }
+    if ( 0 == rc && !ocmp_available( tool_ctx -> compress ) ) { /* out_compress.c */
+        rc = RC( rcExe, rcFile, rcPacking, rcFormat, rcUnsupported );
+        ErrMsg( "compression '%s' is not supported by this build -> %R",
+                hlp_compress_2_string( tool_ctx -> compress ), rc );
+    }
+
+    tool_ctx -> spill_io = spill_io_get_mode( ahlp_get_str_option( args, OPTION_SPILL_IO, NULL ) ); /* spill_io.c */
+    if ( 0 == rc && sio_unknown == tool_ctx -> spill_io ) {
+        rc = RC( rcExe, rcFile, rcPacking, rcName, rcUnknown  );
+        ErrMsg( "invalid spill-io mode -> %R", rc );
+    }
+
+    {
+        const char * shard = ahlp_get_str_option( args, OPTION_SHARD, NULL );
+        const char * rows = ahlp_get_str_option( args, OPTION_ROWS, NULL );
+        if ( 0 == rc && NULL != shard && NULL != rows ) {
+            rc = RC( rcExe, rcFile, rcPacking, rcName, rcInvalid );
+            ErrMsg( "shard and rows exclude each other -> %R", rc );
+        } else if ( 0 == rc && NULL != shard ) {
+            rc = shard_parse_idx( &( tool_ctx -> shard ), shard ); /* shard.c */
+        } else if ( 0 == rc && NULL != rows ) {
+            rc = shard_parse_rows( &( tool_ctx -> shard ), rows ); /* shard.c */
+        }
+    }
+
     tool_ctx -> requested_seq_tbl_name = ahlp_get_str_option( args, OPTION_TABLE, NULL );
     tool_ctx -> append = ahlp_get_bool_option( args, OPTION_APPEND );
     tool_ctx -> use_stdout = ahlp_get_bool_option( args, OPTION_STDOUT );
@@ -482,6 +583,84 @@ static rc_t main_get_user_input( tool_ctx_t * tool_ctx, const Args * args ) {
 
 static const uint32_t queue_timeout = 200;  /* ms */
 
+/* --------------------------------------------------------------------------------------------
+    produce the lookup-table in memory ( --mem-lookup ):
+   --------------------------------------------------------------------------------------------
+    the same producer-threads as below, but instead of KVector's pushed into the
+    background-mergers the packed reads go into one in-memory lookup, indexed by the key.
+    nothing is written to the temp-directory and nothing has to be merge-sorted.
+    if the lookup does not fit into the memory-limit ( estimated before, or exceeded while
+    producing it ), *mem_lookup stays NULL and the caller falls back to the lookup-files.
+-------------------------------------------------------------------------------------------- */
+static rc_t main_produce_mem_lookup( const tool_ctx_t * tool_ctx, struct mem_lookup_t ** mem_lookup ) {
+    rc_t rc = 0;
+    const insp_output_t * insp = &( tool_ctx -> insp_output );
+    size_t estimate = memlkp_estimate( insp -> seq . first_row + insp -> seq . row_count,
+                                       insp -> align . row_count,
+                                       insp -> align . total_base_count,
+                                       tool_ctx -> num_threads ); /* mem_lookup.c */
+    *mem_lookup = NULL;
+    if ( estimate > tool_ctx -> mem_lookup_limit ) {
+        if ( tool_ctx -> show_details ) {
+            KOutMsg( "mem-lookup : estimated %,lu bytes > mem-limit of %,lu bytes, using lookup-files\n",
+                     estimate, tool_ctx -> mem_lookup_limit );
+        }
+    } else {
+        struct mem_lookup_t * m = NULL;
+        rc = memlkp_make( &m, insp -> seq . first_row + insp -> seq . row_count,
+                          tool_ctx -> mem_lookup_limit ); /* mem_lookup.c */
+        if ( 0 == rc ) {
+            lookup_production_args_t args;
+
+            args . dir = tool_ctx -> dir;
+            args . vdb_mgr = tool_ctx -> vdb_mgr;
+            args . accession_short = tool_ctx -> accession_short;
+            args . accession_path = tool_ctx -> accession_path;
+            args . merger = NULL;
+            args . mem_lookup = m;
+            args . align_row_count = insp -> align . row_count;
+            args . seq_first_row = insp -> seq . first_row;
+            args . seq_row_count = tool_ctx -> shard . requested ? insp -> seq . row_count : 0;
+            args . cursor_cache = tool_ctx -> cursor_cache;
+            args . buf_size = tool_ctx -> buf_size;
+            args . mem_limit = tool_ctx -> mem_limit;
+            args . num_threads = tool_ctx -> num_threads;
+            args . show_progress = tool_ctx -> show_progress;
+            args . keep_tmp_files = tool_ctx -> keep_tmp_files;
+
+            tele_stage_begin( ts_lookup ); /* telemetry.c */
+            rc = execute_lookup_production( &args ); /* sorter.c */
+            tele_stage_end( ts_lookup ); /* telemetry.c */
+            if ( 0 == rc ) {
+                *mem_lookup = m;
+            } else if ( memlkp_overflowed( m ) ) { /* mem_lookup.c */
+                /* not an error: fall back to the lookup-files */
+                rc = 0;
+            }
+        } else if ( memlkp_is_overflow_rc( rc ) ) { /* mem_lookup.c */
+            /* the slots alone do not fit, fall back to the lookup-files */
+            rc = 0;
+        }
+
+        if ( NULL == *mem_lookup ) {
+            if ( 0 == rc && tool_ctx -> show_details ) {
+                KOutMsg( "mem-lookup : mem-limit of %,lu bytes exceeded, using lookup-files\n",
+                         tool_ctx -> mem_lookup_limit );
+            }
+            memlkp_release( m ); /* mem_lookup.c ( ignores NULL ) */
+        } else if ( tool_ctx -> show_details ) {
+            /* the lookup-file would have been written twice: as sub-files by the vector-merger
+               and as the final lookup-file by the file-merger, and read back each time */
+            uint64_t file_bytes = memlkp_lookup_file_bytes( m ); /* mem_lookup.c */
+            KOutMsg( "mem-lookup : %,lu entries in %,lu bytes\n",
+                     memlkp_entries( m ), memlkp_bytes_used( m ) );
+            KOutMsg( "scratch avoided : %,lu bytes written, %,lu bytes read\n",
+                     file_bytes * 2, file_bytes * 2 );
+        }
+    }
+    return rc;
+}
+
 static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
     rc_t rc = 0;
     struct bg_update_t * gap = NULL;                    /* merge_sorter.h */
@@ -555,7 +734,10 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         args . accession_short = tool_ctx -> accession_short;
         args . accession_path = tool_ctx -> accession_path;
         args . merger = bg_vec_merger;
+        args . mem_lookup = NULL;
         args . align_row_count = align_row_count;
+        args . seq_first_row = tool_ctx -> insp_output . seq . first_row;
+        args . seq_row_count = tool_ctx -> shard . requested ? tool_ctx -> insp_output . seq . row_count : 0;
         args . cursor_cache = tool_ctx -> cursor_cache;
         args . buf_size = tool_ctx -> buf_size;
         args . mem_limit = tool_ctx -> mem_limit;
@@ -563,12 +745,15 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
         args . show_progress = tool_ctx -> show_progress;
         args . keep_tmp_files = tool_ctx -> keep_tmp_files;
 
+        tele_stage_begin( ts_lookup ); /* telemetry.c */
         rc = execute_lookup_production( &args ); /* sorter.c */
+        tele_stage_end( ts_lookup ); /* telemetry.c */
     }
 
     if ( 1 == tool_ctx -> stop_after_step ) { return rc; }
 
     bg_update_start( gap, "merge  : " ); /* progress_thread.c ...start showing the activity... */
+    tele_stage_begin( ts_merge ); /* telemetry.c */
 
     if ( 0 == rc ) {
         rc = wait_for_and_release_background_vector_merger( bg_vec_merger ); /* merge_sorter.c */
@@ -581,6 +766,7 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
     }
 
     bg_update_release( gap );
+    tele_stage_end( ts_merge ); /* telemetry.c */
 
     if ( 0 == rc ) {
         if ( tool_ctx -> show_details ) {
@@ -597,14 +783,60 @@ static rc_t main_produce_lookup_files( const tool_ctx_t * tool_ctx ) {
 
 /* -------------------------------------------------------------------------------------------- */
 
-static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
+/* in direct-write-mode the join-threads write into the final output-files,
+   there are no temp-files to be concatenated at the end */
+static rc_t main_make_direct_out( const tool_ctx_t * tool_ctx, struct dout_t ** dout ) {
+    rc_t rc = 0;
+    *dout = NULL;
+    if ( tool_ctx -> direct_write ) {
+        uint64_t row_count = tool_ctx -> insp_output . seq . row_count;
+        uint64_t chunk_rows = dout_calc_chunk_rows( row_count,
+                                                    tool_ctx -> estimated_output_size ); /* direct_out.c */
+        rc = dout_create( dout,
+                          tool_ctx -> dir,
+                          tool_ctx -> output_filename,
+                          tool_ctx -> insp_output . seq . first_row,
+                          row_count,
+                          chunk_rows,
+                          tool_ctx -> force,
+                          tool_ctx -> append,
+                          tool_ctx -> compress ); /* direct_out.c */
+        if ( 0 == rc && tool_ctx -> show_details ) {
+            KOutHandlerSetStdErr();
+            KOutMsg( "direct-write : %,lu rows per chunk\n", chunk_rows );
+            KOutHandlerSetStdOut();
+        }
+    }
+    return rc;
+}
+
+static rc_t main_release_direct_out( const tool_ctx_t * tool_ctx, struct dout_t * dout, rc_t rc ) {
+    if ( NULL != dout ) {
+        rc_t rc2;
+        if ( 0 == rc && tool_ctx -> show_details ) {
+            KOutHandlerSetStdErr();
+            KOutMsg( "direct-write : %,lu bytes written\n", dout_bytes_written( dout ) ); /* direct_out.c */
+            KOutHandlerSetStdOut();
+        }
+        rc2 = dout_release( dout ); /* direct_out.c */
+        if ( 0 == rc ) { rc = rc2; }
+    }
+    return rc;
+}
+
+static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx,
+                                         const struct mem_lookup_t * mem_lookup ) {
     struct temp_registry_t * registry = NULL; /* temp_registry.h */
+    struct dout_t * dout = NULL; /* direct_out.h */
     join_stats_t stats; /* helper.h */
     dbj_sorted_fastq_fasta_args_t args; /* join.h */
 
     rc_t rc = make_temp_registry( &registry,
                                   tool_ctx -> cleanup_task,
                                   tool_ctx -> keep_tmp_files ); /* temp_registry.c */
+    if ( 0 == rc ) {
+        rc = main_make_direct_out( tool_ctx, &dout ); /* above */
+    }
 
     hlp_clear_join_stats( &stats );
     /* join SEQUENCE-table with lookup-table === this is the actual purpos of the tool === */
@@ -626,20 +858,25 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
     args . qual_defline = tool_ctx -> qual_defline;
     args . lookup_filename = &( tool_ctx -> lookup_filename[ 0 ] );
     args . index_filename = &( tool_ctx -> index_filename[ 0 ] );
+    args . mem_lookup = mem_lookup;
     args . stats = &stats;
     args . insp_output = &( tool_ctx -> insp_output );
     args . join_options = &( tool_ctx -> join_options );
     args . temp_dir = tool_ctx -> temp_dir;
     args . registry= registry;
+    args . dout = dout;
     args . cursor_cache = tool_ctx -> cursor_cache;
     args . buf_size = tool_ctx -> buf_size;
     args . num_threads = tool_ctx -> num_threads;
     args . row_limit = tool_ctx -> row_limit;
     args . show_progress = tool_ctx -> show_progress;
     args . fmt = tool_ctx -> fmt;
+    args . compress = tool_ctx -> compress;
 
     if ( rc == 0 ) {
+        tele_stage_begin( ts_join ); /* telemetry.c */
         rc = dbj_create_sorted_fastq_fasta( &args );
+        tele_stage_end( ts_join ); /* telemetry.c */
     }
 
     /* from now on we do not need the lookup-file and it's index any more... */
@@ -651,8 +888,11 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
         KDirectoryRemove( tool_ctx -> dir, true, "%s", &tool_ctx -> index_filename[ 0 ] );
     }
 
-    /* STEP 4 : concatenate output-chunks */
-    if ( 0 == rc ) {
+    /* STEP 4 : concatenate output-chunks ( not in direct-write-mode, the output is already in place ) */
+    tele_stage_begin( ts_concat ); /* telemetry.c */
+    if ( NULL != dout ) {
+        rc = main_release_direct_out( tool_ctx, dout, rc ); /* above */
+    } else if ( 0 == rc ) {
         if ( tool_ctx -> use_stdout ) {
             rc = temp_registry_to_stdout( registry,
                                           tool_ctx -> dir,
@@ -665,10 +905,13 @@ static rc_t main_produce_final_db_output( const tool_ctx_t * tool_ctx ) {
                               tool_ctx -> buf_size,
                               tool_ctx -> show_progress,
                               tool_ctx -> force,
-                              tool_ctx -> append ); /* temp_registry.c */
+                              tool_ctx -> append,
+                              tool_ctx -> compress ); /* temp_registry.c */
         }
     }
 
+    tele_stage_end( ts_concat ); /* telemetry.c */
+
     /* in case some of the partial results have not been deleted be the concatenator */
     if ( NULL != registry ) {
         destroy_temp_registry( registry ); /* temp_registry.c */
@@ -704,8 +947,11 @@ static rc_t main_process_csra_fasta_unsorted( const tool_ctx_t * tool_ctx ) {
     args . force = tool_ctx -> force;
     args . only_unaligned = tool_ctx -> only_unaligned;
     args . only_aligned = tool_ctx -> only_aligned;
+    args . compress = tool_ctx -> compress;
 
+    tele_stage_begin( ts_join ); /* telemetry.c */
     rc = dbj_create_unsorted_fasta( &args );
+    tele_stage_end( ts_join ); /* telemetry.c */
 
     hlp_print_stats( &stats, rc );
 
@@ -720,8 +966,22 @@ static rc_t main_process_csra_fasta_concat( const tool_ctx_t * tool_ctx ) {
     >>>>> cSRA <<<<<
    ============================================================================================ */
 
+/* the lookup-files are written and read back through spill_io.c only while they are produced,
+   the join reads the final lookup-file randomly through a KBufFile */
+static rc_t main_produce_lookup_files_spill( const tool_ctx_t * tool_ctx ) {
+    rc_t rc = spill_io_init( tool_ctx -> spill_io, tool_ctx -> buf_size, SPILL_IO_DFLT_DEPTH ); /* spill_io.c */
+    if ( 0 == rc ) {
+        if ( tool_ctx -> show_details && spill_io_direct() ) {
+            KOutMsg( "spill-io : direct ( %s )\n", spill_io_backend() ); /* spill_io.c */
+        }
+        rc = main_produce_lookup_files( tool_ctx );
+    }
+    spill_io_release(); /* spill_io.c */
+    return rc;
+}
+
 static rc_t main_process_csra( const tool_ctx_t * tool_ctx ) {
-    rc_t rc;
+    rc_t rc = 0;
 
     switch ( tool_ctx -> fmt ) { /* fmt defined in helper.h */
         case ft_fasta_us_split_spot : rc = main_process_csra_fasta_unsorted( tool_ctx ); break;
@@ -729,10 +989,17 @@ static rc_t main_process_csra( const tool_ctx_t * tool_ctx ) {
         case ft_fasta_ref_tbl : rc = ref_inventory_print( tool_ctx ); break;
         case ft_ref_report : rc = ref_inventory_print_report( tool_ctx ); break;
         default : {
-            rc = main_produce_lookup_files( tool_ctx );
+            struct mem_lookup_t * mem_lookup = NULL; /* mem_lookup.h */
+            if ( tool_ctx -> use_mem_lookup ) {
+                rc = main_produce_mem_lookup( tool_ctx, &mem_lookup );
+            }
+            if ( 0 == rc && NULL == mem_lookup ) {
+                rc = main_produce_lookup_files_spill( tool_ctx );
+            }
             if ( 0 == rc && 0 == tool_ctx -> stop_after_step ) {
-                rc = main_produce_final_db_output( tool_ctx );
+                rc = main_produce_final_db_output( tool_ctx, mem_lookup );
             }
+            memlkp_release( mem_lookup ); /* mem_lookup.c ( ignores NULL ) */
         }
     }
     return rc;
@@ -744,12 +1011,16 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
     rc_t rc = 0;
     join_stats_t stats; /* helper.h */
     struct temp_registry_t * registry = NULL;   /* temp_registry.h */
+    struct dout_t * dout = NULL; /* direct_out.h */
 
     hlp_clear_join_stats( &stats ); /* helper.c */
 
     rc = make_temp_registry( &registry,
                              tool_ctx -> cleanup_task,
                              tool_ctx -> keep_tmp_files ); /* temp_registry.c */
+    if ( 0 == rc ) {
+        rc = main_make_direct_out( tool_ctx, &dout ); /* above */
+    }
 
     if ( 0 == rc ) {
 
@@ -767,17 +1038,24 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
         args . join_options = &( tool_ctx -> join_options );
         args . temp_dir = tool_ctx -> temp_dir;
         args . registry = registry;
+        args . dout = dout;
         args . cursor_cache = tool_ctx -> cursor_cache;
         args . buf_size = tool_ctx -> buf_size;
         args . num_threads = tool_ctx -> num_threads;
         args . show_progress = tool_ctx -> show_progress;
         args . fmt = tool_ctx -> fmt;
+        args . compress = tool_ctx -> compress;
         args . row_limit = tool_ctx -> row_limit;
 
+        tele_stage_begin( ts_join ); /* telemetry.c */
         rc = execute_tbl_join( &args ); /* tbl_join.c */
+        tele_stage_end( ts_join ); /* telemetry.c */
     }
 
-    if ( 0 == rc ) {
+    tele_stage_begin( ts_concat ); /* telemetry.c */
+    if ( NULL != dout ) {
+        rc = main_release_direct_out( tool_ctx, dout, rc ); /* above */
+    } else if ( 0 == rc ) {
         if ( tool_ctx -> use_stdout ) {
             rc = temp_registry_to_stdout( registry,
                                         tool_ctx -> dir,
@@ -790,9 +1068,11 @@ static rc_t main_process_table_in_seq_order( const tool_ctx_t * tool_ctx, const
                             tool_ctx -> buf_size,
                             tool_ctx -> show_progress,
                             tool_ctx -> force,
-                            tool_ctx -> append ); /* temp_registry.c */
+                            tool_ctx -> append,
+                            tool_ctx -> compress ); /* temp_registry.c */
         }
     }
+    tele_stage_end( ts_concat ); /* telemetry.c */
 
     if ( NULL != registry ) {
         destroy_temp_registry( registry ); /* temp_registry.c */
@@ -826,8 +1106,11 @@ static rc_t main_process_table_fasta_unsorted( const tool_ctx_t * tool_ctx, cons
     args . show_progress = tool_ctx -> show_progress;
     args . force = tool_ctx -> force;
     args . row_limit = tool_ctx -> row_limit;
+    args . compress = tool_ctx -> compress;
 
+    tele_stage_begin( ts_join ); /* telemetry.c */
     rc = execute_unsorted_fasta_tbl_join( &args ); /* tbl_join.c */
+    tele_stage_end( ts_join ); /* telemetry.c */
 
     hlp_print_stats( &stats, rc );
 
@@ -866,6 +1149,112 @@ static rc_t main_process_table( const tool_ctx_t * tool_ctx, const char * tbl_na
     return rc;
 }
 
+/* ============================================================================================
+    >>>>> telemetry <<<<<
+   ============================================================================================ */
+
+static rc_t main_start_telemetry( const char * stats_json, uint32_t stats_interval ) {
+    rc_t rc = 0;
+    if ( NULL != stats_json || stats_interval > 0 ) {
+        rc = tele_start( stats_interval ); /* telemetry.c */
+    }
+    return rc;
+}
+
+static rc_t main_stop_telemetry( const char * stats_json, tele_report_args_t * args, rc_t rc ) {
+    if ( NULL != stats_json ) {
+        rc_t rc2;
+        args -> rc = rc;
+        rc2 = tele_write_report( stats_json, args ); /* telemetry.c */
+        if ( 0 == rc ) { rc = rc2; }
+    }
+    tele_stop(); /* telemetry.c */
+    return rc;
+}
+
+static rc_t main_stop_tool_telemetry( const tool_ctx_t * tool_ctx, rc_t rc ) {
+    tele_report_args_t args; /* telemetry.h */
+
+    args . accession = tool_ctx -> accession_short;
+    args . format = hlp_fmt_2_string( tool_ctx -> fmt );
+    args . num_threads = tool_ctx -> num_threads;
+    args . mem_limit = tool_ctx -> mem_limit;
+    args . buf_size = tool_ctx -> buf_size;
+    args . cursor_cache = tool_ctx -> cursor_cache;
+
+    return main_stop_telemetry( tool_ctx -> stats_json, &args, rc );
+}
+
+/* ============================================================================================
+    >>>>> shards <<<<<
+   ============================================================================================ */
+
+static rc_t main_write_shard_manifest( const tool_ctx_t * tool_ctx ) {
+    rc_t rc = 0;
+    if ( tool_ctx -> shard . requested && !tool_ctx -> use_stdout ) {
+        shard_manifest_args_t args; /* shard.h */
+
+        args . shard = &( tool_ctx -> shard );
+        args . shard_dir = tool_ctx -> shard_dir;
+        args . accession = tool_ctx -> accession_short;
+        args . format = hlp_fmt_2_string( tool_ctx -> fmt );
+        args . compress = hlp_compress_2_string( tool_ctx -> compress );
+
+        rc = shard_write_manifest( tool_ctx -> dir, &args ); /* shard.c */
+    }
+    return rc;
+}
+
+/* no accession: the parameters are the shard-directories to be merged */
+static rc_t main_merge_shards( const Args * args, uint32_t param_count ) {
+    KDirectory * dir;
+    rc_t rc = KDirectoryNativeDir( &dir );
+    if ( 0 != rc ) {
+        ErrMsg( "KDirectoryNativeDir() -> %R", rc );
+    } else {
+        VNamelist * shard_dirs;
+        rc = VNamelistMake( &shard_dirs, param_count );
+        if ( 0 != rc ) {
+            ErrMsg( "main_merge_shards . VNamelistMake() -> %R", rc );
+        } else {
+            uint32_t idx;
+            for ( idx = 0; 0 == rc && idx < param_count; ++idx ) {
+                const char * shard_dir;
+                rc = ArgsParamValue( args, idx, ( const void ** )&shard_dir );
+                if ( 0 == rc ) {
+                    rc = VNamelistAppend( shard_dirs, shard_dir );
+                }
+            }
+            if ( 0 == rc ) {
+                const char * stats_json = ahlp_get_str_option( args, OPTION_STATS_JSON, NULL );
+                size_t buf_size = ahlp_get_size_t_option( args, OPTION_BUFSIZE, DFLT_BUF_SIZE );
+                rc = main_start_telemetry( stats_json,
+                                           ahlp_get_uint32_t_option( args, OPTION_STATS_INTERVAL, 0 ) );
+                if ( 0 == rc ) {
+                    tele_report_args_t t_args; /* telemetry.h */
+
+                    tele_stage_begin( ts_concat ); /* telemetry.c */
+                    rc = shard_merge( dir,
+                                      shard_dirs,
+                                      ahlp_get_str_option( args, OPTION_OUTPUT_D, "." ),
+                                      buf_size,
+                                      ahlp_get_bool_option( args, OPTION_FORCE ),
+                                      ahlp_get_bool_option( args, OPTION_DETAILS ) ); /* shard.c */
+                    tele_stage_end( ts_concat ); /* telemetry.c */
+
+                    memset( &t_args, 0, sizeof t_args );
+                    t_args . format = "merge-shards";
+                    t_args . buf_size = buf_size;
+                    rc = main_stop_telemetry( stats_json, &t_args, rc );
+                }
+            }
+            VNamelistRelease( shard_dirs );
+        }
+        KDirectoryRelease( dir );
+    }
+    return rc;
+}
+
 /* ============================================================================================ */
 
 MAIN_DECL( argc, argv )
@@ -886,6 +1275,8 @@ MAIN_DECL( argc, argv )
         rc = ArgsParamCount( args, &param_count );
         if ( 0 != rc ) {
             ErrMsg( "ArgsParamCount() -> %R", rc );
+        } else if ( ahlp_get_bool_option( args, OPTION_MERGE_SHARDS ) ) {
+            rc = main_merge_shards( args, param_count );
         } else {
             /* in case we are given no or more than one accessions/files to process */
             if ( param_count == 0 || param_count > 1 ) {
@@ -898,8 +1289,13 @@ MAIN_DECL( argc, argv )
 
                 rc = main_get_user_input( &tool_ctx, args );
                 if ( 0 == rc ) {
+                    rc = main_start_telemetry( tool_ctx . stats_json, tool_ctx . stats_interval );
+                }
+                if ( 0 == rc ) {
+                    tele_stage_begin( ts_inspect ); /* telemetry.c */
                     rc = tctx_populate_and_call_inspector( &tool_ctx );
                     /* returns rc != 0 if inspection failed, because of check-mode */
+                    tele_stage_end( ts_inspect ); /* telemetry.c */
                 }
 
                 /* for safety: */
@@ -952,7 +1348,11 @@ MAIN_DECL( argc, argv )
                                               rc = 3; /* signal to main() that the accession is not-found/invalid */
                                               break;
                     }
+                    if ( 0 == rc ) {
+                        rc = main_write_shard_manifest( &tool_ctx );
+                    }
                 }
+                rc = main_stop_tool_telemetry( &tool_ctx, rc ); /* above */
                 rc = tctx_release( &tool_ctx, rc );
             }
         }
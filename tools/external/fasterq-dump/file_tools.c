@@ -247,6 +247,11 @@ rc_t ft_wrap_file_in_buffer( struct KFile ** f, size_t buffer_size, const char *
     return rc;
 }
 
+size_t ft_align_block_size( size_t size ) {
+    if ( size < FT_BLOCK_ALIGN ) { return FT_BLOCK_ALIGN; }
+    return ( ( size + FT_BLOCK_ALIGN - 1 ) / FT_BLOCK_ALIGN ) * FT_BLOCK_ALIGN;
+}
+
 static rc_t ft_available_space_dir_space( const KDirectory * dir, size_t * res ) {
     uint64_t free_space, total_space;
     rc_t rc = KDirectoryGetDiskFreeSpace( dir, &free_space, &total_space );
@@ -65,6 +65,11 @@ rc_t ft_make_buffered_for_read( KDirectory * dir, const struct KFile ** f,
 rc_t ft_release_file( const struct KFile * f, const char * err_msg, ... );
 rc_t ft_wrap_file_in_buffer( struct KFile ** f, size_t buffer_size, const char * err_msg );
 
+/* round a buffer-size up to a multiple of FT_BLOCK_ALIGN ( at least one block ),
+   whole pages for the page-cache, only O_DIRECT ( spill_io.c ) requires it */
+#define FT_BLOCK_ALIGN 4096
+size_t ft_align_block_size( size_t size );
+
 rc_t ft_available_space_disk_space( const KDirectory * dir, const char * path, size_t * res, bool is_file );
 
 #ifdef __cplusplus
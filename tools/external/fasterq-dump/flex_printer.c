@@ -48,26 +48,45 @@
 #include "var_fmt.h"
 #endif
 
+#ifndef _h_out_compress_
+#include "out_compress.h"
+#endif
+
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
 typedef struct fwrap_t {
     struct KFile * f;
     uint64_t file_pos;
+    SBuffer_t pending;      /* output waiting to be compressed ( used if compression is requested ) */
 } fwrap_t;
 
 void flp_initialize_args( flp_args_t * self,
                           KDirectory * dir,
                           struct temp_registry_t * registry,
                           const char * output_base,
-                          size_t buffer_size ) {
+                          size_t buffer_size,
+                          compress_t compress ) {
     self -> dir = dir;
     self -> registry = registry;
     self -> output_base = output_base;
     self -> buffer_size = buffer_size;
+    self -> compress = compress;
+}
+
+static void CC flp_release_chunk_buffer( void * item, void * data ) {
+    if ( NULL != item ) {
+        release_SBuffer( item ); /* sbuffer.c */
+        free( item );
+    }
 }
 
 static void CC flp_release_fwrap( void * item, void * data ) {
     if ( NULL != item ) {
         fwrap_t * p = item;
         if ( NULL != p -> f ) { ft_release_file( p -> f, "flp_release_fwrap()" ); }
+        release_SBuffer( &( p -> pending ) ); /* sbuffer.c ( ignores NULL-addr ) */
         free( item );
     }
 }
@@ -129,6 +148,12 @@ typedef struct flp_t {
     Vector printers;                        /* container for printers, one for each read-id ( used if registry is not NULL ) */
     struct multi_writer_t * multi_writer;   /* from copy-machine, multi-threaded common-file writer */
     struct multi_writer_block_t * block;    /* keep a block at hand... */
+    struct dout_t * dout;                   /* direct-output, common to all threads */
+    Vector chunk_buffers;                   /* SBuffer_t, one for each dst-id ( used if dout is not NULL ) */
+    uint64_t chunk_id;                      /* the chunk we are working on ( used if dout is not NULL ) */
+    bool chunk_open;                        /* flag if chunk_id has not been committed yet */
+    compress_t compress;                    /* helper.h, compress the output-blocks */
+    SBuffer_t packed;                       /* compressed output, reused for each block */
     SBuffer_t transaction_buffer;           /* used only if transaction used.. */
     bool fasta;                             /* flag if FASTA or FASTQ */
     bool in_transaction;                    /* flag if we are in a transaction */
@@ -136,6 +161,10 @@ typedef struct flp_t {
     struct vfmt_t * fmt_v2;                 /* var-printer for 2-READ-data */
     const String * string_data[ 8 ];        /* vector of strings, idx has to match var_desc_list */
     uint64_t int_data[ 4 ];                 /* vector of ints, idx has to match var_desc_list */
+    bool use_dflt;                          /* the deflines are the default ones: use dflt below */
+    dflt_emitter_t dflt;                    /* specialized emitter for the default deflines */
+    SBuffer_t dflt_buffer;                  /* output-buffer for the specialized emitter */
+    tele_acc_t tele;                        /* telemetry.h, bytes written by the file-wrappers */
 } flp_t;
 
 typedef enum string_data_index_t { sdi_acc = 0, sdi_sn = 1, sdi_sg = 2, sdi_rd1 = 3, sdi_rd2 = 4, sdi_qa = 5 } string_data_index_t;
@@ -143,7 +172,10 @@ typedef enum int_data_index_t { idi_si = 0, idi_ri = 1, idi_rl = 2 } int_data_in
 
 void flp_release( struct flp_t * self ) {
     if ( NULL != self ) {
+        tele_acc_flush( &( self -> tele ) ); /* telemetry.c */
         release_SBuffer( &( self -> transaction_buffer ) );
+        release_SBuffer( &( self -> dflt_buffer ) );
+        release_SBuffer( &( self -> packed ) );
         if ( NULL != self -> multi_writer && NULL != self -> block ) {
             if ( !mw_submit_block( self -> multi_writer, self -> block ) ) {
                 /* TBD: cannot submit last block to multi-writer */
@@ -151,6 +183,7 @@ void flp_release( struct flp_t * self ) {
             }
         }
         if ( NULL != self -> file_args ) {  VectorWhack ( &self -> printers, flp_release_fwrap, NULL ); }
+        if ( NULL != self -> dout ) { VectorWhack ( &self -> chunk_buffers, flp_release_chunk_buffer, NULL ); }
         if ( NULL != self -> string_data[ sdi_acc ] ) StringWhack( self -> string_data[ 0 ] );
         if ( NULL != self -> fmt_v1 ) { vfmt_release( self -> fmt_v1 ); }
         if ( NULL != self -> fmt_v2 ) { vfmt_release( self -> fmt_v2 ); }
@@ -253,6 +286,12 @@ static struct flp_t * flp_create_cmn( flp_t * self,
         lifetime of the flex-printer */
     self -> string_data[ sdi_acc ] = hlp_make_string_copy( accession );
 
+    /* the default deflines do not need to be interpreted by var_fmt.c for every record */
+    self -> use_dflt = dflt_match_emitter( &( self -> dflt ), seq_defline, qual_defline, fasta ); /* dflt_defline.c */
+    if ( self -> use_dflt ) {
+        if ( 0 != make_SBuffer( &( self -> dflt_buffer ), 4096 ) ) { self -> use_dflt = false; }
+    }
+
     /* construct the 2 flex-formats ( one with 1xREAD/1xQUAL, one with 2xREAD/2xQUAL ) */
     /* ------------------------------------------------------------------------------- */
     /* first create the variable-definitions ( and their indexes ) */
@@ -297,6 +336,7 @@ struct flp_t * flp_create_1( flp_args_t * args,
     self = calloc( 1, sizeof * self );
     if ( NULL != self ) {
         self -> file_args = args;
+        self -> compress = args -> compress;
         VectorInit ( &( self -> printers ), 0, 4 );
         self = flp_create_cmn( self, accession, seq_defline, qual_defline, fasta );
     }
@@ -318,6 +358,30 @@ struct flp_t * flp_create_2( struct multi_writer_t * multi_writer,
     self = calloc( 1, sizeof * self );
     if ( NULL != self ) {
         self -> multi_writer = multi_writer;
+        self -> compress = ct_none; /* the multi-writer compresses the blocks */
+        self = flp_create_cmn( self, accession, seq_defline, qual_defline, fasta );
+    }
+    return self;
+}
+
+struct flp_t * flp_create_3( struct dout_t * dout,
+                        compress_t compress,
+                        const char * accession,
+                        const char * seq_defline,
+                        const char * qual_defline,
+                        bool fasta ) {
+    flp_t * self = NULL;
+    if ( NULL == dout || NULL == seq_defline || NULL == accession ) {
+        return NULL;
+    }
+    if ( !fasta && NULL == qual_defline ) {
+        return NULL;
+    }
+    self = calloc( 1, sizeof * self );
+    if ( NULL != self ) {
+        self -> dout = dout;
+        self -> compress = compress;
+        VectorInit ( &( self -> chunk_buffers ), 0, 4 );
         self = flp_create_cmn( self, accession, seq_defline, qual_defline, fasta );
     }
     return self;
@@ -391,42 +455,203 @@ static rc_t flp_submit_to_buffer( struct flp_t * self, SBuffer_t * t ) {
     return rc;
 }
 
+/* produce the whole record into a buffer, either via the specialized emitter or via var_fmt.c */
+static SBuffer_t * flp_format( struct flp_t * self, const flp_data_t * data ) {
+    SBuffer_t * res = NULL;
+    if ( self -> use_dflt ) {
+        rc_t rc = dflt_emit( &( self -> dflt ), &( self -> dflt_buffer ),
+                             self -> string_data[ sdi_acc ], data -> row_id, data -> read_id,
+                             data -> spotname, data -> read1, data -> read2,
+                             self -> fasta ? NULL : data -> quality ); /* dflt_defline.c */
+        if ( 0 == rc ) { res = &( self -> dflt_buffer ); }
+    } else {
+        /* pick the right format, depending if data-read2 is NULL or not */
+        struct vfmt_t * fmt = flp_prepare_data( self, data ); /* above */
+        /* the return value is not allocated every-time, it is a reference to a buffer
+         * enclosed in fmt... */
+        res = vfmt_write_to_buffer( fmt,
+                                    self -> string_data, sdi_qa + 1,
+                                    self -> int_data, idi_rl + 1 ); /* var_fmt.c */
+    }
+    return res;
+}
+
+/* append to the in-memory buffer of the current chunk for this dst-id */
+static rc_t flp_append_to_chunk( struct flp_t * self, uint32_t dst_id, const SBuffer_t * t ) {
+    rc_t rc = 0;
+    SBuffer_t * b = VectorGet( &( self -> chunk_buffers ), dst_id );
+    if ( NULL == b ) {
+        b = calloc( 1, sizeof * b );
+        if ( NULL == b ) {
+            rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        } else {
+            /* grows to the size of a chunk, and is reused for the following chunks */
+            rc = make_SBuffer( b, 64 * 1024 ); /* sbuffer.c */
+            if ( 0 == rc ) {
+                rc = VectorSet( &( self -> chunk_buffers ), dst_id, b );
+            }
+            if ( 0 != rc ) { flp_release_chunk_buffer( b, NULL ); }
+        }
+        if ( 0 != rc ) {
+            ErrMsg( "flex_print() cannot create chunk-buffer #%u -> %R", dst_id, rc );
+        }
+    }
+    if ( 0 == rc ) {
+        rc = append_bytes_to_SBuffer( b, t -> S . addr, t -> S . len ); /* sbuffer.c */
+    }
+    return rc;
+}
+
+/* compress the buffer, the compressed data takes the place of the uncompressed data in b */
+static rc_t flp_compress_buffer( struct flp_t * self, SBuffer_t * b ) {
+    rc_t rc = ocmp_compress( self -> compress, b -> S . addr, b -> S . len, &( self -> packed ) ); /* out_compress.c */
+    if ( 0 == rc ) {
+        SBuffer_t tmp = *b;
+        *b = self -> packed;
+        self -> packed = tmp;
+    }
+    return rc;
+}
+
+static rc_t flp_commit_chunk( struct flp_t * self ) {
+    rc_t rc = 0;
+    if ( self -> chunk_open ) {
+        uint32_t idx;
+        uint32_t start = VectorStart( &( self -> chunk_buffers ) );
+        uint32_t end = start + VectorLength( &( self -> chunk_buffers ) );
+        if ( ct_none != self -> compress ) {
+            /* compress in this thread, before the chunk waits for its turn */
+            for ( idx = start; 0 == rc && idx < end; ++idx ) {
+                SBuffer_t * b = VectorGet( &( self -> chunk_buffers ), idx );
+                if ( NULL != b && b -> S . len > 0 ) { rc = flp_compress_buffer( self, b ); } /* above */
+            }
+        }
+        if ( 0 == rc ) {
+            rc = dout_commit_chunk( self -> dout, self -> chunk_id, &( self -> chunk_buffers ) ); /* direct_out.c */
+        }
+        /* the buffers can be reused for the next chunk */
+        for ( idx = start; idx < end; ++idx ) {
+            SBuffer_t * b = VectorGet( &( self -> chunk_buffers ), idx );
+            if ( NULL != b ) { clear_SBuffer( b ); } /* sbuffer.c */
+        }
+        self -> chunk_open = false;
+    }
+    return rc;
+}
+
+bool flp_first_chunk( struct flp_t * self, int64_t * first_row, uint64_t * row_count ) {
+    bool res = false;
+    if ( NULL != self && NULL != self -> dout ) {
+        res = dout_next_chunk( self -> dout, &( self -> chunk_id ), first_row, row_count ); /* direct_out.c */
+        self -> chunk_open = res;
+    }
+    return res;
+}
+
+bool CC flp_next_chunk( void * self, int64_t * first_row, uint64_t * row_count, rc_t * rc ) {
+    bool res = false;
+    flp_t * flp = self;
+    if ( NULL != flp && NULL != flp -> dout ) {
+        *rc = flp_commit_chunk( flp ); /* above */
+        if ( 0 == *rc ) {
+            res = flp_first_chunk( flp, first_row, row_count ); /* above */
+        }
+    }
+    return res;
+}
+
+/* write the pending output of a file-wrapper compressed into its file */
+static rc_t flp_flush_fwrap( struct flp_t * self, fwrap_t * printer ) {
+    rc_t rc = 0;
+    if ( printer -> pending . S . len > 0 ) {
+        rc = ocmp_compress( self -> compress, printer -> pending . S . addr, printer -> pending . S . len,
+                            &( self -> packed ) ); /* out_compress.c */
+        if ( 0 == rc ) {
+            size_t num_writ;
+            rc = KFileWriteAll( printer -> f, printer -> file_pos,
+                                self -> packed . S . addr, self -> packed . S . len, &num_writ );
+            if ( 0 != rc ) {
+                ErrMsg( "flp_flush_fwrap().KFileWriteAll() -> %R", rc );
+            } else {
+                printer -> file_pos += num_writ;
+                self -> tele . bytes_written += num_writ;
+                tele_acc_check( &( self -> tele ) ); /* telemetry.c */
+            }
+        }
+        clear_SBuffer( &( printer -> pending ) ); /* sbuffer.c */
+    }
+    return rc;
+}
+
+static rc_t flp_write_compressed( struct flp_t * self, fwrap_t * printer, const SBuffer_t * t ) {
+    rc_t rc = 0;
+    if ( NULL == printer -> pending . S . addr ) {
+        rc = make_SBuffer( &( printer -> pending ), OCMP_BLOCK_SIZE + 4096 ); /* sbuffer.c */
+    }
+    if ( 0 == rc ) {
+        rc = append_bytes_to_SBuffer( &( printer -> pending ), t -> S . addr, t -> S . len ); /* sbuffer.c */
+    }
+    if ( 0 == rc && printer -> pending . S . len >= OCMP_BLOCK_SIZE ) {
+        rc = flp_flush_fwrap( self, printer ); /* above */
+    }
+    return rc;
+}
+
+rc_t flp_finish( struct flp_t * self, rc_t rc ) {
+    if ( NULL != self && NULL != self -> dout ) {
+        if ( 0 == rc ) {
+            rc = flp_commit_chunk( self ); /* above */
+        }
+        if ( 0 != rc ) {
+            dout_abort( self -> dout ); /* direct_out.c */
+        }
+    } else if ( NULL != self && NULL != self -> file_args && ct_none != self -> compress ) {
+        uint32_t idx;
+        uint32_t start = VectorStart( &( self -> printers ) );
+        uint32_t end = start + VectorLength( &( self -> printers ) );
+        for ( idx = start; 0 == rc && idx < end; ++idx ) {
+            fwrap_t * printer = VectorGet( &( self -> printers ), idx );
+            if ( NULL != printer ) { rc = flp_flush_fwrap( self, printer ); } /* above */
+        }
+    }
+    return rc;
+}
+
 rc_t flp_print( struct flp_t * self, const flp_data_t * data ) {
     rc_t rc = 0;
     if ( NULL == self || data == NULL ) {
         rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
         ErrMsg( "flex_print() -> %R", rc );
     } else {
-        /* pick the right format, depending if data-read2 is NULL or not */
-        struct vfmt_t * fmt = flp_prepare_data( self, data ); /* above */
-        if ( NULL != self -> file_args ) {
+        SBuffer_t * t = flp_format( self, data ); /* above */
+        if ( NULL == t ) {
+            rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcNull );
+            ErrMsg( "flex_print() cannot format data into buffer -> %R", rc );
+        } else if ( NULL != self -> file_args ) {
             /* we are in file-per-read-id--mode */
             fwrap_t * printer = flp_get_or_create_fwrap( &( self -> printers ),
                                                   data -> dst_id, self -> file_args ); /* above */
-            if ( NULL != printer ) {
-                rc = vfmt_print_to_file( fmt,
-                                    printer -> f, &( printer -> file_pos ),
-                                    self -> string_data, sdi_qa + 1,
-                                    self -> int_data, idi_rl + 1 ); /* var_fmt.c */
-            } else {
+            if ( NULL == printer ) {
                 rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcNull );
                 ErrMsg( "flex_print() cannot create printer -> %R", rc );
-            }
-        } else if ( NULL != self -> multi_writer ) {
-            /* we are in multi-writer-mode :
-             * the return value is not allocated every-time, it is a reference to a buffer
-             * enclosed in fmt...
-             */
-            SBuffer_t * t = vfmt_write_to_buffer( fmt,
-                                               self -> string_data, sdi_qa + 1,
-                                               self -> int_data, idi_rl + 1 ); /* var_fmt.c */
-            if ( NULL != t ) {
-                rc = flp_submit_to_buffer( self, t ); /* above */
+            } else if ( ct_none != self -> compress ) {
+                rc = flp_write_compressed( self, printer, t ); /* above */
             } else {
-                rc = RC( rcApp, rcNoTarg, rcConstructing, rcParam, rcNull );
-                ErrMsg( "flex_print() cannot format data into buffer -> %R", rc );
+                size_t num_writ;
+                rc = KFileWrite( printer -> f, printer -> file_pos, t -> S . addr, t -> S . len, &num_writ );
+                if ( 0 == rc ) {
+                    printer -> file_pos += num_writ;
+                    self -> tele . bytes_written += num_writ;
+                    tele_acc_check( &( self -> tele ) ); /* telemetry.c */
+                }
             }
-       }
+        } else if ( NULL != self -> multi_writer ) {
+            /* we are in multi-writer-mode */
+            rc = flp_submit_to_buffer( self, t ); /* above */
+        } else if ( NULL != self -> dout ) {
+            /* we are in direct-output-mode */
+            rc = flp_append_to_chunk( self, data -> dst_id, t ); /* above */
+        }
     }
     return rc;
 }
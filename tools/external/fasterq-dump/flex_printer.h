@@ -56,6 +56,10 @@ extern "C" {
 #ifndef _h_multi_writer_
 #include "multi_writer.h"
 #endif
+
+#ifndef _h_direct_out_
+#include "direct_out.h"
+#endif
     
 struct flp_t;
 
@@ -75,13 +79,15 @@ typedef struct flp_args_t {
     struct temp_registry_t * registry;
     const char * output_base;
     size_t buffer_size;
+    compress_t compress;
 } flp_args_t;
 
 void flp_initialize_args( flp_args_t * self,
                           KDirectory * dir,
                           struct temp_registry_t * registry,
                           const char * output_base,
-                          size_t buffer_size );
+                          size_t buffer_size,
+                          compress_t compress );
 
 /* ---------------------------------------------------------------------------------------------------
     accession       ... used in both modes for filling into the flexible defline
@@ -104,8 +110,29 @@ struct flp_t * flp_create_2( struct multi_writer_t * multi_writer,
                         const char * qual_defline,
                         bool fasta );
 
+/* for direct-output-mode: the output of a chunk of rows is collected in memory,
+   and written into the final output-files when the chunk is done */
+struct flp_t * flp_create_3( struct dout_t * dout,
+                        compress_t compress,
+                        const char * accession,
+                        const char * seq_defline,
+                        const char * qual_defline,
+                        bool fasta );
+
 void flp_release( struct flp_t * self );
 
+/* direct-output-mode only: get the first chunk to work on, false if there is none */
+bool flp_first_chunk( struct flp_t * self, int64_t * first_row, uint64_t * row_count );
+
+/* direct-output-mode only: commit the current chunk and get the next one,
+   to be used as cmn_iter_next_range_t ( cmn_iter.h ), self is the flp_t */
+bool CC flp_next_chunk( void * self, int64_t * first_row, uint64_t * row_count, rc_t * rc );
+
+/* direct-output-mode: commit the current chunk if not done yet,
+   or let the other threads know that this one failed ( rc != 0 )
+   file-per-read-id-mode: write out what is left to be compressed */
+rc_t flp_finish( struct flp_t * self, rc_t rc );
+
 /* depending on the data:
     quality == NULL ... fasta / fastq
     read2 == NULL ... 1 spot / 2 spots
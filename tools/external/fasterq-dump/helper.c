@@ -293,6 +293,72 @@ const char * hlp_check_mode_2_string( check_mode_t cm ) {
 
 /* -------------------------------------------------------------------------------- */
 
+static compress_t compress_cmp( const String * Mode, const char * test, compress_t test_mode ) {
+    String STestMode;
+    StringInitCString( &STestMode, test );
+    if ( 0 == StringCaseCompare ( Mode, &STestMode ) )  {
+        return test_mode;
+    }
+    return ct_unknown;
+}
+
+compress_t hlp_get_compress_t( const char * mode ) {
+    compress_t res = ct_none;
+    if ( NULL != mode ) {
+        String Mode;
+        StringInitCString( &Mode, mode );
+
+        res = compress_cmp( &Mode, "none", ct_none );
+        if ( ct_unknown == res ) {
+            res = compress_cmp( &Mode, "gzip", ct_gzip );
+        }
+        if ( ct_unknown == res ) {
+            res = compress_cmp( &Mode, "zstd", ct_zstd );
+        }
+    }
+    return res;
+}
+
+static const char * CT_UNKNOWN    = "unknown";
+static const char * CT_NONE       = "none";
+static const char * CT_GZIP       = "gzip";
+static const char * CT_ZSTD       = "zstd";
+
+const char * hlp_compress_2_string( compress_t ct ) {
+    const char * res = CT_UNKNOWN;
+    switch ( ct ) {
+        case ct_unknown     : res = CT_UNKNOWN; break;
+        case ct_none        : res = CT_NONE; break;
+        case ct_gzip        : res = CT_GZIP; break;
+        case ct_zstd        : res = CT_ZSTD; break;
+    }
+    return res;
+}
+
+const char * hlp_compress_ext( compress_t ct ) {
+    const char * res = "";
+    switch ( ct ) {
+        case ct_unknown     : break;
+        case ct_none        : break;
+        case ct_gzip        : res = ".gz"; break;
+        case ct_zstd        : res = ".zst"; break;
+    }
+    return res;
+}
+
+bool hlp_is_compress_ext( const String * ext ) {
+    bool res = false;
+    if ( NULL != ext ) {
+        String S_gz, S_zst;
+        CONST_STRING( &S_gz, "gz" );
+        CONST_STRING( &S_zst, "zst" );
+        res = ( 0 == StringCompare( ext, &S_gz ) || 0 == StringCompare( ext, &S_zst ) );
+    }
+    return res;
+}
+
+/* -------------------------------------------------------------------------------- */
+
 static atomic32_t quit_flag;
 
 rc_t hlp_get_quitting( void ) {
@@ -329,6 +395,34 @@ uint64_t hlp_make_key( int64_t seq_spot_id, uint32_t seq_read_id ) {
 
 /* -------------------------------------------------------------------------------- */
 
+static const char hlp_dec_pairs[ 201 ] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+uint32_t hlp_u64_to_dec( char * dst, uint64_t value ) {
+    char tmp[ HLP_MAX_DEC_DIGITS ];
+    uint32_t pos = HLP_MAX_DEC_DIGITS;
+    uint32_t len;
+    /* 2 digits per division, from the right */
+    while ( value >= 100 ) {
+        uint32_t idx = ( uint32_t )( value % 100 ) * 2;
+        value /= 100;
+        tmp[ --pos ] = hlp_dec_pairs[ idx + 1 ];
+        tmp[ --pos ] = hlp_dec_pairs[ idx ];
+    }
+    if ( value >= 10 ) {
+        uint32_t idx = ( uint32_t )value * 2;
+        tmp[ --pos ] = hlp_dec_pairs[ idx + 1 ];
+        tmp[ --pos ] = hlp_dec_pairs[ idx ];
+    } else {
+        tmp[ --pos ] = ( char )( '0' + value );
+    }
+    len = HLP_MAX_DEC_DIGITS - pos;
+    memcpy( dst, &tmp[ pos ], len );
+    return len;
+}
+
 const String * hlp_make_string_copy( const char * src )
 {
     const String * res = NULL;
@@ -686,6 +780,11 @@ uint64_t hlp_calculate_rows_per_thread( uint32_t * num_threads, uint64_t row_cou
     return res;
 }
 
+uint64_t hlp_rows_of_thread( int64_t row, uint64_t rows_per_thread, int64_t end_row ) {
+    if ( row >= end_row ) { return 0; }
+    return ( row + ( int64_t )rows_per_thread > end_row ) ? ( uint64_t )( end_row - row ) : rows_per_thread;
+}
+
 /* -------------------------------------------------------------------------------- */
 
 void hlp_unread_rc_info( bool show ) {
@@ -145,6 +145,23 @@ const char * hlp_check_mode_2_string( check_mode_t cm );
 
 /* -------------------------------------------------------------------------------- */
 
+typedef enum compress_t {
+    ct_unknown, ct_none, ct_gzip, ct_zstd
+    } compress_t;
+
+/* NULL means no compression */
+compress_t hlp_get_compress_t( const char * mode );
+
+const char * hlp_compress_2_string( compress_t ct );
+
+/* the file-extension to be appended to the output-filename ( "" for ct_none ) */
+const char * hlp_compress_ext( compress_t ct );
+
+/* is ext ( without the dot ) one of the extensions above? */
+bool hlp_is_compress_ext( const String * ext );
+
+/* -------------------------------------------------------------------------------- */
+
 rc_t CC Quitting(); /* to avoid including kapp/main.h */
 rc_t hlp_get_quitting( void );
 void hlp_set_quitting( void );
@@ -160,6 +177,13 @@ uint64_t hlp_make_key( int64_t seq_spot_id, uint32_t seq_read_id );
 
 /* -------------------------------------------------------------------------------- */
 
+/* writes value as decimal digits into dst ( no terminating 0 ), dst needs room for 20 chars,
+   returns the number of chars written */
+#define HLP_MAX_DEC_DIGITS 20
+uint32_t hlp_u64_to_dec( char * dst, uint64_t value );
+
+/* -------------------------------------------------------------------------------- */
+
 const String * hlp_make_string_copy( const char * src );
 
 rc_t hlp_split_string( String * in, String * p0, String * p1, uint32_t ch );
@@ -200,6 +224,8 @@ rc_t hlp_make_thread( KThread ** self,
 
 rc_t hlp_join_and_release_threads( Vector * threads );
 uint64_t hlp_calculate_rows_per_thread( uint32_t * num_threads, uint64_t row_count );
+/* the rows of the thread starting at row, the last thread must not run past end_row ( shards! ) */
+uint64_t hlp_rows_of_thread( int64_t row, uint64_t rows_per_thread, int64_t end_row );
 
 /* -------------------------------------------------------------------------------- */
 
@@ -39,6 +39,18 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_packed_4na_
+#include "packed_4na.h"
+#endif
+
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
+#ifndef _h_spill_io_
+#include "spill_io.h"
+#endif
+
 #ifndef _h_kfs_buffile_
 #include <kfs/buffile.h>
 #endif
@@ -48,14 +60,28 @@ typedef struct lookup_reader_t {
     const struct index_reader_t * index;
     SBuffer_t buf;
     uint64_t pos, f_size, max_key;
+    uint8_t * block;        /* only for sequential readers: the current block of the file */
+    size_t block_size;      /* how much is read from the file at once ( a multiple of FT_BLOCK_ALIGN ) */
+    size_t block_cap;       /* how big the block-buffer is */
+    size_t block_avail;     /* how many valid bytes are in the block-buffer */
+    size_t block_ofs;       /* the read-position in the block-buffer */
+    struct spill_reader_t * spill;  /* only for sequential readers with --spill-io direct, instead of f */
+    tele_acc_t tele;        /* telemetry.h, bytes read */
 } lookup_reader_t;
 
 void release_lookup_reader( struct lookup_reader_t * self ) {
     if ( NULL != self ) {
+        tele_acc_flush( &( self -> tele ) ); /* telemetry.c */
         if ( NULL != self -> f ) {
             ft_release_file( self -> f, "release_lookup_reader()" );
         }
+        if ( NULL != self -> spill ) {
+            spill_reader_release( self -> spill ); /* spill_io.c */
+        }
         release_SBuffer( &( self -> buf ) ); /* helper.c */
+        if ( NULL != self -> block ) {
+            free( ( void * ) self -> block );
+        }
         free( ( void * ) self );
     }
 }
@@ -71,11 +97,14 @@ static rc_t make_lookup_reader_obj( struct lookup_reader_t ** reader,
     } else {
         r -> f = f;
         r -> index = index;
-        rc = KFileSize( f, & r -> f_size );
+        if ( NULL != f ) {
+            rc = KFileSize( f, & r -> f_size );
+            if ( 0 != rc ) {
+                ErrMsg( "make_lookup_reader_obj().KFileSize() -> %R", rc );
+            }
+        }
         if ( 0 == rc ) {
             rc = make_SBuffer( &( r -> buf ), 4096 ); /* helper.c */
-        } else {
-            ErrMsg( "make_lookup_reader_obj().KFileSize() -> %R", rc );
         }
 
         if ( 0 == rc && NULL != index ) {
@@ -121,6 +150,147 @@ rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * in
     return rc;
 }
 
+rc_t make_lookup_reader_seq( const KDirectory *dir, struct lookup_reader_t ** reader,
+                             size_t block_size, const char * fmt, ... ) {
+    rc_t rc;
+    const struct KFile * f = NULL;
+    struct spill_reader_t * spill = NULL;
+
+    va_list args;
+    va_start ( args, fmt );
+    if ( spill_io_direct() ) {
+        /* the blocks are read ahead asynchronously, past the page-cache */
+        rc = spill_reader_make( &spill, dir, fmt, args ); /* spill_io.c */
+    } else {
+        rc = KDirectoryVOpenFileRead( dir, &f, fmt, args );
+        if ( 0 != rc ) {
+            ErrMsg( "make_lookup_reader_seq().KDirectoryVOpenFileRead( '?' ) -> %R",  rc );
+        }
+    }
+    va_end ( args );
+
+    if ( 0 == rc ) {
+        /* no KBufFile here: we read big blocks directly from the file, through the page-cache
+           ( only --spill-io direct bypasses it, see spill_io.c ) */
+        rc = make_lookup_reader_obj( reader, NULL, f );
+        if ( 0 != rc ) {
+            if ( NULL != f ) {
+                ft_release_file( f, "make_lookup_reader_seq()" );
+            }
+            spill_reader_release( spill ); /* spill_io.c */
+        } else if ( NULL != spill ) {
+            ( *reader ) -> spill = spill;
+            ( *reader ) -> f_size = spill_reader_size( spill ); /* spill_io.c */
+        }
+        if ( 0 == rc ) {
+            lookup_reader_t * r = *reader;
+            r -> block_size = ft_align_block_size( block_size ); /* file_tools.c */
+            r -> block_cap = 2 * r -> block_size;
+            r -> block = malloc( r -> block_cap );
+            if ( NULL == r -> block ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "make_lookup_reader_seq().malloc( %lu ) -> %R", r -> block_cap, rc );
+                release_lookup_reader( r );
+                *reader = NULL;
+            }
+        }
+    }
+    return rc;
+}
+
+/* make sure that at least 'needed' bytes are available at the read-position of the block */
+static rc_t lookup_reader_fill_block( struct lookup_reader_t * self, size_t needed ) {
+    rc_t rc = 0;
+    size_t avail = self -> block_avail - self -> block_ofs;
+    if ( avail < needed ) {
+        /* move the unread rest of the block to the front */
+        if ( avail > 0 && self -> block_ofs > 0 ) {
+            memmove( self -> block, self -> block + self -> block_ofs, avail );
+        }
+        self -> block_ofs = 0;
+        self -> block_avail = avail;
+
+        /* an entry can be bigger than a block ( long reads ) */
+        if ( needed + self -> block_size > self -> block_cap ) {
+            size_t new_cap = needed + self -> block_size;
+            uint8_t * tmp = realloc( self -> block, new_cap );
+            if ( NULL == tmp ) {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcMemory, rcExhausted );
+                ErrMsg( "lookup_reader_fill_block().realloc( %lu ) -> %R", new_cap, rc );
+            } else {
+                self -> block = tmp;
+                self -> block_cap = new_cap;
+            }
+        }
+
+        /* self -> pos is the position of the next block in the file, always a multiple of block_size */
+        while ( 0 == rc && self -> block_avail < needed && self -> pos < self -> f_size ) {
+            size_t num_read;
+            if ( NULL != self -> spill ) {
+                /* the spill-reader keeps track of the position itself */
+                rc = spill_reader_read( self -> spill, self -> block + self -> block_avail,
+                                        self -> block_size, &num_read ); /* spill_io.c */
+            } else {
+                rc = KFileReadAll( self -> f, self -> pos, self -> block + self -> block_avail,
+                                   self -> block_size, &num_read );
+            }
+            if ( 0 != rc ) {
+                ErrMsg( "lookup_reader_fill_block().read( at %lu, to_read %lu ) -> %R",
+                        self -> pos, self -> block_size, rc );
+            } else if ( 0 == num_read ) {
+                break;
+            } else {
+                self -> pos += num_read;
+                self -> block_avail += num_read;
+                self -> tele . bytes_read += num_read;
+            }
+        }
+
+        if ( 0 == rc && self -> block_avail < needed ) {
+            if ( 0 == self -> block_avail ) {
+                /* regular end of the file */
+                rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcId, rcNotFound );
+            } else {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+                ErrMsg( "lookup_reader_fill_block() truncated entry at %lu -> %R", self -> pos, rc );
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t lookup_reader_next( struct lookup_reader_t * self, uint64_t * key, String * packed_bases ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == key || NULL == packed_bases || NULL == self -> block ) {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
+        ErrMsg( "lookup_reader_next() #invalid input# -> %R",  rc );
+    } else {
+        const size_t hdr_size = sizeof( *key ) + sizeof( dna_len_t );
+        rc = lookup_reader_fill_block( self, hdr_size );
+        if ( 0 == rc ) {
+            dna_len_t dna_bases;
+            size_t dna_bytes;
+            memcpy( key, self -> block + self -> block_ofs, sizeof *key );
+            memcpy( &dna_bases, self -> block + self -> block_ofs + sizeof *key, sizeof dna_bases );
+            if ( 0 == dna_bases ) {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+                ErrMsg( "lookup_reader_next() dna_len == 0, key = %lu", *key );
+            } else {
+                dna_bytes = ( dna_bases & 1 ) ? ( dna_bases + 1 ) >> 1 : dna_bases >> 1;
+                rc = lookup_reader_fill_block( self, hdr_size + dna_bytes );
+                if ( 0 == rc ) {
+                    /* the packed bases start with the dna-len, as in lookup_reader_get() */
+                    const char * addr = ( const char * )( self -> block + self -> block_ofs + sizeof *key );
+                    size_t size = sizeof( dna_bases ) + dna_bytes;
+                    StringInit( packed_bases, addr, size, ( uint32_t )size );
+                    self -> block_ofs += ( hdr_size + dna_bytes );
+                }
+            }
+        }
+    }
+    return rc;
+}
+
 static rc_t read_key_and_len( struct lookup_reader_t * self, uint64_t pos, uint64_t *key, size_t *len ) {
     size_t num_read;
     /*const size_t buffer_size = sizeof( *key ) + sizeof( dna_len_t );*/
@@ -310,6 +480,8 @@ rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t
                                 packed_bases -> S . size = num_read + sizeof( dna_bases );
                                 packed_bases -> S . len = ( uint32_t )packed_bases -> S . size;
                                 self -> pos += ( sizeof( *key ) + sizeof( dna_bases ) + dna_bytes );
+                                self -> tele . bytes_read += ( sizeof( *key ) + sizeof( dna_bases ) + dna_bytes );
+                                tele_acc_check( &( self -> tele ) ); /* telemetry.c */
                             }
                         }
                     }
@@ -320,17 +492,7 @@ rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t
     return rc;
 }
 
-static const char x4na_to_ASCII_fwd[ 16 ] = {
-    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
-       'N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
-};
-
-static const char x4na_to_ASCII_rev[ 16 ] = {
-    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
-       'N', 'T', 'G', 'N', 'C', 'N', 'N', 'N', 'A', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
-};
-
-static rc_t unpack_4na( const String * packed, SBuffer_t * unpacked, bool reverse ) {
+rc_t lookup_unpack_4na( const String * packed, SBuffer_t * unpacked, bool reverse ) {
     rc_t rc = 0;
     uint8_t * src = ( uint8_t * )packed -> addr;
     dna_len_t dna_len;
@@ -338,50 +500,30 @@ static rc_t unpack_4na( const String * packed, SBuffer_t * unpacked, bool revers
     /* the first 2 bytes are the 16-bit dna-length */
     memmove( &dna_len, src, sizeof( dna_len_t ) );
 
-    if ( dna_len > unpacked -> buffer_size ) {
+    /* + 1 for the terminating zero */
+    if ( dna_len >= unpacked -> buffer_size ) {
         rc = increase_SBuffer_to( unpacked, dna_len + 4 );
         if ( 0 != rc ) {
             ErrMsg( "lookup_reader_get().unpack_4na() -> %R failed to increase buffer", rc );
         }
     }
+    if ( 0 == rc && packed -> size < sizeof( dna_len_t ) + ( ( dna_len + 1 ) / 2 ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+        ErrMsg( "lookup_reader_get().unpack_4na() -> %R packed bases too short", rc );
+    }
     if ( 0 == rc ) {
-        if ( 0 == dna_len ) {
-            unpacked -> S . size = 0;
-            unpacked -> S . len = 0;
-        } else {
-            uint8_t * dst = ( uint8_t * )unpacked -> S . addr;
-            int32_t dst_idx;
-            uint32_t src_idx;
-
-            /* use the complement-lookup-table in case of reverse */
-            const char * lookup = reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd;
-
-            dst_idx = reverse ? dna_len - 1 : 0;
-
-            for ( src_idx = sizeof( dna_len_t ); dst_idx >= 0 && src_idx < packed -> len; ++src_idx ) {
-                /* get the packed byte out of the packed input */
-                uint8_t packed_byte = src[ src_idx ];
+        char * dst = ( char * )unpacked -> S . addr;
 
-                /* write the first unpacked byte */
-                if ( dst_idx < unpacked -> buffer_size ) {
-                    dst[ dst_idx ] = lookup[ ( packed_byte >> 4 ) & 0x0F ];
-                    dst_idx += reverse ? -1 : 1;
-                }
+        /* decode 2 bases per byte, the complement in reverse order in case of reverse
+           ( vectorized if the cpu can do it ) */
+        p4na_unpack( src + sizeof( dna_len_t ), dna_len, dst, reverse ); /* packed_4na.c */
 
-                /* write the second unpacked byte */
-                if ( dst_idx < unpacked -> buffer_size ) {
-                    dst[ dst_idx ] = lookup[ packed_byte & 0x0F ];
-                    dst_idx += reverse ? -1 : 1;
-                }
-            }
+        /* set the dna-length in the output-string */
+        unpacked -> S . size = dna_len;
+        unpacked -> S . len = ( uint32_t )unpacked -> S . size;
 
-            /* set the dna-length in the output-string */
-            unpacked -> S . size = dna_len;
-            unpacked -> S . len = ( uint32_t )unpacked -> S . size;
-
-            /* terminated the output-string, just in case */
-            dst[ dna_len ] = 0;
-        }
+        /* terminated the output-string, just in case */
+        dst[ dna_len ] = 0;
     }
     return rc;
 }
@@ -404,7 +546,7 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
             found_read_id = key & 1 ? 2 : 1;
 
             if ( found_row_id == row_id && found_read_id == read_id ) {
-                rc = unpack_4na( &self -> buf . S, B, reverse ); /* helper.c */
+                rc = lookup_unpack_4na( &self -> buf . S, B, reverse ); /* above */
             } else {
                 /* in case the reader is not pointed to the right position, we try to seek again */
                 rc_t rc1;
@@ -426,7 +568,7 @@ rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_
                         found_read_id = key & 1 ? 2 : 1;
 
                         if ( found_row_id == row_id && found_read_id == read_id ) {
-                            rc = unpack_4na( &self -> buf . S, B, reverse ); /* helper.c */
+                            rc = lookup_unpack_4na( &self -> buf . S, B, reverse ); /* above */
                         } else {
                             rc = RC( rcVDB, rcNoTarg, rcConstructing, rcTransfer, rcInvalid );
                             ErrMsg( "lookup_bases #2( %lu.%u ) ---> found %lu.%u (at pos=%lu)",
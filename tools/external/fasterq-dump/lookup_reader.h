@@ -55,11 +55,23 @@ void release_lookup_reader( struct lookup_reader_t * self );
 rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader_t * index,
                          struct lookup_reader_t ** reader, size_t buf_size, const char * fmt, ... );
 
+/* a reader for sequential access only ( the merge-sources in merge_sorter.c ):
+   reads the file in big blocks, no seeking, no index */
+rc_t make_lookup_reader_seq( const KDirectory *dir, struct lookup_reader_t ** reader,
+                             size_t block_size, const char * fmt, ... );
+
+/* only for sequential readers: packed_bases points into the block of the reader
+   and is valid until the next call, returns a silent rc at the end of the file */
+rc_t lookup_reader_next( struct lookup_reader_t * self, uint64_t * key, String * packed_bases );
+
 rc_t seek_lookup_reader( struct lookup_reader_t * self, uint64_t key, uint64_t * key_found, bool exactly );
 
 rc_t lookup_reader_get( struct lookup_reader_t * self, uint64_t * key, SBuffer_t * packed_bases );
 rc_t lookup_bases( struct lookup_reader_t * self, int64_t row_id, uint32_t read_id, SBuffer_t * B, bool reverse );
 
+/* packed = [dna_len_t][4na-packed bases], as stored in the lookup-file ( used by mem_lookup.c too ) */
+rc_t lookup_unpack_4na( const String * packed, SBuffer_t * unpacked, bool reverse );
+
 rc_t lookup_check( struct lookup_reader_t * self );
 rc_t lookup_check_file( const KDirectory *dir, size_t buf_size, const char * filename );
 
@@ -42,8 +42,12 @@
 #include "file_tools.h"
 #endif
 
-#ifndef _h_kfs_buffile_
-#include <kfs/buffile.h>
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
+#ifndef _h_spill_io_
+#include "spill_io.h"
 #endif
 
 #ifndef _h_klib_out_
@@ -54,15 +58,56 @@ typedef struct lookup_writer_t {
     struct KFile * f;
     struct index_writer_t * index_writer;
     SBuffer_t buf;
-    uint64_t pos;
+    uint64_t pos;           /* the logical position of the next entry ( goes into the index ) */
+    uint8_t * block;        /* if not NULL: entries are collected here and written in big blocks */
+    size_t block_size;
+    size_t block_used;
+    uint64_t block_pos;     /* the position in the file where the block goes */
+    struct spill_writer_t * spill;  /* if not NULL: the entries go here instead ( --spill-io direct ) */
 } lookup_writer_t;
 
+static rc_t write_block_of_lookup_writer( struct lookup_writer_t * writer, const void * src, size_t size ) {
+    size_t num_writ;
+    rc_t rc = KFileWriteAll( writer -> f, writer -> block_pos, src, size, &num_writ );
+    if ( 0 != rc ) {
+        ErrMsg( "write_block_of_lookup_writer().KFileWriteAll( at %lu, %lu bytes ) -> %R",
+                writer -> block_pos, size, rc );
+    } else if ( num_writ != size ) {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcInvalid );
+        ErrMsg( "write_block_of_lookup_writer().KFileWriteAll( at %lu, %lu bytes ) -> %R",
+                writer -> block_pos, size, rc );
+    } else {
+        writer -> block_pos += num_writ;
+    }
+    return rc;
+}
+
+rc_t flush_lookup_writer( struct lookup_writer_t * writer ) {
+    rc_t rc = 0;
+    if ( NULL != writer && NULL != writer -> block && writer -> block_used > 0 ) {
+        rc = write_block_of_lookup_writer( writer, writer -> block, writer -> block_used );
+        writer -> block_used = 0;
+    }
+    if ( 0 == rc && NULL != writer && NULL != writer -> spill ) {
+        rc = spill_writer_finish( writer -> spill ); /* spill_io.c */
+    }
+    return rc;
+}
+
 void release_lookup_writer( struct lookup_writer_t * writer ) {
     if ( NULL != writer ) {
+        flush_lookup_writer( writer ); /* errors are already reported via ErrMsg */
+        tele_add_written( writer -> pos ); /* telemetry.c ( pos is the logical size of the file ) */
+        if ( NULL != writer -> spill ) {
+            spill_writer_release( writer -> spill ); /* spill_io.c */
+        }
         if ( NULL != writer -> f ) {
             ft_release_file( writer -> f, "release_lookup_writer()" );
         }
         release_SBuffer( &( writer -> buf ) );
+        if ( NULL != writer -> block ) {
+            free( ( void * ) writer -> block );
+        }
         free( ( void * ) writer );
     }
 }
@@ -88,6 +133,17 @@ static rc_t make_lookup_writer_obj( struct lookup_writer_t ** writer,
     return rc;
 }
 
+static rc_t make_lookup_writer_block( struct lookup_writer_t * writer, size_t buf_size ) {
+    rc_t rc = 0;
+    writer -> block_size = ft_align_block_size( buf_size ); /* file_tools.c */
+    writer -> block = malloc( writer -> block_size );
+    if ( NULL == writer -> block ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "make_lookup_writer_block().malloc( %lu ) -> %R", writer -> block_size, rc );
+    }
+    return rc;
+}
+
 rc_t make_lookup_writer( KDirectory *dir,
                          struct index_writer_t * index_writer,
                          struct lookup_writer_t ** writer,
@@ -99,28 +155,89 @@ rc_t make_lookup_writer( KDirectory *dir,
     va_list args;
     va_start ( args, fmt );
 
+    if ( buf_size > 0 && spill_io_direct() ) {
+        /* asynchronous, aligned and past the page-cache: spill_io.c does the blocking */
+        struct spill_writer_t * spill;
+        rc = spill_writer_make( &spill, dir, fmt, args ); /* spill_io.c */
+        if ( 0 == rc ) {
+            rc = make_lookup_writer_obj( writer, index_writer, NULL );
+            if ( 0 != rc ) {
+                spill_writer_release( spill );
+            } else {
+                ( *writer ) -> spill = spill;
+            }
+        }
+        va_end ( args );
+        return rc;
+    }
+
     rc = KDirectoryVCreateFile( dir, &f, false, 0664, kcmInit, fmt, args );
     if ( 0 != rc ) {
         ErrMsg( "make_lookup_writer().KDirectoryVCreateFile() -> %R", rc );
     } else {
-        if ( buf_size > 0 ) {
-            struct KFile * temp_file;
-            rc = KBufFileMakeWrite( &temp_file, f, false, buf_size );
+        rc = make_lookup_writer_obj( writer, index_writer, f );
+        if ( 0 != rc ) {
+            ft_release_file( f, "make_lookup_writer()" );
+        } else if ( buf_size > 0 ) {
+            /* instead of a KBufFile: we collect whole entries into a block and write it
+               with one call ( no split entries, no extra copy ), through the page-cache */
+            rc = make_lookup_writer_block( *writer, buf_size );
             if ( 0 != rc ) {
-                ErrMsg( "make_lookup_writer().KBufFileMakeWrite() -> %R", rc );
-            } else {
-                ft_release_file( f, "make_lookup_writer().1" );
-                f = temp_file;
+                release_lookup_writer( *writer );
+                *writer = NULL;
             }
         }
-        if ( 0 == rc ) {
-            rc = make_lookup_writer_obj( writer, index_writer, f );
-            if ( 0 != rc ) {
-                ft_release_file( f, "make_lookup_writer().2" );
+    }
+    va_end ( args );
+    return rc;
+}
+
+static rc_t write_packed_to_lookup_block( struct lookup_writer_t * writer,
+                                          const uint64_t key,
+                                          const String * bases_as_packed_4na ) {
+    rc_t rc = 0;
+    size_t entry_size = sizeof key + bases_as_packed_4na -> size;
+    if ( writer -> block_used + entry_size > writer -> block_size ) {
+        rc = flush_lookup_writer( writer );
+    }
+    if ( 0 == rc ) {
+        if ( entry_size > writer -> block_size ) {
+            /* a giant entry: the block is empty now, write it directly */
+            rc = write_block_of_lookup_writer( writer, &key, sizeof key );
+            if ( 0 == rc ) {
+                rc = write_block_of_lookup_writer( writer,
+                                                   bases_as_packed_4na -> addr,
+                                                   bases_as_packed_4na -> size );
             }
+        } else {
+            uint8_t * dst = writer -> block + writer -> block_used;
+            memcpy( dst, &key, sizeof key );
+            memcpy( dst + sizeof key, bases_as_packed_4na -> addr, bases_as_packed_4na -> size );
+            writer -> block_used += entry_size;
         }
     }
-    va_end ( args );
+    if ( 0 == rc ) {
+        if ( NULL != writer -> index_writer ) {
+            rc = write_key( writer -> index_writer, key, writer -> pos );
+        }
+        writer -> pos += entry_size;
+    }
+    return rc;
+}
+
+static rc_t write_packed_to_lookup_spill( struct lookup_writer_t * writer,
+                                          const uint64_t key,
+                                          const String * bases_as_packed_4na ) {
+    rc_t rc = spill_writer_write( writer -> spill, &key, sizeof key ); /* spill_io.c */
+    if ( 0 == rc ) {
+        rc = spill_writer_write( writer -> spill, bases_as_packed_4na -> addr, bases_as_packed_4na -> size );
+    }
+    if ( 0 == rc ) {
+        if ( NULL != writer -> index_writer ) {
+            rc = write_key( writer -> index_writer, key, writer -> pos );
+        }
+        writer -> pos += sizeof key + bases_as_packed_4na -> size;
+    }
     return rc;
 }
 
@@ -128,8 +245,15 @@ rc_t write_packed_to_lookup_writer( struct lookup_writer_t * writer,
                                     const uint64_t key,
                                     const String * bases_as_packed_4na ) {
     size_t num_writ;
+    rc_t rc;
+    if ( NULL != writer -> spill ) {
+        return write_packed_to_lookup_spill( writer, key, bases_as_packed_4na );
+    }
+    if ( NULL != writer -> block ) {
+        return write_packed_to_lookup_block( writer, key, bases_as_packed_4na );
+    }
     /* first write the key ( combination of seq-id and read-id ) */
-    rc_t rc = KFileWriteAll( writer -> f, writer -> pos, &key, sizeof key, &num_writ );
+    rc = KFileWriteAll( writer -> f, writer -> pos, &key, sizeof key, &num_writ );
     if ( 0 != rc ) {
         ErrMsg( "write_packed_to_lookup_writer().KFileWriteAll( key ) -> %R", rc );
     }
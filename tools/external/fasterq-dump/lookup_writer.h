@@ -54,6 +54,9 @@ void release_lookup_writer( struct lookup_writer_t * writer );
 rc_t make_lookup_writer( KDirectory *dir, struct index_writer_t * idx, struct lookup_writer_t ** writer,
                          size_t buf_size, const char * fmt, ... );
 
+/* writes the pending block ( if buf_size > 0 was given ), release_lookup_writer() does it too */
+rc_t flush_lookup_writer( struct lookup_writer_t * writer );
+
 /* used in merge_sorter.c and lookup_writer.c */
 rc_t write_packed_to_lookup_writer( struct lookup_writer_t * writer,
             uint64_t key, const String * bases_as_packed_4na );
@@ -0,0 +1,279 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "mem_lookup.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_lookup_reader_
+#include "lookup_reader.h"
+#endif
+
+#ifndef _h_klib_vector_
+#include <klib/vector.h>
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+/*
+    this is in interfaces/cc/XXX/YYY/atomic.h
+    XXX ... the compiler ( cc, gcc, icc, vc++ )
+    YYY ... the architecture ( fat86, i386, noarch, ppc32, x86_64 )
+ */
+#include <atomic.h>
+
+/* the size of the memory-blocks handed out to the producer-threads */
+#define MEMLKP_BLOCK_SIZE ( 16 * 1024 * 1024 )
+
+typedef struct mem_lookup_t {
+    const uint8_t ** slots;     /* one slot per key, NULL if the key is not in the lookup */
+    uint64_t num_slots;
+    Vector blocks;              /* all the memory-blocks handed out, to be freed at release */
+    KLock * lock;               /* protects the blocks-vector */
+    size_t mem_limit;
+    atomic64_t bytes_used;      /* how much of the mem-limit is used */
+    atomic64_t entries;         /* how many values are stored */
+    atomic64_t file_bytes;      /* how many bytes would have been written to the lookup-file */
+    atomic32_t overflowed;      /* set if the mem-limit has been exceeded */
+} mem_lookup_t;
+
+size_t memlkp_estimate( uint64_t seq_row_count,
+                        uint64_t align_row_count,
+                        uint64_t align_base_count,
+                        uint32_t num_threads ) {
+    size_t res = ( ( seq_row_count + 2 ) * 2 ) * ( sizeof( const uint8_t * ) );     /* the slots */
+    res += align_row_count * sizeof( dna_len_t );                                  /* the dna-lengths */
+    res += ( align_base_count + align_row_count ) / 2;                             /* the packed bases */
+    res += ( size_t )num_threads * MEMLKP_BLOCK_SIZE;                              /* partially used blocks */
+    return res;
+}
+
+static void CC memlkp_free_block( void * item, void * data ) {
+    free( item );
+}
+
+void memlkp_release( struct mem_lookup_t * self ) {
+    if ( NULL != self ) {
+        VectorWhack( &( self -> blocks ), memlkp_free_block, NULL );
+        if ( NULL != self -> lock ) {
+            KLockRelease( self -> lock );
+        }
+        if ( NULL != self -> slots ) {
+            free( ( void * ) self -> slots );
+        }
+        free( ( void * ) self );
+    }
+}
+
+static bool memlkp_reserve( struct mem_lookup_t * self, size_t size ) {
+    int64_t prev = atomic64_read_and_add( &( self -> bytes_used ), size );
+    bool res = ( ( prev + size ) <= self -> mem_limit );
+    if ( !res ) {
+        /* give it back and mark the lookup as overflowed, the caller has to fall back
+           to the file-based lookup */
+        atomic64_read_and_add( &( self -> bytes_used ), -( ( int64_t )size ) );
+        atomic32_set( &( self -> overflowed ), 1 );
+    }
+    return res;
+}
+
+/* rcExcessive and not rcExhausted: a failing malloc() is an error, not an overflow */
+static rc_t memlkp_overflow_rc( void ) {
+    return SILENT_RC( rcVDB, rcNoTarg, rcInserting, rcMemory, rcExcessive );
+}
+
+bool memlkp_is_overflow_rc( rc_t rc ) {
+    return ( rcExcessive == GetRCState( rc ) && ( enum RCObject )rcMemory == GetRCObject( rc ) );
+}
+
+rc_t memlkp_make( struct mem_lookup_t ** self, uint64_t seq_row_count, size_t mem_limit ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcNull );
+        ErrMsg( "mem_lookup.c memlkp_make() -> %R", rc );
+    } else {
+        mem_lookup_t * l = calloc( 1, sizeof * l );
+        *self = NULL;
+        if ( NULL == l ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "mem_lookup.c memlkp_make().calloc( %d ) -> %R", ( sizeof * l ), rc );
+        } else {
+            VectorInit( &( l -> blocks ), 0, 64 );
+            l -> mem_limit = mem_limit;
+            l -> num_slots = ( seq_row_count + 2 ) * 2;
+            atomic64_set( &( l -> bytes_used ), 0 );
+            atomic64_set( &( l -> entries ), 0 );
+            atomic64_set( &( l -> file_bytes ), 0 );
+            atomic32_set( &( l -> overflowed ), 0 );
+
+            rc = KLockMake( &( l -> lock ) );
+            if ( 0 != rc ) {
+                ErrMsg( "mem_lookup.c memlkp_make().KLockMake() -> %R", rc );
+            } else {
+                size_t slot_bytes = l -> num_slots * ( sizeof * l -> slots );
+                if ( !memlkp_reserve( l, slot_bytes ) ) {
+                    rc = memlkp_overflow_rc();
+                } else {
+                    l -> slots = calloc( l -> num_slots, sizeof * l -> slots );
+                    if ( NULL == l -> slots ) {
+                        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                        ErrMsg( "mem_lookup.c memlkp_make().calloc( %lu ) -> %R", slot_bytes, rc );
+                    }
+                }
+            }
+
+            if ( 0 == rc ) {
+                *self = l;
+            } else {
+                memlkp_release( l );
+            }
+        }
+    }
+    return rc;
+}
+
+void memlkp_init_slab( mem_lookup_slab_t * slab ) {
+    if ( NULL != slab ) {
+        slab -> block = NULL;
+        slab -> used = 0;
+        slab -> size = 0;
+    }
+}
+
+static rc_t memlkp_new_block( struct mem_lookup_t * self, mem_lookup_slab_t * slab, size_t needed ) {
+    rc_t rc = 0;
+    /* a read longer than a block gets a block of its own */
+    size_t size = needed > MEMLKP_BLOCK_SIZE ? needed : MEMLKP_BLOCK_SIZE;
+    if ( !memlkp_reserve( self, size ) ) {
+        rc = memlkp_overflow_rc();
+    } else {
+        uint8_t * block = malloc( size );
+        if ( NULL == block ) {
+            rc = RC( rcVDB, rcNoTarg, rcInserting, rcMemory, rcExhausted );
+            ErrMsg( "mem_lookup.c memlkp_new_block().malloc( %lu ) -> %R", size, rc );
+        } else {
+            rc = KLockAcquire( self -> lock );
+            if ( 0 != rc ) {
+                ErrMsg( "mem_lookup.c memlkp_new_block().KLockAcquire -> %R", rc );
+            } else {
+                rc = VectorAppend( &( self -> blocks ), NULL, block );
+                if ( 0 != rc ) {
+                    ErrMsg( "mem_lookup.c memlkp_new_block().VectorAppend -> %R", rc );
+                }
+                KLockUnlock( self -> lock );
+            }
+            if ( 0 == rc ) {
+                /* the remainder of the previous block is given up */
+                slab -> block = block;
+                slab -> used = 0;
+                slab -> size = size;
+            } else {
+                free( block );
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t memlkp_put( struct mem_lookup_t * self, mem_lookup_slab_t * slab,
+                 uint64_t key, const String * packed_bases ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == slab || NULL == packed_bases ) {
+        rc = RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+        ErrMsg( "mem_lookup.c memlkp_put() -> %R", rc );
+    } else if ( key >= self -> num_slots ) {
+        rc = RC( rcVDB, rcNoTarg, rcInserting, rcId, rcTooBig );
+        ErrMsg( "mem_lookup.c memlkp_put( key: %lu of %lu ) -> %R", key, self -> num_slots, rc );
+    } else if ( 0 != atomic32_read( &( self -> overflowed ) ) ) {
+        /* an other producer has hit the limit, no need to go on */
+        rc = memlkp_overflow_rc();
+    } else {
+        size_t needed = packed_bases -> size;
+        if ( NULL == slab -> block || ( slab -> size - slab -> used ) < needed ) {
+            rc = memlkp_new_block( self, slab, needed );
+        }
+        if ( 0 == rc ) {
+            uint8_t * dst = slab -> block + slab -> used;
+            memcpy( dst, packed_bases -> addr, needed );
+            slab -> used += needed;
+            /* each key is written by exactly one producer, no lock needed */
+            self -> slots[ key ] = dst;
+            atomic64_inc( &( self -> entries ) );
+            atomic64_read_and_add( &( self -> file_bytes ), ( sizeof key ) + needed );
+        }
+    }
+    return rc;
+}
+
+bool memlkp_overflowed( const struct mem_lookup_t * self ) {
+    bool res = false;
+    if ( NULL != self ) {
+        res = ( 0 != atomic32_read( &( self -> overflowed ) ) );
+    }
+    return res;
+}
+
+rc_t memlkp_bases( const struct mem_lookup_t * self, int64_t row_id, uint32_t read_id,
+                   SBuffer_t * B, bool reverse ) {
+    rc_t rc = 0;
+    if ( NULL == self || NULL == B ) {
+        rc = RC( rcRuntime, rcData, rcAccessing, rcMemory, rcNull );
+        ErrMsg( "memlkp_bases( %lu.%u ) failed ---> %R", row_id, read_id, rc );
+    } else {
+        uint64_t key = hlp_make_key( row_id, read_id ); /* helper.c */
+        const uint8_t * src = ( key < self -> num_slots ) ? self -> slots[ key ] : NULL;
+        if ( NULL == src ) {
+            rc = RC( rcVDB, rcNoTarg, rcReading, rcId, rcNotFound );
+            ErrMsg( "memlkp_bases( %lu.%u ) ---> not found ---> %R", row_id, read_id, rc );
+        } else {
+            String packed;
+            dna_len_t dna_len;
+            size_t size;
+
+            memcpy( &dna_len, src, sizeof dna_len );
+            size = ( sizeof dna_len ) + ( ( dna_len + 1 ) / 2 );
+            StringInit( &packed, ( const char * )src, size, ( uint32_t )size );
+            rc = lookup_unpack_4na( &packed, B, reverse ); /* lookup_reader.c */
+        }
+    }
+    return rc;
+}
+
+uint64_t memlkp_entries( const struct mem_lookup_t * self ) {
+    return ( NULL == self ) ? 0 : atomic64_read( &( self -> entries ) );
+}
+
+uint64_t memlkp_bytes_used( const struct mem_lookup_t * self ) {
+    return ( NULL == self ) ? 0 : atomic64_read( &( self -> bytes_used ) );
+}
+
+uint64_t memlkp_lookup_file_bytes( const struct mem_lookup_t * self ) {
+    return ( NULL == self ) ? 0 : atomic64_read( &( self -> file_bytes ) );
+}
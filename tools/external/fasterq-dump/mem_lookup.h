@@ -0,0 +1,106 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_mem_lookup_
+#define _h_mem_lookup_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"
+#endif
+
+/* ---------------------------------------------------------------------------------
+    the in-memory lookup-table:
+    an alternative to the file-based lookup ( sorter.c -> merge_sorter.c -> lookup_reader.c )
+    for accessions where the lookup fits into the memory-limit ( --mem )
+
+    the keys are made by hlp_make_key() ( helper.c ), they are dense: 2 x SEQ-row-count
+    each key has a slot in a pointer-table, the slot points to the packed bases in
+    a memory-block owned by the lookup. The packed bases have the same layout as in the
+    lookup-file : [dna_len_t][4na-packed bases]
+
+    the producer-threads ( sorter.c ) write into disjunct slots, each one into its own
+    memory-block ( mem_lookup_slab_t ), no locking is needed to insert a value.
+    the join-threads ( db_join.c ) read from it after all producers have been joined.
+
+    if the memory-limit is exceeded, memlkp_make() and memlkp_put() return a rc for
+    which memlkp_is_overflow_rc() is true, memlkp_put() also marks the lookup as
+    overflowed. The caller has to fall back to the file-based lookup.
+   --------------------------------------------------------------------------------- */
+
+struct mem_lookup_t;
+
+/* each producer-thread owns one of these, it points into the current memory-block */
+typedef struct mem_lookup_slab_t {
+    uint8_t * block;
+    size_t used;
+    size_t size;
+} mem_lookup_slab_t;
+
+/* estimate how much memory the lookup will need */
+size_t memlkp_estimate( uint64_t seq_row_count,
+                        uint64_t align_row_count,
+                        uint64_t align_base_count,
+                        uint32_t num_threads );
+
+rc_t memlkp_make( struct mem_lookup_t ** self, uint64_t seq_row_count, size_t mem_limit );
+void memlkp_release( struct mem_lookup_t * self );
+
+void memlkp_init_slab( mem_lookup_slab_t * slab );
+
+/* called concurrently by the producer-threads, packed_bases = [dna_len_t][4na-packed] */
+rc_t memlkp_put( struct mem_lookup_t * self, mem_lookup_slab_t * slab,
+                 uint64_t key, const String * packed_bases );
+
+bool memlkp_overflowed( const struct mem_lookup_t * self );
+bool memlkp_is_overflow_rc( rc_t rc );
+
+/* called concurrently by the join-threads, unpacks into B ( reverse-complement if requested ) */
+rc_t memlkp_bases( const struct mem_lookup_t * self, int64_t row_id, uint32_t read_id,
+                   SBuffer_t * B, bool reverse );
+
+uint64_t memlkp_entries( const struct mem_lookup_t * self );
+uint64_t memlkp_bytes_used( const struct mem_lookup_t * self );
+
+/* how many bytes the lookup-file would have had on scratch-space */
+uint64_t memlkp_lookup_file_bytes( const struct mem_lookup_t * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -43,6 +43,10 @@
 #include "lookup_writer.h"
 #endif
 
+#ifndef _h_merge_tree_
+#include "merge_tree.h"
+#endif
+
 #ifndef _h_locked_file_list_
 #include "locked_file_list.h"
 #endif
@@ -74,34 +78,17 @@
 typedef struct merge_src {
     struct lookup_reader_t * reader;
     uint64_t key;
-    SBuffer_t packed_bases;
+    String packed_bases;    /* points into the block of the reader */
     rc_t rc;
 } merge_src_t;
 
-static merge_src_t * get_min_merge_src( merge_src_t * src, uint32_t count ) {
-    merge_src_t * res = NULL;
-    uint32_t i;
-    for ( i = 0; i < count; ++i ) {
-        merge_src_t * item = &src[ i ];
-        if ( 0 == item -> rc ) {
-            if ( NULL == res ) {
-                /* pick the first one */
-                res = item;
-            } else if ( item -> key < res -> key ) {
-                /* if this src has a smaller key... */
-                res = item;
-            }
-        }
-    }
-    return res;
-}
-
 /* ================================================================================= */
 
 typedef struct merge_sorter_t {
     struct lookup_writer_t * dst; /* lookup_writer.h */
     struct index_writer_t * idx;  /* index.h */
     merge_src_t * src;            /* vector of input-files to be merged */
+    struct merge_tree_t * tree;   /* picks the src with the smallest key ( merge_tree.h ) */
     struct bg_update_t * gap;     /* indicator of running merge */
     uint64_t total_size, total_entries;
     uint32_t num_src;
@@ -124,6 +111,8 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
         self -> idx = NULL;
     }
 
+    self -> src = NULL;
+    self -> tree = NULL;
     self -> total_size = 0;
     self -> total_entries = 0;
     self -> num_src = num_src;
@@ -133,6 +122,10 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
         rc = make_lookup_writer( dir, self -> idx, &( self -> dst ), buf_size, "%s", output ); /* lookup_writer.h */
     }
 
+    if ( 0 == rc ) {
+        rc = make_merge_tree( &( self -> tree ), self -> num_src ); /* merge_tree.c */
+    }
+
     if ( 0 == rc ) {
         self -> src = calloc( self -> num_src, sizeof * self-> src );
         if ( NULL == self -> src ) {
@@ -147,16 +140,17 @@ static rc_t init_merge_sorter( merge_sorter_t * self,
         if ( 0 == rc ) {
             merge_src_t * s = &self -> src[ i ];
             if ( 0 == rc ) {
-                rc = make_lookup_reader( dir, NULL, &s -> reader, buf_size, "%s", filename ); /* lookup_reader.h */
+                rc = make_lookup_reader_seq( dir, &s -> reader, buf_size, "%s", filename ); /* lookup_reader.h */
             }
             if ( 0 == rc ) {
-                rc = make_SBuffer( &s -> packed_bases, 4096 );
-                if ( 0 == rc ) {
-                    s -> rc = lookup_reader_get( s -> reader, &s -> key, &s -> packed_bases ); /* lookup_reader.h */
-                }
+                s -> rc = lookup_reader_next( s -> reader, &s -> key, &s -> packed_bases ); /* lookup_reader.h */
+                merge_tree_set( self -> tree, i, s -> key, 0 == s -> rc ); /* merge_tree.c */
             }
         }
     }
+    if ( 0 == rc ) {
+        merge_tree_build( self -> tree ); /* merge_tree.c */
+    }
     return rc;
 }
 
@@ -167,10 +161,10 @@ static void release_merge_sorter( merge_sorter_t * self ) {
         for ( uint32_t i = 0; i < self -> num_src; ++i ) {
             merge_src_t * s = &self -> src[ i ];
             release_lookup_reader( s -> reader );
-            release_SBuffer( &s -> packed_bases );
         }
         free( ( void * ) self -> src );
     }
+    release_merge_tree( self -> tree ); /* merge_tree.c */
 }
 
 static rc_t run_merge_sorter( merge_sorter_t * self ) {
@@ -178,11 +172,12 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
     uint64_t last_key = 0;
     uint64_t loop_nr = 0;
 
-    merge_src_t * to_write = get_min_merge_src( self -> src, self -> num_src ); /* above */
+    int32_t idx = merge_tree_top( self -> tree ); /* merge_tree.c */
 
-    while( 0 == rc && NULL != to_write ) {
+    while( 0 == rc && idx >= 0 ) {
         rc = hlp_get_quitting();    /* helper.c */
         if ( 0 == rc ) {
+            merge_src_t * to_write = &( self -> src[ idx ] );
             if ( last_key > to_write -> key ) {
                 rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcInvalid );
                 ErrMsg( "run_merge_sorter() last key:%lu -> to-write-key:%lu in loop #%lu", last_key, to_write -> key, loop_nr );
@@ -191,13 +186,14 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
                 last_key = to_write -> key;
                 rc = write_packed_to_lookup_writer( self -> dst,
                                                     to_write -> key,
-                                                    &to_write -> packed_bases . S ); /* lookup_writer.h */
+                                                    &to_write -> packed_bases ); /* lookup_writer.h */
                 if ( 0 == rc ) {
-                    to_write -> rc = lookup_reader_get( to_write -> reader,
-                                                        &to_write -> key,
-                                                        &to_write -> packed_bases ); /* lookup_reader.h */
+                    to_write -> rc = lookup_reader_next( to_write -> reader,
+                                                         &to_write -> key,
+                                                         &to_write -> packed_bases ); /* lookup_reader.h */
+                    merge_tree_replace_top( self -> tree, to_write -> key, 0 == to_write -> rc ); /* merge_tree.c */
                 }
-                to_write = get_min_merge_src( self -> src, self -> num_src ); /* above */
+                idx = merge_tree_top( self -> tree ); /* merge_tree.c */
             }
             if ( 0 != rc ) {
                 hlp_set_quitting();     /* helper.c */
@@ -205,6 +201,9 @@ static rc_t run_merge_sorter( merge_sorter_t * self ) {
             bg_update_update( self -> gap, 1 ); /* signal to gap-update */
         }
     }
+    if ( 0 == rc ) {
+        rc = flush_lookup_writer( self -> dst ); /* lookup_writer.c */
+    }
     self -> total_entries += loop_nr;
     return rc;
 }
@@ -307,22 +306,6 @@ static void release_bg_vec_merge_src( bg_vec_merge_src_t * src ) {
     }
 }
 
-static bg_vec_merge_src_t * get_min_bg_vec_merge_src( bg_vec_merge_src_t * batch, uint32_t count ) {
-    bg_vec_merge_src_t * res = NULL;
-    uint32_t i;
-    for ( i = 0; i < count; ++i ) {
-        bg_vec_merge_src_t * item = &batch[ i ];
-        if ( 0 == item -> rc ) {
-            if ( NULL == res ) {
-                res = item;
-            } else if ( item -> key < res -> key ) {
-                res = item;
-            }
-        }
-    }
-    return res;
-}
-
 static rc_t write_bg_vec_merge_src( bg_vec_merge_src_t * src, struct lookup_writer_t * writer ) {
     rc_t rc = src -> rc;
     if ( 0 == rc ) {
@@ -416,22 +399,36 @@ static rc_t background_vector_merger_process_batch( background_vector_merger_t *
                 self -> product_id += 1;
             }
             if ( 0 == rc ) {
-                bg_vec_merge_src_t * to_write = get_min_bg_vec_merge_src( batch, count ); /* above */
-                while( 0 == rc && NULL != to_write ) {
-                    rc = hlp_get_quitting();    /* helper.c */
-                    if ( 0 == rc ) {
-                        rc = write_bg_vec_merge_src( to_write, writer ); /* above */
+                struct merge_tree_t * tree; /* merge_tree.h */
+                rc = make_merge_tree( &tree, count ); /* merge_tree.c */
+                if ( 0 == rc ) {
+                    int32_t idx;
+                    uint32_t i;
+                    for ( i = 0; i < count; ++i ) {
+                        merge_tree_set( tree, i, batch[ i ] . key, 0 == batch[ i ] . rc ); /* merge_tree.c */
+                    }
+                    merge_tree_build( tree ); /* merge_tree.c */
+                    idx = merge_tree_top( tree ); /* merge_tree.c */
+                    while( 0 == rc && idx >= 0 ) {
+                        rc = hlp_get_quitting();    /* helper.c */
                         if ( 0 == rc ) {
-                            self -> total++;
-                            to_write = get_min_bg_vec_merge_src( batch, count ); /* above */
-                        } else {
-                            to_write = NULL;
-                        }
-                        bg_update_update( self -> gap, 1 );
-                        if ( 0 != rc ) {
-                            hlp_set_quitting();     /* helper.c */
+                            bg_vec_merge_src_t * to_write = &( batch[ idx ] );
+                            rc = write_bg_vec_merge_src( to_write, writer ); /* above */
+                            if ( 0 == rc ) {
+                                self -> total++;
+                                merge_tree_replace_top( tree, to_write -> key, 0 == to_write -> rc ); /* merge_tree.c */
+                                idx = merge_tree_top( tree ); /* merge_tree.c */
+                            }
+                            bg_update_update( self -> gap, 1 );
+                            if ( 0 != rc ) {
+                                hlp_set_quitting();     /* helper.c */
+                            }
                         }
                     }
+                    release_merge_tree( tree ); /* merge_tree.c */
+                }
+                if ( 0 == rc ) {
+                    rc = flush_lookup_writer( writer ); /* lookup_writer.c */
                 }
                 release_lookup_writer( writer ); /* lookup_writer.c */
             }
@@ -0,0 +1,177 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "merge_tree.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+/* a node holds the key together with the source, no indirection while replaying the matches */
+typedef struct merge_tree_node_t {
+    uint64_t key;           /* UINT64_MAX if the source is exhausted */
+    uint32_t idx;
+} merge_tree_node_t;
+
+typedef struct merge_tree_t {
+    merge_tree_node_t * losers; /* losers[ 0 ] is the winner, losers[ 1..count-1 ] the internal nodes */
+    merge_tree_node_t * winners;/* only used while building the tree */
+    bool * valid;               /* false if the source is exhausted */
+    uint32_t count;
+} merge_tree_t;
+
+void release_merge_tree( struct merge_tree_t * self ) {
+    if ( NULL != self ) {
+        if ( NULL != self -> losers ) { free( ( void * ) self -> losers ); }
+        if ( NULL != self -> winners ) { free( ( void * ) self -> winners ); }
+        if ( NULL != self -> valid ) { free( ( void * ) self -> valid ); }
+        free( ( void * ) self );
+    }
+}
+
+rc_t make_merge_tree( struct merge_tree_t ** tree, uint32_t count ) {
+    rc_t rc = 0;
+    if ( NULL == tree ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "make_merge_tree() -> %R", rc );
+    } else {
+        merge_tree_t * t = calloc( 1, sizeof * t );
+        *tree = NULL;
+        if ( NULL == t ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "make_merge_tree().calloc( %d ) -> %R", ( sizeof * t ), rc );
+        } else {
+            t -> count = count; /* 0 is allowed: merge_tree_top() returns -1 */
+            t -> losers = calloc( count + 1, sizeof *( t -> losers ) );
+            t -> winners = calloc( 2 * count + 1, sizeof *( t -> winners ) );
+            t -> valid = calloc( count + 1, sizeof *( t -> valid ) );
+            if ( NULL == t -> losers || NULL == t -> winners || NULL == t -> valid ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "make_merge_tree().calloc( %u ) -> %R", count, rc );
+                release_merge_tree( t );
+            } else {
+                *tree = t;
+            }
+        }
+    }
+    return rc;
+}
+
+void merge_tree_set( struct merge_tree_t * self, uint32_t idx, uint64_t key, bool valid ) {
+    if ( NULL != self && idx < self -> count ) {
+        merge_tree_node_t * leaf = &( self -> winners[ self -> count + idx ] );
+        leaf -> key = valid ? key : UINT64_MAX;
+        leaf -> idx = idx;
+        self -> valid[ idx ] = valid;
+    }
+}
+
+/* does node a win against node b? exhausted sources have the biggest possible key,
+   on equal keys the smaller source-index wins */
+static inline bool merge_tree_wins( const merge_tree_node_t * a, const merge_tree_node_t * b ) {
+    return ( a -> key < b -> key ) || ( a -> key == b -> key && a -> idx < b -> idx );
+}
+
+/* below MERGE_TREE_MIN_FAN_IN: the leaf with the smallest key becomes the winner */
+static void merge_tree_scan( merge_tree_t * self ) {
+    const merge_tree_node_t * leaves = &( self -> winners[ self -> count ] );
+    const merge_tree_node_t * winner = &( leaves[ 0 ] );
+    uint32_t idx;
+    for ( idx = 1; idx < self -> count; ++idx ) {
+        if ( leaves[ idx ] . key < winner -> key ) {
+            winner = &( leaves[ idx ] );
+        }
+    }
+    self -> losers[ 0 ] = *winner;
+}
+
+/* replay the matches from the leaf of the current winner up to the root */
+static void merge_tree_adjust( merge_tree_t * self, merge_tree_node_t winner ) {
+    uint32_t node = ( winner . idx + self -> count ) >> 1;
+    while ( node > 0 ) {
+        merge_tree_node_t * loser = &( self -> losers[ node ] );
+        if ( merge_tree_wins( loser, &winner ) ) {
+            merge_tree_node_t tmp = *loser;
+            *loser = winner;
+            winner = tmp;
+        }
+        node >>= 1;
+    }
+    self -> losers[ 0 ] = winner;
+}
+
+void merge_tree_build( struct merge_tree_t * self ) {
+    if ( NULL != self && self -> count > 0 && self -> count < MERGE_TREE_MIN_FAN_IN ) {
+        merge_tree_scan( self );
+    } else if ( NULL != self && self -> count > 0 ) {
+        uint32_t count = self -> count;
+        merge_tree_node_t * w = self -> winners;
+        uint32_t node;
+        /* the leaves are the nodes count...2*count-1 ( filled by merge_tree_set() ),
+           play the matches bottom up: the winner moves up, the loser stays in the node */
+        for ( node = count - 1; node > 0; --node ) {
+            merge_tree_node_t * a = &( w[ 2 * node ] );
+            merge_tree_node_t * b = &( w[ 2 * node + 1 ] );
+            if ( merge_tree_wins( a, b ) ) {
+                w[ node ] = *a;
+                self -> losers[ node ] = *b;
+            } else {
+                w[ node ] = *b;
+                self -> losers[ node ] = *a;
+            }
+        }
+        self -> losers[ 0 ] = w[ ( count > 1 ) ? 1 : count ];
+    }
+}
+
+int32_t merge_tree_top( const struct merge_tree_t * self ) {
+    int32_t res = -1;
+    if ( NULL != self && self -> count > 0 ) {
+        uint32_t winner = self -> losers[ 0 ] . idx;
+        if ( self -> valid[ winner ] ) {
+            res = ( int32_t )winner;
+        }
+    }
+    return res;
+}
+
+uint64_t merge_tree_top_key( const struct merge_tree_t * self ) {
+    return self -> losers[ 0 ] . key;
+}
+
+void merge_tree_replace_top( struct merge_tree_t * self, uint64_t key, bool valid ) {
+    if ( NULL != self && self -> count > 0 ) {
+        merge_tree_node_t winner = self -> losers[ 0 ];
+        winner . key = valid ? key : UINT64_MAX;
+        self -> valid[ winner . idx ] = valid;
+        if ( self -> count < MERGE_TREE_MIN_FAN_IN ) {
+            self -> winners[ self -> count + winner . idx ] = winner;
+            merge_tree_scan( self );
+        } else {
+            merge_tree_adjust( self, winner );
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_merge_tree_
+#define _h_merge_tree_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* ---------------------------------------------------------------------------------
+    a loser-tree ( tournament-tree ) to perform a k-way merge
+    the tree does not know about the sources, it just holds one key per source
+    and a flag if the source is still valid ( not exhausted ).
+
+    usage:
+        make_merge_tree( &t, count );
+        for each source i : merge_tree_set( t, i, first-key, valid );
+        merge_tree_build( t );
+        while ( ( idx = merge_tree_top( t ) ) >= 0 ) {
+            ... write the current entry of source idx ...
+            ... advance source idx ...
+            merge_tree_replace_top( t, next-key, valid );
+        }
+
+    finding the next smallest key costs log2( count ) compares instead of count.
+    equal keys are returned in the order of the source-index, that is the same
+    order as a linear scan over the sources produces.
+
+    below MERGE_TREE_MIN_FAN_IN sources the replay of the matches costs more than
+    it saves ( see test/external/fasterq-dump/bench-merge.c ), with so few sources
+    the tree just scans the keys of all sources for the smallest one.
+   --------------------------------------------------------------------------------- */
+
+#define MERGE_TREE_MIN_FAN_IN 8
+
+struct merge_tree_t;
+
+rc_t make_merge_tree( struct merge_tree_t ** tree, uint32_t count );
+void release_merge_tree( struct merge_tree_t * self );
+
+/* set the initial key of a source, before merge_tree_build() */
+void merge_tree_set( struct merge_tree_t * self, uint32_t idx, uint64_t key, bool valid );
+void merge_tree_build( struct merge_tree_t * self );
+
+/* returns the index of the source with the smallest key, or -1 if all sources are exhausted */
+int32_t merge_tree_top( const struct merge_tree_t * self );
+uint64_t merge_tree_top_key( const struct merge_tree_t * self );
+
+/* the source returned by merge_tree_top() has advanced to a new key ( or is exhausted ) */
+void merge_tree_replace_top( struct merge_tree_t * self, uint64_t key, bool valid );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -37,6 +37,14 @@
 #include "file_tools.h"
 #endif
 
+#ifndef _h_out_compress_
+#include "out_compress.h"
+#endif
+
+#ifndef _h_telemetry_
+#include "telemetry.h"
+#endif
+
 #ifndef _h_klib_time_
 #include <klib/time.h>
 #endif
@@ -58,6 +66,8 @@ typedef struct multi_writer_block_t
     char * data;
     size_t len;
     size_t available;
+    SBuffer_t packed;       /* the compressed data, if compression is requested */
+    bool is_packed;         /* the writer-thread writes packed instead of data */
 } multi_writer_block_t;
 
 static multi_writer_block_t * mw_create_block( size_t size ) {
@@ -78,6 +88,7 @@ static multi_writer_block_t * mw_create_block( size_t size ) {
 
 static void mw_release_block( multi_writer_block_t * self ) {
     if ( NULL != self ) {
+        release_SBuffer( &( self -> packed ) ); /* sbuffer.c ( ignores NULL-addr ) */
         free( ( void * ) self -> data );
         free( ( void * ) self );
     }
@@ -163,6 +174,7 @@ typedef struct multi_writer_t {
     KQueue * empty_q;                   /* pre-allocated blocks to write to, client gets from it, thread puts to into it */
     KQueue * write_q;                   /* blocks to write, thread gets from it, client puts to into it */
     uint32_t q_wait_time;
+    compress_t compress;                /* helper.h */
 } multi_writer_t;
 
 static rc_t mw_get_block( KQueue * q, uint32_t timeout, multi_writer_block_t ** block ) {
@@ -243,6 +255,11 @@ void mw_release( struct multi_writer_t * self ) {
                 }
             }
             KThreadWait ( self -> thread, &rc );
+            if ( 0 == rc && NULL != self -> f ) {
+                /* all blocks are written: terminate the compressed file */
+                uint64_t written;
+                rc = ocmp_write_eof( self -> compress, self -> f, self -> pos, &written ); /* out_compress.c */
+            }
         }
 
         if ( NULL != self -> empty_q ) {
@@ -279,17 +296,23 @@ static rc_t CC mw_thread( const KThread * thread, void *data ) {
             ErrMsg( "copy_machine.c multi_writer_thread().TimeoutInit() -> %R", rc );
         } else {
             multi_writer_block_t * block;
+            uint64_t idle_start = tele_clock(); /* telemetry.c */
             rc = KQueuePop ( self -> write_q, ( void ** )&block, &tm );
+            tele_add_idle_since( idle_start ); /* telemetry.c */
             if ( 0 == rc ) {
                 /* we got a block to write out of the to_write_q */
 
                 if ( NULL != self -> f ) {
                     /* we have a file to write to... */
-                    if ( NULL != block -> data && block -> len > 0 ) {
+                    const char * data = block -> is_packed ? block -> packed . S . addr : block -> data;
+                    size_t len = block -> is_packed ? block -> packed . S . len : block -> len;
+                    if ( NULL != data && len > 0 ) {
                         size_t num_written;
-                        rc = KFileWrite( self -> f, self -> pos,
-                                        block -> data, block -> len, &num_written );
-                        if ( 0 == rc ) { self -> pos += num_written;  }
+                        rc = KFileWriteAll( self -> f, self -> pos, data, len, &num_written );
+                        if ( 0 == rc ) {
+                            self -> pos += num_written;
+                            tele_add_written( num_written ); /* telemetry.c */
+                        }
                     }
                 } else {
                     /* no file to print into, write to stdout! */
@@ -351,14 +374,22 @@ struct multi_writer_t * mw_create( KDirectory * dir,
                     size_t buf_size,
                     uint32_t q_wait_time,
                     uint32_t q_num_blocks,
-                    size_t q_block_size  ) {
+                    size_t q_block_size,
+                    compress_t compress ) {
     uint32_t wait_time = ( 0 == q_wait_time ) ? MULTI_WRITER_WAIT : q_wait_time;
     uint32_t num_blocks = ( 0 == q_num_blocks ) ? N_MULTI_WRITER_BLOCKS : q_num_blocks;
     uint32_t block_size = ( 0 == q_block_size ) ? MULTI_WRITER_BLOCK_SIZE : q_block_size;
     multi_writer_t * res = calloc( 1, sizeof * res );
     if ( NULL != res ) {
         rc_t rc = 0;
-        if ( NULL != filename ) {
+        if ( NULL == filename && ct_none != compress ) {
+            /* compressed output to stdout is not supported */
+            rc = RC( rcExe, rcFile, rcCreating, rcParam, rcUnsupported );
+            ErrMsg( "mw_create() : compressed output ( %s ) to stdout -> %R",
+                    hlp_compress_2_string( compress ), rc );
+            mw_release( res );
+            res = NULL;
+        } else if ( NULL != filename ) {
             rc = mw_create_file( res, dir, filename, buf_size );
             if ( 0 != rc ) {
                 mw_release( res );
@@ -368,6 +399,7 @@ struct multi_writer_t * mw_create( KDirectory * dir,
         if ( 0 == rc ) {
             /* create the empty queue */
             res -> q_wait_time = wait_time;
+            res -> compress = compress;
             rc = KQueueMake( &( res -> empty_q ), num_blocks );
             if ( 0 != rc ) {
                 ErrMsg( "mw_create().KQueueMake( '%s' ) -> %R", filename, rc );
@@ -407,9 +439,13 @@ struct multi_writer_t * mw_create( KDirectory * dir,
 struct multi_writer_block_t * mw_get_empty_block( struct multi_writer_t * self ) {
     struct multi_writer_block_t * block = NULL;
     if ( NULL != self ) {
+        /* if there is no empty block, the writer-thread cannot keep up with the producers */
+        uint64_t wait_start = tele_clock(); /* telemetry.c */
         rc_t rc = mw_get_block( self -> empty_q, self -> q_wait_time, &block );
+        tele_add_wait_since( wait_start ); /* telemetry.c */
         if ( 0 == rc ) {
             block -> len = 0;
+            block -> is_packed = false;
         } else {
             block = NULL;
         }
@@ -420,7 +456,22 @@ struct multi_writer_block_t * mw_get_empty_block( struct multi_writer_t * self )
 bool mw_submit_block( struct multi_writer_t * self, struct multi_writer_block_t * block ) {
     bool res = false;
     if ( NULL != self && NULL != block ) {
-        rc_t rc =  mw_push( self -> write_q, block, self -> q_wait_time );
+        rc_t rc = 0;
+        if ( ct_none != self -> compress ) {
+            /* this is the thread that produced the block: compress it here, in parallel with the others */
+            rc = ocmp_compress( self -> compress, block -> data, block -> len,
+                                &( block -> packed ) ); /* out_compress.c */
+            block -> is_packed = ( 0 == rc );
+        }
+        if ( 0 == rc ) {
+            uint64_t wait_start = tele_clock(); /* telemetry.c */
+            rc =  mw_push( self -> write_q, block, self -> q_wait_time );
+            tele_add_wait_since( wait_start ); /* telemetry.c */
+        } else {
+            /* the block will not be written: put it back into the empty-q, otherwise it is lost */
+            block -> is_packed = false;
+            mw_push( self -> empty_q, block, self -> q_wait_time ); /* above */
+        }
         res = ( 0 == rc );
     }
     return res;
@@ -39,6 +39,10 @@ extern "C" {
 #include <kfs/directory.h>
 #endif
 
+#ifndef _h_helper_
+#include "helper.h"     /* compress_t */
+#endif
+
 struct multi_writer_block_t;
 
 bool mw_append_block( struct multi_writer_block_t * self, const char * data, size_t len );
@@ -47,12 +51,14 @@ bool mw_expand_block( struct multi_writer_block_t * self, size_t size );
 
 struct multi_writer_t;
 
+/* compress != ct_none: the blocks are compressed by the thread submitting them */
 struct multi_writer_t * mw_create( KDirectory * dir,
                                     const char * filename,
                                     size_t buf_size,
                                     uint32_t q_wait_time,
                                     uint32_t q_num_blocks,
-                                    size_t q_block_size  );
+                                    size_t q_block_size,
+                                    compress_t compress );
 
 void mw_release( struct multi_writer_t * self );
 
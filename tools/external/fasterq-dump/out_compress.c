@@ -0,0 +1,221 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "out_compress.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_file_tools_
+#include "file_tools.h"
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#include <string.h>     /* memset, memmove */
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define OCMP_GZIP_LEVEL Z_DEFAULT_COMPRESSION
+#define OCMP_ZSTD_LEVEL 3
+
+/* BGZF as in the SAM/BAM-spec: a gzip-member with an extra-field 'BC' holding the size of the member */
+#define BGZF_MAX_MEMBER 0x10000
+#define BGZF_MAX_INPUT  0xff00      /* deflate of this much data always fits into a member */
+#define BGZF_HDR_SIZE   18
+#define BGZF_FTR_SIZE   8
+
+static const uint8_t bgzf_hdr[ BGZF_HDR_SIZE ] = {
+    0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+
+static const uint8_t bgzf_eof[ 28 ] = {
+    0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+bool ocmp_available( compress_t ct ) {
+    switch ( ct ) {
+        case ct_unknown : return false;
+        case ct_none    : return true;
+        case ct_gzip    : return true;
+#ifdef HAVE_ZSTD
+        case ct_zstd    : return true;
+#else
+        case ct_zstd    : return false;
+#endif
+    }
+    return false;
+}
+
+static void ocmp_put_u16( uint8_t * dst, uint32_t value ) {
+    dst[ 0 ] = value & 0xff;
+    dst[ 1 ] = ( value >> 8 ) & 0xff;
+}
+
+static void ocmp_put_u32( uint8_t * dst, uint32_t value ) {
+    ocmp_put_u16( dst, value );
+    ocmp_put_u16( dst + 2, value >> 16 );
+}
+
+static rc_t ocmp_gzip( const char * src, size_t src_len, SBuffer_t * dst ) {
+    size_t num_members = ( src_len + BGZF_MAX_INPUT - 1 ) / BGZF_MAX_INPUT;
+    rc_t rc = increase_SBuffer_to( dst, num_members * BGZF_MAX_MEMBER ); /* sbuffer.c */
+    if ( 0 != rc ) {
+        ErrMsg( "out_compress.c ocmp_gzip().increase_SBuffer_to() -> %R", rc );
+    } else {
+        z_stream zs;
+        int zr;
+        memset( &zs, 0, sizeof zs );
+        /* raw deflate: we write the gzip-header and -footer ourselfs */
+        zr = deflateInit2( &zs, OCMP_GZIP_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY );
+        if ( Z_OK != zr ) {
+            rc = RC( rcVDB, rcNoTarg, rcPacking, rcData, rcInvalid );
+            ErrMsg( "out_compress.c ocmp_gzip().deflateInit2() -> %d", zr );
+        } else {
+            uint8_t * out = ( uint8_t * )( dst -> S . addr );
+            size_t out_len = 0;
+            size_t in_pos = 0;
+            while ( 0 == rc && in_pos < src_len ) {
+                size_t in_len = src_len - in_pos;
+                uint8_t * member = out + out_len;
+                uint32_t member_size;
+                if ( in_len > BGZF_MAX_INPUT ) { in_len = BGZF_MAX_INPUT; }
+                zs . next_in = ( Bytef * )( src + in_pos );
+                zs . avail_in = ( uInt )in_len;
+                zs . next_out = member + BGZF_HDR_SIZE;
+                zs . avail_out = BGZF_MAX_MEMBER - ( BGZF_HDR_SIZE + BGZF_FTR_SIZE );
+                zr = deflate( &zs, Z_FINISH );
+                if ( Z_STREAM_END != zr ) {
+                    rc = RC( rcVDB, rcNoTarg, rcPacking, rcData, rcInvalid );
+                    ErrMsg( "out_compress.c ocmp_gzip().deflate() -> %d", zr );
+                } else {
+                    member_size = ( uint32_t )( ( zs . next_out - member ) + BGZF_FTR_SIZE );
+                    memmove( member, bgzf_hdr, BGZF_HDR_SIZE );
+                    ocmp_put_u16( member + 16, member_size - 1 );
+                    ocmp_put_u32( member + member_size - 8,
+                                  crc32( crc32( 0, NULL, 0 ), ( const Bytef * )( src + in_pos ), ( uInt )in_len ) );
+                    ocmp_put_u32( member + member_size - 4, ( uint32_t )in_len );
+                    out_len += member_size;
+                    in_pos += in_len;
+                    zr = deflateReset( &zs );
+                }
+            }
+            deflateEnd( &zs );
+            dst -> S . size = out_len;
+            dst -> S . len = ( uint32_t )out_len;
+        }
+    }
+    return rc;
+}
+
+static rc_t ocmp_zstd( const char * src, size_t src_len, SBuffer_t * dst ) {
+    rc_t rc;
+#ifdef HAVE_ZSTD
+    rc = increase_SBuffer_to( dst, ZSTD_compressBound( src_len ) ); /* sbuffer.c */
+    if ( 0 != rc ) {
+        ErrMsg( "out_compress.c ocmp_zstd().increase_SBuffer_to() -> %R", rc );
+    } else {
+        size_t res = ZSTD_compress( ( void * )( dst -> S . addr ), dst -> buffer_size,
+                                    src, src_len, OCMP_ZSTD_LEVEL );
+        if ( ZSTD_isError( res ) ) {
+            rc = RC( rcVDB, rcNoTarg, rcPacking, rcData, rcInvalid );
+            ErrMsg( "out_compress.c ocmp_zstd().ZSTD_compress() -> %s", ZSTD_getErrorName( res ) );
+        } else {
+            dst -> S . size = res;
+            dst -> S . len = ( uint32_t )res;
+        }
+    }
+#else
+    rc = RC( rcVDB, rcNoTarg, rcPacking, rcFormat, rcUnsupported );
+    ErrMsg( "out_compress.c ocmp_zstd() : not built with zstd -> %R", rc );
+#endif
+    return rc;
+}
+
+rc_t ocmp_compress( compress_t ct, const char * src, size_t src_len, SBuffer_t * dst ) {
+    rc_t rc = 0;
+    if ( NULL == dst || ( NULL == src && src_len > 0 ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcPacking, rcParam, rcNull );
+        ErrMsg( "out_compress.c ocmp_compress() -> %R", rc );
+    } else if ( 0 == src_len ) {
+        /* an empty block produces nothing, not even an empty member */
+        dst -> S . size = 0;
+        dst -> S . len = 0;
+    } else {
+        switch ( ct ) {
+            case ct_gzip : rc = ocmp_gzip( src, src_len, dst ); break;
+            case ct_zstd : rc = ocmp_zstd( src, src_len, dst ); break;
+            default      : rc = RC( rcVDB, rcNoTarg, rcPacking, rcParam, rcInvalid );
+                           ErrMsg( "out_compress.c ocmp_compress( %s ) -> %R", hlp_compress_2_string( ct ), rc );
+                           break;
+        }
+    }
+    return rc;
+}
+
+rc_t ocmp_write_eof( compress_t ct, struct KFile * f, uint64_t pos, uint64_t * written ) {
+    rc_t rc = 0;
+    *written = 0;
+    if ( ct_gzip == ct ) {
+        size_t num_writ;
+        rc = KFileWriteAll( f, pos, bgzf_eof, sizeof bgzf_eof, &num_writ );
+        if ( 0 != rc ) {
+            ErrMsg( "out_compress.c ocmp_write_eof().KFileWriteAll() -> %R", rc );
+        } else {
+            *written = num_writ;
+        }
+    }
+    return rc;
+}
+
+rc_t ocmp_append_eof( compress_t ct, KDirectory * dir, const char * filename ) {
+    rc_t rc = 0;
+    if ( ct_gzip == ct ) {
+        uint64_t pos;
+        rc = KDirectoryFileSize( dir, &pos, "%s", filename );
+        if ( 0 != rc ) {
+            ErrMsg( "out_compress.c ocmp_append_eof().KDirectoryFileSize( '%s' ) -> %R", filename, rc );
+        } else {
+            struct KFile * f;
+            rc = KDirectoryOpenFileWrite( dir, &f, true, "%s", filename );
+            if ( 0 != rc ) {
+                ErrMsg( "out_compress.c ocmp_append_eof().KDirectoryOpenFileWrite( '%s' ) -> %R", filename, rc );
+            } else {
+                uint64_t written;
+                rc = ocmp_write_eof( ct, f, pos, &written ); /* above */
+                {
+                    rc_t rc2 = ft_release_file( f, "ocmp_append_eof( '%s' )", filename ); /* file_tools.c */
+                    rc = ( 0 == rc ) ? rc2 : rc;
+                }
+            }
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,75 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_out_compress_
+#define _h_out_compress_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"     /* compress_t */
+#endif
+
+#ifndef _h_sbuffer_
+#include "sbuffer.h"
+#endif
+
+/* ----------------------------------------------------------------------------------------------
+    compressed output: each block of output is compressed independently by the thread that
+    produced it ( gzip: BGZF-members of max. 64k, zstd: one frame per block ). Independent
+    members/frames can be concatenated as they are: the temp-files are still concatenated
+    by a plain copy and the order of the output does not change. The BGZF-members also allow
+    readers to seek into the output.
+   ---------------------------------------------------------------------------------------------- */
+
+/* how much uncompressed output is collected before it is compressed ( per thread and file ) */
+#define OCMP_BLOCK_SIZE ( 1024 * 1024 )
+
+/* zstd is only available if the tool was built with libzstd */
+bool ocmp_available( compress_t ct );
+
+/* dst is overwritten, and enlarged if necessary */
+rc_t ocmp_compress( compress_t ct, const char * src, size_t src_len, SBuffer_t * dst );
+
+/* gzip: write the BGZF-EOF-marker ( an empty member ) at the end of a file, nothing for zstd */
+rc_t ocmp_write_eof( compress_t ct, struct KFile * f, uint64_t pos, uint64_t * written );
+rc_t ocmp_append_eof( compress_t ct, KDirectory * dir, const char * filename );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
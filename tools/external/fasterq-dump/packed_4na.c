@@ -0,0 +1,304 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "packed_4na.h"
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define P4NA_X86 1
+#include <immintrin.h>
+#else
+#define P4NA_X86 0
+#endif
+
+static const char xASCII_to_4na[ 256 ] = {
+    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x10 0x11 0x12 0x13 0x14 0x15 0x16 0x17 0x18 0x19 0x1A 0x1B 0x1C 0x1D 0x1E 0x1F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x20 0x21 0x22 0x23 0x24 0x25 0x26 0x27 0x28 0x29 0x2A 0x2B 0x2C 0x2D 0x2E 0x2F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x30 0x31 0x32 0x33 0x34 0x35 0x36 0x37 0x38 0x39 0x3A 0x3B 0x3C 0x3D 0x3E 0x3F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x40 0x41 0x42 0x43 0x44 0x45 0x46 0x47 0x48 0x49 0x4A 0x4B 0x4C 0x4D 0x4E 0x4F */
+    /* @    A    B    C    D    E    F    G    H    I    J    K    L    M    N    O */
+       0,   1,   0,   2,   0,   0,   0,   4,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x50 0x51 0x52 0x53 0x54 0x55 0x56 0x57 0x58 0x59 0x5A 0x5B 0x5C 0x5D 0x5E 0x5F */
+    /* P    Q    R    S    T    U    V    W    X    Y    Z    [    \    ]    ^    _ */
+       0,   0,   0,   0,   8,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x60 0x61 0x62 0x63 0x64 0x65 0x66 0x67 0x68 0x69 0x6A 0x6B 0x6C 0x6D 0x6E 0x6F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x70 0x71 0x72 0x73 0x74 0x75 0x76 0x77 0x78 0x79 0x7A 0x7B 0x7C 0x7D 0x7E 0x7F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x80 0x81 0x82 0x83 0x84 0x85 0x86 0x87 0x88 0x89 0x8A 0x8B 0x8C 0x8D 0x8E 0x8F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0x90 0x91 0x92 0x93 0x94 0x95 0x96 0x97 0x98 0x99 0x9A 0x9B 0x9C 0x9D 0x9E 0x9F */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xA0 0xA1 0xA2 0xA3 0xA4 0xA5 0xA6 0xA7 0xA8 0xA9 0xAA 0xAB 0xAC 0xAD 0xAE 0xAF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xB0 0xB1 0xB2 0xB3 0xB4 0xB5 0xB6 0xB7 0xB8 0xB9 0xBA 0xBB 0xBC 0xBD 0xBE 0xBF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xC0 0xC1 0xC2 0xC3 0xC4 0xC5 0xC6 0xC7 0xC8 0xC9 0xCA 0xCB 0xCC 0xCD 0xCE 0xCF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xD0 0xD1 0xD2 0xD3 0xD4 0xD5 0xD6 0xD7 0xD8 0xD9 0xDA 0xDB 0xDC 0xDD 0xDE 0xDF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xE0 0xE1 0xE2 0xE3 0xE4 0xE5 0xE6 0xE7 0xE8 0xE9 0xEA 0xEB 0xEC 0xED 0xEE 0xEF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+
+    /* 0xF0 0xF1 0xF2 0xF3 0xF4 0xF5 0xF6 0xF7 0xF8 0xF9 0xFA 0xFB 0xFC 0xFD 0xFE 0xFF */
+       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+/* 16 bytes each: loaded as a shuffle-table by the SIMD-versions */
+static const char x4na_to_ASCII_fwd[ 16 ] = {
+    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
+       'N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
+};
+
+static const char x4na_to_ASCII_rev[ 16 ] = {
+    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
+       'N', 'T', 'G', 'N', 'C', 'N', 'N', 'N', 'A', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
+};
+
+/* ---------------------------------------------------------------------------------
+    scalar: the reference for all other implementations, and the tail of them
+   --------------------------------------------------------------------------------- */
+
+/* start has to be even */
+static void p4na_pack_scalar( const uint8_t * ascii, uint32_t start, uint32_t count, uint8_t * dst ) {
+    uint32_t i;
+    for ( i = start; i + 1 < count; i += 2 ) {
+        uint8_t hi = xASCII_to_4na[ ascii[ i ] ] & 0x0F;
+        uint8_t lo = xASCII_to_4na[ ascii[ i + 1 ] ] & 0x0F;
+        dst[ i >> 1 ] = ( hi << 4 ) | lo;
+    }
+    if ( i < count ) {
+        dst[ i >> 1 ] = ( xASCII_to_4na[ ascii[ i ] ] & 0x0F ) << 4;
+    }
+}
+
+static void p4na_unpack_scalar( const uint8_t * src, uint32_t start, uint32_t count, char * dst, bool reverse ) {
+    const char * lookup = reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd;
+    uint32_t i;
+    for ( i = start; i < count; ++i ) {
+        uint8_t packed_byte = src[ i >> 1 ];
+        uint8_t base = ( i & 1 ) ? ( packed_byte & 0x0F ) : ( packed_byte >> 4 );
+        dst[ reverse ? count - 1 - i : i ] = lookup[ base ];
+    }
+}
+
+#if P4NA_X86
+
+/* ---------------------------------------------------------------------------------
+    SSE4.1: 16 bases per round
+    the 16-base blocks are always inlined, the AVX2-versions use them for their tail
+    ( a call into non-VEX SSE-code from AVX-code would cost a state-transition )
+   --------------------------------------------------------------------------------- */
+
+#define P4NA_SSE41_INLINE __attribute__(( target( "sse4.1" ), always_inline )) static inline
+
+P4NA_SSE41_INLINE void p4na_pack16_sse41( const uint8_t * ascii, uint8_t * dst ) {
+    /* even byte * 16 + odd byte * 1 --> one packed byte per 16-bit lane */
+    const __m128i weights = _mm_set1_epi16( 0x0110 );
+    __m128i a = _mm_loadu_si128( ( const __m128i * )ascii );
+    __m128i A = _mm_and_si128( _mm_cmpeq_epi8( a, _mm_set1_epi8( 'A' ) ), _mm_set1_epi8( 1 ) );
+    __m128i C = _mm_and_si128( _mm_cmpeq_epi8( a, _mm_set1_epi8( 'C' ) ), _mm_set1_epi8( 2 ) );
+    __m128i G = _mm_and_si128( _mm_cmpeq_epi8( a, _mm_set1_epi8( 'G' ) ), _mm_set1_epi8( 4 ) );
+    __m128i T = _mm_and_si128( _mm_cmpeq_epi8( a, _mm_set1_epi8( 'T' ) ), _mm_set1_epi8( 8 ) );
+    __m128i n = _mm_or_si128( _mm_or_si128( A, C ), _mm_or_si128( G, T ) );
+    __m128i p = _mm_maddubs_epi16( n, weights );
+    _mm_storel_epi64( ( __m128i * )dst, _mm_packus_epi16( p, p ) );
+}
+
+/* unpacks the bases i...i+15 */
+P4NA_SSE41_INLINE void p4na_unpack16_sse41( const uint8_t * src, uint32_t i, uint32_t count,
+                                            char * dst, bool reverse ) {
+    const __m128i lut = _mm_loadu_si128( ( const __m128i * )( reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd ) );
+    const __m128i mask = _mm_set1_epi8( 0x0F );
+    __m128i p = _mm_loadl_epi64( ( const __m128i * )( src + ( i >> 1 ) ) );
+    __m128i hi = _mm_and_si128( _mm_srli_epi16( p, 4 ), mask );
+    __m128i lo = _mm_and_si128( p, mask );
+    __m128i a = _mm_shuffle_epi8( lut, _mm_unpacklo_epi8( hi, lo ) );
+    if ( reverse ) {
+        const __m128i backwards = _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+        _mm_storeu_si128( ( __m128i * )( dst + count - i - 16 ), _mm_shuffle_epi8( a, backwards ) );
+    } else {
+        _mm_storeu_si128( ( __m128i * )( dst + i ), a );
+    }
+}
+
+__attribute__(( target( "sse4.1" ) ))
+static void p4na_pack_sse41( const uint8_t * ascii, uint32_t count, uint8_t * dst ) {
+    uint32_t i = 0;
+    for ( ; i + 16 <= count; i += 16 ) {
+        p4na_pack16_sse41( ascii + i, dst + ( i >> 1 ) );
+    }
+    p4na_pack_scalar( ascii, i, count, dst );
+}
+
+__attribute__(( target( "sse4.1" ) ))
+static void p4na_unpack_sse41( const uint8_t * src, uint32_t count, char * dst, bool reverse ) {
+    uint32_t i = 0;
+    for ( ; i + 16 <= count; i += 16 ) {
+        p4na_unpack16_sse41( src, i, count, dst, reverse );
+    }
+    p4na_unpack_scalar( src, i, count, dst, reverse );
+}
+
+/* ---------------------------------------------------------------------------------
+    AVX2: 32 bases per round
+   --------------------------------------------------------------------------------- */
+
+__attribute__(( target( "avx2" ) ))
+static void p4na_pack_avx2( const uint8_t * ascii, uint32_t count, uint8_t * dst ) {
+    const __m256i weights = _mm256_set1_epi16( 0x0110 );
+    const __m256i vA = _mm256_set1_epi8( 'A' ), vC = _mm256_set1_epi8( 'C' );
+    const __m256i vG = _mm256_set1_epi8( 'G' ), vT = _mm256_set1_epi8( 'T' );
+    uint32_t i = 0;
+    for ( ; i + 32 <= count; i += 32 ) {
+        __m256i a = _mm256_loadu_si256( ( const __m256i * )( ascii + i ) );
+        __m256i A = _mm256_and_si256( _mm256_cmpeq_epi8( a, vA ), _mm256_set1_epi8( 1 ) );
+        __m256i C = _mm256_and_si256( _mm256_cmpeq_epi8( a, vC ), _mm256_set1_epi8( 2 ) );
+        __m256i G = _mm256_and_si256( _mm256_cmpeq_epi8( a, vG ), _mm256_set1_epi8( 4 ) );
+        __m256i T = _mm256_and_si256( _mm256_cmpeq_epi8( a, vT ), _mm256_set1_epi8( 8 ) );
+        __m256i n = _mm256_or_si256( _mm256_or_si256( A, C ), _mm256_or_si256( G, T ) );
+        __m256i p = _mm256_maddubs_epi16( n, weights );
+        /* packus works per 128-bit lane: move the 2 valid quad-words together */
+        p = _mm256_permute4x64_epi64( _mm256_packus_epi16( p, p ), 0x08 );
+        _mm_storeu_si128( ( __m128i * )( dst + ( i >> 1 ) ), _mm256_castsi256_si128( p ) );
+    }
+    if ( i + 16 <= count ) {
+        p4na_pack16_sse41( ascii + i, dst + ( i >> 1 ) );
+        i += 16;
+    }
+    p4na_pack_scalar( ascii, i, count, dst );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void p4na_unpack_avx2( const uint8_t * src, uint32_t count, char * dst, bool reverse ) {
+    const __m256i lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128( ( const __m128i * )( reverse ? x4na_to_ASCII_rev : x4na_to_ASCII_fwd ) ) );
+    const __m256i mask = _mm256_set1_epi16( 0x0F );
+    const __m256i backwards = _mm256_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                               0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+    uint32_t i = 0;
+    for ( ; i + 32 <= count; i += 32 ) {
+        /* one packed byte per 16-bit lane: high nibble into the low byte, low nibble into the high byte */
+        __m256i w = _mm256_cvtepu8_epi16( _mm_loadu_si128( ( const __m128i * )( src + ( i >> 1 ) ) ) );
+        __m256i hi = _mm256_and_si256( _mm256_srli_epi16( w, 4 ), mask );
+        __m256i lo = _mm256_slli_epi16( _mm256_and_si256( w, mask ), 8 );
+        __m256i a = _mm256_shuffle_epi8( lut, _mm256_or_si256( hi, lo ) );
+        if ( reverse ) {
+            a = _mm256_shuffle_epi8( a, backwards );
+            a = _mm256_permute2x128_si256( a, a, 0x01 );
+            _mm256_storeu_si256( ( __m256i * )( dst + count - i - 32 ), a );
+        } else {
+            _mm256_storeu_si256( ( __m256i * )( dst + i ), a );
+        }
+    }
+    if ( i + 16 <= count ) {
+        p4na_unpack16_sse41( src, i, count, dst, reverse );
+        i += 16;
+    }
+    p4na_unpack_scalar( src, i, count, dst, reverse );
+}
+
+#endif /* P4NA_X86 */
+
+/* ---------------------------------------------------------------------------------
+    runtime dispatch
+   --------------------------------------------------------------------------------- */
+
+static p4na_impl_t p4na_forced_impl = p4na_auto;
+
+static bool p4na_supported( p4na_impl_t impl ) {
+    switch( impl ) {
+        case p4na_auto   : return true;
+        case p4na_scalar : return true;
+#if P4NA_X86
+        case p4na_sse41  : return __builtin_cpu_supports( "sse4.1" );
+        case p4na_avx2   : return __builtin_cpu_supports( "avx2" );
+#endif
+        default : return false;
+    }
+}
+
+p4na_impl_t p4na_get_impl( void ) {
+    if ( p4na_auto != p4na_forced_impl ) { return p4na_forced_impl; }
+    /* __builtin_cpu_supports() is just a bit-test on data initialized at program start */
+    if ( p4na_supported( p4na_avx2 ) ) { return p4na_avx2; }
+    if ( p4na_supported( p4na_sse41 ) ) { return p4na_sse41; }
+    return p4na_scalar;
+}
+
+bool p4na_set_impl( p4na_impl_t impl ) {
+    bool res = p4na_supported( impl );
+    if ( res ) { p4na_forced_impl = impl; }
+    return res;
+}
+
+const char * p4na_impl_name( p4na_impl_t impl ) {
+    switch( impl ) {
+        case p4na_auto   : return "auto";
+        case p4na_scalar : return "scalar";
+        case p4na_sse41  : return "sse4.1";
+        case p4na_avx2   : return "avx2";
+    }
+    return "unknown";
+}
+
+void p4na_pack( const uint8_t * ascii, uint32_t count, uint8_t * dst ) {
+    switch( p4na_get_impl() ) {
+#if P4NA_X86
+        case p4na_avx2  : p4na_pack_avx2( ascii, count, dst ); break;
+        case p4na_sse41 : p4na_pack_sse41( ascii, count, dst ); break;
+#endif
+        default : p4na_pack_scalar( ascii, 0, count, dst ); break;
+    }
+}
+
+void p4na_unpack( const uint8_t * src, uint32_t count, char * dst, bool reverse ) {
+    switch( p4na_get_impl() ) {
+#if P4NA_X86
+        case p4na_avx2  : p4na_unpack_avx2( src, count, dst, reverse ); break;
+        case p4na_sse41 : p4na_unpack_sse41( src, count, dst, reverse ); break;
+#endif
+        default : p4na_unpack_scalar( src, 0, count, dst, reverse ); break;
+    }
+}
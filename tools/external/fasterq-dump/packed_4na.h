@@ -0,0 +1,70 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_packed_4na_
+#define _h_packed_4na_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+/* ---------------------------------------------------------------------------------
+    ASCII <-> packed 4na ( 2 bases per byte, first base in the high nibble )
+    as stored in the lookup-table ( sorter.c, lookup_reader.c, mem_lookup.c )
+
+    A=1, C=2, G=4, T=8 - every other character is packed as 0 ( read back as 'N' )
+
+    on x86_64 the best implementation ( AVX2, SSE4.1 or scalar ) is picked at
+    runtime, every implementation produces byte-identical output
+   --------------------------------------------------------------------------------- */
+
+typedef enum p4na_impl_t { p4na_auto = 0, p4na_scalar, p4na_sse41, p4na_avx2 } p4na_impl_t;
+
+/* pack count ASCII-bases into dst, dst must have room for ( count + 1 ) / 2 bytes,
+   if count is odd the low nibble of the last byte is 0 */
+void p4na_pack( const uint8_t * ascii, uint32_t count, uint8_t * dst );
+
+/* unpack count bases from src into dst ( dst must have room for count bytes ),
+   if reverse is true: write the reverse-complement */
+void p4na_unpack( const uint8_t * src, uint32_t count, char * dst, bool reverse );
+
+/* for tests and benchmarks: force an implementation, returns false if the cpu cannot do it,
+   p4na_auto restores the runtime detection, not thread-safe: call it before any work starts */
+bool p4na_set_impl( p4na_impl_t impl );
+
+/* the implementation that is used right now */
+p4na_impl_t p4na_get_impl( void );
+const char * p4na_impl_name( p4na_impl_t impl );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
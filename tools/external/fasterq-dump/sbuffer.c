@@ -38,6 +38,8 @@
 #include <klib/printf.h>    /* string_vprintf */
 #endif
 
+#include <string.h>         /* memcpy */
+
 rc_t make_SBuffer( SBuffer_t * buffer, size_t len ) {
     rc_t rc = 0;
     String * S = &buffer -> S;
@@ -153,6 +155,17 @@ rc_t split_filename_insert_idx( SBuffer_t * dst, size_t dst_size,
         StringInitCString( &S_in, filename );
         /* rc = hlp_split_string_r( &S_in, &S_name, &S_ext, '.' ); */ /* helper.c */
         rc = hlp_split_path_into_stem_and_extension( &S_in, &S_name, &S_ext );
+        if ( 0 == rc && hlp_is_compress_ext( &S_ext ) ) { /* helper.c */
+            /* 'x.fastq.gz' -> 'x_1.fastq.gz' and not 'x.fastq_1.gz' */
+            String S_stem = S_name, S_name2, S_ext2;
+            if ( 0 == hlp_split_path_into_stem_and_extension( &S_stem, &S_name2, &S_ext2 ) &&
+                 S_ext2 . len > 0 ) {
+                S_name = S_name2;
+                S_ext . addr = S_ext2 . addr;
+                S_ext . size = ( S_in . addr + S_in . size ) - S_ext2 . addr;
+                S_ext . len = ( uint32_t )S_ext . size;
+            }
+        }
         if ( 0 == rc ) {
             /* we found a dot to split the filename! */
             if ( S_ext . len > 0 ) {
@@ -238,3 +251,31 @@ rc_t clear_SBuffer( SBuffer_t * self ) {
     }
     return rc;
 }
+
+rc_t append_bytes_to_SBuffer( SBuffer_t * self, const char * src, size_t len ) {
+    rc_t rc = 0;
+    if ( NULL == self || ( NULL == src && len > 0 ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcSelf, rcNull );
+    } else {
+        size_t needed = self -> S . size + len;
+        if ( needed > self -> buffer_size ) {
+            size_t new_size = self -> buffer_size * 2;
+            char * p;
+            if ( new_size < needed ) { new_size = needed; }
+            p = realloc( ( void * )self -> S . addr, new_size );
+            if ( NULL == p ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                ErrMsg( "append_bytes_to_SBuffer().realloc( %lu ) -> %R", new_size, rc );
+            } else {
+                self -> S . addr = p;
+                self -> buffer_size = new_size;
+            }
+        }
+        if ( 0 == rc && len > 0 ) {
+            memcpy( ( char * )&( self -> S . addr[ self -> S . size ] ), src, len );
+            self -> S . size += len;
+            self -> S . len = ( uint32_t )self -> S . size;
+        }
+    }
+    return rc;
+}
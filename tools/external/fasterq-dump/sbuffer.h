@@ -61,6 +61,9 @@ rc_t copy_SBuffer( SBuffer_t * self, const SBuffer_t * src );
 rc_t append_SBuffer( SBuffer_t * self, const SBuffer_t * src );
 rc_t clear_SBuffer( SBuffer_t * self );
 
+/* appends without the copy-over of append_SBuffer(), grows the buffer geometrically */
+rc_t append_bytes_to_SBuffer( SBuffer_t * self, const char * src, size_t len );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,638 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "shard.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_file_tools_
+#include "file_tools.h"
+#endif
+
+#ifndef _h_concat_
+#include "concatenator.h"
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#ifndef _h_klib_printf_
+#include <klib/printf.h>
+#endif
+
+#ifndef _h_klib_out_
+#include <klib/out.h>
+#endif
+
+#ifndef _h_klib_vector_
+#include <klib/vector.h>
+#endif
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARD_MAX_MANIFEST ( 1024 * 1024 )
+
+/* ---------------------------------------------------------------------------------- */
+
+rc_t shard_parse_idx( shard_t * self, const char * s ) {
+    rc_t rc = 0;
+    char * end = NULL;
+    unsigned long long idx = strtoull( s, &end, 10 );
+    unsigned long long count = 0;
+    if ( NULL != end && '/' == *end ) {
+        count = strtoull( end + 1, &end, 10 );
+    }
+    if ( NULL == end || 0 != *end || 0 == idx || idx > count || count > UINT32_MAX ) {
+        rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcInvalid );
+        ErrMsg( "invalid shard '%s', expected 'idx/count' with 1 <= idx <= count -> %R", s, rc );
+    } else {
+        self -> requested = true;
+        self -> idx = ( uint32_t )idx;
+        self -> count = ( uint32_t )count;
+    }
+    return rc;
+}
+
+rc_t shard_parse_rows( shard_t * self, const char * s ) {
+    rc_t rc = 0;
+    char * end = NULL;
+    long long first = strtoll( s, &end, 10 );
+    long long last = 0;
+    if ( NULL != end && '-' == *end ) {
+        last = strtoll( end + 1, &end, 10 );
+    }
+    if ( NULL == end || 0 != *end || first < 1 || last < first ) {
+        rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcInvalid );
+        ErrMsg( "invalid row-range '%s', expected 'first-last' with 1 <= first <= last -> %R", s, rc );
+    } else {
+        self -> requested = true;
+        self -> idx = 0;
+        self -> count = 0;
+        self -> req_first = first;
+        self -> req_last = last;
+    }
+    return rc;
+}
+
+rc_t shard_apply( shard_t * self, int64_t tbl_first_row, uint64_t tbl_row_count ) {
+    rc_t rc = 0;
+    self -> tbl_first_row = tbl_first_row;
+    self -> tbl_row_count = tbl_row_count;
+    if ( self -> count > 0 ) {
+        /* split on spot-boundaries: the shards of one count cover the table without gaps */
+        uint64_t start = ( tbl_row_count * ( self -> idx - 1 ) ) / self -> count;
+        uint64_t end = ( tbl_row_count * self -> idx ) / self -> count;
+        self -> first_row = tbl_first_row + start;
+        self -> row_count = end - start;
+        if ( 0 == self -> row_count ) {
+            /* more shards than rows: a row-count of 0 means 'the whole table' downstream ( sorter.c ) */
+            rc = RC( rcExe, rcArgv, rcResolving, rcRange, rcEmpty );
+            ErrMsg( "shard %u/%u of a table with %lu rows is empty -> %R",
+                    self -> idx, self -> count, tbl_row_count, rc );
+        }
+    } else {
+        int64_t tbl_end = tbl_first_row + tbl_row_count;
+        int64_t first = self -> req_first;
+        int64_t end = self -> req_last + 1;
+        if ( first < tbl_first_row ) { first = tbl_first_row; }
+        if ( end > tbl_end ) { end = tbl_end; }
+        if ( first >= end ) {
+            rc = RC( rcExe, rcArgv, rcResolving, rcRange, rcInvalid );
+            ErrMsg( "row-range %ld-%ld is outside of the table ( rows %ld-%ld ) -> %R",
+                    self -> req_first, self -> req_last, tbl_first_row, tbl_end - 1, rc );
+        } else {
+            self -> first_row = first;
+            self -> row_count = end - first;
+        }
+    }
+    return rc;
+}
+
+rc_t shard_make_output_filename( const shard_t * self, const char * accession, const char * output_filename,
+                                 char * shard_dir, size_t shard_dir_size,
+                                 char * filename, size_t filename_size ) {
+    rc_t rc;
+    size_t num_writ;
+    const char * base = strrchr( output_filename, '/' );
+    int path_len = ( NULL == base ) ? 0 : ( int )( base - output_filename ) + 1;
+    base = ( NULL == base ) ? output_filename : base + 1;
+    /* the last row is part of the name: sorting the directories by name does not sort them by rows,
+       the merge uses the manifests for that */
+    rc = string_printf( shard_dir, shard_dir_size, &num_writ, "%.*s%s.rows_%ld-%ld",
+                        path_len, output_filename, accession,
+                        self -> first_row, self -> first_row + ( int64_t )self -> row_count - 1 );
+    if ( 0 != rc ) {
+        ErrMsg( "shard.c shard_make_output_filename().string_printf( dir ) -> %R", rc );
+    } else {
+        rc = string_printf( filename, filename_size, &num_writ, "%s/%s", shard_dir, base );
+        if ( 0 != rc ) {
+            ErrMsg( "shard.c shard_make_output_filename().string_printf( file ) -> %R", rc );
+        }
+    }
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static rc_t shard_print( struct KFile * f, uint64_t * pos, const char * fmt, ... ) {
+    char buffer[ 4096 ];
+    size_t num_writ;
+    va_list args;
+    rc_t rc;
+    va_start( args, fmt );
+    rc = string_vprintf( buffer, sizeof buffer, &num_writ, fmt, args );
+    va_end( args );
+    if ( 0 != rc ) {
+        ErrMsg( "shard.c shard_print().string_vprintf() -> %R", rc );
+    } else {
+        size_t written;
+        rc = KFileWriteAll( f, *pos, buffer, num_writ, &written );
+        if ( 0 != rc ) {
+            ErrMsg( "shard.c shard_print().KFileWriteAll() -> %R", rc );
+        } else {
+            *pos += written;
+        }
+    }
+    return rc;
+}
+
+static bool CC shard_is_fragment( const KDirectory * dir, const char * name, void * data ) {
+    return ( kptFile == KDirectoryPathType( dir, "%s", name ) && 0 != strcmp( name, SHARD_MANIFEST ) );
+}
+
+static int CC shard_cmp_names( const void * a, const void * b ) {
+    return strcmp( *( const char ** )a, *( const char ** )b );
+}
+
+static rc_t shard_print_fragments( KDirectory * dir, const char * shard_dir, struct KFile * f, uint64_t * pos ) {
+    KNamelist * names;
+    rc_t rc = KDirectoryList( dir, &names, shard_is_fragment, NULL, "%s", shard_dir );
+    if ( 0 != rc ) {
+        ErrMsg( "shard.c shard_print_fragments().KDirectoryList( '%s' ) -> %R", shard_dir, rc );
+    } else {
+        uint32_t idx, count;
+        rc = KNamelistCount( names, &count );
+        if ( 0 == rc && count > 0 ) {
+            const char ** sorted = calloc( count, sizeof * sorted );
+            if ( NULL == sorted ) {
+                rc = RC( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+                ErrMsg( "shard.c shard_print_fragments().calloc( %u ) -> %R", count, rc );
+            } else {
+                for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+                    rc = KNamelistGet( names, idx, &( sorted[ idx ] ) );
+                }
+                if ( 0 == rc ) {
+                    qsort( sorted, count, sizeof * sorted, shard_cmp_names );
+                }
+                for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+                    uint64_t size = ft_file_size( dir, "%s/%s", shard_dir, sorted[ idx ] ); /* file_tools.c */
+                    rc = shard_print( f, pos, "file\t%s\t%lu\n", sorted[ idx ], size );
+                }
+                free( ( void * )sorted );
+            }
+        }
+        KNamelistRelease( names );
+    }
+    return rc;
+}
+
+rc_t shard_write_manifest( KDirectory * dir, const shard_manifest_args_t * args ) {
+    struct KFile * f;
+    const shard_t * shard = args -> shard;
+    rc_t rc = KDirectoryCreateFile( dir, &f, false, 0664, kcmInit, "%s/%s", args -> shard_dir, SHARD_MANIFEST );
+    if ( 0 != rc ) {
+        ErrMsg( "shard.c shard_write_manifest().KDirectoryCreateFile( '%s/%s' ) -> %R",
+                args -> shard_dir, SHARD_MANIFEST, rc );
+    } else {
+        uint64_t pos = 0;
+        rc = shard_print( f, &pos, "# fasterq-dump shard-manifest\n" );
+        if ( 0 == rc ) {
+            rc = shard_print( f, &pos, "accession\t%s\nformat\t%s\ncompress\t%s\n",
+                              args -> accession, args -> format, args -> compress );
+        }
+        if ( 0 == rc ) {
+            rc = shard_print( f, &pos, "table\t%ld\t%lu\n", shard -> tbl_first_row, shard -> tbl_row_count );
+        }
+        if ( 0 == rc && shard -> count > 0 ) {
+            rc = shard_print( f, &pos, "shard\t%u/%u\n", shard -> idx, shard -> count );
+        }
+        if ( 0 == rc ) {
+            rc = shard_print( f, &pos, "rows\t%ld\t%lu\n", shard -> first_row, shard -> row_count );
+        }
+        if ( 0 == rc ) {
+            rc = shard_print_fragments( dir, args -> shard_dir, f, &pos ); /* above */
+        }
+        {
+            rc_t rc2 = ft_release_file( f, "shard_write_manifest( '%s' )", args -> shard_dir ); /* file_tools.c */
+            rc = ( 0 == rc ) ? rc2 : rc;
+        }
+    }
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+typedef struct shard_fragment_t {
+    const char * name;          /* points into the text of the manifest */
+    uint64_t size;
+} shard_fragment_t;
+
+typedef struct shard_info_t {
+    const char * shard_dir;     /* from the commandline */
+    char * text;                /* the manifest, all strings below point into it */
+    const char * accession;
+    const char * format;
+    const char * compress;
+    int64_t tbl_first_row;
+    uint64_t tbl_row_count;
+    int64_t first_row;
+    uint64_t row_count;
+    uint32_t shard_idx;         /* from '--shard idx/count', 0 for '--rows' */
+    uint32_t shard_count;
+    bool has_rows;
+    Vector fragments;           /* shard_fragment_t */
+} shard_info_t;
+
+static void CC shard_release_fragment( void * item, void * data ) {
+    free( item );
+}
+
+static void shard_release_info( shard_info_t * self ) {
+    if ( NULL != self ) {
+        VectorWhack( &( self -> fragments ), shard_release_fragment, NULL );
+        if ( NULL != self -> text ) { free( self -> text ); }
+        free( self );
+    }
+}
+
+static rc_t shard_read_manifest( KDirectory * dir, shard_info_t * info ) {
+    const struct KFile * f;
+    rc_t rc = KDirectoryOpenFileRead( dir, &f, "%s/%s", info -> shard_dir, SHARD_MANIFEST );
+    if ( 0 != rc ) {
+        ErrMsg( "no manifest found in '%s' -> %R", info -> shard_dir, rc );
+    } else {
+        uint64_t size;
+        rc = KFileSize( f, &size );
+        if ( 0 == rc && size > SHARD_MAX_MANIFEST ) {
+            rc = RC( rcExe, rcFile, rcReading, rcSize, rcExcessive );
+        }
+        if ( 0 != rc ) {
+            ErrMsg( "shard.c shard_read_manifest().KFileSize( '%s' ) -> %R", info -> shard_dir, rc );
+        } else {
+            info -> text = malloc( size + 1 );
+            if ( NULL == info -> text ) {
+                rc = RC( rcExe, rcFile, rcReading, rcMemory, rcExhausted );
+                ErrMsg( "shard.c shard_read_manifest().malloc( %lu ) -> %R", size + 1, rc );
+            } else {
+                size_t num_read;
+                rc = KFileReadAll( f, 0, info -> text, size, &num_read );
+                if ( 0 != rc ) {
+                    ErrMsg( "shard.c shard_read_manifest().KFileReadAll( '%s' ) -> %R", info -> shard_dir, rc );
+                } else {
+                    info -> text[ num_read ] = 0;
+                }
+            }
+        }
+        ft_release_file( f, "shard_read_manifest( '%s' )", info -> shard_dir ); /* file_tools.c */
+    }
+    return rc;
+}
+
+/* "first\tcount" */
+static bool shard_parse_range( const char * value, int64_t * first, uint64_t * count ) {
+    char * end = NULL;
+    *first = strtoll( value, &end, 10 );
+    if ( NULL == end || '\t' != *end ) { return false; }
+    *count = strtoull( end + 1, &end, 10 );
+    return ( NULL != end && 0 == *end );
+}
+
+static rc_t shard_parse_manifest( shard_info_t * info ) {
+    rc_t rc = 0;
+    char * line = info -> text;
+    while ( 0 == rc && NULL != line && 0 != *line ) {
+        char * nl = strchr( line, '\n' );
+        char * value = strchr( line, '\t' );
+        if ( NULL != nl ) { *nl = 0; }
+        if ( '#' != line[ 0 ] && NULL != value && ( NULL == nl || value < nl ) ) {
+            *value++ = 0;
+            if ( 0 == strcmp( line, "accession" ) ) {
+                info -> accession = value;
+            } else if ( 0 == strcmp( line, "format" ) ) {
+                info -> format = value;
+            } else if ( 0 == strcmp( line, "compress" ) ) {
+                info -> compress = value;
+            } else if ( 0 == strcmp( line, "table" ) ) {
+                if ( !shard_parse_range( value, &( info -> tbl_first_row ), &( info -> tbl_row_count ) ) ) {
+                    rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcInvalid );
+                }
+            } else if ( 0 == strcmp( line, "rows" ) ) {
+                info -> has_rows = shard_parse_range( value, &( info -> first_row ), &( info -> row_count ) );
+                if ( !info -> has_rows ) {
+                    rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcInvalid );
+                }
+            } else if ( 0 == strcmp( line, "shard" ) ) {
+                char * end = NULL;
+                info -> shard_idx = strtoul( value, &end, 10 );
+                if ( NULL == end || '/' != *end ) {
+                    rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcInvalid );
+                } else {
+                    info -> shard_count = strtoul( end + 1, &end, 10 );
+                    if ( NULL == end || 0 != *end || 0 == info -> shard_idx ||
+                         info -> shard_idx > info -> shard_count ) {
+                        rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcInvalid );
+                    }
+                }
+            } else if ( 0 == strcmp( line, "file" ) ) {
+                char * size = strrchr( value, '\t' );
+                shard_fragment_t * fragment = calloc( 1, sizeof * fragment );
+                if ( NULL == fragment ) {
+                    rc = RC( rcExe, rcFile, rcParsing, rcMemory, rcExhausted );
+                } else if ( NULL == size ) {
+                    free( fragment );
+                    rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcInvalid );
+                } else {
+                    *size++ = 0;
+                    fragment -> name = value;
+                    fragment -> size = strtoull( size, NULL, 10 );
+                    rc = VectorAppend( &( info -> fragments ), NULL, fragment );
+                    if ( 0 != rc ) { free( fragment ); }
+                }
+            }
+            /* unknown keys are ignored, for future extensions */
+        }
+        line = ( NULL != nl ) ? nl + 1 : NULL;
+    }
+    if ( 0 == rc && ( NULL == info -> accession || NULL == info -> format ||
+                      NULL == info -> compress || !info -> has_rows ) ) {
+        rc = RC( rcExe, rcFile, rcParsing, rcFormat, rcIncomplete );
+    }
+    if ( 0 != rc ) {
+        ErrMsg( "invalid manifest in '%s' -> %R", info -> shard_dir, rc );
+    }
+    return rc;
+}
+
+static rc_t shard_load_info( KDirectory * dir, const char * shard_dir, shard_info_t ** info ) {
+    rc_t rc = 0;
+    shard_info_t * i = calloc( 1, sizeof * i );
+    *info = NULL;
+    if ( NULL == i ) {
+        rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "shard.c shard_load_info().calloc() -> %R", rc );
+    } else {
+        i -> shard_dir = shard_dir;
+        VectorInit( &( i -> fragments ), 0, 4 );
+        rc = shard_read_manifest( dir, i ); /* above */
+        if ( 0 == rc ) {
+            rc = shard_parse_manifest( i ); /* above */
+        }
+        if ( 0 == rc ) {
+            *info = i;
+        } else {
+            shard_release_info( i );
+        }
+    }
+    return rc;
+}
+
+static int CC shard_cmp_info( const void * a, const void * b ) {
+    const shard_info_t * ia = *( const shard_info_t ** )a;
+    const shard_info_t * ib = *( const shard_info_t ** )b;
+    if ( ia -> first_row < ib -> first_row ) { return -1; }
+    return ( ia -> first_row > ib -> first_row ) ? 1 : 0;
+}
+
+/* the merged rows have to cover the whole table, if one of the shards was made by '--shard i/N':
+   a missing shard would otherwise produce a silently truncated output. Only a merge of explicit
+   '--rows' shards can produce a part of the table, because these have been requested as such. */
+static rc_t shard_check_coverage( shard_info_t ** infos, uint32_t count ) {
+    rc_t rc = 0;
+    const shard_info_t * first = infos[ 0 ];
+    const shard_info_t * last = infos[ count - 1 ];
+    int64_t tbl_end = first -> tbl_first_row + ( int64_t )first -> tbl_row_count;
+    int64_t end = last -> first_row + ( int64_t )last -> row_count;
+    if ( first -> first_row != first -> tbl_first_row || end != tbl_end ) {
+        bool by_idx = false;
+        uint32_t idx;
+        for ( idx = 0; !by_idx && idx < count; ++idx ) {
+            by_idx = ( infos[ idx ] -> shard_count > 0 );
+        }
+        if ( by_idx ) {
+            rc = RC( rcExe, rcFile, rcValidating, rcRange, rcIncomplete );
+            ErrMsg( "the shards cover only the rows %ld-%ld of the rows %ld-%ld ( missing shards? ) -> %R",
+                    first -> first_row, end - 1, first -> tbl_first_row, tbl_end - 1, rc );
+        } else {
+            StdErrMsg( "merging the rows %ld-%ld of the rows %ld-%ld ( requested by '--rows' )\n",
+                       first -> first_row, end - 1, first -> tbl_first_row, tbl_end - 1 );
+        }
+    }
+    return rc;
+}
+
+/* before anything is touched: the shards have to come from the same run-parameters, their rows
+   have to be contiguous and cover the table, and the fragments have to be complete */
+static rc_t shard_check_infos( KDirectory * dir, shard_info_t ** infos, uint32_t count ) {
+    rc_t rc = 0;
+    uint32_t idx;
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        const shard_info_t * i = infos[ idx ];
+        uint32_t f_idx, f_count = VectorLength( &( i -> fragments ) );
+        if ( idx > 0 ) {
+            const shard_info_t * prev = infos[ idx - 1 ];
+            if ( 0 != strcmp( i -> accession, prev -> accession ) ||
+                 0 != strcmp( i -> format, prev -> format ) ||
+                 0 != strcmp( i -> compress, prev -> compress ) ||
+                 i -> tbl_first_row != prev -> tbl_first_row ||
+                 i -> tbl_row_count != prev -> tbl_row_count ) {
+                rc = RC( rcExe, rcFile, rcValidating, rcParam, rcInconsistent );
+                ErrMsg( "shards '%s' and '%s' do not belong together -> %R",
+                        prev -> shard_dir, i -> shard_dir, rc );
+            } else if ( prev -> first_row + ( int64_t )prev -> row_count != i -> first_row ) {
+                rc = RC( rcExe, rcFile, rcValidating, rcRange, rcInvalid );
+                ErrMsg( "shards '%s' and '%s' are not contiguous ( rows %ld-%ld and %ld-%ld ) -> %R",
+                        prev -> shard_dir, i -> shard_dir,
+                        prev -> first_row, prev -> first_row + ( int64_t )prev -> row_count - 1,
+                        i -> first_row, i -> first_row + ( int64_t )i -> row_count - 1, rc );
+            }
+        }
+        for ( f_idx = 0; 0 == rc && f_idx < f_count; ++f_idx ) {
+            const shard_fragment_t * fragment = VectorGet( &( i -> fragments ), f_idx );
+            if ( !ft_file_exists( dir, "%s/%s", i -> shard_dir, fragment -> name ) ||
+                 ft_file_size( dir, "%s/%s", i -> shard_dir, fragment -> name ) != fragment -> size ) {
+                rc = RC( rcExe, rcFile, rcValidating, rcSize, rcInvalid );
+                ErrMsg( "fragment '%s/%s' is missing or incomplete -> %R", i -> shard_dir, fragment -> name, rc );
+            }
+        }
+    }
+    if ( 0 == rc && count > 0 ) {
+        rc = shard_check_coverage( infos, count ); /* above */
+    }
+    return rc;
+}
+
+static rc_t shard_collect_names( shard_info_t ** infos, uint32_t count, VNamelist * names ) {
+    rc_t rc = 0;
+    uint32_t idx;
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        uint32_t f_idx, f_count = VectorLength( &( infos[ idx ] -> fragments ) );
+        for ( f_idx = 0; 0 == rc && f_idx < f_count; ++f_idx ) {
+            const shard_fragment_t * fragment = VectorGet( &( infos[ idx ] -> fragments ), f_idx );
+            uint32_t found;
+            if ( 0 != VNamelistIndexOf( names, fragment -> name, &found ) ) {
+                rc = VNamelistAppend( names, fragment -> name );
+            }
+        }
+    }
+    return rc;
+}
+
+static bool shard_has_fragment( const shard_info_t * info, const char * name ) {
+    uint32_t idx, count = VectorLength( &( info -> fragments ) );
+    for ( idx = 0; idx < count; ++idx ) {
+        const shard_fragment_t * fragment = VectorGet( &( info -> fragments ), idx );
+        if ( 0 == strcmp( fragment -> name, name ) ) { return true; }
+    }
+    return false;
+}
+
+static rc_t shard_merge_name( KDirectory * dir, shard_info_t ** infos, uint32_t count,
+                              const char * name, const char * output_dir,
+                              size_t buf_size, bool force, bool show_details ) {
+    VNamelist * files;
+    rc_t rc = VNamelistMake( &files, count );
+    if ( 0 != rc ) {
+        ErrMsg( "shard.c shard_merge_name().VNamelistMake() -> %R", rc );
+    } else {
+        char path[ 4096 ];
+        size_t num_writ;
+        uint32_t idx;
+        for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+            if ( shard_has_fragment( infos[ idx ], name ) ) {
+                rc = string_printf( path, sizeof path, &num_writ, "%s/%s", infos[ idx ] -> shard_dir, name );
+                if ( 0 == rc ) {
+                    rc = VNamelistAppend( files, path );
+                }
+            }
+        }
+        if ( 0 == rc ) {
+            rc = string_printf( path, sizeof path, &num_writ, "%s/%s", output_dir, name );
+        }
+        if ( 0 == rc && show_details ) {
+            uint32_t num_files = 0;
+            VNameListCount( files, &num_files );
+            KOutHandlerSetStdErr();
+            KOutMsg( "merge  : %u fragments -> '%s'\n", num_files, path );
+            KOutHandlerSetStdOut();
+        }
+        if ( 0 == rc ) {
+            /* the fragments are already complete files ( compressed ones with their own EOF-marker ),
+               nothing to add at the end */
+            rc = concat_execute( dir, path, files, buf_size, NULL, force, false, ct_none ); /* concatenator.c */
+        }
+        VNamelistRelease( files );
+    }
+    return rc;
+}
+
+rc_t shard_merge( KDirectory * dir, const VNamelist * shard_dirs, const char * output_dir,
+                  size_t buf_size, bool force, bool show_details ) {
+    uint32_t idx, count = 0;
+    shard_info_t ** infos = NULL;
+    rc_t rc = VNameListCount( shard_dirs, &count );
+    if ( 0 == rc && 0 == count ) {
+        rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcInsufficient );
+        ErrMsg( "no shards to merge -> %R", rc );
+    }
+    if ( 0 == rc ) {
+        infos = calloc( count, sizeof * infos );
+        if ( NULL == infos ) {
+            rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "shard.c shard_merge().calloc( %u ) -> %R", count, rc );
+        }
+    }
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        const char * shard_dir;
+        rc = VNameListGet( shard_dirs, idx, &shard_dir );
+        if ( 0 == rc ) {
+            rc = shard_load_info( dir, shard_dir, &( infos[ idx ] ) ); /* above */
+        }
+    }
+    if ( 0 == rc ) {
+        qsort( infos, count, sizeof * infos, shard_cmp_info );
+        rc = shard_check_infos( dir, infos, count ); /* above */
+    }
+    if ( 0 == rc && !ft_dir_exists( dir, "%s", output_dir ) ) {
+        rc = ft_create_this_dir_2( dir, output_dir, true ); /* file_tools.c */
+    }
+    if ( 0 == rc ) {
+        VNamelist * names;
+        rc = VNamelistMake( &names, 4 );
+        if ( 0 == rc ) {
+            uint32_t n_idx, n_count = 0;
+            rc = shard_collect_names( infos, count, names ); /* above */
+            if ( 0 == rc ) {
+                rc = VNameListCount( names, &n_count );
+            }
+            /* do not consume any fragment if one of the outputs is in the way */
+            for ( n_idx = 0; 0 == rc && !force && n_idx < n_count; ++n_idx ) {
+                const char * name;
+                rc = VNameListGet( names, n_idx, &name );
+                if ( 0 == rc && ft_file_exists( dir, "%s/%s", output_dir, name ) ) {
+                    rc = RC( rcExe, rcFile, rcPacking, rcName, rcExists );
+                    ErrMsg( "output '%s/%s' already exists, use '--force' to overwrite it -> %R",
+                            output_dir, name, rc );
+                }
+            }
+            for ( n_idx = 0; 0 == rc && n_idx < n_count; ++n_idx ) {
+                const char * name;
+                rc = VNameListGet( names, n_idx, &name );
+                if ( 0 == rc ) {
+                    rc = shard_merge_name( dir, infos, count, name, output_dir,
+                                           buf_size, force, show_details ); /* above */
+                }
+            }
+            VNamelistRelease( names );
+        }
+    }
+    /* the fragments are consumed: remove the manifests and the then empty shard-directories */
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        KDirectoryRemove( dir, false, "%s/%s", infos[ idx ] -> shard_dir, SHARD_MANIFEST );
+        KDirectoryRemove( dir, false, "%s", infos[ idx ] -> shard_dir );
+    }
+    if ( NULL != infos ) {
+        for ( idx = 0; idx < count; ++idx ) {
+            shard_release_info( infos[ idx ] );
+        }
+        free( ( void * )infos );
+    }
+    return rc;
+}
@@ -0,0 +1,105 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_shard_
+#define _h_shard_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_namelist_
+#include <klib/namelist.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+/* ----------------------------------------------------------------------------------------------
+    sharding: one accession is extracted by many processes ( on many nodes ), each of them
+    producing the rows of a contiguous range of spots ( rows of the SEQ-table ). The output of
+    a shard goes into its own directory '<acc>.rows_<first>-<last>' next to the regular output,
+    together with a manifest. The fragments are stitched together by a plain concatenation in
+    the order of their rows, without parsing them again ( '--merge-shards' ).
+   ---------------------------------------------------------------------------------------------- */
+
+#define SHARD_MANIFEST "fasterq-dump.manifest"
+
+typedef struct shard_t {
+    bool requested;
+    uint32_t idx;               /* --shard idx/count ( idx is 1-based ), 0 for --rows */
+    uint32_t count;
+    int64_t req_first;          /* --rows first-last ( inclusive, like the row-ranges of vdb-dump ) */
+    int64_t req_last;
+    int64_t first_row;          /* the rows of the shard, resolved by shard_apply() */
+    uint64_t row_count;
+    int64_t tbl_first_row;      /* the rows of the whole SEQ-table */
+    uint64_t tbl_row_count;
+} shard_t;
+
+/* '--shard 3/8' */
+rc_t shard_parse_idx( shard_t * self, const char * s );
+
+/* '--rows 1000001-2000000' */
+rc_t shard_parse_rows( shard_t * self, const char * s );
+
+/* resolve the requested shard against the rows of the SEQ-table,
+   shard idx of count gets rows [ first + rows * ( idx - 1 ) / count, first + rows * idx / count ),
+   an empty shard ( more shards than rows ) is an error, like a row-range outside of the table */
+rc_t shard_apply( shard_t * self, int64_t tbl_first_row, uint64_t tbl_row_count );
+
+/* '/path/SRR000001.fastq' -> shard_dir = '/path/SRR000001.rows_1-1000'
+                              filename = '/path/SRR000001.rows_1-1000/SRR000001.fastq' */
+rc_t shard_make_output_filename( const shard_t * self, const char * accession, const char * output_filename,
+                                 char * shard_dir, size_t shard_dir_size,
+                                 char * filename, size_t filename_size );
+
+typedef struct shard_manifest_args_t {
+    const shard_t * shard;
+    const char * shard_dir;
+    const char * accession;
+    const char * format;        /* hlp_fmt_2_string() */
+    const char * compress;      /* hlp_compress_2_string() */
+} shard_manifest_args_t;
+
+/* lists the fragments in the shard-directory and writes the manifest next to them */
+rc_t shard_write_manifest( KDirectory * dir, const shard_manifest_args_t * args );
+
+/* checks that the shards belong together and that their rows are contiguous, then concatenates
+   the fragments into '<output_dir>/<fragment-name>' ( the fragments are consumed ) */
+rc_t shard_merge( KDirectory * dir, const VNamelist * shard_dirs, const char * output_dir,
+                  size_t buf_size, bool force, bool show_details );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -43,6 +43,10 @@
 #include "progress_thread.h"
 #endif
 
+#ifndef _h_packed_4na_
+#include "packed_4na.h"
+#endif
+
 #ifndef _h_klib_out_
 #include <klib/out.h>
 #endif
@@ -59,9 +63,13 @@ typedef struct lookup_producer_t {
     KVector * store;
     struct bg_progress_t * progress; /* progress_thread.h */
     struct background_vector_merger_t * merger; /* merge_sorter.h */
+    struct mem_lookup_t * mem_lookup; /* mem_lookup.h */
+    mem_lookup_slab_t slab; /* mem_lookup.h */
     SBuffer_t buf; /* helper.h */
     uint64_t bytes_in_store;
     atomic64_t * processed_row_count;
+    int64_t seq_first_row;          /* spot-filter for shards */
+    uint64_t seq_row_count;         /* 0 ... no filter */
     uint32_t chunk_id, sub_file_id;
     size_t buf_size, mem_limit;
 } lookup_producer_t;
@@ -98,59 +106,6 @@ static rc_t push_store_to_merger( lookup_producer_t * self, bool last ) {
     return rc;
 }
 
-static const char xASCII_to_4na[ 256 ] = {
-    /* 0x00 0x01 0x02 0x03 0x04 0x05 0x06 0x07 0x08 0x09 0x0A 0x0B 0x0C 0x0D 0x0E 0x0F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x10 0x11 0x12 0x13 0x14 0x15 0x16 0x17 0x18 0x19 0x1A 0x1B 0x1C 0x1D 0x1E 0x1F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x20 0x21 0x22 0x23 0x24 0x25 0x26 0x27 0x28 0x29 0x2A 0x2B 0x2C 0x2D 0x2E 0x2F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x30 0x31 0x32 0x33 0x34 0x35 0x36 0x37 0x38 0x39 0x3A 0x3B 0x3C 0x3D 0x3E 0x3F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x40 0x41 0x42 0x43 0x44 0x45 0x46 0x47 0x48 0x49 0x4A 0x4B 0x4C 0x4D 0x4E 0x4F */
-    /* @    A    B    C    D    E    F    G    H    I    J    K    L    M    N    O */
-       0,   1,   0,   2,   0,   0,   0,   4,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x50 0x51 0x52 0x53 0x54 0x55 0x56 0x57 0x58 0x59 0x5A 0x5B 0x5C 0x5D 0x5E 0x5F */
-    /* P    Q    R    S    T    U    V    W    X    Y    Z    [    \    ]    ^    _ */
-       0,   0,   0,   0,   8,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x60 0x61 0x62 0x63 0x64 0x65 0x66 0x67 0x68 0x69 0x6A 0x6B 0x6C 0x6D 0x6E 0x6F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x70 0x71 0x72 0x73 0x74 0x75 0x76 0x77 0x78 0x79 0x7A 0x7B 0x7C 0x7D 0x7E 0x7F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x80 0x81 0x82 0x83 0x84 0x85 0x86 0x87 0x88 0x89 0x8A 0x8B 0x8C 0x8D 0x8E 0x8F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0x90 0x91 0x92 0x93 0x94 0x95 0x96 0x97 0x98 0x99 0x9A 0x9B 0x9C 0x9D 0x9E 0x9F */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xA0 0xA1 0xA2 0xA3 0xA4 0xA5 0xA6 0xA7 0xA8 0xA9 0xAA 0xAB 0xAC 0xAD 0xAE 0xAF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xB0 0xB1 0xB2 0xB3 0xB4 0xB5 0xB6 0xB7 0xB8 0xB9 0xBA 0xBB 0xBC 0xBD 0xBE 0xBF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xC0 0xC1 0xC2 0xC3 0xC4 0xC5 0xC6 0xC7 0xC8 0xC9 0xCA 0xCB 0xCC 0xCD 0xCE 0xCF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xD0 0xD1 0xD2 0xD3 0xD4 0xD5 0xD6 0xD7 0xD8 0xD9 0xDA 0xDB 0xDC 0xDD 0xDE 0xDF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xE0 0xE1 0xE2 0xE3 0xE4 0xE5 0xE6 0xE7 0xE8 0xE9 0xEA 0xEB 0xEC 0xED 0xEE 0xEF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-
-    /* 0xF0 0xF1 0xF2 0xF3 0xF4 0xF5 0xF6 0xF7 0xF8 0xF9 0xFA 0xFB 0xFC 0xFD 0xFE 0xFF */
-       0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
-};
-
-
 static rc_t pack_read_2_4na( const String * bases, SBuffer_t * packed_bases ) {
     rc_t rc = 0;
     if ( bases -> len < 1 ) {
@@ -173,26 +128,10 @@ static rc_t pack_read_2_4na( const String * bases, SBuffer_t * packed_bases ) {
 
             /* write the leading num_bases to the target */
             memcpy( dst, &dna_len, sizeof dna_len );
-            {
-                uint32_t src_idx;
-                uint32_t dst_idx = sizeof( dna_len );
-                const uint8_t * src = ( uint8_t * )bases -> addr;
-                /* for each base: encode to 4na and write ot buffer */
-                for ( src_idx = 0; src_idx < dna_len; ++src_idx ) {
-                    if ( dst_idx < packed_bases -> buffer_size ) {
-                        uint8_t base = ( xASCII_to_4na[ src[ src_idx ] ] & 0x0F );
-                        if ( 0 == ( src_idx & 0x01 ) ) {
-                            dst[ dst_idx ] = ( base << 4 );
-                        } else {
-                            dst[ dst_idx++ ] |= base;
-                        }
-                    }
-                }
-                /* if we have not finished a whole byte - increase the lenght! */
-                if ( bases -> len & 0x01 ) { dst_idx++; }
-                /* set the length into the String... */
-                packed_bases -> S . size = packed_bases -> S . len = dst_idx;
-            }
+            /* encode to 4na, 2 bases per byte ( vectorized if the cpu can do it ) */
+            p4na_pack( ( const uint8_t * )bases -> addr, dna_len, dst + sizeof( dna_len ) ); /* packed_4na.c */
+            /* set the length into the String... */
+            packed_bases -> S . size = packed_bases -> S . len = sizeof( dna_len ) + ( ( dna_len + 1 ) / 2 );
         }
     }
     return rc;
@@ -229,6 +168,20 @@ static rc_t write_to_store( lookup_producer_t * self,
     return rc;
 }
 
+static rc_t write_to_mem_lookup( lookup_producer_t * self,
+                                 uint64_t key,
+                                 const String * read ) {
+    /* we write it into the in-memory lookup, instead of the store...*/
+    rc_t rc = pack_read_2_4na( read, &( self -> buf ) ); /* above */
+    if ( 0 != rc ) {
+        ErrMsg( "sorter.c write_to_mem_lookup().pack_read_2_4na() failed %R", rc );
+    } else {
+        /* returns a silent rc if the mem-limit has been exceeded */
+        rc = memlkp_put( self -> mem_lookup, &( self -> slab ), key, &( self -> buf . S ) ); /* mem_lookup.c */
+    }
+    return rc;
+}
+
 static rc_t CC producer_thread_func( const KThread *self, void *data ) {
     rc_t rc1, rc = 0;
     lookup_producer_t * producer = data;
@@ -242,10 +195,20 @@ static rc_t CC producer_thread_func( const KThread *self, void *data ) {
                 if ( rec . read . len < 1 ) {
                     rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcNull );
                     ErrMsg( "sorter.c producer_thread_func: rec.read.len = %d", rec . read . len );
+                } else if ( producer -> seq_row_count > 0 &&
+                            ( ( int64_t )rec . seq_spot_id < producer -> seq_first_row ||
+                              ( int64_t )rec . seq_spot_id >= producer -> seq_first_row + ( int64_t )producer -> seq_row_count ) ) {
+                    /* the spot of this alignment is not part of the shard: it will never be looked up */
+                    bg_progress_inc( producer -> progress ); /* progress_thread.c (ignores NULL) */
+                    row_count++;
                 } else {
                     uint64_t key = hlp_make_key( rec . seq_spot_id, rec . seq_read_id ); /* helper.c */
                     /* the keys are allowed to be out of order here */
-                    rc = write_to_store( producer, key, &rec . read ); /* above! */
+                    if ( NULL != producer -> mem_lookup ) {
+                        rc = write_to_mem_lookup( producer, key, &rec . read ); /* above! */
+                    } else {
+                        rc = write_to_store( producer, key, &rec . read ); /* above! */
+                    }
                     if ( 0 == rc ) {
                         bg_progress_inc( producer -> progress ); /* progress_thread.c (ignores NULL) */
                         row_count++;
@@ -262,7 +225,9 @@ static rc_t CC producer_thread_func( const KThread *self, void *data ) {
     if ( 0 == rc ) {
         /* now we have to push out / write out what is left in the last store */
         rc = push_store_to_merger( producer, true ); /* this might block ! */
-    } else {
+    } else if ( !memlkp_overflowed( producer -> mem_lookup ) ) {
+        /* an exceeded mem-limit of the in-memory lookup is not an error,
+           the caller falls back to the file-based lookup */
         hlp_set_quitting(); /* helper.c */
     }
 
@@ -305,8 +270,10 @@ rc_t execute_lookup_production( const lookup_production_args_t * args ) {
             lookup_producer_t * producer = calloc( 1, sizeof *producer );
             if ( NULL != producer ) {
 
-                /* initialize the producer */
-                rc = KVectorMake( &producer -> store );
+                /* initialize the producer, the store is not needed for the in-memory lookup */
+                if ( NULL == args -> mem_lookup ) {
+                    rc = KVectorMake( &producer -> store );
+                }
                 if ( 0 != rc ) {
                     ErrMsg( "sorter.c init_multi_producer().KVectorMake() -> %R", rc );
                 } else {
@@ -317,12 +284,16 @@ rc_t execute_lookup_production( const lookup_production_args_t * args ) {
                         producer -> iter            = NULL;
                         producer -> progress        = progress;
                         producer -> merger          = args -> merger;
+                        producer -> mem_lookup      = args -> mem_lookup;
                         producer -> bytes_in_store  = 0;
                         producer -> chunk_id        = chunk_id;
                         producer -> sub_file_id     = 0;
                         producer -> buf_size        = args -> buf_size;
                         producer -> mem_limit       = args -> mem_limit;
                         producer -> processed_row_count = &processed_row_count;
+                        producer -> seq_first_row   = args -> seq_first_row;
+                        producer -> seq_row_count   = args -> seq_row_count;
+                        memlkp_init_slab( &( producer -> slab ) ); /* mem_lookup.c */
 
                         cip . dir                = args -> dir;
                         cip . vdb_mgr            = args -> vdb_mgr;
@@ -331,6 +302,8 @@ rc_t execute_lookup_production( const lookup_production_args_t * args ) {
                         cip . first_row          = row;
                         cip . row_count          = rows_per_thread;
                         cip . cursor_cache       = args -> cursor_cache;
+                        cip . next_range         = NULL;
+                        cip . next_range_ctx     = NULL;
 
                         rc = make_raw_read_iter( &cip, &( producer -> iter ) );
                     }
@@ -360,7 +333,7 @@ rc_t execute_lookup_production( const lookup_production_args_t * args ) {
 
         /* collect all the sorter-threads */
         rc = hlp_join_and_release_threads( &threads );
-        if ( 0 != rc ) {
+        if ( 0 != rc && !memlkp_overflowed( args -> mem_lookup ) ) {
             ErrMsg( "sorter.c run_producer_pool().join_and_release_threads -> %R", rc );
         }
 
@@ -382,7 +355,7 @@ rc_t execute_lookup_production( const lookup_production_args_t * args ) {
         rc = seal_background_vector_merger( args -> merger ); /* merge_sorter.c */
     }
 
-    if ( rc != 0 ) {
+    if ( rc != 0 && !memlkp_overflowed( args -> mem_lookup ) ) {
         ErrMsg( "sorter.c execute_lookup_production() -> %R", rc );
     }
     return rc;
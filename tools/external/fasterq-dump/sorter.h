@@ -43,6 +43,10 @@ extern "C" {
 #include "merge_sorter.h"
 #endif
 
+#ifndef _h_mem_lookup_
+#include "mem_lookup.h"
+#endif
+
 #ifndef _h_vdb_manager_
 #include <vdb/manager.h>
 #endif
@@ -53,7 +57,10 @@ typedef struct lookup_production_args_t {
     const char * accession_path;
     const char * accession_short;
     struct background_vector_merger_t * merger; /*merge_sorter.h */
+    struct mem_lookup_t * mem_lookup; /* mem_lookup.h, if not NULL: merger is not used */
     uint64_t align_row_count;
+    int64_t seq_first_row;      /* only alignments of these spots go into the lookup ( shards ), */
+    uint64_t seq_row_count;     /* 0 ... all spots */
     size_t cursor_cache;
     size_t buf_size;
     size_t mem_limit;
@@ -0,0 +1,735 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "spill_io.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"   /* hlp_make_thread */
+#endif
+
+#ifndef _h_file_tools_
+#include "file_tools.h"   /* ft_align_block_size, FT_BLOCK_ALIGN */
+#endif
+
+#ifndef _h_kproc_lock_
+#include <kproc/lock.h>
+#endif
+
+#ifndef _h_kproc_cond_
+#include <kproc/cond.h>
+#endif
+
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+spill_io_mode_t spill_io_get_mode( const char * mode ) {
+    spill_io_mode_t res = sio_buffered;
+    if ( NULL != mode ) {
+        String Mode, Buffered, Direct;
+        StringInitCString( &Mode, mode );
+        StringInitCString( &Buffered, "buffered" );
+        StringInitCString( &Direct, "direct" );
+        if ( 0 == StringCaseCompare( &Mode, &Buffered ) ) {
+            res = sio_buffered;
+        } else if ( 0 == StringCaseCompare( &Mode, &Direct ) ) {
+            res = sio_direct;
+        } else {
+            res = sio_unknown;
+        }
+    }
+    return res;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+#ifdef WINDOWS
+
+/* no direct i/o on WINDOWS: the lookup-files stay buffered KFile's */
+
+rc_t spill_io_init( spill_io_mode_t mode, size_t block_size, uint32_t depth ) { return 0; }
+void spill_io_release( void ) { }
+bool spill_io_direct( void ) { return false; }
+const char * spill_io_backend( void ) { return "buffered"; }
+
+rc_t spill_writer_make( struct spill_writer_t ** writer, const KDirectory * dir,
+                        const char * fmt, va_list args ) {
+    return RC( rcVDB, rcNoTarg, rcConstructing, rcFunction, rcUnsupported );
+}
+rc_t spill_writer_write( struct spill_writer_t * self, const void * src, size_t size ) {
+    return RC( rcVDB, rcNoTarg, rcWriting, rcFunction, rcUnsupported );
+}
+rc_t spill_writer_finish( struct spill_writer_t * self ) { return 0; }
+uint64_t spill_writer_size( const struct spill_writer_t * self ) { return 0; }
+rc_t spill_writer_release( struct spill_writer_t * self ) { return 0; }
+
+rc_t spill_reader_make( struct spill_reader_t ** reader, const KDirectory * dir,
+                        const char * fmt, va_list args ) {
+    return RC( rcVDB, rcNoTarg, rcConstructing, rcFunction, rcUnsupported );
+}
+uint64_t spill_reader_size( const struct spill_reader_t * self ) { return 0; }
+rc_t spill_reader_read( struct spill_reader_t * self, void * dst, size_t size, size_t * num_read ) {
+    return RC( rcVDB, rcNoTarg, rcReading, rcFunction, rcUnsupported );
+}
+void spill_reader_release( struct spill_reader_t * self ) { }
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#define SIO_NUM_THREADS 4       /* the pread/pwrite-pool, if there is no io_uring */
+#define SIO_POOL_MAX 64         /* how many free blocks the buffer-pool keeps */
+
+struct sio_file_t;
+
+/* one request: a block of the file in flight */
+typedef struct sio_slot_t {
+    struct sio_slot_t * next;   /* the queue of the thread-pool */
+    struct sio_file_t * file;
+    uint8_t * buf;              /* aligned, from the buffer-pool */
+    uint64_t pos;               /* where in the file, always aligned */
+    size_t len;                 /* how much to read / to write, always aligned */
+    int64_t res;                /* how much was transfered, or -errno */
+    bool done;                  /* set by the thread-pool under the lock of the file */
+    bool pending;               /* only touched by the owner of the file: submitted, not waited for */
+    bool ready;                 /* only for readers: waited for, res bytes valid in buf */
+} sio_slot_t;
+
+typedef struct sio_file_t {
+    int fd;
+    bool writing;
+    bool use_ring;
+    uint32_t depth;
+    uint64_t read_size;         /* reading: the size of the file, only the last block may be short */
+    KLock * lock;               /* the thread-pool signals completions via lock/cond */
+    KCondition * cond;
+#ifdef HAVE_LIBURING
+    struct io_uring ring;
+#endif
+    sio_slot_t slots[ SPILL_IO_MAX_DEPTH ];
+    char path[ 4096 ];
+} sio_file_t;
+
+typedef struct sio_ctx_t {
+    size_t block_size;
+    uint32_t depth;
+    bool ring_ok;               /* io_uring could be set up at init */
+    bool done;
+    KLock * lock;               /* protects the queue and the buffer-pool */
+    KCondition * cond;          /* signals a new request to the thread-pool */
+    sio_slot_t * head;
+    sio_slot_t * tail;
+    uint8_t * pool[ SIO_POOL_MAX ];
+    uint32_t pool_count;
+    KThread * threads[ SIO_NUM_THREADS ];
+    uint32_t num_threads;
+} sio_ctx_t;
+
+static sio_ctx_t * sio = NULL;
+
+/* ---------------------------------------------------------------------------------- */
+
+static uint8_t * sio_get_block( void ) {
+    uint8_t * res = NULL;
+    KLockAcquire( sio -> lock );
+    if ( sio -> pool_count > 0 ) {
+        res = sio -> pool[ --( sio -> pool_count ) ];
+    }
+    KLockUnlock( sio -> lock );
+    if ( NULL == res ) {
+        void * p = NULL;
+        if ( 0 == posix_memalign( &p, FT_BLOCK_ALIGN, sio -> block_size ) ) {
+            res = ( uint8_t * )p;
+        }
+    }
+    return res;
+}
+
+static void sio_put_block( uint8_t * block ) {
+    if ( NULL != block ) {
+        KLockAcquire( sio -> lock );
+        if ( sio -> pool_count < SIO_POOL_MAX ) {
+            sio -> pool[ ( sio -> pool_count )++ ] = block;
+            block = NULL;
+        }
+        KLockUnlock( sio -> lock );
+        if ( NULL != block ) {
+            free( ( void * ) block );
+        }
+    }
+}
+
+/* synchronous transfer, used by the thread-pool and for the rest of a short io_uring-write */
+static int64_t sio_transfer( sio_file_t * f, uint8_t * buf, uint64_t pos, size_t len ) {
+    size_t done = 0;
+    while ( done < len ) {
+        ssize_t n = f -> writing
+            ? pwrite( f -> fd, buf + done, len - done, pos + done )
+            : pread( f -> fd, buf + done, len - done, pos + done );
+        if ( n < 0 ) {
+            if ( EINTR == errno ) { continue; }
+            return -( int64_t )errno;
+        }
+        done += n;
+        if ( !f -> writing ) { break; }     /* a short read is the end of the file */
+    }
+    return done;
+}
+
+static rc_t CC sio_thread_func( const KThread * thread, void * data ) {
+    sio_ctx_t * ctx = ( sio_ctx_t * )data;
+    KLockAcquire( ctx -> lock );
+    while ( true ) {
+        sio_slot_t * slot = ctx -> head;
+        if ( NULL == slot ) {
+            if ( ctx -> done ) { break; }
+            KConditionWait( ctx -> cond, ctx -> lock );
+        } else {
+            sio_file_t * f = slot -> file;
+            int64_t res;
+            ctx -> head = slot -> next;
+            if ( NULL == ctx -> head ) { ctx -> tail = NULL; }
+            KLockUnlock( ctx -> lock );
+
+            res = sio_transfer( f, slot -> buf, slot -> pos, slot -> len );
+
+            KLockAcquire( f -> lock );
+            slot -> res = res;
+            slot -> done = true;
+            KConditionBroadcast( f -> cond );
+            KLockUnlock( f -> lock );
+
+            KLockAcquire( ctx -> lock );
+        }
+    }
+    KLockUnlock( ctx -> lock );
+    return 0;
+}
+
+static void sio_submit( sio_file_t * f, sio_slot_t * slot, uint64_t pos, size_t len ) {
+    slot -> pos = pos;
+    slot -> len = len;
+    slot -> res = 0;
+    slot -> done = false;
+    slot -> pending = true;
+#ifdef HAVE_LIBURING
+    if ( f -> use_ring ) {
+        /* the ring has 'depth' entries, there is always a free one */
+        struct io_uring_sqe * sqe = io_uring_get_sqe( &( f -> ring ) );
+        int res = -EBUSY;
+        if ( NULL != sqe ) {
+            if ( f -> writing ) {
+                io_uring_prep_write( sqe, f -> fd, slot -> buf, len, pos );
+            } else {
+                io_uring_prep_read( sqe, f -> fd, slot -> buf, len, pos );
+            }
+            io_uring_sqe_set_data( sqe, slot );
+            res = io_uring_submit( &( f -> ring ) );
+        }
+        if ( res < 0 ) {
+            slot -> res = res;
+            slot -> done = true;
+        }
+        return;
+    }
+#endif
+    KLockAcquire( sio -> lock );
+    slot -> next = NULL;
+    if ( NULL == sio -> tail ) {
+        sio -> head = slot;
+    } else {
+        sio -> tail -> next = slot;
+    }
+    sio -> tail = slot;
+    KConditionSignal( sio -> cond );
+    KLockUnlock( sio -> lock );
+}
+
+static void sio_wait( sio_file_t * f, sio_slot_t * slot ) {
+#ifdef HAVE_LIBURING
+    if ( f -> use_ring ) {
+        /* the completions arrive in any order, collect them until this slot is done */
+        while ( !slot -> done ) {
+            struct io_uring_cqe * cqe;
+            int res = io_uring_wait_cqe( &( f -> ring ), &cqe );
+            if ( res < 0 ) {
+                if ( -EINTR == res ) { continue; }
+                slot -> res = res;
+                slot -> done = true;
+            } else {
+                sio_slot_t * s = ( sio_slot_t * )io_uring_cqe_get_data( cqe );
+                s -> res = cqe -> res;
+                s -> done = true;
+                io_uring_cqe_seen( &( f -> ring ), cqe );
+                if ( f -> writing && s -> res > 0 && ( size_t )s -> res < s -> len ) {
+                    int64_t rest = sio_transfer( f, s -> buf + s -> res, s -> pos + s -> res, s -> len - s -> res );
+                    s -> res = ( rest < 0 ) ? rest : s -> res + rest;
+                }
+            }
+        }
+        return;
+    }
+#endif
+    KLockAcquire( f -> lock );
+    while ( !slot -> done ) {
+        KConditionWait( f -> cond, f -> lock );
+    }
+    KLockUnlock( f -> lock );
+}
+
+static rc_t sio_wait_check( sio_file_t * f, sio_slot_t * slot, const char * function ) {
+    rc_t rc = 0;
+    if ( slot -> pending ) {
+        sio_wait( f, slot );
+        slot -> pending = false;
+        if ( slot -> res < 0 ) {
+            rc = RC( rcVDB, rcNoTarg, f -> writing ? rcWriting : rcReading, rcFile, rcFailed );
+            ErrMsg( "spill_io.c %s( '%s' at %lu, %lu bytes ) -> errno %ld",
+                    function, f -> path, slot -> pos, slot -> len, -( slot -> res ) );
+        } else if ( f -> writing && ( size_t )slot -> res != slot -> len ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcFile, rcIncomplete );
+            ErrMsg( "spill_io.c %s( '%s' at %lu, %lu bytes ) -> %ld bytes written",
+                    function, f -> path, slot -> pos, slot -> len, slot -> res );
+        } else if ( !f -> writing && ( size_t )slot -> res < slot -> len &&
+                    slot -> pos + slot -> res < f -> read_size ) {
+            /* the slots advance by block_size: the rest of this block would be missing */
+            rc = RC( rcVDB, rcNoTarg, rcReading, rcFile, rcIncomplete );
+            ErrMsg( "spill_io.c %s( '%s' at %lu, %lu bytes ) -> %ld bytes read of %lu",
+                    function, f -> path, slot -> pos, slot -> len, slot -> res, f -> read_size );
+        }
+    }
+    return rc;
+}
+
+static rc_t sio_wait_all( sio_file_t * f, const char * function ) {
+    rc_t rc = 0;
+    uint32_t idx;
+    for ( idx = 0; idx < f -> depth; ++idx ) {
+        rc_t rc2 = sio_wait_check( f, &( f -> slots[ idx ] ), function );
+        if ( 0 == rc ) { rc = rc2; }
+    }
+    return rc;
+}
+
+static void sio_close( sio_file_t * f ) {
+    uint32_t idx;
+    sio_wait_all( f, "sio_close" ); /* errors are already reported via ErrMsg */
+#ifdef HAVE_LIBURING
+    if ( f -> use_ring ) {
+        io_uring_queue_exit( &( f -> ring ) );
+    }
+#endif
+    for ( idx = 0; idx < f -> depth; ++idx ) {
+        sio_put_block( f -> slots[ idx ] . buf );
+    }
+    if ( f -> fd >= 0 ) {
+        close( f -> fd );
+    }
+    if ( NULL != f -> cond ) {
+        KConditionRelease( f -> cond );
+    }
+    if ( NULL != f -> lock ) {
+        KLockRelease( f -> lock );
+    }
+}
+
+static rc_t sio_open( sio_file_t * f, const KDirectory * dir, bool writing,
+                      const char * fmt, va_list args ) {
+    int flags = writing ? ( O_WRONLY | O_CREAT | O_TRUNC ) : O_RDONLY;
+    uint32_t idx;
+    rc_t rc = KDirectoryVResolvePath( dir, true, f -> path, sizeof f -> path, fmt, args );
+
+    f -> fd = -1;
+    f -> writing = writing;
+    f -> depth = sio -> depth;
+    if ( 0 != rc ) {
+        ErrMsg( "spill_io.c sio_open().KDirectoryVResolvePath() -> %R", rc );
+        return rc;
+    }
+#ifdef O_DIRECT
+    f -> fd = open( f -> path, flags | O_DIRECT, 0664 );
+    if ( f -> fd < 0 && EINVAL == errno ) {
+        /* the file-system does not support O_DIRECT ( tmpfs ): through the page-cache after all */
+        f -> fd = open( f -> path, flags, 0664 );
+    }
+#else
+    f -> fd = open( f -> path, flags, 0664 );
+#ifdef F_NOCACHE
+    if ( f -> fd >= 0 ) {
+        fcntl( f -> fd, F_NOCACHE, 1 ); /* mac: bypass the cache too */
+    }
+#endif
+#endif
+    if ( f -> fd < 0 ) {
+        rc = RC( rcVDB, rcNoTarg, rcOpening, rcFile, rcFailed );
+        ErrMsg( "spill_io.c sio_open( '%s' ) -> errno %d", f -> path, errno );
+        return rc;
+    }
+
+    rc = KLockMake( &( f -> lock ) );
+    if ( 0 != rc ) {
+        ErrMsg( "spill_io.c sio_open().KLockMake() -> %R", rc );
+    } else {
+        rc = KConditionMake( &( f -> cond ) );
+        if ( 0 != rc ) {
+            ErrMsg( "spill_io.c sio_open().KConditionMake() -> %R", rc );
+        }
+    }
+    for ( idx = 0; 0 == rc && idx < f -> depth; ++idx ) {
+        sio_slot_t * slot = &( f -> slots[ idx ] );
+        slot -> file = f;
+        slot -> buf = sio_get_block();
+        if ( NULL == slot -> buf ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "spill_io.c sio_open().posix_memalign( %lu ) -> %R", sio -> block_size, rc );
+        }
+    }
+#ifdef HAVE_LIBURING
+    if ( 0 == rc && sio -> ring_ok ) {
+        /* if the ring cannot be set up for this file, the thread-pool does the work */
+        f -> use_ring = ( 0 == io_uring_queue_init( f -> depth, &( f -> ring ), 0 ) );
+    }
+#endif
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+rc_t spill_io_init( spill_io_mode_t mode, size_t block_size, uint32_t depth ) {
+    rc_t rc = 0;
+    if ( NULL == sio && sio_direct == mode ) {
+        sio_ctx_t * ctx = ( sio_ctx_t * )calloc( 1, sizeof *ctx );
+        if ( NULL == ctx ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "spill_io.c spill_io_init().calloc( %d ) -> %R", ( sizeof *ctx ), rc );
+            return rc;
+        }
+        ctx -> block_size = ft_align_block_size( block_size ); /* file_tools.c */
+        if ( 0 == depth ) { depth = SPILL_IO_DFLT_DEPTH; }
+        if ( depth < 2 ) { depth = 2; }
+        if ( depth > SPILL_IO_MAX_DEPTH ) { depth = SPILL_IO_MAX_DEPTH; }
+        ctx -> depth = depth;
+#ifdef HAVE_LIBURING
+        {
+            /* the kernel may not have io_uring, or a seccomp-profile forbids it ( containers ) */
+            struct io_uring ring;
+            if ( 0 == io_uring_queue_init( depth, &ring, 0 ) ) {
+                ctx -> ring_ok = true;
+                io_uring_queue_exit( &ring );
+            }
+        }
+#endif
+        rc = KLockMake( &( ctx -> lock ) );
+        if ( 0 != rc ) {
+            ErrMsg( "spill_io.c spill_io_init().KLockMake() -> %R", rc );
+        } else {
+            rc = KConditionMake( &( ctx -> cond ) );
+            if ( 0 != rc ) {
+                ErrMsg( "spill_io.c spill_io_init().KConditionMake() -> %R", rc );
+            }
+        }
+        /* the thread-pool is started even with io_uring: a file may not get a ring */
+        while ( 0 == rc && ctx -> num_threads < SIO_NUM_THREADS ) {
+            rc = hlp_make_thread( &( ctx -> threads[ ctx -> num_threads ] ),
+                                  sio_thread_func, ctx, THREAD_DFLT_STACK_SIZE ); /* helper.c */
+            if ( 0 != rc ) {
+                ErrMsg( "spill_io.c spill_io_init().hlp_make_thread() -> %R", rc );
+            } else {
+                ctx -> num_threads++;
+            }
+        }
+        sio = ctx;
+        if ( 0 != rc ) {
+            spill_io_release();
+        }
+    }
+    return rc;
+}
+
+void spill_io_release( void ) {
+    sio_ctx_t * ctx = sio;
+    if ( NULL != ctx ) {
+        uint32_t idx;
+        if ( NULL != ctx -> lock ) {
+            KLockAcquire( ctx -> lock );
+            ctx -> done = true;
+            if ( NULL != ctx -> cond ) {
+                KConditionBroadcast( ctx -> cond );
+            }
+            KLockUnlock( ctx -> lock );
+        }
+        for ( idx = 0; idx < ctx -> num_threads; ++idx ) {
+            KThreadWait( ctx -> threads[ idx ], NULL );
+            KThreadRelease( ctx -> threads[ idx ] );
+        }
+        for ( idx = 0; idx < ctx -> pool_count; ++idx ) {
+            free( ( void * ) ctx -> pool[ idx ] );
+        }
+        if ( NULL != ctx -> cond ) {
+            KConditionRelease( ctx -> cond );
+        }
+        if ( NULL != ctx -> lock ) {
+            KLockRelease( ctx -> lock );
+        }
+        sio = NULL;
+        free( ( void * ) ctx );
+    }
+}
+
+bool spill_io_direct( void ) { return ( NULL != sio ); }
+
+const char * spill_io_backend( void ) {
+    if ( NULL == sio ) { return "buffered"; }
+    return sio -> ring_ok ? "io_uring" : "threads";
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+typedef struct spill_writer_t {
+    sio_file_t f;
+    uint32_t cur;           /* the slot that is filled at the moment */
+    size_t fill;            /* how many bytes are in it */
+    uint64_t next_pos;      /* where in the file it goes */
+    uint64_t size;          /* the logical size of the file */
+    bool finished;
+} spill_writer_t;
+
+rc_t spill_writer_make( struct spill_writer_t ** writer, const KDirectory * dir,
+                        const char * fmt, va_list args ) {
+    rc_t rc;
+    spill_writer_t * w;
+    if ( NULL == sio || NULL == writer ) {
+        return RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+    }
+    w = ( spill_writer_t * )calloc( 1, sizeof *w );
+    if ( NULL == w ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "spill_io.c spill_writer_make().calloc( %d ) -> %R", ( sizeof *w ), rc );
+    } else {
+        rc = sio_open( &( w -> f ), dir, true, fmt, args );
+        if ( 0 == rc ) {
+            *writer = w;
+        } else {
+            sio_close( &( w -> f ) );
+            free( ( void * ) w );
+        }
+    }
+    return rc;
+}
+
+rc_t spill_writer_write( struct spill_writer_t * self, const void * src, size_t size ) {
+    rc_t rc = 0;
+    const uint8_t * p = ( const uint8_t * )src;
+    if ( NULL == self || ( NULL == src && size > 0 ) ) {
+        return RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcInvalid );
+    }
+    while ( 0 == rc && size > 0 ) {
+        sio_slot_t * slot = &( self -> f . slots[ self -> cur ] );
+        /* the slot may still be in flight from the last round through the slots */
+        rc = sio_wait_check( &( self -> f ), slot, "spill_writer_write" );
+        if ( 0 == rc ) {
+            size_t n = sio -> block_size - self -> fill;
+            if ( n > size ) { n = size; }
+            memcpy( slot -> buf + self -> fill, p, n );
+            self -> fill += n;
+            self -> size += n;
+            p += n;
+            size -= n;
+            if ( self -> fill == sio -> block_size ) {
+                sio_submit( &( self -> f ), slot, self -> next_pos, sio -> block_size );
+                self -> next_pos += sio -> block_size;
+                self -> fill = 0;
+                self -> cur = ( self -> cur + 1 ) % self -> f . depth;
+            }
+        }
+    }
+    self -> finished = false;
+    return rc;
+}
+
+rc_t spill_writer_finish( struct spill_writer_t * self ) {
+    rc_t rc = 0;
+    if ( NULL == self ) {
+        return RC( rcVDB, rcNoTarg, rcWriting, rcSelf, rcNull );
+    }
+    if ( !self -> finished ) {
+        if ( self -> fill > 0 ) {
+            /* the tail is padded to the alignment and cut off by ftruncate() below, the slot
+               keeps its content: if more is written later this block is written again */
+            sio_slot_t * slot = &( self -> f . slots[ self -> cur ] );
+            size_t len = ft_align_block_size( self -> fill ); /* file_tools.c */
+            memset( slot -> buf + self -> fill, 0, len - self -> fill );
+            sio_submit( &( self -> f ), slot, self -> next_pos, len );
+        }
+        rc = sio_wait_all( &( self -> f ), "spill_writer_finish" );
+        if ( 0 == rc && 0 != ftruncate( self -> f . fd, self -> size ) ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcFile, rcFailed );
+            ErrMsg( "spill_io.c spill_writer_finish().ftruncate( '%s', %lu ) -> errno %d",
+                    self -> f . path, self -> size, errno );
+        }
+        self -> finished = ( 0 == rc );
+    }
+    return rc;
+}
+
+uint64_t spill_writer_size( const struct spill_writer_t * self ) {
+    return ( NULL == self ) ? 0 : self -> size;
+}
+
+rc_t spill_writer_release( struct spill_writer_t * self ) {
+    rc_t rc = 0;
+    if ( NULL != self ) {
+        rc = spill_writer_finish( self );
+        sio_close( &( self -> f ) );
+        free( ( void * ) self );
+    }
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+typedef struct spill_reader_t {
+    sio_file_t f;
+    uint64_t size;          /* the size of the file */
+    uint64_t next_pos;      /* where the next request reads from */
+    uint32_t cur;           /* the slot with the read-position */
+    size_t ofs;             /* the read-position in this slot */
+} spill_reader_t;
+
+static void spill_reader_request( spill_reader_t * self, sio_slot_t * slot ) {
+    if ( self -> next_pos < self -> size ) {
+        sio_submit( &( self -> f ), slot, self -> next_pos, sio -> block_size );
+        self -> next_pos += sio -> block_size;
+    }
+}
+
+rc_t spill_reader_make( struct spill_reader_t ** reader, const KDirectory * dir,
+                        const char * fmt, va_list args ) {
+    rc_t rc;
+    spill_reader_t * r;
+    if ( NULL == sio || NULL == reader ) {
+        return RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+    }
+    r = ( spill_reader_t * )calloc( 1, sizeof *r );
+    if ( NULL == r ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "spill_io.c spill_reader_make().calloc( %d ) -> %R", ( sizeof *r ), rc );
+    } else {
+        rc = sio_open( &( r -> f ), dir, false, fmt, args );
+        if ( 0 == rc ) {
+            struct stat st;
+            if ( 0 != fstat( r -> f . fd, &st ) ) {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcFile, rcFailed );
+                ErrMsg( "spill_io.c spill_reader_make().fstat( '%s' ) -> errno %d", r -> f . path, errno );
+            } else {
+                uint32_t idx;
+                r -> size = st . st_size;
+                r -> f . read_size = r -> size;
+                /* read-ahead: all slots are in flight from the start */
+                for ( idx = 0; idx < r -> f . depth; ++idx ) {
+                    spill_reader_request( r, &( r -> f . slots[ idx ] ) );
+                }
+            }
+        }
+        if ( 0 == rc ) {
+            *reader = r;
+        } else {
+            sio_close( &( r -> f ) );
+            free( ( void * ) r );
+        }
+    }
+    return rc;
+}
+
+uint64_t spill_reader_size( const struct spill_reader_t * self ) {
+    return ( NULL == self ) ? 0 : self -> size;
+}
+
+rc_t spill_reader_read( struct spill_reader_t * self, void * dst, size_t size, size_t * num_read ) {
+    rc_t rc = 0;
+    uint8_t * p = ( uint8_t * )dst;
+    if ( NULL == self || NULL == num_read || ( NULL == dst && size > 0 ) ) {
+        return RC( rcVDB, rcNoTarg, rcReading, rcParam, rcInvalid );
+    }
+    *num_read = 0;
+    while ( 0 == rc && size > 0 ) {
+        sio_slot_t * slot = &( self -> f . slots[ self -> cur ] );
+        if ( slot -> pending ) {
+            rc = sio_wait_check( &( self -> f ), slot, "spill_reader_read" );
+            if ( 0 == rc ) {
+                slot -> ready = true;
+                self -> ofs = 0;
+            }
+        } else if ( !slot -> ready ) {
+            break;  /* nothing in flight: the end of the file */
+        } else {
+            size_t avail = ( size_t )slot -> res - self -> ofs;
+            if ( 0 == avail ) {
+                /* the slot is consumed: it goes to the end of the read-ahead */
+                slot -> ready = false;
+                spill_reader_request( self, slot );
+                self -> cur = ( self -> cur + 1 ) % self -> f . depth;
+                self -> ofs = 0;
+            } else {
+                if ( avail > size ) { avail = size; }
+                memcpy( p, slot -> buf + self -> ofs, avail );
+                self -> ofs += avail;
+                p += avail;
+                size -= avail;
+                *num_read += avail;
+            }
+        }
+    }
+    return rc;
+}
+
+void spill_reader_release( struct spill_reader_t * self ) {
+    if ( NULL != self ) {
+        sio_close( &( self -> f ) );
+        free( ( void * ) self );
+    }
+}
+
+#endif
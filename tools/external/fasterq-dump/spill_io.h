@@ -0,0 +1,94 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_spill_io_
+#define _h_spill_io_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#include <stdarg.h>
+
+/* ----------------------------------------------------------------------------------------------
+    spill-io: the lookup-files of the merge-sort ( lookup_writer.c, lookup_reader.c in sequential
+    mode ) can be written and read back bypassing the page-cache ( O_DIRECT ), with several
+    aligned blocks in flight per file. The requests go to io_uring if the tool was built with
+    liburing ( HAVE_LIBURING ) and the kernel allows it, otherwise to a small pool of threads
+    doing pread()/pwrite(). The blocks come from a shared pool of aligned buffers.
+    As long as spill_io_init() has not been called with sio_direct, spill_io_direct() returns
+    false and the callers use buffered KFile's as before. ( --spill-io buffered|direct )
+   ---------------------------------------------------------------------------------------------- */
+
+typedef enum spill_io_mode_t { sio_unknown = 0, sio_buffered, sio_direct } spill_io_mode_t;
+
+/* "buffered" or "direct", NULL means sio_buffered */
+spill_io_mode_t spill_io_get_mode( const char * mode );
+
+#define SPILL_IO_DFLT_DEPTH 4
+#define SPILL_IO_MAX_DEPTH 16
+
+/* block_size : bytes per request, aligned by ft_align_block_size()
+   depth      : requests in flight per file ( 2 ... SPILL_IO_MAX_DEPTH, 0 = SPILL_IO_DFLT_DEPTH ) */
+rc_t spill_io_init( spill_io_mode_t mode, size_t block_size, uint32_t depth );
+void spill_io_release( void );
+
+bool spill_io_direct( void );
+const char * spill_io_backend( void );  /* "buffered", "threads" or "io_uring" */
+
+/* sequential writer: collects the bytes into aligned blocks, each full block is written
+   asynchronously, spill_writer_finish() writes the tail and waits for all of them */
+struct spill_writer_t;
+
+rc_t spill_writer_make( struct spill_writer_t ** writer, const KDirectory * dir,
+                        const char * fmt, va_list args );
+rc_t spill_writer_write( struct spill_writer_t * self, const void * src, size_t size );
+rc_t spill_writer_finish( struct spill_writer_t * self );
+uint64_t spill_writer_size( const struct spill_writer_t * self );
+rc_t spill_writer_release( struct spill_writer_t * self );
+
+/* sequential reader: keeps 'depth' blocks ahead of the read-position in flight */
+struct spill_reader_t;
+
+rc_t spill_reader_make( struct spill_reader_t ** reader, const KDirectory * dir,
+                        const char * fmt, va_list args );
+uint64_t spill_reader_size( const struct spill_reader_t * self );
+rc_t spill_reader_read( struct spill_reader_t * self, void * dst, size_t size, size_t * num_read );
+void spill_reader_release( struct spill_reader_t * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
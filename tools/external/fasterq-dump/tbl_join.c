@@ -922,6 +922,7 @@ typedef struct join_thread_data_t {
     struct multi_writer_t * multi_writer;
     struct bg_progress_t * progress;
     struct temp_registry_t * registry;
+    struct dout_t * dout;
     KThread * thread;
 
     uint32_t thread_id;
@@ -931,6 +932,7 @@ typedef struct join_thread_data_t {
     size_t cur_cache;
     size_t buf_size;
     format_t fmt;
+    compress_t compress;
     const join_options_t * join_options;
 
 } join_thread_data_t;
@@ -938,8 +940,39 @@ typedef struct join_thread_data_t {
 static rc_t CC sorted_fastq_fasta_thread_func( const KThread *self, void *data ) {
     rc_t rc = 0;
     join_thread_data_t * jtd = data;
-    flp_args_t file_args;
     table_join_t tj;
+    flp_args_t file_args;   /* referenced by the flex-printer, has to live as long as it */
+    int64_t first_row = jtd -> first_row;
+    uint64_t row_count = jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count;
+    bool has_rows = true;
+
+    if ( NULL != jtd -> dout ) {
+        /* direct-output: the rows are handed out in chunks, the output goes into the final files */
+        tj . printer = flp_create_3( jtd -> dout,
+                                     jtd -> compress,
+                                     jtd -> accession_short,
+                                     jtd -> seq_defline,
+                                     jtd -> qual_defline,
+                                     hlp_is_format_fasta( jtd -> fmt ) ); /* flex_printer.c */
+        if ( NULL == tj . printer ) {
+            dout_abort( jtd -> dout ); /* direct_out.c */
+        } else {
+            has_rows = flp_first_chunk( tj . printer, &first_row, &row_count ); /* flex_printer.c */
+        }
+    } else {
+        flp_initialize_args( &file_args,
+                             jtd -> dir,
+                             jtd -> registry,
+                             jtd -> part_file,
+                             jtd -> buf_size,
+                             jtd -> compress );
+
+        tj . printer = flp_create_1( &file_args,
+                                     jtd -> accession_short,         /* we need that for the flexible defline! */
+                                     jtd -> seq_defline,             /* the seq-defline */
+                                     jtd -> qual_defline,            /* the qual-defline */
+                                     hlp_is_format_fasta( jtd -> fmt ) );    /* fasta-mode */
+    }
 
     cmn_iter_populate_params( &( tj . cp ),
                               jtd -> dir,
@@ -947,20 +980,14 @@ static rc_t CC sorted_fastq_fasta_thread_func( const KThread *self, void *data )
                               jtd -> accession_short,
                               jtd -> accession_path,
                               jtd -> cur_cache,
-                              jtd -> first_row,
-                              jtd -> row_limit > 0 ? jtd -> row_limit : jtd -> row_count );
-    
-    flp_initialize_args( &file_args,
-                         jtd -> dir,
-                         jtd -> registry,
-                         jtd -> part_file,
-                         jtd -> buf_size );
-    
-    tj . printer = flp_create_1( &file_args,
-                                 jtd -> accession_short,         /* we need that for the flexible defline! */
-                                 jtd -> seq_defline,             /* the seq-defline */
-                                 jtd -> qual_defline,            /* the qual-defline */
-                                 hlp_is_format_fasta( jtd -> fmt ) );    /* fasta-mode */
+                              first_row,
+                              row_count );
+    if ( NULL != jtd -> dout ) {
+        /* the iterator continues with the next chunk when the current one is done */
+        tj . cp . next_range = flp_next_chunk; /* flex_printer.c */
+        tj . cp . next_range_ctx = tj . printer;
+    }
+
     tj . filter = hlp_make_2na_filter( jtd -> join_options -> filter_bases );
 
     tj . stats = &jtd -> stats;
@@ -969,7 +996,7 @@ static rc_t CC sorted_fastq_fasta_thread_func( const KThread *self, void *data )
     tj . jo = jtd -> join_options;
     tj . has_read_type = jtd -> has_read_type;
     
-    if ( NULL != tj . printer ) {
+    if ( NULL != tj . printer && has_rows ) {
         switch( jtd -> fmt )
         {
             case ft_fastq_whole_spot : rc = perform_fastq_whole_spot_join( &tj ); break;
@@ -987,8 +1014,9 @@ static rc_t CC sorted_fastq_fasta_thread_func( const KThread *self, void *data )
             case ft_fasta_concat : break;           /* or this */                
             case ft_ref_report : break;             /* or this */
         }
-        flp_release( tj . printer );
+        rc = flp_finish( tj . printer, rc ); /* flex_printer.c */
     }
+    flp_release( tj . printer ); /* flex_printer.c ( ignores NULL ) */
     hlp_release_2na_filter( tj . filter );
     return rc;
 }
@@ -1027,7 +1055,8 @@ rc_t execute_tbl_join( const execute_tbl_join_args_t * args ) {
         if ( 0 == rc && row_count > 0 ) {
             bool name_column_present = args -> insp_output -> seq . has_name_column;
             Vector threads;
-            int64_t row = 1;
+            int64_t row = args -> insp_output -> seq . first_row;
+            int64_t end_row = row + row_count;
             uint32_t thread_id;
             uint32_t num_threads = args -> num_threads;
             uint64_t rows_per_thread;
@@ -1044,7 +1073,7 @@ rc_t execute_tbl_join( const execute_tbl_join_args_t * args ) {
                 rc = bg_progress_make( &progress, row_count, 0, 0 ); /* progress_thread.c */
             }
 
-            for ( thread_id = 0; 0 == rc && thread_id < num_threads; ++thread_id ) {
+            for ( thread_id = 0; 0 == rc && thread_id < num_threads && row < end_row; ++thread_id ) {
                 join_thread_data_t * jtd = calloc( 1, sizeof * jtd );
                 if ( NULL != jtd ) {
                     jtd -> dir              = args -> dir;
@@ -1055,11 +1084,13 @@ rc_t execute_tbl_join( const execute_tbl_join_args_t * args ) {
                     jtd -> qual_defline     = args -> qual_defline;
                     jtd -> tbl_name         = args -> tbl_name;
                     jtd -> first_row        = row;
-                    jtd -> row_count        = rows_per_thread;
+                    jtd -> row_count        = hlp_rows_of_thread( row, rows_per_thread, end_row ); /* helper.c */
                     jtd -> cur_cache        = args -> cursor_cache;
                     jtd -> buf_size         = args -> buf_size;
                     jtd -> progress         = progress;
                     jtd -> registry         = args -> registry;
+                    jtd -> dout             = args -> dout;
+                    jtd -> compress         = args -> compress;
                     jtd -> fmt              = args -> fmt;
                     jtd -> join_options     = &corrected_join_options;
                     jtd -> thread_id        = thread_id;
@@ -1216,12 +1247,14 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                     args -> buf_size,
                     0,                          /* q_wait_time, if 0 --> use default = 5 ms */
                     args -> num_threads * 3,    /* q_num_blocks, if 0 use default = 8 */
-                    0 );                        /* q_block_size, if 0 use default = 4 MB */
+                    0,                          /* q_block_size, if 0 use default = 4 MB */
+                    args -> compress );         /* compressed by the producing threads */
             if ( NULL != multi_writer ) {
                 /* create a 2na-base-filter ( if filterbases were given, by default not ) */
                 struct filter_2na_t * filter = hlp_make_2na_filter( args -> join_options -> filter_bases );
                 Vector threads;
-                int64_t row = 1;
+                int64_t row = args -> insp_output -> seq . first_row;
+                int64_t end_row = row + row_count;
                 uint32_t thread_id;
                 uint32_t num_threads = args -> num_threads;
                 uint64_t rows_per_thread;
@@ -1235,7 +1268,7 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                 rows_per_thread = hlp_calculate_rows_per_thread( &num_threads, row_count );
                 if ( args -> show_progress ) { rc = bg_progress_make( &progress, row_count, 0, 0 ); } /* progress_thread.c */
 
-                for ( thread_id = 0; 0 == rc && thread_id < num_threads; ++thread_id ) {
+                for ( thread_id = 0; 0 == rc && thread_id < num_threads && row < end_row; ++thread_id ) {
                     join_thread_data_t * jtd = calloc( 1, sizeof * jtd ); /* above */
                     if ( NULL != jtd ) {
                         jtd -> dir              = args -> dir;
@@ -1245,7 +1278,7 @@ rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args
                         jtd -> seq_defline      = args -> seq_defline;
                         jtd -> tbl_name         = args -> tbl_name;
                         jtd -> first_row        = row;
-                        jtd -> row_count        = rows_per_thread;
+                        jtd -> row_count        = hlp_rows_of_thread( row, rows_per_thread, end_row ); /* helper.c */
                         jtd -> cur_cache        = args -> cursor_cache;
                         jtd -> buf_size         = args -> buf_size;
                         jtd -> progress         = progress;
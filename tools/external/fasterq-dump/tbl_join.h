@@ -59,6 +59,10 @@ extern "C" {
 #include "inspector.h"
 #endif
 
+#ifndef _h_direct_out_
+#include "direct_out.h"
+#endif
+
 typedef struct execute_tbl_join_args_t {
     KDirectory * dir;
     const VDBManager * vdb_mgr;
@@ -72,12 +76,14 @@ typedef struct execute_tbl_join_args_t {
     const join_options_t * join_options;    /* helper.h */
     const struct temp_dir_t * temp_dir;     /* temp_dir.h */
     struct temp_registry_t * registry;      /* temp_registry.h */
+    struct dout_t * dout;                   /* direct_out.h, if not NULL: no temp-files, registry is not used */
     size_t cursor_cache;
     size_t buf_size;
     uint32_t num_threads;
     uint64_t row_limit;
     bool show_progress;
     format_t fmt;                       /* helper.h */
+    compress_t compress;                /* helper.h, compress the output-blocks */
 } execute_tbl_join_args_t;
 
 rc_t execute_tbl_join( const execute_tbl_join_args_t * args );
@@ -99,6 +105,7 @@ typedef struct execute_fasta_tbl_join_args_t {
     uint64_t row_limit;
     bool show_progress;
     bool force;
+    compress_t compress;                /* helper.h, compress the output-blocks */
 } execute_fasta_tbl_join_args_t;
 
 rc_t execute_unsorted_fasta_tbl_join( const execute_fasta_tbl_join_args_t * args );
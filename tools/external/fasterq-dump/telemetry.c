@@ -0,0 +1,465 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "telemetry.h"
+
+#ifndef _h_err_msg_
+#include "err_msg.h"
+#endif
+
+#ifndef _h_helper_
+#include "helper.h"   /* hlp_make_thread */
+#endif
+
+#ifndef _h_atomic_
+#include <atomic.h>
+#endif
+
+#ifndef _h_atomic64_
+#include <atomic64.h>
+#endif
+
+#ifndef _h_kproc_thread_
+#include <kproc/thread.h>
+#endif
+
+#ifndef _h_kfs_directory_
+#include <kfs/directory.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+#ifndef _h_klib_time_
+#include <klib/time.h>
+#endif
+
+#ifndef _h_klib_printf_
+#include <klib/printf.h>
+#endif
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WINDOWS
+/* no cpu-time and no peak-rss for WINDOWS... */
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/* ---------------------------------------------------------------------------------- */
+
+#ifdef WINDOWS
+
+static uint64_t tele_now( void ) { return ( uint64_t )KTimeMsStamp() * 1000; }
+static uint64_t tele_cpu( void ) { return 0; }
+static uint64_t tele_peak_rss( void ) { return 0; }
+
+#else
+
+static uint64_t tele_now( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( ( uint64_t )ts . tv_sec * 1000000 ) + ( ts . tv_nsec / 1000 );
+}
+
+static uint64_t tele_tv( const struct timeval * tv ) {
+    return ( ( uint64_t )tv -> tv_sec * 1000000 ) + tv -> tv_usec;
+}
+
+static uint64_t tele_cpu( void ) {
+    struct rusage ru;
+    if ( 0 != getrusage( RUSAGE_SELF, &ru ) ) { return 0; }
+    return tele_tv( &( ru . ru_utime ) ) + tele_tv( &( ru . ru_stime ) );
+}
+
+static uint64_t tele_peak_rss( void ) {
+    struct rusage ru;
+    if ( 0 != getrusage( RUSAGE_SELF, &ru ) ) { return 0; }
+#if defined( __APPLE__ )
+    return ru . ru_maxrss;          /* bytes on mac */
+#else
+    return ru . ru_maxrss * 1024;   /* kilobytes on linux */
+#endif
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------- */
+
+static const char * tele_stage_names[ ts_count ] = { "inspect", "lookup", "merge", "join", "concat" };
+
+typedef struct tele_stage_data_t {
+    atomic64_t rows;
+    atomic64_t bytes_read;
+    atomic64_t bytes_written;
+    atomic64_t wait_us;         /* producers blocked on a queue */
+    atomic64_t idle_us;         /* writer-threads waiting for data */
+    atomic64_t wall_us;         /* accumulated at tele_stage_end() */
+    atomic64_t started;         /* != 0 while the stage is running */
+    uint64_t cpu_us;
+    uint64_t started_cpu;
+    uint64_t peak_rss;          /* peak-rss of the process at the end of the stage */
+    bool used;
+} tele_stage_data_t;
+
+typedef struct tele_t {
+    tele_stage_data_t stages[ ts_count ];
+    atomic_t current;           /* the stage the counters go to */
+    atomic_t done;
+    KThread * thread;           /* prints the progress-lines, NULL if no interval given */
+    KFile * err;                /* stderr for the progress-lines */
+    uint64_t err_pos;
+    uint64_t start_us;
+    uint64_t start_cpu;
+    uint32_t interval_secs;
+} tele_t;
+
+static tele_t * tele = NULL;
+
+/* ---------------------------------------------------------------------------------- */
+
+static rc_t tele_print( KFile * f, uint64_t * pos, const char * fmt, ... ) {
+    char buffer[ 4096 ];
+    size_t num_writ;
+    va_list args;
+    rc_t rc;
+    va_start( args, fmt );
+    rc = string_vprintf( buffer, sizeof buffer, &num_writ, fmt, args );
+    va_end( args );
+    if ( 0 != rc ) {
+        ErrMsg( "telemetry.c tele_print().string_vprintf() -> %R", rc );
+    } else {
+        size_t written;
+        rc = KFileWriteAll( f, *pos, buffer, num_writ, &written );
+        if ( 0 != rc ) {
+            ErrMsg( "telemetry.c tele_print().KFileWriteAll() -> %R", rc );
+        } else {
+            *pos += written;
+        }
+    }
+    return rc;
+}
+
+/* how long a stage has been running so far, including the current run */
+static uint64_t tele_stage_wall( tele_stage_data_t * s, uint64_t now ) {
+    uint64_t res = atomic64_read( &( s -> wall_us ) );
+    uint64_t started = atomic64_read( &( s -> started ) );
+    if ( started > 0 && now > started ) { res += ( now - started ); }
+    return res;
+}
+
+static uint64_t tele_per_sec( uint64_t value, uint64_t us ) {
+    return ( us > 0 ) ? ( uint64_t )( ( ( double )value * 1000000.0 ) / us ) : 0;
+}
+
+static void tele_print_progress( tele_t * self ) {
+    uint32_t stage = atomic_read( &( self -> current ) );
+    tele_stage_data_t * s = &( self -> stages[ stage ] );
+    uint64_t now = tele_now();
+    uint64_t stage_us = tele_stage_wall( s, now );
+    uint64_t rows = atomic64_read( &( s -> rows ) );
+    /* one line of JSON per interval, for the job-scheduler */
+    tele_print( self -> err, &( self -> err_pos ),
+        "{\"type\":\"progress\",\"elapsed_ms\":%lu,\"stage\":\"%s\",\"stage_ms\":%lu,\"rows\":%lu,"
+        "\"rows_per_sec\":%lu,\"bytes_read\":%lu,\"bytes_written\":%lu,\"queue_wait_ms\":%lu,"
+        "\"writer_idle_ms\":%lu,\"peak_rss\":%lu}\n",
+        ( now - self -> start_us ) / 1000,
+        tele_stage_names[ stage ],
+        stage_us / 1000,
+        rows,
+        tele_per_sec( rows, stage_us ),
+        ( uint64_t )atomic64_read( &( s -> bytes_read ) ),
+        ( uint64_t )atomic64_read( &( s -> bytes_written ) ),
+        ( uint64_t )atomic64_read( &( s -> wait_us ) ) / 1000,
+        ( uint64_t )atomic64_read( &( s -> idle_us ) ) / 1000,
+        tele_peak_rss() );
+}
+
+static rc_t CC tele_thread_func( const KThread * thread, void * data ) {
+    tele_t * self = data;
+    uint64_t interval = ( uint64_t )self -> interval_secs * 1000000;
+    uint64_t next = tele_now() + interval;
+    while ( 0 == atomic_read( &( self -> done ) ) ) {
+        KSleepMs( 100 );
+        if ( tele_now() >= next ) {
+            tele_print_progress( self );
+            next += interval;
+        }
+    }
+    return 0;
+}
+
+rc_t tele_start( uint32_t interval_secs ) {
+    rc_t rc = 0;
+    if ( NULL == tele ) {
+        tele_t * t = calloc( 1, sizeof *t );
+        if ( NULL == t ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "telemetry.c tele_start().calloc( %d ) -> %R", ( sizeof *t ), rc );
+        } else {
+            t -> start_us = tele_now();
+            t -> start_cpu = tele_cpu();
+            t -> interval_secs = interval_secs;
+            if ( interval_secs > 0 ) {
+                rc = KFileMakeStdErr( &( t -> err ) );
+                if ( 0 != rc ) {
+                    ErrMsg( "telemetry.c tele_start().KFileMakeStdErr() -> %R", rc );
+                } else {
+                    rc = hlp_make_thread( &( t -> thread ), tele_thread_func, t, THREAD_DFLT_STACK_SIZE );
+                    if ( 0 != rc ) {
+                        ErrMsg( "telemetry.c tele_start().helper_make_thread() -> %R", rc );
+                        KFileRelease( t -> err );
+                    }
+                }
+            }
+            if ( 0 == rc ) {
+                tele = t;
+            } else {
+                free( ( void * ) t );
+            }
+        }
+    }
+    return rc;
+}
+
+bool tele_active( void ) { return ( NULL != tele ); }
+
+void tele_stop( void ) {
+    tele_t * t = tele;
+    if ( NULL != t ) {
+        if ( NULL != t -> thread ) {
+            atomic_set( &( t -> done ), 1 );
+            KThreadWait( t -> thread, NULL );
+            KThreadRelease( t -> thread );
+        }
+        if ( NULL != t -> err ) { KFileRelease( t -> err ); }
+        tele = NULL;
+        free( ( void * ) t );
+    }
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+void tele_stage_begin( tele_stage_t stage ) {
+    if ( NULL != tele && stage < ts_count ) {
+        tele_stage_data_t * s = &( tele -> stages[ stage ] );
+        s -> used = true;
+        s -> started_cpu = tele_cpu();
+        atomic64_set( &( s -> started ), tele_now() );
+        atomic_set( &( tele -> current ), stage );
+    }
+}
+
+void tele_stage_end( tele_stage_t stage ) {
+    if ( NULL != tele && stage < ts_count ) {
+        tele_stage_data_t * s = &( tele -> stages[ stage ] );
+        uint64_t started = atomic64_read( &( s -> started ) );
+        if ( started > 0 ) {
+            atomic64_read_and_add( &( s -> wall_us ), tele_now() - started );
+            atomic64_set( &( s -> started ), 0 );
+            s -> cpu_us += ( tele_cpu() - s -> started_cpu );
+            s -> peak_rss = tele_peak_rss();
+        }
+    }
+}
+
+uint64_t tele_clock( void ) {
+    return ( NULL == tele ) ? 0 : tele_now();
+}
+
+static tele_stage_data_t * tele_current( void ) {
+    return &( tele -> stages[ atomic_read( &( tele -> current ) ) ] );
+}
+
+void tele_add_rows( uint64_t rows ) {
+    if ( NULL != tele && rows > 0 ) { atomic64_read_and_add( &( tele_current() -> rows ), rows ); }
+}
+
+void tele_add_read( uint64_t bytes ) {
+    if ( NULL != tele && bytes > 0 ) { atomic64_read_and_add( &( tele_current() -> bytes_read ), bytes ); }
+}
+
+void tele_add_written( uint64_t bytes ) {
+    if ( NULL != tele && bytes > 0 ) { atomic64_read_and_add( &( tele_current() -> bytes_written ), bytes ); }
+}
+
+void tele_add_wait_since( uint64_t start ) {
+    if ( NULL != tele && start > 0 ) { atomic64_read_and_add( &( tele_current() -> wait_us ), tele_now() - start ); }
+}
+
+void tele_add_idle_since( uint64_t start ) {
+    if ( NULL != tele && start > 0 ) { atomic64_read_and_add( &( tele_current() -> idle_us ), tele_now() - start ); }
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+#define TELE_ACC_ROWS 4096
+#define TELE_ACC_BYTES ( 1024 * 1024 )
+
+void tele_acc_check( tele_acc_t * acc ) {
+    if ( acc -> rows >= TELE_ACC_ROWS ||
+         acc -> bytes_read >= TELE_ACC_BYTES ||
+         acc -> bytes_written >= TELE_ACC_BYTES ) {
+        tele_acc_flush( acc );
+    }
+}
+
+void tele_acc_flush( tele_acc_t * acc ) {
+    if ( NULL != acc ) {
+        tele_add_rows( acc -> rows );
+        tele_add_read( acc -> bytes_read );
+        tele_add_written( acc -> bytes_written );
+        memset( acc, 0, sizeof *acc );
+    }
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+/* the accession may be a path: escape what JSON does not allow in a string */
+static void tele_json_string( char * dst, size_t dst_size, const char * src ) {
+    size_t i = 0;
+    if ( NULL != src ) {
+        while ( 0 != *src && i + 2 < dst_size ) {
+            char c = *src++;
+            if ( '"' == c || '\\' == c ) {
+                dst[ i++ ] = '\\';
+                dst[ i++ ] = c;
+            } else if ( ( unsigned char )c >= 0x20 ) {
+                dst[ i++ ] = c;
+            }
+        }
+    }
+    dst[ i ] = 0;
+}
+
+static rc_t tele_print_stages( tele_t * self, KFile * f, uint64_t * pos, uint64_t now ) {
+    rc_t rc = tele_print( f, pos, "  \"stages\" : [" );
+    uint32_t idx;
+    bool first = true;
+    for ( idx = 0; 0 == rc && idx < ts_count; ++idx ) {
+        tele_stage_data_t * s = &( self -> stages[ idx ] );
+        if ( s -> used ) {
+            uint64_t wall_us = tele_stage_wall( s, now );
+            uint64_t rows = atomic64_read( &( s -> rows ) );
+            uint64_t bytes_read = atomic64_read( &( s -> bytes_read ) );
+            uint64_t bytes_written = atomic64_read( &( s -> bytes_written ) );
+            rc = tele_print( f, pos,
+                "%s\n    { \"name\" : \"%s\", \"wall_ms\" : %lu, \"cpu_ms\" : %lu, \"rows\" : %lu, "
+                "\"rows_per_sec\" : %lu, \"bytes_read\" : %lu, \"read_bytes_per_sec\" : %lu, "
+                "\"bytes_written\" : %lu, \"write_bytes_per_sec\" : %lu, \"queue_wait_ms\" : %lu, "
+                "\"writer_idle_ms\" : %lu, \"peak_rss\" : %lu }",
+                first ? "" : ",",
+                tele_stage_names[ idx ],
+                wall_us / 1000,
+                s -> cpu_us / 1000,
+                rows,
+                tele_per_sec( rows, wall_us ),
+                bytes_read,
+                tele_per_sec( bytes_read, wall_us ),
+                bytes_written,
+                tele_per_sec( bytes_written, wall_us ),
+                ( uint64_t )atomic64_read( &( s -> wait_us ) ) / 1000,
+                ( uint64_t )atomic64_read( &( s -> idle_us ) ) / 1000,
+                s -> peak_rss );
+            first = false;
+        }
+    }
+    if ( 0 == rc ) {
+        rc = tele_print( f, pos, "\n  ]\n" );
+    }
+    return rc;
+}
+
+static rc_t tele_print_report( tele_t * self, KFile * f, uint64_t * pos, const tele_report_args_t * args ) {
+    char accession[ 1024 ];
+    uint64_t now = tele_now();
+    rc_t rc;
+
+    tele_json_string( accession, sizeof accession, args -> accession );
+    rc = tele_print( f, pos,
+        "{\n"
+        "  \"tool\" : \"fasterq-dump\",\n"
+        "  \"accession\" : \"%s\",\n"
+        "  \"format\" : \"%s\",\n"
+        "  \"rc\" : %u,\n"
+        "  \"settings\" : { \"threads\" : %u, \"mem\" : %lu, \"bufsize\" : %lu, \"curcache\" : %lu },\n"
+        "  \"wall_ms\" : %lu,\n"
+        "  \"cpu_ms\" : %lu,\n"
+        "  \"peak_rss\" : %lu,\n",
+        accession,
+        NULL != args -> format ? args -> format : "",
+        args -> rc,
+        args -> num_threads,
+        ( uint64_t )args -> mem_limit,
+        ( uint64_t )args -> buf_size,
+        ( uint64_t )args -> cursor_cache,
+        ( now - self -> start_us ) / 1000,
+        ( tele_cpu() - self -> start_cpu ) / 1000,
+        tele_peak_rss() );
+    if ( 0 == rc ) {
+        rc = tele_print_stages( self, f, pos, now );
+    }
+    if ( 0 == rc ) {
+        rc = tele_print( f, pos, "}\n" );
+    }
+    return rc;
+}
+
+rc_t tele_write_report( const char * filename, const tele_report_args_t * args ) {
+    rc_t rc = 0;
+    if ( NULL != tele && NULL != filename && NULL != args ) {
+        KFile * f;
+        uint64_t pos = 0;
+        if ( 0 == strcmp( filename, "-" ) ) {
+            rc = KFileMakeStdErr( &f );
+            if ( 0 != rc ) {
+                ErrMsg( "telemetry.c tele_write_report().KFileMakeStdErr() -> %R", rc );
+            }
+        } else {
+            KDirectory * dir;
+            rc = KDirectoryNativeDir( &dir );
+            if ( 0 != rc ) {
+                ErrMsg( "telemetry.c tele_write_report().KDirectoryNativeDir() -> %R", rc );
+            } else {
+                rc = KDirectoryCreateFile( dir, &f, false, 0664, kcmInit | kcmParents, "%s", filename );
+                if ( 0 != rc ) {
+                    ErrMsg( "telemetry.c tele_write_report().KDirectoryCreateFile( '%s' ) -> %R", filename, rc );
+                }
+                KDirectoryRelease( dir );
+            }
+        }
+        if ( 0 == rc ) {
+            rc = tele_print_report( tele, f, &pos, args );
+            KFileRelease( f );
+        }
+    }
+    return rc;
+}
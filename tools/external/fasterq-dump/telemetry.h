@@ -0,0 +1,102 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_telemetry_
+#define _h_telemetry_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+/* ----------------------------------------------------------------------------------------------
+    telemetry: per-stage wall-/cpu-time, rows, bytes read and written and time spent waiting
+    on the writer-queues. The stages run one after the other, all counters go to the stage that
+    is running at the moment ( work of the background-mergers that overlaps the lookup-stage is
+    counted there ). As long as tele_start() has not been called every function here is a no-op.
+    ( --stats-json FILE, --stats-interval SECONDS )
+   ---------------------------------------------------------------------------------------------- */
+
+typedef enum tele_stage_t {
+    ts_inspect = 0,     /* inspector.c */
+    ts_lookup,          /* sorter.c, reading PRIMARY_ALIGNMENT */
+    ts_merge,           /* merge_sorter.c, merge-sorting the lookup */
+    ts_join,            /* db_join.c / tbl_join.c, producing the output */
+    ts_concat,          /* concatenator.c / direct_out.c, the output in its final place */
+    ts_count
+} tele_stage_t;
+
+/* interval_secs > 0 : print a progress-line ( JSON ) to stderr every interval_secs seconds */
+rc_t tele_start( uint32_t interval_secs );
+bool tele_active( void );
+
+void tele_stage_begin( tele_stage_t stage );
+void tele_stage_end( tele_stage_t stage );
+
+/* microseconds from a monotonic clock, 0 if telemetry is not active */
+uint64_t tele_clock( void );
+
+void tele_add_rows( uint64_t rows );
+void tele_add_read( uint64_t bytes );
+void tele_add_written( uint64_t bytes );
+void tele_add_wait_since( uint64_t start );     /* producer blocked on a full queue / no free block */
+void tele_add_idle_since( uint64_t start );     /* writer-thread waiting for something to write */
+
+/* thread-local accumulator for the hot loops: the shared counters are touched only
+   when enough has been collected, and in tele_acc_flush() */
+typedef struct tele_acc_t {
+    uint64_t rows;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+} tele_acc_t;
+
+void tele_acc_check( tele_acc_t * acc );
+void tele_acc_flush( tele_acc_t * acc );
+
+typedef struct tele_report_args_t {
+    const char * accession;
+    const char * format;
+    uint32_t num_threads;
+    size_t mem_limit;
+    size_t buf_size;
+    size_t cursor_cache;
+    rc_t rc;
+} tele_report_args_t;
+
+/* filename "-" : stderr */
+rc_t tele_write_report( const char * filename, const tele_report_args_t * args );
+
+/* stops the progress-lines and ends the telemetry */
+void tele_stop( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
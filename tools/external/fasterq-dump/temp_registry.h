@@ -62,7 +62,8 @@ rc_t temp_registry_merge( struct temp_registry_t * self,
                           size_t buf_size,
                           bool show_progress,
                           bool force,
-                          bool append );
+                          bool append,
+                          compress_t compress );
 
 rc_t temp_registry_to_stdout( struct temp_registry_t * self,
                               KDirectory * dir,
@@ -77,6 +77,14 @@
 #include "dflt_defline.h"
 #endif
 
+#ifndef _h_mem_lookup_
+#include "mem_lookup.h"
+#endif
+
+#ifndef _h_auto_tune_
+#include "auto_tune.h"
+#endif
+
 bool tctx_populate_cmn_iter_params( const tool_ctx_t * tool_ctx,
                                         cmn_iter_params_t * params ) {
     bool res = false;
@@ -111,6 +119,12 @@ static rc_t tctx_print( const tool_ctx_t * tool_ctx ) {
     if ( 0 == rc && tool_ctx -> row_limit > 0 ) {
         rc = KOutMsg( "row-limit    : %,lu rows\n", tool_ctx -> row_limit );
     }
+    if ( 0 == rc && tool_ctx -> shard . requested ) {
+        rc = KOutMsg( "shard        : rows %,ld ... %,ld ( %,lu rows )\n",
+                      tool_ctx -> shard . first_row,
+                      tool_ctx -> shard . first_row + ( int64_t )tool_ctx -> shard . row_count - 1,
+                      tool_ctx -> shard . row_count );
+    }
     if ( 0 == rc ) {
         rc = KOutMsg( "scratch-path : '%s'\n", get_temp_dir( tool_ctx -> temp_dir ) /* temp_dir.h */ );
     }
@@ -140,6 +154,12 @@ static rc_t tctx_print( const tool_ctx_t * tool_ctx ) {
     if ( 0 == rc ) {
         rc = KOutMsg( "stdout-mode  : '%s'\n", hlp_yes_or_no( tool_ctx -> use_stdout ) );
     }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "direct-write : '%s'\n", hlp_yes_or_no( tool_ctx -> direct_write ) );
+    }
+    if ( 0 == rc ) {
+        rc = KOutMsg( "compress     : '%s'\n", hlp_compress_2_string( tool_ctx -> compress ) );
+    }
     if ( 0 == rc ) {
         rc = KOutMsg( "seq-defline  : '%s'\n", tool_ctx -> seq_defline );
     }
@@ -275,6 +295,7 @@ static rc_t tctx_check_output_exits( tool_ctx_t * tool_ctx ) {
 static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
     rc_t rc = 0;
     bool ignore_stdout = false;
+    bool compress_rejected = false;
     uint32_t env_thread_count = ahlp_get_env_u32( "DLFT_THREAD_COUNT", 0 );
     if ( env_thread_count > 0  ) {
         tool_ctx -> num_threads = env_thread_count;
@@ -287,6 +308,8 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
     if ( tool_ctx -> mem_limit < MIN_MEM_LIMIT ) {
         tool_ctx -> mem_limit = MIN_MEM_LIMIT;
     }
+    /* without --auto-tune the lookup in memory gets what --mem gives */
+    tool_ctx -> mem_lookup_limit = tool_ctx -> mem_limit;
     if ( tool_ctx -> buf_size > MAX_BUF_SIZE ) {
         tool_ctx -> buf_size = MAX_BUF_SIZE;
     }
@@ -310,6 +333,19 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
         tool_ctx -> force = false;
         tool_ctx -> append = false;
     }
+    /* direct-write needs seekable output-files and all rows of the table */
+    if ( tool_ctx -> use_stdout || tool_ctx -> row_limit > 0 ) {
+        tool_ctx -> direct_write = false;
+    }
+    /* compressed output is produced only into files, and not for the reference-modes */
+    if ( ct_none != tool_ctx -> compress ) {
+        switch( tool_ctx -> fmt ) {
+            case ft_fasta_ref_tbl   : compress_rejected = true; break;
+            case ft_fasta_concat    : compress_rejected = true; break;
+            case ft_ref_report      : compress_rejected = true; break;
+            default : compress_rejected = tool_ctx -> use_stdout; break;
+        }
+    }
     if ( tool_ctx -> only_aligned && tool_ctx -> only_unaligned ) {
         tool_ctx -> only_aligned = false;
         tool_ctx -> only_unaligned = false;
@@ -318,6 +354,14 @@ static rc_t tctx_encforce_constrains( tool_ctx_t * tool_ctx ) {
         rc = RC( rcExe, rcFile, rcPacking, rcName, rcExists );
         ErrMsg( "directing output to stdout requested." );
         ErrMsg( "but requested mode ( %s ) would produce multiple files", hlp_fmt_2_string( tool_ctx -> fmt ) );
+    } else if ( compress_rejected ) {
+        rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcUnsupported );
+        ErrMsg( "compressed output ( %s ) requested", hlp_compress_2_string( tool_ctx -> compress ) );
+        if ( tool_ctx -> use_stdout ) {
+            ErrMsg( "but output to stdout is not compressed" );
+        } else {
+            ErrMsg( "but requested mode ( %s ) is not compressed", hlp_fmt_2_string( tool_ctx -> fmt ) );
+        }
     }
     return rc;
 }
@@ -401,9 +445,10 @@ static rc_t tctx_make_output_filename_from_accession( tool_ctx_t * tool_ctx, boo
                                 true /* absolute */,
                                 &( tool_ctx -> dflt_output[ 0 ] ),
                                 sizeof tool_ctx -> dflt_output,
-                                "%s%s",
+                                "%s%s%s",
                                 tool_ctx -> accession_short,
-                                hlp_out_ext( fasta ) /* helper.c */ );
+                                hlp_out_ext( fasta ), /* helper.c */
+                                hlp_compress_ext( tool_ctx -> compress ) /* helper.c */ );
     if ( 0 != rc ) {
         ErrMsg( "tool_ctx_make_output_filename_from_accession.KDirectoryResolvePath() -> %R", rc );
     } else {
@@ -419,10 +464,11 @@ static rc_t tctx_make_output_filename_from_dir_and_accession( tool_ctx_t * tool_
                                 true /* absolute */,
                                 &( tool_ctx -> dflt_output[ 0 ] ),
                                 sizeof tool_ctx -> dflt_output,
-                                es ? "%s%s%s" : "%s/%s%s",
+                                es ? "%s%s%s%s" : "%s/%s%s%s",
                                 tool_ctx -> output_dirname,
                                 tool_ctx -> accession_short,
-                                hlp_out_ext( fasta ) /* helper.c */ );
+                                hlp_out_ext( fasta ), /* helper.c */
+                                hlp_compress_ext( tool_ctx -> compress ) /* helper.c */ );
     if ( 0 != rc ) {
         ErrMsg( "tool_ctx_make_output_filename_from_dir_and_accession.KDirectoryResolvePath() -> %R", rc );
     } else {
@@ -512,8 +558,8 @@ static size_t tctx_temp_file_sizes( tool_ctx_t * tool_ctx ) {
         res = ( tool_ctx -> insp_output . acc_size * tool_ctx -> num_threads );
     }
 
-    /* in case of ft_fasta_us_split_spot: there are no temp-files*/
-    if ( ft_fasta_us_split_spot != tool_ctx -> fmt ) {
+    /* in case of ft_fasta_us_split_spot or direct-write: there are no temp-files for the output */
+    if ( ft_fasta_us_split_spot != tool_ctx -> fmt && !tool_ctx -> direct_write ) {
         /* if we do use temp-files: they need as much space as the generated output */
         res = tool_ctx -> estimated_output_size;
         /* plus ( size / thread-count ) */
@@ -642,6 +688,134 @@ static rc_t tctx_check_available_columns( tool_ctx_t * tool_ctx ) {
     return rc;
 }
 
+/* only the modes walking the SEQ-table in spot-order can be split into shards */
+static rc_t tctx_check_shard_mode( const tool_ctx_t * tool_ctx ) {
+    rc_t rc = 0;
+    bool supported = true;
+    switch( tool_ctx -> fmt ) {
+        case ft_fasta_ref_tbl       : supported = false; break;
+        case ft_fasta_concat        : supported = false; break;
+        case ft_ref_report          : supported = false; break;
+        /* the unsorted cSRA-mode walks the alignment-table too */
+        case ft_fasta_us_split_spot : supported = ( acc_csra != tool_ctx -> insp_output . acc_type ); break;
+        default : break;
+    }
+    if ( !supported ) {
+        rc = RC( rcExe, rcArgv, rcParsing, rcParam, rcUnsupported );
+        ErrMsg( "output-format '%s' cannot be split into shards -> %R", hlp_fmt_2_string( tool_ctx -> fmt ), rc );
+    }
+    return rc;
+}
+
+/* '/out/SRR000001.fastq' -> '/out/SRR000001.rows_1-1000/SRR000001.fastq' */
+static rc_t tctx_make_shard_output_filename( tool_ctx_t * tool_ctx ) {
+    char filename[ DFLT_PATH_LEN ];
+    rc_t rc = shard_make_output_filename( &( tool_ctx -> shard ),
+                                          tool_ctx -> accession_short,
+                                          tool_ctx -> output_filename,
+                                          tool_ctx -> shard_dir, sizeof tool_ctx -> shard_dir,
+                                          filename, sizeof filename ); /* shard.c */
+    if ( 0 == rc ) {
+        string_copy_measure( tool_ctx -> dflt_output, sizeof tool_ctx -> dflt_output, filename );
+        tool_ctx -> output_filename = tool_ctx -> dflt_output;
+        if ( !ft_dir_exists( tool_ctx -> dir, "%s", tool_ctx -> shard_dir ) ) {
+            rc = ft_create_this_dir_2( tool_ctx -> dir, tool_ctx -> shard_dir, true ); /* file_tools.c */
+        } else if ( !tool_ctx -> force &&
+                    ft_file_exists( tool_ctx -> dir, "%s/%s", tool_ctx -> shard_dir, SHARD_MANIFEST ) ) {
+            rc = RC( rcExe, rcFile, rcPacking, rcName, rcExists );
+            ErrMsg( "shard '%s' already exists -> %R", tool_ctx -> shard_dir, rc );
+        }
+    }
+    return rc;
+}
+
+/* restrict the SEQ-table to the rows of the shard: everything downstream only sees these rows */
+static rc_t tctx_apply_shard( tool_ctx_t * tool_ctx ) {
+    rc_t rc = tctx_check_shard_mode( tool_ctx ); /* above */
+    if ( 0 == rc ) {
+        insp_seq_data_t * seq = &( tool_ctx -> insp_output . seq ); /* inspector.h */
+        rc = shard_apply( &( tool_ctx -> shard ), seq -> first_row, seq -> row_count ); /* shard.c */
+        if ( 0 == rc ) {
+            /* the estimation was made for the whole table */
+            if ( seq -> row_count > 0 ) {
+                tool_ctx -> estimated_output_size =
+                    ( size_t )( ( ( double )tool_ctx -> estimated_output_size * tool_ctx -> shard . row_count ) /
+                                seq -> row_count );
+            }
+            seq -> first_row = tool_ctx -> shard . first_row;
+            seq -> row_count = tool_ctx -> shard . row_count;
+        }
+        if ( 0 == rc && !tool_ctx -> use_stdout && cmt_only != tool_ctx -> check_mode ) {
+            rc = tctx_make_shard_output_filename( tool_ctx ); /* above */
+        }
+    }
+    return rc;
+}
+
+/* only a cSRA with these formats builds a lookup-table ( see main_process_csra() ) */
+static bool tctx_needs_lookup( const tool_ctx_t * tool_ctx ) {
+    if ( acc_csra != tool_ctx -> insp_output . acc_type ) { return false; }
+    switch ( tool_ctx -> fmt ) {
+        case ft_fasta_us_split_spot :
+        case ft_fasta_concat :
+        case ft_fasta_ref_tbl :
+        case ft_ref_report : return false;
+        default : return true;
+    }
+}
+
+static rc_t tctx_auto_tune( tool_ctx_t * tool_ctx ) {
+    rc_t rc;
+    at_input_t input; /* auto_tune.h */
+    at_plan_t plan; /* auto_tune.h */
+    const insp_output_t * insp = &( tool_ctx -> insp_output );
+
+    memset( &input, 0, sizeof input );
+    input . insp = insp;
+    input . fmt = tool_ctx -> fmt;
+    input . given = tool_ctx -> at_given;
+    if ( ahlp_get_env_u32( "DLFT_THREAD_COUNT", 0 ) > 0 ) {
+        input . given . num_threads = true; /* the environment overrides the commandline */
+    }
+    input . total_ram = tool_ctx -> total_ram;
+    input . avail_ram = at_available_ram(); /* auto_tune.c */
+    input . cores = at_num_cores(); /* auto_tune.c */
+    input . tmp_free = tool_ctx_get_temp_file_limit( tool_ctx ); /* above */
+    input . estimated_output_size = tool_ctx -> estimated_output_size;
+    input . use_stdout = tool_ctx -> use_stdout;
+    input . row_limit = ( tool_ctx -> row_limit > 0 );
+    if ( tctx_needs_lookup( tool_ctx ) ) {
+        input . lookup_estimate = memlkp_estimate( insp -> seq . first_row + insp -> seq . row_count,
+                                                   insp -> align . row_count,
+                                                   insp -> align . total_base_count,
+                                                   tool_ctx -> num_threads ); /* mem_lookup.c */
+    }
+
+    memset( &plan, 0, sizeof plan );
+    plan . num_threads = tool_ctx -> num_threads;
+    plan . mem_limit = tool_ctx -> mem_limit;
+    plan . mem_lookup_limit = tool_ctx -> mem_lookup_limit;
+    plan . buf_size = tool_ctx -> buf_size;
+    plan . cursor_cache = tool_ctx -> cursor_cache;
+    plan . use_mem_lookup = tool_ctx -> use_mem_lookup;
+    plan . direct_write = tool_ctx -> direct_write;
+    plan . spill_io = tool_ctx -> spill_io;
+
+    rc = at_make_plan( &input, &plan ); /* auto_tune.c */
+    if ( 0 == rc ) {
+        tool_ctx -> num_threads = plan . num_threads;
+        tool_ctx -> mem_limit = plan . mem_limit;
+        tool_ctx -> mem_lookup_limit = plan . mem_lookup_limit;
+        tool_ctx -> buf_size = plan . buf_size;
+        tool_ctx -> cursor_cache = plan . cursor_cache;
+        tool_ctx -> use_mem_lookup = plan . use_mem_lookup;
+        tool_ctx -> direct_write = plan . direct_write;
+        tool_ctx -> spill_io = plan . spill_io;
+        rc = at_print_plan( &input, &plan ); /* auto_tune.c */
+    }
+    return rc;
+}
+
 /* taken form libs/kapp/main-priv.h */
 rc_t KAppGetTotalRam ( uint64_t * totalRam );
 
@@ -804,12 +978,22 @@ rc_t tctx_populate_and_call_inspector( tool_ctx_t * tool_ctx ) {
         tool_ctx -> estimated_output_size = insp_estimate_output_size( &iei );
     }
 
+    /* '--shard' or '--rows' : from here on the SEQ-table has only the rows of the shard */
+    if ( 0 == rc && tool_ctx -> shard . requested ) {
+        rc = tctx_apply_shard( tool_ctx );
+    }
+
     /* determine if output and temp. path are on the same file-systme ( work is in helper-function ) */
     if ( 0 == rc ) {
         tool_ctx -> out_and_tmp_on_same_fs = hlp_paths_on_same_filesystem(
             tool_ctx -> output_filename, get_temp_dir( tool_ctx -> temp_dir ) );
     }
 
+    /* --auto-tune : now everything is known about the accession and the machine */
+    if ( 0 == rc && tool_ctx -> auto_tune ) {
+        rc = tctx_auto_tune( tool_ctx );
+    }
+
     /* print all the values gathered here, if requested */
     if ( 0 == rc && tool_ctx -> show_details ) {
         rc = tctx_print( tool_ctx );
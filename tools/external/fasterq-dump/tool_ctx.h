@@ -54,6 +54,18 @@ extern "C" {
 #ifndef _h_cmn_iter_
 #include "cmn_iter.h"
 #endif
+
+#ifndef _h_shard_
+#include "shard.h"
+#endif
+
+#ifndef _h_spill_io_
+#include "spill_io.h"
+#endif
+
+#ifndef _h_auto_tune_
+#include "auto_tune.h"
+#endif
     
 #define DFLT_PATH_LEN 4096
 
@@ -69,6 +81,7 @@ typedef struct tool_ctx_t {
     const char * requested_seq_tbl_name;
     const char * seq_defline;
     const char * qual_defline;
+    const char * stats_json;        /* --stats-json, NULL if no report is requested */
 
     VNamelist * ref_name_filter;
 
@@ -77,10 +90,12 @@ typedef struct tool_ctx_t {
     char lookup_filename[ DFLT_PATH_LEN ];
     char index_filename[ DFLT_PATH_LEN ];
     char dflt_output[ DFLT_PATH_LEN ];
+    char shard_dir[ DFLT_PATH_LEN ];
 
     struct CleanupTask_t * cleanup_task;
 
     size_t cursor_cache, buf_size, mem_limit;
+    size_t mem_lookup_limit;        /* --mem-lookup: the lookup in memory, mem_limit is per thread */
     size_t estimated_output_size;
     size_t disk_limit_out_cmdl;
     size_t disk_limit_tmp_cmdl;
@@ -89,11 +104,16 @@ typedef struct tool_ctx_t {
 
     uint32_t num_threads;
     uint32_t stop_after_step;
+    uint32_t stats_interval;        /* --stats-interval, seconds between progress-lines */
     uint64_t total_ram;
     uint64_t row_limit;
 
     format_t fmt; /* helper.h */
     check_mode_t check_mode; /* helper.h */
+    compress_t compress; /* helper.h */
+    shard_t shard; /* shard.h */
+    spill_io_mode_t spill_io; /* spill_io.h */
+    at_given_t at_given; /* auto_tune.h, what --auto-tune must not change */
 
     bool force, show_progress, show_details, append, use_stdout, split_file;
     bool only_unaligned, only_aligned;
@@ -102,6 +122,9 @@ typedef struct tool_ctx_t {
     bool only_external_refs;
     bool use_name;
     bool keep_tmp_files;
+    bool use_mem_lookup;
+    bool direct_write;
+    bool auto_tune;
 
     join_options_t join_options; /* helper.h */
 
@@ -214,87 +214,6 @@ static vfmt_entry_t * vfmt_clone_entry( const vfmt_entry_t * src ) {
     return res;
 }
 
-static void vfmt_copy_String_to_buffer( SBuffer_t *buffer, const String * src ) {
-    if ( NULL != src && NULL != buffer ) {
-        uint32_t i = 0;
-        String * dst = &( buffer -> S );
-        char * dst_addr = ( char * )( dst -> addr );
-        while ( i < src -> len && dst -> len < buffer -> buffer_size ) {
-            dst_addr [ dst -> len ] = src -> addr[ i++ ];
-            dst -> len += 1;
-        }
-    }
-}
-
-static void vfmt_copy_int_to_buffer( SBuffer_t *buffer, uint64_t value ) {
-    char temp[ 21 ];
-    size_t temp_written;
-    rc_t rc = string_printf ( temp, sizeof temp, &temp_written, "%lu", value );
-    if ( 0 == rc ) {
-        String S;
-        StringInitCString( &S, temp );
-        vfmt_copy_String_to_buffer( buffer, &S );
-    }
-}
-
-static void vfmt_copy_int_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t *buffer,
-                                           const uint64_t * args, size_t args_len ) {
-    if ( NULL != args && self -> idx < args_len ) {
-        vfmt_copy_int_to_buffer( buffer, args[ self -> idx ] );
-    }
-}
-
-/*we need both: str-args AND int-args, because of the alternative idx-usage */
-static void vfmt_copy_str_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t *buffer,
-                                         const String ** str_args, size_t str_args_len,
-                                         const uint64_t * int_args, size_t int_args_len ) {
-    if ( NULL != str_args && self -> idx < str_args_len ) {
-        const String * src = str_args[ self -> idx ];
-        if ( NULL != src && NULL != src -> addr ) {
-            /* we have a string to use */
-            if ( self -> idx2 == 0xFF ) {
-                /* there is no alternative -> print the string even if len == 0 */
-                vfmt_copy_String_to_buffer( buffer, src );
-            } else {
-                if ( src -> len > 0 ) {
-                    /* there is an alternative, but we have a valid string to print */
-                    vfmt_copy_String_to_buffer( buffer, src );
-                } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-                    /* there is an alternative - and we have an empty string -  */
-                    vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-                }
-            }
-        } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-            /* the string-source is NULL, and we have an alternative to use */
-            vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-        }
-    } else if ( NULL != int_args && self -> idx2 < int_args_len ) {
-        /* there is not even a array of strings, and we have an alternative to use */
-        vfmt_copy_int_to_buffer( buffer, int_args[ self -> idx2 ] );
-    }
-}
-
-static void vfmt_copy_entry_to_buffer( const vfmt_entry_t * self, SBuffer_t * dst,
-                               const String ** str_args, size_t str_args_len,
-                               const uint64_t * int_args, size_t int_args_len ) {
-    if ( NULL != self && NULL != dst ) {
-        switch ( self -> type ) {
-            /* we enter a string literal */
-            case vft_literal : vfmt_copy_String_to_buffer( dst, self -> literal );
-            break;
-            
-            /* we enter a string argument ( supply the int-vector too, because of the alternative! ) */
-            case vft_str    : vfmt_copy_str_entry_to_buffer( self, dst,
-                                                            str_args, str_args_len,
-                                                            int_args, int_args_len );
-            break;
-            
-            /* we enter a int argument */
-            case vft_int    : vfmt_copy_int_entry_to_buffer( self, dst, int_args, int_args_len ); break;
-        }
-    }
-}
-                               
 /* releases an element, data-pointer to match VectorWhack-callback */
 static void vfmt_destroy_entry( void * self, void * data ) {
     if ( NULL != self ) {
@@ -305,13 +224,83 @@ static void vfmt_destroy_entry( void * self, void * data ) {
 }
 
 /* ============================================================================================================= */
+/* the elements compiled into a flat list: no Vector, no pointers to chase while printing */
+typedef struct vfmt_op_t {
+    vfmt_type_t type;
+    uint8_t idx;            /* which str/int-arg to use here */
+    uint8_t idx2;           /* the alternative idx, for vft_str and client gives a NULL */
+    uint32_t lit_ofs;       /* for vft_literal: where the literal starts in vfmt_t.literals */
+    uint32_t lit_len;
+} vfmt_op_t;
+
 typedef struct vfmt_t {
     Vector elements;        /* the elements are pointers to var_fmt_entry_t - structs */
-    size_t fixed_len;       /* sum of all literal elements + sum of dflt-len of int-elements */
+    size_t fixed_len;       /* sum of all literal elements + sum of max-len of int-elements */
     SBuffer_t buffer;       /* internal buffer to print into */
+    vfmt_op_t * ops;        /* created by vfmt_compile() from the elements */
+    uint32_t num_ops;
+    char * literals;        /* all literals concatenated, adjacent ones merged into one op */
 } vfmt_t;
 /* ============================================================================================================= */
 
+static void vfmt_release_ops( vfmt_t * self ) {
+    if ( NULL != self -> ops ) { free( ( void * ) self -> ops ); }
+    if ( NULL != self -> literals ) { free( ( void * ) self -> literals ); }
+    self -> ops = NULL;
+    self -> literals = NULL;
+    self -> num_ops = 0;
+}
+
+/* translate the elements into the flat op-list, calculate the fixed-len */
+static void vfmt_compile( vfmt_t * self ) {
+    const Vector * v = &( self -> elements );
+    uint32_t i, l = VectorLength( v );
+    size_t lit_total = 0;
+
+    vfmt_release_ops( self );
+    self -> fixed_len = 0;
+    for ( i = VectorStart( v ); i < l; ++i ) {
+        const vfmt_entry_t * entry = VectorGet( v, i );
+        if ( NULL != entry && vft_literal == entry -> type ) { lit_total += entry -> literal -> len; }
+    }
+    self -> ops = calloc( l + 1, sizeof *( self -> ops ) );
+    self -> literals = malloc( lit_total + 1 );
+    if ( NULL == self -> ops || NULL == self -> literals ) {
+        vfmt_release_ops( self );
+        return;
+    }
+    lit_total = 0;
+    for ( i = VectorStart( v ); i < l; ++i ) {
+        const vfmt_entry_t * entry = VectorGet( v, i );
+        if ( NULL != entry ) {
+            vfmt_op_t * prev = ( self -> num_ops > 0 ) ? &( self -> ops[ self -> num_ops - 1 ] ) : NULL;
+            if ( vft_literal == entry -> type ) {
+                uint32_t len = entry -> literal -> len;
+                memcpy( self -> literals + lit_total, entry -> literal -> addr, len );
+                if ( NULL != prev && vft_literal == prev -> type ) {
+                    prev -> lit_len += len;
+                } else {
+                    vfmt_op_t * op = &( self -> ops[ self -> num_ops++ ] );
+                    op -> type = vft_literal;
+                    op -> lit_ofs = ( uint32_t )lit_total;
+                    op -> lit_len = len;
+                }
+                lit_total += len;
+                self -> fixed_len += len;
+            } else {
+                vfmt_op_t * op = &( self -> ops[ self -> num_ops++ ] );
+                op -> type = entry -> type;
+                op -> idx = entry -> idx;
+                op -> idx2 = entry -> idx2;
+                /* the length of max_uint64_t as string, for ints and for strings with an int-alternative */
+                if ( vft_int == entry -> type || 0xFF != entry -> idx2 ) {
+                    self -> fixed_len += HLP_MAX_DEC_DIGITS;
+                }
+            }
+        }
+    }
+}
+
 static void vfmt_append_entry( vfmt_t * self, vfmt_entry_t * entry ) {
     if ( NULL == self || NULL == entry ) { return; }
     rc_t rc = VectorAppend ( &( self -> elements ), NULL, entry );
@@ -340,20 +329,6 @@ static bool vfmt_find_desc_and_add_if_found( vfmt_t * self,
     return ( NULL != found );
 }
 
-static size_t vfmt_calc_fixed_len( Vector * v ) {
-    size_t res = 0;
-    uint32_t i, l = VectorLength( v );
-    for ( i = VectorStart( v ); i < l; ++i ) {
-        const vfmt_entry_t * entry = VectorGet ( v, i );
-        switch( entry -> type ) {
-            case vft_literal: res += entry -> literal -> len; break;
-            case vft_int    : res += 20; break;     /* the length of max_uint64_t as string */
-            case vft_str    : break;    /* we do not know yet... */
-        }
-    }
-    return res;
-}
-
 static void vfmt_append( struct vfmt_t * self,  const String * fmt,
                          const struct vfmt_desc_list_t * vars ) {
     if ( NULL != self && NULL != fmt ) {
@@ -374,8 +349,8 @@ static void vfmt_append( struct vfmt_t * self,  const String * fmt,
         if ( !vfmt_find_desc_and_add_if_found( self, &temp, vars ) ) {
             vfmt_append_entry( self, vfmt_create_entry_literal( temp . addr, temp . len ) );
         }
-        /* calculate new fixed-len, and adjust print-buffer */
-        self -> fixed_len = vfmt_calc_fixed_len( &( self -> elements ) );
+        /* compile into the op-list, calculate new fixed-len, and adjust print-buffer */
+        vfmt_compile( self );
         increase_SBuffer_to( &( self -> buffer ), ( self -> fixed_len * 4 ) );
     }
 }
@@ -420,6 +395,7 @@ static struct vfmt_t * vfmt_create_from_str( const char * fmt, const struct vfmt
 void vfmt_release( struct vfmt_t * self ) {
     if ( NULL != self ) {
         VectorWhack ( &( self -> elements ), vfmt_destroy_entry, NULL );
+        vfmt_release_ops( self );
         release_SBuffer( &( self -> buffer ) );
         free( ( void * ) self );
     }
@@ -429,21 +405,14 @@ static size_t vfmt_calc_buffer_size( const struct vfmt_t * self,
                     const String ** str_args, size_t str_args_len ) {
     size_t res = 0;
     if ( NULL != self ) {
-        const Vector * v = &( self -> elements );
-        uint32_t i, l = VectorLength( v );
+        uint32_t i;
         res = self -> fixed_len;
-        for ( i = VectorStart( v ); i < l; ++i ) {
-            const vfmt_entry_t * entry = VectorGet( v, i );
-            if ( NULL != entry ) {
-                if ( vft_str == entry -> type ) {
-                    if ( entry -> idx < str_args_len ) {
-                        const String * S = str_args[ entry -> idx ];
-                        if ( NULL != S ) {
-                            if ( NULL != S -> addr ) {
-                                res += S -> len;
-                            }
-                        }
-                    }
+        for ( i = 0; i < self -> num_ops; ++i ) {
+            const vfmt_op_t * op = &( self -> ops[ i ] );
+            if ( vft_str == op -> type && op -> idx < str_args_len ) {
+                const String * S = str_args[ op -> idx ];
+                if ( NULL != S && NULL != S -> addr ) {
+                    res += S -> len;
                 }
             }
         }
@@ -451,12 +420,51 @@ static size_t vfmt_calc_buffer_size( const struct vfmt_t * self,
     return res;
 }
 
+static char * vfmt_emit_String( char * dst, const String * src ) {
+    memcpy( dst, src -> addr, src -> len );
+    return dst + src -> len;
+}
+
+/* the buffer is big enough: vfmt_calc_buffer_size() accounts for every op */
+static char * vfmt_emit_op( const struct vfmt_t * self, const vfmt_op_t * op, char * dst,
+                            const String ** str_args, size_t str_args_len,
+                            const uint64_t * int_args, size_t int_args_len ) {
+    switch ( op -> type ) {
+        /* we enter a string literal */
+        case vft_literal : memcpy( dst, self -> literals + op -> lit_ofs, op -> lit_len );
+                           dst += op -> lit_len;
+                           break;
+
+        /* we enter a int argument */
+        case vft_int    : if ( NULL != int_args && op -> idx < int_args_len ) {
+                                dst += hlp_u64_to_dec( dst, int_args[ op -> idx ] ); /* helper.c */
+                          }
+                          break;
+
+        /* we enter a string argument ( or the int-alternative ) */
+        case vft_str    : {
+                const String * src = ( NULL != str_args && op -> idx < str_args_len ) ? str_args[ op -> idx ] : NULL;
+                bool has_src = ( NULL != src && NULL != src -> addr );
+                if ( has_src && ( 0xFF == op -> idx2 || src -> len > 0 ) ) {
+                    /* no alternative -> print the string even if len == 0,
+                       with an alternative only a non-empty string */
+                    dst = vfmt_emit_String( dst, src );
+                } else if ( 0xFF != op -> idx2 && NULL != int_args && op -> idx2 < int_args_len ) {
+                    /* the string is NULL or empty, and we have an alternative to use */
+                    dst += hlp_u64_to_dec( dst, int_args[ op -> idx2 ] ); /* helper.c */
+                }
+            }
+            break;
+    }
+    return dst;
+}
+
 /* apply the var-fmt-struct to the given arguments, write result to buffer */
 SBuffer_t * vfmt_write_to_buffer( struct vfmt_t * self,
                     const String ** str_args, size_t str_args_len,
                     const uint64_t * int_args, size_t int_args_len ) {
     SBuffer_t * res = NULL;
-    if ( NULL != self )
+    if ( NULL != self && NULL != self -> ops )
     {
         size_t needed = vfmt_calc_buffer_size( self, str_args, str_args_len ); /* above */
         if ( needed > 0 )
@@ -464,17 +472,14 @@ SBuffer_t * vfmt_write_to_buffer( struct vfmt_t * self,
             rc_t rc = increase_SBuffer_to( &( self -> buffer ), needed ); /* does nothing if not neccessary */
             if ( 0 == rc )
             {
-                SBuffer_t * dst = &( self -> buffer );
-                self -> buffer . S . len = 0;
-                self -> buffer . S . size = 0;
-
-                const Vector * v = &( self -> elements );
-                uint32_t i, l = VectorLength( v );
-                for ( i = VectorStart( v ); i < l; ++i ) {
-                    const vfmt_entry_t * entry = VectorGet( v, i );
-                    vfmt_copy_entry_to_buffer( entry, dst,
-                                               str_args, str_args_len, int_args, int_args_len );
+                char * start = ( char * )self -> buffer . S . addr;
+                char * dst = start;
+                uint32_t i;
+                for ( i = 0; i < self -> num_ops; ++i ) {
+                    dst = vfmt_emit_op( self, &( self -> ops[ i ] ), dst,
+                                        str_args, str_args_len, int_args, int_args_len ); /* above */
                 }
+                self -> buffer . S . len = ( uint32_t )( dst - start );
                 self -> buffer . S . size = self -> buffer . S . len;
                 res = &( self -> buffer );
             }
@@ -54,6 +54,9 @@
 #include <klib/sort.h> /* ksort */
 #include <klib/text.h>
 
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
 #include <sra/sraschema.h> /* VDBManagerMakeSRASchema */
 
 #include <vdb/blob.h> /* VBlobCellData */
@@ -235,21 +238,28 @@ typedef struct SraStats {
     uint64_t total_cmp_len; /* CMP_READ : compressed */
     BAM_HEADER_RG BAM_HEADER;
 } SraStats;
+typedef struct UInt128 { /* sums of squares of READ_LEN values */
+    uint64_t hi;
+    uint64_t lo;
+} UInt128;
 typedef struct Statistics {  /* READ_LEN columnn */
     /* average READ_LEN value */
     /* READ_LEN standard deviation. Is calculated just when requested. */
-    /* running (continuous) standard deviation */
+    /* the sums are exact: they do not depend on the order of the values,
+       average and standard deviation are derived from them when printed */
 
     int64_t n; /* number of values */
-    double a; /* the mean value */
-    double q; /* Qi = Q[i-1] + (Xi - A[i-1])(Xi - Ai) */
+    uint64_t sum; /* sum of the values */
+    UInt128 sum_sq; /* sum of the squares of the values */
 
     bool variable; /* variable or fixed value */
-    double prev_val;
+    uint32_t prev_val;
 } Statistics;
 typedef struct Statistics2 {
-    int n;
-    double average;
+    /* an independent check of <Statistics>: the squared differences from the
+       average of the first pass are summed up in a pass of their own */
+    uint64_t n;
+    double average; /* from the sums of the first pass */
     double diff_sq_sum;
 } Statistics2;
 typedef enum {
@@ -324,8 +334,83 @@ typedef struct srastat_parms {
     bool xml; /* output format (txt or xml) */
 
     int64_t  start, stop;
+    uint32_t threads; /* number of workers of the full table scan */
 } srastat_parms;
 
+static void UInt128Add(UInt128* self, const UInt128* other) {
+    assert(self && other);
+
+    self->lo += other->lo;
+    self->hi += other->hi + (self->lo < other->lo ? 1 : 0);
+}
+
+static UInt128 UInt128Mul(uint64_t a, uint64_t b) {
+    uint64_t ll = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t lh = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hl = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    UInt128 res;
+
+    res.lo = (mid << 32) | (ll & 0xFFFFFFFF);
+    res.hi = (a >> 32) * (b >> 32) + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+    return res;
+}
+
+/* self / d: bit by bit, it is done once per read when printed */
+static UInt128 UInt128Div(const UInt128* self, uint64_t d, uint64_t* rem) {
+    UInt128 res = { 0, 0 };
+    uint64_t r = 0;
+    int i = 0;
+
+    assert(self && d > 0 && rem);
+
+    for (i = 127; i >= 0; --i) {
+        uint64_t bit = i >= 64 ? (self->hi >> (i - 64)) & 1 : (self->lo >> i) & 1;
+        bool carry = (r >> 63) != 0;
+        r = (r << 1) | bit;
+        if (carry || r >= d) {
+            r -= d;
+            if (i >= 64) {
+                res.hi |= (uint64_t)1 << (i - 64);
+            }
+            else {
+                res.lo |= (uint64_t)1 << i;
+            }
+        }
+    }
+
+    *rem = r;
+    return res;
+}
+
+/* sum of the squared differences from the average of n values:
+   sum_sq - sum * sum / n, rounded just once at the end */
+static double SquaredDiffSum(uint64_t n, uint64_t sum, const UInt128* sum_sq) {
+    UInt128 sq;
+    UInt128 q;
+    uint64_t rem = 0;
+
+    assert(sum_sq);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    sq = UInt128Mul(sum, sum);
+    q = UInt128Div(&sq, n, &rem);
+
+    /* sum_sq >= sum * sum / n >= q */
+    if (q.hi > sum_sq->hi || (q.hi == sum_sq->hi && q.lo >= sum_sq->lo)) {
+        return 0;
+    }
+
+    q.hi = sum_sq->hi - q.hi - (sum_sq->lo < q.lo ? 1 : 0);
+    q.lo = sum_sq->lo - q.lo;
+
+    return ldexp((double)q.hi, 64) + (double)q.lo - (double)rem / n;
+}
+
 static
 void Statistics2Init(Statistics2* self, double sum, int64_t  count)
 {
@@ -336,7 +421,7 @@ void Statistics2Init(Statistics2* self, double sum, int64_t  count)
     }
 }
 
-static void Statistics2Add(Statistics2* self, double value) {
+static void Statistics2Add(Statistics2* self, uint32_t value) {
     double diff = 0;
 
     assert(self);
@@ -347,6 +432,34 @@ static void Statistics2Add(Statistics2* self, double value) {
     self->diff_sq_sum += diff * diff;
 }
 
+/* the workers of the --test pass collect the differences from the same average:
+   their sums just add up */
+static void Statistics2Merge(Statistics2* self, const Statistics2* other) {
+    assert(self && other);
+    assert(self->n == 0 || other->n == 0 || self->average == other->average);
+
+    if (other->n == 0) {
+        return;
+    }
+    if (self->n == 0) {
+        *self = *other;
+        return;
+    }
+
+    self->n += other->n;
+    self->diff_sq_sum += other->diff_sq_sum;
+}
+
+static double Statistics2Stdev(const Statistics2* self) {
+    assert(self);
+
+    if (self->n == 0) {
+        return 0;
+    }
+
+    return sqrt(self->diff_sq_sum / self->n);
+}
+
 static void Statistics2Print(const Statistics2* selfs,
     uint32_t nreads, const char* indent,
 
@@ -367,12 +480,10 @@ static void Statistics2Print(const Statistics2* selfs,
         double dev = 0;
         const Statistics2* stats = selfs + i;
         double avr = stats->average;
-        if (stats->n > 0) {
-            dev = sqrt(stats->diff_sq_sum / stats->n);
-        }
+        dev = Statistics2Stdev(stats);
 
         OUTMSG(("%s  "
-            "<Read index=\"%d\" count=\"%ld\" average=\"%f\" stdev=\"%f\"/>\n",
+            "<Read index=\"%d\" count=\"%lu\" average=\"%f\" stdev=\"%f\"/>\n",
             indent, i, stats->n, avr, dev));
     }
 
@@ -769,6 +880,23 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
     return 0;
 }
 
+/* adds the bases counted by another worker */
+static void BasesMerge(Bases *self, const Bases *other) {
+    int i = 0;
+
+    assert(self && other);
+
+    /* BasesAdd() releases the cursors when it fails:
+       then the statistics are not printed, as in a scan on one thread */
+    if (other->cursSEQUENCE == NULL) {
+        BasesRelease(self);
+    }
+
+    for (i = 0; i < 5; ++i) {
+        self->cnt[i] += other->cnt[i];
+    }
+}
+
 static rc_t BasesPrint(const Bases *self,
     uint64_t base_count, const char* indent)
 {
@@ -876,15 +1004,11 @@ static rc_t SraStatsTotalFree(SraStatsTotal* self) {
     return 0;
 }
 
-static void StatisticsAdd(Statistics* self, double value) {
-    double a_1 = 0;
-
-    /* http://en.wikipedia.org/wiki/Stdev#Rapid_calculation_methods */
+static void StatisticsAdd(Statistics* self, uint32_t value) {
+    UInt128 sq;
 
     assert(self);
 
-    a_1 = self->a;
-
     if (self->n++ == 0) {
         self->prev_val = value;
     }
@@ -892,14 +1016,41 @@ static void StatisticsAdd(Statistics* self, double value) {
         self->variable = true;
     }
 
-    self->a += (value - a_1) / self->n;
-    self->q += ((double)value - a_1) * ((double)value - self->a);
+    self->sum += value;
+    sq = UInt128Mul(value, value);
+    UInt128Add(&self->sum_sq, &sq);
+}
+
+/* combines the statistics of two disjoint sets of spots:
+   the sums are exact, the result does not depend on how the spots were split */
+static void StatisticsMerge(Statistics* self, const Statistics* other) {
+    assert(self && other);
+
+    if (other->n == 0) {
+        return;
+    }
+    if (self->n == 0) {
+        *self = *other;
+        return;
+    }
+
+    if (other->variable || self->prev_val != other->prev_val) {
+        self->variable = true;
+    }
+
+    self->n += other->n;
+    self->sum += other->sum;
+    UInt128Add(&self->sum_sq, &other->sum_sq);
 }
 
 static double StatisticsAverage(const Statistics* self) {
     assert(self);
 
-    return self->a;
+    if (self->n == 0) {
+        return 0;
+    }
+
+    return (double)self->sum / self->n;
 }
 
 static double StatisticsStdev(const Statistics* self) {
@@ -909,7 +1060,7 @@ static double StatisticsStdev(const Statistics* self) {
         return 0;
     }
 
-    return sqrt(self->q / self->n);
+    return sqrt(SquaredDiffSum(self->n, self->sum, &self->sum_sq) / self->n);
 }
 
 static
@@ -956,6 +1107,39 @@ void SraStatsTotalAdd2(SraStatsTotal* self, uint32_t* values) {
     }
 }
 
+/* adds the counts and statistics of another worker:
+   the bases are merged separately */
+static void SraStatsTotalMerge(SraStatsTotal* self, const SraStatsTotal* other)
+{
+    uint32_t i = 0;
+
+    assert(self && other);
+
+    self->spot_count          += other->spot_count;
+    self->spot_count_mates    += other->spot_count_mates;
+    self->BIO_BASE_COUNT      += other->BIO_BASE_COUNT;
+    self->bio_len_mates       += other->bio_len_mates;
+    self->BASE_COUNT          += other->BASE_COUNT;
+    self->bad_spot_count      += other->bad_spot_count;
+    self->bad_bio_len         += other->bad_bio_len;
+    self->filtered_spot_count += other->filtered_spot_count;
+    self->filtered_bio_len    += other->filtered_bio_len;
+    self->total_cmp_len       += other->total_cmp_len;
+
+    if (self->nreads != other->nreads || other->variable_nreads) {
+        self->variable_nreads = true;
+    }
+
+    if (self->variable_nreads) {
+        return;
+    }
+
+    for (i = 0; i < self->nreads; ++i) {
+        StatisticsMerge(self->stats + i, other->stats + i);
+        Statistics2Merge(self->stats2 + i, other->stats2 + i);
+    }
+}
+
 static double s_Round(double X) { return floor(X + 0.5); }
 
 static
@@ -1006,7 +1190,7 @@ static rc_t StatisticsDiff(const Statistics* ss,
         const Statistics2* s2 = ss2 + i;
 
         double d  = StatisticsStdev(s);
-        double d2 = sqrt(s2->diff_sq_sum / s2->n);
+        double d2 = Statistics2Stdev(s2);
 
         double diff = d - d2;
         if (diff < 0) {
@@ -1019,7 +1203,7 @@ static rc_t StatisticsDiff(const Statistics* ss,
             DISP_RC(rc, "While comparing calculated standard deviations");
         }
 
-        if (s->n != s2->n) {
+        if ((uint64_t)s->n != s2->n) {
             rc = RC(rcExe, rcNumeral, rcComparing, rcData, rcInvalid);
             DISP_RC(rc, "While comparing read statistics counts");
         }
@@ -3695,798 +3879,1157 @@ int64_t CC srastats_sort ( const BSTNode *item, const BSTNode *n )
     return srastats_cmp(ss->spot_group,n);
 }
 
-static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
-    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+/* the full table scan can be split between several workers:
+   every one of them scans its own range of rows with its own cursors
+   and the results are merged in the order of the ranges */
+typedef struct SraStatsScanShared {
+    const srastat_parms* pb;
+
+    /* every spot is compared to the READ_LEN of the first one */
+    int nreads;
+    const uint32_t * dREAD_LEN;
+
+    const KLoadProgressbar *pr;
+    KLock *lock; /* guards pr when there is more than one worker */
+} SraStatsScanShared;
+
+typedef struct SraStatsScan {
+    const SraStatsScanShared * shared;
+    rc_t ( * fn ) ( struct SraStatsScan * self ); /* stage to run */
+    KThread * thread;
+    rc_t rc;
+
+    const VCursor *curs;
+    uint32_t idxPRIMARY_ALIGNMENT_ID;
+    uint32_t idxRD_FILTER;
+    uint32_t idxREAD_LEN;
+    uint32_t idxREAD_TYPE;
+    uint32_t idxSPOT_GROUP;
+    bool useRD_FILTER; /* is cleared when RD_FILTER looks broken */
+
+    /* rows of this worker */
+    int64_t start, stop;
+    int64_t startALIGNMENT, stopALIGNMENT;
+    int64_t startSEQUENCE, stopSEQUENCE;
+
+    BSTree tr; /* SraStats by SPOT_GROUP */
+    SraStatsTotal total; /* total.bases_count is not used */
+    Bases *bases; /* bases_count of the caller for the first worker */
+    Bases own_bases;
+
+    bool hasSPOT_GROUP;
+    bool fixedNReads;
+    bool fixedReadLength;
+
+    /* the warnings about RD_FILTER are printed after the merge */
+    int bad_read_filter_nreads; /* RD_FILTER size was 1 for so many reads */
+    bool dropped_read_filter;
+    int dropped_read_filter_size;
+    int dropped_read_filter_nreads;
+
+    size_t max_nreads;
+    uint32_t * dREAD_LEN;
+    uint8_t * dREAD_TYPE;
+    uint8_t * dRD_FILTER;
+    size_t max_spot_group;
+    char * dSPOT_GROUP;
+    uint64_t * totalREAD_LEN; /* sum(READ_LEN[i]) */
+    uint64_t * nonZeroLenReads;
+
+    uint64_t progress; /* rows not reported to the progress bar yet */
+} SraStatsScan;
+
+typedef rc_t ( * SraStatsScanFn ) ( SraStatsScan * self );
+
+static void SraStatsScanReset(SraStatsScan* self) {
+    assert(self);
+
+    self->useRD_FILTER = self->idxRD_FILTER != 0;
+    self->hasSPOT_GROUP = false;
+    self->fixedNReads = true;
+    self->fixedReadLength = true;
+    self->bad_read_filter_nreads = 0;
+    self->dropped_read_filter = false;
+}
+
+static rc_t SraStatsScanInit(SraStatsScan* self,
+    const SraStatsScanShared* shared, const VTable *vtbl)
 {
     rc_t rc = 0;
 
-    const VCursor *curs = NULL;
-
     const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
     const char RD_FILTER [] = "RD_FILTER";
     const char READ_LEN  [] = "READ_LEN";
     const char READ_TYPE [] = "READ_TYPE";
     const char SPOT_GROUP[] = "SPOT_GROUP";
 
-    uint32_t idxPRIMARY_ALIGNMENT_ID = 0;
-    uint32_t idxRD_FILTER = 0;
-    uint32_t idxREAD_LEN = 0;
-    uint32_t idxREAD_TYPE = 0;
-    uint32_t idxSPOT_GROUP = 0;
-
-    int g_nreads = 0;
-    int64_t  n_spots = 0;
-    int64_t start = 0;
-    int64_t stop  = 0;
+    assert(self && shared && vtbl);
 
-    /* filled with dREAD_LEN[i] for (spotid == start);
-       used to check fixedReadLength */
-    uint64_t * g_totalREAD_LEN
-        = calloc ( MAX_NREADS, sizeof * g_totalREAD_LEN );
-    uint64_t * g_nonZeroLenReads
-        = calloc ( MAX_NREADS, sizeof * g_nonZeroLenReads );
-    uint32_t * g_dREAD_LEN = calloc ( MAX_NREADS, sizeof * g_dREAD_LEN );
-    if ( g_totalREAD_LEN == NULL || g_nonZeroLenReads == NULL ||
-         g_dREAD_LEN == NULL )
+    memset(self, 0, sizeof *self);
+    self->shared = shared;
+    BSTreeInit(&self->tr);
+    self->bases = &self->own_bases;
+
+    self->max_nreads = MAX_NREADS;
+    self->max_spot_group = 1000;
+    self->dREAD_LEN  = calloc ( MAX_NREADS, sizeof * self->dREAD_LEN  );
+    self->dREAD_TYPE = calloc ( MAX_NREADS, sizeof * self->dREAD_TYPE );
+    self->dRD_FILTER = calloc ( MAX_NREADS, sizeof * self->dRD_FILTER );
+    self->dSPOT_GROUP
+        = calloc ( self->max_spot_group, sizeof * self->dSPOT_GROUP );
+    self->totalREAD_LEN
+        = calloc ( MAX_NREADS, sizeof * self->totalREAD_LEN );
+    self->nonZeroLenReads
+        = calloc ( MAX_NREADS, sizeof * self->nonZeroLenReads );
+    if ( self->dREAD_LEN     == NULL || self->dREAD_TYPE      == NULL ||
+         self->dRD_FILTER    == NULL || self->dSPOT_GROUP     == NULL ||
+         self->totalREAD_LEN == NULL || self->nonZeroLenReads == NULL )
     {
         rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
         DBGMSG ( DBG_APP, DBG_COND_1,
             ( "Failed to allocate buffers for %zu READS\n", MAX_NREADS ) );
+        return rc;
     }
-    else
-        DBGMSG ( DBG_APP, DBG_COND_1,
-            ( "Allocated buffers for %zu READS\n", MAX_NREADS ) );
 
-    rc = VTableCreateCachedCursorRead(vtbl, &curs, DEFAULT_CURSOR_CAPACITY);
+    DBGMSG ( DBG_APP, DBG_COND_1,
+        ( "Allocated buffers for %zu READS\n", MAX_NREADS ) );
+    string_copy_measure ( self->dSPOT_GROUP, self->max_spot_group, "NULL" );
+
+    rc = VTableCreateCachedCursorRead(vtbl, &self->curs,
+                                      DEFAULT_CURSOR_CAPACITY);
     DISP_RC(rc, "Cannot VTableCreateCachedCursorRead");
 
     if (rc == 0) {
-        rc = VCursorPermitPostOpenAdd(curs);
+        rc = VCursorPermitPostOpenAdd(self->curs);
         DISP_RC(rc, "Cannot VCursorPermitPostOpenAdd");
     }
 
     if (rc == 0) {
-        rc = VCursorOpen(curs);
+        rc = VCursorOpen(self->curs);
         DISP_RC(rc, "Cannot VCursorOpen");
     }
 
-    assert(pb && vtbl && tr && total);
-
     if (rc == 0) {
         const char* name = READ_LEN;
-        rc = VCursorAddColumn(curs, &idxREAD_LEN, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_LEN, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
     if (rc == 0) {
         const char* name = READ_TYPE;
-        rc = VCursorAddColumn(curs, &idxREAD_TYPE, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_TYPE, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
-
     if (rc == 0) {
-        {
-            const char* name = SPOT_GROUP;
-            rc = VCursorAddColumn(curs, &idxSPOT_GROUP, "%s", name);
-            if (columnUndefined(rc)) {
-                idxSPOT_GROUP = 0;
-                rc = 0;
-            }
-            DISP_RC2(rc, name, "while calling VCursorAddColumn");
+        const char* name = SPOT_GROUP;
+        rc = VCursorAddColumn(self->curs, &self->idxSPOT_GROUP, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxSPOT_GROUP = 0;
+            rc = 0;
         }
-        if (rc == 0) {
-            if (rc == 0) {
-                const char* name = RD_FILTER;
-                rc = VCursorAddColumn(curs, &idxRD_FILTER, "%s", name);
-                if (columnUndefined(rc)) {
-                    idxRD_FILTER = 0;
-                    rc = 0;
-                }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
-            }
-/*          if (rc == 0) {
-                const char* name = CMP_READ;
-                rc = SRATableOpenColumnRead
-                    (tbl, &cCMP_READ, name, "INSDC:dna:text");
-                if (GetRCState(rc) == rcNotFound)
-                {   rc = 0; }
-                DISP_RC2(rc, name, "while calling SRATableOpenColumnRead");
-            } */
-            if (rc == 0) {
-                const char* name = PRIMARY_ALIGNMENT_ID;
-                rc = VCursorAddColumn(curs, &idxPRIMARY_ALIGNMENT_ID,
-                    "%s", name);
-                if (columnUndefined(rc)) {
-                    idxPRIMARY_ALIGNMENT_ID = 0;
-                    rc = 0;
-                }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
-            }
-            if (rc == 0) {
-                int64_t first = 0;
-                uint64_t count = 0;
-                int64_t spotid;
-                pb->hasSPOT_GROUP = 0;
-                rc = VCursorIdRange(curs, 0, &first, &count);
-                DISP_RC(rc, "VCursorIdRange() failed");
-                if (rc == 0) {
-                    rc = BasesInit(&total->bases_count, ctx, vtbl, pb);
-                }
-                if (rc == 0) {
-                    const KLoadProgressbar *pr = NULL;
-                    bool bad_read_filter = false;
-                    bool fixedNReads = true;
-                    bool fixedReadLength = true;
-
-                    uint32_t * dREAD_LEN
-                        = calloc ( MAX_NREADS, sizeof * dREAD_LEN );
-                    uint8_t * dREAD_TYPE
-                        = calloc ( MAX_NREADS, sizeof * dREAD_TYPE );
-                    uint8_t * dRD_FILTER
-                        = calloc ( MAX_NREADS, sizeof * dRD_FILTER );
-                    size_t MAX_SPOT_GROUP = 1000;
-                    char * dSPOT_GROUP
-                        = calloc ( MAX_SPOT_GROUP, sizeof * dSPOT_GROUP );
-                    if ( dREAD_LEN  == NULL || dREAD_TYPE  == NULL ||
-                         dRD_FILTER == NULL || dSPOT_GROUP == NULL )
-                    {
-                        rc = RC ( rcExe, rcStorage,
-                                  rcAllocating, rcMemory, rcExhausted );
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to allocate "
-                            "cursor buffers for READ_LEN %zu\n", MAX_NREADS ) );
-                    }
-                    else {
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Allocated cursor "
-                                "buffers for %zu READS\n", MAX_NREADS ) );
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Allocated "
-                                "buffer for SPOT_GROUP[%zu]\n",
-                                MAX_SPOT_GROUP ) );
-                        string_copy_measure ( dSPOT_GROUP, MAX_SPOT_GROUP,
-                                              "NULL" );
-                    }
-
-                    if (pb->start > 0) {
-                        start = pb->start;
-                        if (start < first) {
-                            start = first;
-                        }
-                    }
-                    else {
-                        start = first;
-                    }
-
-                    if (pb->stop > 0) {
-                        stop = pb->stop;
-                        if ( ( uint64_t ) stop > first + count) {
-                            stop = first + count;
-                        }
-                    }
-                    else {
-                        stop = first + count;
-                    }
-
-                    for (spotid = start; spotid < stop && rc == 0; ++spotid) {
-                        SraStats* ss;
-
-                        const void* base;
-                        bitsz_t boff, row_bits;
-                        int nreads;
-
-                        rc = Quitting();
-                        if (rc != 0) {
-                            LOGMSG(klogWarn, "Interrupted");
-                        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        const char* name = RD_FILTER;
+        rc = VCursorAddColumn(self->curs, &self->idxRD_FILTER, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxRD_FILTER = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        const char* name = PRIMARY_ALIGNMENT_ID;
+        rc = VCursorAddColumn(self->curs, &self->idxPRIMARY_ALIGNMENT_ID,
+            "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxPRIMARY_ALIGNMENT_ID = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
 
-                        if (rc == 0 && pb->progress && pr == NULL) {
-                            uint64_t b = total->bases_count.stopSEQUENCE + 1
-                                       - total->bases_count.startSEQUENCE;
-                            if ( total->bases_count.stopALIGNMENT > 0 )
-                                b +=  total->bases_count.stopALIGNMENT + 1
-                                    - total->bases_count.startALIGNMENT;
-                            rc = KLoadProgressbar_Make(&pr,
-                                                       stop + 1 - start + b);
-                            if (rc != 0) {
-                                DISP_RC(rc, "cannot initialize progress bar");
-                                rc = 0;
-                                pr = NULL;
-                            }
-                            else if (stop - start > 99) {
-                                KLoadProgressbar_Process(pr, 0, true);
-                            }
-                        }
+    SraStatsScanReset(self);
 
-                        if (rc == 0) {
-                            rc = VCursorColumnRead(curs, spotid,
-                                idxREAD_LEN, &base, &boff, &row_bits);
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "while calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            if (boff & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcOffset, rcInvalid);
-                            }
-                            else if (row_bits & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcSize, rcInvalid);
-                            }
-                            else if ( ( row_bits >> 3 )
-                                 > MAX_NREADS * sizeof * dREAD_LEN )
-                            {
-                                size_t oldMAX_NREADS = MAX_NREADS;
-                                MAX_NREADS =
-                                    ( row_bits >> 3 ) / sizeof * dREAD_LEN
-                                    + 1000;
-                                if ( rc == 0 ) {
-                                    uint32_t * tmp = realloc ( dREAD_LEN,
-                                        MAX_NREADS * sizeof * dREAD_LEN );
-                                    if ( tmp == NULL ) {
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    }
-                                    else
-                                        dREAD_LEN = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint8_t * tmp = realloc ( dREAD_TYPE,
-                                        MAX_NREADS * sizeof * dREAD_TYPE );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else
-                                        dREAD_TYPE = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint8_t * tmp = realloc ( dRD_FILTER,
-                                        MAX_NREADS * sizeof * dRD_FILTER );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else
-                                        dRD_FILTER = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_totalREAD_LEN,
-                                        MAX_NREADS * sizeof * g_totalREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_totalREAD_LEN = tmp;
-                                        memset (
-                                            g_totalREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_totalREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_totalREAD_LEN,
-                                        MAX_NREADS * sizeof * g_totalREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_totalREAD_LEN = tmp;
-                                        memset (
-                                            g_totalREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_totalREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_nonZeroLenReads,
-                                        MAX_NREADS * sizeof * g_nonZeroLenReads );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_nonZeroLenReads = tmp;
-                                        memset (
-                                            g_nonZeroLenReads + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_nonZeroLenReads
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint32_t * tmp = realloc ( g_dREAD_LEN,
-                                        MAX_NREADS * sizeof * g_dREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_dREAD_LEN = tmp;
-                                        memset (
-                                            g_dREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_dREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 )
-                                    DBGMSG ( DBG_APP, DBG_COND_1, (
-                                        "Reallocated buffers "
-                                        "for %zu READS\n", MAX_NREADS ) );
-                                else
-                                    DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to "
-                                        "reallocate buffers for %zu READS\n",
-                                        MAX_NREADS ) );
-                            }
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "after calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            int i, bio_len, bio_count, bad_cnt, filt_cnt;
-                            memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
-                                    ( size_t ) row_bits >> 3);
-                            nreads
-                                = (int) ((row_bits >> 3) / sizeof(*dREAD_LEN));
-                            if (spotid == start) {
-                                g_nreads = nreads;
-                                if (pb->statistics) {
-                                    rc = SraStatsTotalMakeStatistics
-                                        (total, g_nreads);
-                                }
-                            }
-                            else if (g_nreads != nreads) {
-                                fixedNReads = false;
-                            }
+    return rc;
+}
 
-                            if (rc == 0) {
-                                rc = VCursorColumnRead(curs, spotid,
-                                    idxREAD_TYPE, &base, &boff, &row_bits);
-                                DISP_RC_Read(rc, READ_TYPE, spotid,
-                                    "while calling VCursorColumnRead");
-                                if (rc == 0) {
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid);
-                                    }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    else if ((row_bits >> 3) >
-                                        MAX_NREADS * sizeof * dREAD_TYPE)
-                                    {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcBuffer, rcInsufficient);
-                                    }
-                                    else if ((row_bits >> 3) !=  nreads) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcData, rcIncorrect);
-                                    }
-                                    DISP_RC_Read(rc, READ_TYPE, spotid,
-                                        "after calling VCursorColumnRead");
-                                }
-                            }
-                            if (rc == 0) {
-                                memmove(dREAD_TYPE,
-                                    ((const char*)base) + (boff >> 3),
-                                    ( size_t ) row_bits >> 3);
-                                if (idxSPOT_GROUP != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxSPOT_GROUP, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        if (row_bits > 0) {
-                                            int n = row_bits >> 3;
-                                            if (boff & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcOffset, rcInvalid);
-                                            }
-                                            else if (row_bits & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcSize, rcInvalid); }
-                                            else if ( n  > MAX_SPOT_GROUP ) {
-                                                char * tmp = NULL;
-                                                MAX_SPOT_GROUP = n + 1000;
-                                                tmp = realloc ( dSPOT_GROUP,
-                                                    MAX_SPOT_GROUP );
-                                                if ( tmp == NULL ) {
-                                                    rc = RC ( rcExe, rcStorage,
-                                                     rcAllocating, rcMemory, rcExhausted );
-                                                    DBGMSG ( DBG_APP, DBG_COND_1,
-                                                        ( "Failed to reallocate "
-                                                        "buffer for SPOT_GROUP[%zu]\n",
-                                                        MAX_SPOT_GROUP ) );
-                                                }
-                                                else {
-                                                    DBGMSG ( DBG_APP, DBG_COND_1,
-                                                        ( "Reallocated "
-                                                        "buffer for SPOT_GROUP[%zu]\n",
-                                                        MAX_SPOT_GROUP ) );
-                                                    dSPOT_GROUP = tmp;
-                                                }
-                                            }
-                                            DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                               "after calling VCursorColumnRead"
-                                               );
-                                            if (rc == 0) {
-                                                bitsz_t n = row_bits >> 3;
-                                                memmove(dSPOT_GROUP,
-                                                  ((const char*)base)+(boff>>3),
-                                                  ( size_t ) row_bits>>3);
-                                                dSPOT_GROUP[n]='\0';
-                                                if (n > 1 ||
-                                                    (n == 1 && dSPOT_GROUP[0]))
-                                                {
-                                                    pb -> hasSPOT_GROUP = 1;
-                                                }
-                                            }
-                                        }
-                                        else {
-                                            dSPOT_GROUP[0]='\0';
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                            }
-                            if (rc == 0) {
-                                uint64_t cmp_len = 0; /* CMP_READ */
-                                if (idxRD_FILTER != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxRD_FILTER, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, RD_FILTER, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        bitsz_t size = row_bits >> 3;
-                                        if (boff & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcOffset, rcInvalid); }
-                                        else if (row_bits & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcSize, rcInvalid);
-                                        }
-                                        else if (size >
-                                            MAX_NREADS * sizeof * dRD_FILTER)
-                                        {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcBuffer, rcInsufficient);
-                                        }
-                                        DISP_RC_Read(rc, RD_FILTER, spotid,
-                                            "after calling VCursorColumnRead");
-                                        if (rc == 0) {
-                                            memmove(dRD_FILTER,
-                                                ((const char*)base) + (boff>>3),
-                                                ( size_t ) size);
-                                            if (size < nreads) {
-                             /* RD_FILTER is expected to have nreads elements */
-                                                if (size == 1) {
-                             /* fill all RD_FILTER elements with RD_FILTER[0] */
-                                                    int i = 0;
-                                                    for (i = 1; i < nreads;
-                                                        ++i)
-                                                    {
-                                                        memmove(dRD_FILTER + i,
-                                                  ((const char*)base)+(boff>>3),
-                                                  1);
-                                                    }
-                                                    if
-                                                     (!bad_read_filter)
-                                                    {
-                                                        bad_read_filter = true;
-                                                        PLOGMSG(klogWarn,
-                                                            (klogWarn,
-             "RD_FILTER column size is 1 but it is expected to be $(n)",
-                                                            "n=%d", nreads));
-                                                    }
-                                                }
-                                                else {
-                                  /* something really bad with RD_FILTER column:
-                                     let's pretend it does not exist */
-                                                    idxRD_FILTER = 0;
-                                                    bad_read_filter = true;
-                                                    PLOGMSG(klogWarn,
-                                                        (klogWarn,
-             "RD_FILTER column size is $(real) but it is expected to be $(exp)",
-                                                        "real=%d,exp=%d",
-                                                        size, nreads));
-                                                }
-                                            }
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                                if (idxPRIMARY_ALIGNMENT_ID != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxPRIMARY_ALIGNMENT_ID,
-                                        &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                        spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid); }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                       spotid,
-                                       "after calling calling VCursorColumnRead"
-                                       );
-                                    if (rc == 0) {
-                                        int i = 0;
-                                        const int64_t* pii = base;
-                                        assert(nreads);
-                                        for (i = 0; i < nreads; ++i) {
-                                            if (pii[i] == 0)
-/* eCMP_BASE_COUNT SRR12544267 */               cmp_len += dREAD_LEN[i];
-                                        }
-                                    }
-                                }
-
-                                ss = (SraStats*)BSTreeFind
-                                    (tr, dSPOT_GROUP, srastats_cmp);
-                                if (ss == NULL) {
-                                    ss = calloc(1, sizeof(*ss));
-                                    if (ss == NULL) {
-                                        rc = RC(rcExe, rcStorage, rcAllocating,
-                                            rcMemory, rcExhausted);
-                                        break;
-                                    }
-                                    else {
-                                        strcpy(ss->spot_group, dSPOT_GROUP);
-                                        BSTreeInsert
-                                            (tr, (BSTNode*)ss, srastats_sort);
-                                    }
-                                }
-     /* eSG_SPOT_COUNT */       ++ss->spot_count;
-     /* eSPOT_COUNT */          ++total->spot_count;
-
-     /* eSG_CMP_BASE_COUNT */   ss->total_cmp_len += cmp_len;
-                                total->total_cmp_len += cmp_len;
-
-                                if (pb->statistics) {
-                                    SraStatsTotalAdd(total, dREAD_LEN, nreads);
-                                }
-                                for (bio_len = bio_count = i = bad_cnt
-                                        = filt_cnt = 0;
-                                    (i < nreads) && (rc == 0); i++)
-                                {
-                                    if ( i >= MAX_NREADS ) {
-                                        rc = RC ( rcExe, rcData, rcProcessing,
-                                                  rcBuffer, rcInsufficient );
-                                        break;
-                                    }
-                                    if (dREAD_LEN[i] > 0) {
-                                        g_totalREAD_LEN[i] += dREAD_LEN[i];
-                                        ++g_nonZeroLenReads[i];
-                                    }
-                                    if (spotid == start) {
-                                        g_dREAD_LEN[i] = dREAD_LEN[i];
-                                    }
-                                    else if (g_dREAD_LEN[i] != dREAD_LEN[i]) {
-                                        fixedReadLength = false;
-                                    }
-
-                                    if (dREAD_LEN[i] > 0) {
-                                        bool biological = false;
-             /* eSG_BASE_COUNT */       ss->total_len += dREAD_LEN[i];
-             /* eBASE_COUNT */          total->BASE_COUNT += dREAD_LEN[i];
-                                        if ((dREAD_TYPE[i]
-                                            & SRA_READ_TYPE_BIOLOGICAL) != 0)
-                                        {
-                                            biological = true;
-                                            bio_len += dREAD_LEN[i];
-                                            bio_count++;
-                                        }
-                                        if (idxRD_FILTER != 0) {
-                                            switch (dRD_FILTER[i]) {
-                                                case SRA_READ_FILTER_PASS:
-                                                    break;
-                                                case SRA_READ_FILTER_REJECT:
-                                                case SRA_READ_FILTER_CRITERIA:
-                                                    if (biological) {
-                                                        ss->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    bad_cnt++;
-                                                    break;
-                                                case SRA_READ_FILTER_REDACTED:
-                                                    if (biological) {
-                                                        ss->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    filt_cnt++;
-                                                    break;
-                                                default:
-                                                    rc = RC(rcExe, rcColumn,
-                                                        rcReading,
-                                                        rcData, rcUnexpected);
-                                                    PLOGERR(klogInt,
-                                                        (klogInt, rc,
-    "spot=$(spot), read=$(read), READ_FILTER=$(val)", "spot=%lu,read=%d,val=%d",
-                                                        spotid, i,
-                                                        dRD_FILTER[i]));
-                                                    break;
-                                            }
-                                        }
-                                    }
-                                }
-     /* eSG_BIO_BASE_COUNT */   ss->bio_len += bio_len;
-     /* eBIO_BASE_COUNT */      total->BIO_BASE_COUNT += bio_len;
-                                if (bio_count > 1) {
-                                    ++ss->spot_count_mates;
-                                    ++total->spot_count_mates;
-                                    ss->bio_len_mates += bio_len;
-                                    total->bio_len_mates += bio_len;
-                                }
-                                if (bad_cnt) {
-                                    ss->bad_spot_count++;
-                                    total->bad_spot_count++;
-                                }
-                                if (filt_cnt) {
-                                    ss->filtered_spot_count++;
-                                    total->filtered_spot_count++;
-                                }
-                            }
+static rc_t SraStatsScanRelease(SraStatsScan* self) {
+    rc_t rc = 0;
 
-                            if (rc == 0 && pb->progress) {
-                                KLoadProgressbar_Process(pr, 1, false);
-                            }
-                        }
-                    } /* for (spotid = start; spotid <= stop && rc == 0;
-                              ++spotid) */
-
-                    for (spotid = total->bases_count.startALIGNMENT;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopALIGNMENT && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, true,
-                            dREAD_LEN, dREAD_TYPE);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+    assert(self);
 
-                    for (spotid = total->bases_count.startSEQUENCE;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopSEQUENCE && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, false,
-                            dREAD_LEN, dREAD_TYPE);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+    RELEASE(VCursor, self->curs);
 
-                    if (rc == 0) {
-                        BasesFinalize(&total->bases_count);
-                        pb->variableReadLength = !fixedReadLength;
+    BSTreeWhack(&self->tr, bst_whack_free, NULL);
+    SraStatsTotalFree(&self->total);
+    if (self->bases == &self->own_bases) {
+        BasesRelease(&self->own_bases);
+    }
 
-              /* --- g_totalREAD_LEN[i] is sum(READ_LEN[i]) for all spots --- */
-                        if (fixedNReads) {
-                            int i = 0;
-                            if (stop >= start) {
-                                n_spots = stop - start;
-                            }
-                            if (n_spots > 0) {
-                                for (i = 0; i < g_nreads && rc == 0; ++i) {
-                                    if (fixedReadLength) {
-                                        assert(g_totalREAD_LEN[i] / n_spots
-                                            == g_dREAD_LEN[i]);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    if (rc == 0) {
-                        KLoadProgressbar_Release(pr, true);
-                        pr = NULL;
-                    }
+    free ( self->dREAD_LEN );
+    free ( self->dREAD_TYPE );
+    free ( self->dRD_FILTER );
+    free ( self->dSPOT_GROUP );
+    free ( self->totalREAD_LEN );
+    free ( self->nonZeroLenReads );
 
-                    free ( dREAD_LEN );
-                    free ( dREAD_TYPE );
-                    free ( dRD_FILTER );
-                    free ( dSPOT_GROUP );
-                }
-            }
-        }
-    }
+    return rc;
+}
 
-    RELEASE(VCursor, curs);
+/* forgets the results of the scan of spots */
+static rc_t SraStatsScanClear(SraStatsScan* self) {
+    rc_t rc = 0;
 
-    if (pb->test && rc == 0) {
-        uint32_t idx = 0;
-        int i = 0;
-        int64_t spotid = 0;
+    assert(self && self->shared && self->shared->pb);
 
-        double   * average   = calloc ( MAX_NREADS, sizeof * average   );
-        double   * diff_sq   = calloc ( MAX_NREADS, sizeof * diff_sq   );
-        uint32_t * dREAD_LEN = calloc ( MAX_NREADS, sizeof * dREAD_LEN );
-        if ( average == NULL || diff_sq == NULL || dREAD_LEN == NULL )
-            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
-        SraStatsTotalStatistics2Init(total,
-            g_nreads, g_totalREAD_LEN, g_nonZeroLenReads);
-        for (i = 0; i < g_nreads; ++i) {
-            average[i] = (double)g_totalREAD_LEN[i] / n_spots;
-        }
+    BSTreeWhack(&self->tr, bst_whack_free, NULL);
+    BSTreeInit(&self->tr);
 
-        if ( rc == 0 ) {
-            rc = VTableCreateCachedCursorRead(vtbl, &curs, DEFAULT_CURSOR_CAPACITY);
-            DISP_RC(rc, "Cannot VTableCreateCachedCursorRead");
-        }
+    SraStatsTotalFree(&self->total);
+    memset(&self->total, 0, sizeof self->total);
 
-        if (rc == 0) {
-            const char* name = READ_LEN;
-            rc = VCursorAddColumn(curs, &idx, "%s", name);
-            DISP_RC(rc, "Cannot VCursorAddColumn(READ_LEN)");
-            if (rc == 0) {
-                rc = VCursorOpen(curs);
-                if (rc != 0) {
-                    PLOGERR(klogInt, (klogInt,
-                        rc, "Cannot VCursorOpen($(name))", "name=%s", name));
-                }
-            }
-        }
+    memset(self->totalREAD_LEN, 0,
+        self->max_nreads * sizeof * self->totalREAD_LEN);
+    memset(self->nonZeroLenReads, 0,
+        self->max_nreads * sizeof * self->nonZeroLenReads);
 
-        for (spotid = start; spotid < stop && rc == 0; ++spotid) {
-            const void* base;
-            bitsz_t boff, row_bits;
-            if (rc == 0) {
-                rc = VCursorColumnRead(curs, spotid,
-                    idx, &base, &boff, &row_bits);
-                DISP_RC_Read(rc, READ_LEN, spotid,
-                    "while calling VCursorColumnRead");
-                if ( ( row_bits >> 3 ) > sizeof dREAD_LEN )
-                    rc = RC ( rcExe, rcColumn, rcReading,
-                              rcBuffer, rcInsufficient);
-            }
-            if (rc == 0) {
-                memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
-                        ( size_t ) row_bits>>3);
-            }
-            for (i = 0; i < g_nreads; ++i) {
-                diff_sq[i] +=
-                    (dREAD_LEN[i] - average[i]) * (dREAD_LEN[i] - average[i]);
-            }
-            SraStatsTotalAdd2(total, dREAD_LEN);
-        }
-        RELEASE(VCursor, curs);
+    SraStatsScanReset(self);
 
-        free ( average );
-        free ( diff_sq );
-        free ( dREAD_LEN );
+    if (self->shared->pb->statistics) {
+        rc = SraStatsTotalMakeStatistics(&self->total, self->shared->nreads);
     }
 
-    free ( g_totalREAD_LEN );
-    free ( g_nonZeroLenReads );
-    free ( g_dREAD_LEN );
-
     return rc;
 }
 
-static
-void CtxRelease(Ctx* ctx)
-{
-    assert(ctx);
-
-    QualityStatsRelease(&ctx->quality);
-    TableCountsRelease(&ctx->tables);
-
-    memset(ctx, 0, sizeof *ctx);
-}
+/* makes the per-read buffers big enough for max_nreads reads */
+static rc_t SraStatsScanGrow(SraStatsScan* self, size_t max_nreads) {
+    rc_t rc = 0;
+    size_t old = 0;
 
-static bool VDatabaseIsSingleTblDb(const VDatabase * self) {
-    bool isSingleTblDb = false;
+    assert(self);
 
-    uint32_t count = 0;
+    old = self->max_nreads;
+    if (max_nreads <= old) {
+        return 0;
+    }
+
+    if ( rc == 0 ) {
+        uint32_t * tmp = realloc ( self->dREAD_LEN,
+            max_nreads * sizeof * self->dREAD_LEN );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self->dREAD_LEN = tmp;
+    }
+    if ( rc == 0 ) {
+        uint8_t * tmp = realloc ( self->dREAD_TYPE,
+            max_nreads * sizeof * self->dREAD_TYPE );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self->dREAD_TYPE = tmp;
+    }
+    if ( rc == 0 ) {
+        uint8_t * tmp = realloc ( self->dRD_FILTER,
+            max_nreads * sizeof * self->dRD_FILTER );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self->dRD_FILTER = tmp;
+    }
+    if ( rc == 0 ) {
+        uint64_t * tmp = realloc ( self->totalREAD_LEN,
+            max_nreads * sizeof * self->totalREAD_LEN );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else {
+            self->totalREAD_LEN = tmp;
+            memset ( self->totalREAD_LEN + old, 0,
+                ( max_nreads - old ) * sizeof * self->totalREAD_LEN );
+        }
+    }
+    if ( rc == 0 ) {
+        uint64_t * tmp = realloc ( self->nonZeroLenReads,
+            max_nreads * sizeof * self->nonZeroLenReads );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else {
+            self->nonZeroLenReads = tmp;
+            memset ( self->nonZeroLenReads + old, 0,
+                ( max_nreads - old ) * sizeof * self->nonZeroLenReads );
+        }
+    }
+
+    if ( rc == 0 ) {
+        self->max_nreads = max_nreads;
+        DBGMSG ( DBG_APP, DBG_COND_1, (
+            "Reallocated buffers for %zu READS\n", max_nreads ) );
+    }
+    else
+        DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to "
+            "reallocate buffers for %zu READS\n", max_nreads ) );
+
+    return rc;
+}
+
+/* reads READ_LEN of a spot into dREAD_LEN */
+static rc_t SraStatsScanReadLen(SraStatsScan* self, int64_t spotid,
+    int *nreads)
+{
+    rc_t rc = 0;
+
+    const void* base = NULL;
+    bitsz_t boff = 0, row_bits = 0;
+
+    assert(self && nreads);
+
+    rc = VCursorColumnRead(self->curs, spotid,
+        self->idxREAD_LEN, &base, &boff, &row_bits);
+    DISP_RC_Read(rc, "READ_LEN", spotid, "while calling VCursorColumnRead");
+    if (rc == 0) {
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        else if ( ( row_bits >> 3 )
+            > self->max_nreads * sizeof * self->dREAD_LEN )
+        {
+            rc = SraStatsScanGrow(self,
+                ( row_bits >> 3 ) / sizeof * self->dREAD_LEN + 1000);
+        }
+        DISP_RC_Read(rc, "READ_LEN", spotid,
+            "after calling VCursorColumnRead");
+    }
+    if (rc == 0) {
+        memmove(self->dREAD_LEN, ((const char*)base) + (boff>>3),
+                ( size_t ) row_bits >> 3);
+        *nreads = (int) ((row_bits >> 3) / sizeof(*self->dREAD_LEN));
+    }
+
+    return rc;
+}
+
+static rc_t SraStatsScanSpot(SraStatsScan* self, int64_t spotid) {
+    rc_t rc = 0;
+
+    const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
+    const char RD_FILTER [] = "RD_FILTER";
+    const char READ_TYPE [] = "READ_TYPE";
+    const char SPOT_GROUP[] = "SPOT_GROUP";
+
+    const SraStatsScanShared* shared = NULL;
+    SraStatsTotal* total = NULL;
+    SraStats* ss = NULL;
+
+    const void* base = NULL;
+    bitsz_t boff = 0, row_bits = 0;
+    int nreads = 0;
+
+    uint64_t cmp_len = 0; /* CMP_READ */
+    int i, bio_len, bio_count, bad_cnt, filt_cnt;
+
+    assert(self && self->shared);
+
+    shared = self->shared;
+    total = &self->total;
+
+    rc = SraStatsScanReadLen(self, spotid, &nreads);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (shared->nreads != nreads) {
+        self->fixedNReads = false;
+    }
+
+    rc = VCursorColumnRead(self->curs, spotid,
+        self->idxREAD_TYPE, &base, &boff, &row_bits);
+    DISP_RC_Read(rc, READ_TYPE, spotid, "while calling VCursorColumnRead");
+    if (rc == 0) {
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        else if ((row_bits >> 3) > self->max_nreads * sizeof * self->dREAD_TYPE)
+        {
+            rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
+        }
+        else if ((row_bits >> 3) !=  nreads) {
+            rc = RC(rcExe, rcColumn, rcReading, rcData, rcIncorrect);
+        }
+        DISP_RC_Read(rc, READ_TYPE, spotid, "after calling VCursorColumnRead");
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    memmove(self->dREAD_TYPE, ((const char*)base) + (boff >> 3),
+        ( size_t ) row_bits >> 3);
+
+    if (self->idxSPOT_GROUP != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxSPOT_GROUP, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, SPOT_GROUP, spotid,
+            "while calling VCursorColumnRead");
+        if (rc != 0) {
+            return rc;
+        }
+        if (row_bits > 0) {
+            size_t n = row_bits >> 3;
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            else if ( n >= self->max_spot_group ) {
+                size_t max_spot_group = n + 1000;
+                char * tmp = realloc ( self->dSPOT_GROUP, max_spot_group );
+                if ( tmp == NULL ) {
+                    rc = RC ( rcExe, rcStorage,
+                        rcAllocating, rcMemory, rcExhausted );
+                    DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to reallocate "
+                        "buffer for SPOT_GROUP[%zu]\n", max_spot_group ) );
+                }
+                else {
+                    DBGMSG ( DBG_APP, DBG_COND_1, ( "Reallocated "
+                        "buffer for SPOT_GROUP[%zu]\n", max_spot_group ) );
+                    self->dSPOT_GROUP = tmp;
+                    self->max_spot_group = max_spot_group;
+                }
+            }
+            DISP_RC_Read(rc, SPOT_GROUP, spotid,
+                "after calling VCursorColumnRead");
+            if (rc == 0) {
+                memmove(self->dSPOT_GROUP, ((const char*)base) + (boff>>3),
+                    n);
+                self->dSPOT_GROUP[n]='\0';
+                if (n > 1 || (n == 1 && self->dSPOT_GROUP[0])) {
+                    self->hasSPOT_GROUP = true;
+                }
+            }
+        }
+        else {
+            self->dSPOT_GROUP[0]='\0';
+        }
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (self->useRD_FILTER) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxRD_FILTER, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, RD_FILTER, spotid, "while calling VCursorColumnRead");
+        if (rc != 0) {
+            return rc;
+        }
+        else {
+            bitsz_t size = row_bits >> 3;
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            else if (size > self->max_nreads * sizeof * self->dRD_FILTER) {
+                rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
+            }
+            DISP_RC_Read(rc, RD_FILTER, spotid,
+                "after calling VCursorColumnRead");
+            if (rc == 0) {
+                memmove(self->dRD_FILTER, ((const char*)base) + (boff>>3),
+                    ( size_t ) size);
+                if (size < nreads) {
+                    /* RD_FILTER is expected to have nreads elements */
+                    if (size == 1) {
+                        /* fill all RD_FILTER elements with RD_FILTER[0] */
+                        memset(self->dRD_FILTER + 1, self->dRD_FILTER[0],
+                            nreads - 1);
+                        if (self->bad_read_filter_nreads == 0) {
+                            self->bad_read_filter_nreads = nreads;
+                        }
+                    }
+                    else {
+                        /* something really bad with RD_FILTER column:
+                           let's pretend it does not exist */
+                        self->useRD_FILTER = false;
+                        self->dropped_read_filter = true;
+                        self->dropped_read_filter_size = (int) size;
+                        self->dropped_read_filter_nreads = nreads;
+                    }
+                }
+            }
+        }
+    }
+
+    if (rc == 0 && self->idxPRIMARY_ALIGNMENT_ID != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxPRIMARY_ALIGNMENT_ID, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+            "while calling VCursorColumnRead");
+        if (rc == 0) {
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+                "after calling calling VCursorColumnRead");
+        }
+        if (rc == 0) {
+            const int64_t* pii = base;
+            assert(nreads);
+            for (i = 0; i < nreads; ++i) {
+                if (pii[i] == 0)
+/* eCMP_BASE_COUNT SRR12544267 */   cmp_len += self->dREAD_LEN[i];
+            }
+        }
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    ss = (SraStats*)BSTreeFind(&self->tr, self->dSPOT_GROUP, srastats_cmp);
+    if (ss == NULL) {
+        ss = calloc(1, sizeof(*ss));
+        if (ss == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        strcpy(ss->spot_group, self->dSPOT_GROUP);
+        BSTreeInsert(&self->tr, (BSTNode*)ss, srastats_sort);
+    }
+/* eSG_SPOT_COUNT */       ++ss->spot_count;
+/* eSPOT_COUNT */          ++total->spot_count;
+
+/* eSG_CMP_BASE_COUNT */   ss->total_cmp_len += cmp_len;
+                           total->total_cmp_len += cmp_len;
+
+    if (shared->pb->statistics) {
+        SraStatsTotalAdd(total, self->dREAD_LEN, nreads);
+    }
+    for (bio_len = bio_count = i = bad_cnt = filt_cnt = 0;
+        (i < nreads) && (rc == 0); i++)
+    {
+        uint32_t len = self->dREAD_LEN[i];
+        if (len > 0) {
+            self->totalREAD_LEN[i] += len;
+            ++self->nonZeroLenReads[i];
+        }
+        if ((i < shared->nreads ? shared->dREAD_LEN[i] : 0) != len) {
+            self->fixedReadLength = false;
+        }
+
+        if (len > 0) {
+            bool biological = false;
+/* eSG_BASE_COUNT */       ss->total_len += len;
+/* eBASE_COUNT */          total->BASE_COUNT += len;
+            if ((self->dREAD_TYPE[i] & SRA_READ_TYPE_BIOLOGICAL) != 0) {
+                biological = true;
+                bio_len += len;
+                bio_count++;
+            }
+            if (self->useRD_FILTER) {
+                switch (self->dRD_FILTER[i]) {
+                    case SRA_READ_FILTER_PASS:
+                        break;
+                    case SRA_READ_FILTER_REJECT:
+                    case SRA_READ_FILTER_CRITERIA:
+                        if (biological) {
+                            ss->bad_bio_len += len;
+                            total->bad_bio_len += len;
+                        }
+                        bad_cnt++;
+                        break;
+                    case SRA_READ_FILTER_REDACTED:
+                        if (biological) {
+                            ss->filtered_bio_len += len;
+                            total->filtered_bio_len += len;
+                        }
+                        filt_cnt++;
+                        break;
+                    default:
+                        rc = RC(rcExe, rcColumn, rcReading,
+                            rcData, rcUnexpected);
+                        PLOGERR(klogInt, (klogInt, rc,
+                            "spot=$(spot), read=$(read), READ_FILTER=$(val)",
+                            "spot=%lu,read=%d,val=%d",
+                            spotid, i, self->dRD_FILTER[i]));
+                        break;
+                }
+            }
+        }
+    }
+/* eSG_BIO_BASE_COUNT */   ss->bio_len += bio_len;
+/* eBIO_BASE_COUNT */      total->BIO_BASE_COUNT += bio_len;
+    if (bio_count > 1) {
+        ++ss->spot_count_mates;
+        ++total->spot_count_mates;
+        ss->bio_len_mates += bio_len;
+        total->bio_len_mates += bio_len;
+    }
+    if (bad_cnt) {
+        ss->bad_spot_count++;
+        total->bad_spot_count++;
+    }
+    if (filt_cnt) {
+        ss->filtered_spot_count++;
+        total->filtered_spot_count++;
+    }
+
+    return rc;
+}
+
+/* reports the rows scanned since the last call to the progress bar */
+static void SraStatsScanProgress(SraStatsScan* self, bool flush) {
+    const SraStatsScanShared* shared = NULL;
+
+    assert(self && self->shared);
+
+    shared = self->shared;
+    if (shared->pr == NULL || self->progress == 0) {
+        return;
+    }
+
+    if (shared->lock == NULL) {
+        KLoadProgressbar_Process(shared->pr, self->progress, false);
+        self->progress = 0;
+    }
+    else if (flush || self->progress >= 1024) {
+        if (KLockAcquire(shared->lock) == 0) {
+            KLoadProgressbar_Process(shared->pr, self->progress, false);
+            KLockUnlock(shared->lock);
+        }
+        self->progress = 0;
+    }
+}
+
+static rc_t SraStatsScanSpots(SraStatsScan* self) {
+    rc_t rc = 0;
+    int64_t spotid = 0;
+
+    assert(self);
+
+    for (spotid = self->start; spotid < self->stop && rc == 0; ++spotid) {
+        rc = Quitting();
+        if (rc != 0) {
+            LOGMSG(klogWarn, "Interrupted");
+        }
+
+        if (rc == 0) {
+            rc = SraStatsScanSpot(self, spotid);
+        }
+
+        if (rc == 0) {
+            ++self->progress;
+            SraStatsScanProgress(self, false);
+        }
+    }
+    SraStatsScanProgress(self, true);
+
+    return rc;
+}
+
+static rc_t SraStatsScanBases(SraStatsScan* self) {
+    rc_t rc = 0;
+    int64_t spotid = 0;
+    bool quick = false;
+
+    assert(self && self->shared && self->shared->pb);
+
+    quick = self->shared->pb->quick;
+
+    for (spotid = self->startALIGNMENT;
+         !quick && spotid < self->stopALIGNMENT && rc == 0; ++spotid)
+    {
+        rc = BasesAdd(self->bases, spotid, true,
+            self->dREAD_LEN, self->dREAD_TYPE);
+        if (rc == 0) {
+            ++self->progress;
+            SraStatsScanProgress(self, false);
+        }
+        rc = Quitting();
+        if (rc != 0)
+            LOGMSG(klogWarn, "Interrupted");
+    }
+
+    for (spotid = self->startSEQUENCE;
+         !quick && spotid < self->stopSEQUENCE && rc == 0; ++spotid)
+    {
+        rc = BasesAdd(self->bases, spotid, false,
+            self->dREAD_LEN, self->dREAD_TYPE);
+        if (rc == 0) {
+            ++self->progress;
+            SraStatsScanProgress(self, false);
+        }
+        rc = Quitting();
+        if (rc != 0)
+            LOGMSG(klogWarn, "Interrupted");
+    }
+    SraStatsScanProgress(self, true);
+
+    return rc;
+}
+
+/* the second pass of --test: READ_LEN differences from the average */
+static rc_t SraStatsScanTest(SraStatsScan* self) {
+    rc_t rc = 0;
+    int64_t spotid = 0;
+
+    assert(self);
+
+    for (spotid = self->start; spotid < self->stop && rc == 0; ++spotid) {
+        const void* base = NULL;
+        bitsz_t boff = 0, row_bits = 0;
+
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxREAD_LEN, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, "READ_LEN", spotid,
+            "while calling VCursorColumnRead");
+        if (rc == 0 &&
+            ( row_bits >> 3 ) > self->max_nreads * sizeof * self->dREAD_LEN)
+        {
+            rc = RC ( rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
+        }
+        if (rc == 0) {
+            memmove(self->dREAD_LEN, ((const char*)base) + (boff>>3),
+                    ( size_t ) row_bits>>3);
+            SraStatsTotalAdd2(&self->total, self->dREAD_LEN);
+        }
+    }
+
+    return rc;
+}
+
+static rc_t CC SraStatsScanThread(const KThread *self, void *data) {
+    SraStatsScan* scan = data;
+
+    assert(scan && scan->fn);
+
+    scan->rc = scan->fn(scan);
+
+    return scan->rc;
+}
+
+/* runs a stage of the scan: the first worker runs on the calling thread.
+   Returns the error of the first range that failed */
+static rc_t SraStatsScanRun(SraStatsScan* scans, uint32_t count,
+    SraStatsScanFn fn)
+{
+    rc_t rc = 0;
+    uint32_t i = 0;
+
+    assert(scans && count > 0 && fn);
+
+    for (i = 1; i < count; ++i) {
+        rc_t rc2 = 0;
+        scans[i].fn = fn;
+        scans[i].rc = 0;
+        scans[i].thread = NULL;
+        rc2 = KThreadMake(&scans[i].thread, SraStatsScanThread, &scans[i]);
+        DISP_RC(rc2, "Cannot KThreadMake");
+        if (rc2 != 0) {
+            /* will be run on the calling thread */
+            scans[i].thread = NULL;
+        }
+    }
+
+    scans[0].rc = fn(&scans[0]);
+
+    for (i = 1; i < count; ++i) {
+        if (scans[i].thread != NULL) {
+            rc_t status = 0;
+            rc_t rc2 = KThreadWait(scans[i].thread, &status);
+            if (rc2 != 0) {
+                scans[i].rc = rc2;
+            }
+            KThreadRelease(scans[i].thread);
+            scans[i].thread = NULL;
+        }
+        else {
+            scans[i].rc = fn(&scans[i]);
+        }
+    }
+
+    for (i = 0; i < count && rc == 0; ++i) {
+        rc = scans[i].rc;
+    }
+
+    return rc;
+}
+
+/* splits [start, stop) into count parts: returns the part number i */
+static void SraStatsSplit(int64_t start, int64_t stop, uint32_t i,
+    uint32_t count, int64_t *from, int64_t *to)
+{
+    uint64_t n = stop > start ? stop - start : 0;
+
+    assert(from && to && i < count);
+
+    *from = start + n * i / count;
+    *to   = start + n * ( i + 1 ) / count;
+}
+
+static void SraStatsScanSetRanges(SraStatsScan* scans, uint32_t count,
+    int64_t start, int64_t stop, const Bases *bases)
+{
+    uint32_t i = 0;
+
+    assert(scans && bases);
+
+    for (i = 0; i < count; ++i) {
+        SraStatsScan* self = scans + i;
+        SraStatsSplit(start, stop, i, count, &self->start, &self->stop);
+        SraStatsSplit(bases->startALIGNMENT, bases->stopALIGNMENT, i, count,
+            &self->startALIGNMENT, &self->stopALIGNMENT);
+        SraStatsSplit(bases->startSEQUENCE, bases->stopSEQUENCE, i, count,
+            &self->startSEQUENCE, &self->stopSEQUENCE);
+    }
+}
+
+typedef struct SraStatsMergeData {
+    BSTree *tr;
+    rc_t rc;
+} SraStatsMergeData;
+
+static
+void CC srastats_merge ( BSTNode *n, void *data )
+{
+    const SraStats *from = ( const SraStats* ) n;
+    SraStatsMergeData *d = data;
+    SraStats *ss = NULL;
+
+    if (d->rc != 0) {
+        return;
+    }
+
+    ss = (SraStats*)BSTreeFind(d->tr, from->spot_group, srastats_cmp);
+    if (ss == NULL) {
+        ss = calloc(1, sizeof(*ss));
+        if (ss == NULL) {
+            d->rc = RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+            return;
+        }
+        strcpy(ss->spot_group, from->spot_group);
+        BSTreeInsert(d->tr, (BSTNode*)ss, srastats_sort);
+    }
+
+    ss->spot_count          += from->spot_count;
+    ss->spot_count_mates    += from->spot_count_mates;
+    ss->bio_len             += from->bio_len;
+    ss->bio_len_mates       += from->bio_len_mates;
+    ss->total_len           += from->total_len;
+    ss->bad_spot_count      += from->bad_spot_count;
+    ss->bad_bio_len         += from->bad_bio_len;
+    ss->filtered_spot_count += from->filtered_spot_count;
+    ss->filtered_bio_len    += from->filtered_bio_len;
+    ss->total_cmp_len       += from->total_cmp_len;
+}
+
+static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
+    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+{
+    rc_t rc = 0;
+
+    SraStatsScanShared shared;
+    SraStatsScan * scans = NULL;
+    uint32_t count = 0;
+    uint32_t i = 0;
+
+    int64_t  n_spots = 0;
+    int64_t start = 0;
+    int64_t stop  = 0;
+
+    uint32_t * g_dREAD_LEN = NULL; /* READ_LEN of the first spot */
+    uint64_t * g_totalREAD_LEN = NULL; /* sum(READ_LEN[i]) for all spots */
+    uint64_t * g_nonZeroLenReads = NULL;
+    bool fixedNReads = true;
+    bool fixedReadLength = true;
+
+    assert(pb && vtbl && tr && total);
+
+    memset(&shared, 0, sizeof shared);
+    shared.pb = pb;
+
+    count = pb->threads > 0 ? pb->threads : 1;
+    scans = calloc(count, sizeof *scans);
+    if (scans == NULL) {
+        return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+    }
+
+    rc = SraStatsScanInit(&scans[0], &shared, vtbl);
+
+    if (rc == 0) {
+        int64_t first = 0;
+        uint64_t row_count = 0;
+        pb->hasSPOT_GROUP = 0;
+        rc = VCursorIdRange(scans[0].curs, 0, &first, &row_count);
+        DISP_RC(rc, "VCursorIdRange() failed");
+        if (rc == 0) {
+            rc = BasesInit(&total->bases_count, ctx, vtbl, pb);
+            scans[0].bases = &total->bases_count;
+        }
+        if (rc == 0) {
+            if (pb->start > 0) {
+                start = pb->start;
+                if (start < first) {
+                    start = first;
+                }
+            }
+            else {
+                start = first;
+            }
+
+            if (pb->stop > 0) {
+                stop = pb->stop;
+                if ( ( uint64_t ) stop > first + row_count) {
+                    stop = first + row_count;
+                }
+            }
+            else {
+                stop = first + row_count;
+            }
+        }
+    }
+
+    if (rc == 0 && start < stop) {
+        int nreads = 0;
+        rc = SraStatsScanReadLen(&scans[0], start, &nreads);
+        if (rc == 0 && nreads > 0) {
+            g_dREAD_LEN = malloc(nreads * sizeof * g_dREAD_LEN);
+            if (g_dREAD_LEN == NULL) {
+                rc = RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+            }
+            else {
+                memmove(g_dREAD_LEN, scans[0].dREAD_LEN,
+                    nreads * sizeof * g_dREAD_LEN);
+                shared.nreads = nreads;
+                shared.dREAD_LEN = g_dREAD_LEN;
+            }
+        }
+        if (rc == 0 && pb->statistics) {
+            rc = SraStatsTotalMakeStatistics(total, shared.nreads);
+        }
+    }
+
+    /* no worker without a spot */
+    if (rc == 0 && ( uint64_t ) count > ( uint64_t ) ( stop - start )) {
+        count = stop > start ? ( uint32_t ) ( stop - start ) : 1;
+    }
+
+    for (i = 1; i < count && rc == 0; ++i) {
+        rc = SraStatsScanInit(&scans[i], &shared, vtbl);
+        if (rc == 0) {
+            rc = BasesInit(&scans[i].own_bases, ctx, vtbl, pb);
+        }
+    }
+
+    for (i = 0; i < count && rc == 0 && pb->statistics; ++i) {
+        rc = SraStatsTotalMakeStatistics(&scans[i].total, shared.nreads);
+    }
+
+    if (rc == 0 && count > 1) {
+        rc = KLockMake(&shared.lock);
+        DISP_RC(rc, "Cannot KLockMake");
+    }
+
+    if (rc == 0 && pb->progress && start < stop) {
+        const KLoadProgressbar *pr = NULL;
+        uint64_t b = total->bases_count.stopSEQUENCE + 1
+                   - total->bases_count.startSEQUENCE;
+        if ( total->bases_count.stopALIGNMENT > 0 )
+            b +=  total->bases_count.stopALIGNMENT + 1
+                - total->bases_count.startALIGNMENT;
+        rc = KLoadProgressbar_Make(&pr, stop + 1 - start + b);
+        if (rc != 0) {
+            DISP_RC(rc, "cannot initialize progress bar");
+            rc = 0;
+            pr = NULL;
+        }
+        else if (stop - start > 99) {
+            KLoadProgressbar_Process(pr, 0, true);
+        }
+        shared.pr = pr;
+    }
+
+    if (rc == 0) {
+        SraStatsScanSetRanges(scans, count, start, stop, &total->bases_count);
+        rc = SraStatsScanRun(scans, count, SraStatsScanSpots);
+    }
+
+    if (rc == 0 && count > 1) {
+        /* after RD_FILTER turned out to be broken in a spot it is ignored:
+           the workers of the following ranges could not know it */
+        bool rescan = false;
+        for (i = 0; i < count - 1; ++i) {
+            if (scans[i].dropped_read_filter) {
+                rescan = true;
+            }
+        }
+        if (rescan) {
+            for (i = 0; i < count && rc == 0; ++i) {
+                rc = SraStatsScanClear(&scans[i]);
+            }
+            if (rc == 0) {
+                scans[0].start = start;
+                scans[0].stop = stop;
+                rc = SraStatsScanRun(scans, 1, SraStatsScanSpots);
+                SraStatsScanSetRanges(scans, count, start, stop,
+                    &total->bases_count);
+            }
+        }
+    }
+
+    if (rc == 0) {
+        /* merge the scans of spots */
+        bool bad_read_filter = false;
+
+        for (i = 0; i < count; ++i) {
+            if (scans[i].max_nreads > MAX_NREADS) {
+                MAX_NREADS = scans[i].max_nreads;
+            }
+        }
+        g_totalREAD_LEN = calloc(MAX_NREADS, sizeof * g_totalREAD_LEN);
+        g_nonZeroLenReads = calloc(MAX_NREADS, sizeof * g_nonZeroLenReads);
+        if (g_totalREAD_LEN == NULL || g_nonZeroLenReads == NULL) {
+            rc = RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+
+        for (i = 0; i < count && rc == 0; ++i) {
+            SraStatsScan* scan = scans + i;
+            SraStatsMergeData data;
+            size_t j = 0;
+
+            data.tr = tr;
+            data.rc = 0;
+            BSTreeForEach(&scan->tr, false, srastats_merge, &data);
+            rc = data.rc;
+
+            SraStatsTotalMerge(total, &scan->total);
+
+            for (j = 0; j < scan->max_nreads; ++j) {
+                g_totalREAD_LEN[j] += scan->totalREAD_LEN[j];
+                g_nonZeroLenReads[j] += scan->nonZeroLenReads[j];
+            }
+
+            if (scan->hasSPOT_GROUP) {
+                pb->hasSPOT_GROUP = 1;
+            }
+            fixedNReads = fixedNReads && scan->fixedNReads;
+            fixedReadLength = fixedReadLength && scan->fixedReadLength;
+
+            if (!bad_read_filter && scan->bad_read_filter_nreads != 0) {
+                bad_read_filter = true;
+                PLOGMSG(klogWarn, (klogWarn,
+                    "RD_FILTER column size is 1 but it is expected to be $(n)",
+                    "n=%d", scan->bad_read_filter_nreads));
+            }
+            if (scan->dropped_read_filter) {
+                PLOGMSG(klogWarn, (klogWarn,
+                    "RD_FILTER column size is $(real) but it is expected to be $(exp)",
+                    "real=%d,exp=%d", scan->dropped_read_filter_size,
+                    scan->dropped_read_filter_nreads));
+            }
+        }
+    }
+
+    if (rc == 0) {
+        /* BasesAdd() expects the buffers to hold MAX_NREADS reads */
+        for (i = 0; i < count && rc == 0; ++i) {
+            rc = SraStatsScanGrow(&scans[i], MAX_NREADS);
+        }
+    }
+
+    if (rc == 0) {
+        rc = SraStatsScanRun(scans, count, SraStatsScanBases);
+    }
+
+    for (i = 1; i < count && rc == 0; ++i) {
+        BasesMerge(&total->bases_count, &scans[i].own_bases);
+    }
+
+    if (rc == 0) {
+        BasesFinalize(&total->bases_count);
+        pb->variableReadLength = !fixedReadLength;
+
+              /* --- g_totalREAD_LEN[i] is sum(READ_LEN[i]) for all spots --- */
+        if (fixedNReads) {
+            int r = 0;
+            if (stop >= start) {
+                n_spots = stop - start;
+            }
+            if (n_spots > 0) {
+                for (r = 0; r < shared.nreads && rc == 0; ++r) {
+                    if (fixedReadLength) {
+                        assert(g_totalREAD_LEN[r] / n_spots
+                            == g_dREAD_LEN[r]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (shared.pr != NULL) {
+        KLoadProgressbar_Release(shared.pr, true);
+        shared.pr = NULL;
+    }
+
+    if (pb->test && rc == 0) {
+        SraStatsTotalStatistics2Init(total,
+            shared.nreads, g_totalREAD_LEN, g_nonZeroLenReads);
+        for (i = 0; i < count; ++i) {
+            SraStatsTotalStatistics2Init(&scans[i].total,
+                shared.nreads, g_totalREAD_LEN, g_nonZeroLenReads);
+        }
+
+        rc = SraStatsScanRun(scans, count, SraStatsScanTest);
+
+        for (i = 0; i < count && rc == 0; ++i) {
+            uint32_t j = 0;
+            for (j = 0; j < total->nreads; ++j) {
+                Statistics2Merge(total->stats2 + j, scans[i].total.stats2 + j);
+            }
+        }
+    }
+
+    for (i = 0; i < count; ++i) {
+        rc_t rc2 = SraStatsScanRelease(&scans[i]);
+        if (rc == 0) {
+            rc = rc2;
+        }
+    }
+    free ( scans );
+
+    KLockRelease ( shared.lock );
+
+    free ( g_dREAD_LEN );
+    free ( g_totalREAD_LEN );
+    free ( g_nonZeroLenReads );
+
+    return rc;
+}
+
+static
+void CtxRelease(Ctx* ctx)
+{
+    assert(ctx);
+
+    QualityStatsRelease(&ctx->quality);
+    TableCountsRelease(&ctx->tables);
+
+    memset(ctx, 0, sizeof *ctx);
+}
+
+static bool VDatabaseIsSingleTblDb(const VDatabase * self) {
+    bool isSingleTblDb = false;
+
+    uint32_t count = 0;
 
     KNamelist *names = NULL;
     rc_t rc = VDatabaseListTbl(self, &names);
@@ -4744,6 +5287,11 @@ static const char * stop_usage[] = { "Ending spot id, default is max.", NULL };
 static const char * test_usage[] = {
    "Test READ_LEN average and standard deviation calculation.", NULL };
 
+#define ALIAS_THREADS  NULL
+#define OPTION_THREADS "threads"
+static const char * threads_usage[] = {
+   "Scan the table on this many threads, default is 1.", NULL };
+
 #define ALIAS_XML      "x"
 #define OPTION_XML     "xml"
 static const char * xml_usage[] = { "Output as XML, default is text.", NULL };
@@ -4764,6 +5312,7 @@ OptDef Options[] = { /*                            maxCount needValue required*/
     , { OPTION_STATS   , ALIAS_STATS   , NULL, stats_usage   , 1, false, false }
     , { OPTION_STOP    , ALIAS_STOP    , NULL, stop_usage    , 1, true,  false }
     , { OPTION_TEST    , ALIAS_TEST    , NULL, test_usage    , 1, false, false }
+    , { OPTION_THREADS , ALIAS_THREADS , NULL, threads_usage , 1, true,  false }
     , { OPTION_XML     , ALIAS_XML     , NULL, xml_usage     , 1, false, false }
 };
 
@@ -4808,6 +5357,7 @@ rc_t CC Usage (const Args * args)
     HelpOptionLine(ALIAS_ALIGN   , OPTION_ALIGN   , "on | off", align_usage);
     HelpOptionLine(ALIAS_LOCINFO , OPTION_LOCINFO , NULL      , locinfo_usage);
     HelpOptionLine(ALIAS_PROGRESS, OPTION_PROGRESS, NULL      , progress_usage);
+    HelpOptionLine(ALIAS_THREADS , OPTION_THREADS , "count"   , threads_usage);
     HelpOptionLine(ALIAS_NGC     , OPTION_NGC     , "path"    , ngc_usage);
     XMLLogger_Usage();
     HelpOptionLine(ALIAS_REPAIR  , OPTION_REPAIR  , NULL      , repair_usage);
@@ -4876,6 +5426,22 @@ MAIN_DECL( argc, argv )
                 }
 
 
+                rc = ArgsOptionCount (args, OPTION_THREADS, &pcount);
+                if (rc != 0) {
+                    break;
+                }
+
+
+                if (pcount == 1) {
+                    rc = ArgsOptionValue (args, OPTION_THREADS, 0, (const void **)&pc);
+                    if (rc != 0) {
+                        break;
+                    }
+
+                    pb.threads = AsciiToU32 (pc, NULL, NULL);
+                }
+
+
                 rc = ArgsOptionCount (args, OPTION_XML, &pcount);
                 if (rc != 0) {
                     break;
@@ -0,0 +1,746 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "vdb-dump-arrow.h"
+#include "vdb-dump-helper.h"
+
+#include <klib/rc.h>
+#include <klib/log.h>
+#include <klib/num-gen.h>
+
+#include <vdb/cursor.h>
+#include <vdb/blob.h>
+#include <vdb/schema.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+rc_t CC Quitting ( void );
+
+/* a record-batch gets this many rows... */
+#define VDAR_BATCH_ROWS ( 64 * 1024 )
+
+/* ...or less, if the values of one column get bigger than this
+   ( keeps the int32-offsets of utf8- and list-columns far from overflowing ) */
+#define VDAR_BATCH_BYTES ( 128 * 1024 * 1024 )
+
+/* the messages and the buffers in the body of a message start at multiples of this */
+#define VDAR_ALIGN 8
+
+/* values taken from the Arrow format-definitions: Schema.fbs, Message.fbs and File.fbs */
+#define VDAR_METADATA_V5        4
+#define VDAR_TYPE_INT           2
+#define VDAR_TYPE_FLOAT         3
+#define VDAR_TYPE_UTF8          5
+#define VDAR_TYPE_BOOL          6
+#define VDAR_TYPE_LIST          12
+#define VDAR_PRECISION_SINGLE   1
+#define VDAR_PRECISION_DOUBLE   2
+#define VDAR_HEADER_SCHEMA      1
+#define VDAR_HEADER_BATCH       3
+
+static const char vdar_magic[ VDAR_ALIGN ] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+static const uint8_t vdar_zeros[ VDAR_ALIGN ] = { 0 };
+
+/* the structs of the Arrow metadata ( written in host byte-order, which has to be little-endian ) */
+typedef struct vdar_node { int64_t length; int64_t null_count; } vdar_node;
+typedef struct vdar_buffer { int64_t offset; int64_t length; } vdar_buffer;
+typedef struct vdar_block { int64_t offset; int32_t meta_len; int32_t pad; int64_t body_len; } vdar_block;
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct vdar_buf {
+    uint8_t * data;
+    size_t len;
+    size_t size;
+} vdar_buf;
+
+static rc_t vdar_buf_reserve( vdar_buf * self, size_t more ) {
+    if ( self -> len + more > self -> size ) {
+        size_t new_size = ( self -> size > 0 ) ? self -> size * 2 : 4096;
+        uint8_t * tmp;
+        while ( new_size < self -> len + more ) {
+            new_size *= 2;
+        }
+        tmp = realloc( self -> data, new_size );
+        if ( NULL == tmp ) {
+            return RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        }
+        self -> data = tmp;
+        self -> size = new_size;
+    }
+    return 0;
+}
+
+static rc_t vdar_buf_append( vdar_buf * self, const void * src, size_t len ) {
+    rc_t rc = vdar_buf_reserve( self, len );
+    if ( 0 == rc && len > 0 ) {
+        memmove( self -> data + self -> len, src, len );
+        self -> len += len;
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+/* a minimal flatbuffer-builder for the Arrow metadata: the buffer is filled from its
+   end towards its start, objects are referenced by their distance from the end */
+#define VDAR_FB_MAX_FIELDS 8
+
+typedef struct vdar_fb {
+    uint8_t * data;
+    uint32_t size;
+    uint32_t used;
+    uint32_t fields[ VDAR_FB_MAX_FIELDS ];  /* the fields of the table in construction */
+    uint32_t table_start;
+    rc_t rc;
+} vdar_fb;
+
+static void vdar_fb_push( vdar_fb * self, const void * src, uint32_t len ) {
+    if ( 0 == self -> rc && self -> used + len > self -> size ) {
+        uint32_t new_size = ( self -> size > 0 ) ? self -> size * 2 : 1024;
+        uint8_t * tmp;
+        while ( new_size < self -> used + len ) {
+            new_size *= 2;
+        }
+        tmp = malloc( new_size );
+        if ( NULL == tmp ) {
+            self -> rc = RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        } else {
+            if ( self -> used > 0 ) {
+                memmove( tmp + new_size - self -> used, self -> data + self -> size - self -> used, self -> used );
+            }
+            free( self -> data );
+            self -> data = tmp;
+            self -> size = new_size;
+        }
+    }
+    if ( 0 == self -> rc && len > 0 ) {
+        self -> used += len;
+        if ( NULL == src ) {
+            memset( self -> data + self -> size - self -> used, 0, len );
+        } else {
+            memmove( self -> data + self -> size - self -> used, src, len );
+        }
+    }
+}
+
+/* pads with zeros, so that the buffer is aligned after len more bytes */
+static void vdar_fb_align( vdar_fb * self, uint32_t align, uint32_t len ) {
+    vdar_fb_push( self, NULL, ( align - ( self -> used + len ) % align ) % align );
+}
+
+static uint32_t vdar_fb_scalar( vdar_fb * self, const void * value, uint32_t len ) {
+    vdar_fb_align( self, len, 0 );
+    vdar_fb_push( self, value, len );
+    return self -> used;
+}
+
+static uint32_t vdar_fb_offset( vdar_fb * self, uint32_t ref ) {
+    uint32_t value;
+    vdar_fb_align( self, 4, 0 );
+    value = self -> used + 4 - ref;
+    vdar_fb_push( self, &value, 4 );
+    return self -> used;
+}
+
+static uint32_t vdar_fb_string( vdar_fb * self, const char * s ) {
+    uint32_t len = ( uint32_t )strlen( s );
+    vdar_fb_align( self, 4, len + 1 );
+    vdar_fb_push( self, NULL, 1 );
+    vdar_fb_push( self, s, len );
+    vdar_fb_push( self, &len, 4 );
+    return self -> used;
+}
+
+/* all the structs in the Arrow metadata contain int64-members */
+static uint32_t vdar_fb_struct_vector( vdar_fb * self, const void * src, uint32_t count, uint32_t elem_size ) {
+    vdar_fb_align( self, 8, count * elem_size );
+    vdar_fb_push( self, src, count * elem_size );
+    vdar_fb_push( self, &count, 4 );
+    return self -> used;
+}
+
+static uint32_t vdar_fb_offset_vector( vdar_fb * self, const uint32_t * refs, uint32_t count ) {
+    uint32_t idx;
+    vdar_fb_align( self, 4, count * 4 );
+    for ( idx = count; idx > 0; --idx ) {
+        vdar_fb_offset( self, refs[ idx - 1 ] );
+    }
+    vdar_fb_push( self, &count, 4 );
+    return self -> used;
+}
+
+static void vdar_fb_start_table( vdar_fb * self ) {
+    memset( self -> fields, 0, sizeof self -> fields );
+    self -> table_start = self -> used;
+}
+
+static void vdar_fb_field( vdar_fb * self, uint32_t slot, const void * value, uint32_t len ) {
+    self -> fields[ slot ] = vdar_fb_scalar( self, value, len );
+}
+
+static void vdar_fb_field_offset( vdar_fb * self, uint32_t slot, uint32_t ref ) {
+    self -> fields[ slot ] = vdar_fb_offset( self, ref );
+}
+
+static uint32_t vdar_fb_end_table( vdar_fb * self ) {
+    uint16_t vtable[ 2 + VDAR_FB_MAX_FIELDS ];
+    uint32_t idx, slots = 0;
+    int32_t soffset = 0;
+    uint32_t table = vdar_fb_scalar( self, &soffset, 4 );
+    for ( idx = 0; idx < VDAR_FB_MAX_FIELDS; ++idx ) {
+        if ( 0 != self -> fields[ idx ] ) {
+            slots = idx + 1;
+        }
+    }
+    vtable[ 0 ] = ( uint16_t )( ( 2 + slots ) * 2 );
+    vtable[ 1 ] = ( uint16_t )( table - self -> table_start );
+    for ( idx = 0; idx < slots; ++idx ) {
+        vtable[ 2 + idx ] = ( uint16_t )( ( 0 != self -> fields[ idx ] ) ? table - self -> fields[ idx ] : 0 );
+    }
+    vdar_fb_push( self, vtable, vtable[ 0 ] );
+    if ( 0 == self -> rc ) {
+        /* the table starts with the distance to its vtable in front of it */
+        soffset = ( int32_t )( self -> used - table );
+        memmove( self -> data + self -> size - table, &soffset, 4 );
+    }
+    return table;
+}
+
+static void vdar_fb_finish( vdar_fb * self, uint32_t root ) {
+    vdar_fb_align( self, VDAR_ALIGN, 4 );
+    vdar_fb_offset( self, root );
+}
+
+static const uint8_t * vdar_fb_bytes( const vdar_fb * self ) {
+    return self -> data + self -> size - self -> used;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef enum vdar_kind {
+    vdar_scalar,    /* one value per row ( the row-id ) */
+    vdar_utf8,      /* one string per row */
+    vdar_list       /* a list of values per row */
+} vdar_kind;
+
+typedef struct vdar_col {
+    const char * name;
+    uint32_t idx;           /* index of the column in the cursor */
+    vdar_kind kind;
+    uint8_t type;           /* Arrow-type of the values */
+    uint32_t bits;          /* bits per value */
+    bool is_signed;
+    const char * bases;     /* letters for INSDC:2na:bin / INSDC:4na:bin */
+    uint8_t bases_mask;
+    vdar_buf offsets;       /* int32 for every row of the batch + 1 */
+    vdar_buf values;
+    uint64_t value_count;
+    const VBlob * blob;     /* the blob of the last row read */
+    int64_t blob_first;
+    uint64_t blob_count;
+} vdar_col;
+
+typedef struct vdar_writer {
+    const VCursor * curs;
+    vdar_col * cols;
+    uint32_t col_count;
+    uint64_t rows;          /* rows in the record-batch in construction */
+    uint64_t pos;           /* bytes written */
+    vdar_buf blocks;        /* a vdar_block for every record-batch written */
+    vdar_node * nodes;
+    vdar_buffer * buffers;
+    vdar_fb fb;
+} vdar_writer;
+
+static rc_t vdar_col_init( vdar_col * col, const col_def * def, bool translate ) {
+    uint32_t bits = def -> type_desc . intrinsic_bits;
+    bool bytes = ( 8 == bits || 16 == bits || 32 == bits || 64 == bits );
+    col -> name = def -> name;
+    col -> idx = def -> idx;
+    col -> type = 0;
+    col -> bits = bits;
+    switch ( def -> type_desc . domain ) {
+        case vtdAscii   :
+        case vtdUnicode : if ( 8 == bits && 1 == def -> type_desc . intrinsic_dim ) {
+                              col -> kind = vdar_utf8;
+                              col -> type = VDAR_TYPE_UTF8;
+                          }
+                          break;
+
+        case vtdBool    : if ( 8 == bits ) {
+                              col -> kind = vdar_list;
+                              col -> type = VDAR_TYPE_BOOL;
+                          }
+                          break;
+
+        case vtdInt     :
+        case vtdUint    : col -> is_signed = ( vtdInt == def -> type_desc . domain );
+                          if ( translate && NULL != def -> bases &&
+                               8 == bits && 1 == def -> type_desc . intrinsic_dim ) {
+                              col -> kind = vdar_utf8;
+                              col -> type = VDAR_TYPE_UTF8;
+                              col -> bases = def -> bases;
+                              col -> bases_mask = ( uint8_t )( strlen( def -> bases ) - 1 );
+                          } else if ( bytes ) {
+                              col -> kind = vdar_list;
+                              col -> type = VDAR_TYPE_INT;
+                          }
+                          break;
+
+        case vtdFloat   : if ( 32 == bits || 64 == bits ) {
+                              col -> kind = vdar_list;
+                              col -> type = VDAR_TYPE_FLOAT;
+                          }
+                          break;
+    }
+    if ( 0 == col -> type ) {
+        ErrMsg( "column '%s' cannot be written as Arrow-column ( %u bits, dim %u ), cast it to a text- or integer-type",
+                def -> name, bits, def -> type_desc . intrinsic_dim );
+        return RC( rcExe, rcColumn, rcReading, rcType, rcUnsupported );
+    }
+    return 0;
+}
+
+static rc_t vdar_col_start_batch( vdar_col * col ) {
+    rc_t rc = 0;
+    col -> offsets . len = 0;
+    col -> values . len = 0;
+    col -> value_count = 0;
+    if ( vdar_scalar != col -> kind ) {
+        int32_t offset = 0;
+        rc = vdar_buf_append( &( col -> offsets ), &offset, sizeof offset );
+    }
+    return rc;
+}
+
+/* bool-cells have one byte per value, Arrow packs them into bits */
+static rc_t vdar_col_append_bools( vdar_col * col, const uint8_t * src, size_t count ) {
+    size_t needed = ( size_t )( ( col -> value_count + count + 7 ) / 8 );
+    rc_t rc = vdar_buf_reserve( &( col -> values ), needed - col -> values . len );
+    if ( 0 == rc ) {
+        size_t idx;
+        for ( idx = 0; idx < count; ++idx ) {
+            uint64_t bit = col -> value_count + idx;
+            if ( 0 == ( bit & 7 ) ) {
+                col -> values . data[ bit >> 3 ] = 0;
+            }
+            if ( 0 != src[ idx ] ) {
+                col -> values . data[ bit >> 3 ] |= ( uint8_t )( 1 << ( bit & 7 ) );
+            }
+        }
+        col -> values . len = needed;
+        col -> value_count += count;
+    }
+    return rc;
+}
+
+static rc_t vdar_col_append_bases( vdar_col * col, const uint8_t * src, size_t count ) {
+    rc_t rc = vdar_buf_reserve( &( col -> values ), count );
+    if ( 0 == rc ) {
+        uint8_t * dst = col -> values . data + col -> values . len;
+        size_t idx;
+        for ( idx = 0; idx < count; ++idx ) {
+            dst[ idx ] = col -> bases[ src[ idx ] & col -> bases_mask ];
+        }
+        col -> values . len += count;
+        col -> value_count += count;
+    }
+    return rc;
+}
+
+/* the blob of the column is kept until a row outside of it is requested */
+static rc_t vdar_col_append( vdar_col * col, const VCursor * curs, int64_t row_id ) {
+    rc_t rc = 0;
+    uint32_t elem_bits, boff, row_len;
+    const void * base;
+    if ( NULL == col -> blob || row_id < col -> blob_first ||
+         row_id >= col -> blob_first + ( int64_t )col -> blob_count ) {
+        if ( NULL != col -> blob ) {
+            VBlobRelease( col -> blob );
+            col -> blob = NULL;
+        }
+        rc = VCursorGetBlobDirect( curs, &( col -> blob ), row_id, col -> idx );
+        DISP_RC( rc, "vdar_col_append().VCursorGetBlobDirect() failed" );
+        if ( 0 == rc ) {
+            rc = VBlobIdRange( col -> blob, &( col -> blob_first ), &( col -> blob_count ) );
+            DISP_RC( rc, "vdar_col_append().VBlobIdRange() failed" );
+        }
+    }
+    if ( 0 == rc ) {
+        rc = VBlobCellData( col -> blob, row_id, &elem_bits, &base, &boff, &row_len );
+        DISP_RC( rc, "vdar_col_append().VBlobCellData() failed" );
+    }
+    if ( 0 == rc ) {
+        /* vdar_col_init() accepts only types made of whole bytes */
+        size_t bytes = ( ( size_t )elem_bits * row_len ) >> 3;
+        if ( VDAR_TYPE_BOOL == col -> type ) {
+            rc = vdar_col_append_bools( col, base, bytes );
+        } else if ( NULL != col -> bases ) {
+            rc = vdar_col_append_bases( col, base, bytes );
+        } else {
+            rc = vdar_buf_append( &( col -> values ), base, bytes );
+            col -> value_count += ( vdar_utf8 == col -> kind ) ? bytes : bytes / ( col -> bits >> 3 );
+        }
+    }
+    if ( 0 == rc ) {
+        int32_t offset = ( int32_t )col -> value_count;
+        rc = vdar_buf_append( &( col -> offsets ), &offset, sizeof offset );
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static rc_t vdar_write( vdar_writer * self, const void * src, size_t len ) {
+    rc_t rc = vdh_write_out( src, len );
+    DISP_RC( rc, "vdar_write().vdh_write_out() failed" );
+    if ( 0 == rc ) {
+        self -> pos += len;
+    }
+    return rc;
+}
+
+static rc_t vdar_write_padded( vdar_writer * self, const void * src, size_t len ) {
+    rc_t rc = vdar_write( self, src, len );
+    if ( 0 == rc && 0 != ( len % VDAR_ALIGN ) ) {
+        rc = vdar_write( self, vdar_zeros, VDAR_ALIGN - ( len % VDAR_ALIGN ) );
+    }
+    return rc;
+}
+
+/* writes the finished flatbuffer as an encapsulated message: marker, length, metadata */
+static rc_t vdar_write_metadata( vdar_writer * self, vdar_block * block ) {
+    rc_t rc = self -> fb . rc;
+    DISP_RC( rc, "vdar_write_metadata() failed" );
+    if ( 0 == rc ) {
+        uint32_t prefix[ 2 ];
+        prefix[ 0 ] = 0xFFFFFFFF;
+        prefix[ 1 ] = self -> fb . used;
+        block -> offset = ( int64_t )self -> pos;
+        block -> meta_len = ( int32_t )( sizeof prefix + self -> fb . used );
+        block -> pad = 0;
+        rc = vdar_write( self, prefix, sizeof prefix );
+        if ( 0 == rc ) {
+            rc = vdar_write( self, vdar_fb_bytes( &( self -> fb ) ), self -> fb . used );
+        }
+    }
+    self -> fb . used = 0;
+    return rc;
+}
+
+static uint32_t vdar_fb_type( vdar_fb * fb, uint8_t type, uint32_t bits, bool is_signed ) {
+    vdar_fb_start_table( fb );
+    if ( VDAR_TYPE_INT == type ) {
+        int32_t bit_width = ( int32_t )bits;
+        uint8_t sign = is_signed ? 1 : 0;
+        vdar_fb_field( fb, 0, &bit_width, sizeof bit_width );
+        vdar_fb_field( fb, 1, &sign, sizeof sign );
+    } else if ( VDAR_TYPE_FLOAT == type ) {
+        int16_t precision = ( 64 == bits ) ? VDAR_PRECISION_DOUBLE : VDAR_PRECISION_SINGLE;
+        vdar_fb_field( fb, 0, &precision, sizeof precision );
+    }
+    return vdar_fb_end_table( fb );
+}
+
+static uint32_t vdar_fb_field_def( vdar_fb * fb, const char * name, uint8_t type, uint32_t type_ref,
+                                   const uint32_t * children, uint32_t child_count ) {
+    uint32_t name_ref = vdar_fb_string( fb, name );
+    uint32_t children_ref = vdar_fb_offset_vector( fb, children, child_count );
+    uint8_t nullable = 0;
+    vdar_fb_start_table( fb );
+    vdar_fb_field_offset( fb, 0, name_ref );
+    vdar_fb_field( fb, 1, &nullable, sizeof nullable );
+    vdar_fb_field( fb, 2, &type, sizeof type );
+    vdar_fb_field_offset( fb, 3, type_ref );
+    vdar_fb_field_offset( fb, 5, children_ref );
+    return vdar_fb_end_table( fb );
+}
+
+/* a list-column is a List-field with the values as child-field */
+static uint32_t vdar_fb_column( vdar_fb * fb, const vdar_col * col ) {
+    uint32_t type_ref = vdar_fb_type( fb, col -> type, col -> bits, col -> is_signed );
+    if ( vdar_list == col -> kind ) {
+        uint32_t child = vdar_fb_field_def( fb, "item", col -> type, type_ref, NULL, 0 );
+        type_ref = vdar_fb_type( fb, VDAR_TYPE_LIST, 0, false );
+        return vdar_fb_field_def( fb, col -> name, VDAR_TYPE_LIST, type_ref, &child, 1 );
+    }
+    return vdar_fb_field_def( fb, col -> name, col -> type, type_ref, NULL, 0 );
+}
+
+static uint32_t vdar_fb_schema( vdar_writer * self ) {
+    vdar_fb * fb = &( self -> fb );
+    uint32_t fields_ref = 0;
+    uint32_t * fields = calloc( self -> col_count, sizeof fields[ 0 ] );
+    if ( NULL == fields ) {
+        fb -> rc = RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    } else {
+        uint32_t idx;
+        for ( idx = 0; idx < self -> col_count; ++idx ) {
+            fields[ idx ] = vdar_fb_column( fb, &( self -> cols[ idx ] ) );
+        }
+        fields_ref = vdar_fb_offset_vector( fb, fields, self -> col_count );
+        free( fields );
+    }
+    vdar_fb_start_table( fb );
+    vdar_fb_field_offset( fb, 1, fields_ref );
+    return vdar_fb_end_table( fb );
+}
+
+static uint32_t vdar_fb_message( vdar_fb * fb, uint8_t header_type, uint32_t header, int64_t body_len ) {
+    int16_t version = VDAR_METADATA_V5;
+    vdar_fb_start_table( fb );
+    vdar_fb_field( fb, 3, &body_len, sizeof body_len );
+    vdar_fb_field( fb, 0, &version, sizeof version );
+    vdar_fb_field( fb, 1, &header_type, sizeof header_type );
+    vdar_fb_field_offset( fb, 2, header );
+    return vdar_fb_end_table( fb );
+}
+
+/* the file starts with the magic and the schema as the first message */
+static rc_t vdar_write_header( vdar_writer * self ) {
+    rc_t rc = vdar_write( self, vdar_magic, sizeof vdar_magic );
+    if ( 0 == rc ) {
+        vdar_block block;
+        uint32_t schema = vdar_fb_schema( self );
+        vdar_fb_finish( &( self -> fb ), vdar_fb_message( &( self -> fb ), VDAR_HEADER_SCHEMA, schema, 0 ) );
+        rc = vdar_write_metadata( self, &block );
+    }
+    return rc;
+}
+
+/* every field has a node, the buffers of a field follow the Arrow layout of its type */
+static rc_t vdar_write_batch( vdar_writer * self ) {
+    vdar_block block;
+    uint32_t idx, node_count = 0, buffer_count = 0;
+    int64_t body_len = 0;
+    rc_t rc = 0;
+
+#define VDAR_ADD_BUFFER( n ) \
+    self -> buffers[ buffer_count ] . offset = body_len; \
+    self -> buffers[ buffer_count ] . length = ( int64_t )( n ); \
+    body_len += ( ( int64_t )( n ) + VDAR_ALIGN - 1 ) & ~( ( int64_t )VDAR_ALIGN - 1 ); \
+    buffer_count++
+
+    for ( idx = 0; idx < self -> col_count; ++idx ) {
+        const vdar_col * col = &( self -> cols[ idx ] );
+        self -> nodes[ node_count ] . length = ( int64_t )self -> rows;
+        self -> nodes[ node_count++ ] . null_count = 0;
+        VDAR_ADD_BUFFER( 0 );   /* no validity-bitmap: nothing is null */
+        if ( vdar_scalar != col -> kind ) {
+            VDAR_ADD_BUFFER( col -> offsets . len );
+        }
+        if ( vdar_list == col -> kind ) {
+            self -> nodes[ node_count ] . length = ( int64_t )col -> value_count;
+            self -> nodes[ node_count++ ] . null_count = 0;
+            VDAR_ADD_BUFFER( 0 );
+        }
+        VDAR_ADD_BUFFER( col -> values . len );
+    }
+#undef VDAR_ADD_BUFFER
+
+    {
+        vdar_fb * fb = &( self -> fb );
+        uint32_t nodes_ref = vdar_fb_struct_vector( fb, self -> nodes, node_count, sizeof self -> nodes[ 0 ] );
+        uint32_t buffers_ref = vdar_fb_struct_vector( fb, self -> buffers, buffer_count, sizeof self -> buffers[ 0 ] );
+        int64_t length = ( int64_t )self -> rows;
+        vdar_fb_start_table( fb );
+        vdar_fb_field( fb, 0, &length, sizeof length );
+        vdar_fb_field_offset( fb, 1, nodes_ref );
+        vdar_fb_field_offset( fb, 2, buffers_ref );
+        vdar_fb_finish( fb, vdar_fb_message( fb, VDAR_HEADER_BATCH, vdar_fb_end_table( fb ), body_len ) );
+    }
+    rc = vdar_write_metadata( self, &block );
+    for ( idx = 0; 0 == rc && idx < self -> col_count; ++idx ) {
+        vdar_col * col = &( self -> cols[ idx ] );
+        if ( vdar_scalar != col -> kind ) {
+            rc = vdar_write_padded( self, col -> offsets . data, col -> offsets . len );
+        }
+        if ( 0 == rc ) {
+            rc = vdar_write_padded( self, col -> values . data, col -> values . len );
+        }
+        if ( 0 == rc ) {
+            rc = vdar_col_start_batch( col );
+        }
+    }
+    if ( 0 == rc ) {
+        block . body_len = body_len;
+        rc = vdar_buf_append( &( self -> blocks ), &block, sizeof block );
+        self -> rows = 0;
+    }
+    return rc;
+}
+
+/* the end-of-stream marker, the footer with the schema and the record-batches, the magic */
+static rc_t vdar_write_footer( vdar_writer * self ) {
+    static const uint32_t eos[ 2 ] = { 0xFFFFFFFF, 0 };
+    rc_t rc = vdar_write( self, eos, sizeof eos );
+    if ( 0 == rc ) {
+        vdar_fb * fb = &( self -> fb );
+        uint32_t schema = vdar_fb_schema( self );
+        uint32_t dicts = vdar_fb_struct_vector( fb, NULL, 0, sizeof( vdar_block ) );
+        uint32_t batches = vdar_fb_struct_vector( fb, self -> blocks . data,
+                                ( uint32_t )( self -> blocks . len / sizeof( vdar_block ) ), sizeof( vdar_block ) );
+        int16_t version = VDAR_METADATA_V5;
+        vdar_fb_start_table( fb );
+        vdar_fb_field( fb, 0, &version, sizeof version );
+        vdar_fb_field_offset( fb, 1, schema );
+        vdar_fb_field_offset( fb, 2, dicts );
+        vdar_fb_field_offset( fb, 3, batches );
+        vdar_fb_finish( fb, vdar_fb_end_table( fb ) );
+        rc = fb -> rc;
+        DISP_RC( rc, "vdar_write_footer() failed" );
+        if ( 0 == rc ) {
+            int32_t footer_len = ( int32_t )fb -> used;
+            rc = vdar_write( self, vdar_fb_bytes( fb ), fb -> used );
+            if ( 0 == rc ) {
+                rc = vdar_write( self, &footer_len, sizeof footer_len );
+            }
+            if ( 0 == rc ) {
+                rc = vdar_write( self, vdar_magic, 6 );
+            }
+        }
+    }
+    return rc;
+}
+
+static rc_t vdar_append_row( vdar_writer * self, int64_t row_id ) {
+    rc_t rc = 0;
+    uint32_t idx;
+    for ( idx = 0; 0 == rc && idx < self -> col_count; ++idx ) {
+        vdar_col * col = &( self -> cols[ idx ] );
+        if ( vdar_scalar == col -> kind ) {
+            rc = vdar_buf_append( &( col -> values ), &row_id, sizeof row_id );
+            col -> value_count++;
+        } else {
+            rc = vdar_col_append( col, self -> curs, row_id );
+        }
+    }
+    if ( 0 == rc ) {
+        self -> rows++;
+    }
+    return rc;
+}
+
+static bool vdar_batch_full( const vdar_writer * self ) {
+    bool res = ( self -> rows >= VDAR_BATCH_ROWS );
+    uint32_t idx;
+    for ( idx = 0; !res && idx < self -> col_count; ++idx ) {
+        res = ( self -> cols[ idx ] . values . len >= VDAR_BATCH_BYTES );
+    }
+    return res;
+}
+
+static rc_t vdar_make_cols( vdar_writer * self, const p_dump_context ctx, const col_defs * defs ) {
+    rc_t rc = 0;
+    uint32_t idx, count = VectorLength( &( defs -> cols ) );
+    self -> cols = calloc( count + 1, sizeof self -> cols[ 0 ] );
+    self -> nodes = calloc( 2 * ( count + 1 ), sizeof self -> nodes[ 0 ] );
+    self -> buffers = calloc( 4 * ( count + 1 ), sizeof self -> buffers[ 0 ] );
+    if ( NULL == self -> cols || NULL == self -> nodes || NULL == self -> buffers ) {
+        rc = RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    } else if ( ctx -> print_row_id ) {
+        vdar_col * col = &( self -> cols[ self -> col_count++ ] );
+        col -> name = "ROW_ID";
+        col -> kind = vdar_scalar;
+        col -> type = VDAR_TYPE_INT;
+        col -> bits = 64;
+        col -> is_signed = true;
+    }
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        const col_def * def = VectorGet( &( defs -> cols ), idx );
+        if ( NULL != def && def -> valid && !def -> excluded ) {
+            rc = vdar_col_init( &( self -> cols[ self -> col_count++ ] ), def, !ctx -> without_sra_types );
+        }
+    }
+    for ( idx = 0; 0 == rc && idx < self -> col_count; ++idx ) {
+        rc = vdar_col_start_batch( &( self -> cols[ idx ] ) );
+    }
+    return rc;
+}
+
+static void vdar_release( vdar_writer * self ) {
+    if ( NULL != self -> cols ) {
+        uint32_t idx;
+        for ( idx = 0; idx < self -> col_count; ++idx ) {
+            vdar_col * col = &( self -> cols[ idx ] );
+            if ( NULL != col -> blob ) {
+                VBlobRelease( col -> blob );
+            }
+            free( col -> offsets . data );
+            free( col -> values . data );
+        }
+        free( self -> cols );
+    }
+    free( self -> nodes );
+    free( self -> buffers );
+    free( self -> blocks . data );
+    free( self -> fb . data );
+}
+
+rc_t vdar_dump_rows( const p_dump_context ctx, const col_defs * defs, const VCursor * curs ) {
+    rc_t rc;
+    vdar_writer w;
+    if ( NULL == ctx || NULL == defs || NULL == curs ) {
+        return RC( rcVDB, rcNoTarg, rcReading, rcParam, rcNull );
+    }
+    memset( &w, 0, sizeof w );
+    w . curs = curs;
+    rc = vdar_make_cols( &w, ctx, defs );
+    if ( 0 == rc ) {
+        rc = vdar_write_header( &w );
+    }
+    if ( 0 == rc ) {
+        const struct num_gen_iter * iter;
+        rc = num_gen_iterator_make( ctx -> rows, &iter );
+        DISP_RC( rc, "vdar_dump_rows().num_gen_iterator_make() failed" );
+        if ( 0 == rc ) {
+            int64_t row_id;
+            while ( 0 == rc && num_gen_iterator_next( iter, &row_id, &rc ) ) {
+                if ( 0 == rc ) {
+                    rc = Quitting();
+                }
+                if ( 0 == rc ) {
+                    rc = vdar_append_row( &w, row_id );
+                }
+                if ( 0 == rc && vdar_batch_full( &w ) ) {
+                    rc = vdar_write_batch( &w );
+                }
+            }
+            num_gen_iterator_destroy( iter );
+        }
+        if ( 0 == rc && w . rows > 0 ) {
+            rc = vdar_write_batch( &w );
+        }
+        if ( 0 == rc ) {
+            rc = vdar_write_footer( &w );
+        }
+    }
+    vdar_release( &w );
+    return rc;
+}
@@ -0,0 +1,58 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#ifndef _h_vdb_dump_arrow_
+#define _h_vdb_dump_arrow_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+#include "vdb-dump-context.h"
+#include "vdb-dump-coldefs.h"
+
+/*************************************************************************************
+    writes the rows of ctx -> rows as an Arrow IPC file to KOut, column by column:
+        text-columns and INSDC:2na:bin / INSDC:4na:bin ... utf8, one string per row
+        integer-, float- and bool-columns .............. a list of values per row
+        ROW_ID ( if ctx -> print_row_id ) .............. int64, one per row
+
+    the columns of col_defs have to be added to the open cursor, the cells are taken
+    from the blobs of the cursor ( VCursorGetBlobDirect ) and collected into
+    record-batches, a reader can memory-map the file and use the buffers in place
+*************************************************************************************/
+rc_t vdar_dump_rows( const p_dump_context ctx, const col_defs * defs, const VCursor * curs );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -242,6 +242,21 @@ static size_t vdcd_get_dim_trans_size( const VSchema *my_schema, VTypedecl * typ
     return res;
 }
 
+/* hardcoded values taken from ncbi-vdb/interfaces/insdc/insdc.vschema */
+#define INSDC_2NA_BIN "INSDC:2na:bin"
+#define INSDC_4NA_BIN "INSDC:4na:bin"
+
+static const char * vdcd_get_bases( const VSchema *my_schema, VTypedecl * typedecl ) {
+    const char * res = NULL;
+    if ( NULL == my_schema || NULL == typedecl ) { return res; }
+    if ( vdcd_type_cmp( my_schema, typedecl, INSDC_2NA_BIN ) ) {
+        res = "ACGT";
+    } else if ( vdcd_type_cmp( my_schema, typedecl, INSDC_4NA_BIN ) ) {
+        res = "-ACMGRSVTWYHKDBN";
+    }
+    return res;
+}
+
 const char * const_s_Ascii = "Ascii";
 const char * const_s_Unicode = "Unicode";
 const char * const_s_Uint = "Uint";
@@ -313,6 +328,55 @@ void vdcd_destroy( col_defs* defs ) {
     }
 }
 
+/* a copy of the column-definitions for a worker-thread: same columns, own content */
+bool vdcd_copy( col_defs** dst, const col_defs* src ) {
+    bool res = false;
+    if ( NULL != src && vdcd_init( dst, src -> str_limit ) ) {
+        uint32_t idx, count = VectorLength( &( src -> cols ) );
+        res = true;
+        ( *dst ) -> max_colname_chars = src -> max_colname_chars;
+        for ( idx = 0; res && idx < count; ++idx ) {
+            const col_def * src_col = VectorGet( &( src -> cols ), idx );
+            p_col_def col = vdcd_init_col( src_col -> name, src -> str_limit );
+            res = ( NULL != col );
+            if ( res ) {
+                col -> idx = src_col -> idx;
+                col -> valid = src_col -> valid;
+                col -> excluded = src_col -> excluded;
+                col -> type_decl = src_col -> type_decl;
+                col -> type_desc = src_col -> type_desc;
+                col -> value_trans_fn = src_col -> value_trans_fn;
+                col -> dim_trans_fn = src_col -> dim_trans_fn;
+                col -> dim_trans_size = src_col -> dim_trans_size;
+                col -> bases = src_col -> bases;
+                res = ( 0 == VectorAppend( &( ( *dst ) -> cols ), NULL, col ) );
+                if ( !res ) {
+                    vdcd_destroy_col( col );
+                }
+            }
+        }
+        if ( !res ) {
+            vdcd_destroy( *dst );
+            *dst = NULL;
+        }
+    }
+    return res;
+}
+
+/* adds the element-sums of a copy ( made by vdcd_copy ) to the original */
+void vdcd_add_elementsums( col_defs* dst, const col_defs* src ) {
+    if ( NULL != dst && NULL != src ) {
+        uint32_t idx, count = VectorLength( &( dst -> cols ) );
+        for ( idx = 0; idx < count; ++idx ) {
+            p_col_def dst_col = VectorGet( &( dst -> cols ), idx );
+            const col_def * src_col = VectorGet( &( src -> cols ), idx );
+            if ( NULL != dst_col && NULL != src_col ) {
+                dst_col -> elementsum += src_col -> elementsum;
+            }
+        }
+    }
+}
+
 static p_col_def vdcd_append_col( col_defs* defs, const char* name ) {
     p_col_def col = vdcd_init_col( name, defs -> str_limit );
     if ( NULL != col ) {
@@ -673,6 +737,7 @@ static void CC vdcd_ins_1_trans_fkt( void *item, void *data ) {
         col_def -> value_trans_fn = vdcd_get_value_trans_fn( schema, &( col_def -> type_decl ) );
         col_def -> dim_trans_fn = vdcd_get_dim_trans_fn( schema, &( col_def -> type_decl ) );
         col_def -> dim_trans_size = vdcd_get_dim_trans_size( schema, &( col_def -> type_decl ) );
+        col_def -> bases = vdcd_get_bases( schema, &( col_def -> type_decl ) );
     }
 }
 
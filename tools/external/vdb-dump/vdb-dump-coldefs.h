@@ -72,6 +72,7 @@ typedef struct col_def
     value_trans_fn_t value_trans_fn;
     dim_trans_fn_t dim_trans_fn;
     size_t dim_trans_size;
+    const char * bases; /* letters of INSDC:2na:bin / INSDC:4na:bin values, NULL for other types */
 } col_def;
 typedef col_def* p_col_def;
 
@@ -95,6 +96,9 @@ char *vdcd_make_domain_txt( const uint32_t domain );
 bool vdcd_init( col_defs** defs, const size_t str_limit );
 void vdcd_destroy( col_defs* defs );
 
+bool vdcd_copy( col_defs** dst, const col_defs* src );
+void vdcd_add_elementsums( col_defs* dst, const col_defs* src );
+
 uint32_t vdcd_parse_string( col_defs* defs, const char* src, const VTable *tbl, uint32_t * invalid_columns );
 uint32_t vdcd_extract_from_table( col_defs* defs, const VTable *tbl, uint32_t * invalid_columns );
 
@@ -115,6 +115,7 @@ static void vdco_init_values( p_dump_context ctx ) {
     ctx -> max_line_len = 0;
     ctx -> indented_line_len = 0;
     ctx -> slice_depth = 0;
+    ctx -> threads = 1;
 
     ctx -> help_requested = false;
     ctx -> usage_requested = false;
@@ -369,6 +370,8 @@ static bool vdco_set_format( p_dump_context ctx, const char *src ) {
         ctx -> format = df_qual1;
     } else if ( 0 == strcmp( src, "sql" ) ) {
         ctx -> format = df_sql;
+    } else if ( 0 == strcmp( src, "arrow" ) ) {
+        ctx -> format = df_arrow;
     } else {
         ctx -> format = df_default;
     }
@@ -525,6 +528,10 @@ static void vdco_evaluate_options( const Args *args, dump_context *ctx ) {
     ctx -> cell_v1 = vdco_get_bool_option( args, OPTION_CELL_V1, false );
     ctx -> cur_cache_size = vdco_get_size_t_option( args, OPTION_CUR_CACHE, CURSOR_CACHE_SIZE );
     ctx -> output_buffer_size = vdco_get_size_t_option( args, OPTION_OUT_BUF_SIZE, DEF_OPTION_OUT_BUF_SIZE );
+    ctx -> threads = vdco_get_uint16_option( args, OPTION_THREADS, 1 );
+    if ( 0 == ctx -> threads || ctx -> disable_multithreading ) {
+        ctx -> threads = 1;
+    }
     
     if ( vdco_get_bool_option( args, OPTION_GZIP, false ) ) {
         ctx -> compress_mode = orm_gzip;
@@ -27,6 +27,7 @@
 #include "vdb-dump-fastq.h"
 #include "vdb-dump-helper.h"
 #include "vdb-dump-tools.h"
+#include "vdb-dump-row-blocks.h"
 
 #include <stdlib.h>
 
@@ -59,6 +60,9 @@ typedef struct fastq_ctx {
     uint32_t idx_read_start;
     uint32_t idx_read_len;
     uint32_t idx_read_type;
+    uint32_t threads;
+    const struct num_gen * rows;
+    p_dump_str out;         /* NULL: print to stdout, else collect the output of a block of rows */
 } fastq_ctx;
 
 static char * vdb_fastq_extract_run_name( const char * acc_or_path ) {
@@ -84,6 +88,42 @@ static void init_fastq_ctx( const p_dump_context ctx, fastq_ctx * fctx, const ch
     fctx -> idx_read_start  = INVALID_COLUMN;
     fctx -> idx_read_len    = INVALID_COLUMN;
     fctx -> idx_read_type   = INVALID_COLUMN;
+    fctx -> threads  = ctx -> threads;
+    fctx -> rows     = NULL;
+    fctx -> out      = NULL;
+}
+
+/* the fastq-context of a worker-thread: same table and format, but own cursor */
+static void copy_fastq_ctx( const fastq_ctx * src, fastq_ctx * dst ) {
+    dst -> run_name = src -> run_name;
+    dst -> tbl      = src -> tbl;
+    dst -> cursor   = NULL;
+    dst -> row_iter = NULL;
+    dst -> max_line_len = src -> max_line_len;
+    dst -> format   = src -> format;
+    dst -> cur_cache_size = src -> cur_cache_size;
+    dst -> idx_read = INVALID_COLUMN;
+    dst -> idx_qual = INVALID_COLUMN;
+    dst -> idx_name = INVALID_COLUMN;
+    dst -> idx_read_start  = INVALID_COLUMN;
+    dst -> idx_read_len    = INVALID_COLUMN;
+    dst -> idx_read_type   = INVALID_COLUMN;
+    dst -> threads  = 1;
+    dst -> rows     = NULL;
+    dst -> out      = NULL;
+}
+
+static rc_t vdb_fastq_out( const fastq_ctx * fctx, const char * fmt, ... ) {
+    rc_t rc;
+    va_list args;
+    va_start( args, fmt );
+    if ( NULL == fctx -> out ) {
+        rc = KOutVMsg( fmt, args );
+    } else {
+        rc = vds_append_vfmt_no_limit_check( fctx -> out, fmt, args );
+    }
+    va_end( args );
+    return rc;
 }
 
 static void vdb_fastq_row_error( const char * fmt, rc_t rc, int64_t row_id ) {
@@ -251,7 +291,7 @@ static rc_t vdb_fastq1_frag_type_checked( fastq_spot * spot, int64_t row_id, con
         for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot -> num_rd_start; ++idx ) {
             if ( ( READ_TYPE_BIOLOGICAL == ( spot -> rd_type[ idx ] & READ_TYPE_BIOLOGICAL ) ) &&
                  spot -> rd_len[ idx ] > 0 ) {
-                rc = KOutMsg( "@%s.%li.%d %.*s length=%u\n%.*s\n+%s.%li.%d %.*s length=%u\n%.*s\n",
+                rc = vdb_fastq_out( fctx, "@%s.%li.%d %.*s length=%u\n%.*s\n+%s.%li.%d %.*s length=%u\n%.*s\n",
                               fctx -> run_name, row_id, frag, spot -> name_len, spot -> name, spot -> rd_len[ idx ],
                               spot -> rd_len[ idx ], &( spot -> bases[ ofs ] ),
                               fctx -> run_name, row_id, frag, spot -> name_len, spot -> name, spot -> rd_len[ idx ],
@@ -283,7 +323,7 @@ static rc_t vdb_fastq1_frag_not_type_checked( fastq_spot * spot, int64_t row_id,
         uint32_t idx, frag, ofs;
         for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot -> num_rd_start; ++idx ) {
             if ( spot -> rd_len[ idx ] > 0 ) {
-                rc = KOutMsg( "@%s.%li.%d %.*s length=%u\n%.*s\n+%s.%li.%d %.*s length=%u\n%.*s\n",
+                rc = vdb_fastq_out( fctx, "@%s.%li.%d %.*s length=%u\n%.*s\n+%s.%li.%d %.*s length=%u\n%.*s\n",
                               fctx -> run_name, row_id, frag, spot -> name_len, spot -> name, spot -> rd_len[ idx ],
                               spot -> rd_len[ idx ], &( spot -> bases[ ofs ] ),
                               fctx -> run_name, row_id, frag, spot -> name_len, spot -> name, spot -> rd_len[ idx ],
@@ -297,6 +337,82 @@ static rc_t vdb_fastq1_frag_not_type_checked( fastq_spot * spot, int64_t row_id,
     return rc;
 }
 
+/* -------------------------------------------------------------------------------------------------------------- */
+
+/* the records of one row, with one fastq-context per thread ( own cursor and output-string ) */
+typedef rc_t ( * fastq_row_fn )( const fastq_ctx * fctx, int64_t row_id );
+
+typedef struct fastq_worker {
+    fastq_ctx fctx;
+    fastq_row_fn row_fn;
+} fastq_worker;
+
+static rc_t CC vdb_fastq_row_cb( void * worker, int64_t row_id, bool first, bool last, p_dump_str out ) {
+    fastq_worker * w = ( fastq_worker * )worker;
+    w -> fctx . out = out;
+    return w -> row_fn( &( w -> fctx ), row_id );
+}
+
+static rc_t vdb_fastq_rows_threaded( const fastq_ctx * fctx, fastq_row_fn row_fn ) {
+    rc_t rc = 0;
+    uint32_t idx, count = fctx -> threads;
+    fastq_worker * w = calloc( count, sizeof w[ 0 ] );
+    void ** workers = calloc( count, sizeof workers[ 0 ] );
+    if ( NULL == w || NULL == workers ) {
+        rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        count = 0;
+    }
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        copy_fastq_ctx( fctx, &( w[ idx ] . fctx ) );
+        w[ idx ] . row_fn = row_fn;
+        workers[ idx ] = &( w[ idx ] );
+        rc = vdb_prepare_cursor( &( w[ idx ] . fctx ) );
+    }
+    if ( 0 == rc ) {
+        rc = vdrb_dump_rows( fctx -> rows, workers, count, vdb_fastq_row_cb );
+    }
+    for ( idx = 0; idx < count; ++idx ) {
+        if ( NULL != w[ idx ] . fctx . cursor ) {
+            rc = vdh_vcursor_release( rc, w[ idx ] . fctx . cursor );
+        }
+    }
+    free( workers );
+    free( w );
+    return rc;
+}
+
+/* calls row_fn for every row, on worker-threads if requested ( --threads ) */
+static rc_t vdb_fastq_rows( const fastq_ctx * fctx, fastq_row_fn row_fn ) {
+    rc_t rc = 0;
+    if ( fctx -> threads > 1 ) {
+        rc = vdb_fastq_rows_threaded( fctx, row_fn );
+    } else {
+        int64_t row_id;
+        while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
+            if ( 0 == rc ) { rc = Quitting(); }
+            if ( 0 == rc ) {
+                rc = row_fn( fctx, row_id );
+            }
+        }
+    }
+    return rc;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+static rc_t vdb_fastq1_row( const fastq_ctx * fctx, int64_t row_id ) {
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        if ( INVALID_COLUMN != fctx -> idx_read_type ) {
+            rc = vdb_fastq1_frag_type_checked( &spot, row_id, fctx );
+        } else {
+            rc = vdb_fastq1_frag_not_type_checked( &spot, row_id, fctx );
+        }
+    }
+    return rc;
+}
+
 static rc_t vdb_fastq1_loop( const fastq_ctx * fctx ) {
     rc_t rc = 0;
     if ( INVALID_COLUMN == fctx -> idx_read || INVALID_COLUMN == fctx -> idx_name ||
@@ -305,21 +421,27 @@ static rc_t vdb_fastq1_loop( const fastq_ctx * fctx ) {
         rc = RC( rcExe, rcNoTarg, rcConstructing, rcNoObj, rcInvalid );
         DISP_RC( rc, "cannot generate fasta-format, at least one of these columns not found: READ, NAME, QUALITY, READ_START, READ_LEN" );
     } else {
-        bool has_type = ( INVALID_COLUMN != fctx -> idx_read_type );
-        int64_t row_id;
-        while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-            if ( 0 == rc ) { rc = Quitting(); }
-            if ( 0 == rc ) {
-                fastq_spot spot;
-                rc = read_spot( fctx, row_id, &spot );
-                if ( 0 == rc ) {
-                    if ( has_type ) {
-                        rc = vdb_fastq1_frag_type_checked( &spot, row_id, fctx );
-                    } else {
-                        rc = vdb_fastq1_frag_not_type_checked( &spot, row_id, fctx );
-                    }
-                }
-            }
+        rc = vdb_fastq_rows( fctx, vdb_fastq1_row );
+    }
+    return rc;
+}
+
+static rc_t vdb_fastq_row( const fastq_ctx * fctx, int64_t row_id ) {
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( rc == 0 ) {
+        if ( INVALID_COLUMN != fctx -> idx_name ) {
+            rc = vdb_fastq_out( fctx, "@%s.%li %.*s length=%u\n%.*s\n+%s.%li %.*s length=%u\n%.*s\n",
+                        fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_bases,
+                        spot . num_bases, spot . bases,
+                        fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_qual,
+                        spot . num_qual, spot . qual );
+        } else {
+            rc = vdb_fastq_out( fctx, "@%s.%li %li length=%u\n%.*s\n+%s.%li %li length=%u\n%.*s\n",
+                        fctx -> run_name, row_id, row_id, spot . num_bases,
+                        spot . num_bases, spot . bases,
+                        fctx -> run_name, row_id, row_id, spot . num_bases,
+                        spot . num_qual, spot . qual );
         }
     }
     return rc;
@@ -331,40 +453,15 @@ static rc_t vdb_fastq_loop( const fastq_ctx * fctx ) {
         rc = RC( rcExe, rcNoTarg, rcConstructing, rcNoObj, rcInvalid );
         DISP_RC( rc, "cannot generate fasta-format: READ and/or QUALITY column not found" );
     } else {
-        bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-        int64_t row_id;
-        while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-            if ( 0 == rc ) {
-                rc = Quitting();
-            }
-            if ( 0 == rc ) {
-                fastq_spot spot;
-                rc = read_spot( fctx, row_id, &spot );
-                if ( rc == 0 ) {
-                    if ( has_name ) {
-                        rc = KOutMsg( "@%s.%li %.*s length=%u\n%.*s\n+%s.%li %.*s length=%u\n%.*s\n",
-                                    fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_bases,
-                                    spot . num_bases, spot . bases,
-                                    fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_qual,
-                                    spot . num_qual, spot . qual );
-                    } else {
-                        rc = KOutMsg( "@%s.%li %li length=%u\n%.*s\n+%s.%li %li length=%u\n%.*s\n",
-                                    fctx -> run_name, row_id, row_id, spot . num_bases,
-                                    spot . num_bases, spot . bases,
-                                    fctx -> run_name, row_id, row_id, spot . num_bases,
-                                    spot . num_qual, spot . qual );
-                    }
-                }
-            }
-        }
+        rc = vdb_fastq_rows( fctx, vdb_fastq_row );
     }
     return rc;
 }
 
-static rc_t print_bases( const char * bases, uint32_t num_bases, uint32_t max_line_len ) {
+static rc_t print_bases( const fastq_ctx * fctx, const char * bases, uint32_t num_bases, uint32_t max_line_len ) {
     rc_t rc;
     if ( 0 == max_line_len ) {
-        rc = KOutMsg( "%.*s\n", num_bases, bases );
+        rc = vdb_fastq_out( fctx, "%.*s\n", num_bases, bases );
     } else {
         uint32_t idx = 0, to_print = num_bases;
         rc = 0;
@@ -372,7 +469,7 @@ static rc_t print_bases( const char * bases, uint32_t num_bases, uint32_t max_li
             if ( to_print > max_line_len ) {
                 to_print = max_line_len;
             }
-            rc = KOutMsg( "%.*s\n", to_print, &bases[ idx ] );
+            rc = vdb_fastq_out( fctx, "%.*s\n", to_print, &bases[ idx ] );
             if ( 0 == rc ) {
                 idx += to_print;
                 to_print = ( num_bases - idx );
@@ -382,7 +479,7 @@ static rc_t print_bases( const char * bases, uint32_t num_bases, uint32_t max_li
     return rc;
 }
 
-static rc_t print_qual( const char * qual, uint32_t count, uint32_t max_line_len ) {
+static rc_t print_qual( const fastq_ctx * fctx, const char * qual, uint32_t count, uint32_t max_line_len ) {
     rc_t rc = 0;
     uint32_t i = 0, on_line = 0;
     while ( 0 == rc && i < count ) {
@@ -391,113 +488,92 @@ static rc_t print_qual( const char * qual, uint32_t count, uint32_t max_line_len
         rc = string_printf( buffer, sizeof buffer, &num_writ, "%d", qual[ i ] );
         if ( 0 == rc ) {
             if ( 0 == on_line ) {
-                rc = KOutMsg( "%s", buffer );
+                rc = vdb_fastq_out( fctx, "%s", buffer );
                 on_line = ( uint32_t )num_writ;
             } else {
                 if ( ( on_line + num_writ + 1 ) < max_line_len ) {
-                    rc = KOutMsg( " %s", buffer );
+                    rc = vdb_fastq_out( fctx, " %s", buffer );
                     on_line += ( ( uint32_t )num_writ + 1 );
                 } else {
-                    rc = KOutMsg( "\n%s", buffer );
+                    rc = vdb_fastq_out( fctx, "\n%s", buffer );
                     on_line = ( uint32_t )num_writ;
                 }
             }
             i++;
         }
     }
-    rc = KOutMsg( "\n" );
+    rc = vdb_fastq_out( fctx, "\n" );
     return rc;
 }
 
-static rc_t vdb_fasta_frag_type_checked_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_fasta_frag_type_checked_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
-        if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                uint32_t idx, frag, ofs;
-                for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
-                    uint32_t frag_len = spot.rd_len[ idx ];
-                    if ( frag_len > 0 &&
-                         ( ( spot.rd_type[ idx ] & READ_TYPE_BIOLOGICAL ) == READ_TYPE_BIOLOGICAL ) ) {
-                        if ( has_name ) {
-                            rc = KOutMsg( ">%s.%li.%d %.*s length=%u\n",
-                                    fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
-                        } else {
-                            rc = KOutMsg( ">%s.%li.%d %li length=%u\n",
-                                    fctx -> run_name, row_id, frag, row_id, frag_len );
-                        }
-                        if ( 0 == rc ) {
-                            rc = print_bases( &( spot.bases[ ofs ] ), frag_len, fctx -> max_line_len );
-                        }
-                        frag++;
-                    }
-                    ofs += frag_len;
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        uint32_t idx, frag, ofs;
+        for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
+            uint32_t frag_len = spot.rd_len[ idx ];
+            if ( frag_len > 0 &&
+                 ( ( spot.rd_type[ idx ] & READ_TYPE_BIOLOGICAL ) == READ_TYPE_BIOLOGICAL ) ) {
+                if ( has_name ) {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %.*s length=%u\n",
+                            fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
+                } else {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %li length=%u\n",
+                            fctx -> run_name, row_id, frag, row_id, frag_len );
+                }
+                if ( 0 == rc ) {
+                    rc = print_bases( fctx, &( spot.bases[ ofs ] ), frag_len, fctx -> max_line_len );
                 }
+                frag++;
             }
+            ofs += frag_len;
         }
     }
     return rc;
 }
 
-static rc_t vdb_fasta_frag_no_type_check_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_fasta_frag_no_type_check_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
-        if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                uint32_t idx, frag, ofs;
-                for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
-                    uint32_t frag_len = spot.rd_len[ idx ];
-                    if ( frag_len > 0 ) {
-                        if ( has_name ) {
-                            rc = KOutMsg( ">%s.%li.%d %.*s length=%u\n",
-                                    fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
-                        } else {
-                            rc = KOutMsg( ">%s.%li.%d %li length=%u\n",
-                                    fctx -> run_name, row_id, frag, row_id, frag_len );
-                        }
-                        if ( 0 == rc ) {
-                            rc = print_bases( &( spot.bases[ ofs ] ), frag_len, fctx -> max_line_len );
-                        }
-                        frag++;
-                    }
-                    ofs += frag_len;
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        uint32_t idx, frag, ofs;
+        for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
+            uint32_t frag_len = spot.rd_len[ idx ];
+            if ( frag_len > 0 ) {
+                if ( has_name ) {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %.*s length=%u\n",
+                            fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
+                } else {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %li length=%u\n",
+                            fctx -> run_name, row_id, frag, row_id, frag_len );
+                }
+                if ( 0 == rc ) {
+                    rc = print_bases( fctx, &( spot.bases[ ofs ] ), frag_len, fctx -> max_line_len );
                 }
+                frag++;
             }
+            ofs += frag_len;
         }
     }
     return rc;
 }
 
-static rc_t vdb_fasta_spot_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_fasta_spot_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        if ( has_name ) {
+            rc = vdb_fastq_out( fctx, ">%s.%li %.*s length=%u\n",
+                    fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_bases );
+        } else {
+            rc = vdb_fastq_out( fctx, ">%s.%li %li length=%u\n", fctx -> run_name, row_id, row_id, spot . num_bases );
+        }
         if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                if ( has_name ) {
-                    rc = KOutMsg( ">%s.%li %.*s length=%u\n",
-                            fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_bases );
-                } else {
-                    rc = KOutMsg( ">%s.%li %li length=%u\n", fctx -> run_name, row_id, row_id, spot . num_bases );
-                }   
-                if ( 0 == rc ) {
-                    rc = print_bases( spot.bases, spot.num_bases, fctx -> max_line_len );
-                }
-            }
+            rc = print_bases( fctx, spot.bases, spot.num_bases, fctx -> max_line_len );
         }
     }
     return rc;
@@ -514,12 +590,12 @@ static rc_t vdb_fasta_loop( const fastq_ctx * fctx ) {
         if ( can_split ) {
             bool has_type = ( INVALID_COLUMN != fctx -> idx_read_type );
             if ( has_type ) {
-                rc = vdb_fasta_frag_type_checked_loop( fctx );
+                rc = vdb_fastq_rows( fctx, vdb_fasta_frag_type_checked_row );
             } else {
-                rc = vdb_fasta_frag_no_type_check_loop( fctx );
+                rc = vdb_fastq_rows( fctx, vdb_fasta_frag_no_type_check_row );
             }
         } else {
-            rc = vdb_fasta_spot_loop( fctx );
+            rc = vdb_fastq_rows( fctx, vdb_fasta_spot_row );
         }
     }
     return rc;
@@ -527,101 +603,84 @@ static rc_t vdb_fasta_loop( const fastq_ctx * fctx ) {
 
 /* -------------------------------------------------------------------------------------------------------------- */
 
-static rc_t vdb_qual_frag_type_checked_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_qual_frag_type_checked_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
-        if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                uint32_t idx, frag, ofs;
-                for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
-                    uint32_t frag_len = spot.rd_len[ idx ];
-                    if ( frag_len > 0 &&
-                         ( READ_TYPE_BIOLOGICAL == ( spot.rd_type[ idx ] & READ_TYPE_BIOLOGICAL ) ) ) {
-                        if ( has_name ) {
-                            rc = KOutMsg( ">%s.%li.%d %.*s length=%u\n",
-                                    fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
-                        } else {
-                            rc = KOutMsg( ">%s.%li.%d %li length=%u\n",
-                                    fctx -> run_name, row_id, frag, row_id, frag_len );
-                        }
-                        if ( 0 == rc ) {
-                            rc = print_qual( &( spot . qual[ ofs ] ), frag_len, fctx -> max_line_len );
-                        }
-                        frag++;
-                    }
-                    ofs += frag_len;
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        uint32_t idx, frag, ofs;
+        for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
+            uint32_t frag_len = spot.rd_len[ idx ];
+            if ( frag_len > 0 &&
+                 ( READ_TYPE_BIOLOGICAL == ( spot.rd_type[ idx ] & READ_TYPE_BIOLOGICAL ) ) ) {
+                if ( has_name ) {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %.*s length=%u\n",
+                            fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
+                } else {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %li length=%u\n",
+                            fctx -> run_name, row_id, frag, row_id, frag_len );
+                }
+                if ( 0 == rc ) {
+                    rc = print_qual( fctx, &( spot . qual[ ofs ] ), frag_len, fctx -> max_line_len );
                 }
+                frag++;
             }
+            ofs += frag_len;
         }
     }
     return rc;
 }
 
-static rc_t vdb_qual_frag_no_type_check_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_qual_frag_no_type_check_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
-        if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                uint32_t idx, frag, ofs;
-                for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
-                    uint32_t frag_len = spot.rd_len[ idx ];
-                    if ( frag_len > 0 ) {
-                        if ( has_name ) {
-                            rc = KOutMsg( ">%s.%li.%d %.*s length=%u\n",
-                                    fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
-                        } else {
-                            rc = KOutMsg( ">%s.%li.%d %li length=%u\n",
-                                    fctx -> run_name, row_id, frag, row_id, frag_len );
-                        }
-                        if ( 0 == rc ) {
-                            rc = print_qual( &( spot.qual[ ofs ] ), frag_len, fctx -> max_line_len );
-                        }
-                        frag++;
-                    }
-                    ofs += frag_len;
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        uint32_t idx, frag, ofs;
+        for ( idx = 0, frag = 1, ofs = 0; 0 == rc && idx < spot.num_rd_start; ++idx ) {
+            uint32_t frag_len = spot.rd_len[ idx ];
+            if ( frag_len > 0 ) {
+                if ( has_name ) {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %.*s length=%u\n",
+                            fctx -> run_name, row_id, frag, spot . name_len, spot . name, frag_len );
+                } else {
+                    rc = vdb_fastq_out( fctx, ">%s.%li.%d %li length=%u\n",
+                            fctx -> run_name, row_id, frag, row_id, frag_len );
                 }
+                if ( 0 == rc ) {
+                    rc = print_qual( fctx, &( spot.qual[ ofs ] ), frag_len, fctx -> max_line_len );
+                }
+                frag++;
             }
+            ofs += frag_len;
         }
     }
     return rc;
 }
 
-static rc_t vdb_qual_spot_loop( const fastq_ctx * fctx ) {
-    rc_t rc = 0;
+static rc_t vdb_qual_spot_row( const fastq_ctx * fctx, int64_t row_id ) {
     bool has_name = ( INVALID_COLUMN != fctx -> idx_name );
-    int64_t row_id;
-    while ( 0 == rc && num_gen_iterator_next( fctx -> row_iter, &row_id, &rc ) ) {
-        if ( 0 == rc ) { rc = Quitting(); }
+    fastq_spot spot;
+    rc_t rc = read_spot( fctx, row_id, &spot );
+    if ( 0 == rc ) {
+        if ( has_name ) {
+            rc = vdb_fastq_out( fctx, ">%s.%li %.*s length=%u\n",
+                    fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_qual );
+        } else {
+            rc = vdb_fastq_out( fctx, ">%s.%li %li length=%u\n",
+                    fctx -> run_name, row_id, row_id, spot . num_qual );
+        }
         if ( 0 == rc ) {
-            fastq_spot spot;
-            rc = read_spot( fctx, row_id, &spot );
-            if ( 0 == rc ) {
-                if ( has_name ) {
-                    rc = KOutMsg( ">%s.%li %.*s length=%u\n",
-                            fctx -> run_name, row_id, spot . name_len, spot . name, spot . num_qual );
-                } else {
-                    rc = KOutMsg( ">%s.%li %li length=%u\n",
-                            fctx -> run_name, row_id, row_id, spot . num_qual );
-                }   
-                if ( 0 == rc ) {
-                    rc = print_qual( spot.qual, spot.num_qual, fctx -> max_line_len );
-                }
-            }
+            rc = print_qual( fctx, spot.qual, spot.num_qual, fctx -> max_line_len );
         }
     }
     return rc;
 }
 
+static rc_t vdb_qual_spot_loop( const fastq_ctx * fctx ) {
+    return vdb_fastq_rows( fctx, vdb_qual_spot_row );
+}
+
 static rc_t vdb_qual_loop( const fastq_ctx * fctx ) {
     rc_t rc = 0;
     if ( INVALID_COLUMN == fctx -> idx_qual ) {
@@ -633,12 +692,12 @@ static rc_t vdb_qual_loop( const fastq_ctx * fctx ) {
         if ( can_split ) {
             bool has_type = ( INVALID_COLUMN != fctx -> idx_read_type );
             if ( has_type ) {
-                rc = vdb_qual_frag_type_checked_loop( fctx );
+                rc = vdb_fastq_rows( fctx, vdb_qual_frag_type_checked_row );
             } else {
-                rc = vdb_qual_frag_no_type_check_loop( fctx );
+                rc = vdb_fastq_rows( fctx, vdb_qual_frag_no_type_check_row );
             }
         } else {
-            rc = vdb_qual_spot_loop( fctx );
+            rc = vdb_fastq_rows( fctx, vdb_qual_spot_row );
         }
     }
     return rc;
@@ -768,6 +827,7 @@ static rc_t vdb_fastq_tbl( const p_dump_context ctx, fastq_ctx * fctx ) {
                     DISP_RC( rc, "num_gen_trim() failed" );
                 }
                 if ( 0 == rc && !num_gen_empty( ctx -> rows ) ) {
+                    fctx -> rows = ctx -> rows;
                     rc = num_gen_iterator_make( ctx -> rows, &fctx -> row_iter );
                     DISP_RC( rc, "num_gen_iterator_make() failed" );
                     if ( 0 == rc ) {
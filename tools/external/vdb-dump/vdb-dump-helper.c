@@ -25,6 +25,7 @@
 */
 
 #include <klib/printf.h>
+#include <klib/out.h>
 #include <kfs/cacheteefile.h>
 #include <sra/sraschema.h>
 #include <vfs/resolver.h>
@@ -596,6 +597,24 @@ rc_t vdh_open_vpath_as_file( const KDirectory * dir, const VPath * vpath, const
     return rc;
 }
 
+/* writes unformatted bytes to where KOut writes to ( stdout or the redirected output-file ) */
+rc_t vdh_write_out( const void * src, size_t len ) {
+    rc_t rc = 0;
+    KWrtWriter writer = KOutWriterGet();
+    void * data = KOutDataGet();
+    size_t total = 0;
+    if ( NULL == writer ) { return rc; }
+    while ( 0 == rc && total < len ) {
+        size_t num_writ = 0;
+        rc = writer( data, ( const char * )src + total, len - total, &num_writ );
+        if ( 0 == rc && 0 == num_writ ) {
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcTransfer, rcIncomplete );
+        }
+        total += num_writ;
+    }
+    return rc;
+}
+
 rc_t vdh_vfsmanager_release( rc_t rc, const VFSManager * mgr ) {
     if ( NULL != mgr ) {
         rc_t rc2 = VFSManagerRelease( mgr );
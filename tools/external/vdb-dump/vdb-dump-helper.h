@@ -148,6 +148,8 @@ rc_t vdh_check_table_empty( const VTable * tab );
 rc_t vdh_open_table_by_path( const VDatabase * db, const char * inner_db_path, const VTable ** tab );
 
 rc_t vdh_open_vpath_as_file( const KDirectory * dir, const VPath * vpath, const KFile ** f );
+
+rc_t vdh_write_out( const void * src, size_t len );
     
 rc_t vdh_vfsmanager_release( rc_t rc, const VFSManager * mgr );
 rc_t vdh_vpath_release( rc_t rc, const VPath * path );
@@ -0,0 +1,295 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "vdb-dump-row-blocks.h"
+#include "vdb-dump-helper.h"
+
+#include <klib/rc.h>
+#include <klib/log.h>
+#include <klib/num-gen.h>
+
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+rc_t CC Quitting ( void );
+
+/* the number of row-id's in a block */
+#define VDRB_BLOCK_ROWS 1024
+
+/* every worker can be one block ahead of the writer */
+#define VDRB_SLOTS_PER_WORKER 2
+
+typedef enum vdrb_state { vdrb_free, vdrb_filling, vdrb_done } vdrb_state;
+
+typedef struct vdrb_block
+{
+    int64_t ids[ VDRB_BLOCK_ROWS ];
+    uint32_t count;         /* number of row-id's in ids */
+    uint64_t first_nr;      /* position of ids[ 0 ] in the row-set */
+    uint64_t seq;           /* position of the block in the output */
+    dump_str out;           /* the formated rows */
+    rc_t rc;
+    vdrb_state state;
+} vdrb_block;
+
+typedef struct vdrb_shared
+{
+    KLock * lock;
+    KCondition * changed;   /* a block was handed out, dumped or written */
+    const struct num_gen_iter * iter;
+    uint64_t row_count;     /* number of rows in the row-set */
+    uint64_t next_nr;       /* rows taken from the iterator so far */
+    uint64_t next_seq;      /* the next block to hand out */
+    uint64_t write_seq;     /* the next block to write */
+    vdrb_block * blocks;
+    uint32_t block_count;
+    vdrb_row_fn row_fn;
+    bool eof;               /* the iterator is exhausted */
+    bool quit;              /* the writer has stopped */
+} vdrb_shared;
+
+typedef struct vdrb_worker
+{
+    vdrb_shared * shared;
+    void * worker;
+} vdrb_worker;
+
+/* called with the lock held: takes the next row-id's from the iterator */
+static void vdrb_fill_block( vdrb_shared * self, vdrb_block * block )
+{
+    rc_t rc = 0;
+    block -> seq = self -> next_seq++;
+    block -> first_nr = self -> next_nr;
+    block -> count = 0;
+    block -> rc = 0;
+    block -> state = vdrb_filling;
+    while ( block -> count < VDRB_BLOCK_ROWS &&
+            num_gen_iterator_next( self -> iter, &( block -> ids[ block -> count ] ), &rc ) )
+    {
+        if ( 0 != rc ) break;
+        block -> count++;
+    }
+    if ( 0 != rc )
+    {
+        block -> rc = rc;
+        self -> eof = true;
+    }
+    else if ( block -> count < VDRB_BLOCK_ROWS )
+    {
+        self -> eof = true;
+    }
+    self -> next_nr += block -> count;
+}
+
+static rc_t vdrb_dump_block( const vdrb_worker * w, vdrb_block * block )
+{
+    rc_t rc = vds_clear( &( block -> out ) );
+    uint32_t idx;
+    uint64_t last_nr = w -> shared -> row_count - 1;
+    for ( idx = 0; 0 == rc && idx < block -> count; ++idx )
+    {
+        uint64_t nr = block -> first_nr + idx;
+        rc = Quitting();
+        if ( 0 == rc )
+        {
+            rc = w -> shared -> row_fn( w -> worker, block -> ids[ idx ],
+                                        ( 0 == nr ), ( nr >= last_nr ), &( block -> out ) );
+        }
+    }
+    return rc;
+}
+
+static rc_t CC vdrb_worker_thread( const KThread * self, void * data )
+{
+    const vdrb_worker * w = data;
+    vdrb_shared * shared = w -> shared;
+    rc_t rc = KLockAcquire( shared -> lock );
+    while ( 0 == rc )
+    {
+        vdrb_block * block = &( shared -> blocks[ shared -> next_seq % shared -> block_count ] );
+        while ( 0 == rc && !shared -> quit && !shared -> eof && vdrb_free != block -> state )
+        {
+            rc = KConditionWait( shared -> changed, shared -> lock );
+            block = &( shared -> blocks[ shared -> next_seq % shared -> block_count ] );
+        }
+        if ( 0 != rc || shared -> quit || shared -> eof ) break;
+
+        vdrb_fill_block( shared, block );
+        KLockUnlock( shared -> lock );
+
+        if ( 0 == block -> rc )
+        {
+            block -> rc = vdrb_dump_block( w, block );
+        }
+
+        rc = KLockAcquire( shared -> lock );
+        block -> state = vdrb_done;
+        KConditionBroadcast( shared -> changed );
+    }
+    if ( 0 == rc )
+    {
+        KLockUnlock( shared -> lock );
+    }
+    return rc;
+}
+
+/* the calling thread writes the blocks in the order they were handed out */
+static rc_t vdrb_write_blocks( vdrb_shared * shared )
+{
+    rc_t rc = KLockAcquire( shared -> lock );
+    if ( 0 == rc )
+    {
+        while ( 0 == rc )
+        {
+            vdrb_block * block = &( shared -> blocks[ shared -> write_seq % shared -> block_count ] );
+            bool all_written = false;
+            while ( 0 == rc )
+            {
+                if ( vdrb_done == block -> state && block -> seq == shared -> write_seq ) break;
+                all_written = ( shared -> eof && shared -> write_seq == shared -> next_seq );
+                if ( all_written ) break;
+                rc = KConditionWait( shared -> changed, shared -> lock );
+            }
+            if ( 0 != rc || all_written ) break;
+
+            KLockUnlock( shared -> lock );
+            rc = vdh_write_out( block -> out . buf, block -> out . str_len );
+            DISP_RC( rc, "vdrb_write_blocks().vdh_write_out() failed" );
+            if ( 0 == rc )
+            {
+                rc = block -> rc;
+            }
+            KLockAcquire( shared -> lock );
+
+            block -> state = vdrb_free;
+            shared -> write_seq++;
+            KConditionBroadcast( shared -> changed );
+        }
+        shared -> quit = true;
+        KConditionBroadcast( shared -> changed );
+        KLockUnlock( shared -> lock );
+    }
+    return rc;
+}
+
+rc_t vdrb_dump_rows( const struct num_gen * rows, void ** workers, uint32_t worker_count,
+                     vdrb_row_fn row_fn )
+{
+    rc_t rc = 0;
+    vdrb_shared shared;
+    vdrb_worker * w = NULL;
+    KThread ** threads = NULL;
+    uint32_t idx, started = 0;
+
+    if ( NULL == rows || NULL == workers || 0 == worker_count || NULL == row_fn )
+    {
+        return RC( rcVDB, rcNoTarg, rcReading, rcParam, rcNull );
+    }
+
+    memset( &shared, 0, sizeof shared );
+    shared . row_fn = row_fn;
+    shared . block_count = worker_count * VDRB_SLOTS_PER_WORKER;
+    shared . blocks = calloc( shared . block_count, sizeof shared . blocks[ 0 ] );
+    w = calloc( worker_count, sizeof w[ 0 ] );
+    threads = calloc( worker_count, sizeof threads[ 0 ] );
+    if ( NULL == shared . blocks || NULL == w || NULL == threads )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    }
+    for ( idx = 0; 0 == rc && idx < shared . block_count; ++idx )
+    {
+        rc = vds_make( &( shared . blocks[ idx ] . out ), 0, DUMP_STR_INC );
+    }
+    if ( 0 == rc )
+    {
+        rc = KLockMake( &shared . lock );
+        DISP_RC( rc, "vdrb_dump_rows().KLockMake() failed" );
+    }
+    if ( 0 == rc )
+    {
+        rc = KConditionMake( &shared . changed );
+        DISP_RC( rc, "vdrb_dump_rows().KConditionMake() failed" );
+    }
+    if ( 0 == rc )
+    {
+        rc = num_gen_iterator_make( rows, &shared . iter );
+        DISP_RC( rc, "vdrb_dump_rows().num_gen_iterator_make() failed" );
+        if ( 0 == rc )
+        {
+            rc = num_gen_iterator_count( shared . iter, &shared . row_count );
+            DISP_RC( rc, "vdrb_dump_rows().num_gen_iterator_count() failed" );
+        }
+    }
+
+    for ( idx = 0; 0 == rc && idx < worker_count; ++idx )
+    {
+        w[ idx ] . shared = &shared;
+        w[ idx ] . worker = workers[ idx ];
+        rc = KThreadMake( &threads[ idx ], vdrb_worker_thread, &w[ idx ] );
+        DISP_RC( rc, "vdrb_dump_rows().KThreadMake() failed" );
+        if ( 0 == rc )
+        {
+            started++;
+        }
+    }
+    if ( started > 0 )
+    {
+        /* if not all threads could be started, the started ones do the work */
+        rc = vdrb_write_blocks( &shared );
+    }
+    for ( idx = 0; idx < started; ++idx )
+    {
+        rc_t status = 0;
+        rc_t rc2 = KThreadWait( threads[ idx ], &status );
+        if ( 0 == rc )
+        {
+            rc = ( 0 != rc2 ) ? rc2 : status;
+        }
+        KThreadRelease( threads[ idx ] );
+    }
+
+    if ( NULL != shared . iter )
+    {
+        num_gen_iterator_destroy( shared . iter );
+    }
+    KConditionRelease( shared . changed );
+    KLockRelease( shared . lock );
+    if ( NULL != shared . blocks )
+    {
+        for ( idx = 0; idx < shared . block_count; ++idx )
+        {
+            vds_free( &( shared . blocks[ idx ] . out ) );
+        }
+        free( shared . blocks );
+    }
+    free( threads );
+    free( w );
+    return rc;
+}
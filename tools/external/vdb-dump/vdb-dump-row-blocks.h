@@ -0,0 +1,65 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_vdb_dump_row_blocks_
+#define _h_vdb_dump_row_blocks_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+#include "vdb-dump-str.h"
+
+struct num_gen;
+
+/*************************************************************************************
+    dumps one row into the output-string of the block it belongs to:
+        worker  ... the state of one worker-thread ( own cursor, own column-buffers )
+        first   ... the row is the first one of the row-set
+        last    ... the row is the last one of the row-set
+*************************************************************************************/
+typedef rc_t ( CC * vdrb_row_fn )( void * worker, int64_t row_id, bool first, bool last, p_dump_str out );
+
+/*************************************************************************************
+    splits the row-set into blocks of consecutive rows, the blocks are dumped
+    by one thread per worker, the calling thread writes the output of the blocks
+    in row-order to KOut...
+
+    stops at the first error of a block, after the output of the rows in front
+    of the failing row has been written
+*************************************************************************************/
+rc_t vdrb_dump_rows( const struct num_gen * rows, void ** workers, uint32_t worker_count,
+                     vdrb_row_fn row_fn );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -188,6 +188,48 @@ rc_t vds_append_fmt( p_dump_str s, const size_t aprox_len, const char *fmt, ...
 }
 
 
+rc_t vds_append_vfmt_no_limit_check( p_dump_str s, const char *fmt, va_list args )
+{
+    rc_t rc = 0;
+    if ( NULL == s || NULL == fmt )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+    }
+    else
+    {
+        size_t needed = DUMP_STR_INC;
+        bool done = false;
+        while ( 0 == rc && !done )
+        {
+            rc = vds_inc_buffer( s, needed );
+            if ( 0 == rc )
+            {
+                va_list argp;
+                size_t num_writ = 0;
+                size_t avail = s -> buf_size - s -> str_len;
+
+                va_copy( argp, args );
+                rc = string_vprintf( s -> buf + s -> str_len, avail, &num_writ, fmt, argp );
+                va_end( argp );
+
+                if ( 0 == rc && num_writ < avail )
+                {
+                    s -> str_len += num_writ;
+                    done = true;
+                }
+                else if ( 0 == rc || GetRCState( rc ) == rcInsufficient )
+                {
+                    /* string_vprintf() reports the needed size, but do not rely on it */
+                    needed = ( num_writ >= avail ) ? num_writ + 1 : avail * 2;
+                    rc = 0;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
 rc_t vds_append_str( p_dump_str s, const char *s1 )
 {
     rc_t rc = 0;
@@ -37,6 +37,7 @@ extern "C" {
 
 #include <klib/rc.h>
 #include <klib/namelist.h>
+#include <stdarg.h>
 
 typedef struct dump_str
 {
@@ -70,6 +71,9 @@ char *vds_ptr( p_dump_str s );
 /* appends the formated string with parameters, truncates to the limit */
 rc_t vds_append_fmt( p_dump_str s, const size_t aprox_len, const char *fmt, ... );
 
+/* appends the formated string with a va_list, grows the buffer as needed, does not truncate */
+rc_t vds_append_vfmt_no_limit_check( p_dump_str s, const char *fmt, va_list args );
+
 /* appends the string, truncates to the limit */
 rc_t vds_append_str( p_dump_str s, const char *s1 );
 
@@ -59,6 +59,8 @@
 #include "vdb-dump-helper.h"
 #include "vdb-dump-row-context.h"
 #include "vdb-dump-formats.h"
+#include "vdb-dump-row-blocks.h"
+#include "vdb-dump-arrow.h"
 #include "vdb-dump-fastq.h"
 #include "vdb-dump-redir.h"
 #include "vdb_info.h"
@@ -105,6 +107,7 @@ static const char * gzip_usage[]                = { "compress output using gzip"
 static const char * bzip2_usage[]               = { "compress output using bzip2",                  NULL };
 static const char * outbuf_size_usage[]         = { "size of output-buffer, 0...none",              NULL };
 static const char * disable_mt_usage[]          = { "disable multithreading",                       NULL };
+static const char * threads_usage[]             = { "dump rows on this many threads",               NULL };
 static const char * info_usage[]                = { "print info about run",                         NULL };
 static const char * spotgroup_usage[]           = { "show spotgroups",                              NULL };
 static const char * merge_ranges_usage[]        = { "merge and sort row-ranges",                    NULL };
@@ -161,6 +164,7 @@ OptDef DumpOptions[] =
     { OPTION_BZIP2,                 NULL,                     NULL, bzip2_usage,             1, false,  false },
     { OPTION_OUT_BUF_SIZE,          NULL,                     NULL, outbuf_size_usage,       1, true,   false },
     { OPTION_NO_MULTITHREAD,        NULL,                     NULL, disable_mt_usage,        1, false,  false },
+    { OPTION_THREADS,               NULL,                     NULL, threads_usage,           1, true,   false },
     { OPTION_INFO,                  NULL,                     NULL, info_usage,              1, false,  false },
     { OPTION_SPOTGROUPS,            NULL,                     NULL, spotgroup_usage,         1, false,  false },
     { OPTION_MERGE_RANGES,          NULL,                     NULL, merge_ranges_usage,      1, false,  false },
@@ -232,7 +236,8 @@ rc_t CC Usage ( const Args * args )
     KOutMsg( "      fasta1 .. one FASTA-record for the whole accession (REFSEQ)\n" );
     KOutMsg( "      fasta2 .. one FASTA-record for each REFERENCE in cSRA\n" );
     KOutMsg( "      qual .... QUAL( 2 lines ) for each row\n" );
-    KOutMsg( "      qual1 ... QUAL( 2 lines ) for each fragment if possible\n\n" );
+    KOutMsg( "      qual1 ... QUAL( 2 lines ) for each fragment if possible\n" );
+    KOutMsg( "      arrow ... Arrow IPC file, one column per column ( use --output-file )\n\n" );
     HelpOptionLine ( ALIAS_ID_RANGE,            OPTION_ID_RANGE,        NULL,           id_range_usage );
     HelpOptionLine ( ALIAS_WITHOUT_SRA,         OPTION_WITHOUT_SRA,     NULL,           without_sra_usage );
     HelpOptionLine ( ALIAS_EXCLUDED_COLUMNS,    OPTION_EXCLUDED_COLUMNS,"columns",      excluded_columns_usage );
@@ -255,6 +260,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( NULL,                      OPTION_BZIP2,           NULL,           bzip2_usage );
     HelpOptionLine ( NULL,                      OPTION_OUT_BUF_SIZE,    "size",         outbuf_size_usage );
     HelpOptionLine ( NULL,                      OPTION_NO_MULTITHREAD,  NULL,           disable_mt_usage );
+    HelpOptionLine ( NULL,                      OPTION_THREADS,         "count",        threads_usage );
     HelpOptionLine ( NULL,                      OPTION_INFO,            NULL,           info_usage );
     HelpOptionLine ( NULL,                      OPTION_SPOTGROUPS,      NULL,           spotgroup_usage );
     HelpOptionLine ( NULL,                      OPTION_MERGE_RANGES,    NULL,           merge_ranges_usage );
@@ -404,12 +410,8 @@ static void vdm_row_error( const char * fmt, rc_t rc, uint64_t row_id ) {
 }
 
 /*************************************************************************************
-    dump_rows:
-    * is the main loop to dump all rows or all selected rows ( -R1-10 )
-    * creates a dump-string ( parameterizes it with the wanted max. line-len )
-    * starts the number-generator
-    * as long as the number-generator has a number and the result-code is ok
-      do for every row-id:
+    dump_row:
+    * dumps the row r_ctx -> row_id
         - set the row-id into the cursor and open the cursor-row
         - loop throuh the columns
         - close the row
@@ -417,67 +419,178 @@ static void vdm_row_error( const char * fmt, rc_t rc, uint64_t row_id ) {
     * the collection of the text's for the columns "read_cell_data_and_dump()"
       is separated from the actual printing "print_row()" !
 
+r_ctx   [IN] ... row-context ( cursor, dump_context, col_defs ... )
+first   [IN] ... the row is the first one of the row-set
+last    [IN] ... the row is the last one of the row-set
+*************************************************************************************/
+static rc_t vdm_dump_row( p_row_context r_ctx, bool first, bool last ) {
+    r_ctx -> rc = VCursorSetRowId( r_ctx -> cursor, r_ctx -> row_id );
+    if ( 0 != r_ctx -> rc ) {
+        vdm_row_error( "vdm_dump_rows().VCursorSetRowId( row#$(row_nr) ) failed",
+                    r_ctx -> rc, r_ctx -> row_id ); /* above */
+    } else {
+        r_ctx -> rc = VCursorOpenRow( r_ctx -> cursor );
+        if ( 0 != r_ctx -> rc ) {
+            vdm_row_error( "vdm_dump_rows().VCursorOpenRow( row#$(row_nr) ) failed",
+                        r_ctx -> rc, r_ctx -> row_id ); /* above */
+        } else {
+            /* first reset the string and valid-flag for every column */
+            vdcd_reset_content( r_ctx -> col_defs );
+            /* read the data of every column and create a string for it */
+            VectorForEach( &( r_ctx -> col_defs -> cols ), false, vdm_read_cell_data, r_ctx );
+            if ( 0 == r_ctx -> rc ) {
+                /* prints the collected strings, in vdb-dump-formats.c */
+                if ( !r_ctx -> ctx -> sum_num_elem ) {
+                    r_ctx -> rc = vdfo_print_row( r_ctx, first, last ); /* in vdb-dump-formats.c */
+                    if ( 0 != r_ctx -> rc ) {
+                        vdm_row_error( "vdm_dump_rows().vdfo_print_row( row#$(row_nr) ) failed",
+                            r_ctx -> rc, r_ctx -> row_id ); /* above */
+                    }
+                }
+            }
+            r_ctx -> rc = VCursorCloseRow( r_ctx -> cursor );
+            if ( 0 != r_ctx -> rc ) {
+                vdm_row_error( "vdm_dump_rows().VCursorCloseRow( row#$(row_nr) ) failed",
+                            r_ctx -> rc, r_ctx -> row_id ); /* above */
+            }
+        }
+    }
+    return r_ctx -> rc;
+}
+
+/*************************************************************************************
+    dump_rows_threaded:
+    * gives every worker-thread its own row-context: own cursor, own copy of the
+      column-definitions ( content-buffers and element-sums ) and own dump-string
+    * the rows are dumped in blocks of consecutive rows into the output-strings of
+      the blocks, which are written in row-order ( vdb-dump-row-blocks.c )
+    * merges the element-sums and the last error of the workers into r_ctx
+
+r_ctx   [IN] ... row-context ( cursor, dump_context, col_defs ... )
+*************************************************************************************/
+static rc_t CC vdm_dump_row_cb( void * worker, int64_t row_id, bool first, bool last, p_dump_str out ) {
+    p_row_context w_ctx = ( p_row_context )worker;
+    w_ctx -> out = out;
+    w_ctx -> row_id = row_id;
+    return vdm_dump_row( w_ctx, first, last );
+}
+
+static rc_t vdm_make_worker( const p_row_context r_ctx, p_row_context w_ctx ) {
+    rc_t rc = 0;
+    w_ctx -> table = r_ctx -> table;
+    w_ctx -> view = r_ctx -> view;
+    w_ctx -> ctx = r_ctx -> ctx;
+    if ( !vdcd_copy( &( w_ctx -> col_defs ), r_ctx -> col_defs ) ) {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        DISP_RC( rc, "vdcd_copy() failed" );
+    }
+    if ( 0 == rc ) {
+        rc = vds_make( &( w_ctx -> s_col ), r_ctx -> ctx -> max_line_len, 512 );
+        DISP_RC( rc, "vds_make() failed" );
+    }
+    if ( 0 == rc ) {
+        if ( NULL != r_ctx -> view ) {
+            rc = VViewCreateCursor( r_ctx -> view, &( w_ctx -> cursor ) );
+            DISP_RC( rc, "VViewCreateCursor() failed" );
+        } else {
+            rc = VTableCreateCachedCursorRead( r_ctx -> table, &( w_ctx -> cursor ), r_ctx -> ctx -> cur_cache_size );
+            DISP_RC( rc, "VTableCreateCursorRead() failed" );
+        }
+    }
+    if ( 0 == rc ) {
+        if ( vdcd_add_to_cursor( w_ctx -> col_defs, w_ctx -> cursor ) < 1 ) {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+            DISP_RC( rc, "vdcd_add_to_cursor() failed" );
+        } else {
+            rc = VCursorOpen( w_ctx -> cursor );
+            DISP_RC( rc, "VCursorOpen() failed" );
+        }
+    }
+    return rc;
+}
+
+static rc_t vdm_dump_rows_threaded( p_row_context r_ctx ) {
+    rc_t rc = 0;
+    uint32_t idx, count = r_ctx -> ctx -> threads;
+    row_context * w_ctx = calloc( count, sizeof w_ctx[ 0 ] );
+    void ** workers = calloc( count, sizeof workers[ 0 ] );
+    if ( NULL == w_ctx || NULL == workers ) {
+        rc = RC( rcVDB, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        count = 0;
+    }
+    for ( idx = 0; 0 == rc && idx < count; ++idx ) {
+        workers[ idx ] = &( w_ctx[ idx ] );
+        rc = vdm_make_worker( r_ctx, &( w_ctx[ idx ] ) );
+    }
+    if ( 0 == rc ) {
+        rc = vdrb_dump_rows( r_ctx -> ctx -> rows, workers, count, vdm_dump_row_cb );
+    }
+    for ( idx = 0; idx < count; ++idx ) {
+        /* the partial element-sums of the workers add up to the sums of the row-set */
+        vdcd_add_elementsums( r_ctx -> col_defs, w_ctx[ idx ] . col_defs );
+        if ( 0 != w_ctx[ idx ] . last_rc ) {
+            r_ctx -> last_rc = w_ctx[ idx ] . last_rc;
+        }
+        vdcd_destroy( w_ctx[ idx ] . col_defs );
+        vds_free( &( w_ctx[ idx ] . s_col ) );
+        if ( NULL != w_ctx[ idx ] . cursor ) {
+            rc = vdh_vcursor_release( rc, w_ctx[ idx ] . cursor );
+        }
+    }
+    free( workers );
+    free( w_ctx );
+    return rc;
+}
+
+/*************************************************************************************
+    dump_rows:
+    * is the main loop to dump all rows or all selected rows ( -R1-10 )
+    * creates a dump-string ( parameterizes it with the wanted max. line-len )
+    * starts the number-generator
+    * as long as the number-generator has a number and the result-code is ok
+      call dump_row() for every row-id
+    * if more than one thread is requested, the rows are dumped by worker-threads
+      instead ( dump_rows_threaded() )
+
 r_ctx   [IN] ... row-context ( cursor, dump_context, col_defs ... )
 *************************************************************************************/
 static rc_t vdm_dump_rows( p_row_context r_ctx ) {
     /* the important row_id is a member of r_ctx ! */
     const struct num_gen_iter * iter;
 
+    r_ctx -> out = NULL;
+    if ( df_arrow == r_ctx -> ctx -> format ) {
+        /* column by column, blob by blob */
+        r_ctx -> rc = vdar_dump_rows( r_ctx -> ctx, r_ctx -> col_defs, r_ctx -> cursor ); /* vdb-dump-arrow.c */
+        return r_ctx -> rc;
+    }
     r_ctx -> rc = vds_make( &( r_ctx -> s_col ), r_ctx -> ctx->max_line_len, 512 ); /* vdb-dump-str.sh */
     DISP_RC( r_ctx -> rc, "vdm_dump_rows().vds_make() failed" );
     if ( 0 == r_ctx -> rc ) {
-        r_ctx -> rc = num_gen_iterator_make( r_ctx -> ctx -> rows, &iter );
-        DISP_RC( r_ctx -> rc, "vdm_dump_rows().num_gen_iterator_make() failed" );
-        if ( 0 == r_ctx -> rc ) {
-            uint64_t count;
-            r_ctx -> rc = num_gen_iterator_count( iter, &count );
-            DISP_RC( r_ctx -> rc, "vdm_dump_rows().num_gen_iterator_count() failed" );
+        if ( r_ctx -> ctx -> threads > 1 ) {
+            r_ctx -> rc = vdm_dump_rows_threaded( r_ctx ); /* above */
+        } else {
+            r_ctx -> rc = num_gen_iterator_make( r_ctx -> ctx -> rows, &iter );
+            DISP_RC( r_ctx -> rc, "vdm_dump_rows().num_gen_iterator_make() failed" );
             if ( 0 == r_ctx -> rc ) {
-                uint64_t num = 0;
-                while ( ( 0 == r_ctx -> rc ) &&
-                        num_gen_iterator_next( iter, &( r_ctx -> row_id ), &( r_ctx -> rc ) ) ) {
-                    if ( 0 == r_ctx -> rc ) {
-                        r_ctx -> rc = Quitting();
-                    }
-                    if ( 0 != r_ctx -> rc ) break;
-                    r_ctx -> rc = VCursorSetRowId( r_ctx -> cursor, r_ctx -> row_id );
-                    if ( 0 != r_ctx -> rc ) {
-                        vdm_row_error( "vdm_dump_rows().VCursorSetRowId( row#$(row_nr) ) failed",
-                                    r_ctx -> rc, r_ctx -> row_id ); /* above */
-                    } else {
-                        r_ctx -> rc = VCursorOpenRow( r_ctx -> cursor );
-                        if ( 0 != r_ctx -> rc ) {
-                            vdm_row_error( "vdm_dump_rows().VCursorOpenRow( row#$(row_nr) ) failed",
-                                        r_ctx -> rc, r_ctx -> row_id ); /* above */
-                        } else {
-                            /* first reset the string and valid-flag for every column */
-                            vdcd_reset_content( r_ctx -> col_defs );
-                            /* read the data of every column and create a string for it */
-                            VectorForEach( &( r_ctx -> col_defs -> cols ), false, vdm_read_cell_data, r_ctx );
-                            if ( 0 == r_ctx -> rc ) {
-                                /* prints the collected strings, in vdb-dump-formats.c */
-                                if ( !r_ctx -> ctx -> sum_num_elem ) {
-                                    bool first = ( 0 == num );
-                                    bool last  = ( num >= count - 1 );
-                                    r_ctx -> rc = vdfo_print_row( r_ctx, first, last ); /* in vdb-dump-formats.c */
-                                    if ( 0 != r_ctx -> rc ) {
-                                        vdm_row_error( "vdm_dump_rows().vdfo_print_row( row#$(row_nr) ) failed",
-                                            r_ctx -> rc, r_ctx -> row_id ); /* above */
-                                    }
-                                }
-                            }
-                            r_ctx -> rc = VCursorCloseRow( r_ctx -> cursor );
-                            if ( 0 != r_ctx -> rc ) {
-                                vdm_row_error( "vdm_dump_rows().VCursorCloseRow( row#$(row_nr) ) failed",
-                                            r_ctx -> rc, r_ctx -> row_id ); /* above */
-                            }
+                uint64_t count;
+                r_ctx -> rc = num_gen_iterator_count( iter, &count );
+                DISP_RC( r_ctx -> rc, "vdm_dump_rows().num_gen_iterator_count() failed" );
+                if ( 0 == r_ctx -> rc ) {
+                    uint64_t num = 0;
+                    while ( ( 0 == r_ctx -> rc ) &&
+                            num_gen_iterator_next( iter, &( r_ctx -> row_id ), &( r_ctx -> rc ) ) ) {
+                        if ( 0 == r_ctx -> rc ) {
+                            r_ctx -> rc = Quitting();
                         }
-                    }
-                    num += 1;
-                } /* while( ... ) */
+                        if ( 0 != r_ctx -> rc ) break;
+                        vdm_dump_row( r_ctx, ( 0 == num ), ( num >= count - 1 ) ); /* above */
+                        num += 1;
+                    } /* while( ... ) */
+                }
             }
+            num_gen_iterator_destroy( iter );
         }
-        num_gen_iterator_destroy( iter );
         /* in case the user selected element-sum on the commandline ( -U|--numelemsum )*/
         if ( 0 == r_ctx -> rc && r_ctx -> ctx -> sum_num_elem ) {
             VectorForEach( &( r_ctx -> col_defs -> cols ), false, vdm_print_elem_sum, r_ctx );
@@ -136,6 +136,10 @@ static const char *USAGE_SDC_SEQ_ROWS[] =
 static const char *USAGE_SDC_PLEN_THOLD[] =
 { "Specify a threshold for amount of secondary alignment which are shorter (hard-clipped) than corresponding primaries, default 1%.", NULL };
 
+#define OPTION_THREADS "threads"
+static const char *USAGE_THREADS[] =
+{ "Check referential integrity of alignment databases on this many threads, default 1.", NULL };
+
 #define OPTION_NGC "ngc"
 static const char *USAGE_NGC[] = { "path to ngc file", NULL };
 
@@ -171,6 +175,8 @@ static OptDef options [] =
   , { OPTION_SDC_SEQ_ROWS, NULL      , NULL, USAGE_SDC_SEQ_ROWS, 1, true , false }
   , { OPTION_SDC_PLEN_THOLD, NULL    , NULL, USAGE_SDC_PLEN_THOLD, 1, true , false }
 
+  , { OPTION_THREADS , NULL          , NULL, USAGE_THREADS , 1, true , false }
+
     /* not printed by --help */
   , { "dri"          , NULL          , NULL, USAGE_DRI     , 1, false, false }
   , { "index-only"   ,NULL           , NULL, USAGE_IND_ONLY, 1, false, false }
@@ -230,6 +236,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine(NULL          , OPTION_SDC_SEC_ROWS, "rows"    , USAGE_SDC_SEC_ROWS);
     HelpOptionLine(NULL          , OPTION_SDC_SEQ_ROWS, "rows"    , USAGE_SDC_SEQ_ROWS);
     HelpOptionLine(NULL          , OPTION_SDC_PLEN_THOLD, "threshold", USAGE_SDC_PLEN_THOLD);
+    HelpOptionLine(NULL          , OPTION_THREADS       , "count", USAGE_THREADS);
     HelpOptionLine(NULL          , OPTION_NGC           , "path", USAGE_NGC);
 
     HelpOptionLine(NULL          , OPTION_CHECK_REDACT, NULL, USAGE_CHECK_REDACT);
@@ -273,6 +280,7 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
     pb -> sdc_seq_rows.number = 100000;
     pb -> sdc_pa_len_thold_in_percent = true;
     pb -> sdc_pa_len_thold.percent = 0.01;
+    pb -> threads = 1;
 
     pb -> check_redact = false;
   {
@@ -552,6 +560,41 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
         }
     }
 
+/* OPTION_THREADS */
+    {
+        rc = ArgsOptionCount ( args, OPTION_THREADS, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_THREADS);
+            return rc;
+        }
+
+        if (cnt > 0)
+        {
+            uint64_t value;
+            rc = ArgsOptionValue ( args, OPTION_THREADS, 0, (const void **) &dummy );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "ArgsOptionValue() failed for " OPTION_THREADS);
+                return rc;
+            }
+
+            value = string_to_U64 ( dummy, string_size ( dummy ), &rc );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "string_to_U64() failed for " OPTION_THREADS);
+                return rc;
+            }
+            else if (value == 0 || value > 1024)
+            {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR (klogInt, rc, OPTION_THREADS " has illegal value (has to be 1-1024)" );
+                return rc;
+            }
+            pb->threads = (uint32_t)value;
+        }
+    }
+
 /* OPTION_NGC */
     {
         rc = ArgsOptionCount(args, OPTION_NGC, &cnt);
@@ -69,6 +69,11 @@
 #include <klib/debug.h>
 #include <klib/data-buffer.h>
 #include <klib/sort.h>
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <kproc/lock.h>
+#include <kproc/thread.h>
+#include <atomic32.h>
 
 #include <kapp/main.h> /* Quitting */
 
@@ -1195,11 +1200,16 @@ typedef struct id_pair_s {
     int64_t second;
 } id_pair_t;
 
-static size_t work_chunk(uint64_t const count)
+static size_t work_chunk(uint64_t const count, unsigned const threads)
 {
     size_t const max = memory_suggestion / (sizeof(id_pair_t));
     size_t chunk = (size_t)count;
 
+    if (threads > 1) {
+        /* every thread needs room for its share of the rows
+         * and for the radix sort's copy of them */
+        chunk = 2 * (size_t)threads * (size_t)(count / threads + 1);
+    }
 #if 1
     /* do as many as possible at once */
     if (chunk > max)
@@ -1232,6 +1242,192 @@ static void sort_key_pairs(size_t const N, id_pair_t array[/* N */])
 #undef GET
 }
 
+/* the radix sort gives every thread a slice of at least this many pairs */
+#define RADIX_MIN_SLICE (64u * 1024u)
+#define RADIX_MAX_THREADS 32
+
+enum radix_phase {
+    radix_scan,
+    radix_count,
+    radix_scatter
+};
+
+typedef struct radix_slice_s {
+    id_pair_t const *src;
+    id_pair_t *dst;
+    size_t start;
+    size_t end;
+    int64_t min[2];
+    int64_t max[2];
+    uint64_t base;
+    unsigned shift;
+    unsigned key; /* 0: first, 1: second */
+    enum radix_phase phase;
+    bool ordered; /* second does not decrease within the slice */
+    size_t count[256];
+} radix_slice_t;
+
+#define RADIX_KEY(P, KEY) ((KEY) == 0 ? (P)->first : (P)->second)
+#define RADIX_DIGIT(K, BASE, SHIFT) ((unsigned)((((uint64_t)(K) - (BASE)) >> (SHIFT)) & 0xFF))
+
+static void radix_slice_run(radix_slice_t *const self)
+{
+    id_pair_t const *const src = self->src;
+    uint64_t const base = self->base;
+    unsigned const shift = self->shift;
+    unsigned const key = self->key;
+    size_t i;
+
+    switch (self->phase) {
+    case radix_scan:
+        self->min[0] = self->min[1] = INT64_MAX;
+        self->max[0] = self->max[1] = INT64_MIN;
+        self->ordered = true;
+        for (i = self->start; i < self->end; ++i) {
+            int64_t const first = src[i].first;
+            int64_t const second = src[i].second;
+
+            if (self->min[0] > first)  self->min[0] = first;
+            if (self->max[0] < first)  self->max[0] = first;
+            if (self->min[1] > second) self->min[1] = second;
+            if (self->max[1] < second) self->max[1] = second;
+            if (i > self->start && second < src[i - 1].second)
+                self->ordered = false;
+        }
+        break;
+    case radix_count:
+        memset(self->count, 0, sizeof(self->count));
+        for (i = self->start; i < self->end; ++i)
+            ++self->count[RADIX_DIGIT(RADIX_KEY(&src[i], key), base, shift)];
+        break;
+    case radix_scatter:
+        /* count holds the slice's offset into dst for every digit */
+        for (i = self->start; i < self->end; ++i)
+            self->dst[self->count[RADIX_DIGIT(RADIX_KEY(&src[i], key), base, shift)]++] = src[i];
+        break;
+    }
+}
+
+static rc_t CC radix_slice_thread(const KThread *self, void *data)
+{
+    radix_slice_run((radix_slice_t *)data);
+    return 0;
+}
+
+/* runs a phase on all slices, the first one on the calling thread;
+ * a slice whose thread can not be started is run here after the others */
+static void radix_run(unsigned const n, radix_slice_t slice[/* n */], enum radix_phase const phase)
+{
+    KThread *thread[RADIX_MAX_THREADS];
+    unsigned i;
+
+    for (i = 0; i < n; ++i)
+        slice[i].phase = phase;
+    for (i = 1; i < n; ++i) {
+        if (KThreadMake(&thread[i], radix_slice_thread, &slice[i]) != 0)
+            thread[i] = NULL;
+    }
+    radix_slice_run(&slice[0]);
+    for (i = 1; i < n; ++i) {
+        if (thread[i] != NULL) {
+            rc_t rc = 0;
+
+            KThreadWait(thread[i], &rc);
+            KThreadRelease(thread[i]);
+        }
+        else
+            radix_slice_run(&slice[i]);
+    }
+}
+
+/* sorts the pairs like sort_key_pairs does;
+ * least significant digit radix sort, first on second and then on first,
+ * a byte per pass and only over the bytes in which the keys differ;
+ * the pass on second is skipped if it is already in order,
+ * as it is when the pairs are loaded row by row;
+ * tmp has room for N pairs */
+static void radix_sort_key_pairs(size_t const N,
+                                 id_pair_t array[/* N */],
+                                 id_pair_t tmp[/* N */],
+                                 unsigned const threads)
+{
+    radix_slice_t slice[RADIX_MAX_THREADS];
+    unsigned n = threads < RADIX_MAX_THREADS ? threads : RADIX_MAX_THREADS;
+    id_pair_t *src = array;
+    id_pair_t *dst = tmp;
+    int64_t min[2] = { INT64_MAX, INT64_MAX };
+    int64_t max[2] = { INT64_MIN, INT64_MIN };
+    bool ordered = true;
+    unsigned i;
+    int key;
+
+    if (N < 2)
+        return;
+    if (n > N / RADIX_MIN_SLICE)
+        n = (unsigned)(N / RADIX_MIN_SLICE);
+    if (n == 0)
+        n = 1;
+    for (i = 0; i < n; ++i) {
+        slice[i].src = src;
+        slice[i].start = (N / n) * i;
+        slice[i].end = i + 1 < n ? (N / n) * (i + 1) : N;
+    }
+    radix_run(n, slice, radix_scan);
+    for (i = 0; i < n; ++i) {
+        int k;
+
+        for (k = 0; k < 2; ++k) {
+            if (min[k] > slice[i].min[k]) min[k] = slice[i].min[k];
+            if (max[k] < slice[i].max[k]) max[k] = slice[i].max[k];
+        }
+        ordered &= slice[i].ordered;
+        if (i > 0 && src[slice[i].start].second < src[slice[i].start - 1].second)
+            ordered = false;
+    }
+    for (key = ordered ? 0 : 1; key >= 0; --key) {
+        uint64_t const range = (uint64_t)max[key] - (uint64_t)min[key];
+        unsigned shift;
+
+        for (shift = 0; shift < 64 && (range >> shift) != 0; shift += 8) {
+            size_t offset = 0;
+            unsigned digit;
+            bool single = false;
+
+            for (i = 0; i < n; ++i) {
+                slice[i].src = src;
+                slice[i].dst = dst;
+                slice[i].base = (uint64_t)min[key];
+                slice[i].shift = shift;
+                slice[i].key = (unsigned)key;
+            }
+            radix_run(n, slice, radix_count);
+            for (digit = 0; digit < 256; ++digit) {
+                size_t const start = offset;
+
+                for (i = 0; i < n; ++i) {
+                    size_t const count = slice[i].count[digit];
+
+                    slice[i].count[digit] = offset;
+                    offset += count;
+                }
+                if (offset - start == N)
+                    single = true;
+            }
+            if (single)
+                continue; /* every key has the same byte here */
+
+            radix_run(n, slice, radix_scatter);
+            src = dst;
+            dst = src == array ? tmp : array;
+        }
+    }
+    if (src != array)
+        memmove(array, src, N * sizeof(array[0]));
+}
+
+#undef RADIX_DIGIT
+#undef RADIX_KEY
+
 /* use the KSORT macro so the compiler can optimize everything */
 static void sort_keys(size_t const N, int64_t array[/* N */])
 {
@@ -1250,10 +1446,12 @@ static void sort_keys(size_t const N, int64_t array[/* N */])
 
 #define CHECK_QUITTING do { rc_t const rc = Quitting(); if (rc) return rc; } while(0);
 
+/* tmp is room for the radix sort, the pairs are sorted with KSORT without it */
 static size_t load_key_pairs(int64_t const startId,
                              int64_t const endId,
                              size_t const pairs,
                              id_pair_t pair[/* pairs */],
+                             id_pair_t tmp[/* pairs */],
                              VCursor const *const acurs,
                              ColumnInfo *const aci,
                              int64_t plast[],
@@ -1275,7 +1473,14 @@ static size_t load_key_pairs(int64_t const startId,
             Rc[0] = rc1;
             return 0;
         }
-        CHECK_QUITTING;
+        {
+            rc_t const rc = Quitting();
+
+            if (rc) {
+                Rc[0] = rc;
+                return 0;
+            }
+        }
 
         if (first < row)
             first = row;
@@ -1309,8 +1514,12 @@ static size_t load_key_pairs(int64_t const startId,
             /* row not found might be an error but that won't be decided here */
         }
     }
-    if (!ordered)
-        sort_key_pairs(j, pair);
+    if (!ordered) {
+        if (tmp)
+            radix_sort_key_pairs(j, pair, tmp, 1);
+        else
+            sort_key_pairs(j, pair);
+    }
 
     Rc[0] = 0;
     return j;
@@ -1334,6 +1543,123 @@ static bool is_sorted(uint32_t const N, int64_t const key[/* N */])
     return true;
 }
 
+/* state shared by the threads of a referential integrity check */
+typedef struct ric_shared_s {
+    KLock *lock;
+    atomic32_t failed; /* 1 + the lowest index of the threads that failed */
+    uint64_t done;
+    uint64_t count;
+    bool show_complete;
+} ric_shared_t;
+
+/* a thread only stops for the failure of a thread before it,
+ * so the failure reported is one of the first range that has one;
+ * the pairs of a chunk are checked in the order of their foreign key and the
+ * chunks of a thread are smaller than without threads, with several bad pairs
+ * the one reported can be another one than without threads */
+static bool ric_stopped(ric_shared_t const *const shared, unsigned const which)
+{
+    if (shared) {
+        int const failed = atomic32_read(&shared->failed);
+
+        return failed != 0 && (unsigned)failed <= which;
+    }
+    return false;
+}
+
+static void ric_report_pair(ColumnInfo const *const aci,
+                            ColumnInfo const *const bci,
+                            id_pair_t const *const bad,
+                            bool const not_found)
+{
+    if (not_found)
+        (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
+                                 "$(aname) <-> $(bname)"
+                                 " failed to retrieve pair $(first) -> $(second)",
+                                 "aname=%s,bname=%s,first=%ld,second=%ld",
+                                 aci->name, bci->name,
+                                 bad->first, bad->second));
+    else
+        (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
+                                 "$(aname) <-> $(bname) "
+                                 "inconsistent pair $(first) -> $(second)",
+                                 "aname=%s,bname=%s,first=%ld,second=%ld",
+                                 aci->name, bci->name,
+                                 bad->first, bad->second));
+}
+
+/* looks up the pairs loaded by load_key_pairs in the other table;
+ * an inconsistent pair is returned in bad */
+static rc_t ric_check_pairs(size_t const n,
+                            id_pair_t const pair[/* n */],
+                            void *scratch[],
+                            size_t *const scratch_size,
+                            VCursor const *const bcurs,
+                            ColumnInfo *const bci,
+                            ric_shared_t const *const shared,
+                            unsigned const which,
+                            id_pair_t *const bad,
+                            bool *const not_found)
+{
+    size_t i;
+    int64_t cur_fkey = 0;
+    uint32_t elem_count = 0;
+    uint32_t current = 0;
+    int64_t const *id = 0;
+
+    for (i = 0; i < n; ++i) {
+        int64_t const fkey = pair[i].first;
+        int64_t const row = pair[i].second;
+
+        if (cur_fkey != fkey) {
+            uint32_t dummy;
+            rc_t rc;
+
+            CHECK_QUITTING;
+            if (ric_stopped(shared, which))
+                return 0;
+
+            rc = VCursorCellDataDirect(bcurs, fkey, bci->idx,
+                                       &dummy, (void const **)&id,
+                                       NULL, &elem_count);
+
+            if (GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound){
+                bad[0] = pair[i];
+                not_found[0] = true;
+                return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            } else if (rc)
+                return rc;
+
+            if (elem_count > 0 && !is_sorted(elem_count, id)) {
+                if (scratch_size[0] < elem_count) {
+                    void *const temp = realloc(scratch[0], elem_count * sizeof(id[0]));
+
+                    if (temp == NULL)
+                        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+                    scratch[0] = temp;
+                    scratch_size[0] = elem_count;
+                }
+                memmove(scratch[0], id, elem_count * sizeof(id[0]));
+                sort_keys(elem_count, (int64_t *)scratch[0]);
+                id = (int64_t const *)scratch[0];
+            }
+            current = 0;
+            cur_fkey = fkey;
+            while (current < elem_count && id[current] < row) {
+                ++current;
+            }
+        }
+        if (current >= elem_count || id[current] != row) {
+            bad[0] = pair[i];
+            not_found[0] = false;
+            return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+        }
+        ++current;
+    }
+    return 0;
+}
+
 static rc_t ric_align_generic(int64_t const startId,
                               uint64_t const count,
                               size_t const pairs,
@@ -1349,20 +1675,20 @@ static rc_t ric_align_generic(int64_t const startId,
     int64_t const endId = startId + count;
     size_t scratch_size = 0;
     bool show_complete = false;
+    bool first = true;
 
     for (chunk = startId; chunk < endId; ) {
         rc_t rc = 0;
         int64_t last = 0;
-        size_t const n = load_key_pairs(chunk, endId, pairs, pair, acurs, aci, &last, &rc);
-        size_t i;
-        int64_t cur_fkey = 0;
-        uint32_t elem_count = 0;
-        uint32_t current = 0;
-        int64_t const *id = 0;
+        size_t const n = load_key_pairs(chunk, endId, pairs, pair, NULL, acurs, aci, &last, &rc);
+        id_pair_t bad;
+        bool not_found = false;
 
         if (rc) return rc;
-        if (chunk == last)
+        /* the row chunk starts with was the last one checked, unless nothing was checked yet */
+        if (chunk == last && !first)
             break;
+        first = false;
         if (chunk != startId) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
                                      "$(aname) <-> $(bname)"
@@ -1373,76 +1699,234 @@ static rc_t ric_align_generic(int64_t const startId,
             show_complete = true;
         }
         chunk = last;
-        for (i = 0; i < n; ++i) {
-            int64_t const fkey = pair[i].first;
-            int64_t const row = pair[i].second;
+        rc = ric_check_pairs(n, pair, scratch, &scratch_size, bcurs, bci,
+                             NULL, 0, &bad, &not_found);
+        if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcInconsistent)
+            ric_report_pair(aci, bci, &bad, not_found);
+        if (rc) return rc;
+    }
+    if (show_complete) {
+        (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
+                                 "$(aname) <-> $(bname) "
+                                 "$(pct)% complete",
+                                 "aname=%s,bname=%s,pct=%5.1f",
+                                 aci->name, bci->name,
+                                 100.0));
+    }
+    return 0;
+}
 
-            if (cur_fkey != fkey) {
-                uint32_t dummy;
+/* a thread of ric_align_threaded checks a range of the rows of table a */
+typedef struct ric_worker_s {
+    ric_shared_t *shared;
+    KThread *thread;
+    VCursor const *acurs;
+    VCursor const *bcurs;
+    ColumnInfo aci;
+    ColumnInfo bci;
+    id_pair_t *pair;
+    id_pair_t *tmp;
+    size_t pairs;
+    void *scratch;
+    size_t scratch_size;
+    int64_t startId;
+    uint64_t count;
+    unsigned which;
+    rc_t rc;
+    id_pair_t bad;
+    bool not_found;
+    KTimeMs_t load_ms;
+    KTimeMs_t check_ms;
+} ric_worker_t;
+
+static rc_t ric_worker_run(ric_worker_t *const self)
+{
+    ric_shared_t *const shared = self->shared;
+    int64_t const endId = self->startId + self->count;
+    int64_t chunk;
+    bool first = true;
 
-                CHECK_QUITTING;
+    for (chunk = self->startId; chunk < endId; ) {
+        rc_t rc = 0;
+        int64_t last = 0;
+        KTimeMs_t const loading = KTimeMsStamp();
+        size_t const n = load_key_pairs(chunk, endId, self->pairs, self->pair, self->tmp,
+                                        self->acurs, &self->aci, &last, &rc);
+        KTimeMs_t const checking = KTimeMsStamp();
+
+        self->load_ms += checking - loading;
+        if (rc) return rc;
+        /* as in ric_align_generic: a range of one row has chunk == last from the start */
+        if ((chunk == last && !first) || ric_stopped(shared, self->which))
+            break;
+        first = false;
 
-                rc = VCursorCellDataDirect(bcurs, fkey, bci->idx,
-                                           &dummy, (void const **)&id,
-                                           NULL, &elem_count);
+        rc = ric_check_pairs(n, self->pair, &self->scratch, &self->scratch_size,
+                             self->bcurs, &self->bci, shared, self->which,
+                             &self->bad, &self->not_found);
+        self->check_ms += KTimeMsStamp() - checking;
+        if (rc) return rc;
 
-                if (GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound){
-					(void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
+        rc = KLockAcquire(shared->lock);
+        if (rc) return rc;
+        shared->done += last - chunk;
+        if (last + 1 < endId) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
                                      "$(aname) <-> $(bname)"
-                                     " failed to retrieve pair $(first) -> $(second)",
-                                     "aname=%s,bname=%s,first=%ld,second=%ld",
-                                     aci->name, bci->name,
-                                     pair[i].first,pair[i].second));
+                                     " $(pct)% complete",
+                                     "aname=%s,bname=%s,pct=%5.1f",
+                                     self->aci.name, self->bci.name,
+                                     (100.0 * shared->done) / shared->count));
+            shared->show_complete = true;
+        }
+        KLockUnlock(shared->lock);
+        chunk = last;
+    }
+    return 0;
+}
 
-                    return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                } else if (rc)
-                    return rc;
+static rc_t CC ric_worker_thread(const KThread *thread, void *data)
+{
+    ric_worker_t *const self = (ric_worker_t *)data;
 
-                if (elem_count > 0 && !is_sorted(elem_count, id)) {
-                    if (scratch_size < elem_count) {
-                        void *const temp = realloc(scratch[0], elem_count * sizeof(id[0]));
+    self->rc = ric_worker_run(self);
+    if (self->rc && KLockAcquire(self->shared->lock) == 0) {
+        int const failed = atomic32_read(&self->shared->failed);
 
-                        if (temp == NULL)
-                            return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+        if (failed == 0 || (unsigned)failed > self->which + 1)
+            atomic32_set(&self->shared->failed, (int)(self->which + 1));
+        KLockUnlock(self->shared->lock);
+    }
+    return 0;
+}
 
-                        scratch[0] = temp;
-                        scratch_size = elem_count;
-                    }
-                    memmove(scratch[0], id, elem_count * sizeof(id[0]));
-                    sort_keys(elem_count, (int64_t *)scratch[0]);
-                    id = (int64_t const *)scratch[0];
-                }
-                current = 0;
-                cur_fkey = fkey;
-                while (current < elem_count && id[current] < row) {
-                    ++current;
-                }
-            }
-            if (current >= elem_count || id[current] != row) {
-                (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
-                                         "$(aname) <-> $(bname) "
-                                         "inconsistent pair $(first) -> $(second)",
-                                         "aname=%s,bname=%s,first=%ld,second=%ld",
-                                         aci->name, bci->name,
-                                         pair[i].first,pair[i].second));
+static rc_t ric_open_cursor(VTable const *const tbl,
+                            ColumnInfo *const ci,
+                            VCursor const **const curs)
+{
+    rc_t rc = VTableCreateCursorRead(tbl, curs);
 
-                return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-			}
-            ++current;
+    if (rc == 0)
+        rc = VCursorAddColumn(*curs, &ci->idx, "%s", ci->name);
+    if (rc == 0)
+        rc = VCursorOpen(*curs);
+    return rc;
+}
+
+/* ric_align_generic on several threads:
+ * the rows of table a are split into a range per thread,
+ * every thread loads its range with its own cursors, sorts it with the radix sort
+ * and looks it up in table b;
+ * the first thread uses the cursors it is given and runs on the calling thread;
+ * pair is split between the threads, half of every share is room for the sort */
+static rc_t ric_align_threaded(unsigned const threads,
+                               int64_t const startId,
+                               uint64_t const count,
+                               size_t const pairs,
+                               id_pair_t pair[/* pairs */],
+                               VTable const *const atbl,
+                               VCursor const *const acurs,
+                               ColumnInfo *const aci,
+                               VTable const *const btbl,
+                               VCursor const *const bcurs,
+                               ColumnInfo *const bci)
+{
+    unsigned const n = count < threads ? (unsigned)count : threads;
+    size_t const share = n > 0 ? pairs / (2 * n) : 0;
+    ric_worker_t *worker;
+    ric_shared_t shared;
+    rc_t rc = 0;
+    unsigned i;
+
+    if (n == 0)
+        return 0;
+    if (share == 0)
+        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+    worker = (ric_worker_t *)calloc(n, sizeof(worker[0]));
+    if (worker == NULL)
+        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+    memset(&shared, 0, sizeof(shared));
+    atomic32_set(&shared.failed, 0);
+    shared.count = count;
+    rc = KLockMake(&shared.lock);
+
+    for (i = 0; i < n && rc == 0; ++i) {
+        ric_worker_t *const self = &worker[i];
+
+        self->shared = &shared;
+        self->which = i;
+        self->startId = startId + (int64_t)((count * i) / n);
+        self->count = (startId + (int64_t)((count * (i + 1)) / n)) - self->startId;
+        self->pair = &pair[2 * share * i];
+        self->tmp = &self->pair[share];
+        self->pairs = share;
+        self->aci = *aci;
+        self->bci = *bci;
+        if (i == 0) {
+            self->acurs = acurs;
+            self->bcurs = bcurs;
+        }
+        else {
+            rc = ric_open_cursor(atbl, &self->aci, &self->acurs);
+            if (rc == 0)
+                rc = ric_open_cursor(btbl, &self->bci, &self->bcurs);
         }
     }
-    if (show_complete) {
-        (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
-                                 "$(aname) <-> $(bname) "
-                                 "$(pct)% complete",
-                                 "aname=%s,bname=%s,pct=%5.1f",
-                                 aci->name, bci->name,
-                                 100.0));
+    if (rc == 0) {
+        for (i = 1; i < n; ++i) {
+            if (KThreadMake(&worker[i].thread, ric_worker_thread, &worker[i]) != 0)
+                worker[i].thread = NULL;
+        }
+        ric_worker_thread(NULL, &worker[0]);
+        for (i = 1; i < n; ++i) {
+            if (worker[i].thread != NULL) {
+                rc_t rc_thread = 0;
+
+                KThreadWait(worker[i].thread, &rc_thread);
+                KThreadRelease(worker[i].thread);
+            }
+            else if (!ric_stopped(&shared, i))
+                ric_worker_thread(NULL, &worker[i]);
+        }
+        for (i = 0; i < n; ++i) {
+            ric_worker_t const *const self = &worker[i];
+
+            STSMSG(2, ("Referential Integrity: %s <-> %s rows %ld-%ld: "
+                       "load %lu ms, check %lu ms",
+                       aci->name, bci->name,
+                       self->startId, self->startId + (int64_t)self->count - 1,
+                       (uint64_t)self->load_ms, (uint64_t)self->check_ms));
+            if (rc == 0 && self->rc != 0) {
+                rc = self->rc;
+                if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcInconsistent)
+                    ric_report_pair(aci, bci, &self->bad, self->not_found);
+            }
+        }
+        if (rc == 0 && shared.show_complete) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
+                                     "$(aname) <-> $(bname) "
+                                     "$(pct)% complete",
+                                     "aname=%s,bname=%s,pct=%5.1f",
+                                     aci->name, bci->name,
+                                     100.0));
+        }
     }
-    return 0;
+    for (i = 0; i < n; ++i) {
+        if (i > 0) {
+            VCursorRelease(worker[i].acurs);
+            VCursorRelease(worker[i].bcurs);
+        }
+        free(worker[i].scratch);
+    }
+    KLockRelease(shared.lock);
+    free(worker);
+    return rc;
 }
 
-static rc_t ric_align_ref_and_align(char const dbname[],
+static rc_t ric_align_ref_and_align(const vdb_validate_params *pb,
+                                    char const dbname[],
                                     VTable const *ref,
                                     VTable const *align,
                                     int which)
@@ -1483,14 +1967,18 @@ static rc_t ric_align_ref_and_align(char const dbname[],
 									"reference table can not be read", "name=%s", dbname));
 	}
 	if (rc == 0) {
-        size_t const chunk = work_chunk(count);
+        size_t const chunk = work_chunk(count, pb->threads);
         id_pair_t *const pair = (id_pair_t *)malloc(sizeof(id_pair_t) * chunk);
 
         if (pair) {
             void *scratch = NULL;
 
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
+            if (pb->threads > 1)
+                rc = ric_align_threaded(pb->threads, startId, count, chunk, pair,
+                                        align, acurs, &aci, ref, bcurs, &bci);
+            else
+                rc = ric_align_generic(startId, count, chunk, pair, &scratch,
+                                       acurs, &aci, bcurs, &bci);
             if (scratch)
                 free(scratch);
 
@@ -1529,7 +2017,8 @@ static rc_t ric_align_ref_and_align(char const dbname[],
     return rc;
 }
 
-static rc_t ric_align_seq_and_pri(char const dbname[],
+static rc_t ric_align_seq_and_pri(const vdb_validate_params *pb,
+                                  char const dbname[],
                                   VTable const *seq,
                                   VTable const *pri)
 {
@@ -1565,14 +2054,18 @@ static rc_t ric_align_seq_and_pri(char const dbname[],
                 "sequence table can not be read", "name=%s", dbname));
     }
     if (rc == 0) {
-        size_t const chunk = work_chunk(count);
+        size_t const chunk = work_chunk(count, pb->threads);
         id_pair_t *const pair = (id_pair_t *)malloc((sizeof(id_pair_t)+sizeof(int64_t)) * chunk);
 
         if (pair) {
             void *scratch = NULL;
 
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
+            if (pb->threads > 1)
+                rc = ric_align_threaded(pb->threads, startId, count, chunk, pair,
+                                        pri, acurs, &aci, seq, bcurs, &bci);
+            else
+                rc = ric_align_generic(startId, count, chunk, pair, &scratch,
+                                       acurs, &aci, bcurs, &bci);
             if (scratch)
                 free(scratch);
 
@@ -1639,6 +2132,7 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
     id_pair_t * pri_len_pairs = NULL;
     id_pair_t *seq_spot_id_pairs = NULL;
     id_pair_t *seq_spot_read_id_pairs = NULL;
+    id_pair_t *sort_tmp = NULL;
     uint32_t *seq_read_lens = NULL;
 
     // SEQUENCE cursor
@@ -1746,6 +2240,9 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
         seq_spot_id_pairs = (id_pair_t *)malloc(sizeof(*seq_spot_id_pairs) * chunk_size);
         seq_spot_read_id_pairs = (id_pair_t *)malloc(sizeof(*seq_spot_read_id_pairs) * chunk_size);
         seq_read_lens = (uint32_t *)malloc(sizeof(*seq_read_lens) * chunk_size);
+        /* the chunks are sorted with KSORT if there is no room for the radix sort */
+        if (pb->threads > 1)
+            sort_tmp = (id_pair_t *)malloc(sizeof(*sort_tmp) * chunk_size);
 
         if (seq_spot_id_pairs == NULL)
         {
@@ -1849,7 +2346,10 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
 
             if (!ordered)
             {
-                sort_key_pairs(i_count, seq_spot_id_pairs);
+                if (sort_tmp != NULL)
+                    radix_sort_key_pairs(i_count, seq_spot_id_pairs, sort_tmp, pb->threads);
+                else
+                    sort_key_pairs(i_count, seq_spot_id_pairs);
             }
 
             // Load chunk of PRIMARY_ALIGNMENT_ID (and some other fields) and sort ids for faster data retrieval
@@ -1929,7 +2429,10 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
 
             if (!ordered)
             {
-                sort_key_pairs(i_count, pri_id_pairs);
+                if (sort_tmp != NULL)
+                    radix_sort_key_pairs(i_count, pri_id_pairs, sort_tmp, pb->threads);
+                else
+                    sort_key_pairs(i_count, pri_id_pairs);
             }
 
             for ( i = 0; i < i_count; ++i )
@@ -2050,6 +2553,7 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
     free(seq_spot_id_pairs);
     free(seq_spot_read_id_pairs);
     free(seq_read_lens);
+    free(sort_tmp);
 
     if ( rc == 0 )
     {
@@ -2151,6 +2655,16 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
 
 }
 
+/* the time a check took, shown with -v */
+static void report_check_time(const vdb_validate_params *pb,
+                              char const dbname[],
+                              char const check[],
+                              KTimeMs_t const started)
+{
+    STSMSG(1, ("Database '%s': %s took %lu ms on %u thread(s)",
+               dbname, check, (uint64_t)(KTimeMsStamp() - started), pb->threads));
+}
+
 /* database referential integrity check for alignment database */
 static rc_t dbric_align(const vdb_validate_params *pb,
                         char const dbname[],
@@ -2162,7 +2676,11 @@ static rc_t dbric_align(const vdb_validate_params *pb,
     rc_t rc = 0;
 
     if ((rc == 0 || exhaustive) && (pri != NULL && seq != NULL)) {
-        rc_t rc2 = ric_align_seq_and_pri(dbname, seq, pri);
+        KTimeMs_t const started = KTimeMsStamp();
+        rc_t rc2 = ric_align_seq_and_pri(pb, dbname, seq, pri);
+
+        report_check_time(pb, dbname, "SEQUENCE.PRIMARY_ALIGNMENT_ID <-> "
+                          "PRIMARY_ALIGNMENT.SEQ_SPOT_ID check", started);
 
         if (rc2 == 0) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
@@ -2174,7 +2692,11 @@ static rc_t dbric_align(const vdb_validate_params *pb,
         }
     }
     if ((rc == 0 || exhaustive) && (pri != NULL && ref != NULL)) {
-        rc_t rc2 = ric_align_ref_and_align(dbname, ref, pri, 0);
+        KTimeMs_t const started = KTimeMsStamp();
+        rc_t rc2 = ric_align_ref_and_align(pb, dbname, ref, pri, 0);
+
+        report_check_time(pb, dbname, "REFERENCE.PRIMARY_ALIGNMENT_IDS <-> "
+                          "PRIMARY_ALIGNMENT.REF_ID check", started);
 
         if (rc2 == 0) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
@@ -2186,7 +2708,11 @@ static rc_t dbric_align(const vdb_validate_params *pb,
         }
     }
     if (pb->sdc_enabled && (rc == 0 || exhaustive) && (pri != NULL && sec != NULL && seq != NULL)) {
+        KTimeMs_t const started = KTimeMsStamp();
         rc_t rc2 = ridc_align_seq_pri_sec(pb, dbname, seq, pri, sec);
+
+        report_check_time(pb, dbname, "SEQUENCE and SECONDARY_ALIGNMENT "
+                          "data integrity check", started);
         if (rc2 == 0) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
                 "SEQUENCE and SECONDARY_ALIGNMENT tables data integrity checks ok", "dbname=%s", dbname));
@@ -71,6 +71,9 @@ struct vdb_validate_params
         double percent;
         uint64_t number;
     } sdc_pa_len_thold;
+
+    // referential integrity checks of alignment databases run on this many threads
+    uint32_t threads;
 };
 
 rc_t vdb_validate(const vdb_validate_params *pb, const char *aPath);
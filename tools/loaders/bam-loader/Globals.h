@@ -93,6 +93,10 @@ typedef struct globals
     bool deferSecondary;
     uint32_t searchBatchSize;   ///< Max search batch size
     uint32_t numThreads;        ///< Max number of threads for batch search
+    uint32_t inflateThreads;    ///< Number of threads inflating the BGZF blocks of the input
+    uint32_t parseThreads;      ///< Number of threads parsing the lines of SAM input
+    size_t spillBudget;         ///< Memory for the packed spot names in bytes, the rest is spilled to tmpfs (0 - no limit)
+    uint32_t indexThreads;      ///< Number of threads decoding ranges of an indexed BAM file (0 - read sequentially)
     bool hasExtraLogging;       ///< Additional logging enabled
 
     size_t minBatchSize; ///< Minimum batch size for spot assembly
@@ -139,6 +139,7 @@ struct BAM_Alignment {
 
 	uint64_t keyId;
 	bool wasInserted;
+    bool inPage;                /* lives in a record page of parent */
 
     unsigned datasize;
     unsigned cigar;
@@ -166,6 +166,10 @@ static char const option_threads[] = "threads";
 static char const option_extra_logging[] = "extra-logging";
 static char const option_min_batch_size[] = "min-batch-size";
 static char const option_telemetry[] = "telemetry";
+static char const option_inflate_threads[] = "inflate-threads";
+static char const option_parse_threads[] = "parse-threads";
+static char const option_spill_budget[] = "spill-budget";
+static char const option_index_threads[] = "index-threads";
 
 #define OPTION_INPUT option_input
 #define OPTION_OUTPUT option_output
@@ -196,6 +200,10 @@ static char const option_telemetry[] = "telemetry";
 #define OPTION_EXTRA_LOGGING option_extra_logging
 #define OPTION_MIN_BATCH_SIZE option_min_batch_size
 #define OPTION_TELEMETRY option_telemetry
+#define OPTION_INFLATE_THREADS option_inflate_threads
+#define OPTION_PARSE_THREADS option_parse_threads
+#define OPTION_SPILL_BUDGET option_spill_budget
+#define OPTION_INDEX_THREADS option_index_threads
 
 
 #define ALIAS_INPUT  "i"
@@ -488,6 +496,34 @@ char const * telemetry_usage[] =
     NULL
 };
 
+static
+char const * inflate_threads_usage[] =
+{
+    "number of threads decompressing the BAM file (default: 4, 0 means on the reading thread)",
+    NULL
+};
+
+static
+char const * parse_threads_usage[] =
+{
+    "number of threads parsing the SAM file (default: 4, 0 means on the reading thread)",
+    NULL
+};
+
+static
+char const * spill_budget_usage[] =
+{
+    "memory in MB for the packed spot names, the least recently used ones above it are moved to the temporary directory (default: 0, no limit)",
+    NULL
+};
+
+static
+char const * index_threads_usage[] =
+{
+    "number of threads decoding ranges of a coordinate-sorted BAM file with a BAI or CSI index next to it, instead of the inflate threads (default: 0, read sequentially)",
+    NULL
+};
+
 OptDef Options[] =
 {
     /* order here is same as in param array below!!! */
@@ -530,6 +566,10 @@ OptDef Options[] =
     { OPTION_EXTRA_LOGGING, NULL, NULL, is_extra_logging, 1, false, false },
     { OPTION_MIN_BATCH_SIZE, NULL, NULL, min_batch_size_usage, 1, true,  false },
     { OPTION_TELEMETRY, NULL, NULL, telemetry_usage, 1, true, false },
+    { OPTION_INFLATE_THREADS, NULL, NULL, inflate_threads_usage, 1, true, false },
+    { OPTION_PARSE_THREADS, NULL, NULL, parse_threads_usage, 1, true, false },
+    { OPTION_SPILL_BUDGET, NULL, NULL, spill_budget_usage, 1, true, false },
+    { OPTION_INDEX_THREADS, NULL, NULL, index_threads_usage, 1, true, false },
 };
 
 const char* OptHelpParam[] =
@@ -573,7 +613,11 @@ const char* OptHelpParam[] =
     NULL,				/* threads */
     NULL,				/* extra logging */
     "count",     	    /* min cache size */
-    "file-name"			/* telemetry file name */
+    "file-name",		/* telemetry file name */
+    "count",			/* inflate threads */
+    "count",			/* parse threads */
+    "mbytes",			/* spill budget */
+    "count"				/* index threads */
 };
 
 rc_t UsageSummary (char const * progname)
@@ -1190,6 +1234,86 @@ static rc_t main_1(int argc, char *argv[], bool const continuing, unsigned const
             break;
         }
 
+        rc = ArgsOptionCount (args, OPTION_INFLATE_THREADS, &pcount);
+        if (rc)
+            break;
+        if (pcount == 1)
+        {
+            rc = ArgsOptionValue (args, OPTION_INFLATE_THREADS, 0, (const void **)&value);
+            if (rc)
+                break;
+
+            char* p;
+            G.inflateThreads = strtoul(value, &p, 0);
+            if ( * p != 0 )
+            {
+                rc = RC(rcApp, rcArgv, rcAccessing, rcParam, rcIncorrect);
+                OUTMSG (("inflate-threads: bad value\n"));
+                MiniUsage (args);
+                break;
+            }
+        }
+
+        rc = ArgsOptionCount (args, OPTION_PARSE_THREADS, &pcount);
+        if (rc)
+            break;
+        if (pcount == 1)
+        {
+            rc = ArgsOptionValue (args, OPTION_PARSE_THREADS, 0, (const void **)&value);
+            if (rc)
+                break;
+
+            char* p;
+            G.parseThreads = strtoul(value, &p, 0);
+            if ( * p != 0 )
+            {
+                rc = RC(rcApp, rcArgv, rcAccessing, rcParam, rcIncorrect);
+                OUTMSG (("parse-threads: bad value\n"));
+                MiniUsage (args);
+                break;
+            }
+        }
+
+        rc = ArgsOptionCount (args, OPTION_SPILL_BUDGET, &pcount);
+        if (rc)
+            break;
+        if (pcount == 1)
+        {
+            rc = ArgsOptionValue (args, OPTION_SPILL_BUDGET, 0, (const void **)&value);
+            if (rc)
+                break;
+
+            char* p;
+            G.spillBudget = strtoul(value, &p, 0) * 1024UL * 1024UL;
+            if ( * p != 0 )
+            {
+                rc = RC(rcApp, rcArgv, rcAccessing, rcParam, rcIncorrect);
+                OUTMSG (("spill-budget: bad value\n"));
+                MiniUsage (args);
+                break;
+            }
+        }
+
+        rc = ArgsOptionCount (args, OPTION_INDEX_THREADS, &pcount);
+        if (rc)
+            break;
+        if (pcount == 1)
+        {
+            rc = ArgsOptionValue (args, OPTION_INDEX_THREADS, 0, (const void **)&value);
+            if (rc)
+                break;
+
+            char* p;
+            G.indexThreads = strtoul(value, &p, 0);
+            if ( * p != 0 )
+            {
+                rc = RC(rcApp, rcArgv, rcAccessing, rcParam, rcIncorrect);
+                OUTMSG (("index-threads: bad value\n"));
+                MiniUsage (args);
+                break;
+            }
+        }
+
 
         rc = run(argv[0], n_aligned, (char const **)aligned, n_unalgnd, (char const **)unalgnd, continuing);
         break;
@@ -1359,6 +1483,10 @@ MAIN_DECL( argc, argv )
     G.minMatchCount = 10;
     G.searchBatchSize = DEFAULT_BATCH_SIZE;
     G.numThreads = 8;
+    G.inflateThreads = 4;
+    G.parseThreads = 4;
+    G.spillBudget = 0;
+    G.indexThreads = 0;
     G.minBatchSize = DEFAULT_MIN_SPOT_ASSEMPLY_BATCH_SIZE;
     if (char* env = getenv("LOADER_MEM_LIMIT_GB")) {
         G.LOADER_MEM_LIMIT_GB = atoi(env);
@@ -27,6 +27,8 @@
 #include "bam.h"
 #include "bam-alignment.h"
 
+#include <atomic.h>
+
 typedef struct BAMIndex BAMIndex;
 typedef struct BufferedFile BufferedFile;
 typedef struct SAMFile SAMFile;
@@ -63,11 +65,13 @@ struct SAMFile {
     BufferedFile file;
     int putback;
     rc_t last;
+    struct SAMThreads *mt;      /* if parsing on a pool of threads */
 };
 
 struct BGZFile {
     BufferedFile file;
     z_stream zs;
+    struct BGZFThreads *mt;     /* not NULL if the members are inflated by a pool of threads */
 };
 
 struct BAM_File {
@@ -86,6 +90,11 @@ struct BAM_File {
     void *headerData1;          /* gets used for refSeq and readGroup */
     void *headerData2;          /* gets used for refSeq */
     BAM_Alignment *nocopy;      /* used to hold current record for BAM_FileRead2 */
+    union BAM_RecordPage *pages; /* free record pages, only used by the reading thread */
+    atomic_ptr_t released;      /* record pages released by any thread */
+    uint64_t pagesFresh;        /* record pages allocated */
+    uint64_t pagesRecycled;     /* record pages reused */
+    struct BAMRangeThreads *ranges; /* not NULL if the records are read by range readers */
 
     uint64_t fpos_cur;
     uint64_t deferPos;
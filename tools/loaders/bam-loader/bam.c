@@ -36,6 +36,9 @@
 #include <klib/text.h>
 #include <klib/refcount.h>
 #include <klib/data-buffer.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 #include <insdc/sra.h>
 #include <sysalloc.h>
 
@@ -62,6 +65,9 @@
 #include <byteswap.h>
 
 #include <zlib.h>
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 
 #include "bam-priv.h"
 #include "sam.h"
@@ -197,6 +203,7 @@ static rc_t SAMFileInit(SAMFile *self, RawFile_vt *vt)
 
     self->putback = -1;
     self->last = 0;
+    self->mt = NULL;
     *vt = my_vt;
 
     return 0;
@@ -360,6 +367,384 @@ static rc_t BGZFileInit(BGZFile *const self, RawFile_vt *const vt)
     return 0;
 }
 
+/* MARK: BGZFile threaded inflate *** Start *** */
+
+/* Every member of a BGZF file is a gzip member of its own, the BC field of
+ * its header gives the size of the compressed member. So the members can
+ * be cut out of the file without inflating them and inflated in parallel.
+ * The members travel through a ring of slots in file order, the size of
+ * the ring bounds the memory used for reading ahead. Whichever thread finds
+ * a free slot reads the next member into it (one at a time) and inflates it.
+ */
+
+#define BGZF_MAX_THREADS (64u)
+#define BGZF_SLOTS_PER_THREAD (4u)
+#define BGZF_FIXED_HEADER (12u)     /* gzip header up to and including XLEN */
+#define BGZF_TRAILER (8u)           /* CRC32 and ISIZE */
+
+typedef struct BGZFSlot {
+    rc_t rc;
+    unsigned csize;             /* size of the compressed member (BSIZE + 1) */
+    unsigned dsize;             /* size of the inflated data */
+    bool done;
+    uint64_t fpos;              /* position in the file after the member */
+    zlib_block_t cdata;
+    zlib_block_t data;
+} BGZFSlot;
+
+typedef struct BGZFWorker {
+    KThread *thread;
+    struct BGZFThreads *mt;
+#ifdef HAVE_LIBDEFLATE
+    struct libdeflate_decompressor *ld;
+#else
+    z_stream zs;
+#endif
+} BGZFWorker;
+
+typedef struct BGZFThreads {
+    BufferedFile *file;         /* only touched by the thread holding 'reading' */
+    KLock *lock;
+    KCondition *cond;
+    BGZFSlot *slot;
+    BGZFWorker *worker;
+    uint64_t next_in;           /* sequence number of the next member to read */
+    uint64_t next_out;          /* sequence number of the next member to hand out */
+    uint64_t fpos;              /* position in the file after the last member handed out */
+    unsigned slots;
+    unsigned threads;
+    bool reading;
+    bool eof;                   /* reading stopped, at eof or because of an error */
+    bool quit;
+} BGZFThreads;
+
+/* copies up to len bytes out of the buffered file, refills it as needed */
+static rc_t BufferedFileReadn(BufferedFile *const self, unsigned const len, uint8_t dst[], unsigned *const numRead)
+{
+    unsigned cur = 0;
+
+    while (cur < len) {
+        unsigned n;
+
+        if (self->bpos == self->bmax) {
+            rc_t const rc = BufferedFileRead(self);
+            if (rc)
+                return rc;
+            if (self->bmax == 0)
+                break;
+        }
+        n = (unsigned)(self->bmax - self->bpos);
+        if (n > len - cur)
+            n = len - cur;
+        memmove(&dst[cur], (uint8_t const *)self->buf + self->bpos, n);
+        self->bpos += n;
+        cur += n;
+    }
+    *numRead = cur;
+    return 0;
+}
+
+/* returns (rcData, rcInsufficient) if at eof, like BGZFileRead */
+static rc_t BGZFileReadMember(BufferedFile *const file, zlib_block_t dst, unsigned *const csize)
+{
+    unsigned xlen;
+    unsigned bsize = 0;
+    unsigned n = 0;
+    unsigned i;
+    rc_t rc = BufferedFileReadn(file, BGZF_FIXED_HEADER, dst, &n);
+
+    if (rc)
+        return rc;
+    if (n == 0)
+        return RC(rcAlign, rcFile, rcReading, rcData, rcInsufficient);
+    if (n < BGZF_FIXED_HEADER)
+        return RC(rcAlign, rcFile, rcReading, rcFile, rcTooShort);
+    if (dst[0] != 31 || dst[1] != 139 || dst[2] != 8 || (dst[3] & 4) == 0)
+        return RC(rcAlign, rcFile, rcReading, rcFormat, rcInvalid); /* no gzip header with extra fields */
+
+    xlen = LE2HUI16(&dst[10]);
+    rc = BufferedFileReadn(file, xlen, &dst[BGZF_FIXED_HEADER], &n);
+    if (rc)
+        return rc;
+    if (n < xlen)
+        return RC(rcAlign, rcFile, rcReading, rcFile, rcTooShort);
+
+    for (i = 0; i + 4 <= xlen; ) {
+        uint8_t const *const extra = &dst[BGZF_FIXED_HEADER + i];
+        unsigned const slen = LE2HUI16(&extra[2]);
+
+        if (extra[0] == 'B' && extra[1] == 'C' && slen == 2 && i + 6 <= xlen) {
+            bsize = 1 + LE2HUI16(&extra[4]);
+            break;
+        }
+        i += slen + 4;
+    }
+    if (bsize < BGZF_FIXED_HEADER + xlen + BGZF_TRAILER) {
+        DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("BGZF Header extra field BC not found\n"));
+        return RC(rcAlign, rcFile, rcReading, rcFormat, rcInvalid); /* not BGZF */
+    }
+
+    rc = BufferedFileReadn(file, bsize - BGZF_FIXED_HEADER - xlen, &dst[BGZF_FIXED_HEADER + xlen], &n);
+    if (rc)
+        return rc;
+    if (n < bsize - BGZF_FIXED_HEADER - xlen) {
+        DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("EOF in Zlib block after %lu bytes\n", BufferedFileGetPos(file)));
+        return RC(rcAlign, rcFile, rcReading, rcFile, rcTooShort);
+    }
+    *csize = bsize;
+    return 0;
+}
+
+static rc_t BGZFWorkerInflate(BGZFWorker *const self, BGZFSlot *const slot)
+{
+    unsigned const xlen = LE2HUI16(&slot->cdata[10]);
+    uint8_t const *const src = &slot->cdata[BGZF_FIXED_HEADER + xlen];
+    unsigned const srcLen = slot->csize - BGZF_FIXED_HEADER - xlen - BGZF_TRAILER;
+    uint32_t const crc = LE2HUI32(&slot->cdata[slot->csize - 8]);
+    uint32_t const isize = LE2HUI32(&slot->cdata[slot->csize - 4]);
+
+    if (isize > sizeof(slot->data))
+        return RC(rcAlign, rcFile, rcReading, rcFile, rcCorrupt);
+#ifdef HAVE_LIBDEFLATE
+    {
+        size_t actual = 0;
+        enum libdeflate_result const lr = libdeflate_deflate_decompress(self->ld, src, srcLen, slot->data, isize, &actual);
+
+        if (lr != LIBDEFLATE_SUCCESS || actual != isize) {
+            DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("Unexpected libdeflate result %i\n", (int)lr));
+            return RC(rcAlign, rcFile, rcReading, rcFile, rcCorrupt);
+        }
+        if (libdeflate_crc32(0, slot->data, isize) != crc)
+            return RC(rcAlign, rcFile, rcReading, rcFile, rcCorrupt);
+    }
+#else
+    {
+        int zr;
+
+        self->zs.next_in = (Bytef *)src;
+        self->zs.avail_in = srcLen;
+        self->zs.next_out = (Bytef *)slot->data;
+        self->zs.avail_out = sizeof(slot->data);
+
+        zr = inflate(&self->zs, Z_FINISH);
+        if (zr != Z_STREAM_END || self->zs.total_out != isize) {
+            DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("Unexpected Zlib result %i: %s\n", zr, self->zs.msg ? self->zs.msg : "unknown"));
+            inflateReset(&self->zs);
+            return RC(rcAlign, rcFile, rcReading, rcFile, rcCorrupt);
+        }
+        zr = inflateReset(&self->zs);
+        assert(zr == Z_OK);
+        if (crc32(crc32(0L, Z_NULL, 0), slot->data, isize) != crc)
+            return RC(rcAlign, rcFile, rcReading, rcFile, rcCorrupt);
+    }
+#endif
+    slot->dsize = isize;
+    return 0;
+}
+
+static rc_t CC BGZFWorkerRun(KThread const *const th, void *const data)
+{
+    BGZFWorker *const self = data;
+    BGZFThreads *const mt = self->mt;
+
+    KLockAcquire(mt->lock);
+    while (!mt->quit) {
+        if (mt->reading || mt->eof || mt->next_in - mt->next_out >= mt->slots) {
+            KConditionWait(mt->cond, mt->lock);
+            continue;
+        }
+        {
+            BGZFSlot *const slot = &mt->slot[mt->next_in % mt->slots];
+
+            ++mt->next_in;
+            mt->reading = true;
+            KLockUnlock(mt->lock);
+
+            slot->rc = BGZFileReadMember(mt->file, slot->cdata, &slot->csize);
+            slot->fpos = BufferedFileGetPos(mt->file);
+            slot->dsize = 0;
+
+            KLockAcquire(mt->lock);
+            mt->reading = false;
+            if (slot->rc)
+                mt->eof = true;
+            KConditionBroadcast(mt->cond);
+            KLockUnlock(mt->lock);
+
+            if (slot->rc == 0)
+                slot->rc = BGZFWorkerInflate(self, slot);
+
+            KLockAcquire(mt->lock);
+            slot->done = true;
+            KConditionBroadcast(mt->cond);
+        }
+    }
+    KLockUnlock(mt->lock);
+    return 0;
+}
+
+/* hands out the members in file order; an error or eof stays in its slot
+ * and is returned again by the following calls, like BGZFileRead does */
+static rc_t BGZFileReadThreaded(BGZFile *const self, zlib_block_t dst, unsigned *const pNumRead)
+{
+    BGZFThreads *const mt = self->mt;
+    BGZFSlot *const slot = &mt->slot[mt->next_out % mt->slots];
+    rc_t rc;
+
+    *pNumRead = 0;
+
+    KLockAcquire(mt->lock);
+    while (!(mt->next_out < mt->next_in && slot->done))
+        KConditionWait(mt->cond, mt->lock);
+    KLockUnlock(mt->lock);
+
+    rc = slot->rc;
+    if (rc)
+        return rc;
+
+    memmove(dst, slot->data, slot->dsize);
+    *pNumRead = slot->dsize;
+    mt->fpos = slot->fpos;
+
+    KLockAcquire(mt->lock);
+    slot->done = false;
+    ++mt->next_out;
+    KConditionBroadcast(mt->cond);
+    KLockUnlock(mt->lock);
+
+    return 0;
+}
+
+static uint64_t BGZFileGetPosThreaded(BGZFile const *const self)
+{
+    return self->mt->fpos;
+}
+
+static float BGZFileProPosThreaded(BGZFile const *const self)
+{
+    return self->file.fmax == 0 ? -1.0 : (self->mt->fpos / (double)self->file.fmax);
+}
+
+/* the threads read ahead, so this is for sequential reading only */
+static rc_t BGZFileSetPosThreaded(BGZFile *const self, uint64_t const pos)
+{
+    return RC(rcAlign, rcFile, rcPositioning, rcFunction, rcUnsupported);
+}
+
+static void BGZFThreadsWhack(BGZFThreads *const self)
+{
+    unsigned i;
+
+    KLockAcquire(self->lock);
+    self->quit = true;
+    KConditionBroadcast(self->cond);
+    KLockUnlock(self->lock);
+
+    for (i = 0; i < self->threads; ++i) {
+        BGZFWorker *const worker = &self->worker[i];
+
+        if (worker->thread) {
+            rc_t rc2 = 0;
+            KThreadWait(worker->thread, &rc2);
+            KThreadRelease(worker->thread);
+        }
+#ifdef HAVE_LIBDEFLATE
+        if (worker->ld)
+            libdeflate_free_decompressor(worker->ld);
+#else
+        inflateEnd(&worker->zs);
+#endif
+    }
+    KConditionRelease(self->cond);
+    KLockRelease(self->lock);
+    free(self->worker);
+    free(self->slot);
+    free(self);
+}
+
+static void BGZFileWhackThreaded(BGZFile *self)
+{
+    BGZFThreadsWhack(self->mt);
+    self->mt = NULL;
+    BGZFileWhack(self);
+}
+
+/* switches an open BGZFile over to the pool of threads, the header has been
+ * read by then and the members following it are read by the threads */
+static rc_t BGZFileStartThreads(BGZFile *const self, RawFile_vt *const vt, unsigned const threads)
+{
+    static RawFile_vt const my_vt = {
+        (rc_t (*)(void *, zlib_block_t, unsigned *))BGZFileReadThreaded,
+        (uint64_t (*)(void const *))BGZFileGetPosThreaded,
+        (float (*)(void const *))BGZFileProPosThreaded,
+        (uint64_t (*)(void const *))BufferedFileGetSize,
+        (rc_t (*)(void *, uint64_t))BGZFileSetPosThreaded,
+        (void (*)(void *))BGZFileWhackThreaded
+    };
+    BGZFThreads *const mt = calloc(1, sizeof(*mt));
+    rc_t rc = 0;
+    unsigned i;
+
+    if (mt == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+
+    mt->file = &self->file;
+    mt->fpos = BufferedFileGetPos(&self->file);
+    mt->threads = threads;
+    mt->slots = threads * BGZF_SLOTS_PER_THREAD;
+    mt->slot = calloc(mt->slots, sizeof(mt->slot[0]));
+    mt->worker = calloc(threads, sizeof(mt->worker[0]));
+    if (mt->slot == NULL || mt->worker == NULL) {
+        free(mt->worker);
+        free(mt->slot);
+        free(mt);
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    }
+    rc = KLockMake(&mt->lock);
+    if (rc == 0)
+        rc = KConditionMake(&mt->cond);
+    if (rc) {
+        KLockRelease(mt->lock);
+        free(mt->worker);
+        free(mt->slot);
+        free(mt);
+        return rc;
+    }
+
+    for (i = 0; i < threads; ++i) {
+        BGZFWorker *const worker = &mt->worker[i];
+
+        worker->mt = mt;
+#ifdef HAVE_LIBDEFLATE
+        worker->ld = libdeflate_alloc_decompressor();
+        if (worker->ld == NULL)
+            rc = RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+#else
+        switch (inflateInit2(&worker->zs, -MAX_WBITS)) { /* raw deflate, the headers are parsed by us */
+        case Z_OK:
+            break;
+        case Z_MEM_ERROR:
+            rc = RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+            break;
+        default:
+            rc = RC(rcAlign, rcFile, rcConstructing, rcNoObj, rcUnexpected);
+            break;
+        }
+#endif
+        if (rc == 0)
+            rc = KThreadMake(&worker->thread, BGZFWorkerRun, worker);
+        if (rc) {
+            mt->threads = i + 1;
+            BGZFThreadsWhack(mt);
+            return rc;
+        }
+    }
+    self->mt = mt;
+    *vt = my_vt;
+    DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("Inflating BGZF members on %u threads\n", threads));
+    return 0;
+}
+
 static const char cigarChars[] = {
     ct_Match,
     ct_Insert,
@@ -1378,9 +1763,107 @@ static rc_t ProcessSAMHeader(BAM_File *self, char const substitute[])
     return rc;
 }
 
+/* MARK: BAM Alignment record pages */
+
+/* The detached records (see BAM_AlignmentDetach) are handed from the reading
+ * thread to another thread, which releases them. Instead of going through
+ * malloc and free for every record, the records live in pages of a fixed
+ * size, which are recycled: a released page is pushed onto a lock-free stack
+ * (any thread may release), the reading thread takes the whole stack at once
+ * when it runs out of pages. Since nobody else pops, there is no ABA problem.
+ * Records too big for a page are allocated as before.
+ */
+
+#define BAM_RECORD_PAGE_SIZE (4096u)
+
+typedef union BAM_RecordPage {
+    union BAM_RecordPage *next;     /* while the page is free */
+    uint64_t align;
+    uint8_t data[BAM_RECORD_PAGE_SIZE];
+} BAM_RecordPage;
+
+/* reading thread only */
+static BAM_RecordPage *BAM_FileGetPage(BAM_File *const self)
+{
+    BAM_RecordPage *page = self->pages;
+
+    if (page == NULL) {
+        void *head = atomic_read_ptr(&self->released);
+
+        while (head != NULL) {
+            void *const prior = atomic_test_and_set_ptr(&self->released, NULL, head);
+            if (prior == head)
+                break;
+            head = prior;
+        }
+        page = head;
+    }
+    if (page != NULL) {
+        self->pages = page->next;
+        ++self->pagesRecycled;
+    }
+    else if ((page = malloc(sizeof(*page))) != NULL)
+        ++self->pagesFresh;
+    return page;
+}
+
+/* any thread */
+static void BAM_FileReleasePage(BAM_File *const self, BAM_RecordPage *const page)
+{
+    void *head = atomic_read_ptr(&self->released);
+
+    for ( ; ; ) {
+        void *prior;
+
+        page->next = head;
+        prior = atomic_test_and_set_ptr(&self->released, page, head);
+        if (prior == head)
+            break;
+        head = prior;
+    }
+}
+
+static void BAM_FileWhackPages(BAM_File *const self)
+{
+    BAM_RecordPage *page = self->pages;
+
+    for (self->pages = NULL; page != NULL; ) {
+        BAM_RecordPage *const next = page->next;
+        free(page);
+        page = next;
+    }
+    page = atomic_read_ptr(&self->released);
+    while (page != NULL) {
+        BAM_RecordPage *const next = page->next;
+        free(page);
+        page = next;
+    }
+}
+
+static void BAMRangeThreadsGetPageCounts(struct BAMRangeThreads const *self, uint64_t *fresh, uint64_t *recycled);
+
+rc_t BAM_FileGetRecordPageCounts(const BAM_File *self, uint64_t *fresh, uint64_t *recycled)
+{
+    if (self == NULL)
+        return RC(rcAlign, rcFile, rcAccessing, rcSelf, rcNull);
+    if (fresh == NULL || recycled == NULL)
+        return RC(rcAlign, rcFile, rcAccessing, rcParam, rcNull);
+    *fresh = self->pagesFresh;
+    *recycled = self->pagesRecycled;
+    if (self->ranges)
+        BAMRangeThreadsGetPageCounts(self->ranges, fresh, recycled);
+    return 0;
+}
+
 /* MARK: BAM File destructor */
 
+static void BAMRangeThreadsWhack(struct BAMRangeThreads *self);
+
 static void BAM_FileWhack(BAM_File *self) {
+    if (self->ranges)
+        BAMRangeThreadsWhack(self->ranges); /* first, the records buffered by them live in their files */
+    if (self->vt.FileWhack)
+        self->vt.FileWhack(&self->file); /* first, the threads parsing SAM use refSeq */
     if (self->refSeqs > 0 && self->refSeq)
         free(self->refSeq);
     if (self->readGroup)
@@ -1393,8 +1876,7 @@ static void BAM_FileWhack(BAM_File *self) {
         free((void *)self->headerData2);
     if (self->nocopy)
         free(self->nocopy);
-    if (self->vt.FileWhack)
-        self->vt.FileWhack(&self->file);
+    BAM_FileWhackPages(self);
     KFileRelease(self->defer);
     BufferedFileWhack(&self->file.bam.file);
 }
@@ -1494,6 +1976,19 @@ rc_t BAM_FileMake(const BAM_File **cself,
     return rc;
 }
 
+rc_t BAM_FileSetInflateThreads(const BAM_File *cself, unsigned threads)
+{
+    BAM_File *const self = (BAM_File *)cself;
+
+    if (self == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcSelf, rcNull);
+
+    if (self->isSAM || threads == 0 || self->file.bam.mt != NULL || self->ranges != NULL)
+        return 0;
+
+    return BGZFileStartThreads(&self->file.bam, &self->vt, threads < BGZF_MAX_THREADS ? threads : BGZF_MAX_THREADS);
+}
+
 /* MARK: BAM File ref-counting */
 
 rc_t BAM_FileAddRef(const BAM_File *cself) {
@@ -1514,6 +2009,11 @@ rc_t BAM_FileRelease(const BAM_File *cself) {
 
 float BAM_FileGetProportionalPosition(const BAM_File *self)
 {
+    if (self->ranges) {
+        /* the file itself is not read, fpos_cur follows the records handed out */
+        uint64_t const fmax = self->vt.FileGetSize(&self->file);
+        return fmax == 0 ? -1.0 : (self->fpos_cur / (double)fmax);
+    }
     return self->vt.FileProPos(&self->file);
 }
 
@@ -1532,6 +2032,47 @@ static void BAM_FileAdvance(BAM_File *const self, unsigned distance)
     }
 }
 
+rc_t BAM_FileSetPosition(const BAM_File *cself, const BAM_FilePosition *pos)
+{
+    BAM_File *const self = (BAM_File *)cself;
+    BGZFile *const file = &self->file.bam;
+    uint64_t fpos;
+    unsigned bpos;
+
+    if (self == NULL)
+        return RC(rcAlign, rcFile, rcPositioning, rcSelf, rcNull);
+    if (pos == NULL)
+        return RC(rcAlign, rcFile, rcPositioning, rcParam, rcNull);
+    if (self->isSAM || file->mt != NULL || self->ranges != NULL)
+        return RC(rcAlign, rcFile, rcPositioning, rcFunction, rcUnsupported);
+
+    fpos = *pos >> 16;
+    bpos = (unsigned)(*pos & 0xFFFF);
+
+    if (fpos != self->fpos_cur || self->bufSize == 0) {
+        rc_t rc = self->vt.FileSetPos(&file->file, fpos);
+        if (rc) return rc;
+
+        /* the member starts at the read head of the buffered file */
+        inflateReset(&file->zs);
+        file->zs.next_in = (Bytef *)file->file.buf + file->file.bpos;
+        file->zs.avail_in = (uInt)(file->file.bmax - file->file.bpos);
+
+        self->fpos_cur = fpos;
+        self->bufCurrent = 0;
+        self->bufSize = 0;
+        rc = BAM_FileFillBuffer(self);
+        if (rc) return rc;
+    }
+    if (bpos > self->bufSize)
+        return RC(rcAlign, rcFile, rcPositioning, rcParam, rcOutofrange);
+
+    self->eof = false;
+    self->bufCurrent = 0;
+    BAM_FileAdvance(self, bpos); /* the end of a member is the start of the next one */
+    return 0;
+}
+
 /* MARK: BAM Alignment contruction */
 
 static int TagTypeSize(int const type)
@@ -2011,48 +2552,505 @@ static rc_t BAM_FileReadSAM_1(BAM_File *const self, KDataBuffer *data, KDataBuff
     return rc;
 }
 
-static rc_t BAM_FileReadSAM(BAM_File *const self, BAM_Alignment **const rslt)
-{
-    KDataBuffer data;
-    KDataBuffer offsets;
-    SAM2BAM_Parser *parser = NULL;
-    rc_t rc = 0;
+/* MARK: SAM threaded parsing *** Start *** */
 
-    memset(&data, 0, sizeof(data));
-    memset(&offsets, 0, sizeof(offsets));
+/* The lines of a SAM file don't depend on each other, so the file is cut
+ * into chunks of whole lines and the lines are parsed into BAM records on a
+ * pool of threads. Like the members of a BGZF file (see above) the chunks
+ * travel through a ring of slots in file order. Whichever thread finds a
+ * free slot reads the next chunk into it (one at a time) and parses it, the
+ * records of a chunk are handed out in the order of its lines.
+ */
 
-    rc = KDataBufferMakeBytes(&data, 65536);
-    if (rc) return rc;
+#define SAM_MAX_THREADS (64u)
+#define SAM_SLOTS_PER_THREAD (2u)
+#define SAM_CHUNK_SIZE (1024u * 1024u)
 
-    rc = KDataBufferMake(&offsets, sizeof(unsigned) * 8, 4080 / sizeof(unsigned));
-    if (rc == 0) {
-        rc = BAM_FileReadSAM_1(self, &data, &offsets);
-        if (rc == 0) {
-            RefNameLookupContext ctx;
+typedef struct SAMRecord {
+    rc_t rc;
+    unsigned numExtra;
+    size_t offset;              /* of the BAM record in the data of the chunk */
+    size_t size;
+} SAMRecord;
 
-            ctx.refSeq = self->refSeq;
-            ctx.refSeqs = self->refSeqs;
-            ctx.depth = 0;
+typedef struct SAMChunk {
+    rc_t rc;
+    bool done;
+    uint64_t fpos;              /* position in the file after the chunk */
+    char *text;                 /* whole lines, only the last one at eof may be incomplete */
+    size_t textSize;
+    size_t textMax;
+    SAMRecord *record;
+    size_t records;
+    size_t recordMax;
+    uint8_t *data;              /* the BAM records */
+    size_t dataSize;
+    size_t dataMax;
+} SAMChunk;
+
+typedef struct SAMWorker {
+    KThread *thread;
+    struct SAMThreads *mt;
+    unsigned *offset;           /* of the fields of a line, like BAM_FileReadSAM_SplitLine */
+    size_t offsetMax;
+    zlib_block_t buffer;
+} SAMWorker;
+
+typedef struct SAMThreads {
+    SAMFile *file;              /* only touched by the thread holding 'reading' */
+    BAMRefSeq *refSeq;          /* only read by the threads */
+    unsigned refSeqs;
+    KLock *lock;
+    KCondition *cond;
+    SAMChunk *slot;
+    SAMWorker *worker;
+    char *carry;                /* the incomplete line at the end of the last chunk read */
+    size_t carrySize;
+    size_t carryMax;
+    uint64_t next_in;           /* sequence number of the next chunk to read */
+    uint64_t next_out;          /* sequence number of the next chunk to hand out */
+    uint64_t fpos;              /* position in the file after the chunk being handed out */
+    size_t current;             /* next record of the chunk being handed out */
+    unsigned slots;
+    unsigned threads;
+    bool reading;
+    bool eof;                   /* reading stopped, at eof or because of an error */
+    bool quit;
+} SAMThreads;
+
+/* returns the (possibly moved) array with room for at least 'need' elements
+ * or NULL, the array is left alone then */
+static void *SAMThreadsGrow(void *const array, size_t *const max, size_t const need, size_t const elemSize)
+{
+    size_t newMax = *max > 0 ? *max : 64;
+    void *rslt;
+
+    if (need <= *max)
+        return array;
+    while (newMax < need)
+        newMax *= 2;
+    rslt = realloc(array, newMax * elemSize);
+    if (rslt != NULL)
+        *max = newMax;
+    return rslt;
+}
+
+/* returns (rcRow, rcNotFound) at eof, like BAM_FileReadSAM_1 */
+static rc_t SAMChunkRead(SAMThreads *const mt, SAMChunk *const chunk)
+{
+    size_t have = mt->carrySize;
+    size_t end = 0;
+    bool eof = false;
+    char *text;
+
+    chunk->textSize = 0;
+    chunk->records = 0;
+    chunk->dataSize = 0;
+
+    text = SAMThreadsGrow(chunk->text, &chunk->textMax, have > SAM_CHUNK_SIZE ? have : SAM_CHUNK_SIZE, 1);
+    if (text == NULL)
+        return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+    chunk->text = text;
+    if (have > 0)
+        memmove(chunk->text, mt->carry, have);
+    mt->carrySize = 0;
 
-            parser = SAM2BAM_Parser_parse(data.base, offsets.elem_count, offsets.base, self->buffer, sizeof(self->buffer), BAM_FileRefNameIncrementalLookup, &ctx, &rc);
-        }
-    }
-    if (parser) {
-        if (rc == 0) {
-            assert(parser->field >= 11);
-            *rslt = BAM_FileMakeAlignment(self, parser->rslt_size, parser->rslt, parser->field - 11, &rc);
-            if ((**rslt).storage == (void *)parser->rslt)
-                parser->rslt = NULL; /* ownership was transfered */
+    for ( ; ; ) {
+        while (have < chunk->textMax && !eof) {
+            size_t const want = chunk->textMax - have;
+            unsigned const len = want < ZLIB_BLOCK_SIZE * 64u ? (unsigned)want : ZLIB_BLOCK_SIZE * 64u;
+            unsigned n = 0;
+            rc_t const rc = BufferedFileReadn(&mt->file->file, len, (uint8_t *)&chunk->text[have], &n);
+
+            if (rc)
+                return rc;
+            have += n;
+            eof = n < len;
         }
-        if (parser->rslt != NULL && (void *)parser->rslt != (void *)self->buffer)
-            free(parser->rslt);
-        free(parser);
+        for (end = have; end > 0 && chunk->text[end - 1] != '\n'; --end)
+            ;
+        if (end > 0 || eof)
+            break;
+        /* the line is longer than the chunk */
+        text = SAMThreadsGrow(chunk->text, &chunk->textMax, have * 2, 1);
+        if (text == NULL)
+            return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+        chunk->text = text;
+    }
+    if (end == 0)
+        end = have; /* at eof without a line-feed */
+    if (end < have) {
+        char *const carry = SAMThreadsGrow(mt->carry, &mt->carryMax, have - end, 1);
+
+        if (carry == NULL)
+            return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+        mt->carry = carry;
+        mt->carrySize = have - end;
+        memmove(mt->carry, &chunk->text[end], mt->carrySize);
+    }
+    if (end == 0)
+        return SILENT_RC(rcAlign, rcFile, rcReading, rcRow, rcNotFound);
+
+    chunk->textSize = end;
+    chunk->fpos = BufferedFileGetPos(&mt->file->file) - mt->carrySize;
+    return 0;
+}
+
+/* the records of the lines which can't be parsed carry the error */
+static rc_t SAMWorkerParse(SAMWorker *const self, SAMChunk *const chunk)
+{
+    SAMThreads const *const mt = self->mt;
+    size_t pos = 0;
+
+    while (pos < chunk->textSize) {
+        char *const line = &chunk->text[pos];
+        char *const lf = memchr(line, '\n', chunk->textSize - pos);
+        size_t const len = lf ? (size_t)(lf - line) : chunk->textSize - pos;
+        size_t const end = (len > 0 && line[len - 1] == '\r') ? len - 1 : len;
+        SAMRecord *const record = SAMThreadsGrow(chunk->record, &chunk->recordMax, chunk->records + 1, sizeof(chunk->record[0]));
+        SAMRecord *rec;
+        SAM2BAM_Parser *parser;
+        RefNameLookupContext ctx;
+        unsigned fields = 0;
+        size_t i;
+        rc_t rc = 0;
+
+        if (record == NULL)
+            return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+        chunk->record = record;
+        rec = &chunk->record[chunk->records++];
+        memset(rec, 0, sizeof(*rec));
+        pos += len + 1;
+        if (lf == NULL) {
+            rec->rc = RC(rcAlign, rcFile, rcReading, rcFile, rcTooShort);
+            break;
+        }
+
+        /* the fields are nul-terminated (CR-LF is a line-feed), the offsets
+         * point past the terminators, like BAM_FileReadSAM_1 */
+        for (i = 0; i <= end; ++i) {
+            if (i < end && line[i] != '\t')
+                continue;
+            if (fields == self->offsetMax) {
+                unsigned *const offset = SAMThreadsGrow(self->offset, &self->offsetMax, fields + 1, sizeof(self->offset[0]));
+
+                if (offset == NULL)
+                    return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+                self->offset = offset;
+            }
+            line[i] = '\0';
+            self->offset[fields++] = (unsigned)(i + 1);
+        }
+
+        ctx.refSeq = mt->refSeq;
+        ctx.refSeqs = mt->refSeqs;
+        ctx.depth = 0;
+
+        parser = SAM2BAM_Parser_parse(line, fields, self->offset, self->buffer, sizeof(self->buffer), BAM_FileRefNameIncrementalLookup, &ctx, &rc);
+        if (parser) {
+            if (rc == 0) {
+                uint8_t *const data = SAMThreadsGrow(chunk->data, &chunk->dataMax, chunk->dataSize + parser->rslt_size, 1);
+
+                assert(parser->field >= 11);
+                if (data != NULL) {
+                    chunk->data = data;
+                    memmove(&chunk->data[chunk->dataSize], parser->rslt, parser->rslt_size);
+                    rec->offset = chunk->dataSize;
+                    rec->size = parser->rslt_size;
+                    rec->numExtra = parser->field - 11;
+                    chunk->dataSize += parser->rslt_size;
+                }
+                else
+                    rc = RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+            }
+            if (parser->rslt != NULL && (void *)parser->rslt != (void *)self->buffer)
+                free(parser->rslt);
+            free(parser);
+        }
+        rec->rc = rc;
+    }
+    return 0;
+}
+
+static rc_t CC SAMWorkerRun(KThread const *const th, void *const data)
+{
+    SAMWorker *const self = data;
+    SAMThreads *const mt = self->mt;
+
+    KLockAcquire(mt->lock);
+    while (!mt->quit) {
+        if (mt->reading || mt->eof || mt->next_in - mt->next_out >= mt->slots) {
+            KConditionWait(mt->cond, mt->lock);
+            continue;
+        }
+        {
+            SAMChunk *const chunk = &mt->slot[mt->next_in % mt->slots];
+
+            ++mt->next_in;
+            mt->reading = true;
+            KLockUnlock(mt->lock);
+
+            chunk->rc = SAMChunkRead(mt, chunk);
+
+            KLockAcquire(mt->lock);
+            mt->reading = false;
+            if (chunk->rc)
+                mt->eof = true;
+            KConditionBroadcast(mt->cond);
+            KLockUnlock(mt->lock);
+
+            if (chunk->rc == 0)
+                chunk->rc = SAMWorkerParse(self, chunk);
+
+            KLockAcquire(mt->lock);
+            chunk->done = true;
+            KConditionBroadcast(mt->cond);
+        }
+    }
+    KLockUnlock(mt->lock);
+    return 0;
+}
+
+/* hands out the records in file order; an error of a chunk or eof stays in
+ * its slot and is returned again by the following calls */
+static rc_t BAM_FileReadSAMThreaded(BAM_File *const self, BAM_Alignment **const rslt)
+{
+    SAMThreads *const mt = self->file.sam.mt;
+    SAMRecord const *rec = NULL;
+    SAMChunk *chunk;
+    void *storage = NULL;
+    void *data = self->buffer;
+    rc_t rc = 0;
+
+    for ( ; ; ) {
+        chunk = &mt->slot[mt->next_out % mt->slots];
+
+        KLockAcquire(mt->lock);
+        while (!(mt->next_out < mt->next_in && chunk->done))
+            KConditionWait(mt->cond, mt->lock);
+        KLockUnlock(mt->lock);
+
+        if (chunk->rc)
+            return chunk->rc;
+
+        mt->fpos = chunk->fpos;
+        if (mt->current < chunk->records) {
+            rec = &chunk->record[mt->current++];
+            break;
+        }
+        mt->current = 0;
+
+        KLockAcquire(mt->lock);
+        chunk->done = false;
+        ++mt->next_out;
+        KConditionBroadcast(mt->cond);
+        KLockUnlock(mt->lock);
+    }
+    if (rec->rc)
+        return rec->rc;
+
+    if (rec->size > sizeof(self->buffer)) {
+        storage = data = malloc(rec->size);
+        if (data == NULL)
+            return RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+    }
+    memmove(data, &chunk->data[rec->offset], rec->size);
+    *rslt = BAM_FileMakeAlignment(self, rec->size, data, rec->numExtra, &rc);
+    if (*rslt != NULL && (**rslt).storage == storage)
+        storage = NULL; /* ownership was transfered */
+    free(storage);
+    return rc;
+}
+
+static uint64_t SAMFileGetPosThreaded(SAMFile const *const self)
+{
+    return self->mt->fpos;
+}
+
+static float SAMFileProPosThreaded(SAMFile const *const self)
+{
+    return self->file.fmax == 0 ? -1.0 : (self->mt->fpos / (double)self->file.fmax);
+}
+
+/* the threads read ahead, so this is for sequential reading only */
+static rc_t SAMFileSetPosThreaded(SAMFile *const self, uint64_t const pos)
+{
+    return RC(rcAlign, rcFile, rcPositioning, rcFunction, rcUnsupported);
+}
+
+static void SAMThreadsWhack(SAMThreads *const self)
+{
+    unsigned i;
+
+    KLockAcquire(self->lock);
+    self->quit = true;
+    KConditionBroadcast(self->cond);
+    KLockUnlock(self->lock);
+
+    for (i = 0; i < self->threads; ++i) {
+        SAMWorker *const worker = &self->worker[i];
+
+        if (worker->thread) {
+            rc_t rc2 = 0;
+            KThreadWait(worker->thread, &rc2);
+            KThreadRelease(worker->thread);
+        }
+        free(worker->offset);
+    }
+    for (i = 0; i < self->slots; ++i) {
+        free(self->slot[i].text);
+        free(self->slot[i].record);
+        free(self->slot[i].data);
+    }
+    KConditionRelease(self->cond);
+    KLockRelease(self->lock);
+    free(self->carry);
+    free(self->worker);
+    free(self->slot);
+    free(self);
+}
+
+static void SAMFileWhackThreaded(SAMFile *self)
+{
+    SAMThreadsWhack(self->mt);
+    self->mt = NULL;
+}
+
+/* switches an open SAMFile over to the pool of threads, the header has been
+ * read by then and the lines following it are read by the threads */
+static rc_t SAMFileStartThreads(SAMFile *const self, RawFile_vt *const vt, BAMRefSeq *const refSeq, unsigned const refSeqs, unsigned const threads)
+{
+    static RawFile_vt const my_vt = {
+        (rc_t (*)(void *, zlib_block_t, unsigned *))NULL,
+        (uint64_t (*)(void const *))SAMFileGetPosThreaded,
+        (float (*)(void const *))SAMFileProPosThreaded,
+        (uint64_t (*)(void const *))BufferedFileGetSize,
+        (rc_t (*)(void *, uint64_t))SAMFileSetPosThreaded,
+        (void (*)(void *))SAMFileWhackThreaded
+    };
+    SAMThreads *const mt = calloc(1, sizeof(*mt));
+    rc_t rc = 0;
+    unsigned i;
+
+    if (mt == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+
+    mt->file = self;
+    mt->refSeq = refSeq;
+    mt->refSeqs = refSeqs;
+    mt->fpos = BufferedFileGetPos(&self->file);
+    mt->threads = threads;
+    mt->slots = threads * SAM_SLOTS_PER_THREAD;
+    mt->slot = calloc(mt->slots, sizeof(mt->slot[0]));
+    mt->worker = calloc(threads, sizeof(mt->worker[0]));
+    if (mt->slot == NULL || mt->worker == NULL) {
+        free(mt->worker);
+        free(mt->slot);
+        free(mt);
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    }
+    if (self->putback >= 0) {
+        /* the first character of the records was put back by ProcessSAMHeader */
+        mt->carry = SAMThreadsGrow(NULL, &mt->carryMax, 1, 1);
+        if (mt->carry == NULL) {
+            free(mt->worker);
+            free(mt->slot);
+            free(mt);
+            return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+        }
+        mt->carry[0] = (char)self->putback;
+        mt->carrySize = 1;
+        self->putback = -1;
+    }
+    rc = KLockMake(&mt->lock);
+    if (rc == 0)
+        rc = KConditionMake(&mt->cond);
+    if (rc) {
+        KLockRelease(mt->lock);
+        free(mt->carry);
+        free(mt->worker);
+        free(mt->slot);
+        free(mt);
+        return rc;
+    }
+
+    for (i = 0; i < threads; ++i) {
+        SAMWorker *const worker = &mt->worker[i];
+
+        worker->mt = mt;
+        rc = KThreadMake(&worker->thread, SAMWorkerRun, worker);
+        if (rc) {
+            mt->threads = i + 1;
+            SAMThreadsWhack(mt);
+            return rc;
+        }
+    }
+    self->mt = mt;
+    *vt = my_vt;
+    DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("Parsing SAM lines on %u threads\n", threads));
+    return 0;
+}
+
+rc_t BAM_FileSetParseThreads(const BAM_File *cself, unsigned threads)
+{
+    BAM_File *const self = (BAM_File *)cself;
+
+    if (self == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcSelf, rcNull);
+
+    if (!self->isSAM || threads == 0 || self->file.sam.mt != NULL)
+        return 0;
+
+    return SAMFileStartThreads(&self->file.sam, &self->vt, self->refSeq, self->refSeqs, threads < SAM_MAX_THREADS ? threads : SAM_MAX_THREADS);
+}
+
+static rc_t BAM_FileReadSAM(BAM_File *const self, BAM_Alignment **const rslt)
+{
+    KDataBuffer data;
+    KDataBuffer offsets;
+    SAM2BAM_Parser *parser = NULL;
+    rc_t rc = 0;
+
+    if (self->file.sam.mt)
+        return BAM_FileReadSAMThreaded(self, rslt);
+
+    memset(&data, 0, sizeof(data));
+    memset(&offsets, 0, sizeof(offsets));
+
+    rc = KDataBufferMakeBytes(&data, 65536);
+    if (rc) return rc;
+
+    rc = KDataBufferMake(&offsets, sizeof(unsigned) * 8, 4080 / sizeof(unsigned));
+    if (rc == 0) {
+        rc = BAM_FileReadSAM_1(self, &data, &offsets);
+        if (rc == 0) {
+            RefNameLookupContext ctx;
+
+            ctx.refSeq = self->refSeq;
+            ctx.refSeqs = self->refSeqs;
+            ctx.depth = 0;
+
+            parser = SAM2BAM_Parser_parse(data.base, offsets.elem_count, offsets.base, self->buffer, sizeof(self->buffer), BAM_FileRefNameIncrementalLookup, &ctx, &rc);
+        }
+    }
+    if (parser) {
+        if (rc == 0) {
+            assert(parser->field >= 11);
+            *rslt = BAM_FileMakeAlignment(self, parser->rslt_size, parser->rslt, parser->field - 11, &rc);
+            if ((**rslt).storage == (void *)parser->rslt)
+                parser->rslt = NULL; /* ownership was transfered */
+        }
+        if (parser->rslt != NULL && (void *)parser->rslt != (void *)self->buffer)
+            free(parser->rslt);
+        free(parser);
     }
     KDataBufferWhack(&offsets);
     KDataBufferWhack(&data);
     return rc;
 }
 
+static rc_t BAMRangeThreadsRead(BAM_File *self, BAM_Alignment **rslt);
+
 static rc_t read2(BAM_File *const self, BAM_Alignment **const rhs)
 {
     rc_t rc;
@@ -2060,6 +3058,13 @@ static rc_t read2(BAM_File *const self, BAM_Alignment **const rhs)
     if (self->bufCurrent >= self->bufSize && self->eof)
         return SILENT_RC(rcAlign, rcFile, rcReading, rcRow, rcNotFound);
 
+    if (self->ranges) {
+        rc = BAMRangeThreadsRead(self, rhs);
+        if (rc != 0 && GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound)
+            self->eof = true;
+        return rc;
+    }
+
     if (self->isSAM) {
         rc = BAM_FileReadSAM(self, rhs);
         if (rc != 0 && GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound)
@@ -2203,6 +3208,647 @@ rc_t BAM_FileRead(const BAM_File *cself, const BAM_Alignment **rhs)
     abort();
 }
 
+/* MARK: BAM File indexed ranges *** Start *** */
+
+/* The index of a coordinate-sorted BAM file (BAI or CSI) holds the virtual
+ * offsets of many records: the starts of the chunks of the bins and the
+ * linear index. Cut at such offsets, the file falls into ranges, which can be
+ * decoded independently: every range reader has a BAM_File of its own, seeks
+ * to the start of a range and reads up to the start of the next one. The
+ * records are handed out range by range, so in file order. Only a bounded
+ * number of records is buffered per range and only a bounded number of
+ * ranges is read ahead of the one being handed out.
+ */
+
+#define BAM_RANGE_MAX_THREADS (64u)
+#define BAM_RANGES_PER_THREAD (16u)
+#define BAM_RANGE_MIN_SIZE (4u * 1024u * 1024u)  /* compressed bytes */
+#define BAM_RANGE_RECORDS (4096u)               /* records buffered per range */
+#define BAM_RANGE_BATCH (256u)                  /* records moved at once */
+#define BAM_RANGE_EOF (~(uint64_t)0)
+#define BAI_PSEUDO_BIN (37450u)                 /* the bin with the statistics of a reference */
+
+typedef struct BAMRange {
+    uint64_t beg;               /* virtual offset of the first record */
+    uint64_t end;               /* virtual offset of the first record of the next range */
+    uint64_t pos;               /* virtual offset after the last record put into the ring */
+    BAM_Alignment **ring;       /* allocated while the range is read and handed out */
+    unsigned head;              /* next record to hand out */
+    unsigned count;             /* records in the ring */
+    rc_t rc;                    /* why reading stopped, returned after the records */
+    bool done;
+} BAMRange;
+
+typedef struct BAMRangeWorker {
+    KThread *thread;
+    struct BAMRangeThreads *mt;
+    BAM_File *file;             /* a reader of its own */
+} BAMRangeWorker;
+
+typedef struct BAMRangeThreads {
+    KLock *lock;
+    KCondition *cond;
+    BAMRange *range;
+    BAMRangeWorker *worker;
+    unsigned ranges;
+    unsigned next_in;           /* next range to read */
+    unsigned next_out;          /* range being handed out */
+    unsigned threads;
+    unsigned batchSize;
+    unsigned batchNext;
+    bool quit;
+    BAM_Alignment *batch[BAM_RANGE_BATCH]; /* taken out of a ring, handed out without locking */
+} BAMRangeThreads;
+
+typedef struct BAMIndexCursor {
+    uint8_t const *cur;
+    uint8_t const *end;
+    bool bad;                   /* read past the end */
+} BAMIndexCursor;
+
+static uint32_t BAMIndexCursorU32(BAMIndexCursor *const self)
+{
+    uint32_t value = 0;
+
+    if (self->end - self->cur < 4)
+        self->bad = true;
+    else {
+        value = LE2HUI32(self->cur);
+        self->cur += 4;
+    }
+    return value;
+}
+
+static uint64_t BAMIndexCursorU64(BAMIndexCursor *const self)
+{
+    uint64_t value = 0;
+
+    if (self->end - self->cur < 8)
+        self->bad = true;
+    else {
+        value = LE2HUI64(self->cur);
+        self->cur += 8;
+    }
+    return value;
+}
+
+static void BAMIndexCursorSkip(BAMIndexCursor *const self, uint32_t const count)
+{
+    if ((size_t)(self->end - self->cur) < count)
+        self->bad = true;
+    else
+        self->cur += count;
+}
+
+typedef struct BAMIndexOffsets {
+    uint64_t *offset;
+    size_t count;
+    size_t max;
+} BAMIndexOffsets;
+
+static bool BAMIndexOffsetsAdd(BAMIndexOffsets *const self, uint64_t const offset)
+{
+    if (self->count == self->max) {
+        size_t const max = self->max ? self->max * 2 : 4096;
+        void *const tmp = realloc(self->offset, max * sizeof(self->offset[0]));
+
+        if (tmp == NULL)
+            return false;
+        self->offset = tmp;
+        self->max = max;
+    }
+    self->offset[self->count++] = offset;
+    return true;
+}
+
+static int64_t BAMIndexOffsetsCompare(void const *A, void const *B, void *ignored)
+{
+    uint64_t const a = *(uint64_t const *)A;
+    uint64_t const b = *(uint64_t const *)B;
+
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+/* opens path.bai, path.csi or the same with the .bam of path replaced */
+static rc_t BAMIndexOpen(KDirectory const *const dir, char const path[], KFile const **const kf)
+{
+    static char const *const ext[] = { "bai", "csi" };
+    size_t const len = strlen(path);
+    unsigned i;
+
+    for (i = 0; i < 2; ++i) {
+        if (KDirectoryOpenFileRead(dir, kf, "%s.%s", path, ext[i]) == 0)
+            return 0;
+    }
+    if (len > 4 && strcmp(path + len - 4, ".bam") == 0) {
+        for (i = 0; i < 2; ++i) {
+            if (KDirectoryOpenFileRead(dir, kf, "%.*s.%s", (int)(len - 4), path, ext[i]) == 0)
+                return 0;
+        }
+    }
+    return SILENT_RC(rcAlign, rcIndex, rcOpening, rcFile, rcNotFound);
+}
+
+/* a CSI file is BGZF, every member is a gzip member of its own */
+static rc_t BAMIndexInflate(uint8_t const src[], size_t const ssize, uint8_t **const rslt, size_t *const rsize)
+{
+    size_t max = ssize * 4;
+    uint8_t *data = malloc(max);
+    rc_t rc = 0;
+    z_stream zs;
+
+    if (data == NULL)
+        return RC(rcAlign, rcIndex, rcReading, rcMemory, rcExhausted);
+    memset(&zs, 0, sizeof(zs));
+    if (ssize > UINT_MAX || inflateInit2(&zs, MAX_WBITS + 16) != Z_OK) {
+        free(data);
+        return RC(rcAlign, rcIndex, rcReading, rcNoObj, rcUnexpected);
+    }
+    zs.next_in = (Bytef *)src;
+    zs.avail_in = (uInt)ssize;
+    zs.next_out = data;
+    for ( ; ; ) {
+        size_t const size = zs.next_out - data;
+        int zr;
+
+        if (size == max || max - size < 1024) {
+            void *const tmp = realloc(data, max * 2);
+            if (tmp == NULL) {
+                rc = RC(rcAlign, rcIndex, rcReading, rcMemory, rcExhausted);
+                break;
+            }
+            data = tmp;
+            max *= 2;
+            zs.next_out = data + size;
+        }
+        zs.avail_out = (uInt)((max - size) < UINT_MAX ? (max - size) : UINT_MAX);
+        zr = inflate(&zs, Z_NO_FLUSH);
+        if (zr == Z_STREAM_END) {
+            if (zs.avail_in == 0)
+                break;
+            inflateReset(&zs);
+        }
+        else if (!(zr == Z_OK || (zr == Z_BUF_ERROR && zs.avail_out == 0))) {
+            DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BGZF), ("Unexpected Zlib result %i inflating index\n", zr));
+            rc = RC(rcAlign, rcIndex, rcReading, rcFile, rcCorrupt);
+            break;
+        }
+    }
+    *rsize = zs.next_out - data;
+    inflateEnd(&zs);
+    if (rc) {
+        free(data);
+        return rc;
+    }
+    *rslt = data;
+    return 0;
+}
+
+static rc_t BAMIndexLoad(KFile const *const kf, uint8_t **const rslt, size_t *const rsize)
+{
+    uint64_t fsize = 0;
+    size_t nread = 0;
+    uint8_t *raw;
+    rc_t rc = KFileSize(kf, &fsize);
+
+    if (rc)
+        return rc;
+    if (fsize < 8 || fsize != (size_t)fsize)
+        return RC(rcAlign, rcIndex, rcReading, rcFile, rcInvalid);
+
+    raw = malloc(fsize);
+    if (raw == NULL)
+        return RC(rcAlign, rcIndex, rcReading, rcMemory, rcExhausted);
+    rc = KFileReadAll(kf, 0, raw, fsize, &nread);
+    if (rc == 0 && nread != fsize)
+        rc = RC(rcAlign, rcIndex, rcReading, rcFile, rcTooShort);
+    if (rc == 0 && raw[0] == 31 && raw[1] == 139) {
+        rc = BAMIndexInflate(raw, fsize, rslt, rsize);
+        free(raw);
+        return rc;
+    }
+    if (rc) {
+        free(raw);
+        return rc;
+    }
+    *rslt = raw;
+    *rsize = fsize;
+    return 0;
+}
+
+/* collects the virtual offsets of records found in the index, they are sorted
+ * and the duplicates removed; the pseudo-bins hold no offsets of records */
+static rc_t BAMIndexCollectOffsets(uint8_t const data[], size_t const size, BAMIndexOffsets *const rslt)
+{
+    BAMIndexCursor c;
+    uint32_t pseudoBin = BAI_PSEUDO_BIN;
+    bool isCSI = false;
+    uint32_t refs;
+    uint32_t r;
+    size_t i;
+    size_t n;
+
+    c.cur = data + 4;
+    c.end = data + size;
+    c.bad = false;
+
+    if (size >= 4 && memcmp(data, "CSI\1", 4) == 0) {
+        uint32_t depth;
+
+        isCSI = true;
+        BAMIndexCursorU32(&c); /* min_shift */
+        depth = BAMIndexCursorU32(&c);
+        BAMIndexCursorSkip(&c, BAMIndexCursorU32(&c)); /* l_aux and aux */
+        if (depth > 9)
+            return RC(rcAlign, rcIndex, rcParsing, rcData, rcUnsupported);
+        pseudoBin = ((1u << ((depth + 1) * 3)) - 1) / 7 + 1;
+    }
+    else if (size < 4 || memcmp(data, "BAI\1", 4) != 0)
+        return RC(rcAlign, rcIndex, rcParsing, rcFormat, rcInvalid);
+
+    refs = BAMIndexCursorU32(&c);
+    for (r = 0; r < refs && !c.bad; ++r) {
+        uint32_t const bins = BAMIndexCursorU32(&c);
+        uint32_t b;
+
+        for (b = 0; b < bins && !c.bad; ++b) {
+            uint32_t const bin = BAMIndexCursorU32(&c);
+            uint64_t const loffset = isCSI ? BAMIndexCursorU64(&c) : 0;
+            uint32_t const chunks = BAMIndexCursorU32(&c);
+            uint32_t k;
+
+            if (bin != pseudoBin && loffset != 0 && !BAMIndexOffsetsAdd(rslt, loffset))
+                return RC(rcAlign, rcIndex, rcParsing, rcMemory, rcExhausted);
+            for (k = 0; k < chunks && !c.bad; ++k) {
+                uint64_t const beg = BAMIndexCursorU64(&c);
+
+                BAMIndexCursorU64(&c); /* end */
+                if (bin != pseudoBin && !c.bad && !BAMIndexOffsetsAdd(rslt, beg))
+                    return RC(rcAlign, rcIndex, rcParsing, rcMemory, rcExhausted);
+            }
+        }
+        if (!isCSI) {
+            uint32_t const intervals = BAMIndexCursorU32(&c);
+            uint32_t k;
+
+            for (k = 0; k < intervals && !c.bad; ++k) {
+                uint64_t const ioffset = BAMIndexCursorU64(&c);
+
+                if (ioffset != 0 && !c.bad && !BAMIndexOffsetsAdd(rslt, ioffset))
+                    return RC(rcAlign, rcIndex, rcParsing, rcMemory, rcExhausted);
+            }
+        }
+    }
+    if (c.bad)
+        return RC(rcAlign, rcIndex, rcParsing, rcData, rcInsufficient);
+
+    if (rslt->count > 0) {
+        ksort(rslt->offset, rslt->count, sizeof(rslt->offset[0]), BAMIndexOffsetsCompare, NULL);
+        for (i = n = 1; i < rslt->count; ++i) {
+            if (rslt->offset[i] != rslt->offset[n - 1])
+                rslt->offset[n++] = rslt->offset[i];
+        }
+        rslt->count = n;
+    }
+    return 0;
+}
+
+/* cuts the file at the offsets into ranges of at least size compressed bytes,
+ * the first range starts at first, the last one ends at eof */
+static unsigned BAMRangesMake(BAMIndexOffsets const *const offsets, uint64_t const first, uint64_t const size, BAMRange range[])
+{
+    unsigned n = 0;
+    size_t i;
+
+    range[0].beg = first;
+    for (i = 0; i < offsets->count; ++i) {
+        uint64_t const offset = offsets->offset[i];
+
+        if (offset > range[n].beg && (offset >> 16) - (range[n].beg >> 16) >= size) {
+            range[n].end = offset;
+            range[++n].beg = offset;
+        }
+    }
+    range[n].end = BAM_RANGE_EOF;
+    return n + 1;
+}
+
+/* false if quitting, the records are released then */
+static bool BAMRangePut(BAMRangeThreads *const mt, BAMRange *const range,
+                        BAM_Alignment *const batch[], unsigned const n, uint64_t const pos)
+{
+    unsigned i;
+
+    KLockAcquire(mt->lock);
+    while (!mt->quit && range->count + n > BAM_RANGE_RECORDS)
+        KConditionWait(mt->cond, mt->lock);
+    if (mt->quit) {
+        KLockUnlock(mt->lock);
+        for (i = 0; i < n; ++i)
+            BAM_AlignmentRelease(batch[i]);
+        return false;
+    }
+    for (i = 0; i < n; ++i)
+        range->ring[(range->head + range->count + i) % BAM_RANGE_RECORDS] = batch[i];
+    range->count += n;
+    range->pos = pos;
+    KConditionBroadcast(mt->cond);
+    KLockUnlock(mt->lock);
+    return true;
+}
+
+/* the end of a range has to be the start of a record, else the index does not
+ * belong to the file; at the end of a member both offsets name the same place */
+static bool BAMRangeEndsAt(BAM_FilePosition const pos, uint64_t const end)
+{
+    return pos == end || ((end >> 16) < (pos >> 16) && (pos & 0xFFFF) == 0);
+}
+
+static void BAMRangeWorkerRead(BAMRangeWorker *const self, BAMRange *const range)
+{
+    BAMRangeThreads *const mt = self->mt;
+    BAM_File *const file = self->file;
+    BAM_Alignment *batch[BAM_RANGE_BATCH];
+    BAM_FilePosition pos = range->beg;
+    unsigned n = 0;
+    rc_t rc = 0;
+
+    range->ring = malloc(BAM_RANGE_RECORDS * sizeof(range->ring[0]));
+    if (range->ring == NULL)
+        rc = RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+    else
+        rc = BAM_FileSetPosition(file, &pos);
+
+    while (rc == 0) {
+        BAM_Alignment *rec = NULL;
+
+        BAM_FileGetPosition(file, &pos);
+        if (n == BAM_RANGE_BATCH) {
+            if (!BAMRangePut(mt, range, batch, n, pos))
+                return;
+            n = 0;
+        }
+        if (pos >= range->end) {
+            if (!BAMRangeEndsAt(pos, range->end))
+                rc = RC(rcAlign, rcIndex, rcReading, rcData, rcInconsistent);
+            break;
+        }
+        rc = read2(file, &rec);
+        if (rc == 0 || (GetRCObject(rc) == rcRow && GetRCState(rc) == rcEmpty)) {
+            /* the empty records are handed out too, like read2 does */
+            if ((batch[n] = BAM_AlignmentDetach(rec)) == NULL)
+                rc = RC(rcAlign, rcFile, rcReading, rcMemory, rcExhausted);
+            else {
+                ++n;
+                rc = 0;
+            }
+        }
+        else if (GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound) {
+            rc = range->end == BAM_RANGE_EOF ? 0 : RC(rcAlign, rcIndex, rcReading, rcData, rcInconsistent);
+            break;
+        }
+    }
+    if (n > 0 && !BAMRangePut(mt, range, batch, n, pos))
+        return;
+
+    KLockAcquire(mt->lock);
+    range->rc = rc;
+    range->done = true;
+    KConditionBroadcast(mt->cond);
+    KLockUnlock(mt->lock);
+}
+
+static rc_t CC BAMRangeWorkerRun(KThread const *const th, void *const data)
+{
+    BAMRangeWorker *const self = data;
+    BAMRangeThreads *const mt = self->mt;
+
+    KLockAcquire(mt->lock);
+    while (!mt->quit && mt->next_in < mt->ranges) {
+        if (mt->next_in - mt->next_out >= 2 * mt->threads) {
+            KConditionWait(mt->cond, mt->lock);
+            continue;
+        }
+        {
+            BAMRange *const range = &mt->range[mt->next_in++];
+
+            KLockUnlock(mt->lock);
+            BAMRangeWorkerRead(self, range);
+            KLockAcquire(mt->lock);
+        }
+    }
+    KLockUnlock(mt->lock);
+    return 0;
+}
+
+/* hands out the records range by range; an error stays in its range and is
+ * returned again by the following calls */
+static rc_t BAMRangeThreadsRead(BAM_File *const self, BAM_Alignment **const rslt)
+{
+    BAMRangeThreads *const mt = self->ranges;
+
+    if (mt->batchNext == mt->batchSize) {
+        rc_t rc = 0;
+
+        mt->batchNext = mt->batchSize = 0;
+        KLockAcquire(mt->lock);
+        while (rc == 0) {
+            BAMRange *const range = &mt->range[mt->next_out];
+
+            if (mt->next_out == mt->ranges)
+                rc = SILENT_RC(rcAlign, rcFile, rcReading, rcRow, rcNotFound);
+            else if (range->count > 0) {
+                unsigned const n = range->count < BAM_RANGE_BATCH ? range->count : BAM_RANGE_BATCH;
+                unsigned i;
+
+                for (i = 0; i < n; ++i)
+                    mt->batch[i] = range->ring[(range->head + i) % BAM_RANGE_RECORDS];
+                range->head = (range->head + n) % BAM_RANGE_RECORDS;
+                range->count -= n;
+                mt->batchSize = n;
+                self->fpos_cur = range->pos >> 16; /* a little ahead, for the progress only */
+                KConditionBroadcast(mt->cond);
+                break;
+            }
+            else if (range->done) {
+                rc = range->rc;
+                if (rc == 0) {
+                    free(range->ring);
+                    range->ring = NULL;
+                    ++mt->next_out;
+                    KConditionBroadcast(mt->cond);
+                }
+            }
+            else
+                KConditionWait(mt->cond, mt->lock);
+        }
+        KLockUnlock(mt->lock);
+        if (rc)
+            return rc;
+    }
+    *rslt = mt->batch[mt->batchNext++];
+    if (BAM_AlignmentIsEmpty(*rslt)) /* the range reader logged it */
+        return SILENT_RC(rcAlign, rcFile, rcReading, rcRow, rcEmpty);
+    return 0;
+}
+
+static void BAMRangeThreadsGetPageCounts(BAMRangeThreads const *const self, uint64_t *const fresh, uint64_t *const recycled)
+{
+    unsigned i;
+
+    for (i = 0; i < self->threads; ++i) {
+        BAM_File const *const file = self->worker[i].file;
+
+        if (file) {
+            *fresh += file->pagesFresh;
+            *recycled += file->pagesRecycled;
+        }
+    }
+}
+
+static void BAMRangeThreadsWhack(BAMRangeThreads *const self)
+{
+    unsigned i;
+
+    if (self->lock) {
+        KLockAcquire(self->lock);
+        self->quit = true;
+        KConditionBroadcast(self->cond);
+        KLockUnlock(self->lock);
+    }
+    for (i = 0; i < self->threads; ++i) {
+        BAMRangeWorker *const worker = &self->worker[i];
+
+        if (worker->thread) {
+            rc_t rc2 = 0;
+            KThreadWait(worker->thread, &rc2);
+            KThreadRelease(worker->thread);
+        }
+    }
+    /* the records go back to the pages of the files of the readers */
+    for (i = self->batchNext; i < self->batchSize; ++i)
+        BAM_AlignmentRelease(self->batch[i]);
+    for (i = 0; i < self->ranges; ++i) {
+        BAMRange *const range = &self->range[i];
+
+        if (range->ring) {
+            unsigned k;
+
+            for (k = 0; k < range->count; ++k)
+                BAM_AlignmentRelease(range->ring[(range->head + k) % BAM_RANGE_RECORDS]);
+            free(range->ring);
+        }
+    }
+    for (i = 0; i < self->threads; ++i)
+        BAM_FileRelease(self->worker[i].file);
+    KConditionRelease(self->cond);
+    KLockRelease(self->lock);
+    free(self->worker);
+    free(self->range);
+    free(self);
+}
+
+static rc_t BAMRangeThreadsMake(BAM_File *const self, BAMIndexOffsets const *const offsets,
+                                unsigned const threads, unsigned *const ranges)
+{
+    uint64_t const fmax = self->vt.FileGetSize(&self->file);
+    uint64_t const fsize = fmax / ((uint64_t)threads * BAM_RANGES_PER_THREAD);
+    BAMRangeThreads *const mt = calloc(1, sizeof(*mt));
+    BAM_FilePosition first = 0;
+    rc_t rc = 0;
+    unsigned i;
+
+    if (mt == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    mt->range = calloc(offsets->count + 1, sizeof(mt->range[0]));
+    if (mt->range == NULL) {
+        free(mt);
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    }
+    BAM_FileGetPosition(self, &first);
+    mt->ranges = BAMRangesMake(offsets, first, fsize > BAM_RANGE_MIN_SIZE ? fsize : BAM_RANGE_MIN_SIZE, mt->range);
+    *ranges = mt->ranges;
+    if (mt->ranges < 2) {
+        /* nothing to read in parallel */
+        free(mt->range);
+        free(mt);
+        return 0;
+    }
+    mt->threads = threads < mt->ranges ? threads : mt->ranges;
+    mt->worker = calloc(mt->threads, sizeof(mt->worker[0]));
+    if (mt->worker == NULL) {
+        free(mt->range);
+        free(mt);
+        return RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    }
+    rc = KLockMake(&mt->lock);
+    if (rc == 0)
+        rc = KConditionMake(&mt->cond);
+
+    /* the readers see the header the file was opened with */
+    for (i = 0; i < mt->threads && rc == 0; ++i) {
+        BAMRangeWorker *const worker = &mt->worker[i];
+
+        worker->mt = mt;
+        rc = BAM_FileMakeWithKFileAndHeader(&worker->file, self->file.bam.file.kf, self->header);
+        if (rc == 0 && worker->file->isSAM)
+            rc = RC(rcAlign, rcFile, rcConstructing, rcFormat, rcInvalid);
+        if (rc == 0 && (worker->file->nocopy = malloc(64u * 1024u)) == NULL)
+            rc = RC(rcAlign, rcFile, rcConstructing, rcMemory, rcExhausted);
+    }
+    for (i = 0; i < mt->threads && rc == 0; ++i)
+        rc = KThreadMake(&mt->worker[i].thread, BAMRangeWorkerRun, &mt->worker[i]);
+    if (rc) {
+        BAMRangeThreadsWhack(mt);
+        return rc;
+    }
+    self->ranges = mt;
+    DBGMSG(DBG_ALIGN, DBG_FLAG(DBG_ALIGN_BAM), ("Reading %u ranges on %u threads\n", mt->ranges, mt->threads));
+    return 0;
+}
+
+rc_t BAM_FileSetIndexedThreads(const BAM_File *cself, unsigned threads, char const path[], unsigned *ranges)
+{
+    BAM_File *const self = (BAM_File *)cself;
+    KDirectory *dir = NULL;
+    KFile const *kf = NULL;
+    BAMIndexOffsets offsets;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    rc_t rc;
+
+    if (self == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcSelf, rcNull);
+    if (path == NULL || ranges == NULL)
+        return RC(rcAlign, rcFile, rcConstructing, rcParam, rcNull);
+
+    *ranges = 0;
+    if (self->isSAM || threads == 0 || self->file.bam.mt != NULL || self->ranges != NULL)
+        return 0;
+
+    rc = KDirectoryNativeDir(&dir);
+    if (rc) return rc;
+    rc = BAMIndexOpen(dir, path, &kf);
+    KDirectoryRelease(dir);
+    if (rc) return rc;
+
+    rc = BAMIndexLoad(kf, &data, &size);
+    KFileRelease(kf);
+    if (rc) return rc;
+
+    memset(&offsets, 0, sizeof(offsets));
+    rc = BAMIndexCollectOffsets(data, size, &offsets);
+    free(data);
+    if (rc == 0 && offsets.count > 0 && (offsets.offset[offsets.count - 1] >> 16) >= self->vt.FileGetSize(&self->file))
+        rc = RC(rcAlign, rcIndex, rcParsing, rcData, rcInconsistent); /* not the index of this file */
+    if (rc == 0)
+        rc = BAMRangeThreadsMake(self, &offsets, threads < BAM_RANGE_MAX_THREADS ? threads : BAM_RANGE_MAX_THREADS, ranges);
+    free(offsets.offset);
+    return rc;
+}
+
+/* MARK: BAM File indexed ranges *** End *** */
+
 /* MARK: BAM File header info accessor */
 
 rc_t BAM_FileGetRefSeqById(const BAM_File *cself, int32_t id, const BAMRefSeq **rhs)
@@ -2266,7 +3912,9 @@ rc_t BAM_FileGetHeaderText(BAM_File const *cself, char const **header, size_t *h
 static rc_t BAM_AlignmentWhack(BAM_Alignment *self)
 {
     free(self->storage);
-    if (self != self->parent->nocopy)
+    if (self->inPage)
+        BAM_FileReleasePage(self->parent, (BAM_RecordPage *)self);
+    else if (self != self->parent->nocopy)
         free(self);
     return 0;
 }
@@ -2285,13 +3933,35 @@ rc_t BAM_AlignmentRelease(const BAM_Alignment *cself)
     return 0;
 }
 
+/* like BAM_AlignmentCopy, but into a record page if it fits */
+static BAM_Alignment *BAM_AlignmentCopyToPage(const BAM_Alignment *self)
+{
+    unsigned const numExtra = self->numExtra;
+    size_t const datasize = self->datasize;
+    size_t const rsltsize = BAM_ALIGNMENT_SIZE(numExtra);
+    BAM_Alignment *tmp;
+
+    if (rsltsize + datasize > BAM_RECORD_PAGE_SIZE)
+        return BAM_AlignmentCopy(self);
+
+    tmp = (BAM_Alignment *)BAM_FileGetPage(self->parent);
+    if (tmp) {
+        memmove(tmp, self, rsltsize);
+        memmove(&tmp->extra[numExtra], self->data, datasize);
+        tmp->data = (void *)&tmp->extra[numExtra];
+        tmp->storage = NULL;
+        tmp->inPage = true;
+    }
+    return tmp;
+}
+
 BAM_Alignment *BAM_AlignmentDetach(const BAM_Alignment *self)
 {
     if (self) {
         BAM_File *const file = self->parent;
 
         if (self == file->nocopy || BAM_FileIsInBuffer(file, self->data)) {
-            BAM_Alignment *copy = BAM_AlignmentCopy(self);
+            BAM_Alignment *copy = BAM_AlignmentCopyToPage(self);
             BAM_AlignmentRelease(self);
             return copy;
         }
@@ -2311,6 +3981,7 @@ BAM_Alignment *BAM_AlignmentCopy(const BAM_Alignment *self)
         memmove(&tmp->extra[numExtra], self->data, datasize);
         tmp->data = (void *)&tmp->extra[numExtra];
         tmp->storage = NULL;
+        tmp->inPage = false;
     }
     return tmp;
 }
@@ -52,7 +52,10 @@ BAM_Alignment *BAM_AlignmentCopy(const BAM_Alignment *self);
  *
  * This detaches the record's data from the files buffer
  * by making a copy into a seperate allocation that is
- * owned by the record.
+ * owned by the record. Small records are copied into
+ * pages owned by the file, which are recycled when the
+ * records are released ( by any thread ), so the records
+ * must be released before the file.
  *
  * NB. the returned object is a REPLACEMENT for the input object.
  * The input will be released if a copy was made.
@@ -521,6 +524,59 @@ rc_t BAM_FileMake(const BAM_File **result,
                   char const headerText[],
                   char const path[], ... );
 
+/* SetInflateThreads
+ *  inflate the BGZF blocks of a BAM file on a pool of threads,
+ *  which read ahead a bounded number of blocks; the alignments are
+ *  still returned in file order
+ *  the file can not be positioned any more after this
+ *  no-op for SAM files or if "threads" is 0
+ *
+ *  "threads" [ IN ] - number of threads ( at most 64 are used )
+ */
+rc_t BAM_FileSetInflateThreads ( const BAM_File *self, unsigned threads );
+
+/* SetParseThreads
+ *  parse the lines of a SAM file on a pool of threads, which read
+ *  ahead a bounded number of chunks of lines; the alignments are
+ *  still returned in file order
+ *  the file can not be positioned any more after this
+ *  no-op for BAM files or if "threads" is 0
+ *
+ *  "threads" [ IN ] - number of threads ( at most 64 are used )
+ */
+rc_t BAM_FileSetParseThreads ( const BAM_File *self, unsigned threads );
+
+/* SetIndexedThreads
+ *  read a coordinate-sorted BAM file on a pool of threads, each with a
+ *  reader of its own; the file is cut into ranges at the virtual offsets
+ *  found in its BAI or CSI index, the ranges are decoded concurrently and
+ *  a bounded number of records is read ahead; the alignments are still
+ *  returned in file order
+ *  the index is looked for as "path".bai, "path".csi and with the .bam
+ *  of "path" replaced; (rcIndex, rcNotFound) if there is none
+ *  the file can not be positioned any more after this
+ *  call before SetInflateThreads, which is a no-op after this
+ *  no-op for SAM files or if "threads" is 0
+ *
+ *  "threads" [ IN ] - number of threads ( at most 64 are used )
+ *
+ *  "path" [ IN ] - the path the file was opened with
+ *
+ *  "ranges" [ OUT ] - the number of ranges, if it is less than 2
+ *  the file is read as before
+ */
+rc_t BAM_FileSetIndexedThreads ( const BAM_File *self, unsigned threads, char const path[], unsigned *ranges );
+
+/* GetRecordPageCounts
+ *  the number of record pages ( see BAM_AlignmentDetach )
+ *  allocated from the heap and reused after being released
+ *
+ *  "fresh" [ OUT ] - pages allocated
+ *
+ *  "recycled" [ OUT ] - pages reused
+ */
+rc_t BAM_FileGetRecordPageCounts ( const BAM_File *self, uint64_t *fresh, uint64_t *recycled );
+
 /* AddRef
  * Release
  */
@@ -538,6 +594,15 @@ rc_t BAM_FileRelease ( const BAM_File *self );
 rc_t BAM_FileGetPosition ( const BAM_File *self, BAM_FilePosition *pos );
 
 
+/* SetPosition
+ *  seek to a position returned by GetPosition or found in a BAM index
+ *  not for SAM files or after SetInflateThreads or SetIndexedThreads
+ *
+ *  "pos" [ IN ] - the position of the next alignment to read
+ */
+rc_t BAM_FileSetPosition ( const BAM_File *self, const BAM_FilePosition *pos );
+
+
 /* GetProportionalPosition
  *  get the aproximate proportional position in the input file
  *  this is intended to be useful for computing progress
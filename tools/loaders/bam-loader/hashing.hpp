@@ -29,8 +29,7 @@
 #include <bm/bm64.h>
 #include <vector>
 #include <functional>
-#include <bitset>
-#include <klib/checksum.h>
+#include <cmath>
 
 using namespace std;
 namespace hashing {
@@ -60,76 +59,18 @@ namespace hashing {
         }
     };
 
-    /* copied from  https://github.com/explosion/murmurhash/blob/master/murmurhash/MurmurHash2.cpp */
     #define BIG_CONSTANT(x) (x##LLU)
 
-    uint64_t MurmurHash ( const void * key, int len, uint64_t seed = 0)
+    /* the finalizer of MurmurHash3: spreads the bits of an (fnv1a-) hash over all 64 bits */
+    inline uint64_t fmix64(uint64_t h)
     {
-        const uint64_t m = BIG_CONSTANT(0xc6a4a7935bd1e995);
-        const int r = 47;
-
-        uint64_t h = seed ^ (len * m);
-
-        const uint64_t * data = (const uint64_t *)key;
-        const uint64_t * end = data + (len/8);
-
-        while(data != end)
-        {
-            uint64_t k; memcpy(&k, data++, sizeof(k)); // k = *data++;
-
-            k *= m;
-            k ^= k >> r;
-            k *= m;
-
-            h ^= k;
-            h *= m;
-        }
-
-        const unsigned char * data2 = (const unsigned char*)data;
-
-        switch(len & 7)
-        {
-            case 7: h ^= ((uint64_t) data2[6]) << 48;
-            case 6: h ^= ((uint64_t) data2[5]) << 40;
-            case 5: h ^= ((uint64_t) data2[4]) << 32;
-            case 4: h ^= ((uint64_t) data2[3]) << 24;
-            case 3: h ^= ((uint64_t) data2[2]) << 16;
-            case 2: h ^= ((uint64_t) data2[1]) << 8;
-            case 1: h ^= ((uint64_t) data2[0]);
-                    h *= m;
-        };
-
-        h ^= h >> r;
-        h *= m;
-        h ^= h >> r;
-
+        h ^= h >> 33;
+        h *= BIG_CONSTANT(0xff51afd7ed558ccd);
+        h ^= h >> 33;
+        h *= BIG_CONSTANT(0xc4ceb9fe1a85ec53);
+        h ^= h >> 33;
         return h;
     }
-
-    static unsigned char *SHA1(const unsigned char *data, size_t count, unsigned char *md_buf)
-    {
-        SHA1State state;
-        SHA1StateInit(&state);
-        SHA1StateAppend(&state, reinterpret_cast<void const *>(data), count);
-        SHA1StateFinish(&state, reinterpret_cast<uint8_t *>(&md_buf[0]));
-        return md_buf;
-    }
-    static unsigned char *SHA224(const unsigned char *data, size_t count, unsigned char *md_buf)
-    {
-        SHA224State state;
-        SHA224StateInit(&state);
-        SHA224StateAppend(&state, reinterpret_cast<void const *>(data), count);
-        SHA224StateFinish(&state, reinterpret_cast<uint8_t *>(&md_buf[0]));
-        return md_buf;
-    }
-    static unsigned char *SHA256(const unsigned char *data, size_t count, unsigned char *md_buf)
-    {
-        SHA256State state;
-        SHA256StateInit(&state);
-        SHA256StateAppend(&state, reinterpret_cast<void const *>(data), count);
-        SHA256StateFinish(&state, reinterpret_cast<uint8_t *>(&md_buf[0]));
-        return md_buf;
-    }
 }
 
 class spot_name_filter
@@ -140,89 +81,149 @@ public:
 
     virtual bool seen_before(const char* value, size_t sz) = 0;
     virtual size_t memory_used() const = 0;
+    virtual void reserve(size_t num_names) {}
+    virtual double estimated_fpr() const { return 0; }
     uint64_t get_name_hash() const { return m_name_hash; }
 
 protected:
     uint64_t m_name_hash = 0;
 };
 
-class fnv_murmur_filter : public spot_name_filter
+/**
+ * @brief Cache-line blocked (split block) bloom filter
+ *
+ * Every name sets one bit in each of the 8 words of a single 64 byte block,
+ * so a lookup touches one cache line per stage.
+ * The filter grows by adding stages: the names seen so far stay in the old
+ * stages, new names go into the newest one and a lookup checks all of them.
+ * So growing does not need the names again.
+ */
+class blocked_bloom_filter : public spot_name_filter
 {
 public:
-    fnv_murmur_filter() {
-        for (auto& hb : hash_buckets) {
-            hb = hashing::bvector_type(bm::BM_GAP, bm::gap_len_table_min<true>::_len);
-            hb.init();
-        }
+    static constexpr size_t BITS_PER_NAME = 16;         ///< ~0.1% false positives
+    static constexpr size_t MIN_CAPACITY = 1ull << 24;  ///< names in the first stage (32 MB)
+
+    explicit blocked_bloom_filter(size_t capacity = MIN_CAPACITY) {
+        m_stages.emplace_back(capacity);
     }
+
     virtual bool seen_before(const char* value, size_t sz) override
     {
-        bool hits[4];
         m_name_hash = hashing::fnv1a(value, sz);
-        auto murmur_hash = hashing::MurmurHash(value, sz);
-        uint32_t hash32 = m_name_hash;
-        hits[0] = (hash32 == bm::id_max || !hash_buckets[0].set_bit_conditional(hash32, true, false));
-        hash32 = (m_name_hash >> 32);
-        hits[1] = (hash32 == bm::id_max || !hash_buckets[1].set_bit_conditional(hash32, true, false));
-        hash32 = murmur_hash;
-        hits[2] = (hash32 == bm::id_max || !hash_buckets[2].set_bit_conditional(hash32, true, false));
-        hash32 = (murmur_hash >> 32);
-        hits[3] = (hash32 == bm::id_max || !hash_buckets[3].set_bit_conditional(hash32, true, false));
-        return hits[0] && hits[1] && hits[2] && hits[3];
-    }
-    size_t memory_used() const override {
-        size_t memory_used = 0;
-        for (const auto& hb : hash_buckets) {
-            hashing::bvector_type::statistics st;
-            hb.calc_stat(&st);
-            memory_used += st.memory_used;
+        uint64_t const hash = hashing::fmix64(m_name_hash);
+        for (auto const& stage : m_stages) {
+            if (stage.test(hash))
+                return true;
         }
-        return memory_used;
+        if (m_stages.back().count >= m_stages.back().capacity)
+            m_stages.emplace_back(2 * m_stages.back().capacity);
+        m_stages.back().set(hash);
+        return false;
     }
 
-private:
-
-    array<hashing::bvector_type, 4> hash_buckets;
-
-};
+    /** inserts a name by its fnv1a hash (for a filter of a known set of names) */
+    void insert_hash(uint64_t name_hash)
+    {
+        if (m_stages.back().count >= m_stages.back().capacity)
+            m_stages.emplace_back(2 * m_stages.back().capacity);
+        m_stages.back().set(hashing::fmix64(name_hash));
+    }
 
-template<unsigned char* ShaFunc(const unsigned char *data, size_t count, unsigned char *md_buf), int NUM_BUCKETS>
-class sha_filter : public spot_name_filter
-{
-public:
-    virtual bool seen_before(const char* value, size_t sz) override
+    /** tests a name by its fnv1a hash without inserting it */
+    bool contains_hash(uint64_t name_hash) const
     {
-        m_name_hash = hashing::fnv1a(value, sz);
-        ShaFunc((const unsigned char*)value, sz, (unsigned char*)m_md_buf.data());
-        uint8_t hits = 0;
-        for (int i = 0; i < NUM_BUCKETS; ++i) {
-            m_hits[i] = hash_buckets[i].test(m_md_buf[i]);
-            m_hits[i] ? ++hits : hash_buckets[i].set(m_md_buf[i]);
+        uint64_t const hash = hashing::fmix64(name_hash);
+        for (auto const& stage : m_stages) {
+            if (stage.test(hash))
+                return true;
         }
-        return hits == NUM_BUCKETS;
+        return false;
     }
-    size_t memory_used() const override {
-        return (4294967296/8) * NUM_BUCKETS;
-    };
 
-private:
-    array<uint32_t, NUM_BUCKETS> m_md_buf;
-    array<bool, NUM_BUCKETS> m_hits;
-    array<std::bitset<4294967296>, NUM_BUCKETS> hash_buckets;
-};
+    /** makes room for num_names names in total (the names seen so far included) */
+    virtual void reserve(size_t num_names) override
+    {
+        size_t const seen = names();
+        auto& last = m_stages.back();
+        if (num_names > seen + (last.capacity - min(last.count, last.capacity)))
+            m_stages.emplace_back(max(num_names - seen, MIN_CAPACITY));
+    }
 
-class sha1_filter : public sha_filter<hashing::SHA1, 5>
-{
-};
+    size_t memory_used() const override {
+        size_t memory_used = 0;
+        for (auto const& stage : m_stages)
+            memory_used += stage.blocks.size() * sizeof(block_t);
+        return memory_used;
+    }
 
-class sha224_filter : public sha_filter<hashing::SHA224, 7>
-{
-};
+    virtual double estimated_fpr() const override {
+        double pass = 1.0;
+        for (auto const& stage : m_stages)
+            pass *= 1.0 - stage.estimated_fpr();
+        return 1.0 - pass;
+    }
 
-class sha256_filter : public sha_filter<hashing::SHA256, 8>
-{
-};
+    size_t names() const {
+        size_t names = 0;
+        for (auto const& stage : m_stages)
+            names += stage.count;
+        return names;
+    }
+    size_t capacity() const {
+        size_t capacity = 0;
+        for (auto const& stage : m_stages)
+            capacity += stage.capacity;
+        return capacity;
+    }
+    size_t stages() const { return m_stages.size(); }
+
+private:
+    struct alignas(64) block_t {
+        uint64_t word[8];
+    };
 
+    struct stage_t {
+        vector<block_t> blocks;
+        size_t capacity;
+        size_t count = 0;
+
+        explicit stage_t(size_t capacity)
+            : blocks((capacity * BITS_PER_NAME + 511) / 512)
+            , capacity(capacity)
+        {}
+
+        /** one bit in each word, picked by 8 odd multipliers from the low 32 bits */
+        static uint64_t mask(uint32_t hash, unsigned i) {
+            static constexpr uint32_t salt[8] = {
+                0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+            return 1ull << ((uint32_t)(hash * salt[i]) >> 26);
+        }
+        /** the block is picked by the high bits */
+        size_t index(uint64_t hash) const {
+            return (size_t)(((unsigned __int128)hash * blocks.size()) >> 64);
+        }
+        bool test(uint64_t hash) const {
+            auto const& block = blocks[index(hash)];
+            bool hit = true;
+            for (unsigned i = 0; i < 8; ++i)
+                hit &= (block.word[i] & mask((uint32_t)hash, i)) != 0;
+            return hit;
+        }
+        void set(uint64_t hash) {
+            auto& block = blocks[index(hash)];
+            for (unsigned i = 0; i < 8; ++i)
+                block.word[i] |= mask((uint32_t)hash, i);
+            ++count;
+        }
+        double estimated_fpr() const {
+            double const bit_set = 1.0 - exp(-(double)count / (64.0 * blocks.size()));
+            return pow(bit_set, 8);
+        }
+    };
 
+    vector<stage_t> m_stages;
+};
 
 #endif // __HASHING_HPP__
@@ -265,6 +265,9 @@ struct context_t {
     BAM_FilePosition m_HeaderOffset = 0;
     uint64_t m_inputSize = 0;             ///< Total size in bytes of all input files (can be 0 for stdin inputs)
     uint64_t m_processedSize = 0;         ///< Number of already processed bytes
+    uint64_t m_recordPagesFresh = 0;      ///< BAM record pages allocated (all input files)
+    uint64_t m_recordPagesRecycled = 0;   ///< BAM record pages reused (all input files)
+    uint64_t m_indexedRanges = 0;         ///< Ranges decoded concurrently with the BAM index (all input files)
     atomic<uint64_t> m_BankedSpots{0};
     atomic<uint64_t> m_BankedSize{0};
     atomic<uint64_t> m_SpotSize{0};
@@ -291,6 +294,7 @@ struct context_t {
 
     vector<unique_ptr<spot_assembly>> m_read_groups; ///< list of read groups
     shared_ptr<spot_name_filter> m_key_filter;   ///< Bloom filter (all spot names in scope)
+    shared_ptr<spot_spill> m_spot_spill;         ///< Spill tier for the packed spot names (all read groups)
     vector<u40_t> m_spot_id_buffer;              ///< Temporary buffer for spot name extraction
 
     // reset everything but spotId and spot assembly related fields
@@ -308,11 +312,9 @@ struct context_t {
     }
 
     /**
-     * @brief Set bloom filter based on the estimated number of spots
-     * >9e9 spots - sha256
-     * >2e9 - sha242
-     * >1e9 - sha1
-     * otherwise default: fnv + murmur
+     * @brief Size the bloom filter for the estimated number of spots
+     * the filter grows by a stage for the spots still to come,
+     * the spot names seen so far are not hashed again
      *
      * @param num_spots
      */
@@ -321,40 +323,12 @@ struct context_t {
         static bool is_set = false;
         if (is_set)
             return;
-        if (num_spots > 3e9 && dynamic_cast<sha256_filter*>(m_key_filter.get()) == 0) {
-            spdlog::stopwatch sw;
-            m_key_filter.reset(new sha256_filter);
-            for(auto& gr : m_read_groups) {
-                gr->visit_spots([this](const char* spot_name) {
-                    m_key_filter->seen_before(spot_name, strlen(spot_name));
-                });
-            }
-            spdlog::info("SHA256 bloom filter rebuilt in {:.3}", sw);
-
-        } else if (num_spots > 2e9 && dynamic_cast<sha224_filter*>(m_key_filter.get()) == 0) {
-            spdlog::stopwatch sw;
-            m_key_filter.reset(new sha224_filter);
-            for(auto& gr : m_read_groups) {
-                gr->visit_spots([this](const char* spot_name) {
-                    m_key_filter->seen_before(spot_name, strlen(spot_name));
-                });
-            }
-            spdlog::info("SHA224 bloom filter rebuilt in {:.3}", sw);
-
-        } else if (num_spots > 1e9 && dynamic_cast<sha1_filter*>(m_key_filter.get()) == 0) {
-            spdlog::stopwatch sw;
-            m_key_filter.reset(new sha1_filter);
-            for(auto& gr : m_read_groups) {
-                gr->visit_spots([this](const char* spot_name) {
-                    m_key_filter->seen_before(spot_name, strlen(spot_name));
-                });
-            }
-            spdlog::info("SHA1 bloom filter rebuilt in {:.3}", sw);
-        }
+        m_key_filter->reserve(num_spots);
+        spdlog::info("Bloom filter sized for {:L} spots, memory {:L}", num_spots, m_key_filter->memory_used());
         is_set = true;
     }
     spot_assembly& add_read_group() {
-        m_read_groups.emplace_back(make_unique<spot_assembly>(*m_executor, m_key_filter, m_read_groups.size(), G.searchBatchSize));
+        m_read_groups.emplace_back(make_unique<spot_assembly>(*m_executor, m_key_filter, m_read_groups.size(), G.searchBatchSize, m_spot_spill));
         return *m_read_groups.back().get();
     }
 
@@ -944,7 +918,13 @@ static rc_t SetupContext(context_t *ctx, unsigned numfiles)
 
     KLoadProgressbar_Append(ctx->progress[0], 100 * numfiles);
     ctx->m_estimatedBatchSize = G.searchBatchSize;
-    ctx->m_key_filter.reset(new fnv_murmur_filter);
+    ctx->m_key_filter.reset(new blocked_bloom_filter);
+    {
+        char prefix[4096];
+        rc = string_printf(prefix, sizeof(prefix), NULL, "%s/spot-names.%u", G.tmpfs, G.pid);
+        if (rc) return rc;
+        ctx->m_spot_spill = make_shared<spot_spill>(prefix, G.spillBudget);
+    }
     ctx->m_executor.reset(new tf::Executor(G.numThreads));
     return rc;
 }
@@ -1664,7 +1644,7 @@ static rc_t run_bamread_thread(const KThread *self, void *const file)
         queue_rec_t* queue_rec = new queue_rec_t;
 #endif
 
-        {
+        try {
             static char const dummy[] = "";
             char const *spotGroup;
             char const *name;
@@ -1682,6 +1662,11 @@ static rc_t run_bamread_thread(const KThread *self, void *const file)
             rc = GetKeyID(&GlobalContext, bam, *queue_rec, spotGroup ? spotGroup : dummy, name, namelen);
 #endif
             if (rc) break;
+        } catch (std::exception const& e) {
+            // the spot names spilled to the scratch files could not be written or read back
+            (void)PLOGMSG(klogErr, (klogErr, "Spot name lookup failed: $(msg)", "msg=%s", e.what()));
+            rc = RC(rcApp, rcFile, rcReading, rcData, rcUnexpected);
+            break;
         }
 
         for ( ; ; ) {
@@ -1898,6 +1883,32 @@ static rc_t ProcessBAM(char const bamFile[], context_t *ctx, VDatabase *db,
     }
     BAM_FileGetPosition(bam, &ctx->m_fileOffset);
     ctx->m_fileOffset >>= 16;
+    if (G.indexThreads > 0 && strcmp(bamFile, "/dev/stdin") != 0) {
+        // coordinate-sorted input with an index: the ranges are decoded concurrently,
+        // the records still arrive in file order
+        unsigned ranges = 0;
+        rc = BAM_FileSetIndexedThreads(bam, G.indexThreads, bamFile, &ranges);
+        if (rc == 0 && ranges > 1) {
+            spdlog::info("Reading {:L} ranges of '{}' on {} threads", ranges, bamFile, min<unsigned>(G.indexThreads, ranges));
+            ctx->m_indexedRanges += ranges;
+        }
+        else if (rc != 0 && GetRCTarget(rc) == rcIndex && GetRCState(rc) == rcNotFound) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "No index for '$(file)', reading it sequentially", "file=%s", bamFile));
+            rc = 0;
+        }
+        if (rc) {
+            (void)PLOGERR(klogErr, (klogErr, rc, "Failed to read the index of '$(file)'", "file=%s", bamFile));
+            BAM_FileRelease(bam);
+            return rc;
+        }
+    }
+    rc = BAM_FileSetInflateThreads(bam, G.inflateThreads);
+    if (rc == 0)
+        rc = BAM_FileSetParseThreads(bam, G.parseThreads);
+    if (rc) {
+        BAM_FileRelease(bam);
+        return rc;
+    }
     ctx->m_HeaderOffset = ctx->m_fileOffset;
 
     {
@@ -3443,6 +3454,15 @@ WRITE_ALIGNMENT:
                      "The file contained no records that were processed.");
         rc = RC(rcAlign, rcFile, rcReading, rcData, rcEmpty);
     }
+    {
+        uint64_t fresh = 0;
+        uint64_t recycled = 0;
+
+        BAM_FileGetRecordPageCounts(bam, &fresh, &recycled);
+        spdlog::info("BAM record pages: fresh: {:L}, recycled: {:L}", fresh, recycled);
+        ctx->m_recordPagesFresh += fresh;
+        ctx->m_recordPagesRecycled += recycled;
+    }
 
     BAM_FileRelease(bam);
 #ifdef HAS_CTX_VALUE
@@ -4216,6 +4236,10 @@ static rc_t ArchiveBAM(VDBManager *mgr, VDatabase *db,
     spdlog::info("SIMD code = {}", bm::simd_version());
     spdlog::info("Num threads  = {}", G.numThreads);
     spdlog::info("Search batch size = {}", G.searchBatchSize);
+    if (G.spillBudget > 0)
+        spdlog::info("Spot name spill budget = {:L} MB", G.spillBudget / (1024 * 1024));
+    if (G.indexThreads > 0)
+        spdlog::info("Index threads = {}", G.indexThreads);
 
     rc_t rc = 0;
     rc_t rc2;
@@ -4299,6 +4323,41 @@ static rc_t ArchiveBAM(VDBManager *mgr, VDatabase *db,
             ctx->mTelemetry["is-unaligned"] = 1;
         if (ref.out_of_order)
             ctx->mTelemetry["is-unsorted"] = 1;
+        if (ctx->m_key_filter) {
+            size_t lookups = 0;
+            size_t false_positives = 0;
+            size_t new_spots = 0;
+            for (const auto& sa : ctx->m_read_groups) {
+                lookups += sa->m_key_filter_total;
+                false_positives += sa->m_key_filter_miss;
+                new_spots += sa->m_total_spots;
+            }
+            json& j = ctx->mTelemetry["spot-name-filter"];
+            j["memory-kb"] = ctx->m_key_filter->memory_used()/1024;
+            j["lookups"] = lookups;
+            j["false-positives"] = false_positives;
+            j["fpr"] = new_spots ? (double)false_positives/new_spots : 0.0;
+            j["estimated-fpr"] = ctx->m_key_filter->estimated_fpr();
+        }
+        if (ctx->m_spot_spill && ctx->m_spot_spill->enabled()) {
+            auto const& spill = *ctx->m_spot_spill;
+            spdlog::info("Spot name spills: {:L}, reloads: {:L}, written: {:L}", spill.spills(), spill.reloads(), spill.bytes_written());
+            json& j = ctx->mTelemetry["spot-name-spill"];
+            j["budget-kb"] = spill.budget()/1024;
+            j["spills"] = spill.spills();
+            j["reloads"] = spill.reloads();
+            j["written-kb"] = spill.bytes_written()/1024;
+        }
+        {
+            json& j = ctx->mTelemetry["record-pages"];
+            j["fresh"] = ctx->m_recordPagesFresh;
+            j["recycled"] = ctx->m_recordPagesRecycled;
+        }
+        if (ctx->m_indexedRanges > 0) {
+            json& j = ctx->mTelemetry["indexed-ranges"];
+            j["threads"] = G.indexThreads;
+            j["ranges"] = ctx->m_indexedRanges;
+        }
 
         ctx->release_search_memory();
         // Clear the metadata columns that we don't need anymore
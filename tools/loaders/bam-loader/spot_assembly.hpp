@@ -49,6 +49,8 @@
 #include <memory>
 #include <algorithm>
 #include <variant>
+#include <string>
+#include <cstdio>
 
 typedef tsl::array_map<char, uint32_t, 
     hashing::fnv_1a_hash, 
@@ -149,6 +151,9 @@ public:
  * and m_spot_map memory is released
  * The switch is done by spot_assembly instance which handles the list of spot_batches and their states
  * 
+ * A cold volume can be spilled by spot_spill: m_data and m_index are saved to the scratch files
+ * (m_data_saved == true) and released, m_gate stays in memory and tells if a name may be in the volume
+ * 
  */
 struct spot_batch 
 {
@@ -164,7 +169,12 @@ struct spot_batch
     bool m_use_scanner{false};           ///< Flag to indicate which search to use (scanner or spot_map)
     atomic<size_t> m_memory_used = 0;            ///< Memory used by metadata (for diagnostics) 
     unique_ptr<metadata_t> m_metadata;   ///< Pointer to metadata
-    bool m_data_saved{false};
+    bool m_data_saved{false};            ///< Spot names are saved to the scratch files (m_spill_path)
+    unique_ptr<blocked_bloom_filter> m_gate; ///< Spot names of the batch (only if it can be spilled)
+    size_t m_names_size = 0;             ///< Memory used by m_data and m_index
+    size_t m_max_name_len = 0;           ///< Longest spot name in the batch
+    uint64_t m_last_used = 0;            ///< Spill clock of the last search that found a name here
+    string m_spill_path;                 ///< Prefix of the scratch files
 
     /**
      * @brief Construct a new spot batch object
@@ -191,11 +201,162 @@ struct spot_batch
         m_data.reset(nullptr);
         m_index.reset(nullptr);
         m_scanner.reset(nullptr);
+        m_gate.reset(nullptr);
         m_memory_used = 0;
+        remove_spill_files();
+    }
+
+    ~spot_batch()
+    {
+        remove_spill_files();
+    }
+
+    /** the spot names were spilled and are not loaded back */
+    bool is_spilled() const { return m_data_saved && !m_data; }
+
+    void remove_spill_files()
+    {
+        if (m_data_saved) {
+            std::remove((m_spill_path + ".data").c_str());
+            std::remove((m_spill_path + ".index").c_str());
+            m_data_saved = false;
+        }
     }
 
 };
 
+/**
+ * @brief Memory budget for the packed spot names of all spot assemblies
+ * 
+ * When the packed spot names of the cold batches exceed the budget, 
+ * the least recently used batches are saved to the scratch directory (BitMagic serialization)
+ * and released. The spot name bloom filter stays the front gate, a name that passes it
+ * is searched in the batches in memory first, a spilled batch is loaded back 
+ * only if its own gate (spot_batch::m_gate) has the name.
+ * Metadata is not spilled: the queued records hold pointers into it.
+ * 
+ * Used by the thread calling spot_assembly::find only
+ */
+class spot_spill 
+{
+public:
+    /**
+     * @brief Construct a new spot spill object
+     * 
+     * @param path_prefix -- prefix of the scratch files (directory and file name)
+     * @param budget -- memory in bytes for the packed spot names, 0 - no spilling
+     */
+    spot_spill(string path_prefix, size_t budget) 
+        : m_path_prefix(std::move(path_prefix))
+        , m_budget(budget)
+    {}
+
+    bool enabled() const { return m_budget > 0; }
+
+    /** registers the batch, the batch must be unregistered (remove) before it's destroyed */
+    void add(spot_batch* batch) { m_batches.push_back(batch); }
+    void remove(spot_batch* batch) { m_batches.erase(std::remove(m_batches.begin(), m_batches.end(), batch), m_batches.end()); }
+
+    /** advances the clock, once per search */
+    void tick() { ++m_clock; }
+    uint64_t now() const { return m_clock; }
+
+    /** 
+     * @brief Switches the finished batches to the scanner and spills
+     * the least recently used ones until the spot names fit into the budget 
+     */
+    void enforce();
+
+    /** loads the spot names of the spilled batch back, throws on I/O errors */
+    void load(spot_batch& batch);
+
+    size_t budget() const { return m_budget; }
+    size_t spills() const { return m_spills; }
+    size_t reloads() const { return m_reloads; }
+    size_t bytes_written() const { return m_bytes_written; }
+
+private:
+    void spill(spot_batch& batch);
+
+    string m_path_prefix;
+    size_t m_budget = 0;
+    vector<spot_batch*> m_batches;  ///< batches of all assemblies
+    uint64_t m_clock = 0;
+    unsigned m_files = 0;           ///< number of spilled batches (file name suffix)
+    size_t m_spills = 0;
+    size_t m_reloads = 0;
+    size_t m_bytes_written = 0;
+};
+
+void spot_spill::enforce()
+{
+    if (m_budget == 0)
+        return;
+    size_t in_memory = 0;
+    vector<spot_batch*> loaded;
+    for (auto batch : m_batches) {
+        if (!batch->m_use_scanner && batch->m_data_ready) {
+            batch->m_use_scanner = true;
+            batch->m_spot_map.reset();
+        }
+        if (batch->m_use_scanner && batch->m_data && batch->m_gate) {
+            in_memory += batch->m_names_size;
+            loaded.push_back(batch);
+        }
+    }
+    if (in_memory <= m_budget)
+        return;
+    sort(loaded.begin(), loaded.end(), [](const spot_batch* b1, const spot_batch* b2) {
+        return b1->m_last_used < b2->m_last_used;
+    });
+    for (auto batch : loaded) {
+        if (in_memory <= m_budget)
+            break;
+        in_memory -= batch->m_names_size;
+        spill(*batch);
+    }
+}
+
+void spot_spill::spill(spot_batch& batch)
+{
+    if (!batch.m_data_saved) {
+        // the spot names never change, a batch spilled again keeps its files
+        string path = fmt::format("{}.{}", m_path_prefix, ++m_files);
+        size_t data_size = 0, index_size = 0;
+        if (bm::file_save_svector(*batch.m_data, path + ".data", &data_size) != 0 
+            || bm::file_save_svector(*batch.m_index, path + ".index", &index_size) != 0) {
+            std::remove((path + ".data").c_str());
+            throw runtime_error("Failed to save spot names to " + path);
+        }
+        batch.m_spill_path = std::move(path);
+        batch.m_data_saved = true;
+        m_bytes_written += data_size + index_size;
+    }
+    batch.m_scanner.reset();
+    batch.m_data.reset();
+    batch.m_index.reset();
+    batch.m_memory_used -= batch.m_names_size;
+    ++m_spills;
+}
+
+void spot_spill::load(spot_batch& batch)
+{
+    assert(batch.is_spilled());
+    auto data = make_unique<str_sv_type>();
+    auto index = make_unique<svector_u32>();
+    if (bm::file_load_svector(*data, batch.m_spill_path + ".data") != 0 
+        || bm::file_load_svector(*index, batch.m_spill_path + ".index") != 0)
+        throw runtime_error("Failed to load spot names from " + batch.m_spill_path);
+    data->freeze();
+    index->freeze();
+    batch.m_scanner.reset(new spot_batch::scanner_t);
+    batch.m_scanner->bind(*data, true);
+    batch.m_data = std::move(data);
+    batch.m_index = std::move(index);
+    batch.m_memory_used += batch.m_names_size;
+    ++m_reloads;
+}
+
 /**
  * @brief Implements spot assembly
  * 
@@ -209,6 +370,7 @@ struct spot_assembly
     tf::Executor& m_executor;           ///< Taskflow executor (initialized in constructor)
     tf::Taskflow m_taskflow;            ///< taskflow used for searches
     shared_ptr<spot_name_filter> m_key_filter; ///< Spot name bloom filter
+    shared_ptr<spot_spill> m_spill;      ///< Spill tier for the packed spot names (shared by all assemblies)
     const unsigned m_group_id;           ///< unique spot assembly (or reporting)
     unique_ptr<array_map_t> m_spot_map;  ///< Current search map
     unique_ptr<metadata_t> m_metadata;   ///< Current metdata
@@ -222,8 +384,8 @@ struct spot_assembly
     atomic<bool> m_stop_packing{false};  ///< Flag to interrupt bach packing jobs
     atomic<bool> m_search_done;          ///< Flag to interrupt the current search 
     
-    size_t m_key_filter_total = 0;
-    size_t m_key_filter_miss = 0;
+    size_t m_key_filter_total = 0;      ///< Number of bloom filter lookups
+    size_t m_key_filter_miss = 0;       ///< Number of bloom filter false positives
 
     /**
      * @brief Construct a new spot assembly object
@@ -232,8 +394,9 @@ struct spot_assembly
      * @param key_filter -- Bloom filter
      * @param group_id -- numeric cgroup_id
      * @param batch_size -- default batch size
+     * @param spill -- spill tier (optional)
      */
-    spot_assembly(tf::Executor& executor, shared_ptr<spot_name_filter> key_filter, unsigned group_id, size_t batch_size); 
+    spot_assembly(tf::Executor& executor, shared_ptr<spot_name_filter> key_filter, unsigned group_id, size_t batch_size, shared_ptr<spot_spill> spill = nullptr); 
 
     /**
      * @brief Destroy the spot assembly object
@@ -282,6 +445,21 @@ struct spot_assembly
      */
     const spot_rec_t& find(const char* name, int namelen);
 
+    /**
+     * @brief Searches the name in the batch (its names must be in memory), populates m_rec if found
+     * 
+     * @return true if found
+     */
+    bool search_batch(spot_batch& batch, const char* name, int namelen);
+
+    /**
+     * @brief Searches the name in the spilled batches, newest first,
+     * loads back the batches whose gate has the name
+     * 
+     * @return true if found
+     */
+    bool search_spilled(const char* name, int namelen);
+
     /**
      * @brief Applies F to all metadata in the group
      * 
@@ -379,6 +557,11 @@ void spot_assembly::pack_batch()
 
     string batch_idx = fmt::format("{}.{}", m_group_id, m_batches.size());
     auto batch = m_batches.back().get();
+    bool const spill = m_spill && m_spill->enabled();
+    if (spill) {
+        m_spill->enforce(); // the batches packed since the last call
+        m_spill->add(batch);
+    }
     batch->m_spot_map.swap(m_spot_map); 
     m_spot_map.reset(new array_map_t);
     m_spot_map->max_load_factor(64.);
@@ -391,15 +574,21 @@ void spot_assembly::pack_batch()
     batch->m_metadata.swap(m_metadata);
     batch->m_metadata->need_optimize = true;
     m_metadata.reset(new metadata_t);
-    batch->m_pack_job = m_executor.async([this, batch, batch_idx]() {
+    batch->m_pack_job = m_executor.async([this, batch, batch_idx, spill]() {
         auto& new_batch = *batch;
         spdlog::stopwatch sw1;
         spdlog::stopwatch sw;
         // Get the list of current spot name and sort them
         vector<const char*> sss;
         sss.reserve(new_batch.m_spot_map->size());
+        unique_ptr<blocked_bloom_filter> gate;
+        if (spill)
+            gate.reset(new blocked_bloom_filter(max<size_t>(new_batch.m_spot_map->size(), 1024)));
         for(auto it = new_batch.m_spot_map->begin(); it != new_batch.m_spot_map->end(); ++it) {
             sss.push_back(it.key());
+            new_batch.m_max_name_len = max<size_t>(new_batch.m_max_name_len, it.key_size());
+            if (gate)
+                gate->insert_hash(hashing::fnv1a(it.key(), it.key_size()));
         }
         if (m_stop_packing)
             return;
@@ -448,6 +637,9 @@ void spot_assembly::pack_batch()
         svector_u32::statistics st2;
         new_batch.m_index->optimize(TB, bm::bvector<>::opt_compress, &st2);
         new_batch.m_memory_used += st2.memory_used;
+        new_batch.m_names_size = new_batch.m_memory_used;
+        if (gate)
+            new_batch.m_memory_used += gate->memory_used();
 
         spdlog::info("{} Batch vector optimize: {:.3}, sv {:L}, idx: {:L}", batch_idx, sw, st1.memory_used, st2.memory_used); 
         if (m_stop_packing)
@@ -459,6 +651,7 @@ void spot_assembly::pack_batch()
         // Create and link scanner to spot_name vector    
         new_batch.m_scanner.reset(new spot_batch::scanner_t);
         new_batch.m_scanner->bind(*new_batch.m_data, true);
+        new_batch.m_gate = std::move(gate);
         new_batch.m_data_ready = true;
 
         spdlog::info("{} Batch done in : {:.3}", batch_idx, sw1); 
@@ -479,9 +672,10 @@ size_t spot_assembly::memory_used()
 }
 
 
-spot_assembly::spot_assembly(tf::Executor& executor, shared_ptr<spot_name_filter> key_filter, unsigned group_id, size_t batch_size ) 
+spot_assembly::spot_assembly(tf::Executor& executor, shared_ptr<spot_name_filter> key_filter, unsigned group_id, size_t batch_size, shared_ptr<spot_spill> spill) 
     : m_executor{executor}
     , m_key_filter(key_filter)
+    , m_spill(spill)
     , m_group_id(group_id)
 {
     m_batches.reserve(256);
@@ -498,6 +692,58 @@ spot_assembly::~spot_assembly()
         if (batch->m_pack_job.valid())
             batch->m_pack_job.get();
     });
+    if (m_spill) {
+        for (auto& batch : m_batches)
+            m_spill->remove(batch.get());
+    }
+}
+
+bool spot_assembly::search_batch(spot_batch& batch, const char* name, int namelen)
+{
+    if (batch.m_use_scanner) {
+        // the remap matrix of a loaded back vector covers only the stored name lengths
+        if ((size_t)namelen > batch.m_max_name_len)
+            return false;
+        str_sv_type::size_type pos = 0;
+        if (!batch.m_scanner->bfind_eq_str(name, namelen, pos))
+            return false;
+        m_rec.row_id = batch.m_index->get(pos);
+    } else {
+        auto it = batch.m_spot_map->find_ks(name, namelen, m_key_filter->get_name_hash());
+        bool const found = it != batch.m_spot_map->end();
+        if (found) 
+            m_rec.row_id = *it;
+        if (batch.m_data_ready) {
+            batch.m_use_scanner = true;
+            batch.m_spot_map.reset();
+        }
+        if (!found)
+            return false;
+    }
+    m_rec.wasInserted = false;
+    m_rec.pos = m_rec.row_id + batch.m_offset;
+    m_rec.metadata = batch.m_metadata.get();
+    if (m_spill)
+        batch.m_last_used = m_spill->now();
+    return true;
+}
+
+bool spot_assembly::search_spilled(const char* name, int namelen)
+{
+    uint64_t const hash = hashing::fnv1a(name, namelen);
+    bool loaded = false;
+    bool found = false;
+    for (auto it = m_batches.rbegin(); it != m_batches.rend() && !found; ++it) {
+        auto& batch = **it;
+        if (!batch.is_spilled() || !batch.m_gate->contains_hash(hash))
+            continue;
+        m_spill->load(batch);
+        loaded = true;
+        found = search_batch(batch, name, namelen);
+    }
+    if (loaded)
+        m_spill->enforce();
+    return found;
 }
 
 const spot_assembly::spot_rec_t& spot_assembly::find(const char* name, int namelen) 
@@ -510,7 +756,10 @@ const spot_assembly::spot_rec_t& spot_assembly::find(const char* name, int namel
     static size_t batch_found = 0;
 #endif    
     m_rec.wasInserted = true;
+    ++m_key_filter_total;
     if (m_key_filter->seen_before(name, namelen)) {
+        if (m_spill)
+            m_spill->tick();
         auto it = m_spot_map->find_ks(name, namelen, m_key_filter->get_name_hash());
 
         if (it != m_spot_map->end()) {
@@ -526,32 +775,10 @@ const spot_assembly::spot_rec_t& spot_assembly::find(const char* name, int namel
             m_taskflow.clear();
             m_search_done = false;
             m_taskflow.for_each(m_batches.rbegin(), m_batches.rend(), [this, &name, &namelen] (auto& batch) { 
-                if (m_search_done)
+                if (m_search_done || batch->is_spilled())
                     return;
-                if (batch->m_use_scanner) {
-                    str_sv_type::size_type pos = 0;
-                    if (batch->m_scanner->bfind_eq_str(name, namelen, pos)) { 
-                        m_search_done = true;
-                        m_rec.wasInserted = false;
-                        m_rec.row_id = batch->m_index->get(pos);
-                        m_rec.pos = m_rec.row_id + batch->m_offset;
-                        m_rec.metadata = batch->m_metadata.get();
-                    } 
-
-                } else {
-                    auto it = batch->m_spot_map->find_ks(name, namelen, m_key_filter->get_name_hash());
-                    if (it != batch->m_spot_map->end()) {
-                        m_search_done = true;
-                        m_rec.wasInserted = false;
-                        m_rec.row_id = *it;
-                        m_rec.pos = m_rec.row_id + batch->m_offset;
-                        m_rec.metadata = batch->m_metadata.get();
-                    } 
-                    if (batch->m_data_ready) {
-                        batch->m_use_scanner = true;
-                        batch->m_spot_map.reset();
-                    }
-                } 
+                if (search_batch(*batch, name, namelen))
+                    m_search_done = true;
             });
             m_executor.run(m_taskflow).wait();
     #if defined (COLLECT_STATS)    
@@ -560,29 +787,14 @@ const spot_assembly::spot_rec_t& spot_assembly::find(const char* name, int namel
     #endif                    
         } else if (m_batches.size() == 1) {
             auto& b = *m_batches.front();
-            if (b.m_use_scanner) {
-                str_sv_type::size_type pos = 0;
-                if (b.m_scanner->bfind_eq_str(name, namelen,  pos)) { 
-                    m_rec.wasInserted = false;
-                    m_rec.row_id = b.m_index->get(pos);
-                    m_rec.pos = m_rec.row_id + b.m_offset;
-                    m_rec.metadata = b.m_metadata.get();
-                    return m_rec;
-                } 
-            } else {
-                auto it = b.m_spot_map->find_ks(name, namelen, m_key_filter->get_name_hash());
-                if (it != b.m_spot_map->end()) {
-                    m_rec.wasInserted = false;
-                    m_rec.row_id = *it;
-                    m_rec.pos = m_rec.row_id + b.m_offset;
-                    m_rec.metadata = b.m_metadata.get();
-                } 
-                if (b.m_data_ready) {
-                    b.m_use_scanner = true;
-                    b.m_spot_map.reset();
-                }
-            } 
+            if (!b.is_spilled() && search_batch(b, name, namelen))
+                return m_rec;
         }
+        // the spilled batches are loaded back on this thread, after the in-memory ones missed
+        if (m_rec.wasInserted && m_spill && m_spill->enabled())
+            search_spilled(name, namelen);
+        if (m_rec.wasInserted)
+            ++m_key_filter_miss;
 #if defined (COLLECT_STATS)    
         if (rec.wasInserted) 
             ++bloom_collisions;
@@ -596,6 +808,8 @@ const spot_assembly::spot_rec_t& spot_assembly::find(const char* name, int namel
         m_rec.metadata = m_metadata.get();
         ++m_total_spots;
         ++m_curr_row;
+        if (m_spill && (m_total_spots & 0xfffff) == 0)
+            m_spill->enforce();
 #if defined (COLLECT_STATS)    
         ++new_rec;
 #endif        
@@ -657,11 +871,16 @@ void spot_assembly::visit_spots(F&& f)
     }
     for (auto& b : m_batches) {
         if (b->m_use_scanner) {
+            bool const spilled = b->is_spilled();
+            if (spilled)
+                m_spill->load(*b);
             auto data_it = b->m_data->begin();
             while (data_it.valid()) {
                 f(data_it.value());
                 data_it.advance();
             }
+            if (spilled)
+                m_spill->enforce();
         } else {
             for(auto it = b->m_spot_map->begin(); it != b->m_spot_map->end(); ++it) {
                 f(it.key());
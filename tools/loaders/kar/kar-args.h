@@ -40,6 +40,7 @@
 #define OPTION_DIRECTORY "directory"
 #define OPTION_STDOUT    "stdout"
 #define OPTION_MD5       "md5"
+#define OPTION_THREADS   "threads"
 /*TBD - add alignment option */
 
 
@@ -89,6 +90,9 @@ struct Params
     
     /*modifier to create mode to create an md5sum compatible auxilary file*/
     bool md5sum;
+
+    /* number of threads writing the files into the archive in create mode */
+    uint32_t threads;
 };
 
 
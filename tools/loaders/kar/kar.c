@@ -43,6 +43,9 @@
 #include <kfs/toc.h>
 #include <kfs/sra.h>
 #include <kfs/md5.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include <kapp/main.h>
 
@@ -55,6 +58,16 @@
 #include <endian.h>
 #include <byteswap.h>
 
+#if defined __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined SYS_copy_file_range
+#define KAR_COPY_FILE_RANGE 1
+#endif
+#endif
+
 
 /*******************************************************************************
  * Globals + Forwards + Declarations + Definitions
@@ -1276,8 +1289,499 @@ void kar_write_file ( KARArchiveFile *af, const KDirectory *wd, const KARFile *f
     KFileRelease ( f );
 }
 
+/********** threaded write of the files  */
+
+/* With more than one thread the files are copied by a pool of workers.
+   Their offsets were assigned by kar_prepare_toc, so without an md5 each
+   worker copies whole files straight to their place in the archive, with
+   copy_file_range(2) where the system has it: the kernel copies the data
+   without passing it through user space, or shares the blocks on a file
+   system that can ( btrfs, xfs ). The md5 is calculated by the KMD5File
+   as the data are written through it, and has to see them in archive
+   order. With an md5 the workers read chunks ahead into slots and the
+   main thread writes the slots in order. */
+
+#define KAR_CHUNK_SIZE ( 8 * 1024 * 1024 )
+#define KAR_SLOTS_PER_THREAD 2
+
+typedef struct KARChunk KARChunk;
+struct KARChunk
+{
+    char *data;
+    uint64_t file_idx;
+    uint64_t pos;
+    size_t size;
+    rc_t rc;
+    int exit_code;
+    bool done;
+};
+
+typedef struct KARWriter KARWriter;
+struct KARWriter
+{
+    const KDirectory *wd;
+    const char *root_dir;
+    KARFilePtrArray files;
+    uint64_t num_files;
+    uint64_t starting_pos;
+    uint64_t data_end;
+    KFile *archive;
+
+    KLock *lock;
+    KCondition *cond;
+
+    /* whole files: next one to copy, largest first */
+    uint64_t next_file;
+    int fd;             /* the archive for copy_file_range, or -1 */
+    bool zero_copy;
+
+    /* chunks in archive order */
+    KARChunk *slot;
+    uint32_t slots;
+    uint64_t next_in;   /* sequence number of the next chunk read */
+    uint64_t next_out;  /* sequence number of the next chunk written */
+    uint64_t in_file;   /* the next chunk starts in this file */
+    uint64_t in_pos;    /* ... at this position */
+
+    rc_t rc;
+    int exit_code;
+    bool quit;
+};
+
+typedef struct KARWorker KARWorker;
+struct KARWorker
+{
+    KARWriter *w;
+    KThread *thread;
+    char *buffer;
+    const KFile *f;
+    uint64_t f_idx;
+};
+
+/* called with the lock held, the first error stops the workers */
+static
+void kar_writer_fail ( KARWriter *w, rc_t rc, int exit_code )
+{
+    if ( w -> rc == 0 )
+    {
+        w -> rc = rc;
+        w -> exit_code = exit_code;
+    }
+    w -> quit = true;
+    KConditionBroadcast ( w -> cond );
+}
+
+static
+rc_t kar_open_input ( const KARWriter *w, const KARFile *file, const KFile **f,
+    char *filename, size_t fsize, int *exit_code )
+{
+    rc_t rc;
+    size_t path_size = kar_entry_full_path ( & file -> dad, w -> root_dir, filename, fsize );
+    if ( path_size == fsize )
+    {
+        rc = RC ( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+        LogErr ( klogInt, rc, "File path was too long" );
+        * exit_code = 5;
+        return rc;
+    }
+
+    rc = KDirectoryOpenFileRead ( w -> wd, f, "%s", filename );
+    if ( rc != 0 )
+    {
+        pLogErr ( klogInt, rc, "Failed to open file $(fname)", "fname=%s", file -> dad . name );
+        * exit_code = 6;
+    }
+    return rc;
+}
+
+#if KAR_COPY_FILE_RANGE
+/* copies from *pos on as far as the kernel does,
+   returns false if copy_file_range does not work for these files */
+static
+bool kar_copy_file_range ( const char *filename, int fd_out, uint64_t dst, uint64_t size, uint64_t *pos )
+{
+    bool works = true;
+    int fd_in = open ( filename, O_RDONLY );
+    if ( fd_in < 0 )
+        return true;
+
+    while ( * pos < size )
+    {
+        int64_t off_in = * pos;
+        int64_t off_out = dst + * pos;
+        long n = syscall ( SYS_copy_file_range, fd_in, & off_in, fd_out, & off_out,
+                           ( size_t ) ( size - * pos ), 0u );
+        if ( n > 0 )
+            * pos += n;
+        else if ( n < 0 && errno == EINTR )
+            continue;
+        else
+        {
+            /* ENOSYS, EXDEV, EINVAL, EOPNOTSUPP...; real i/o errors
+               come up again in the copy that takes over from here */
+            works = n == 0;
+            break;
+        }
+    }
+
+    close ( fd_in );
+    return works;
+}
+#endif
+
+static
+rc_t kar_copy_file ( KARWorker *self, const KARFile *file, bool *zero_copy, int *exit_code )
+{
+    KARWriter *w = self -> w;
+    const KFile *f;
+    char filename [ 4096 ];
+    uint64_t pos = 0;
+    uint64_t const dst = w -> starting_pos + file -> byte_offset;
+    uint64_t const end = dst + file -> byte_size;
+
+    rc_t rc = kar_open_input ( w, file, & f, filename, sizeof filename, exit_code );
+    if ( rc != 0 )
+        return rc;
+
+    STATUS ( STAT_QA, "copying '%s' to archive offset %lu", filename, dst );
+
+#if KAR_COPY_FILE_RANGE
+    if ( * zero_copy && w -> fd >= 0 )
+        * zero_copy = kar_copy_file_range ( filename, w -> fd, dst, file -> byte_size, & pos );
+#endif
+
+    while ( rc == 0 && pos < file -> byte_size )
+    {
+        size_t num_read, num_writ, to_read = KAR_CHUNK_SIZE;
+
+        if ( pos + to_read > file -> byte_size )
+            to_read = ( size_t ) ( file -> byte_size - pos );
+
+        rc = KFileReadAll ( f, pos, self -> buffer, to_read, & num_read );
+        if ( rc == 0 && num_read == 0 )
+            rc = RC ( rcExe, rcFile, rcReading, rcTransfer, rcIncomplete );
+        if ( rc == 0 )
+        {
+            rc = KFileWriteAll ( w -> archive, dst + pos, self -> buffer, num_read, & num_writ );
+            if ( rc == 0 && num_writ != num_read )
+                rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        }
+        pos += num_read;
+    }
+
+    /* the alignment gap up to the next file, as kar_write_file writes it */
+    if ( rc == 0 && end < w -> data_end )
+    {
+        size_t align_size = align_offset ( end, 4 ) - end;
+        if ( align_size != 0 )
+            rc = KFileWriteAll ( w -> archive, end, "0000", align_size, NULL );
+    }
+
+    if ( rc != 0 )
+    {
+        pLogErr ( klogInt, rc, "Failed to copy file $(fname) into archive", "fname=%s", file -> dad . name );
+        * exit_code = 5;
+    }
+
+    KFileRelease ( f );
+    return rc;
+}
+
 static
-rc_t kar_make ( const KDirectory * wd, KFile *archive, const BSTree *tree, const char * root_dir )
+rc_t CC kar_file_worker ( const KThread *t, void *data )
+{
+    KARWorker *self = data;
+    KARWriter *w = self -> w;
+
+    KLockAcquire ( w -> lock );
+    while ( ! w -> quit && w -> next_file < w -> num_files )
+    {
+        /* the files are sorted by size, the largest go first so that
+           the threads finish at about the same time */
+        const KARFile *file = w -> files [ w -> num_files - 1 - w -> next_file ++ ];
+        bool zero_copy = w -> zero_copy;
+        int exit_code = 0;
+        rc_t rc = 0;
+
+        KLockUnlock ( w -> lock );
+        if ( file -> byte_size != 0 )
+            rc = kar_copy_file ( self, file, & zero_copy, & exit_code );
+        KLockAcquire ( w -> lock );
+
+        if ( ! zero_copy && w -> zero_copy )
+        {
+            STATUS ( STAT_QA, "copy_file_range is not supported, copying through memory" );
+            w -> zero_copy = false;
+        }
+        if ( rc != 0 )
+            kar_writer_fail ( w, rc, exit_code );
+    }
+    KLockUnlock ( w -> lock );
+
+    return 0;
+}
+
+/* called with the lock held */
+static
+void kar_writer_skip_empty ( KARWriter *w )
+{
+    while ( w -> in_file < w -> num_files && w -> in_pos == w -> files [ w -> in_file ] -> byte_size )
+    {
+        ++ w -> in_file;
+        w -> in_pos = 0;
+    }
+}
+
+static
+rc_t CC kar_chunk_worker ( const KThread *t, void *data )
+{
+    KARWorker *self = data;
+    KARWriter *w = self -> w;
+
+    KLockAcquire ( w -> lock );
+    while ( ! w -> quit && w -> in_file < w -> num_files )
+    {
+        KARChunk *slot;
+        const KARFile *file;
+        size_t num_read;
+        int exit_code = 0;
+        rc_t rc = 0;
+
+        if ( w -> next_in - w -> next_out >= w -> slots )
+        {
+            KConditionWait ( w -> cond, w -> lock );
+            continue;
+        }
+
+        /* take the next chunk in archive order */
+        slot = & w -> slot [ w -> next_in ++ % w -> slots ];
+        file = w -> files [ w -> in_file ];
+        slot -> file_idx = w -> in_file;
+        slot -> pos = w -> in_pos;
+        slot -> size = KAR_CHUNK_SIZE;
+        if ( slot -> pos + slot -> size > file -> byte_size )
+            slot -> size = ( size_t ) ( file -> byte_size - slot -> pos );
+        w -> in_pos += slot -> size;
+        kar_writer_skip_empty ( w );
+        KLockUnlock ( w -> lock );
+
+        if ( self -> f == NULL || self -> f_idx != slot -> file_idx )
+        {
+            char filename [ 4096 ];
+
+            KFileRelease ( self -> f );
+            self -> f = NULL;
+            rc = kar_open_input ( w, file, & self -> f, filename, sizeof filename, & exit_code );
+            self -> f_idx = slot -> file_idx;
+        }
+        if ( rc == 0 )
+        {
+            rc = KFileReadAll ( self -> f, slot -> pos, slot -> data, slot -> size, & num_read );
+            if ( rc == 0 && num_read != slot -> size )
+                rc = RC ( rcExe, rcFile, rcReading, rcTransfer, rcIncomplete );
+            if ( rc != 0 )
+            {
+                pLogErr ( klogInt, rc, "Failed to read file $(fname)", "fname=%s", file -> dad . name );
+                exit_code = 5;
+            }
+        }
+
+        KLockAcquire ( w -> lock );
+        slot -> rc = rc;
+        slot -> exit_code = exit_code;
+        slot -> done = true;
+        KConditionBroadcast ( w -> cond );
+    }
+    KLockUnlock ( w -> lock );
+
+    KFileRelease ( self -> f );
+    return 0;
+}
+
+/* writes the chunks through af -> archive in archive order */
+static
+void kar_write_chunks ( KARArchiveFile *af, KARWriter *w )
+{
+    char align_buffer [ 4 ] = "0000";
+
+    while ( true )
+    {
+        KARChunk *slot = & w -> slot [ w -> next_out % w -> slots ];
+        const KARFile *file;
+        size_t num_writ;
+        rc_t rc = 0;
+
+        KLockAcquire ( w -> lock );
+        while ( ! slot -> done && ! w -> quit &&
+                ! ( w -> next_out == w -> next_in && w -> in_file == w -> num_files ) )
+            KConditionWait ( w -> cond, w -> lock );
+        if ( ! slot -> done )
+        {
+            KLockUnlock ( w -> lock );
+            break;
+        }
+        KLockUnlock ( w -> lock );
+
+        if ( slot -> rc != 0 )
+        {
+            KLockAcquire ( w -> lock );
+            kar_writer_fail ( w, slot -> rc, slot -> exit_code );
+            KLockUnlock ( w -> lock );
+            break;
+        }
+
+        file = w -> files [ slot -> file_idx ];
+        if ( slot -> pos == 0 )
+        {
+            size_t align_size = align_offset ( af -> pos, 4 ) - af -> pos;
+            if ( align_size != 0  )
+                rc = KFileWriteAll ( af -> archive, af -> pos, align_buffer, align_size, NULL );
+
+            af -> pos = af -> starting_pos + file -> byte_offset;
+            STATUS ( STAT_QA, "writing file '%s'", file -> dad . name );
+        }
+
+        if ( rc == 0 )
+        {
+            rc = KFileWriteAll ( af -> archive, af -> pos, slot -> data, slot -> size, & num_writ );
+            if ( rc == 0 && num_writ != slot -> size )
+                rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        }
+
+        KLockAcquire ( w -> lock );
+        if ( rc != 0 )
+        {
+            pLogErr ( klogInt, rc, "Failed to write file $(fname) into archive", "fname=%s", file -> dad . name );
+            kar_writer_fail ( w, rc, 5 );
+            KLockUnlock ( w -> lock );
+            break;
+        }
+        af -> pos += num_writ;
+        slot -> done = false;
+        ++ w -> next_out;
+        KConditionBroadcast ( w -> cond );
+        KLockUnlock ( w -> lock );
+    }
+}
+
+static
+void kar_write_files_threaded ( KARArchiveFile *af, const KDirectory *wd, KARFilePtrArray files, const Params *p )
+{
+    rc_t rc = 0;
+    uint32_t i, started = 0;
+    KARWorker *workers;
+    KARWriter w;
+
+    memset ( & w, 0, sizeof w );
+    w . wd = wd;
+    w . root_dir = p -> directory_path;
+    w . files = files;
+    w . num_files = num_files;
+    w . starting_pos = af -> starting_pos;
+    w . archive = af -> archive;
+    w . fd = -1;
+    w . data_end = af -> starting_pos;
+    if ( num_files != 0 )
+        w . data_end += files [ num_files - 1 ] -> byte_offset + files [ num_files - 1 ] -> byte_size;
+
+    workers = calloc ( p -> threads, sizeof * workers );
+    if ( workers == NULL )
+        rc = RC ( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+    else if ( p -> md5sum )
+    {
+        w . slots = p -> threads * KAR_SLOTS_PER_THREAD;
+        w . slot = calloc ( w . slots, sizeof * w . slot );
+        if ( w . slot == NULL )
+            rc = RC ( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+        for ( i = 0; rc == 0 && i < w . slots; ++ i )
+        {
+            w . slot [ i ] . data = malloc ( KAR_CHUNK_SIZE );
+            if ( w . slot [ i ] . data == NULL )
+                rc = RC ( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+        }
+        kar_writer_skip_empty ( & w );
+    }
+    else
+    {
+        for ( i = 0; rc == 0 && i < p -> threads; ++ i )
+        {
+            workers [ i ] . buffer = malloc ( KAR_CHUNK_SIZE );
+            if ( workers [ i ] . buffer == NULL )
+                rc = RC ( rcExe, rcFile, rcWriting, rcMemory, rcExhausted );
+        }
+#if KAR_COPY_FILE_RANGE
+        /* a descriptor of our own for the kernel copy, KDirectoryCreateFile
+           has opened the same path relative to the same directory */
+        w . fd = open ( p -> archive_path, O_WRONLY );
+        w . zero_copy = w . fd >= 0;
+#endif
+    }
+    if ( rc != 0 )
+    {
+        LogErr ( klogInt, rc, "Failed to allocate buffers for the threads" );
+        exit ( 7 );
+    }
+
+    rc = KLockMake ( & w . lock );
+    if ( rc == 0 )
+        rc = KConditionMake ( & w . cond );
+
+    STATUS ( STAT_QA, "about to write %u files on %u threads", num_files, p -> threads );
+    for ( i = 0; rc == 0 && i < p -> threads; ++ i, ++ started )
+    {
+        workers [ i ] . w = & w;
+        rc = KThreadMake ( & workers [ i ] . thread, p -> md5sum ? kar_chunk_worker : kar_file_worker, & workers [ i ] );
+    }
+    if ( rc != 0 )
+    {
+        LogErr ( klogInt, rc, "Failed to start the threads" );
+        if ( w . cond != NULL )
+        {
+            KLockAcquire ( w . lock );
+            kar_writer_fail ( & w, rc, 5 );
+            KLockUnlock ( w . lock );
+        }
+        else
+        {
+            w . rc = rc;
+            w . exit_code = 5;
+        }
+    }
+    else if ( p -> md5sum )
+        kar_write_chunks ( af, & w );
+
+    for ( i = 0; i < started; ++ i )
+    {
+        if ( workers [ i ] . thread != NULL )
+        {
+            rc_t rc2 = 0;
+            KThreadWait ( workers [ i ] . thread, & rc2 );
+            KThreadRelease ( workers [ i ] . thread );
+        }
+    }
+
+    if ( ! p -> md5sum && w . rc == 0 )
+        af -> pos = w . data_end;
+
+#if KAR_COPY_FILE_RANGE
+    if ( w . fd >= 0 )
+        close ( w . fd );
+#endif
+    for ( i = 0; i < p -> threads; ++ i )
+        free ( workers [ i ] . buffer );
+    free ( workers );
+    for ( i = 0; w . slot != NULL && i < w . slots; ++ i )
+        free ( w . slot [ i ] . data );
+    free ( w . slot );
+    KConditionRelease ( w . cond );
+    KLockRelease ( w . lock );
+
+    if ( w . rc != 0 )
+        exit ( w . exit_code );
+}
+
+static
+rc_t kar_make ( const KDirectory * wd, KFile *archive, const BSTree *tree, const Params *p )
 {
     rc_t rc = 0;
 
@@ -1301,12 +1805,17 @@ rc_t kar_make ( const KDirectory * wd, KFile *archive, const BSTree *tree, const
         /* write toc */
         kar_write_toc ( & af, tree );
 
-        /* write each of the files in order */
-        STATUS ( STAT_QA, "about to write %u files", num_files );
-        for ( i = 0; i < num_files; ++ i )
+        if ( p -> threads > 1 )
+            kar_write_files_threaded ( & af, wd, file_array, p );
+        else
         {
-            STATUS ( STAT_QA, "writing file %u: '%s'", i, file_array [ i ] -> dad . name );
-            kar_write_file ( & af, wd, file_array [ i ], root_dir );
+            /* write each of the files in order */
+            STATUS ( STAT_QA, "about to write %u files", num_files );
+            for ( i = 0; i < num_files; ++ i )
+            {
+                STATUS ( STAT_QA, "writing file %u: '%s'", i, file_array [ i ] -> dad . name );
+                kar_write_file ( & af, wd, file_array [ i ], p -> directory_path );
+            }
         }
 
         free ( file_array );
@@ -1365,7 +1874,7 @@ rc_t kar_create ( const Params *p )
                         {
                             BSTreeForEach ( &tree, false, kar_entry_link_parent_dir, NULL );
 
-                            rc = kar_make ( wd, archive, &tree, p -> directory_path );
+                            rc = kar_make ( wd, archive, &tree, p );
                             if ( rc != 0 )
                                 LogErr ( klogInt, rc, "Failed to build archive" );
                         }
@@ -9,6 +9,7 @@
 
 #include "fastq_read.hpp"
 #include "regexpr.hpp"
+#include "fastq_defline_scanner.hpp"
 #include <insdc/sra.h>
 
 using namespace std;
@@ -252,7 +253,8 @@ public:
         auto& readNum = re.GetMatch()[10];
 
         m_tmp_suffix.set(nullptr, 0);
-        if (illuminaOldSuffix2.Matches(y)) {
+        // the suffix patterns need a non-digit in y and a readNum longer than "/1"
+        if (!s_is_number(string_view(y.data(), y.size())) && illuminaOldSuffix2.Matches(y)) {
             y = illuminaOldSuffix2.GetMatch()[0];
             auto& suffix = illuminaOldSuffix2.GetMatch()[1];
             if (suffix.size() >= 3) {
@@ -260,7 +262,7 @@ public:
                     suffix.remove_prefix(2);
                 m_tmp_suffix = suffix;                    
             }         
-        } else if (!readNum.empty() && illuminaOldSuffix.Matches(readNum)) {
+        } else if (readNum.size() > 3 && illuminaOldSuffix.Matches(readNum)) {
             readNum = illuminaOldSuffix.GetMatch()[0];    
             if (illuminaOldSuffix.GetMatch()[1].size() >= 3) 
                 m_tmp_suffix = illuminaOldSuffix.GetMatch()[1];
@@ -407,6 +409,11 @@ public:
             "illuminaNew",
             R"(^[@>+]([!-~]+?)([:_])(\d+)([:_])(\d+)([:_])(-?\d+\.?\d*)([:_])(-?\d+\.\d+|\d+)(\s+|[:_|-])([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$))")
     {}
+
+    bool Matches(const string_view& defline) override
+    {
+        return re.Scan(defline, sharq::scan_illumina_new) || re.Matches(defline);
+    }
 };
 
 
@@ -494,6 +501,11 @@ public:
             R"(^[@>+]?([!-~]+?)(:)(\d+)(:)(\d+)(:)(-?\d+\.?\d*)([-:])(-?\d+\.\d+|-?\d+)_?[012]?(#[!-~]*?|)\s?(/[12345]|\\[12345])?(\s+|$))")
     {}
 
+    bool Matches(const string_view& defline) override
+    {
+        return re.Scan(defline, sharq::scan_illumina_old) || re.Matches(defline);
+    }
+
 };
 
 class CDefLineMatcherIlluminaOldUnderscore : public CDefLineMatcherIlluminaOldBase
@@ -555,6 +567,12 @@ public:
             R"(^[@>+](\S{1,3}\d{9}\S{0,3})(L\d)(C\d{3})(R\d{3})([_]?\d{1,8})(#[!-~]*?|)(/[1234]\S*|)(\s+|$))")
     {
     }
+
+    bool Matches(const string_view& defline) override
+    {
+        return re.Scan(defline, sharq::scan_bgi_old) || re.Matches(defline);
+    }
+
     uint8_t GetPlatform() const override {
         return 0;//SRA_PLATFORM_UNDEFINED
     };
@@ -593,6 +611,11 @@ public:
 
     {}
 
+    bool Matches(const string_view& defline) override
+    {
+        return re.Scan(defline, sharq::scan_bgi_new) || re.Matches(defline);
+    }
+
     uint8_t GetPlatform() const override {
         return 0;//SRA_PLATFORM_UNDEFINED
     };
@@ -915,11 +938,38 @@ public:
         getPoreBarcode( R"(barcode=(\S+))" )
     {}
 
+    bool Matches(const string_view& defline) override
+    {
+        mScanned = re.Scan(defline, sharq::scan_nanopore4);
+        return mScanned || re.Matches(defline);
+    }
+
     virtual void GetMatch(CFastqRead& read) override
     {
         // 0 self.name
         read.SetSpot( re.GetMatch()[0] );
 
+        const string Unclassified = string("unclassified");
+        if ( mScanned )
+        {   // ASCII line, the same fields as the regexes below
+            re2::StringPiece value;
+            const string& input = re.GetLastInput();
+            if ( sharq::find_number_field( input, "read", value ) )
+            {
+                read.SetNanoporeReadNo( value );
+            }
+            if ( sharq::find_number_field( input, "ch", value ) )
+            {
+                read.SetChannel( value );
+            }
+            if ( sharq::find_text_field( input, "barcode=", value ) && value != Unclassified )
+            {
+                read.SetSpotGroup( value );
+            }
+            PostProcess( read );
+            return;
+        }
+
         if ( getPoreReadNo.Matches(re.GetLastInput()) )
         {
             read.SetNanoporeReadNo( getPoreReadNo.GetMatch()[0] );
@@ -930,7 +980,6 @@ public:
             read.SetChannel( getPoreChannel.GetMatch()[0] );
         }
 
-        const string Unclassified = string("unclassified");
         if ( getPoreBarcode.Matches(re.GetLastInput()) &&
              getPoreBarcode.GetMatch()[0].as_string() != Unclassified )
         {
@@ -943,6 +992,7 @@ public:
     CRegExprMatcher getPoreReadNo;
     CRegExprMatcher getPoreChannel;
     CRegExprMatcher getPoreBarcode;
+    bool mScanned = false;  ///< last Matches() was done by the scanner
 };
 
 class CDefLineMatcherNanopore5 : public CDefLineMatcherNanoporeBase
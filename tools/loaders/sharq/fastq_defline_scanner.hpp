@@ -0,0 +1,396 @@
+#ifndef __FASTQ_DEFLINE_SCANNER_HPP__
+#define __FASTQ_DEFLINE_SCANNER_HPP__
+
+/**
+ * @file fastq_defline_scanner.hpp
+ * @brief Hand-written scanners for the most common defline formats
+ *
+ */
+
+/*
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description: single pass scanners in front of the defline regexes
+*
+* Each scanner handles the usual shape of one CDefLineMatcher's pattern and
+* fills the same capture groups RE2 would. A scanner accepts a line only when
+* it can tell which groups RE2 would capture, walking the alternatives in
+* RE2's order of preference; on anything unusual it returns false and the
+* matcher runs the regex. Returning false is always safe, accepting a line
+* the regex would capture differently is a bug (see the differential test in
+* test-sharq-reader).
+*
+* ===========================================================================
+*/
+
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <re2/re2.h>
+
+using namespace std;
+
+namespace sharq {
+
+typedef vector<re2::StringPiece> defline_groups_t;
+typedef bool (*defline_scanner_t)(const string_view& line, defline_groups_t& groups);
+
+/// RE2's \s
+static inline bool s_is_re_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r'; }
+/// [!-~]
+static inline bool s_is_graph(char c) { return c >= '!' && c <= '~'; }
+static inline bool s_is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline bool s_is_marker(char c) { return c == '@' || c == '>' || c == '+'; }
+
+template<typename Pred>
+static inline size_t s_span(const string_view& s, size_t pos, Pred pred)
+{
+    while (pos < s.size() && pred(s[pos]))
+        ++pos;
+    return pos;
+}
+
+static inline re2::StringPiece s_group(const string_view& s, size_t from, size_t to)
+{
+    return re2::StringPiece(s.data() + from, to - from);
+}
+
+/**
+ * @brief End of the defline's name, the first token after the marker
+ *
+ * @return position of the whitespace or the end of line after the name,
+ *         string_view::npos if the name holds anything but [!-~]
+ */
+static inline size_t s_name_end(const string_view& line)
+{
+    size_t e = s_span(line, 1, s_is_graph);
+    if (e < line.size() && !s_is_re_space(line[e]))
+        return string_view::npos;
+    return e;
+}
+
+/**
+ * @brief (\s+|$) at pos
+ */
+static inline bool s_end_sep(const string_view& line, size_t pos, re2::StringPiece& group)
+{
+    if (pos == line.size()) {
+        group = s_group(line, pos, pos);
+        return true;
+    }
+    if (!s_is_re_space(line[pos]))
+        return false;
+    group = s_group(line, pos, s_span(line, pos, s_is_re_space));
+    return true;
+}
+
+/**
+ * @brief ([12345]|):([NY]):(\d+|O):?([!-~]*?)(\s+|$) at pos, into groups[first..first + 4]
+ */
+static inline bool s_casava_tail(const string_view& line, size_t p, defline_groups_t& groups, size_t first)
+{
+    size_t const n = line.size();
+    if (p + 1 < n && line[p] >= '1' && line[p] <= '5' && line[p + 1] == ':') {
+        groups[first] = s_group(line, p, p + 1);
+        ++p;
+    } else if (p < n && line[p] == ':') {
+        groups[first] = s_group(line, p, p);
+    } else {
+        return false;
+    }
+    if (p + 3 >= n || (line[p + 1] != 'N' && line[p + 1] != 'Y') || line[p + 2] != ':')
+        return false;
+    groups[first + 1] = s_group(line, p + 1, p + 2);
+    p += 3;
+    size_t d = s_span(line, p, s_is_digit);
+    if (d == p) {
+        if (line[p] != 'O')
+            return false;
+        d = p + 1;
+    }
+    groups[first + 2] = s_group(line, p, d);
+    p = d;
+    if (p < n && line[p] == ':')
+        ++p;
+    size_t const b = s_span(line, p, s_is_graph);
+    groups[first + 3] = s_group(line, p, b);
+    return s_end_sep(line, b, groups[first + 4]);
+}
+
+/**
+ * @brief Splits "prefix:n:n:n:n" at the four separators before `end`
+ *
+ * The numbers are plain digits, the separators are any of `seps`
+ * The groups are prefix, sep, n, sep, n, sep, n, sep, n
+ */
+static inline bool s_four_numbers(const string_view& line, size_t end, const char* seps, defline_groups_t& groups)
+{
+    for (int k = 8; k > 0; k -= 2) {
+        size_t b = end;
+        while (b > 1 && s_is_digit(line[b - 1]))
+            --b;
+        if (b == end || b < 3 || strchr(seps, line[b - 1]) == nullptr)
+            return false;
+        groups[k] = s_group(line, b, end);
+        groups[k - 1] = s_group(line, b - 1, b);
+        end = b - 1;
+    }
+    groups[0] = s_group(line, 1, end);
+    return true;
+}
+
+/**
+ * @brief CDefLineMatcherIlluminaNew, e.g. "@A00123:8:H5KJ2DSXX:1:1101:1000:1000 1:N:0:ACGTACGT"
+ *
+ * Accepted: the name ends with four numbers and is followed by whitespace.
+ * The name must not contain ":N:" or ":Y:", otherwise the read number could
+ * also be found inside the name and RE2 might prefer a shorter prefix
+ */
+static inline bool scan_illumina_new(const string_view& line, defline_groups_t& groups)
+{
+    if (line.size() < 2 || !s_is_marker(line[0]))
+        return false;
+    size_t const e = s_name_end(line);
+    if (e == string_view::npos || e == line.size())
+        return false;
+    string_view const name = line.substr(0, e);
+    if (name.find(":N:") != string_view::npos || name.find(":Y:") != string_view::npos)
+        return false;
+    if (!s_four_numbers(line, e, ":_", groups))
+        return false;
+    size_t const w = s_span(line, e, s_is_re_space);
+    groups[9] = s_group(line, e, w);
+    return s_casava_tail(line, w, groups, 10);
+}
+
+/**
+ * @brief CDefLineMatcherIlluminaOldColon, e.g. "@HWUSI-EAS100R:6:73:941:1973#0/1"
+ *
+ * Accepted: the name is "prefix:n:n:n:n", optionally followed by "#barcode"
+ * and/or "/N"; the prefix has no '#', '/' or '\'
+ */
+static inline bool scan_illumina_old(const string_view& line, defline_groups_t& groups)
+{
+    size_t const n = line.size();
+    if (n < 2 || !s_is_marker(line[0]))
+        return false;
+    size_t const e = s_name_end(line);
+    if (e == string_view::npos)
+        return false;
+    auto is_read_num = [&](size_t k) {
+        return (line[k] == '/' || line[k] == '\\') && line[k + 1] >= '1' && line[k + 1] <= '5';
+    };
+    size_t h = 1;
+    while (h < e && line[h] != '#' && line[h] != '/' && line[h] != '\\')
+        ++h;
+    if (!s_four_numbers(line, h, ":", groups))
+        return false;
+
+    size_t p = e;   // where \s? starts
+    if (h == e) {
+        groups[9] = s_group(line, h, h);
+    } else if (line[h] == '#') {
+        // the barcode is lazy: it stops before a read number that ends the name
+        if (e - 2 > h && is_read_num(e - 2))
+            p = e - 2;
+        groups[9] = s_group(line, h, p);
+    } else {
+        if (h + 2 != e || !is_read_num(h))
+            return false;
+        groups[9] = s_group(line, h, h);
+        p = h;
+    }
+
+    if (p < e) {
+        groups[10] = s_group(line, p, e);
+        return s_end_sep(line, e, groups[11]);
+    }
+    groups[10] = re2::StringPiece();
+    if (e < n) {
+        // \s? takes one space, a read number may follow it
+        size_t const r = e + 1;
+        if (r + 1 < n && is_read_num(r) && (r + 2 == n || s_is_re_space(line[r + 2]))) {
+            groups[10] = s_group(line, r, r + 2);
+            return s_end_sep(line, r + 2, groups[11]);
+        }
+        if (s_end_sep(line, r, groups[11]))
+            return true;
+    }
+    return s_end_sep(line, e, groups[11]);
+}
+
+/**
+ * @brief \S{1,3}\d{9}\S{0,3}(L\d)(C\d{3})(R\d{3})([_]?\d{1,8}) of the BGI flowcell, in RE2's order
+ *
+ * @return position after the read number, string_view::npos if not recognized
+ */
+static inline size_t s_bgi_flowcell(const string_view& line, size_t e, defline_groups_t& groups)
+{
+    auto digits = [&](size_t from, size_t count) {
+        for (size_t i = from; i < from + count; ++i)
+            if (!s_is_digit(line[i]))
+                return false;
+        return true;
+    };
+    for (size_t a = 3; a >= 1; --a) {
+        if (1 + a + 9 > e || !digits(1 + a, 9))
+            continue;
+        for (size_t b = 4; b-- > 0;) {
+            size_t const l = 1 + a + 9 + b;
+            if (l + 10 > e || line[l] != 'L' || !s_is_digit(line[l + 1]) ||
+                line[l + 2] != 'C' || !digits(l + 3, 3) || line[l + 6] != 'R' || !digits(l + 7, 3))
+                continue;
+            // the rest of the pattern has to work with the first flowcell RE2 tries
+            size_t q = l + 10;
+            size_t const r0 = q < e && line[q] == '_' ? q + 1 : q;
+            size_t const d = s_span(line.substr(0, min(e, r0 + 8)), r0, s_is_digit);
+            if (d == r0)
+                return string_view::npos;
+            groups[0] = s_group(line, 1, l);
+            groups[1] = s_group(line, l, l + 2);
+            groups[2] = s_group(line, l + 2, l + 6);
+            groups[3] = s_group(line, l + 6, l + 10);
+            groups[4] = s_group(line, q, d);
+            return d;
+        }
+    }
+    return string_view::npos;
+}
+
+/**
+ * @brief CDefLineMatcherBgiNew, e.g. "@V300019058L1C001R0010000001 1:N:0:ATGGTAGG"
+ */
+static inline bool scan_bgi_new(const string_view& line, defline_groups_t& groups)
+{
+    if (line.size() < 2 || !s_is_marker(line[0]))
+        return false;
+    size_t const e = s_name_end(line);
+    if (e == string_view::npos || e == line.size())
+        return false;
+    size_t const r = s_bgi_flowcell(line, e, groups);
+    if (r == string_view::npos)
+        return false;
+    groups[5] = s_group(line, r, e);
+    size_t const w = s_span(line, e, s_is_re_space);
+    groups[6] = s_group(line, e, w);
+    return s_casava_tail(line, w, groups, 7);
+}
+
+/**
+ * @brief CDefLineMatcherBgiOld, e.g. "@V300047012L3C001R0010000001/1"
+ */
+static inline bool scan_bgi_old(const string_view& line, defline_groups_t& groups)
+{
+    if (line.size() < 2 || !s_is_marker(line[0]))
+        return false;
+    size_t const e = s_name_end(line);
+    if (e == string_view::npos)
+        return false;
+    size_t const r = s_bgi_flowcell(line, e, groups);
+    if (r == string_view::npos)
+        return false;
+    auto is_read_num = [&](size_t k) {
+        return k + 1 < e && line[k] == '/' && line[k + 1] >= '1' && line[k + 1] <= '4';
+    };
+    size_t k = r;
+    if (r < e && line[r] == '#') {
+        // the barcode is lazy: it stops before the first "/N"
+        k = r + 1;
+        while (k < e && !is_read_num(k))
+            ++k;
+    } else if (r < e && !is_read_num(r)) {
+        return false;
+    }
+    groups[5] = s_group(line, r, k);
+    groups[6] = s_group(line, k, e);
+    return s_end_sep(line, e, groups[7]);
+}
+
+/**
+ * @brief CDefLineMatcherNanopore4, e.g. "@aba5dfd4-af02-46d1-9bce-3b62557aa8c1 runid=... read=29 ch=350"
+ *
+ * Accepted: the name holds an 8-4-4-4-12 id and the line is all ASCII,
+ * so that find_number_field()/find_text_field() can stand in for the
+ * regexes CDefLineMatcherNanopore4 runs over the whole line
+ */
+static inline bool scan_nanopore4(const string_view& line, defline_groups_t& groups)
+{
+    if (line.size() < 2 || !s_is_marker(line[0]))
+        return false;
+    for (char c : line)
+        if ((unsigned char)c >= 0x80)
+            return false;
+    size_t const e = s_name_end(line);
+    if (e == string_view::npos)
+        return false;
+    for (size_t o = 1; o + 36 <= e; ++o) {
+        if (line[o + 8] == '-' && line[o + 13] == '-' && line[o + 18] == '-' && line[o + 23] == '-') {
+            groups[0] = s_group(line, 1, e);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Same as the regex "<key>[=_]?(\d+)" on an ASCII line
+ */
+static inline bool find_number_field(const string_view& line, const string_view& key, re2::StringPiece& value)
+{
+    size_t const n = line.size();
+    for (size_t i = line.find(key); i != string_view::npos; i = line.find(key, i + 1)) {
+        size_t j = i + key.size();
+        if (j + 1 < n && (line[j] == '=' || line[j] == '_') && s_is_digit(line[j + 1]))
+            ++j;
+        size_t const d = s_span(line, j, s_is_digit);
+        if (d > j) {
+            value = s_group(line, j, d);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Same as the regex "<key>(\S+)" on an ASCII line
+ */
+static inline bool find_text_field(const string_view& line, const string_view& key, re2::StringPiece& value)
+{
+    size_t const n = line.size();
+    for (size_t i = line.find(key); i != string_view::npos; i = line.find(key, i + 1)) {
+        size_t const j = i + key.size();
+        if (j < n && !s_is_re_space(line[j])) {
+            value = s_group(line, j, s_span(line, j, [](char c) { return !s_is_re_space(c); }));
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // sharq namespace
+
+#endif
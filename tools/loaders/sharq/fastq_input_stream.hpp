@@ -0,0 +1,581 @@
+#ifndef __FASTQ_INPUT_STREAM_HPP__
+#define __FASTQ_INPUT_STREAM_HPP__
+
+/**
+ * @file fastq_input_stream.hpp
+ * @brief Input streams decompressing on background threads
+ *
+ */
+
+/*
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description: input streams decompressing on background threads
+*
+* BGZF files (gzip members of at most 64K, each announcing its compressed size
+* in the header) are inflated by a pool of threads, a member per task.
+* Other compressed files (plain or multi-member gzip, bzip2) can not be split
+* without decompressing them, they are decompressed by bxzstr on a read-ahead
+* thread into a ring of buffers.
+* Both are plugged in behind std::istream, the reader does not see the difference.
+*
+* ===========================================================================
+*/
+
+#include "bxzstr/bxzstr.hpp"
+#include <zlib.h>
+#include <istream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <chrono>
+#include <limits>
+#include <cstring>
+
+using namespace std;
+
+namespace sharq {
+
+/**
+ * @brief Decompression statistics of an input file
+ *
+ */
+struct decompression_metrics_t {
+    string mode{"none"};        ///< "none", "bgzf" or "read-ahead"
+    unsigned threads{0};        ///< number of decompressing threads
+    size_t compressed_bytes{0}; ///< compressed bytes consumed
+    size_t bytes{0};            ///< decompressed bytes produced
+    double cpu_time{0};         ///< seconds spent decompressing, summed over the threads
+    double wall_time{0};        ///< seconds between the open and the end of data
+};
+
+/**
+ * @brief streambuf decompressing on background threads
+ *
+ */
+class input_streambuf : public std::streambuf
+{
+public:
+    virtual ~input_streambuf() = default;
+    virtual bxz::Compression compression() const = 0;  ///< compression of the file
+    virtual size_t compressed_tellg() const = 0;       ///< position in the compressed file of the data returned so far
+    virtual decompression_metrics_t metrics() const = 0;
+
+protected:
+    using clock_t = std::chrono::steady_clock;
+    static double s_seconds(clock_t::time_point start) {
+        return std::chrono::duration<double>(clock_t::now() - start).count();
+    }
+};
+
+/**
+ * @brief istream over an input_streambuf
+ *
+ */
+class input_stream : public std::istream
+{
+public:
+    explicit input_stream(unique_ptr<input_streambuf> buf)
+        : std::istream(buf.get())
+        , m_buf(std::move(buf))
+    {}
+
+    bxz::Compression compression() const { return m_buf->compression(); }
+    size_t compressed_tellg() const { return m_buf->compressed_tellg(); }
+    decompression_metrics_t metrics() const { return m_buf->metrics(); }
+
+private:
+    unique_ptr<input_streambuf> m_buf;
+};
+
+
+/**
+ * @brief Inflates the members of a BGZF file on a pool of threads
+ *
+ * A worker claims the next member under the I/O lock, reads it, and inflates it
+ * into its slot of the ring. The consumer takes the slots in file order,
+ * a slot is reused when the consumer moved past it.
+ */
+class bgzf_streambuf : public input_streambuf
+{
+public:
+    static constexpr size_t BLOCKS_PER_THREAD = 4;
+    static constexpr size_t MAX_BLOCK_SIZE = 64 * 1024;
+
+    bgzf_streambuf(const string& file_name, unsigned threads)
+        : m_file_name(file_name)
+        , m_file(file_name, ios::in | ios::binary)
+        , m_ring(max(threads, 1u) * BLOCKS_PER_THREAD)
+        , m_threads(max(threads, 1u))
+        , m_start(clock_t::now())
+    {
+        if (!m_file.good())
+            throw runtime_error("Failure to open '" + file_name + "'");
+        for (unsigned i = 0; i < m_threads; ++i)
+            m_workers.emplace_back([this]() { worker(); });
+    }
+
+    ~bgzf_streambuf()
+    {
+        {
+            lock_guard<mutex> lk(m_mutex);
+            m_stop = true;
+        }
+        m_cv_worker.notify_all();
+        for (auto& t : m_workers)
+            t.join();
+    }
+
+    /**
+     * @brief Returns true if the data starts with a BGZF header
+     *
+     * gzip member with FEXTRA only and the "BC" subfield first (SAM specification, 4.1)
+     */
+    static bool is_bgzf(const unsigned char* p, size_t size)
+    {
+        return size >= 18
+            && p[0] == 0x1f && p[1] == 0x8b && p[2] == 8 && p[3] == 4
+            && (p[10] | (p[11] << 8)) >= 6
+            && p[12] == 'B' && p[13] == 'C' && p[14] == 2 && p[15] == 0;
+    }
+
+    bxz::Compression compression() const override { return bxz::z; }
+    size_t compressed_tellg() const override { return m_pos; }
+
+    decompression_metrics_t metrics() const override
+    {
+        lock_guard<mutex> lk(m_mutex);
+        decompression_metrics_t m;
+        m.mode = "bgzf";
+        m.threads = m_threads;
+        m.compressed_bytes = m_pos;
+        m.bytes = m_bytes;
+        m.cpu_time = m_cpu_time;
+        m.wall_time = m_done ? m_wall_time : s_seconds(m_start);
+        return m;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        unique_lock<mutex> lk(m_mutex);
+        while (true) {
+            if (m_has_current) {
+                m_ring[m_next_get % m_ring.size()].state = eFree;
+                ++m_next_get;
+                m_has_current = false;
+                m_cv_worker.notify_all();
+            }
+            auto& b = m_ring[m_next_get % m_ring.size()];
+            m_cv_consumer.wait(lk, [&]() {
+                return b.state == eReady || (m_read_done && m_next_get >= m_end_seq);
+            });
+            if (b.state != eReady)
+                break;
+            m_has_current = true;
+            if (!b.error.empty())
+                throw runtime_error(b.error);
+            m_pos = b.end_pos;
+            m_bytes += b.out.size();
+            if (b.out.empty())
+                continue; // EOF marker or empty member
+            setg(b.out.data(), b.out.data(), b.out.data() + b.out.size());
+            return traits_type::to_int_type(*gptr());
+        }
+        if (!m_done) {
+            m_done = true;
+            m_wall_time = s_seconds(m_start);
+        }
+        if (!m_error.empty())
+            throw runtime_error(m_error);
+        setg(nullptr, nullptr, nullptr);
+        return traits_type::eof();
+    }
+
+private:
+    enum EState { eFree, eLoaded, eReady };
+
+    struct block_t {
+        vector<unsigned char> in;   ///< member as read from the file
+        vector<char> out;           ///< inflated member
+        size_t data_offset = 0;     ///< offset of the deflated data in 'in'
+        size_t end_pos = 0;         ///< file position past the member
+        string error;               ///< inflate failure
+        EState state = eFree;
+    };
+
+    /**
+     * @brief Reads the next member, returns false at the end of file
+     *
+     * Under the I/O lock; sets error on a malformed or truncated member
+     */
+    bool read_block(block_t& b, string& error)
+    {
+        unsigned char hdr[12];
+        m_file.read((char*)hdr, sizeof(hdr));
+        auto got = (size_t)m_file.gcount();
+        if (got == 0)
+            return false;
+        if (got < sizeof(hdr) || hdr[0] != 0x1f || hdr[1] != 0x8b || hdr[2] != 8 || (hdr[3] & 4) == 0) {
+            error = "'" + m_file_name + "': not a BGZF block at offset " + to_string(m_read_pos);
+            return false;
+        }
+        size_t const xlen = hdr[10] | (hdr[11] << 8);
+        b.in.resize(sizeof(hdr) + xlen);
+        memcpy(b.in.data(), hdr, sizeof(hdr));
+        m_file.read((char*)b.in.data() + sizeof(hdr), xlen);
+        size_t block_size = 0;
+        if ((size_t)m_file.gcount() == xlen) {
+            for (size_t i = sizeof(hdr); i + 4 <= b.in.size(); ) {
+                size_t const slen = b.in[i + 2] | (b.in[i + 3] << 8);
+                if (b.in[i] == 'B' && b.in[i + 1] == 'C' && slen == 2 && i + 6 <= b.in.size()) {
+                    block_size = (b.in[i + 4] | (b.in[i + 5] << 8)) + 1;
+                    break;
+                }
+                i += 4 + slen;
+            }
+        }
+        if (block_size < b.in.size() + 8) {
+            error = "'" + m_file_name + "': not a BGZF block at offset " + to_string(m_read_pos);
+            return false;
+        }
+        size_t const head = b.in.size();
+        b.in.resize(block_size);
+        m_file.read((char*)b.in.data() + head, block_size - head);
+        if ((size_t)m_file.gcount() != block_size - head) {
+            error = "'" + m_file_name + "': truncated BGZF block at offset " + to_string(m_read_pos);
+            return false;
+        }
+        b.data_offset = head;
+        m_read_pos += block_size;
+        b.end_pos = m_read_pos;
+        return true;
+    }
+
+    /**
+     * @brief Inflates a member, checks its size and CRC
+     *
+     */
+    void inflate_block(block_t& b, z_stream& zs)
+    {
+        auto const trailer = b.in.data() + b.in.size() - 8;
+        uint32_t const crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+        uint32_t const isize = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+        b.error.clear();
+        if (isize > MAX_BLOCK_SIZE) {
+            b.error = "'" + m_file_name + "': invalid BGZF block size before offset " + to_string(b.end_pos);
+            b.out.clear();
+            return;
+        }
+        b.out.resize(isize);
+        inflateReset(&zs);
+        zs.next_in = b.in.data() + b.data_offset;
+        zs.avail_in = (uInt)(trailer - zs.next_in);
+        zs.next_out = (Bytef*)b.out.data();
+        zs.avail_out = isize;
+        int const rc = inflate(&zs, Z_FINISH);
+        if (rc != Z_STREAM_END || zs.avail_out != 0
+            || crc32(crc32(0L, Z_NULL, 0), (const Bytef*)b.out.data(), isize) != crc) {
+            b.error = "'" + m_file_name + "': corrupt BGZF block before offset " + to_string(b.end_pos);
+            b.out.clear();
+        }
+    }
+
+    void worker()
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -15) != Z_OK) {
+            lock_guard<mutex> lk(m_mutex);
+            if (m_error.empty())
+                m_error = "'" + m_file_name + "': inflateInit2 failed";
+            m_stop = m_read_done = true;
+            m_end_seq = min(m_end_seq, m_next_read);
+            m_cv_consumer.notify_all();
+            m_cv_worker.notify_all();
+            return;
+        }
+        while (true) {
+            unique_lock<mutex> io(m_io_mutex);
+            unique_lock<mutex> lk(m_mutex);
+            m_cv_worker.wait(lk, [this]() {
+                return m_stop || m_read_done || m_ring[m_next_read % m_ring.size()].state == eFree;
+            });
+            if (m_stop || m_read_done)
+                break;
+            size_t const seq = m_next_read++;
+            auto& b = m_ring[seq % m_ring.size()];
+            b.state = eLoaded;
+            lk.unlock();
+
+            string error;
+            bool const has_block = read_block(b, error);
+            if (!has_block) {
+                // still under the I/O lock: no other worker reads past the end
+                lk.lock();
+                b.state = eFree;
+                m_read_done = true;
+                m_end_seq = seq;
+                m_error = error;
+                m_cv_consumer.notify_all();
+                m_cv_worker.notify_all();
+                break;
+            }
+            io.unlock();
+
+            auto const start = clock_t::now();
+            inflate_block(b, zs);
+            double const elapsed = s_seconds(start);
+
+            lk.lock();
+            m_cpu_time += elapsed;
+            b.state = eReady;
+            if (seq == m_next_get)
+                m_cv_consumer.notify_all();
+        }
+        inflateEnd(&zs);
+    }
+
+    string m_file_name;
+    ifstream m_file;
+    vector<block_t> m_ring;
+    unsigned m_threads;
+    vector<thread> m_workers;
+
+    mutable mutex m_mutex;              ///< guards the ring and the counters
+    mutex m_io_mutex;                   ///< orders the reads of the members
+    condition_variable m_cv_worker;
+    condition_variable m_cv_consumer;
+
+    size_t m_next_read = 0;             ///< sequence number of the next member to read
+    size_t m_next_get = 0;              ///< sequence number of the member being consumed
+    size_t m_end_seq = numeric_limits<size_t>::max(); ///< number of members in the file
+    size_t m_read_pos = 0;              ///< file position of the next member (under m_io_mutex)
+    bool m_has_current = false;
+    bool m_read_done = false;
+    bool m_stop = false;
+    string m_error;                     ///< read failure at m_end_seq
+
+    size_t m_pos = 0;
+    size_t m_bytes = 0;
+    double m_cpu_time = 0;
+    clock_t::time_point m_start;
+    bool m_done = false;
+    double m_wall_time = 0;
+};
+
+
+/**
+ * @brief Decompresses a file with bxzstr on a read-ahead thread
+ *
+ * The thread fills a ring of chunks ahead of the consumer
+ */
+class read_ahead_streambuf : public input_streambuf
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+    static constexpr size_t CHUNKS = 8;
+
+    read_ahead_streambuf(const string& file_name, size_t buffer_size, size_t file_size, bxz::Compression compression)
+        : m_stream(file_name, ios::in, buffer_size)
+        , m_ring(CHUNKS)
+        , m_file_size(file_size)
+        , m_compression(compression)
+        , m_start(clock_t::now())
+    {
+        m_stream.exceptions(std::ifstream::badbit);
+        for (auto& c : m_ring)
+            c.data.resize(CHUNK_SIZE);
+        m_thread = thread([this]() { producer(); });
+    }
+
+    ~read_ahead_streambuf()
+    {
+        {
+            lock_guard<mutex> lk(m_mutex);
+            m_stop = true;
+        }
+        m_cv_producer.notify_all();
+        m_thread.join();
+    }
+
+    bxz::Compression compression() const override { return m_compression; }
+    size_t compressed_tellg() const override { return m_pos; }
+
+    decompression_metrics_t metrics() const override
+    {
+        lock_guard<mutex> lk(m_mutex);
+        decompression_metrics_t m;
+        m.mode = "read-ahead";
+        m.threads = 1;
+        m.compressed_bytes = m_pos;
+        m.bytes = m_bytes;
+        m.cpu_time = m_cpu_time;
+        m.wall_time = m_done ? m_wall_time : s_seconds(m_start);
+        return m;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        unique_lock<mutex> lk(m_mutex);
+        if (m_has_current) {
+            ++m_consumed;
+            m_has_current = false;
+            m_cv_producer.notify_one();
+        }
+        m_cv_consumer.wait(lk, [this]() { return m_filled > m_consumed || m_eof; });
+        if (m_filled > m_consumed) {
+            auto& c = m_ring[m_consumed % m_ring.size()];
+            m_has_current = true;
+            m_pos = c.end_pos;
+            m_bytes += c.size;
+            setg(c.data.data(), c.data.data(), c.data.data() + c.size);
+            return traits_type::to_int_type(*gptr());
+        }
+        if (!m_done) {
+            m_done = true;
+            m_wall_time = s_seconds(m_start);
+        }
+        if (m_error)
+            rethrow_exception(m_error);
+        setg(nullptr, nullptr, nullptr);
+        return traits_type::eof();
+    }
+
+private:
+    struct chunk_t {
+        vector<char> data;
+        size_t size = 0;
+        size_t end_pos = 0;     ///< compressed position past the chunk
+    };
+
+    void producer()
+    {
+        unique_lock<mutex> lk(m_mutex);
+        while (true) {
+            m_cv_producer.wait(lk, [this]() { return m_stop || m_filled - m_consumed < m_ring.size(); });
+            if (m_stop)
+                break;
+            auto& c = m_ring[m_filled % m_ring.size()];
+            lk.unlock();
+
+            exception_ptr error;
+            auto const start = clock_t::now();
+            try {
+                m_stream.read(c.data.data(), c.data.size());
+            } catch (...) {
+                error = current_exception();
+            }
+            c.size = m_stream.gcount();
+            auto const pos = m_stream.compressed_tellg();
+            c.end_pos = pos >= 0 ? (size_t)pos : m_file_size;
+            double const elapsed = s_seconds(start);
+
+            lk.lock();
+            m_cpu_time += elapsed;
+            if (c.size > 0)
+                ++m_filled;
+            if (error || c.size < c.data.size()) {
+                m_error = error;
+                m_eof = true;
+            }
+            m_cv_consumer.notify_one();
+            if (m_eof)
+                break;
+        }
+    }
+
+    bxz::ifstream m_stream;
+    vector<chunk_t> m_ring;
+    size_t m_file_size;
+    bxz::Compression m_compression;     ///< detected when the file was opened
+    thread m_thread;
+
+    mutable mutex m_mutex;
+    condition_variable m_cv_producer;
+    condition_variable m_cv_consumer;
+    size_t m_filled = 0;                ///< chunks produced
+    size_t m_consumed = 0;              ///< chunks released by the consumer
+    bool m_has_current = false;
+    bool m_eof = false;
+    bool m_stop = false;
+    exception_ptr m_error;
+
+    size_t m_pos = 0;
+    size_t m_bytes = 0;
+    double m_cpu_time = 0;
+    clock_t::time_point m_start;
+    bool m_done = false;
+    double m_wall_time = 0;
+};
+
+
+/**
+ * @brief Opens a compressed file for decompression on background threads
+ *
+ * @param[in] file_name
+ * @param[in] buffer_size buffer size of the sequential decompression
+ * @param[in] threads number of threads for BGZF files
+ * @return input stream or nullptr if the file is not compressed (or can not be opened)
+ */
+inline
+shared_ptr<istream> open_input_stream(const string& file_name, size_t buffer_size, unsigned threads)
+{
+    unsigned char head[18];
+    size_t got = 0;
+    size_t file_size = 0;
+    {
+        ifstream f(file_name, ios::in | ios::binary | ios::ate);
+        if (!f.good())
+            return nullptr;
+        file_size = (size_t)f.tellg();
+        f.seekg(0);
+        f.read((char*)head, sizeof(head));
+        got = f.gcount();
+    }
+    if (bgzf_streambuf::is_bgzf(head, got))
+        return make_shared<input_stream>(make_unique<bgzf_streambuf>(file_name, threads));
+    if (got < 6)
+        return nullptr;
+    auto const compression = bxz::detect_type((char*)head, (char*)head + got);
+    if (compression == bxz::plaintext)
+        return nullptr;
+    return make_shared<input_stream>(make_unique<read_ahead_streambuf>(file_name, buffer_size, file_size, compression));
+}
+
+}  // sharq namespace
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __FASTQ_LINE_READER_HPP__
+#define __FASTQ_LINE_READER_HPP__
+
+/**
+ * @file fastq_line_reader.hpp
+ * @brief Line reader over large blocks of an input stream
+ *
+ */
+
+/*
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description: line reader over large blocks of an input stream
+*
+* The stream is read in blocks, the lines are found with memchr (vectorized
+* by the C library) and returned as string_views into the block, nothing is
+* copied per line. A line crossing the end of the block is moved to the front
+* of the buffer before the next block is appended to it.
+*
+* ===========================================================================
+*/
+
+#include <istream>
+#include <string_view>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+namespace sharq {
+
+class line_reader
+{
+public:
+    static constexpr size_t MIN_BLOCK = 4 * 1024;       ///< first read, small for short inputs and the digest
+    static constexpr size_t MAX_BLOCK = 1024 * 1024;    ///< the blocks double up to this size
+
+    explicit line_reader(istream& stream)
+        : m_stream(stream)
+    {}
+
+    /**
+     * @brief Returns the next line (without the '\n'), valid until the next call
+     *
+     * Same as std::getline: false if the end of data was reached before a '\n',
+     * the line then holds the rest of the data (possibly empty) and eof() is true
+     *
+     * @param[out] line
+     * @return true if the line was terminated by '\n'
+     */
+    bool get_line(string_view& line)
+    {
+        while (true) {
+            const char* begin = m_buf.data() + m_begin;
+            const char* end = m_buf.data() + m_end;
+            size_t const unscanned = end - begin - m_scanned;
+            auto nl = unscanned ? (const char*)memchr(begin + m_scanned, '\n', unscanned) : nullptr;
+            if (nl != nullptr) {
+                line = string_view(begin, nl - begin);
+                m_begin += line.size() + 1;
+                m_consumed += line.size() + 1;
+                m_scanned = 0;
+                return true;
+            }
+            if (m_stream_eof) {
+                line = string_view(begin, end - begin);
+                m_consumed += line.size();
+                m_begin = m_end;
+                m_scanned = 0;
+                m_eof = true;
+                return false;
+            }
+            m_scanned = end - begin;
+            fill();
+        }
+    }
+
+    bool eof() const { return m_eof; }              ///< true once a line was ended by the end of data
+    size_t consumed() const { return m_consumed; }  ///< bytes returned as lines (with the '\n's)
+    size_t pulled() const { return m_pulled; }      ///< bytes read from the stream
+
+private:
+    /**
+     * @brief Keeps the unfinished line, appends the next block
+     *
+     */
+    void fill()
+    {
+        size_t const pending = m_end - m_begin;
+        if (m_begin > 0) {
+            if (pending)
+                memmove(m_buf.data(), m_buf.data() + m_begin, pending);
+            m_begin = 0;
+            m_end = pending;
+        }
+        if (m_buf.size() < pending + m_block)
+            m_buf.resize(pending + m_block);
+        m_stream.read(m_buf.data() + m_end, m_block);
+        size_t const got = m_stream.gcount();
+        m_end += got;
+        m_pulled += got;
+        if (got < m_block)
+            m_stream_eof = true;
+        if (m_block < MAX_BLOCK)
+            m_block *= 2;
+    }
+
+    istream& m_stream;
+    vector<char> m_buf;
+    size_t m_begin = 0;         ///< start of the unread data in m_buf
+    size_t m_end = 0;           ///< end of the data in m_buf
+    size_t m_scanned = 0;       ///< bytes after m_begin known not to contain '\n'
+    size_t m_block = MIN_BLOCK; ///< size of the next read
+    size_t m_consumed = 0;
+    size_t m_pulled = 0;
+    bool m_stream_eof = false;
+    bool m_eof = false;
+};
+
+}  // sharq namespace
+
+#endif
@@ -106,6 +106,11 @@ private:
     void xCreateWriterFromDigest(json& data);
     bool xIsSingleFileInput() const;
 
+    /*
+    * @brief Number of input decompression threads: --threads limited by the number of cores
+    */
+    unsigned xDecompressionThreads() const;
+
     /*
     * @brief Set platform code from platfom parameter
     */
@@ -672,6 +677,12 @@ void CFastqParseApp::xCreateWriterFromDigest(json& data)
     m_writer->set_attr("platform", to_string(m_platform_code != 0 ? m_platform_code : platform_code));
 }
 
+unsigned CFastqParseApp::xDecompressionThreads() const
+{
+    unsigned cores = thread::hardware_concurrency();
+    return cores ? min(mThreads, cores) : 1;
+}
+
 int CFastqParseApp::xRun()
 {
     if (mInputBatches.empty())
@@ -693,6 +704,7 @@ int CFastqParseApp::xRun()
         if (!mDebug)
             parser.set_spot_file(mSpotFile);
         parser.set_allow_early_end(mAllowEarlyFileEnd);
+        parser.set_decompression_threads(xDecompressionThreads());
         m_writer->open();
         auto err_checker = [this](fastq_error& e) -> void { CFastqParseApp::xCheckErrorLimits(e);};
         for (auto& group : data["groups"]) {
@@ -805,6 +817,7 @@ int CFastqParseApp::xRunSpotAssembly()
             parser.set_spot_file(mSpotFile);
         parser.set_allow_early_end(mAllowEarlyFileEnd);
         parser.set_hot_reads_threshold(mHotReadsThreshold);
+        parser.set_decompression_threads(xDecompressionThreads());
 
         //auto err_checker = [this](fastq_error& e) { CFastqParseApp::xCheckErrorLimits(e);};
         for (auto& group : data["groups"]) {
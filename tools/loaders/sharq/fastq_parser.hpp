@@ -48,6 +48,8 @@
 #include "hashing.hpp"
 // input streams
 #include "bxzstr/bxzstr.hpp"
+#include "fastq_input_stream.hpp"
+#include "fastq_line_reader.hpp"
 #include <bm/bm64.h>
 #include <bm/bmdbg.h>
 #include <bm/bmtimer.h>
@@ -278,6 +280,7 @@ public:
     fastq_reader(const string& file_name, shared_ptr<istream> _stream, vector<char> read_type = {'B'}, int platform = 0, bool match_all = false)
         : m_file_name(file_name)
         , m_stream(_stream)
+        , m_lines(*m_stream)
         , m_read_type(read_type)
         , m_read_type_sz(m_read_type.size())
         , m_curr_platform(platform)
@@ -292,6 +295,7 @@ public:
             m_defline_parser(other.m_defline_parser),
             m_file_name(other.m_file_name),
             m_stream(other.m_stream),
+            m_lines(*m_stream),
             m_read_type(other.m_read_type),
             m_read_type_sz(other.m_read_type_sz),
             m_curr_platform(other.m_curr_platform)
@@ -372,7 +376,7 @@ public:
     template<typename ScoreValidator = validator_options<>>
     bool get_spot_mt(const string& spot_name, vector<CFastqRead>& reads);
 
-    bool eof() const { return m_stream->eof();}  ///< Returns true if file is  at eof
+    bool eof() const { return m_lines.eof();}  ///< Returns true if file is  at eof
     // multi-threaded version of eof
     bool eof_mt() const { return m_read_queue->is_done && m_read_queue->queue.peek() == nullptr;}  ///< Returns true if file is at eof
 
@@ -389,6 +393,8 @@ public:
      *
      */
     bool is_compressed() const {
+        if (auto mt_stream = dynamic_cast<sharq::input_stream*>(&*m_stream))
+            return mt_stream->compression() != bxz::plaintext;
         auto fstream = dynamic_cast<bxz::ifstream*>(&*m_stream);
         return fstream ? fstream->compression() != bxz::plaintext : false;
     }
@@ -399,8 +405,27 @@ public:
      * @return size_t
      */
     size_t tellg() const {
-        auto fstream = dynamic_cast<bxz::ifstream*>(&*m_stream);
-        return fstream ? fstream->compressed_tellg() : m_stream->tellg();
+        size_t pos;
+        if (auto mt_stream = dynamic_cast<sharq::input_stream*>(&*m_stream))
+            pos = mt_stream->compressed_tellg();
+        else if (auto fstream = dynamic_cast<bxz::ifstream*>(&*m_stream))
+            pos = fstream->compressed_tellg();
+        else
+            pos = m_stream->tellg();
+        // the stream is read ahead of the parsed lines by up to a block
+        if (pos == size_t(-1) || m_lines.pulled() == 0)
+            return pos;
+        return size_t((double)pos * m_lines.consumed() / m_lines.pulled());
+    }
+
+    /**
+     * @brief returns decompression statistics (mode "none" if the stream decompresses on the reading thread)
+     *
+     */
+    sharq::decompression_metrics_t decompression_metrics() const {
+        if (auto mt_stream = dynamic_cast<sharq::input_stream*>(&*m_stream))
+            return mt_stream->metrics();
+        return {};
     }
 
     const set<string>& AllDeflineTypes() const { return m_defline_parser.AllDeflineTypes(); } ///< retruns set of defline types processed by the reader
@@ -438,16 +463,25 @@ public:
     data_input_metrics_t m_input_metrics;
 
 private:
+    /**
+     * @brief Reads the next line into m_raw_line and m_line_view (trimmed), counts it
+     *
+     * as std::getline did: a last line without '\n' is counted unless it is empty
+     */
+    void get_line();
+
     CDefLineParser      m_defline_parser;       ///< Defline parser
     string              m_file_name;            ///< Corresponding file name
     shared_ptr<istream> m_stream;               ///< reader's stream
+    sharq::line_reader  m_lines;                ///< lines of m_stream
     vector<char>        m_read_type;            ///< Reader's readType (T|B|A), A - illumina, set based on read length
     size_t              m_line_number = 0;      ///< Line number counter (1-based)
     string              m_buffered_defline;     ///< Defline already read from the stream but not placed in a read
     vector<CFastqRead>  m_buffered_spot;        ///< Spot already read from the stream but no returned to the consumer
     vector<CFastqRead>  m_pending_spot;         ///< Partial spot with the first read only
-    string              m_line;                     ///< Temporary variable to hold current line
-    string_view         m_line_view;                ///< Temporary variable to hold string_view to the current line
+    string              m_line;                     ///< Temporary variable to hold a buffered defline
+    string_view         m_raw_line;                 ///< Current line as read (a view into m_lines' block)
+    string_view         m_line_view;                ///< Current line, trimmed
     string              m_tmp_str;                  ///< Temporary string holder
     int                 m_read_type_sz = 0;         ///< Temporary variable yto hold readtype vector size
     int                 m_curr_platform = 0;        ///< current platform
@@ -468,10 +502,24 @@ private:
 };
 
 //  ----------------------------------------------------------------------------
+/**
+ * @brief Opens an input file
+ *
+ * With more than one thread compressed files are decompressed in the background:
+ * BGZF members by up to 'threads' threads, other formats on a read-ahead thread
+ *
+ * @param[in] filename file name, "-" for stdin
+ * @param[in] buffer_size decompression buffer size
+ * @param[in] threads number of decompression threads
+ */
 static
-shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size)
+shared_ptr<istream> s_OpenStream(const string& filename, size_t buffer_size, unsigned threads = 1)
 {
-    shared_ptr<istream> is = (filename != "-") ? shared_ptr<istream>(new bxz::ifstream(filename, ios::in, buffer_size)) : shared_ptr<istream>(new bxz::istream(std::cin));
+    shared_ptr<istream> is;
+    if (filename != "-" && threads > 1)
+        is = sharq::open_input_stream(filename, buffer_size, threads);
+    if (!is)
+        is = (filename != "-") ? shared_ptr<istream>(new bxz::ifstream(filename, ios::in, buffer_size)) : shared_ptr<istream>(new bxz::istream(std::cin));
     if (!is->good())
         throw runtime_error("Failure to open '" + filename + "'");
     return is;
@@ -686,6 +734,14 @@ public:
         m_spot_assembly.m_hot_reads_threshold = threshold;
     }
 
+    /**
+     * @brief Set number of threads decompressing the input files of a group
+     * default: 1 (decompression on the reading thread)
+    */
+    void set_decompression_threads(unsigned threads) {
+        m_decompression_threads = max(threads, 1u);
+    }
+
 private:
 
     /**
@@ -706,6 +762,7 @@ private:
         size_t number_of_spots_with_orphans = 0;
         size_t max_sequence_size = 0;
         size_t min_sequence_size = numeric_limits<size_t>::max();
+        vector<sharq::decompression_metrics_t> decompression; ///< per file, in the order of files
     };
 
     struct spot_assembly_metrics_t {
@@ -754,6 +811,7 @@ private:
     str_sv_type::back_insert_iterator m_spot_names_bi; ///< Internal back_inserter for spot_names collection
     vector<char>         m_read_types;                 ///< ReadTypes
     int                  m_read_type_sz{0};            ///< ReadTypes size
+    unsigned             m_decompression_threads{1};   ///< Decompression threads shared by the group's readers
 
     spot_assembly_t m_spot_assembly;
     std::shared_ptr<spdlog::logger> m_logger;
@@ -782,25 +840,20 @@ void s_trim(string_view& in)
         in.remove_suffix(sz - pos);
 }
 
-#define GET_LINE(stream, line, str, count) {\
-line.clear(); \
-if (getline(stream, line).eof()) { \
-    str = line;\
-    if (!line.empty()) {\
-        ++count;\
-        s_trim(str); \
-    } \
-} else { \
-    ++count;\
-    s_trim(str = line); \
-}\
-}\
+inline
+void fastq_reader::get_line()
+{
+    if (m_lines.get_line(m_raw_line) || !m_raw_line.empty())
+        ++m_line_number;
+    m_line_view = m_raw_line;
+    s_trim(m_line_view);
+}
 
 //  ----------------------------------------------------------------------------
 template<typename ScoreValidator>
 bool fastq_reader::parse_read(CFastqRead& read)
 {
-    if (m_stream->eof())
+    if (m_lines.eof())
         return false;
     read.Reset();
     if (!m_buffered_defline.empty()) {
@@ -808,12 +861,12 @@ bool fastq_reader::parse_read(CFastqRead& read)
         swap(m_line, m_buffered_defline);
         m_line_view = m_line;
     } else {
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        get_line();
         // skip empty lines
         while (m_line_view.empty()) {
-            if (m_stream->eof())
+            if (m_lines.eof())
                 return false;
-            GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+            get_line();
         }
     }
 
@@ -823,23 +876,23 @@ bool fastq_reader::parse_read(CFastqRead& read)
     m_defline_parser.Parse(m_line_view, read); // may throw
 
     // sequence
-    GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+    get_line();
     while (!m_line_view.empty() && m_line_view[0] != '+') {
         if (m_line_view[0] == '@' || m_line_view[0] == '>') {
             // defline is expected to start with '@' or '>'
             // if it is not, we skip it
-            m_buffered_defline = m_line;
+            m_buffered_defline = m_raw_line;
             break;
         }
         m_input_metrics.sequence_len += m_line_view.size();
         read.AddSequenceLine(m_line_view);
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        get_line();
     }
 
     if (!m_line_view.empty() && m_line_view[0] == '+') { // quality score defline
         // quality score defline is expected to start with '+'
         // we skip it
-        GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+        get_line();
         if (!m_line_view.empty()) {
             size_t sequence_size = read.Sequence().size();
             if constexpr (ScoreValidator::type() == eNumeric) {
@@ -848,14 +901,14 @@ bool fastq_reader::parse_read(CFastqRead& read)
             do {
                 // attempt to detect a missing quality score
                 if (m_line_view[0] == '@' && m_line_view.size() != sequence_size && m_defline_parser.MatchLast(m_line_view)) {
-                    m_buffered_defline = m_line;
+                    m_buffered_defline = m_raw_line;
                     break;
                 }
                 m_input_metrics.quality_len += m_line_view.size();
                 read.AddQualityLine(m_line_view);
                 if (read.Quality().size() >= sequence_size)
                     break;
-                GET_LINE(*m_stream, m_line, m_line_view, m_line_number);
+                get_line();
                 if (m_line_view.empty())
                     break;
             } while (true);
@@ -1404,6 +1457,7 @@ void fastq_parser<TWriter>::update_readers_telemetry()
 
         auto& group = m_telemetry.groups.back();
         group.defline_types.insert(reader.AllDeflineTypes().begin(), reader.AllDeflineTypes().end());
+        group.decompression.push_back(reader.decompression_metrics());
     }
 
     for (size_t i = 0; i < m_telemetry.input_metrics.base_counts.size(); ++i) {
@@ -1897,13 +1951,14 @@ void fastq_parser<TWriter>::set_readers(json& group, bool update_telemetry)
         return;
     uint8_t files_with_read_numbers = 0;
     vector<char> read_types;
+    unsigned decompression_threads = max<unsigned>(m_decompression_threads / group["files"].size(), 1);
     for (auto& data : group["files"]) {
         const string& name = data["file_path"];
         if (data.contains("readType"))
             read_types = data["readType"];
         else
             read_types.clear();
-        m_readers.emplace_back(name, s_OpenStream(name, (1024 * 1024) * 10), read_types, data["platform_code"].front());
+        m_readers.emplace_back(name, s_OpenStream(name, (1024 * 1024) * 10, decompression_threads), read_types, data["platform_code"].front());
         if (!data["readNums"].empty())
             ++files_with_read_numbers;
     }
@@ -1938,6 +1993,22 @@ void fastq_parser<TWriter>::report_telemetry(json& j)
             g["number_of_spots_with_orphans"] = gr.number_of_spots_with_orphans;
             g["max_sequence_size"] = gr.max_sequence_size;
             g["min_sequence_size"] = gr.min_sequence_size;
+            for (size_t i = 0; i < gr.decompression.size() && i < gr.files.size(); ++i) {
+                const auto& dm = gr.decompression[i];
+                if (dm.mode == "none")
+                    continue;
+                json d;
+                d["file"] = gr.files[i];
+                d["mode"] = dm.mode;
+                d["threads"] = dm.threads;
+                d["compressed_bytes"] = dm.compressed_bytes;
+                d["bytes"] = dm.bytes;
+                d["cpu_time"] = ceil(dm.cpu_time * 100.0) / 100.0;
+                d["wall_time"] = ceil(dm.wall_time * 100.0) / 100.0;
+                if (dm.wall_time > 0)
+                    d["mb_per_sec"] = ceil(dm.bytes / dm.wall_time / (1024.0 * 1024.0) * 100.0) / 100.0;
+                g["decompression"].push_back(d);
+            }
             defline_types.insert(gr.defline_types.begin(), gr.defline_types.end());
         }
         for (const auto &d : defline_types)
@@ -8,6 +8,7 @@
 
 #include "fastq_error.hpp"
 #include <re2/re2.h>
+#include <array>
 
 using namespace std;
 
@@ -152,7 +153,17 @@ translate( char ch )
 
 void CFastqRead::AddSequenceLine(const string_view& sequence)
 {   // self.transDashUridineX = str.maketrans('-uUX?', 'NtTNN')
-    std::transform(sequence.begin(), sequence.end(), std::back_inserter(mSequence), translate);
+    static const auto table = []() {
+        array<char, 256> t;
+        for (int c = 0; c < 256; ++c)
+            t[c] = c < 128 ? translate(char(c)) : char(c);
+        return t;
+    }();
+    size_t const pos = mSequence.size();
+    mSequence.resize(pos + sequence.size());
+    char* out = &mSequence[pos];
+    for (size_t i = 0; i < sequence.size(); ++i)
+        out[i] = table[(uint8_t)sequence[i]];
     //mSequence.append(sequence.begin(), sequence.end());
 }
 
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <iostream>
+#include <string_view>
 
 #include <re2/re2.h>
 
@@ -62,6 +63,24 @@ public:
         return re2::RE2::PartialMatchN(input, *re, args.empty() ? nullptr : &args[0], (int)args.size());
     }
 
+    /**
+     * @brief Fill the matched groups with a hand-written scanner instead of the regex
+     *
+     * The scanner must accept only input the regex matches and capture the same groups
+     *
+     * @param[in] input string to match
+     * @param[in] scanner bool(const std::string_view&, MatchResult&)
+     * @return true if the scanner accepted the input
+     */
+    template<typename Scanner>
+    bool Scan(const std::string_view& input, Scanner scanner)
+    {
+        if (!scanner(input, match))
+            return false;
+        mLastInput.assign(input.data(), input.size());
+        return true;
+    }
+
     /**
      * @brief return last input line
      *